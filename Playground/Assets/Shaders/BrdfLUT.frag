@@ -0,0 +1,62 @@
+#version 460
+
+// Split sum environment BRDF for the IBL specular term. x = N.V, y = roughness, (scale, bias) for F0.
+
+#define PI				3.14159265359
+#define SAMPLE_COUNT	1024u
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+//---------------------------------------------------------------------------------------------------------------------
+float radicalInverse(uint bits)
+{
+	return float(bitfieldReverse(bits)) * 2.3283064365386963e-10;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void main()
+{
+	float NdotV = max(inUV.x, 1e-4);
+	float roughness = inUV.y;
+	float alpha = roughness * roughness;
+	float alphaSq = alpha * alpha;
+
+	// Smith G with the IBL remapping k = alpha / 2
+	float k = alpha * 0.5;
+
+	vec3 view = vec3(sqrt(1.0 - NdotV * NdotV), 0.0, NdotV);
+
+	float scale = 0.0;
+	float bias = 0.0;
+	for (uint i = 0; i < SAMPLE_COUNT; ++i)
+	{
+		float u1 = float(i) / float(SAMPLE_COUNT);
+		float u2 = radicalInverse(i);
+
+		float phi = 2.0 * PI * u1;
+		float cosTheta = sqrt((1.0 - u2) / (1.0 + (alphaSq - 1.0) * u2));
+		float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+		vec3 halfVector = vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+
+		float VdotH = dot(view, halfVector);
+		vec3 light = halfVector * (2.0 * VdotH) - view;
+
+		float NdotL = light.z;
+		if (NdotL <= 0.0)
+			continue;
+
+		float NdotH = max(halfVector.z, 0.0);
+		float clampedVdotH = max(VdotH, 0.0);
+
+		float geometry = (NdotV / (NdotV * (1.0 - k) + k)) * (NdotL / (NdotL * (1.0 - k) + k));
+		float visibility = geometry * clampedVdotH / (NdotH * NdotV);
+		float fresnel = pow(1.0 - clampedVdotH, 5.0);
+
+		scale += (1.0 - fresnel) * visibility;
+		bias += fresnel * visibility;
+	}
+
+	outColor = vec4(scale / float(SAMPLE_COUNT), bias / float(SAMPLE_COUNT), 0.0, 1.0);
+}
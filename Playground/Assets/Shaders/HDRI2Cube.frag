@@ -0,0 +1,29 @@
+#version 460
+
+// Equirect HDRI -> one cubemap face, a single bilinear lookup per texel. VulkanTextureCUBE::CreateTextureCubeFromHDRI binds
+// the HDRI as m_pTextureHDRI.
+
+#define PI 3.14159265359
+
+layout(set = 0, binding = 0) uniform sampler2D equirectMap;
+
+layout(location = 0) in vec3 inDirection;
+
+layout(location = 0) out vec4 outColor;
+
+//---------------------------------------------------------------------------------------------------------------------
+// Longitude from -X around to -Z, row 0 at the bottom of the HDRI
+vec2 equirectUV(vec3 direction)
+{
+	float phi = atan(-direction.z, -direction.x);
+	if (phi < 0.0)
+		phi += 2.0 * PI;
+
+	return vec2(phi / (2.0 * PI), 1.0 - acos(clamp(direction.y, -1.0, 1.0)) / PI);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void main()
+{
+	outColor = vec4(texture(equirectMap, equirectUV(normalize(inDirection))).rgb, 1.0);
+}
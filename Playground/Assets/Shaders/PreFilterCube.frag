@@ -0,0 +1,79 @@
+#version 460
+
+// GGX prefiltered specular for one level of VulkanTextureCUBE::CreatePrefilteredSpecMap, roughness comes in per level.
+// Importance samples the distribution with N = V & reads the environment level that matches each sample's solid angle.
+
+#define PI 3.14159265359
+
+// Layout matches PrefilterShaderPushData
+layout(push_constant) uniform PrefilterPush
+{
+	mat4	mvp;
+	float	roughness;
+	uint	numSamples;
+} push;
+
+layout(set = 0, binding = 0) uniform samplerCube environmentMap;
+
+layout(location = 0) in vec3 inDirection;
+
+layout(location = 0) out vec4 outColor;
+
+//---------------------------------------------------------------------------------------------------------------------
+float radicalInverse(uint bits)
+{
+	return float(bitfieldReverse(bits)) * 2.3283064365386963e-10;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void main()
+{
+	vec3 normal = normalize(inDirection);
+
+	float maxLod = float(textureQueryLevels(environmentMap) - 1);
+	if (push.roughness <= 0.0)
+	{
+		outColor = vec4(textureLod(environmentMap, normal, 0.0).rgb, 1.0);
+		return;
+	}
+
+	vec3 up = abs(normal.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, normal));
+	vec3 bitangent = cross(normal, tangent);
+
+	uint sampleCount = max(push.numSamples, 1u);
+	float alpha = push.roughness * push.roughness;
+	float alphaSq = alpha * alpha;
+
+	float faceSize = float(textureSize(environmentMap, 0).x);
+	float texelSolidAngle = 4.0 * PI / (6.0 * faceSize * faceSize);
+
+	vec3 radiance = vec3(0.0);
+	float totalWeight = 0.0;
+	for (uint i = 0; i < sampleCount; ++i)
+	{
+		float u1 = (float(i) + 0.5) / float(sampleCount);
+		float u2 = radicalInverse(i);
+
+		float phi = 2.0 * PI * u1;
+		float cosTheta = sqrt((1.0 - u2) / (1.0 + (alphaSq - 1.0) * u2));
+		float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+
+		vec3 halfVector = vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+		vec3 light = halfVector * (2.0 * cosTheta) - vec3(0.0, 0.0, 1.0);
+		if (light.z <= 0.0)
+			continue;
+
+		// pdf of L is D / 4 with N = V, one level up against aliasing
+		float denominator = (alphaSq - 1.0) * cosTheta * cosTheta + 1.0;
+		float distribution = alphaSq / (PI * denominator * denominator);
+		float sampleSolidAngle = 1.0 / (float(sampleCount) * distribution * 0.25 + 1e-6);
+		float lod = clamp(0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0, 0.0, maxLod);
+
+		vec3 direction = tangent * light.x + bitangent * light.y + normal * light.z;
+		radiance += textureLod(environmentMap, direction, lod).rgb * light.z;
+		totalWeight += light.z;
+	}
+
+	outColor = vec4(radiance / max(totalWeight, 1e-6), 1.0);
+}
@@ -0,0 +1,20 @@
+#version 460
+
+// Renders DummySkybox from the centre for one face of one level of VulkanTextureCUBE's prefiltered specular bake.
+
+// Leading matrix of PrefilterShaderPushData, roughness & sample count are only read by the fragment stage
+layout(push_constant) uniform CubeFacePush
+{
+	mat4	mvp;
+} push;
+
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) out vec3 outDirection;
+
+//---------------------------------------------------------------------------------------------------------------------
+void main()
+{
+	outDirection = inPosition;
+	gl_Position = push.mvp * vec4(inPosition, 1.0);
+}
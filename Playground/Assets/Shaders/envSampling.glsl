@@ -0,0 +1,94 @@
+// Environment importance sampling, GPU side of Texture::EnvironmentSampling. Include with GL_GOOGLE_include_directive after
+// defining ENV_SAMPLING_SET & ENV_SAMPLING_BINDING, the alias table takes that binding & the equirect the one after it.
+// Texel layout matches Texture::EnvironmentAliasGPU & the direction mapping Texture::EquirectDirection.
+
+#ifndef ENV_SAMPLING_GLSL
+#define ENV_SAMPLING_GLSL
+
+#define ENV_PI 3.14159265359
+
+struct EnvAliasEntry
+{
+	float	probability;
+	uint	alias;
+	float	texelPdf;
+	float	padding;
+};
+
+layout(std430, set = ENV_SAMPLING_SET, binding = ENV_SAMPLING_BINDING) readonly buffer EnvAliasTable
+{
+	EnvAliasEntry entries[];
+} envAlias;
+
+layout(set = ENV_SAMPLING_SET, binding = ENV_SAMPLING_BINDING + 1) uniform sampler2D envMap;
+
+//---------------------------------------------------------------------------------------------------------------------
+vec3 envDirection(vec2 uv)
+{
+	float phi = 2.0 * ENV_PI * uv.x;
+	float theta = ENV_PI * (1.0 - uv.y);
+
+	return vec3(-sin(theta) * cos(phi), cos(theta), -sin(theta) * sin(phi));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+vec2 envUV(vec3 direction)
+{
+	float phi = atan(-direction.z, -direction.x);
+	if (phi < 0.0)
+		phi += 2.0 * ENV_PI;
+
+	return vec2(phi / (2.0 * ENV_PI), 1.0 - acos(clamp(direction.y, -1.0, 1.0)) / ENV_PI);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+float envSolidAnglePdf(float texelPdf, float sinTheta)
+{
+	return sinTheta > 0.0 ? texelPdf / (2.0 * ENV_PI * ENV_PI * sinTheta) : 0.0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Pdf per steradian of a direction from any other strategy, for MIS weights
+float envPdf(vec3 direction)
+{
+	ivec2 size = textureSize(envMap, 0);
+	ivec2 texel = min(ivec2(envUV(direction) * vec2(size)), size - 1);
+
+	float sinTheta = sqrt(max(0.0, 1.0 - direction.y * direction.y));
+	return envSolidAnglePdf(envAlias.entries[texel.y * size.x + texel.x].texelPdf, sinTheta);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// u.x picks the texel, u.y decides between it & its alias & gets reused for the row offset, u.z is the column offset.
+// envMap holds the same rows the table was built from, row 0 at the bottom, so texels line up with table entries.
+vec3 sampleEnvAlias(vec3 u, out vec3 direction, out float pdf)
+{
+	ivec2 size = textureSize(envMap, 0);
+	uint texelCount = uint(size.x * size.y);
+
+	uint texel = min(uint(u.x * float(texelCount)), texelCount - 1);
+	EnvAliasEntry entry = envAlias.entries[texel];
+
+	float offsetY;
+	if (u.y < entry.probability)
+	{
+		offsetY = u.y / entry.probability;
+	}
+	else
+	{
+		offsetY = (u.y - entry.probability) / (1.0 - entry.probability);
+		texel = entry.alias;
+		entry = envAlias.entries[texel];
+	}
+
+	uint x = texel % uint(size.x);
+	uint y = texel / uint(size.x);
+	vec2 uv = vec2((float(x) + u.z) / float(size.x), (float(y) + min(offsetY, 0.99999994)) / float(size.y));
+
+	direction = envDirection(uv);
+	pdf = envSolidAnglePdf(entry.texelPdf, sin(ENV_PI * (1.0 - uv.y)));
+
+	return texelFetch(envMap, ivec2(x, y), 0).rgb;
+}
+
+#endif
@@ -0,0 +1,106 @@
+// Shared by the IBL compute stages, the GPU side of VulkanComputeIBL. Cube stages cover every face & level in one dispatch:
+// workgroups are 8x8 tiles laid out level by level, groupOffsets holds the first workgroup of each level (& the total after
+// the last one), so a whole workgroup always lands in one face of one level. Only core features, no extended storage
+// formats, no subgroups & no dynamic indexing of storage image arrays.
+
+#ifndef IBL_COMPUTE_GLSL
+#define IBL_COMPUTE_GLSL
+
+#define IBL_PI			3.14159265359
+#define IBL_TILE		8
+#define IBL_MAX_LEVELS	13
+
+layout(local_size_x = IBL_TILE, local_size_y = IBL_TILE, local_size_z = 1) in;
+
+// Layout matches IBLComputePushData
+layout(push_constant) uniform IBLComputePush
+{
+	uint	levelCount;
+	uint	dimension;				// Level 0 size of the output
+	uint	sourceWidth;			// Equirect for the environment stage, environment cube face for the prefilter
+	uint	sourceHeight;
+	uint	sourceLevels;
+	uint	minSamples;
+	uint	maxSamples;
+	uint	groupsPerRow;			// Dispatch width, workgroups are numbered row by row
+	uint	groupOffsets[16];
+} push;
+
+// Faces in Texture::CubemapDirection order & orientation, which is also how samplerCube looks them up
+const vec3 IBL_FACE_CENTRE[6]	= vec3[](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 IBL_FACE_RIGHT[6]	= vec3[](vec3(0, 0, -1), vec3(0, 0, 1), vec3(1, 0, 0), vec3(1, 0, 0), vec3(1, 0, 0), vec3(-1, 0, 0));
+const vec3 IBL_FACE_DOWN[6]		= vec3[](vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0));
+
+//---------------------------------------------------------------------------------------------------------------------
+vec3 iblCubeDirection(uint face, vec2 uv)
+{
+	vec2 st = 2.0 * uv - 1.0;
+	return normalize(IBL_FACE_CENTRE[face] + IBL_FACE_RIGHT[face] * st.x + IBL_FACE_DOWN[face] * st.y);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+float iblRadicalInverse(uint bits)
+{
+	return float(bitfieldReverse(bits)) * 2.3283064365386963e-10;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Level, face & texel of this invocation, false for the ones past the edge of a level smaller than a tile
+bool iblLocateTexel(out uint level, out uint face, out ivec2 texel, out uint extent)
+{
+	uint group = gl_WorkGroupID.y * push.groupsPerRow + gl_WorkGroupID.x;
+
+	level = 0;
+	face = 0;
+	texel = ivec2(0);
+	extent = push.dimension;
+
+	if (group >= push.groupOffsets[push.levelCount])
+		return false;
+
+	while (level + 1 < push.levelCount && group >= push.groupOffsets[level + 1])
+		++level;
+
+	extent = max(push.dimension >> level, 1u);
+
+	uint tilesPerSide = (extent + IBL_TILE - 1) / IBL_TILE;
+	uint tile = group - push.groupOffsets[level];
+
+	face = tile / (tilesPerSide * tilesPerSide);
+	tile = tile % (tilesPerSide * tilesPerSide);
+
+	texel = ivec2((tile % tilesPerSide) * IBL_TILE + gl_LocalInvocationID.x, (tile / tilesPerSide) * IBL_TILE + gl_LocalInvocationID.y);
+
+	return texel.x < int(extent) && texel.y < int(extent);
+}
+
+#ifdef IBL_CUBE_OUTPUT
+
+// One 6 layer view per level, unused entries repeat the last level
+layout(set = 0, binding = 1, rgba32f) uniform writeonly image2DArray outLevels[IBL_MAX_LEVELS];
+
+//---------------------------------------------------------------------------------------------------------------------
+// Constant indices only, shaderStorageImageArrayDynamicIndexing is optional
+void iblStoreLevel(uint level, ivec3 coord, vec4 value)
+{
+	switch (level)
+	{
+		case 0:		imageStore(outLevels[0], coord, value);		break;
+		case 1:		imageStore(outLevels[1], coord, value);		break;
+		case 2:		imageStore(outLevels[2], coord, value);		break;
+		case 3:		imageStore(outLevels[3], coord, value);		break;
+		case 4:		imageStore(outLevels[4], coord, value);		break;
+		case 5:		imageStore(outLevels[5], coord, value);		break;
+		case 6:		imageStore(outLevels[6], coord, value);		break;
+		case 7:		imageStore(outLevels[7], coord, value);		break;
+		case 8:		imageStore(outLevels[8], coord, value);		break;
+		case 9:		imageStore(outLevels[9], coord, value);		break;
+		case 10:	imageStore(outLevels[10], coord, value);	break;
+		case 11:	imageStore(outLevels[11], coord, value);	break;
+		case 12:	imageStore(outLevels[12], coord, value);	break;
+	}
+}
+
+#endif
+
+#endif
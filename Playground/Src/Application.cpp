@@ -9,6 +9,8 @@
 #include "Engine/Renderer/RTXRenderer.h"
 #include "Engine/Helpers/Camera.h"
 
+#include "imgui.h"
+
 
 //---------------------------------------------------------------------------------------------------------------------
 Application::Application(const std::string& _title)
@@ -177,6 +179,19 @@ void Application::EventMousePositionCallback(GLFWwindow* pWindow, double xPos, d
 //---------------------------------------------------------------------------------------------------------------------
 void Application::EventMouseButtonCallback(GLFWwindow* pWindow, int button, int action, int mods)
 {
+    // Clicks on UI windows belong to ImGui
+    if (ImGui::GetIO().WantCaptureMouse)
+        return;
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+    {
+        Application* pApp = static_cast<Application*>(glfwGetWindowUserPointer(pWindow));
+
+        double xPos, yPos;
+        glfwGetCursorPos(pWindow, &xPos, &yPos);
+
+        pApp->m_pRenderer->PickObject(xPos, yPos);
+    }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,143 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "JobSystem.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+JobSystem::JobSystem()
+{
+	m_bShutdown = false;
+
+	// Calling thread participates while waiting, so leave one hardware thread for it!
+	const uint32_t hwThreads = std::max(2u, std::thread::hardware_concurrency());
+	for (uint32_t i = 0; i < hwThreads - 1; ++i)
+	{
+		m_vecWorkers.emplace_back(&JobSystem::WorkerLoop, this);
+	}
+
+	LOG_DEBUG("JobSystem started with {0} worker threads", m_vecWorkers.size());
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexJobs);
+		m_bShutdown = true;
+	}
+
+	m_cvJobs.notify_all();
+
+	for (std::thread& worker : m_vecWorkers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+
+	m_vecWorkers.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JobSystem::Run(TaskGroup* pGroup, const std::function<void()>& job)
+{
+	if (pGroup)
+		pGroup->m_uiPending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexJobs);
+		m_queueJobs.push_back({ job, pGroup });
+	}
+
+	m_cvJobs.notify_one();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JobSystem::Wait(TaskGroup* pGroup)
+{
+	while (!pGroup->IsDone())
+	{
+		// Help out instead of blocking, otherwise nested waits can starve the pool! Only with our own group's jobs,
+		// anything else may run far longer than what we're waiting on.
+		if (!TryRunPendingJob(pGroup))
+			std::this_thread::yield();
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func)
+{
+	if (count == 0)
+		return;
+
+	// Aim for a few chunks per thread so uneven chunks still balance out
+	const uint32_t targetChunks = GetThreadCount() * 4;
+	const uint32_t chunkSize = std::max(std::max(grainSize, 1u), (count + targetChunks - 1) / targetChunks);
+
+	if (chunkSize >= count)
+	{
+		func(0, count);
+		return;
+	}
+
+	TaskGroup group;
+	for (uint32_t begin = chunkSize; begin < count; begin += chunkSize)
+	{
+		const uint32_t end = std::min(begin + chunkSize, count);
+		Run(&group, [&func, begin, end]() { func(begin, end); });
+	}
+
+	// First chunk on the calling thread
+	func(0, chunkSize);
+
+	Wait(&group);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Runs the most recently queued job of pGroup, if any is still waiting in the queue
+bool JobSystem::TryRunPendingJob(TaskGroup* pGroup)
+{
+	Job job;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutexJobs);
+
+		// LIFO for the helping thread keeps nested work hot in cache
+		auto iter = std::find_if(m_queueJobs.rbegin(), m_queueJobs.rend(), [pGroup](const Job& queued) { return queued.pGroup == pGroup; });
+		if (iter == m_queueJobs.rend())
+			return false;
+
+		job = std::move(*iter);
+		m_queueJobs.erase(std::next(iter).base());
+	}
+
+	job.func();
+
+	if (job.pGroup)
+		job.pGroup->m_uiPending.fetch_sub(1, std::memory_order_release);
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		Job job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutexJobs);
+			m_cvJobs.wait(lock, [this]() { return m_bShutdown || !m_queueJobs.empty(); });
+
+			if (m_bShutdown && m_queueJobs.empty())
+				return;
+
+			job = std::move(m_queueJobs.front());
+			m_queueJobs.pop_front();
+		}
+
+		job.func();
+
+		if (job.pGroup)
+			job.pGroup->m_uiPending.fetch_sub(1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Counts outstanding jobs spawned through JobSystem::Run so that a caller can wait on just its own work.
+class TaskGroup
+{
+public:
+	TaskGroup() : m_uiPending(0) {}
+
+	bool								IsDone() const { return m_uiPending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<uint32_t>				m_uiPending;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Fixed pool of worker threads used by the CPU side systems (BVH builds, CPU raytracer, texture processing).
+//--- Waiting threads help by executing queued jobs of the group they wait on, so jobs are free to spawn & wait on
+//--- nested jobs without a waiter picking up unrelated long running work (e.g. a CPU renderer frame).
+class JobSystem
+{
+public:
+	static JobSystem& getInstance()
+	{
+		static JobSystem instance;
+		return instance;
+	}
+
+	~JobSystem();
+
+	void								Run(TaskGroup* pGroup, const std::function<void()>& job);
+	void								Wait(TaskGroup* pGroup);
+
+	// Splits [0, count) into chunks of at least grainSize & runs them in parallel. Blocks until all are done.
+	void								ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func);
+
+	inline uint32_t						GetThreadCount() const { return static_cast<uint32_t>(m_vecWorkers.size()) + 1; }
+
+private:
+	JobSystem();
+	JobSystem(const JobSystem&);
+	void operator=(const JobSystem&);
+
+	struct Job
+	{
+		std::function<void()>			func;
+		TaskGroup*						pGroup;
+	};
+
+	bool								TryRunPendingJob(TaskGroup* pGroup);
+	void								WorkerLoop();
+
+private:
+	std::vector<std::thread>			m_vecWorkers;
+	std::deque<Job>						m_queueJobs;
+	std::mutex							m_mutexJobs;
+	std::condition_variable				m_cvJobs;
+	bool								m_bShutdown;
+};
@@ -157,19 +157,19 @@ namespace Vulkan
 		{
 			deviceAddress	= 0;
 			handle			= VK_NULL_HANDLE;
-			memory			= VK_NULL_HANDLE;
+			allocation		= nullptr;
 		}
 
 		void Cleanup(VulkanDevice* pDevice)
 		{
-			vkFreeMemory(pDevice->m_vkLogicalDevice, memory, nullptr);
-			vkDestroyBuffer(pDevice->m_vkLogicalDevice, handle, nullptr);
+			pDevice->DestroyBuffer(handle, allocation);
+			allocation = nullptr;
 			deviceAddress = 0;
 		}
 
 		uint64_t deviceAddress;
 		VkBuffer handle;
-		VkDeviceMemory memory;
+		VulkanAllocation* allocation;
 	};
 
 
@@ -182,7 +182,7 @@ namespace Vulkan
 			handle			= VK_NULL_HANDLE;
 			deviceAddress	= 0;
 			buffer			= VK_NULL_HANDLE;
-			memory			= VK_NULL_HANDLE;
+			allocation		= nullptr;
 		}
 
 		void Cleanup(VulkanDevice* pDevice)
@@ -190,16 +190,16 @@ namespace Vulkan
 			PFN_vkDestroyAccelerationStructureKHR vkDestroyAccelerationStructureKHR = reinterpret_cast<PFN_vkDestroyAccelerationStructureKHR>
 			(vkGetDeviceProcAddr(pDevice->m_vkLogicalDevice, "vkDestroyAccelerationStructureKHR"));
 
-			vkFreeMemory(pDevice->m_vkLogicalDevice, memory, nullptr);
-			vkDestroyBuffer(pDevice->m_vkLogicalDevice, buffer, nullptr);
 			vkDestroyAccelerationStructureKHR(pDevice->m_vkLogicalDevice, handle, nullptr);
+			pDevice->DestroyBuffer(buffer, allocation);
+			allocation = nullptr;
 			deviceAddress = 0;
 		}
 
 		VkAccelerationStructureKHR handle;
 		uint64_t deviceAddress;
 		VkBuffer buffer;
-		VkDeviceMemory memory;
+		VulkanAllocation* allocation;
 	};
 
 	//-----------------------------------------------------------------------------------------------------------------------
@@ -238,19 +238,19 @@ namespace Vulkan
 		Buffer()
 		{
 			buffer		= VK_NULL_HANDLE;
-			memory		= VK_NULL_HANDLE;
+			allocation	= nullptr;
 			size		= 0;
 			alignment	= 0;
 		}
 
 		void Cleanup(VulkanDevice*	pDevice)
 		{
-			vkFreeMemory(pDevice->m_vkLogicalDevice, memory, nullptr);
-			vkDestroyBuffer(pDevice->m_vkLogicalDevice, buffer, nullptr);
+			pDevice->DestroyBuffer(buffer, allocation);
+			allocation = nullptr;
 		}
 
 		VkBuffer				buffer;
-		VkDeviceMemory			memory;
+		VulkanAllocation*		allocation;					// Host visible ones are mapped at allocation->pMapped
 		VkDeviceSize			size;
 		VkDeviceSize			alignment;
 		VkBufferUsageFlags		usageFlags;
@@ -322,7 +322,7 @@ namespace Vulkan
 
 
 	//-----------------------------------------------------------------------------------------------------------------------
-	//--- Create Shader Module
+	//--- Create Shader Module, VK_NULL_HANDLE when the SPIR-V is missing or broken
 	inline VkShaderModule CreateShaderModule(VulkanDevice* pDevice, const std::string& fileName)
 	{
 		// start reading at the end & in binary mode.
@@ -331,10 +331,19 @@ namespace Vulkan
 		std::ifstream file(fileName, std::ios::ate | std::ios::binary);
 
 		if (!file.is_open())
-			LOG_ERROR("Failed to open Shader file!");
+		{
+			LOG_ERROR("Failed to open Shader file {0}, is it compiled?", fileName);
+			return VK_NULL_HANDLE;
+		}
 
 		// get the file size & allocate buffer memory!
 		size_t fileSize = (size_t)file.tellg();
+		if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0)
+		{
+			LOG_ERROR("Shader file {0} isn't valid SPIR-V ({1} bytes)", fileName, fileSize);
+			return VK_NULL_HANDLE;
+		}
+
 		std::vector<char> buffer(fileSize);
 
 		// now seek back to the beginning of the file & read all bytes at once!
@@ -352,13 +361,14 @@ namespace Vulkan
 		shaderModuleInfo.pNext = nullptr;
 		shaderModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
-		VkShaderModule shaderModule;
-		std::string shaderModuleName = fileName;
-
-		VKRESULT_CHECK_INFO(vkCreateShaderModule(pDevice->m_vkLogicalDevice, &shaderModuleInfo, nullptr, &shaderModule),
-							"Failed to create shader module for " + shaderModuleName,
-							"Successfully created shader module for " + shaderModuleName);
+		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		if (vkCreateShaderModule(pDevice->m_vkLogicalDevice, &shaderModuleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+		{
+			LOG_ERROR("Failed to create shader module for {0}", fileName);
+			return VK_NULL_HANDLE;
+		}
 
+		LOG_DEBUG("Successfully created shader module for {0}", fileName);
 		return shaderModule;
 	}
 
@@ -444,6 +454,102 @@ namespace Vulkan
 			pDevice->EndAndSubmitCommandBuffer(transferCommandBuffer);
 		}
 
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Record copies of tightly packed mip levels from srcBuffer to VkImage, level i starts at vecLevelOffsets[i]
+	inline void CopyImageBufferMips(VkCommandBuffer transferCommandBuffer, VkBuffer srcBuffer, VkImage image, uint32_t width, uint32_t height,
+									const std::vector<VkDeviceSize>& vecLevelOffsets)
+		{
+			std::vector<VkBufferImageCopy> vecRegions(vecLevelOffsets.size());
+			for (uint32_t i = 0; i < vecRegions.size(); ++i)
+			{
+				VkBufferImageCopy& imageRegion = vecRegions[i];
+				imageRegion.bufferOffset = vecLevelOffsets[i];							// offset into data
+				imageRegion.bufferRowLength = 0;										// tightly packed
+				imageRegion.bufferImageHeight = 0;
+				imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				imageRegion.imageSubresource.mipLevel = i;								// mipmap level to copy
+				imageRegion.imageSubresource.baseArrayLayer = 0;
+				imageRegion.imageSubresource.layerCount = 1;
+				imageRegion.imageOffset = { 0,0,0 };
+				imageRegion.imageExtent = { std::max(1u, width >> i), std::max(1u, height >> i), 1 };
+			}
+
+			vkCmdCopyBufferToImage(transferCommandBuffer, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+								   static_cast<uint32_t>(vecRegions.size()), vecRegions.data());
+		}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Fill mip levels 1..nMipmaps-1 by blitting each level from the one above. Expects every level in TRANSFER_DST
+	//--- with level 0 uploaded, leaves every level SHADER_READ_ONLY. Format must support linear filtered blits!
+	inline void GenerateMipmapsBlit(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t nMipmaps)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+
+			int32_t mipWidth = static_cast<int32_t>(width);
+			int32_t mipHeight = static_cast<int32_t>(height);
+
+			for (uint32_t i = 1; i < nMipmaps; ++i)
+			{
+				// Level above becomes the blit source
+				barrier.subresourceRange.baseMipLevel = i - 1;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+									 0, nullptr, 0, nullptr, 1, &barrier);
+
+				const int32_t nextWidth = std::max(1, mipWidth / 2);
+				const int32_t nextHeight = std::max(1, mipHeight / 2);
+
+				VkImageBlit blit = {};
+				blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = i - 1;
+				blit.srcSubresource.baseArrayLayer = 0;
+				blit.srcSubresource.layerCount = 1;
+				blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+				blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.dstSubresource.mipLevel = i;
+				blit.dstSubresource.baseArrayLayer = 0;
+				blit.dstSubresource.layerCount = 1;
+
+				vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							   1, &blit, VK_FILTER_LINEAR);
+
+				// Done reading the level above, hand it to the shaders
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+									 0, nullptr, 0, nullptr, 1, &barrier);
+
+				mipWidth = nextWidth;
+				mipHeight = nextHeight;
+			}
+
+			// Last level was only ever written
+			barrier.subresourceRange.baseMipLevel = nMipmaps - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+								 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
 	//-----------------------------------------------------------------------------------------------------------------------
 	//--- Function to transition image layout from old to new image layout using command pool for VkImage!
 	inline void TransitionImageLayout(VulkanDevice* pDevice, VkImage image, VkImageLayout oldImageLayout, VkImageLayout newImageLayout)
@@ -1135,7 +1241,7 @@ namespace Vulkan
 	//-----------------------------------------------------------------------------------------------------------------------
 	//--- Create VkImage & VkDeviceMemory based on width-height-format-tiling-usageFlags-propertyFlags!
 	inline VkImage CreateImage(VulkanDevice* pDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-		VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory)
+		VkImageUsageFlags usageFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory, uint32_t nMipmaps = 1)
 	{
 		// Image creation info
 		VkImageCreateInfo imageCreateInfo = {};
@@ -1144,7 +1250,7 @@ namespace Vulkan
 		imageCreateInfo.extent.width = width;									// width of image extent
 		imageCreateInfo.extent.height = height;									// height of image extent
 		imageCreateInfo.extent.depth = 1;										// depth of image ( just 1, no 3D aspect) 
-		imageCreateInfo.mipLevels = 1;											// number of mipmap levels
+		imageCreateInfo.mipLevels = nMipmaps;									// number of mipmap levels
 		imageCreateInfo.arrayLayers = 1;										// number of levels in image array
 		imageCreateInfo.format = format;										// format type of image	
 		imageCreateInfo.tiling = tiling;										// how image data should be tiled
@@ -1181,7 +1287,7 @@ namespace Vulkan
 
 	//-----------------------------------------------------------------------------------------------------------------------
 	//--- Create VkImageView for a VkImage
-	inline VkImageView CreateImageView(const VulkanDevice* pDevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+	inline VkImageView CreateImageView(const VulkanDevice* pDevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t nMipmaps = 1)
 		{
 			VkImageViewCreateInfo imageViewCreateInfo = {};
 			imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -1195,7 +1301,7 @@ namespace Vulkan
 
 			imageViewCreateInfo.subresourceRange.aspectMask = aspectFlags;
 			imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-			imageViewCreateInfo.subresourceRange.levelCount = 1;
+			imageViewCreateInfo.subresourceRange.levelCount = nMipmaps;
 			imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
 			imageViewCreateInfo.subresourceRange.layerCount = 1;
 
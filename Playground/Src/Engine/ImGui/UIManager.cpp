@@ -9,6 +9,22 @@
 #include "Engine/Helpers/Log.h"
 #include "Engine/Helpers/Utility.h"
 #include "Engine/Scene.h"
+#include "Engine/Raytracer/CpuRenderer.h"
+#include "Engine/Raytracer/SceneBVH.h"
+#include "Engine/Texture/HDRConverter.h"
+#include "Engine/Texture/IBLCache.h"
+#include "Engine/Texture/MipGenerator.h"
+#include "Engine/Texture/SphericalHarmonics.h"
+#include "Engine/Texture/SpecularPrefilter.h"
+#include "Engine/Texture/TextureCompiler.h"
+#include "Engine/Texture/TextureResidency.h"
+#include "Engine/Renderer/VulkanTextureCache.h"
+#include "Engine/Renderer/VulkanMaterialTable.h"
+#include "Engine/Renderer/VulkanSamplerCache.h"
+#include "Engine/Renderer/VulkanTextureLoader.h"
+#include "Engine/Renderer/VulkanTextureCUBE.h"
+#include "Engine/Renderer/VulkanComputeIBL.h"
+#include "Engine/Renderer/VulkanMemoryAllocator.h"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -18,6 +34,8 @@
 UIManager::UIManager()
 {
 	m_iPassID = 0;
+	m_iCompressionPreset = 0;
+	m_iTextureContainer = 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -400,6 +418,142 @@ void UIManager::RenderDebugStats()
 	ImGui::End();
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+void UIManager::RenderPickingStats(const Raytracer::RayHit& hit, float timeMs, Scene* pScene)
+{
+	ImGui::Begin("Picking");
+
+	if (hit.IsValid())
+	{
+		ImGui::Text("Object: %u", hit.objectIndex);
+		ImGui::Text("Triangle: %u", hit.primitive);
+		ImGui::Text("Distance: %f", hit.t);
+		ImGui::Text("Barycentrics: %f, %f", hit.barycentrics.x, hit.barycentrics.y);
+	}
+	else
+	{
+		ImGui::Text("Object: none");
+	}
+
+	ImGui::Text("Raycast: %.4f ms", timeMs);
+
+	//**** Top level updates
+	Raytracer::SceneBVH* pSceneBVH = pScene->m_pSceneBVH;
+	const Raytracer::DynamicBVHStats& stats = pSceneBVH->m_UpdateStats;
+	ImGui::Text("Refit Nodes: %u", stats.refitNodes);
+	ImGui::Text("Inserts: %u, Removes: %u", stats.inserts, stats.removes);
+	ImGui::Text("Treelets: %u (%u leaves)", stats.treeletsRebuilt, stats.treeletLeaves);
+
+	//**** Synthetic update benchmark, blocks until done
+	if (ImGui::CollapsingHeader("Top Level Benchmark"))
+	{
+		if (ImGui::Button("Run (100k instances)"))
+			pSceneBVH->RunUpdateBenchmark(100000, 30);
+
+		for (const Raytracer::DynamicBVHBenchmarkResult& result : pSceneBVH->m_vecBenchmarkResults)
+		{
+			ImGui::Text("%4.1f%% moving: %7.2f ms vs %7.2f ms rebuild, SAH %.2fx, churn %7.2f ms", result.movingFraction * 100.0f,
+						result.updateMs, result.fullRebuildMs, result.sahRatio, result.churnMs);
+		}
+	}
+
+	ImGui::End();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void UIManager::RenderCpuRendererUI(Raytracer::CpuRenderer* pCpuRenderer, Scene* pScene)
+{
+	ImGui::Begin("CPU Renderer");
+
+	ImGui::Checkbox("Enable", &pCpuRenderer->m_bEnabled);
+
+	int samples = static_cast<int>(pCpuRenderer->m_uiSamplesPerPixel);
+	if (ImGui::SliderInt("Samples Per Pass", &samples, 1, 16))
+		pCpuRenderer->m_uiSamplesPerPixel = static_cast<uint32_t>(samples);
+
+	//**** Accumulation
+	ImGui::Checkbox("Adaptive Sampling", &pCpuRenderer->m_bAdaptiveSampling);
+	ImGui::SliderFloat("Target Noise", &pCpuRenderer->m_fTargetNoise, 0.0f, 0.1f, "%.4f");
+	ImGui::SliderFloat("Pass Budget (ms)", &pCpuRenderer->m_fFrameBudgetMs, 0.0f, 100.0f, "%.1f");
+
+	int maxSamples = static_cast<int>(pCpuRenderer->m_uiMaxSamplesPerPixel);
+	if (ImGui::SliderInt("Max Samples Per Pixel", &maxSamples, 1, 4096))
+		pCpuRenderer->m_uiMaxSamplesPerPixel = static_cast<uint32_t>(maxSamples);
+
+	if (ImGui::Button("Reset Accumulation"))
+		pCpuRenderer->ResetAccumulation();
+
+	const Raytracer::TileSchedulerStats& stats = pCpuRenderer->m_LastFrameStats;
+	ImGui::Text("Resolution: %u x %u", pCpuRenderer->GetWidth(), pCpuRenderer->GetHeight());
+	ImGui::Text("Accumulated: %.1f spp%s", pCpuRenderer->m_fAverageSamples, pCpuRenderer->m_bConverged ? " (converged)" : "");
+	ImGui::Text("Frames: %u completed, %u cancelled", pCpuRenderer->m_uiFramesCompleted, pCpuRenderer->m_uiFramesCancelled);
+	ImGui::Text("Last Pass: %.2f ms, %u threads", stats.timeMs, stats.threadCount);
+	ImGui::Text("Tiles: %u, %u active, %u stolen", stats.tileCount, pCpuRenderer->m_uiActiveTiles, stats.tilesStolen);
+
+	//**** Thread scaling, blocks until every thread count has rendered a frame
+	if (ImGui::CollapsingHeader("Thread Scaling"))
+	{
+		if (ImGui::Button("Measure"))
+			pCpuRenderer->MeasureScaling(pScene);
+
+		for (const Raytracer::CpuScalingResult& result : pCpuRenderer->m_vecScalingResults)
+		{
+			ImGui::Text("%2u threads: %8.2f ms  %5.2fx  %3.0f%%  %s", result.threadCount, result.timeMs, result.speedup,
+						result.efficiency * 100.0f, result.bDeterministic ? "identical" : "DIFFERS");
+		}
+	}
+
+	//**** Time to reach a target error, uniform vs adaptive
+	if (ImGui::CollapsingHeader("Convergence"))
+	{
+		ImGui::SliderFloat("Target RMSE", &pCpuRenderer->m_fTargetError, 0.0005f, 0.05f, "%.4f");
+
+		if (ImGui::Button("Measure Convergence"))
+			pCpuRenderer->MeasureConvergence(pScene);
+
+		for (const Raytracer::CpuConvergenceResult& result : pCpuRenderer->m_vecConvergenceResults)
+		{
+			ImGui::Text("%-8s: %8.2f ms  %6.1f spp  RMSE %.4f%s", result.bAdaptive ? "adaptive" : "uniform", result.timeMs,
+						result.averageSamples, result.rmse, result.bReachedTarget ? "" : " (not reached)");
+		}
+	}
+
+	//**** White diffuse scene under an HDRI, error over time of each way to pick the light direction
+	if (ImGui::CollapsingHeader("Environment Lighting"))
+	{
+		ImGui::Checkbox("Enable##Environment", &pCpuRenderer->m_bEnvironmentLighting);
+
+		const char* modes[] = { "Uniform", "Cosine", "CDF", "Alias" };
+		int mode = static_cast<int>(pCpuRenderer->m_eEnvironmentSampling);
+		if (ImGui::Combo("Sampling", &mode, modes, IM_ARRAYSIZE(modes)))
+			pCpuRenderer->m_eEnvironmentSampling = static_cast<Raytracer::EnvironmentSamplingMode>(mode);
+
+		const Texture::EnvironmentSamplingReport& report = pCpuRenderer->m_EnvironmentReport;
+		ImGui::Text("%s: CDF %.2f ms, alias table %.2f ms", pCpuRenderer->m_strEnvironmentFile.c_str(), report.cdfMs, report.aliasMs);
+
+		if (ImGui::Button("Measure Sampling"))
+			pCpuRenderer->MeasureEnvironmentSampling(pScene);
+
+		for (const Raytracer::CpuEnvironmentSamplingResult& result : pCpuRenderer->m_vecEnvironmentSamplingResults)
+		{
+			const char* name = Raytracer::GetEnvironmentSamplingName(result.eMode);
+			if (result.targetTimeMs >= 0.0f)
+			{
+				ImGui::Text("%-8s: %8.2f ms  %6.1f spp  RMSE %.4f  target in %8.2f ms", name, result.timeMs, result.averageSamples,
+							result.rmse, result.targetTimeMs);
+			}
+			else
+			{
+				ImGui::Text("%-8s: %8.2f ms  %6.1f spp  RMSE %.4f  (not reached)", name, result.timeMs, result.averageSamples, result.rmse);
+			}
+
+			ImGui::PlotLines(name, result.vecRMSE.data(), static_cast<int>(result.vecRMSE.size()), 0, "RMSE per pass", 0.0f, FLT_MAX, ImVec2(0, 40));
+		}
+	}
+
+	ImGui::End();
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void UIManager::HandleWindowResize(GLFWwindow* pWindow, VkInstance instance, VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 {
@@ -472,3 +626,370 @@ void UIManager::CleanupOnWindowResize(VulkanDevice* pDevice)
 	// Cleanup Command Pool
 	vkDestroyCommandPool(pDevice->m_vkLogicalDevice, m_vkCommandPool, nullptr);
 }
+
+//---------------------------------------------------------------------------------------------------------------------
+void UIManager::RenderTextureUI(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
+{
+	ImGui::Begin("Textures");
+
+	//**** Mip generation, blocks until every synthetic chain is generated & validated
+	if (ImGui::CollapsingHeader("Mip Self Test"))
+	{
+		if (ImGui::Button("Run"))
+			m_vecMipSelfTestResults = Texture::RunMipSelfTest();
+
+		for (const Texture::MipSelfTestResult& result : m_vecMipSelfTestResults)
+		{
+			if (result.validation.bValid)
+			{
+				ImGui::Text("%-28s %2u levels %7.2f ms  error %.2f", result.name.c_str(), result.levelCount, result.timeMs, result.validation.maxError);
+			}
+			else
+			{
+				ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%-28s FAILED at level %u  error %.2f", result.name.c_str(),
+								   result.validation.failedLevel, result.validation.maxError);
+			}
+		}
+	}
+
+	//**** Shared textures, stats cover the last scene load
+	if (ImGui::CollapsingHeader("Texture Cache"))
+	{
+		const VulkanTextureCache& cache = VulkanTextureCache::getInstance();
+		const TextureCacheStats& stats = cache.GetStats();
+		const uint32_t hits = stats.pathHits + stats.contentHits;
+
+		ImGui::Text("Resident: %u textures, %.2f MB", cache.GetResidentCount(), cache.GetResidentBytes() / (1024.0f * 1024.0f));
+		ImGui::Text("Requests: %u, loads %u, hits %u (%u by content)", stats.requests, stats.loads, hits, stats.contentHits);
+		ImGui::Text("Hit rate: %.1f%%", stats.requests > 0 ? 100.0f * hits / stats.requests : 0.0f);
+		ImGui::Text("Loaded:   %.2f MB in %.1f ms", stats.loadedBytes / (1024.0f * 1024.0f), stats.loadMs);
+		ImGui::Text("Saved:    %.2f MB, %.1f ms", stats.savedBytes / (1024.0f * 1024.0f), stats.savedMs);
+
+		const TextureLoadStats& batch = VulkanTextureLoader::getInstance().GetLastBatchStats();
+		ImGui::Separator();
+		ImGui::Text("Last batch: %u textures, %.2f MB in %.1f ms", batch.textureCount, batch.uploadBytes / (1024.0f * 1024.0f), batch.totalMs);
+		ImGui::Text("Decode:     %.1f ms on %u threads (%.1f ms serial)", batch.decodeMs, batch.threadCount, batch.decodeCpuMs);
+		ImGui::Text("Upload:     %.1f ms in %u submits", batch.uploadMs, batch.submitCount);
+
+		const SamplerCacheStats samplers = VulkanSamplerCache::getInstance().GetStats();
+		ImGui::Separator();
+		ImGui::Text("Samplers:   %u live for %u textures, peak %u, device limit %u", samplers.liveSamplers, samplers.references,
+					samplers.peakSamplers, samplers.deviceLimit);
+		ImGui::Text("Requests:   %u, hits %u, created %u, destroyed %u", samplers.requests, samplers.hits, samplers.creates, samplers.destroys);
+
+		const BindlessStats bindless = VulkanMaterialTable::getInstance().GetStats();
+		ImGui::Separator();
+		ImGui::Text("Bindless:   %u materials, %u textures, %u models", bindless.materialCount, bindless.textureCount, bindless.modelCount);
+		ImGui::Text("Per model:  %u pools, %u sets, %u descriptors, %u binds/frame", bindless.legacyPools, bindless.legacySets,
+					bindless.legacyDescriptors, bindless.legacyBindsPerFrame);
+		ImGui::Text("Table:      %u pools, %u sets, %u descriptors, %u binds/frame", bindless.pools, bindless.sets,
+					bindless.descriptors, bindless.bindsPerFrame);
+	}
+
+	//**** Mip residency of the cached textures, the simulation checks the policy against synthetic camera paths
+	if (ImGui::CollapsingHeader("Texture Residency"))
+	{
+		Texture::ResidencyManager& residency = VulkanTextureCache::getInstance().GetResidency();
+		const Texture::ResidencyStats& stats = residency.GetStats();
+
+		Texture::ResidencySettings settings = residency.GetSettings();
+		int budgetMB = static_cast<int>(settings.budgetBytes / (1024 * 1024));
+		if (ImGui::SliderInt("Budget (MB)", &budgetMB, 16, 4096))
+		{
+			settings.budgetBytes = static_cast<uint64_t>(budgetMB) * 1024 * 1024;
+			residency.SetSettings(settings);
+		}
+
+		ImGui::Text("Resident: %.2f MB, peak %.2f MB", stats.residentBytes / (1024.0f * 1024.0f), stats.peakResidentBytes / (1024.0f * 1024.0f));
+		ImGui::Text("Requests: %u, misses %u, last frame %u commands", stats.requests, stats.misses,
+					VulkanTextureCache::getInstance().GetLastResidencyCommandCount());
+		ImGui::Text("Streamed: %u loads %.2f MB, %u evictions %.2f MB", stats.loads, stats.loadedBytes / (1024.0f * 1024.0f),
+					stats.evictions, stats.evictedBytes / (1024.0f * 1024.0f));
+
+		if (ImGui::Button("Run Simulation"))
+			m_vecResidencySimulationResults = Texture::RunResidencySimulation();
+
+		for (const Texture::ResidencySimulationResult& result : m_vecResidencySimulationResults)
+		{
+			if (result.bValid)
+			{
+				ImGui::Text("%-24s tails %3u  miss %5.1f%%  peak %4llu/%4llu MB  %5u loads %5u evictions", result.name.c_str(),
+							result.framesToTails, 100.0f * result.missRate, static_cast<unsigned long long>(result.peakResidentBytes / (1024 * 1024)),
+							static_cast<unsigned long long>(result.budgetBytes / (1024 * 1024)), result.loads, result.evictions);
+			}
+			else
+			{
+				ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%-24s FAILED: %s", result.name.c_str(), result.failure.c_str());
+			}
+		}
+	}
+
+	//**** HDRI ingestion, synthetic 2k/4k/8k maps through stb_image & the parallel half/shared exponent paths. Takes a few
+	//**** seconds & up to ~1 GB of memory for the 8k map.
+	if (ImGui::CollapsingHeader("HDRI Formats"))
+	{
+		ImGui::Text("F16C: %s", Texture::HasF16C() ? "yes" : "no");
+
+		if (ImGui::Button("Run HDRI Benchmark"))
+			m_vecHDRBenchmarkResults = Texture::RunHDRBenchmark();
+
+		for (const Texture::HDRBenchmarkResult& result : m_vecHDRBenchmarkResults)
+		{
+			ImGui::Text("%4ux%-4u %-9s %-8s %8.1f ms  CPU %4u MB  VRAM %4u MB  error %.5f", result.width, result.height, result.method.c_str(),
+						Texture::GetTextureFormatName(result.eFormat), result.loadMs, static_cast<uint32_t>(result.cpuBytes / (1024 * 1024)),
+						static_cast<uint32_t>(result.vramBytes / (1024 * 1024)), result.maxRelativeError);
+		}
+	}
+
+	//**** Cubemap faces decoded in parallel into one staging allocation, 1k/2k/4k synthetic cubes. The 4k cube with mips
+	//**** needs ~540 MB of staging for the duration of the load.
+	if (ImGui::CollapsingHeader("Cubemap Loading"))
+	{
+		if (ImGui::Button("Run Cubemap Benchmark"))
+			m_vecCubemapBenchmarkResults = VulkanTextureLoader::getInstance().RunCubemapBenchmark(pDevice);
+
+		for (const CubemapBenchmarkResult& result : m_vecCubemapBenchmarkResults)
+		{
+			const std::string label = result.dimension > 0 ? std::to_string(result.dimension) : std::string("all");
+			ImGui::Text("%-4s x%u %-7s %7.1f ms  decode %7.1f ms (%7.1f serial)  upload %6.1f ms  %4u MB  %u submits", label.c_str(),
+						result.cubeCount, result.bMips ? "mips" : "no mips", result.stats.totalMs, result.stats.decodeMs, result.stats.decodeCpuMs,
+						result.stats.uploadMs, static_cast<uint32_t>(result.stats.uploadBytes / (1024 * 1024)), result.stats.submitCount);
+		}
+	}
+
+	//**** SH irradiance against a brute force cosine convolution of the same source, a few seconds for the reference sums
+	if (ImGui::CollapsingHeader("Irradiance SH"))
+	{
+		if (ImGui::Button("Run SH Validation"))
+			m_vecSHValidationResults = Texture::RunSHValidation();
+
+		for (const Texture::SHValidationResult& result : m_vecSHValidationResults)
+		{
+			ImGui::Text("%-24s %7.2f ms (%7.2f scalar)  reference %7.0f ms  max %5.2f%%  mean %5.3f%%  %s", result.name.c_str(),
+						result.projectMs, result.projectScalarMs, result.referenceMs, result.maxRelativeError * 100.0f,
+						result.meanRelativeError * 100.0f, result.bValid ? "valid" : "FAILED");
+		}
+	}
+
+	//**** CPU GGX prefilter of a synthetic sky & sun, threaded & single threaded. Level 0 only sampling shows the noise the
+	//**** source mip selection removes. Takes several seconds.
+	if (ImGui::CollapsingHeader("Specular Prefilter"))
+	{
+		if (ImGui::Button("Run Prefilter Benchmark"))
+			m_vecPrefilterBenchmarkResults = Texture::RunPrefilterBenchmark();
+
+		for (const Texture::PrefilterBenchmarkResult& result : m_vecPrefilterBenchmarkResults)
+		{
+			ImGui::Text("%-18s %4u  %u levels  %7.1f ms (%7.1f single thread)  %5.1f M samples  noise %5.2f%%  constant error %.1e", result.name.c_str(),
+						result.dimension, result.mipLevels, result.bakeMs, result.bakeSingleThreadMs, result.sampleCount / 1000000.0f,
+						result.noise * 100.0f, result.constantError);
+		}
+	}
+
+	//**** Bakes whatever is missing from the IBL cache for every HDRI, a second run should be all hits. BC6H entries are
+	//**** separate from the float ones & report the log space PSNR of the cubes they encoded.
+	if (ImGui::CollapsingHeader("IBL Cache"))
+	{
+		if (ImGui::Button("Prepare Assets/Textures/HDRI"))
+			m_vecIBLCacheReports = Texture::PrepareIBLCacheDirectory(Texture::IBLBakeSettings());
+
+		ImGui::SameLine();
+		if (ImGui::Button("Prepare as BC6H"))
+		{
+			Texture::IBLBakeSettings settings;
+			settings.eCubeFormat = Texture::TextureFormat::BC6H;
+			m_vecIBLCacheReports = Texture::PrepareIBLCacheDirectory(settings);
+		}
+
+		for (const Texture::IBLCacheReport& report : m_vecIBLCacheReports)
+		{
+			ImGui::Text("%-24s %016llx  env %-5s  SH %-5s  spec %-5s  BRDF %-5s  hash %6.1f ms  bake %8.1f ms  total %8.1f ms  cubes %7u KB",
+						report.name.c_str(), static_cast<unsigned long long>(report.contentHash), report.bEnvironmentHit ? "hit" : "baked",
+						report.bIrradianceHit ? "hit" : "baked", report.bPrefilterHit ? "hit" : "baked", report.bBrdfHit ? "hit" : "baked",
+						report.hashMs, report.bakeMs, report.totalMs, static_cast<uint32_t>(report.cubeBytes / 1024));
+
+			if (report.encodeMs > 0.0f)
+			{
+				ImGui::Text("%-24s BC6H encode %8.1f ms  log PSNR env %5.2f dB  spec %5.2f dB", "", report.encodeMs, report.environmentPSNR,
+							report.prefilterPSNR);
+			}
+		}
+	}
+
+	//**** HDRI->Cube & prefiltered specular rendered into the cube's own layer views against the offscreen image + face copies
+	if (ImGui::CollapsingHeader("Cube Bakes"))
+	{
+		if (ImGui::Button("Run Cube Bake Benchmark"))
+			m_vecCubeBakeReports = VulkanTextureCUBE::RunCubeBakeBenchmark(pDevice, pSwapchain, "old_hall_2k.hdr");
+
+		for (const CubeBakeReport& report : m_vecCubeBakeReports)
+		{
+			ImGui::Text("%-32s %-11s %4u x%2u mips  %7.2f ms  %3u copies  %3u barriers  %6u KB transient", report.name.c_str(),
+						report.eTarget == CubeBakeTarget::LAYER_VIEWS ? "layer views" : "face copies", report.dimension, report.mipLevels,
+						report.bakeMs, report.copyCount, report.barrierCount, static_cast<uint32_t>(report.transientBytes / 1024));
+		}
+	}
+
+	//**** HDRI->Cube, prefilter & BRDF LUT as compute dispatches, checked against the CPU bakes
+	if (ImGui::CollapsingHeader("Compute IBL"))
+	{
+		if (ImGui::Button("Run Compute IBL Validation"))
+		{
+			m_vecComputeIBLReports = VulkanComputeIBL::RunComputeIBLValidation(pDevice);
+			m_strComputeIBLStatus = m_vecComputeIBLReports.empty() ? "Compute IBL pipelines unavailable, are the .comp shaders compiled?" : "";
+		}
+
+		ImGui::SameLine();
+		if (ImGui::Button("Bake old_hall_2k.hdr"))
+		{
+			VulkanTextureCUBE cube;
+			const bool bBaked = cube.CreateIBLCompute(pDevice, "old_hall_2k.hdr", Texture::IBLBakeSettings());
+			cube.Cleanup(pDevice);
+
+			m_strComputeIBLStatus = bBaked ? "" : "Compute IBL bake failed, see the log";
+		}
+
+		if (!m_strComputeIBLStatus.empty())
+			ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%s", m_strComputeIBLStatus.c_str());
+
+		for (const ComputeIBLReport& report : m_vecComputeIBLReports)
+		{
+			ImGui::Text("%-20s env %4u  prefiltered %4u x%2u  BRDF %4u  %u dispatches  gpu %6.2f/%6.2f/%6.2f ms  total %7.2f ms", report.name.c_str(),
+						report.environmentDimension, report.prefilterDimension, report.prefilterLevels, report.brdfDimension, report.dispatchCount,
+						report.environmentGpuMs, report.prefilterGpuMs, report.brdfGpuMs, report.totalMs);
+
+			ImGui::TextColored(report.bValid ? ImVec4(0.3f, 1.0f, 0.3f, 1.0f) : ImVec4(1.0f, 0.3f, 0.3f, 1.0f),
+							   "    error env %.3f%%  prefiltered %.3f%%  BRDF %.3f%%", report.environmentError * 100.0f,
+							   report.prefilterError * 100.0f, report.brdfError * 100.0f);
+		}
+	}
+
+	//**** Offline block compression of Assets/Textures, blocks until every texture is compiled. Compiled files get picked
+	//**** up the next time a texture is created.
+	if (ImGui::CollapsingHeader("Texture Compiler"))
+	{
+		const char* presets[] = { "FAST", "QUALITY" };
+		const char* containers[] = { "KTX2", "DDS" };
+		ImGui::Combo("Preset", &m_iCompressionPreset, presets, IM_ARRAYSIZE(presets));
+		ImGui::Combo("Container", &m_iTextureContainer, containers, IM_ARRAYSIZE(containers));
+
+		if (ImGui::Button("Compile Assets/Textures"))
+		{
+			m_vecTextureCompileReports = Texture::CompileTextureDirectory(static_cast<Texture::CompressionPreset>(m_iCompressionPreset),
+																		  static_cast<Texture::ContainerType>(m_iTextureContainer));
+		}
+
+		uint64_t totalUncompressed = 0;
+		uint64_t totalCompressed = 0;
+		for (const Texture::TextureCompileReport& report : m_vecTextureCompileReports)
+		{
+			if (!report.bSuccess)
+			{
+				ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%-28s FAILED", report.name.c_str());
+				continue;
+			}
+
+			ImGui::Text("%-28s %-5s %5u KB -> %5u KB  %6.1f ms  %5.2f dB  load %6.2f -> %5.2f ms", report.name.c_str(),
+						Texture::GetTextureFormatName(report.eFormat), static_cast<uint32_t>(report.uncompressedBytes / 1024),
+						static_cast<uint32_t>(report.compressedBytes / 1024), report.encodeMs, report.psnr, report.sourceLoadMs,
+						report.containerLoadMs);
+
+			totalUncompressed += report.uncompressedBytes;
+			totalCompressed += report.compressedBytes;
+		}
+
+		if (totalCompressed > 0)
+		{
+			ImGui::Text("VRAM %u KB -> %u KB (%.1fx)", static_cast<uint32_t>(totalUncompressed / 1024), static_cast<uint32_t>(totalCompressed / 1024),
+						static_cast<float>(totalUncompressed) / totalCompressed);
+		}
+	}
+
+	ImGui::End();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void UIManager::RenderMemoryUI(VulkanDevice* pDevice)
+{
+	ImGui::Begin("Device Memory");
+
+	//**** Blocks & dedicated allocations of the device, every sub-allocated buffer used to be a vkAllocateMemory of its own
+	const DeviceMemoryStats stats = pDevice->m_pMemoryAllocator->GetStats();
+
+	ImGui::Text("VkDeviceMemory: %u of %u, %u blocks + %u dedicated", stats.deviceMemoryCount, stats.maxDeviceMemoryCount, stats.blockCount,
+				stats.dedicatedCount);
+	ImGui::Text("Allocations:    %u live, %llu served by %llu vkAllocateMemory calls", stats.allocationCount,
+				static_cast<unsigned long long>(stats.allocationsServed), static_cast<unsigned long long>(stats.allocateCalls));
+	ImGui::Text("Blocks:         %.2f of %.2f MB used, fragmentation %.2f", stats.blockUsedBytes / (1024.0f * 1024.0f),
+				stats.blockBytes / (1024.0f * 1024.0f), stats.fragmentation);
+	ImGui::Text("Dedicated:      %.2f MB", stats.dedicatedBytes / (1024.0f * 1024.0f));
+
+	if (ImGui::Button("Defragment"))
+		pDevice->DefragmentMemory(UINT32_MAX);
+
+	ImGui::SameLine();
+	ImGui::Text("last %u moves, %.2f MB", stats.lastDefragmentationMoves, stats.lastDefragmentationBytes / (1024.0f * 1024.0f));
+
+	//**** Staging ring, throughput from the transfer timestamps of completed batches
+	const UploadStats uploads = pDevice->m_pUploader->GetStats();
+
+	ImGui::Separator();
+	ImGui::Text("Uploads:        %.2f MB in %u submits, %u oversize", uploads.uploadBytes / (1024.0f * 1024.0f), uploads.submitCount,
+				uploads.oversizeCount);
+	ImGui::Text("Staging ring:   %.2f of %.0f MB in flight, %u batches", uploads.ringInFlight / (1024.0f * 1024.0f),
+				uploads.ringSize / (1024.0f * 1024.0f), uploads.batchesInFlight);
+	ImGui::Text("Stalls:         %u, %.1f ms", uploads.stallCount, uploads.stallMs);
+	ImGui::Text("Transfer:       %.2f GB/s, last batch %.2f MB in %.3f ms", uploads.gbPerSecond, uploads.lastBatchBytes / (1024.0f * 1024.0f),
+				uploads.lastBatchGpuMs);
+
+	//**** Queues uploads & AS builds run on, graphics when the device has no family of their own
+	const QueueFamilyIndices* pFamilies = pDevice->m_pQueueFamilyIndices;
+
+	if (pDevice->HasTransferQueue())
+	{
+		ImGui::Text("Upload queue:   dedicated transfer, family %u", pFamilies->m_uiTransferFamily.value());
+	}
+	else
+	{
+		ImGui::Text("Upload queue:   graphics");
+	}
+
+	if (pDevice->HasComputeQueue())
+	{
+		ImGui::Text("AS build queue: async compute, family %u", pFamilies->m_uiComputeFamily.value());
+	}
+	else
+	{
+		ImGui::Text("AS build queue: graphics");
+	}
+
+	//**** Same bytes per upload size through a staging buffer & queue wait each & through the ring, takes a few seconds
+	if (ImGui::CollapsingHeader("Upload Benchmark"))
+	{
+		if (ImGui::Button("Run Upload Benchmark"))
+			m_vecUploadBenchmarkResults = VulkanStagingUploader::RunUploadBenchmark(pDevice);
+
+		for (const UploadBenchmarkResult& result : m_vecUploadBenchmarkResults)
+		{
+			ImGui::Text("%-28s %5u uploads  %4u MB  %8.1f ms  %6.2f GB/s  %5u submits", result.name.c_str(), result.uploadCount,
+						static_cast<uint32_t>(result.uploadBytes / (1024 * 1024)), result.cpuMs, result.gbPerSecond, result.submitCount);
+		}
+	}
+
+	//**** Allocator against a CPU side mock device, no GPU memory involved
+	if (ImGui::CollapsingHeader("Allocator Validation"))
+	{
+		if (ImGui::Button("Run"))
+			m_vecMemoryAllocatorResults = VulkanMemoryAllocator::RunMemoryAllocatorValidation();
+
+		for (const MemoryAllocatorValidationResult& result : m_vecMemoryAllocatorResults)
+		{
+			ImGui::TextColored(result.bValid ? ImVec4(0.3f, 1.0f, 0.3f, 1.0f) : ImVec4(1.0f, 0.3f, 0.3f, 1.0f),
+							   "%-28s %6u allocations  %3u device memories  %6.2f us  fragmentation %.2f  %s", result.name.c_str(),
+							   result.allocationCount, result.peakDeviceMemoryCount, result.allocateUs, result.fragmentation,
+							   result.bValid ? "OK" : "FAILED");
+		}
+	}
+
+	ImGui::End();
+}
@@ -9,6 +9,28 @@ class VulkanDevice;
 class VulkanSwapChain;
 class VulkanFrameBuffer;
 class Scene;
+struct CubemapBenchmarkResult;
+struct CubeBakeReport;
+struct ComputeIBLReport;
+struct MemoryAllocatorValidationResult;
+struct UploadBenchmarkResult;
+
+namespace Raytracer
+{
+	class CpuRenderer;
+	struct RayHit;
+}
+
+namespace Texture
+{
+	struct MipSelfTestResult;
+	struct TextureCompileReport;
+	struct ResidencySimulationResult;
+	struct HDRBenchmarkResult;
+	struct SHValidationResult;
+	struct PrefilterBenchmarkResult;
+	struct IBLCacheReport;
+}
 
 class UIManager
 {
@@ -30,6 +52,10 @@ public:
 
 	void							RenderSceneUI(Scene* pScene);
 	void							RenderDebugStats();
+	void							RenderCpuRendererUI(Raytracer::CpuRenderer* pCpuRenderer, Scene* pScene);
+	void							RenderPickingStats(const Raytracer::RayHit& hit, float timeMs, Scene* pScene);
+	void							RenderTextureUI(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain);
+	void							RenderMemoryUI(VulkanDevice* pDevice);
 
 private:
 	UIManager();
@@ -48,6 +74,22 @@ private:
 	std::vector<VkFramebuffer>		m_vecFramebuffers;
 	VkCommandPool					m_vkCommandPool;
 
+	std::vector<Texture::MipSelfTestResult>	m_vecMipSelfTestResults;
+	std::vector<Texture::TextureCompileReport>	m_vecTextureCompileReports;
+	std::vector<Texture::ResidencySimulationResult>	m_vecResidencySimulationResults;
+	std::vector<Texture::HDRBenchmarkResult>	m_vecHDRBenchmarkResults;
+	std::vector<CubemapBenchmarkResult>	m_vecCubemapBenchmarkResults;
+	std::vector<Texture::SHValidationResult>	m_vecSHValidationResults;
+	std::vector<Texture::PrefilterBenchmarkResult>	m_vecPrefilterBenchmarkResults;
+	std::vector<Texture::IBLCacheReport>	m_vecIBLCacheReports;
+	std::vector<CubeBakeReport>			m_vecCubeBakeReports;
+	std::vector<ComputeIBLReport>		m_vecComputeIBLReports;
+	std::string							m_strComputeIBLStatus;		// Last run's failure, empty when it worked
+	std::vector<MemoryAllocatorValidationResult>	m_vecMemoryAllocatorResults;
+	std::vector<UploadBenchmarkResult>	m_vecUploadBenchmarkResults;
+	int								m_iCompressionPreset;
+	int								m_iTextureContainer;
+
 public:
 	std::vector<VkCommandBuffer>	m_vecCommandBuffers;
 
@@ -0,0 +1,596 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "BVH.h"
+
+#include <chrono>
+#include <mutex>
+
+#include "Engine/Helpers/JobSystem.h"
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	const uint32_t	SAH_BIN_COUNT			= 32;
+	const uint32_t	SAH_MAX_LEAF_SIZE		= 8;
+	const uint32_t	SAH_TASK_THRESHOLD		= 4096;		// Subtrees smaller than this are built on the current thread
+	const uint32_t	SAH_PARALLEL_BINNING	= 65536;	// Nodes larger than this bin their primitives with ParallelFor
+	const uint32_t	PLOC_RADIUS				= 16;
+	const uint32_t	PARALLEL_GRAIN			= 4096;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Spreads lower 10 bits of v so that there are two zero bits between each
+	inline uint32_t ExpandBits(uint32_t v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- 30 bit Morton code for a point in [0,1]^3
+	inline uint32_t MortonCode3D(const glm::vec3& p)
+	{
+		const glm::vec3 scaled = glm::clamp(p * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+		return (ExpandBits(static_cast<uint32_t>(scaled.x)) << 2) | (ExpandBits(static_cast<uint32_t>(scaled.y)) << 1) | ExpandBits(static_cast<uint32_t>(scaled.z));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Parallel LSD radix sort of (key, value) pairs, 8 bits per pass. Stable, so equal Morton codes keep input order.
+	static void RadixSortPairs(std::vector<uint32_t>& vecKeys, std::vector<uint32_t>& vecValues)
+	{
+		const uint32_t count = static_cast<uint32_t>(vecKeys.size());
+		const uint32_t nChunks = std::max(1u, std::min(JobSystem::getInstance().GetThreadCount() * 4, count / PARALLEL_GRAIN));
+		const uint32_t chunkSize = (count + nChunks - 1) / nChunks;
+
+		std::vector<uint32_t> vecKeysTemp(count);
+		std::vector<uint32_t> vecValuesTemp(count);
+		std::vector<uint32_t> vecHistograms(nChunks * 256);
+
+		for (uint32_t shift = 0; shift < 32; shift += 8)
+		{
+			std::fill(vecHistograms.begin(), vecHistograms.end(), 0);
+
+			// Per chunk digit histograms
+			JobSystem::getInstance().ParallelFor(nChunks, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t c = begin; c < end; ++c)
+				{
+					uint32_t* pHistogram = &vecHistograms[c * 256];
+					const uint32_t last = std::min(count, (c + 1) * chunkSize);
+					for (uint32_t i = c * chunkSize; i < last; ++i)
+					{
+						++pHistogram[(vecKeys[i] >> shift) & 0xFF];
+					}
+				}
+			});
+
+			// Exclusive scan in digit-major order gives every chunk its own scatter offset per digit
+			uint32_t sum = 0;
+			for (uint32_t digit = 0; digit < 256; ++digit)
+			{
+				for (uint32_t c = 0; c < nChunks; ++c)
+				{
+					const uint32_t n = vecHistograms[c * 256 + digit];
+					vecHistograms[c * 256 + digit] = sum;
+					sum += n;
+				}
+			}
+
+			JobSystem::getInstance().ParallelFor(nChunks, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t c = begin; c < end; ++c)
+				{
+					uint32_t* pOffsets = &vecHistograms[c * 256];
+					const uint32_t last = std::min(count, (c + 1) * chunkSize);
+					for (uint32_t i = c * chunkSize; i < last; ++i)
+					{
+						const uint32_t dst = pOffsets[(vecKeys[i] >> shift) & 0xFF]++;
+						vecKeysTemp[dst] = vecKeys[i];
+						vecValuesTemp[dst] = vecValues[i];
+					}
+				}
+			});
+
+			vecKeys.swap(vecKeysTemp);
+			vecValues.swap(vecValuesTemp);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	BVH::BVH()
+	{
+		m_uiRootIndex = 0;
+		m_uiNodeCount = 0;
+		m_eBuildMode = BVHBuildMode::BINNED_SAH;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	BVH::~BVH()
+	{
+		Clear();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BVH::Clear()
+	{
+		m_vecNodes.clear();
+		m_vecPrimIndices.clear();
+		m_vecCentroids.clear();
+		m_uiRootIndex = 0;
+		m_uiNodeCount = 0;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BVH::Build(const std::vector<AABB>& vecPrimBounds, BVHBuildMode eMode)
+	{
+		Clear();
+
+		m_eBuildMode = eMode;
+		m_BuildStats = BVHBuildStats();
+
+		const uint32_t nPrims = static_cast<uint32_t>(vecPrimBounds.size());
+		if (nPrims == 0)
+			return;
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		m_vecCentroids.resize(nPrims);
+		JobSystem::getInstance().ParallelFor(nPrims, PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+				m_vecCentroids[i] = vecPrimBounds[i].Centroid();
+		});
+
+		// Binary tree with single-primitive leaves is the worst case
+		m_vecNodes.resize(2 * nPrims - 1);
+
+		switch (eMode)
+		{
+			case BVHBuildMode::BINNED_SAH:
+				BuildBinnedSAH(vecPrimBounds);
+				break;
+
+			case BVHBuildMode::LBVH:
+				BuildLBVH(vecPrimBounds);
+				break;
+		}
+
+		m_vecNodes.resize(m_uiNodeCount);
+		m_vecCentroids.clear();
+		m_vecCentroids.shrink_to_fit();
+
+		const auto endTime = std::chrono::high_resolution_clock::now();
+
+		m_BuildStats.buildTimeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+		m_BuildStats.mtrisPerSec = m_BuildStats.buildTimeMs > 0.0f ? (nPrims / 1000000.0f) / (m_BuildStats.buildTimeMs / 1000.0f) : 0.0f;
+		m_BuildStats.nodeCount = static_cast<uint32_t>(m_vecNodes.size());
+		m_BuildStats.leafCount = static_cast<uint32_t>(std::count_if(m_vecNodes.begin(), m_vecNodes.end(), [](const BVHNode& node) { return node.IsLeaf(); }));
+		m_BuildStats.sahCost = ComputeSAHCost();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float BVH::ComputeSAHCost() const
+	{
+		if (m_vecNodes.empty())
+			return 0.0f;
+
+		const float rootArea = m_vecNodes[m_uiRootIndex].bounds.SurfaceArea();
+		if (rootArea <= 0.0f)
+			return 0.0f;
+
+		float cost = 0.0f;
+		for (const BVHNode& node : m_vecNodes)
+		{
+			const float area = node.bounds.SurfaceArea();
+			cost += node.IsLeaf() ? area * node.primCount : area;
+		}
+
+		return cost / rootArea;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BVH::BuildBinnedSAH(const std::vector<AABB>& vecPrimBounds)
+	{
+		const uint32_t nPrims = static_cast<uint32_t>(vecPrimBounds.size());
+
+		m_vecPrimIndices.resize(nPrims);
+		for (uint32_t i = 0; i < nPrims; ++i)
+			m_vecPrimIndices[i] = i;
+
+		m_uiRootIndex = 0;
+		m_uiNodeCount = 1;
+		m_vecNodes[0].parent = INVALID_INDEX;
+
+		TaskGroup group;
+		BuildNodeSAH(vecPrimBounds, 0, 0, nPrims, &group);
+		JobSystem::getInstance().Wait(&group);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BVH::BuildNodeSAH(const std::vector<AABB>& vecPrimBounds, uint32_t nodeIndex, uint32_t first, uint32_t count, TaskGroup* pGroup)
+	{
+		struct Bin
+		{
+			AABB		bounds;
+			uint32_t	count = 0;
+		};
+
+		struct BinningResult
+		{
+			AABB		nodeBounds;
+			AABB		centroidBounds;
+		};
+
+		BVHNode& node = m_vecNodes[nodeIndex];
+
+		//--- Node & centroid bounds
+		BinningResult extents;
+		auto computeExtents = [&](uint32_t begin, uint32_t end, BinningResult& result)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t primId = m_vecPrimIndices[first + i];
+				result.nodeBounds.Grow(vecPrimBounds[primId]);
+				result.centroidBounds.Grow(m_vecCentroids[primId]);
+			}
+		};
+
+		if (count >= SAH_PARALLEL_BINNING)
+		{
+			std::mutex mutexMerge;
+			JobSystem::getInstance().ParallelFor(count, PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end)
+			{
+				BinningResult local;
+				computeExtents(begin, end, local);
+
+				std::lock_guard<std::mutex> lock(mutexMerge);
+				extents.nodeBounds.Grow(local.nodeBounds);
+				extents.centroidBounds.Grow(local.centroidBounds);
+			});
+		}
+		else
+		{
+			computeExtents(0, count, extents);
+		}
+
+		node.bounds = extents.nodeBounds;
+
+		auto makeLeaf = [&]()
+		{
+			node.left = first;
+			node.right = INVALID_INDEX;
+			node.primCount = count;
+		};
+
+		if (count <= 2)
+		{
+			makeLeaf();
+			return;
+		}
+
+		//--- Bin centroids along all three axes
+		const glm::vec3 centroidExtent = extents.centroidBounds.Extent();
+		const glm::vec3 binScale = glm::vec3(static_cast<float>(SAH_BIN_COUNT)) / glm::max(centroidExtent, glm::vec3(1e-20f));
+
+		auto binIndex = [&](uint32_t primId, int axis)
+		{
+			const float offset = (m_vecCentroids[primId][axis] - extents.centroidBounds.vecMin[axis]) * binScale[axis];
+			return std::min(SAH_BIN_COUNT - 1, static_cast<uint32_t>(std::max(0.0f, offset)));
+		};
+
+		Bin bins[3][SAH_BIN_COUNT];
+		auto binPrimitives = [&](uint32_t begin, uint32_t end, Bin (&localBins)[3][SAH_BIN_COUNT])
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t primId = m_vecPrimIndices[first + i];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					Bin& bin = localBins[axis][binIndex(primId, axis)];
+					bin.bounds.Grow(vecPrimBounds[primId]);
+					++bin.count;
+				}
+			}
+		};
+
+		if (count >= SAH_PARALLEL_BINNING)
+		{
+			std::mutex mutexMerge;
+			JobSystem::getInstance().ParallelFor(count, PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end)
+			{
+				Bin localBins[3][SAH_BIN_COUNT];
+				binPrimitives(begin, end, localBins);
+
+				std::lock_guard<std::mutex> lock(mutexMerge);
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					for (uint32_t b = 0; b < SAH_BIN_COUNT; ++b)
+					{
+						bins[axis][b].bounds.Grow(localBins[axis][b].bounds);
+						bins[axis][b].count += localBins[axis][b].count;
+					}
+				}
+			});
+		}
+		else
+		{
+			binPrimitives(0, count, bins);
+		}
+
+		//--- Sweep bins from both sides to evaluate every split plane
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (centroidExtent[axis] <= 0.0f)
+				continue;
+
+			float rightCost[SAH_BIN_COUNT];
+			AABB rightBounds;
+			uint32_t rightCount = 0;
+			for (uint32_t b = SAH_BIN_COUNT - 1; b > 0; --b)
+			{
+				rightBounds.Grow(bins[axis][b].bounds);
+				rightCount += bins[axis][b].count;
+				rightCost[b] = rightBounds.SurfaceArea() * rightCount;
+			}
+
+			AABB leftBounds;
+			uint32_t leftCount = 0;
+			for (uint32_t b = 0; b < SAH_BIN_COUNT - 1; ++b)
+			{
+				leftBounds.Grow(bins[axis][b].bounds);
+				leftCount += bins[axis][b].count;
+
+				const float cost = leftBounds.SurfaceArea() * leftCount + rightCost[b + 1];
+				if (leftCount > 0 && leftCount < count && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b + 1;
+				}
+			}
+		}
+
+		// Unit traversal cost vs. intersecting everything in this node
+		const float nodeArea = node.bounds.SurfaceArea();
+		const float leafCost = static_cast<float>(count);
+		const float splitCost = nodeArea > 0.0f ? 1.0f + bestCost / nodeArea : FLT_MAX;
+
+		if (count <= SAH_MAX_LEAF_SIZE && (bestAxis < 0 || splitCost >= leafCost))
+		{
+			makeLeaf();
+			return;
+		}
+
+		//--- Partition primitive range
+		uint32_t leftCount = 0;
+		if (bestAxis >= 0)
+		{
+			auto itMid = std::partition(m_vecPrimIndices.begin() + first, m_vecPrimIndices.begin() + first + count,
+										[&](uint32_t primId) { return binIndex(primId, bestAxis) < bestSplit; });
+
+			leftCount = static_cast<uint32_t>(itMid - (m_vecPrimIndices.begin() + first));
+		}
+		else
+		{
+			// All centroids coincide, split by count
+			leftCount = count / 2;
+		}
+
+		const uint32_t leftIndex = m_uiNodeCount.fetch_add(2, std::memory_order_relaxed);
+		const uint32_t rightIndex = leftIndex + 1;
+
+		node.left = leftIndex;
+		node.right = rightIndex;
+		node.primCount = 0;
+
+		m_vecNodes[leftIndex].parent = nodeIndex;
+		m_vecNodes[rightIndex].parent = nodeIndex;
+
+		const uint32_t rightCount = count - leftCount;
+
+		if (leftCount >= SAH_TASK_THRESHOLD)
+		{
+			JobSystem::getInstance().Run(pGroup, [this, &vecPrimBounds, leftIndex, first, leftCount, pGroup]()
+			{
+				BuildNodeSAH(vecPrimBounds, leftIndex, first, leftCount, pGroup);
+			});
+		}
+		else
+		{
+			BuildNodeSAH(vecPrimBounds, leftIndex, first, leftCount, pGroup);
+		}
+
+		BuildNodeSAH(vecPrimBounds, rightIndex, first + leftCount, rightCount, pGroup);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BVH::BuildLBVH(const std::vector<AABB>& vecPrimBounds)
+	{
+		const uint32_t nPrims = static_cast<uint32_t>(vecPrimBounds.size());
+		JobSystem& jobSystem = JobSystem::getInstance();
+
+		//--- Scene centroid bounds
+		AABB centroidBounds;
+		std::mutex mutexMerge;
+		jobSystem.ParallelFor(nPrims, PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end)
+		{
+			AABB local;
+			for (uint32_t i = begin; i < end; ++i)
+				local.Grow(m_vecCentroids[i]);
+
+			std::lock_guard<std::mutex> lock(mutexMerge);
+			centroidBounds.Grow(local);
+		});
+
+		//--- Morton codes & sort
+		const glm::vec3 invExtent = 1.0f / glm::max(centroidBounds.Extent(), glm::vec3(1e-20f));
+
+		std::vector<uint32_t> vecMortonCodes(nPrims);
+		m_vecPrimIndices.resize(nPrims);
+
+		jobSystem.ParallelFor(nPrims, PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				vecMortonCodes[i] = MortonCode3D((m_vecCentroids[i] - centroidBounds.vecMin) * invExtent);
+				m_vecPrimIndices[i] = i;
+			}
+		});
+
+		RadixSortPairs(vecMortonCodes, m_vecPrimIndices);
+
+		//--- One leaf per primitive, in Morton order
+		jobSystem.ParallelFor(nPrims, PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				BVHNode& leaf = m_vecNodes[i];
+				leaf.bounds = vecPrimBounds[m_vecPrimIndices[i]];
+				leaf.left = i;
+				leaf.right = INVALID_INDEX;
+				leaf.primCount = 1;
+				leaf.parent = INVALID_INDEX;
+			}
+		});
+
+		m_uiNodeCount = nPrims;
+
+		//--- PLOC: every cluster picks the neighbour within PLOC_RADIUS that gives the smallest merged box,
+		//--- mutual nearest neighbours merge, survivors get compacted. Morton order keeps the search window local.
+		std::vector<uint32_t> vecClusters(nPrims);
+		std::vector<uint32_t> vecClustersNext(nPrims);
+		std::vector<uint32_t> vecNeighbours(nPrims);
+
+		for (uint32_t i = 0; i < nPrims; ++i)
+			vecClusters[i] = i;
+
+		const uint32_t nChunks = jobSystem.GetThreadCount() * 4;
+		std::vector<uint32_t> vecChunkOffsets(nChunks + 1);
+
+		uint32_t nClusters = nPrims;
+		while (nClusters > 1)
+		{
+			jobSystem.ParallelFor(nClusters, 256, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					const AABB& bounds = m_vecNodes[vecClusters[i]].bounds;
+					const uint32_t searchBegin = i > PLOC_RADIUS ? i - PLOC_RADIUS : 0;
+					const uint32_t searchEnd = std::min(nClusters, i + PLOC_RADIUS + 1);
+
+					float bestArea = FLT_MAX;
+					uint32_t bestNeighbour = INVALID_INDEX;
+					for (uint32_t j = searchBegin; j < searchEnd; ++j)
+					{
+						if (j == i)
+							continue;
+
+						AABB merged = bounds;
+						merged.Grow(m_vecNodes[vecClusters[j]].bounds);
+
+						const float area = merged.SurfaceArea();
+						if (area < bestArea)
+						{
+							bestArea = area;
+							bestNeighbour = j;
+						}
+					}
+
+					vecNeighbours[i] = bestNeighbour;
+				}
+			});
+
+			jobSystem.ParallelFor(nClusters, 256, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					const uint32_t j = vecNeighbours[i];
+					if (vecNeighbours[j] != i || j < i)
+						continue;
+
+					const uint32_t leftNode = vecClusters[i];
+					const uint32_t rightNode = vecClusters[j];
+					const uint32_t parentIndex = m_uiNodeCount.fetch_add(1, std::memory_order_relaxed);
+
+					BVHNode& parent = m_vecNodes[parentIndex];
+					parent.bounds = m_vecNodes[leftNode].bounds;
+					parent.bounds.Grow(m_vecNodes[rightNode].bounds);
+					parent.left = leftNode;
+					parent.right = rightNode;
+					parent.primCount = 0;
+					parent.parent = INVALID_INDEX;
+
+					m_vecNodes[leftNode].parent = parentIndex;
+					m_vecNodes[rightNode].parent = parentIndex;
+
+					vecClusters[i] = parentIndex;
+					vecClusters[j] = INVALID_INDEX;
+				}
+			});
+
+			//--- Parallel stream compaction of the surviving clusters
+			const uint32_t chunkSize = (nClusters + nChunks - 1) / nChunks;
+
+			jobSystem.ParallelFor(nChunks, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t c = begin; c < end; ++c)
+				{
+					const uint32_t first = std::min(nClusters, c * chunkSize);
+					const uint32_t last = std::min(nClusters, first + chunkSize);
+					vecChunkOffsets[c + 1] = static_cast<uint32_t>(std::count_if(vecClusters.begin() + first, vecClusters.begin() + last,
+																	[](uint32_t cluster) { return cluster != INVALID_INDEX; }));
+				}
+			});
+
+			vecChunkOffsets[0] = 0;
+			for (uint32_t c = 0; c < nChunks; ++c)
+				vecChunkOffsets[c + 1] += vecChunkOffsets[c];
+
+			jobSystem.ParallelFor(nChunks, 1, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t c = begin; c < end; ++c)
+				{
+					const uint32_t first = std::min(nClusters, c * chunkSize);
+					const uint32_t last = std::min(nClusters, first + chunkSize);
+					std::copy_if(vecClusters.begin() + first, vecClusters.begin() + last, vecClustersNext.begin() + vecChunkOffsets[c],
+								 [](uint32_t cluster) { return cluster != INVALID_INDEX; });
+				}
+			});
+
+			vecClusters.swap(vecClustersNext);
+
+			// Ties in merge cost can, in theory, leave no mutual pair. Force progress so the loop always terminates.
+			if (vecChunkOffsets[nChunks] == nClusters)
+			{
+				const uint32_t parentIndex = m_uiNodeCount.fetch_add(1, std::memory_order_relaxed);
+
+				BVHNode& parent = m_vecNodes[parentIndex];
+				parent.bounds = m_vecNodes[vecClusters[0]].bounds;
+				parent.bounds.Grow(m_vecNodes[vecClusters[1]].bounds);
+				parent.left = vecClusters[0];
+				parent.right = vecClusters[1];
+				parent.primCount = 0;
+				parent.parent = INVALID_INDEX;
+
+				m_vecNodes[parent.left].parent = parentIndex;
+				m_vecNodes[parent.right].parent = parentIndex;
+
+				vecClusters[0] = parentIndex;
+				std::copy(vecClusters.begin() + 2, vecClusters.begin() + nClusters, vecClusters.begin() + 1);
+				--nClusters;
+			}
+			else
+			{
+				nClusters = vecChunkOffsets[nChunks];
+			}
+		}
+
+		m_uiRootIndex = vecClusters[0];
+	}
+}
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cfloat>
+#include <atomic>
+
+#include "glm/glm.hpp"
+
+class TaskGroup;
+
+namespace Raytracer
+{
+	const uint32_t	INVALID_INDEX = 0xFFFFFFFF;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Axis aligned bounding box
+	struct AABB
+	{
+		AABB() { vecMin = glm::vec3(FLT_MAX); vecMax = glm::vec3(-FLT_MAX); }
+		AABB(const glm::vec3& _min, const glm::vec3& _max) :
+			vecMin(_min),
+			vecMax(_max) {}
+
+		inline void			Grow(const glm::vec3& p)		{ vecMin = glm::min(vecMin, p); vecMax = glm::max(vecMax, p); }
+		inline void			Grow(const AABB& box)			{ vecMin = glm::min(vecMin, box.vecMin); vecMax = glm::max(vecMax, box.vecMax); }
+		inline glm::vec3	Centroid() const				{ return (vecMin + vecMax) * 0.5f; }
+		inline glm::vec3	Extent() const					{ return vecMax - vecMin; }
+		inline bool			IsValid() const					{ return vecMin.x <= vecMax.x; }
+
+		inline float		SurfaceArea() const
+		{
+			if (!IsValid())
+				return 0.0f;
+
+			const glm::vec3 e = Extent();
+			return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+		}
+
+		glm::vec3 vecMin;
+		glm::vec3 vecMax;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Ray with cached reciprocal direction for slab tests. tMax shrinks as closer hits are found.
+	struct Ray
+	{
+		Ray(const glm::vec3& _origin, const glm::vec3& _direction, float _tMin = 0.0f, float _tMax = FLT_MAX) :
+			origin(_origin),
+			direction(_direction),
+			invDirection(1.0f / _direction),
+			tMin(_tMin),
+			tMax(_tMax) {}
+
+		glm::vec3 origin;
+		glm::vec3 direction;
+		glm::vec3 invDirection;
+		float tMin;
+		float tMax;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Primary ray through ndc in [-1, 1], same setup as raygenBasic.rgen
+	inline Ray GenerateCameraRay(const glm::mat4& matViewInverse, const glm::mat4& matProjInverse, const glm::vec2& ndc)
+	{
+		const glm::vec4 origin = matViewInverse * glm::vec4(0, 0, 0, 1);
+		const glm::vec4 target = matProjInverse * glm::vec4(ndc.x, ndc.y, 1, 1);
+		const glm::vec4 direction = matViewInverse * glm::vec4(glm::normalize(glm::vec3(target)), 0);
+
+		return Ray(glm::vec3(origin), glm::vec3(direction), 0.001f, 10000.0f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Bounds of a transformed box, per-axis min/max of the matrix terms instead of transforming all 8 corners
+	inline AABB TransformAABB(const AABB& box, const glm::mat4& mat)
+	{
+		if (!box.IsValid())
+			return box;
+
+		glm::vec3 vecMin = glm::vec3(mat[3]);
+		glm::vec3 vecMax = vecMin;
+
+		for (int col = 0; col < 3; ++col)
+		{
+			const glm::vec3 axis = glm::vec3(mat[col]);
+			const glm::vec3 a = axis * box.vecMin[col];
+			const glm::vec3 b = axis * box.vecMax[col];
+			vecMin += glm::min(a, b);
+			vecMax += glm::max(a, b);
+		}
+
+		return AABB(vecMin, vecMax);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Closest hit record, barycentrics follow the hitAttributeEXT convention (weights of v1 & v2)
+	struct RayHit
+	{
+		RayHit() { t = FLT_MAX; objectIndex = INVALID_INDEX; primitive = INVALID_INDEX; barycentrics = glm::vec2(0); normal = glm::vec3(0); }
+
+		inline bool IsValid() const { return primitive != INVALID_INDEX; }
+
+		float		t;
+		uint32_t	objectIndex;
+		uint32_t	primitive;
+		glm::vec2	barycentrics;
+		glm::vec3	normal;			// Geometric, object space & unnormalized
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Slab test, returns entry distance in tEntry
+	inline bool IntersectAABB(const Ray& ray, const AABB& box, float& tEntry)
+	{
+		const glm::vec3 t0 = (box.vecMin - ray.origin) * ray.invDirection;
+		const glm::vec3 t1 = (box.vecMax - ray.origin) * ray.invDirection;
+		const glm::vec3 tSmall = glm::min(t0, t1);
+		const glm::vec3 tBig = glm::max(t0, t1);
+
+		const float tNear = glm::max(glm::max(tSmall.x, tSmall.y), glm::max(tSmall.z, ray.tMin));
+		const float tFar = glm::min(glm::min(tBig.x, tBig.y), glm::min(tBig.z, ray.tMax));
+
+		tEntry = tNear;
+		return tNear <= tFar;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Moller-Trumbore, returns distance & barycentrics (u, v) of the hit
+	inline bool IntersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& t, float& u, float& v)
+	{
+		const glm::vec3 edge1 = v1 - v0;
+		const glm::vec3 edge2 = v2 - v0;
+		const glm::vec3 pvec = glm::cross(ray.direction, edge2);
+		const float det = glm::dot(edge1, pvec);
+
+		if (glm::abs(det) < 1e-12f)
+			return false;
+
+		const float invDet = 1.0f / det;
+		const glm::vec3 tvec = ray.origin - v0;
+		u = glm::dot(tvec, pvec) * invDet;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		const glm::vec3 qvec = glm::cross(tvec, edge1);
+		v = glm::dot(ray.direction, qvec) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		t = glm::dot(edge2, qvec) * invDet;
+		return t > ray.tMin && t < ray.tMax;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class BVHBuildMode
+	{
+		BINNED_SAH,				// Top-down binned SAH, subtrees built as parallel tasks. Best trace quality.
+		LBVH					// Morton codes + parallel radix sort + agglomerative (PLOC) clustering. Fastest build.
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Interior nodes reference two children, leaves reference a range in BVH::m_vecPrimIndices
+	struct BVHNode
+	{
+		inline bool IsLeaf() const { return primCount > 0; }
+
+		AABB		bounds;
+		uint32_t	left;				// Left child, or first primitive for leaves
+		uint32_t	right;				// Right child, unused for leaves
+		uint32_t	primCount;			// 0 for interior nodes
+		uint32_t	parent;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct BVHBuildStats
+	{
+		BVHBuildStats() { buildTimeMs = 0.0f; mtrisPerSec = 0.0f; sahCost = 0.0f; nodeCount = 0; leafCount = 0; }
+
+		float		buildTimeMs;
+		float		mtrisPerSec;
+		float		sahCost;
+		uint32_t	nodeCount;
+		uint32_t	leafCount;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	class BVH
+	{
+	public:
+		BVH();
+		~BVH();
+
+		// Builds over primitive bounds. Primitive ids handed to the traversal callback are indices into vecPrimBounds.
+		void									Build(const std::vector<AABB>& vecPrimBounds, BVHBuildMode eMode);
+		void									Clear();
+
+		// SAH cost with unit traversal & intersection cost, normalized by root surface area
+		float									ComputeSAHCost() const;
+
+		// intersectPrim(primId, ray) must return true on a hit and shrink ray.tMax to the hit distance
+		template<typename PrimIntersector>
+		bool									Traverse(Ray& ray, PrimIntersector&& intersectPrim) const;
+
+		inline bool								IsEmpty() const { return m_vecNodes.empty(); }
+		inline const AABB&						GetBounds() const { return m_vecNodes[m_uiRootIndex].bounds; }
+
+	private:
+		void									BuildBinnedSAH(const std::vector<AABB>& vecPrimBounds);
+		void									BuildNodeSAH(const std::vector<AABB>& vecPrimBounds, uint32_t nodeIndex, uint32_t first, uint32_t count, TaskGroup* pGroup);
+
+		void									BuildLBVH(const std::vector<AABB>& vecPrimBounds);
+
+	public:
+		std::vector<BVHNode>					m_vecNodes;
+		std::vector<uint32_t>					m_vecPrimIndices;
+		uint32_t								m_uiRootIndex;
+		BVHBuildMode							m_eBuildMode;
+		BVHBuildStats							m_BuildStats;
+
+	private:
+		std::vector<glm::vec3>					m_vecCentroids;			// Build time only
+		std::atomic<uint32_t>					m_uiNodeCount;			// Build time only
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	template<typename PrimIntersector>
+	bool BVH::Traverse(Ray& ray, PrimIntersector&& intersectPrim) const
+	{
+		if (m_vecNodes.empty())
+			return false;
+
+		float tEntry;
+		if (!IntersectAABB(ray, m_vecNodes[m_uiRootIndex].bounds, tEntry))
+			return false;
+
+		// Only the far child gets pushed per level, so stack depth is bounded by tree depth. LBVH on clustered Morton codes
+		// can still go past the local stack, like DynamicBVH the rest spills over to the heap.
+		uint32_t localStack[128];
+		std::vector<uint32_t> vecOverflow;
+		uint32_t stackPtr = 0;
+		uint32_t nodeIndex = m_uiRootIndex;
+		bool bHit = false;
+
+		auto push = [&](uint32_t index)
+		{
+			if (stackPtr < 128)
+				localStack[stackPtr++] = index;
+			else
+				vecOverflow.push_back(index);
+		};
+
+		auto pop = [&](uint32_t& index)
+		{
+			if (!vecOverflow.empty())
+			{
+				index = vecOverflow.back();
+				vecOverflow.pop_back();
+				return true;
+			}
+
+			if (stackPtr == 0)
+				return false;
+
+			index = localStack[--stackPtr];
+			return true;
+		};
+
+		while (true)
+		{
+			const BVHNode& node = m_vecNodes[nodeIndex];
+
+			if (node.IsLeaf())
+			{
+				for (uint32_t i = 0; i < node.primCount; ++i)
+				{
+					bHit |= intersectPrim(m_vecPrimIndices[node.left + i], ray);
+				}
+
+				if (!pop(nodeIndex))
+					break;
+
+				continue;
+			}
+
+			float tLeft, tRight;
+			const bool bHitLeft = IntersectAABB(ray, m_vecNodes[node.left].bounds, tLeft);
+			const bool bHitRight = IntersectAABB(ray, m_vecNodes[node.right].bounds, tRight);
+
+			if (bHitLeft && bHitRight)
+			{
+				// Visit closer child first, so that tMax shrinks early
+				const bool bLeftFirst = tLeft <= tRight;
+				push(bLeftFirst ? node.right : node.left);
+				nodeIndex = bLeftFirst ? node.left : node.right;
+			}
+			else if (bHitLeft)
+			{
+				nodeIndex = node.left;
+			}
+			else if (bHitRight)
+			{
+				nodeIndex = node.right;
+			}
+			else
+			{
+				if (!pop(nodeIndex))
+					break;
+			}
+		}
+
+		return bHit;
+	}
+}
@@ -0,0 +1,783 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "CpuRenderer.h"
+#include "Sampling.h"
+
+#include "Engine/Scene.h"
+#include "Engine/RenderObjects/SceneObject.h"
+#include "Engine/Helpers/Camera.h"
+#include "Engine/Texture/HDRConverter.h"
+
+namespace Raytracer
+{
+	// Samples every tile takes before its noise estimate is trusted
+	const uint32_t	ADAPTIVE_WARMUP_SAMPLES = 8;
+
+	// Cap on a single tile's share of a pass, keeps one noisy tile from serializing the pass
+	const uint32_t	ADAPTIVE_MAX_PASS_SCALE = 16;
+
+	const std::string	ENVIRONMENT_DIRECTORY = "Assets/Textures/HDRI/";
+
+	// Diffuse reflectance of every surface under environment lighting
+	const float		ENVIRONMENT_ALBEDO = 0.8f;
+
+	// Shadow rays start this far off the surface along the normal
+	const float		SHADOW_RAY_OFFSET = 0.001f;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline float Luminance(const glm::vec3& color)
+	{
+		return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	CpuRenderer::CpuRenderer()
+	{
+		m_bEnabled = false;
+		m_uiSamplesPerPixel = 4;
+		m_uiCacheSizeBytes = 256 * 1024;
+
+		m_bAdaptiveSampling = true;
+		m_fTargetNoise = 0.01f;
+		m_fFrameBudgetMs = 0.0f;
+		m_uiMaxSamplesPerPixel = 1024;
+		m_uiReferenceSamples = 256;
+		m_fTargetError = 0.01f;
+
+		m_bEnvironmentLighting = false;
+		m_eEnvironmentSampling = EnvironmentSamplingMode::ALIAS;
+		m_strEnvironmentFile = "old_hall_2k.hdr";
+		m_EnvironmentReport = {};
+
+		m_uiFramesCompleted = 0;
+		m_uiFramesCancelled = 0;
+		m_uiActiveTiles = 0;
+		m_fAverageSamples = 0.0f;
+		m_bConverged = false;
+
+		m_uiWidth = 0;
+		m_uiHeight = 0;
+		m_bOutputBGRA = false;
+		m_uiSeedStream = 0;
+
+		m_uiLastSampleCount = 0;
+		m_fMsPerSample = 0.0f;
+
+		m_bCancel = false;
+		m_bFrameInFlight = false;
+		m_uiDisplayVersion = 0;
+
+		m_matViewInverse = glm::mat4(1);
+		m_matProjInverse = glm::mat4(1);
+		m_matView = glm::mat4(1);
+		m_matProjection = glm::mat4(1);
+		m_bFrameEnvironmentLighting = false;
+		m_eFrameEnvironmentSampling = EnvironmentSamplingMode::ALIAS;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	CpuRenderer::~CpuRenderer()
+	{
+		Cleanup();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::Initialize(uint32_t width, uint32_t height, bool bOutputBGRA)
+	{
+		CancelAndWait();
+
+		m_uiWidth = width;
+		m_uiHeight = height;
+		m_bOutputBGRA = bOutputBGRA;
+
+		m_vecRenderPixels.assign(width * height, 0);
+		m_vecDisplayPixels.assign(width * height, 0);
+		++m_uiDisplayVersion;
+
+		// Tile working set is the accumulation & output pixels, but keep enough tiles around for stealing to balance the load
+		uint32_t tileSize = TileScheduler::ComputeTileSize(m_uiCacheSizeBytes, sizeof(glm::vec4) + sizeof(uint32_t));
+		const uint32_t minTiles = JobSystem::getInstance().GetThreadCount() * 8;
+		while (tileSize > 8 && ((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize) < minTiles)
+		{
+			tileSize /= 2;
+		}
+
+		m_TileScheduler.SetTileSize(tileSize);
+		ResetAccumulation();
+
+		LOG_DEBUG("CpuRenderer initialized ({0}x{1}), tile size {2}", width, height, tileSize);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::Cleanup()
+	{
+		CancelAndWait();
+
+		m_vecRenderPixels.clear();
+		m_vecDisplayPixels.clear();
+		m_vecInstances.clear();
+		m_SceneBVH.Clear();
+
+		m_vecAccumulation.clear();
+		m_vecTileSamples.clear();
+		m_vecTilePassSamples.clear();
+		m_vecTileError.clear();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::Update(Scene* pScene)
+	{
+		if (!m_FrameGroup.IsDone())
+		{
+			// Stale pass, stop it at the next tile boundary
+			if (!m_bEnabled || HasSceneChanged(pScene))
+				m_bCancel = true;
+
+			return;
+		}
+
+		RetireFrame();
+
+		if (!m_bEnabled || m_uiWidth == 0 || m_uiHeight == 0)
+			return;
+
+		// One attempt, a missing file turns environment lighting back off instead of retrying every frame
+		if (m_bEnvironmentLighting && !m_Environment.IsValid() && !LoadEnvironment(m_strEnvironmentFile))
+			m_bEnvironmentLighting = false;
+
+		if (HasSceneChanged(pScene))
+		{
+			SnapshotScene(pScene);
+			ResetAccumulation();
+		}
+
+		// Size the pass from the measured cost of the previous ones. Every active tile still takes at least one sample.
+		float passSamples = static_cast<float>(m_uiSamplesPerPixel);
+		if (m_fFrameBudgetMs > 0.0f && m_fMsPerSample > 0.0f)
+			passSamples = m_fFrameBudgetMs / (m_fMsPerSample * m_uiWidth * m_uiHeight);
+
+		m_uiActiveTiles = AllocateSamples(m_bAdaptiveSampling, passSamples);
+		m_bConverged = (m_uiActiveTiles == 0);
+
+		if (!m_bConverged)
+			KickFrame();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool CpuRenderer::AcquireFrame(void* pDst, uint32_t& uiFrameVersion)
+	{
+		if (uiFrameVersion == m_uiDisplayVersion)
+			return false;
+
+		memcpy(pDst, m_vecDisplayPixels.data(), m_vecDisplayPixels.size() * sizeof(uint32_t));
+		uiFrameVersion = m_uiDisplayVersion;
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::MeasureScaling(Scene* pScene)
+	{
+		if (m_uiWidth == 0 || m_uiHeight == 0)
+			return;
+
+		CancelAndWait();
+		SnapshotScene(pScene);
+
+		const uint32_t maxThreads = JobSystem::getInstance().GetThreadCount();
+
+		std::vector<uint32_t> vecThreadCounts;
+		for (uint32_t n = 1; n < maxThreads; n *= 2)
+			vecThreadCounts.push_back(n);
+		vecThreadCounts.push_back(maxThreads);
+
+		m_vecScalingResults.clear();
+
+		std::vector<uint32_t> vecReference;
+		float baseTimeMs = 0.0f;
+
+		for (uint32_t nThreads : vecThreadCounts)
+		{
+			ResetAccumulation();
+			AllocateSamples(false, static_cast<float>(m_uiSamplesPerPixel));
+			RenderFrame(nThreads);
+
+			CpuScalingResult result;
+			result.threadCount = nThreads;
+			result.timeMs = m_TileScheduler.m_Stats.timeMs;
+
+			if (vecReference.empty())
+			{
+				vecReference = m_vecRenderPixels;
+				baseTimeMs = result.timeMs;
+			}
+
+			result.speedup = result.timeMs > 0.0f ? baseTimeMs / result.timeMs : 0.0f;
+			result.efficiency = result.speedup / nThreads;
+			result.bDeterministic = (vecReference == m_vecRenderPixels);
+
+			m_vecScalingResults.push_back(result);
+
+			LOG_INFO("CpuRenderer scaling: {0} threads, {1:.2f} ms, speedup {2:.2f}x, efficiency {3:.0f}%, {4} tiles stolen, output {5}",
+					 nThreads, result.timeMs, result.speedup, result.efficiency * 100.0f, m_TileScheduler.m_Stats.tilesStolen,
+					 result.bDeterministic ? "identical" : "DIFFERS");
+		}
+
+		m_TileScheduler.SetThreadCount(0);
+		ResetAccumulation();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::MeasureConvergence(Scene* pScene)
+	{
+		if (m_uiWidth == 0 || m_uiHeight == 0)
+			return;
+
+		CancelAndWait();
+		SnapshotScene(pScene);
+
+		const float pixelCount = static_cast<float>(m_uiWidth * m_uiHeight);
+
+		//--- Reference from a separate seed stream, so that its noise is uncorrelated with the runs being measured
+		ResetAccumulation();
+		m_uiSeedStream = 1;
+		AllocateSamples(false, static_cast<float>(m_uiReferenceSamples));
+		RenderFrame(0);
+
+		std::vector<glm::vec3> vecReference;
+		ResolveAccumulation(vecReference);
+		m_uiSeedStream = 0;
+
+		LOG_INFO("CpuRenderer convergence: reference {0} spp took {1:.2f} ms", m_uiReferenceSamples, m_TileScheduler.m_Stats.timeMs);
+
+		m_vecConvergenceResults.clear();
+
+		for (bool bAdaptive : { false, true })
+		{
+			ResetAccumulation();
+
+			CpuConvergenceResult result;
+			result.bAdaptive = bAdaptive;
+			result.bReachedTarget = false;
+			result.passes = 0;
+			result.timeMs = 0.0f;
+			result.rmse = FLT_MAX;
+
+			// Only render time counts, error evaluation sits outside the timed passes
+			while (AllocateSamples(bAdaptive, static_cast<float>(m_uiSamplesPerPixel)) > 0)
+			{
+				RenderFrame(0);
+				result.timeMs += m_TileScheduler.m_Stats.timeMs;
+				++result.passes;
+
+				result.rmse = ComputeRMSE(vecReference);
+				if (result.rmse <= m_fTargetError)
+				{
+					result.bReachedTarget = true;
+					break;
+				}
+
+				if (CountSamples() >= static_cast<uint64_t>(m_uiReferenceSamples) * m_uiWidth * m_uiHeight)
+					break;
+			}
+
+			result.averageSamples = CountSamples() / pixelCount;
+			m_vecConvergenceResults.push_back(result);
+
+			LOG_INFO("CpuRenderer convergence: {0}, {1} passes, {2:.2f} ms, {3:.1f} spp, RMSE {4:.4f} {5}",
+					 bAdaptive ? "adaptive" : "uniform", result.passes, result.timeMs, result.averageSamples, result.rmse,
+					 result.bReachedTarget ? "reached target" : "did NOT reach target");
+		}
+
+		const CpuConvergenceResult& uniform = m_vecConvergenceResults[0];
+		const CpuConvergenceResult& adaptive = m_vecConvergenceResults[1];
+		if (uniform.bReachedTarget && adaptive.bReachedTarget && adaptive.timeMs > 0.0f)
+			LOG_INFO("CpuRenderer convergence: adaptive reaches RMSE {0} {1:.2f}x faster", m_fTargetError, uniform.timeMs / adaptive.timeMs);
+
+		ResetAccumulation();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool CpuRenderer::LoadEnvironment(const std::string& fileName)
+	{
+		CancelAndWait();
+
+		Texture::HDRImage image;
+		if (!Texture::LoadHDRImage(ENVIRONMENT_DIRECTORY + fileName, Texture::TextureFormat::RGBA32F, image))
+		{
+			LOG_ERROR("CpuRenderer failed to load environment {0}", fileName);
+			return false;
+		}
+
+		Texture::BuildEnvironmentSampling(reinterpret_cast<const float*>(image.vecData.data()), image.width, image.height, m_Environment,
+										  &m_EnvironmentReport);
+		m_strEnvironmentFile = fileName;
+
+		LOG_INFO("CpuRenderer environment {0} ({1}x{2}): CDF {3:.2f} ms, alias table {4:.2f} ms, {5} threads", fileName, image.width,
+				 image.height, m_EnvironmentReport.cdfMs, m_EnvironmentReport.aliasMs, m_EnvironmentReport.threadCount);
+
+		ResetAccumulation();
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::MeasureEnvironmentSampling(Scene* pScene)
+	{
+		if (m_uiWidth == 0 || m_uiHeight == 0)
+			return;
+
+		if (!m_Environment.IsValid() && !LoadEnvironment(m_strEnvironmentFile))
+			return;
+
+		CancelAndWait();
+
+		const bool bEnvironmentLighting = m_bEnvironmentLighting;
+		const EnvironmentSamplingMode eEnvironmentSampling = m_eEnvironmentSampling;
+		m_bEnvironmentLighting = true;
+
+		const float pixelCount = static_cast<float>(m_uiWidth * m_uiHeight);
+
+		//--- Reference from a separate seed stream, so that its noise is uncorrelated with the runs being measured
+		m_eEnvironmentSampling = EnvironmentSamplingMode::ALIAS;
+		SnapshotScene(pScene);
+		ResetAccumulation();
+		m_uiSeedStream = 1;
+		AllocateSamples(false, static_cast<float>(m_uiReferenceSamples));
+		RenderFrame(0);
+
+		std::vector<glm::vec3> vecReference;
+		ResolveAccumulation(vecReference);
+		m_uiSeedStream = 0;
+
+		LOG_INFO("CpuRenderer environment sampling: reference {0} spp took {1:.2f} ms", m_uiReferenceSamples, m_TileScheduler.m_Stats.timeMs);
+
+		// Every mode gets the same sample budget, so the curves show error against time at equal sample counts too
+		const uint64_t sampleLimit = static_cast<uint64_t>(std::max(1u, m_uiReferenceSamples / 4)) * m_uiWidth * m_uiHeight;
+
+		m_vecEnvironmentSamplingResults.clear();
+
+		for (EnvironmentSamplingMode eMode : { EnvironmentSamplingMode::UNIFORM, EnvironmentSamplingMode::COSINE, EnvironmentSamplingMode::CDF,
+											   EnvironmentSamplingMode::ALIAS })
+		{
+			m_eEnvironmentSampling = eMode;
+			SnapshotScene(pScene);
+			ResetAccumulation();
+
+			CpuEnvironmentSamplingResult result;
+			result.eMode = eMode;
+			result.passes = 0;
+			result.timeMs = 0.0f;
+			result.rmse = FLT_MAX;
+			result.targetTimeMs = -1.0f;
+
+			// Only render time counts, error evaluation sits outside the timed passes
+			while (AllocateSamples(false, static_cast<float>(m_uiSamplesPerPixel)) > 0)
+			{
+				RenderFrame(0);
+				result.timeMs += m_TileScheduler.m_Stats.timeMs;
+				++result.passes;
+
+				result.rmse = ComputeRMSE(vecReference);
+				result.vecTimeMs.push_back(result.timeMs);
+				result.vecRMSE.push_back(result.rmse);
+
+				if (result.targetTimeMs < 0.0f && result.rmse <= m_fTargetError)
+					result.targetTimeMs = result.timeMs;
+
+				if (CountSamples() >= sampleLimit)
+					break;
+			}
+
+			result.averageSamples = CountSamples() / pixelCount;
+			m_vecEnvironmentSamplingResults.push_back(result);
+
+			LOG_INFO("CpuRenderer environment sampling: {0}, {1} passes, {2:.2f} ms, {3:.1f} spp, RMSE {4:.4f}, target {5}",
+					 GetEnvironmentSamplingName(eMode), result.passes, result.timeMs, result.averageSamples, result.rmse,
+					 result.targetTimeMs >= 0.0f ? std::to_string(result.targetTimeMs) + " ms" : std::string("not reached"));
+		}
+
+		// Variance at equal time, RMSE^2 scaled by the time each mode took for the same samples
+		const CpuEnvironmentSamplingResult& uniform = m_vecEnvironmentSamplingResults.front();
+		for (const CpuEnvironmentSamplingResult& result : m_vecEnvironmentSamplingResults)
+		{
+			const float uniformCost = uniform.rmse * uniform.rmse * uniform.timeMs;
+			const float cost = result.rmse * result.rmse * result.timeMs;
+			if (cost > 0.0f)
+				LOG_INFO("CpuRenderer environment sampling: {0} is {1:.2f}x as efficient as uniform", GetEnvironmentSamplingName(result.eMode), uniformCost / cost);
+		}
+
+		m_bEnvironmentLighting = bEnvironmentLighting;
+		m_eEnvironmentSampling = eEnvironmentSampling;
+		ResetAccumulation();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::ResetAccumulation()
+	{
+		CancelAndWait();
+
+		const size_t tileCount = m_TileScheduler.BuildTiles(m_uiWidth, m_uiHeight).size();
+
+		m_vecAccumulation.assign(m_uiWidth * m_uiHeight, glm::vec4(0.0f));
+		m_vecTileSamples.assign(tileCount, 0);
+		m_vecTilePassSamples.assign(tileCount, 0);
+		m_vecTileError.assign(tileCount, FLT_MAX);
+
+		m_uiLastSampleCount = 0;
+		m_fAverageSamples = 0.0f;
+		m_uiActiveTiles = 0;
+		m_bConverged = false;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::CancelAndWait()
+	{
+		m_bCancel = true;
+		JobSystem::getInstance().Wait(&m_FrameGroup);
+		RetireFrame();
+		m_bCancel = false;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Main thread bookkeeping once the frame task has finished
+	void CpuRenderer::RetireFrame()
+	{
+		if (!m_bFrameInFlight)
+			return;
+
+		m_bFrameInFlight = false;
+		m_LastFrameStats = m_TileScheduler.m_Stats;
+
+		// Tiles that finished before a cancel still accumulated valid samples, so count them either way
+		const uint64_t sampleCount = CountSamples();
+		if (sampleCount > m_uiLastSampleCount && m_LastFrameStats.timeMs > 0.0f)
+			m_fMsPerSample = m_LastFrameStats.timeMs / (sampleCount - m_uiLastSampleCount);
+
+		m_uiLastSampleCount = sampleCount;
+		m_fAverageSamples = static_cast<float>(sampleCount) / (m_uiWidth * m_uiHeight);
+
+		if (m_LastFrameStats.bCancelled)
+		{
+			++m_uiFramesCancelled;
+			return;
+		}
+
+		// Tiles skipped by the pass keep their previous output, so copy instead of swapping
+		++m_uiFramesCompleted;
+		m_vecDisplayPixels = m_vecRenderPixels;
+		++m_uiDisplayVersion;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::SnapshotScene(Scene* pScene)
+	{
+		const Camera& camera = Camera::getInstance();
+
+		m_matView = camera.m_matView;
+		m_matProjection = camera.m_matProjection;
+		m_matViewInverse = glm::inverse(m_matView);
+		m_matProjInverse = glm::inverse(m_matProjection);
+
+		m_vecInstances.clear();
+		for (const SceneObject* pObject : pScene->m_vecSceneObjects)
+		{
+			CpuInstance instance;
+			instance.pObject = pObject;
+			instance.matObjectToWorld = pObject->m_pMeshInstanceData->transformMatrix;
+			instance.matWorldToObject = glm::inverse(instance.matObjectToWorld);
+			m_vecInstances.push_back(instance);
+		}
+
+		// Own copy of the scene's two level BVH, the main thread updates Scene's every frame while tiles trace. Refits &
+		// inserts only touch what changed since the last snapshot.
+		m_SceneBVH.Update(pScene->m_vecSceneObjects);
+
+		m_bFrameEnvironmentLighting = m_bEnvironmentLighting && m_Environment.IsValid();
+		m_eFrameEnvironmentSampling = m_eEnvironmentSampling;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool CpuRenderer::HasSceneChanged(Scene* pScene) const
+	{
+		const Camera& camera = Camera::getInstance();
+		if (camera.m_matView != m_matView || camera.m_matProjection != m_matProjection)
+			return true;
+
+		if ((m_bEnvironmentLighting && m_Environment.IsValid()) != m_bFrameEnvironmentLighting || m_eEnvironmentSampling != m_eFrameEnvironmentSampling)
+			return true;
+
+		if (pScene->m_vecSceneObjects.size() != m_vecInstances.size())
+			return true;
+
+		for (uint32_t i = 0; i < m_vecInstances.size(); ++i)
+		{
+			const SceneObject* pObject = pScene->m_vecSceneObjects[i];
+			if (pObject != m_vecInstances[i].pObject || pObject->m_pMeshInstanceData->transformMatrix != m_vecInstances[i].matObjectToWorld)
+				return true;
+		}
+
+		return false;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Fills m_vecTilePassSamples for the next pass & returns the number of tiles that get samples.
+	//--- Uniform mode gives every tile the same count until all of them are below m_fTargetNoise. Adaptive mode warms
+	//--- every tile up, then drops tiles below m_fTargetNoise & splits the pass budget over the rest by their noise.
+	uint32_t CpuRenderer::AllocateSamples(bool bAdaptive, float passSamples)
+	{
+		const uint32_t nTiles = static_cast<uint32_t>(m_vecTileSamples.size());
+		const uint32_t baseSamples = std::max(1u, static_cast<uint32_t>(passSamples + 0.5f));
+
+		float sumError = 0.0f;
+		float maxError = 0.0f;
+		for (uint32_t i = 0; i < nTiles; ++i)
+		{
+			maxError = std::max(maxError, m_vecTileError[i]);
+
+			if (m_vecTileSamples[i] >= ADAPTIVE_WARMUP_SAMPLES && m_vecTileSamples[i] < m_uiMaxSamplesPerPixel && m_vecTileError[i] > m_fTargetNoise)
+				sumError += m_vecTileError[i];
+		}
+
+		const bool bAllConverged = m_fTargetNoise > 0.0f && maxError <= m_fTargetNoise;
+		const float budget = passSamples * nTiles;
+
+		uint32_t activeTiles = 0;
+		for (uint32_t i = 0; i < nTiles; ++i)
+		{
+			const uint32_t remaining = m_uiMaxSamplesPerPixel - std::min(m_vecTileSamples[i], m_uiMaxSamplesPerPixel);
+			uint32_t samples = 0;
+
+			if (!bAdaptive)
+			{
+				samples = bAllConverged ? 0 : baseSamples;
+			}
+			else if (m_vecTileSamples[i] < ADAPTIVE_WARMUP_SAMPLES)
+			{
+				samples = std::max(baseSamples, ADAPTIVE_WARMUP_SAMPLES - m_vecTileSamples[i]);
+			}
+			else if (m_vecTileError[i] > m_fTargetNoise && sumError > 0.0f)
+			{
+				samples = static_cast<uint32_t>(budget * m_vecTileError[i] / sumError + 0.5f);
+				samples = glm::clamp(samples, 1u, baseSamples * ADAPTIVE_MAX_PASS_SCALE);
+			}
+
+			m_vecTilePassSamples[i] = std::min(samples, remaining);
+			activeTiles += m_vecTilePassSamples[i] > 0 ? 1 : 0;
+		}
+
+		return activeTiles;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::KickFrame()
+	{
+		m_bCancel = false;
+		m_bFrameInFlight = true;
+
+		JobSystem::getInstance().Run(&m_FrameGroup, [this]() { RenderFrame(0); });
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool CpuRenderer::RenderFrame(uint32_t nThreads)
+	{
+		m_TileScheduler.SetThreadCount(nThreads);
+
+		return m_TileScheduler.Execute(m_uiWidth, m_uiHeight, [this](const Tile& tile, uint32_t threadIndex) { RenderTile(tile); }, &m_bCancel);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::RenderTile(const Tile& tile)
+	{
+		const uint32_t passSamples = m_vecTilePassSamples[tile.index];
+		if (passSamples == 0)
+			return;
+
+		const uint32_t firstSample = m_vecTileSamples[tile.index];
+		const uint32_t totalSamples = firstSample + passSamples;
+		const float invSamples = 1.0f / totalSamples;
+
+		float sumVarianceOfMean = 0.0f;
+		float sumLuminance = 0.0f;
+
+		for (uint32_t y = tile.y; y < tile.y + tile.height; ++y)
+		{
+			for (uint32_t x = tile.x; x < tile.x + tile.width; ++x)
+			{
+				glm::vec4& accumulation = m_vecAccumulation[y * m_uiWidth + x];
+				for (uint32_t s = firstSample; s < totalSamples; ++s)
+				{
+					const glm::vec3 color = TracePixel(x, y, s);
+					const float luminance = Luminance(color);
+					accumulation += glm::vec4(color, luminance * luminance);
+				}
+
+				const glm::vec3 mean = glm::vec3(accumulation) * invSamples;
+				const float meanLuminance = Luminance(mean);
+				const float variance = std::max(0.0f, accumulation.w * invSamples - meanLuminance * meanLuminance);
+
+				sumVarianceOfMean += variance * invSamples;
+				sumLuminance += meanLuminance;
+
+				m_vecRenderPixels[y * m_uiWidth + x] = PackColor(mean);
+			}
+		}
+
+		// Relative standard error of the tile mean, offset keeps near black tiles from never converging
+		const float pixelCount = static_cast<float>(tile.width * tile.height);
+		m_vecTileSamples[tile.index] = totalSamples;
+		m_vecTileError[tile.index] = totalSamples > 1 ? std::sqrt(sumVarianceOfMean / pixelCount) / (sumLuminance / pixelCount + 0.01f) : FLT_MAX;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Same camera setup as raygenBasic.rgen, jittered inside the pixel
+	glm::vec3 CpuRenderer::TracePixel(uint32_t x, uint32_t y, uint32_t sampleIndex) const
+	{
+		RandomSampler sampler(PixelSeed(x, y, m_uiSeedStream, sampleIndex));
+
+		const glm::vec2 pixel = glm::vec2(static_cast<float>(x), static_cast<float>(y)) + sampler.NextFloat2();
+		const glm::vec2 inUV = pixel / glm::vec2(static_cast<float>(m_uiWidth), static_cast<float>(m_uiHeight));
+		const glm::vec2 d = inUV * 2.0f - glm::vec2(1.0f);
+
+		Ray ray = GenerateCameraRay(m_matViewInverse, m_matProjInverse, d);
+		RayHit hit;
+		const bool bHit = IntersectScene(ray, hit);
+
+		if (m_bFrameEnvironmentLighting)
+			return ShadeEnvironment(ray, hit, bHit, sampler);
+
+		// closestHitBasic
+		if (bHit)
+			return glm::vec3(1.0f - hit.barycentrics.x - hit.barycentrics.y, hit.barycentrics.x, hit.barycentrics.y);
+
+		// missBasic
+		return glm::vec3(0.0f, 0.0f, 0.2f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Diffuse direct lighting from the environment, one light direction & one shadow ray per sample
+	glm::vec3 CpuRenderer::ShadeEnvironment(const Ray& ray, const RayHit& hit, bool bHit, RandomSampler& sampler) const
+	{
+		if (!bHit)
+			return Texture::LookupEnvironment(m_Environment, ray.direction);
+
+		// Object space normal to world through the inverse transpose, flipped towards the camera
+		const CpuInstance& instance = m_vecInstances[hit.objectIndex];
+		glm::vec3 normal = glm::normalize(glm::vec3(glm::transpose(instance.matWorldToObject) * glm::vec4(hit.normal, 0.0f)));
+		if (glm::dot(normal, ray.direction) > 0.0f)
+			normal = -normal;
+
+		glm::vec3 direction(0.0f), radiance(0.0f);
+		float pdf = 0.0f;
+
+		switch (m_eFrameEnvironmentSampling)
+		{
+			case EnvironmentSamplingMode::UNIFORM:
+			case EnvironmentSamplingMode::COSINE:
+			{
+				glm::vec3 tangent, bitangent;
+				BuildOrthonormalBasis(normal, tangent, bitangent);
+
+				const bool bUniform = m_eFrameEnvironmentSampling == EnvironmentSamplingMode::UNIFORM;
+				const glm::vec3 local = bUniform ? SampleUniformHemisphere(sampler.NextFloat2()) : SampleCosineHemisphere(sampler.NextFloat2());
+
+				direction = tangent * local.x + bitangent * local.y + normal * local.z;
+				radiance = Texture::LookupEnvironment(m_Environment, direction);
+				pdf = bUniform ? static_cast<float>(0.5 / M_PI) : local.z * static_cast<float>(1.0 / M_PI);
+				break;
+			}
+
+			case EnvironmentSamplingMode::CDF:
+			case EnvironmentSamplingMode::ALIAS:
+			{
+				const glm::vec2 u = sampler.NextFloat2();
+				const Texture::EnvironmentSample sample = m_eFrameEnvironmentSampling == EnvironmentSamplingMode::CDF ?
+														  Texture::SampleEnvironmentCDF(m_Environment, u) :
+														  Texture::SampleEnvironmentAlias(m_Environment, glm::vec3(u.x, u.y, sampler.NextFloat()));
+				direction = sample.direction;
+				radiance = sample.radiance;
+				pdf = sample.pdf;
+				break;
+			}
+		}
+
+		// Environment samples below the horizon are wasted, that's the price of ignoring the normal
+		const float cosTheta = glm::dot(normal, direction);
+		if (cosTheta <= 0.0f || pdf <= 0.0f || Luminance(radiance) <= 0.0f)
+			return glm::vec3(0.0f);
+
+		const glm::vec3 position = ray.origin + ray.direction * hit.t;
+		Ray shadowRay(position + normal * SHADOW_RAY_OFFSET, direction, 0.0f, FLT_MAX);
+		RayHit shadowHit;
+		if (IntersectScene(shadowRay, shadowHit))
+			return glm::vec3(0.0f);
+
+		return radiance * (ENVIRONMENT_ALBEDO * cosTheta / (static_cast<float>(M_PI) * pdf));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Same top level traversal as picking, so only instances whose world bounds the ray crosses get intersected
+	bool CpuRenderer::IntersectScene(Ray& ray, RayHit& hit) const
+	{
+		return m_SceneBVH.RaycastClosest(ray, hit);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CpuRenderer::ResolveAccumulation(std::vector<glm::vec3>& vecOut) const
+	{
+		vecOut.resize(m_uiWidth * m_uiHeight);
+
+		for (const Tile& tile : m_TileScheduler.GetTiles())
+		{
+			const float invSamples = 1.0f / std::max(1u, m_vecTileSamples[tile.index]);
+
+			for (uint32_t y = tile.y; y < tile.y + tile.height; ++y)
+			{
+				for (uint32_t x = tile.x; x < tile.x + tile.width; ++x)
+				{
+					vecOut[y * m_uiWidth + x] = glm::vec3(m_vecAccumulation[y * m_uiWidth + x]) * invSamples;
+				}
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float CpuRenderer::ComputeRMSE(const std::vector<glm::vec3>& vecReference) const
+	{
+		std::vector<glm::vec3> vecCurrent;
+		ResolveAccumulation(vecCurrent);
+
+		double sumSquaredError = 0.0;
+		for (size_t i = 0; i < vecCurrent.size(); ++i)
+		{
+			const glm::vec3 diff = vecCurrent[i] - vecReference[i];
+			sumSquaredError += glm::dot(diff, diff);
+		}
+
+		return static_cast<float>(std::sqrt(sumSquaredError / (vecCurrent.size() * 3)));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint64_t CpuRenderer::CountSamples() const
+	{
+		uint64_t count = 0;
+		for (const Tile& tile : m_TileScheduler.GetTiles())
+		{
+			count += static_cast<uint64_t>(m_vecTileSamples[tile.index]) * tile.width * tile.height;
+		}
+
+		return count;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t CpuRenderer::PackColor(const glm::vec3& color) const
+	{
+		const glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + glm::vec3(0.5f);
+
+		const uint32_t r = static_cast<uint32_t>(c.x);
+		const uint32_t g = static_cast<uint32_t>(c.y);
+		const uint32_t b = static_cast<uint32_t>(c.z);
+
+		// Matches the swapchain format the result gets copied into
+		return m_bOutputBGRA ? (b | (g << 8) | (r << 16) | (255u << 24)) : (r | (g << 8) | (b << 16) | (255u << 24));
+	}
+}
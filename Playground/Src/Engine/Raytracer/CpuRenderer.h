@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+
+#include "glm/glm.hpp"
+
+#include "BVH.h"
+#include "SceneBVH.h"
+#include "TileScheduler.h"
+#include "Engine/Helpers/JobSystem.h"
+#include "Engine/Texture/EnvironmentSampling.h"
+
+class Scene;
+class SceneObject;
+
+namespace Raytracer
+{
+	struct RandomSampler;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Per-object state captured at frame start, so that the frame never reads transforms the main thread is writing
+	struct CpuInstance
+	{
+		const SceneObject*	pObject;
+		glm::mat4			matObjectToWorld;
+		glm::mat4			matWorldToObject;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct CpuScalingResult
+	{
+		uint32_t	threadCount;
+		float		timeMs;
+		float		speedup;
+		float		efficiency;
+		bool		bDeterministic;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct CpuConvergenceResult
+	{
+		bool		bAdaptive;
+		bool		bReachedTarget;
+		uint32_t	passes;
+		float		timeMs;
+		float		averageSamples;			// Samples per pixel, averaged over the image
+		float		rmse;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- How the environment lit path picks its one light direction per sample
+	enum class EnvironmentSamplingMode
+	{
+		UNIFORM,				// Hemisphere around the normal
+		COSINE,					// Cosine weighted hemisphere
+		CDF,					// Marginal/conditional CDF of the environment
+		ALIAS					// Alias table of the environment
+	};
+
+	inline const char* GetEnvironmentSamplingName(EnvironmentSamplingMode eMode)
+	{
+		const char* arrNames[] = { "uniform", "cosine", "CDF", "alias" };
+		return arrNames[static_cast<uint32_t>(eMode)];
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct CpuEnvironmentSamplingResult
+	{
+		EnvironmentSamplingMode	eMode;
+		uint32_t				passes;
+		float					timeMs;
+		float					averageSamples;
+		float					rmse;
+		float					targetTimeMs;			// First pass at or below m_fTargetError, negative if never
+		std::vector<float>		vecTimeMs;				// Accumulated render time after each pass
+		std::vector<float>		vecRMSE;				// & the error at that point
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- CPU reference implementation of raygenBasic/missBasic/closestHitBasic. Passes render asynchronously on the
+	//--- JobSystem through the work-stealing TileScheduler & accumulate into a float buffer until the camera or an
+	//--- instance transform changes. Adaptive mode spends each pass's samples on the tiles with the highest noise.
+	//--- Environment lighting swaps the basic shaders for a white diffuse surface lit by an HDRI with one shadowed
+	//--- light sample per pixel sample, which is where the environment sampling modes get compared.
+	class CpuRenderer
+	{
+	public:
+		CpuRenderer();
+		~CpuRenderer();
+
+		void									Initialize(uint32_t width, uint32_t height, bool bOutputBGRA);
+		void									Cleanup();
+
+		// Non blocking. Cancels the in-flight pass & restarts accumulation if the scene changed, kicks the next pass when idle.
+		void									Update(Scene* pScene);
+
+		// Copies the latest finished frame into pDst (width * height RGBA8/BGRA8) unless uiFrameVersion says pDst
+		// already holds it. Every destination keeps its own version, so multiple frames in flight all catch up.
+		bool									AcquireFrame(void* pDst, uint32_t& uiFrameVersion);
+
+		// Renders the same frame with 1..N threads & logs speedup/efficiency. Blocks.
+		void									MeasureScaling(Scene* pScene);
+
+		// Time for uniform & adaptive sampling to get within m_fTargetError RMSE of a high sample count reference. Blocks.
+		void									MeasureConvergence(Scene* pScene);
+
+		// Loads Assets/Textures/HDRI/fileName & builds its sampling tables, Update loads m_strEnvironmentFile on first use. Blocks.
+		bool									LoadEnvironment(const std::string& fileName);
+
+		// Error over time of every EnvironmentSamplingMode against an alias sampled reference, environment lighting forced on.
+		// Loads the default HDRI if none is loaded yet. Blocks.
+		void									MeasureEnvironmentSampling(Scene* pScene);
+
+		void									ResetAccumulation();
+
+		inline uint32_t							GetWidth() const	{ return m_uiWidth; }
+		inline uint32_t							GetHeight() const	{ return m_uiHeight; }
+
+	private:
+		void									CancelAndWait();
+		void									RetireFrame();
+		void									SnapshotScene(Scene* pScene);
+		bool									HasSceneChanged(Scene* pScene) const;
+		uint32_t								AllocateSamples(bool bAdaptive, float passSamples);
+		void									KickFrame();
+		bool									RenderFrame(uint32_t nThreads);
+		void									RenderTile(const Tile& tile);
+		glm::vec3								TracePixel(uint32_t x, uint32_t y, uint32_t sampleIndex) const;
+		glm::vec3								ShadeEnvironment(const Ray& ray, const RayHit& hit, bool bHit, RandomSampler& sampler) const;
+		void									ResolveAccumulation(std::vector<glm::vec3>& vecOut) const;
+		float									ComputeRMSE(const std::vector<glm::vec3>& vecReference) const;
+		uint64_t								CountSamples() const;
+		bool									IntersectScene(Ray& ray, RayHit& hit) const;
+		uint32_t								PackColor(const glm::vec3& color) const;
+
+	public:
+		bool									m_bEnabled;
+		uint32_t								m_uiSamplesPerPixel;		// Per pass, average over the image in adaptive mode
+		size_t									m_uiCacheSizeBytes;			// Per-core cache the tile size gets tuned for
+
+		bool									m_bAdaptiveSampling;
+		float									m_fTargetNoise;				// Relative standard error a tile stops at, 0 = never
+		float									m_fFrameBudgetMs;			// Sizes each pass to this time, 0 = fixed samples per pass
+		uint32_t								m_uiMaxSamplesPerPixel;
+		uint32_t								m_uiReferenceSamples;		// MeasureConvergence reference image
+		float									m_fTargetError;				// MeasureConvergence RMSE target
+
+		bool									m_bEnvironmentLighting;
+		EnvironmentSamplingMode					m_eEnvironmentSampling;
+		std::string								m_strEnvironmentFile;
+		Texture::EnvironmentSamplingReport		m_EnvironmentReport;
+
+		TileSchedulerStats						m_LastFrameStats;
+		uint32_t								m_uiFramesCompleted;
+		uint32_t								m_uiFramesCancelled;
+		uint32_t								m_uiActiveTiles;
+		float									m_fAverageSamples;
+		bool									m_bConverged;
+		std::vector<CpuScalingResult>			m_vecScalingResults;
+		std::vector<CpuConvergenceResult>		m_vecConvergenceResults;
+		std::vector<CpuEnvironmentSamplingResult>	m_vecEnvironmentSamplingResults;
+
+	private:
+		uint32_t								m_uiWidth;
+		uint32_t								m_uiHeight;
+		bool									m_bOutputBGRA;
+		uint32_t								m_uiSeedStream;
+
+		TileScheduler							m_TileScheduler;
+		TaskGroup								m_FrameGroup;
+		std::atomic<bool>						m_bCancel;
+
+		// Frame inputs, only touched by the main thread while no frame is in flight
+		glm::mat4								m_matViewInverse;
+		glm::mat4								m_matProjInverse;
+		glm::mat4								m_matView;
+		glm::mat4								m_matProjection;
+		std::vector<CpuInstance>				m_vecInstances;
+		SceneBVH								m_SceneBVH;					// Over the snapshot, hit objectIndex indexes m_vecInstances
+		bool									m_bFrameEnvironmentLighting;
+		EnvironmentSamplingMode					m_eFrameEnvironmentSampling;
+		Texture::EnvironmentSampling			m_Environment;
+
+		// Per pixel rgb sum & luminance squared sum, per tile sample counts. Only the thread running a tile touches its entries.
+		std::vector<glm::vec4>					m_vecAccumulation;
+		std::vector<uint32_t>					m_vecTileSamples;
+		std::vector<uint32_t>					m_vecTilePassSamples;		// Allocation for the pass in flight
+		std::vector<float>						m_vecTileError;
+		uint64_t								m_uiLastSampleCount;
+		float									m_fMsPerSample;
+
+		std::vector<uint32_t>					m_vecRenderPixels;			// Written by tiles
+		std::vector<uint32_t>					m_vecDisplayPixels;			// Last complete pass, main thread only
+		bool									m_bFrameInFlight;
+		uint32_t								m_uiDisplayVersion;
+	};
+}
@@ -0,0 +1,594 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "DynamicBVH.h"
+
+#include <chrono>
+#include <queue>
+#include <random>
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	const uint32_t	DYNAMIC_SAH_BIN_COUNT	= 16;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline bool SameBounds(const AABB& a, const AABB& b)
+	{
+		return a.vecMin.x == b.vecMin.x && a.vecMin.y == b.vecMin.y && a.vecMin.z == b.vecMin.z &&
+			   a.vecMax.x == b.vecMax.x && a.vecMax.y == b.vecMax.y && a.vecMax.z == b.vecMax.z;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline AABB Union(const AABB& a, const AABB& b)
+	{
+		AABB box = a;
+		box.Grow(b);
+		return box;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	DynamicBVH::DynamicBVH()
+	{
+		m_fOverlapGrowthThreshold = 0.25f;
+		m_uiMaxTreeletLeaves = 256;
+		m_uiRootIndex = INVALID_INDEX;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	DynamicBVH::~DynamicBVH()
+	{
+		Clear();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DynamicBVH::Clear()
+	{
+		m_vecNodes.clear();
+		m_vecFreeNodes.clear();
+		m_vecTreeletCandidates.clear();
+		m_uiRootIndex = INVALID_INDEX;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DynamicBVH::Build(const std::vector<AABB>& vecBounds, std::vector<uint32_t>& vecOutLeaves)
+	{
+		Clear();
+
+		const uint32_t count = static_cast<uint32_t>(vecBounds.size());
+		vecOutLeaves.resize(count);
+
+		if (count == 0)
+			return;
+
+		m_vecNodes.reserve(2 * count - 1);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint32_t leaf = AllocateNode();
+			m_vecNodes[leaf].bounds = vecBounds[i];
+			m_vecNodes[leaf].primitive = i;
+			m_vecNodes[leaf].leafCount = 1;
+			vecOutLeaves[i] = leaf;
+		}
+
+		m_vecScratchLeaves = vecOutLeaves;
+		m_uiRootIndex = BuildSubtree(m_vecScratchLeaves.data(), count, INVALID_INDEX, INVALID_INDEX);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t DynamicBVH::AllocateNode()
+	{
+		uint32_t nodeIndex;
+		if (!m_vecFreeNodes.empty())
+		{
+			nodeIndex = m_vecFreeNodes.back();
+			m_vecFreeNodes.pop_back();
+		}
+		else
+		{
+			nodeIndex = static_cast<uint32_t>(m_vecNodes.size());
+			m_vecNodes.emplace_back();
+		}
+
+		DynamicBVHNode& node = m_vecNodes[nodeIndex];
+		node.bounds = AABB();
+		node.parent = INVALID_INDEX;
+		node.left = INVALID_INDEX;
+		node.right = INVALID_INDEX;
+		node.primitive = INVALID_INDEX;
+		node.leafCount = 0;
+		node.buildOverlap = 0.0f;
+		node.bTreeletCandidate = false;
+
+		return nodeIndex;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DynamicBVH::FreeNode(uint32_t nodeIndex)
+	{
+		DynamicBVHNode& node = m_vecNodes[nodeIndex];
+		node.parent = INVALID_INDEX;
+		node.primitive = INVALID_INDEX;
+		node.bTreeletCandidate = false;
+
+		m_vecFreeNodes.push_back(nodeIndex);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float DynamicBVH::ChildOverlap(const AABB& bounds, const AABB& left, const AABB& right)
+	{
+		const float area = bounds.SurfaceArea();
+		if (area <= 0.0f)
+			return 0.0f;
+
+		const AABB overlap(glm::max(left.vecMin, right.vecMin), glm::min(left.vecMax, right.vecMax));
+		if (overlap.vecMin.x > overlap.vecMax.x || overlap.vecMin.y > overlap.vecMax.y || overlap.vecMin.z > overlap.vecMax.z)
+			return 0.0f;
+
+		return overlap.SurfaceArea() / area;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Binned SAH over arbitrary nodes (leaves or whole subtrees), pLeaves gets reordered. reuseRoot, if valid, becomes
+	//--- the returned root so that the parent's child link stays intact.
+	uint32_t DynamicBVH::BuildSubtree(uint32_t* pLeaves, uint32_t count, uint32_t parent, uint32_t reuseRoot)
+	{
+		if (count == 1)
+		{
+			m_vecNodes[pLeaves[0]].parent = parent;
+			return pLeaves[0];
+		}
+
+		AABB centroidBounds;
+		for (uint32_t i = 0; i < count; ++i)
+			centroidBounds.Grow(m_vecNodes[pLeaves[i]].bounds.Centroid());
+
+		//--- Best split over all axes
+		int bestAxis = -1;
+		uint32_t bestBin = 0;
+		float bestCost = FLT_MAX;
+		const glm::vec3 extent = centroidBounds.Extent();
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (extent[axis] <= 0.0f)
+				continue;
+
+			AABB binBounds[DYNAMIC_SAH_BIN_COUNT];
+			uint32_t binCounts[DYNAMIC_SAH_BIN_COUNT] = {};
+			const float scale = DYNAMIC_SAH_BIN_COUNT / extent[axis];
+
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const AABB& bounds = m_vecNodes[pLeaves[i]].bounds;
+				const uint32_t bin = std::min(DYNAMIC_SAH_BIN_COUNT - 1, static_cast<uint32_t>((bounds.Centroid()[axis] - centroidBounds.vecMin[axis]) * scale));
+				binBounds[bin].Grow(bounds);
+				binCounts[bin] += m_vecNodes[pLeaves[i]].leafCount;
+			}
+
+			// Sweep from the right, then evaluate every plane from the left
+			float rightAreas[DYNAMIC_SAH_BIN_COUNT];
+			uint32_t rightCounts[DYNAMIC_SAH_BIN_COUNT];
+			AABB rightBox;
+			uint32_t rightCount = 0;
+			for (uint32_t b = DYNAMIC_SAH_BIN_COUNT - 1; b > 0; --b)
+			{
+				rightBox.Grow(binBounds[b]);
+				rightCount += binCounts[b];
+				rightAreas[b] = rightBox.SurfaceArea();
+				rightCounts[b] = rightCount;
+			}
+
+			AABB leftBox;
+			uint32_t leftCount = 0;
+			for (uint32_t b = 0; b < DYNAMIC_SAH_BIN_COUNT - 1; ++b)
+			{
+				leftBox.Grow(binBounds[b]);
+				leftCount += binCounts[b];
+
+				if (leftCount == 0 || rightCounts[b + 1] == 0)
+					continue;
+
+				const float cost = leftBox.SurfaceArea() * leftCount + rightAreas[b + 1] * rightCounts[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		//--- Partition, falling back to an even split when all centroids coincide
+		uint32_t leftCount = count / 2;
+		if (bestAxis >= 0)
+		{
+			const float scale = DYNAMIC_SAH_BIN_COUNT / extent[bestAxis];
+			uint32_t* pMid = std::partition(pLeaves, pLeaves + count, [&](uint32_t nodeIndex)
+			{
+				const float c = m_vecNodes[nodeIndex].bounds.Centroid()[bestAxis];
+				return std::min(DYNAMIC_SAH_BIN_COUNT - 1, static_cast<uint32_t>((c - centroidBounds.vecMin[bestAxis]) * scale)) <= bestBin;
+			});
+
+			leftCount = static_cast<uint32_t>(pMid - pLeaves);
+			if (leftCount == 0 || leftCount == count)
+				leftCount = count / 2;
+		}
+
+		// Node storage may grow while building the children, so only hold indices across the recursion
+		const uint32_t nodeIndex = reuseRoot != INVALID_INDEX ? reuseRoot : AllocateNode();
+		const uint32_t left = BuildSubtree(pLeaves, leftCount, nodeIndex, INVALID_INDEX);
+		const uint32_t right = BuildSubtree(pLeaves + leftCount, count - leftCount, nodeIndex, INVALID_INDEX);
+
+		DynamicBVHNode& node = m_vecNodes[nodeIndex];
+		node.parent = parent;
+		node.left = left;
+		node.right = right;
+		node.primitive = INVALID_INDEX;
+		node.bounds = Union(m_vecNodes[left].bounds, m_vecNodes[right].bounds);
+		node.leafCount = m_vecNodes[left].leafCount + m_vecNodes[right].leafCount;
+		node.buildOverlap = ChildOverlap(node.bounds, m_vecNodes[left].bounds, m_vecNodes[right].bounds);
+		node.bTreeletCandidate = false;
+
+		return nodeIndex;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t DynamicBVH::Insert(uint32_t primitive, const AABB& bounds)
+	{
+		const uint32_t leaf = AllocateNode();
+		m_vecNodes[leaf].bounds = bounds;
+		m_vecNodes[leaf].primitive = primitive;
+		m_vecNodes[leaf].leafCount = 1;
+		++m_Stats.inserts;
+
+		if (m_uiRootIndex == INVALID_INDEX)
+		{
+			m_uiRootIndex = leaf;
+			return leaf;
+		}
+
+		//--- Descend towards the sibling with the cheapest SAH growth. Every ancestor grows by the same
+		//--- inherited cost, so a child is only worth entering if that beats pairing up right here.
+		uint32_t sibling = m_uiRootIndex;
+		while (!m_vecNodes[sibling].IsLeaf())
+		{
+			const DynamicBVHNode& node = m_vecNodes[sibling];
+
+			const float area = node.bounds.SurfaceArea();
+			const float combinedArea = Union(node.bounds, bounds).SurfaceArea();
+			const float cost = 2.0f * combinedArea;
+			const float inheritedCost = 2.0f * (combinedArea - area);
+
+			auto childCost = [&](uint32_t child)
+			{
+				const DynamicBVHNode& childNode = m_vecNodes[child];
+				const float grownArea = Union(childNode.bounds, bounds).SurfaceArea();
+				return (childNode.IsLeaf() ? grownArea : grownArea - childNode.bounds.SurfaceArea()) + inheritedCost;
+			};
+
+			const float costLeft = childCost(node.left);
+			const float costRight = childCost(node.right);
+
+			if (cost < costLeft && cost < costRight)
+				break;
+
+			sibling = costLeft < costRight ? node.left : node.right;
+		}
+
+		//--- New parent takes the sibling's place
+		const uint32_t oldParent = m_vecNodes[sibling].parent;
+		const uint32_t newParent = AllocateNode();
+
+		DynamicBVHNode& parentNode = m_vecNodes[newParent];
+		parentNode.parent = oldParent;
+		parentNode.left = sibling;
+		parentNode.right = leaf;
+		parentNode.bounds = Union(m_vecNodes[sibling].bounds, bounds);
+		parentNode.leafCount = m_vecNodes[sibling].leafCount + 1;
+		parentNode.buildOverlap = ChildOverlap(parentNode.bounds, m_vecNodes[sibling].bounds, bounds);
+
+		if (oldParent == INVALID_INDEX)
+		{
+			m_uiRootIndex = newParent;
+		}
+		else if (m_vecNodes[oldParent].left == sibling)
+		{
+			m_vecNodes[oldParent].left = newParent;
+		}
+		else
+		{
+			m_vecNodes[oldParent].right = newParent;
+		}
+
+		m_vecNodes[sibling].parent = newParent;
+		m_vecNodes[leaf].parent = newParent;
+
+		RefitAncestors(oldParent, false);
+
+		return leaf;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DynamicBVH::Remove(uint32_t leaf)
+	{
+		++m_Stats.removes;
+
+		if (leaf == m_uiRootIndex)
+		{
+			m_uiRootIndex = INVALID_INDEX;
+			FreeNode(leaf);
+			return;
+		}
+
+		//--- Sibling moves up into the parent's slot
+		const uint32_t parent = m_vecNodes[leaf].parent;
+		const uint32_t grandParent = m_vecNodes[parent].parent;
+		const uint32_t sibling = m_vecNodes[parent].left == leaf ? m_vecNodes[parent].right : m_vecNodes[parent].left;
+
+		if (grandParent == INVALID_INDEX)
+		{
+			m_uiRootIndex = sibling;
+		}
+		else if (m_vecNodes[grandParent].left == parent)
+		{
+			m_vecNodes[grandParent].left = sibling;
+		}
+		else
+		{
+			m_vecNodes[grandParent].right = sibling;
+		}
+
+		m_vecNodes[sibling].parent = grandParent;
+
+		FreeNode(parent);
+		FreeNode(leaf);
+
+		RefitAncestors(grandParent, false);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DynamicBVH::Move(uint32_t leaf, const AABB& bounds)
+	{
+		m_vecNodes[leaf].bounds = bounds;
+		RefitAncestors(m_vecNodes[leaf].parent, true);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Recomputes bounds & leaf counts from nodeIndex up to the root. For moves the walk stops at the first ancestor
+	//--- whose bounds did not change, and nodes whose child overlap grew too much get queued for a treelet rebuild.
+	void DynamicBVH::RefitAncestors(uint32_t nodeIndex, bool bFlagOverlap)
+	{
+		while (nodeIndex != INVALID_INDEX)
+		{
+			DynamicBVHNode& node = m_vecNodes[nodeIndex];
+			const AABB& leftBounds = m_vecNodes[node.left].bounds;
+			const AABB& rightBounds = m_vecNodes[node.right].bounds;
+
+			const AABB bounds = Union(leftBounds, rightBounds);
+			if (bFlagOverlap && SameBounds(bounds, node.bounds))
+				break;
+
+			node.bounds = bounds;
+			node.leafCount = m_vecNodes[node.left].leafCount + m_vecNodes[node.right].leafCount;
+			++m_Stats.refitNodes;
+
+			if (bFlagOverlap && !node.bTreeletCandidate && ChildOverlap(bounds, leftBounds, rightBounds) > node.buildOverlap + m_fOverlapGrowthThreshold)
+			{
+				node.bTreeletCandidate = true;
+				m_vecTreeletCandidates.push_back(nodeIndex);
+			}
+
+			nodeIndex = node.parent;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t DynamicBVH::OptimizeTreelets()
+	{
+		uint32_t nRebuilt = 0;
+
+		for (uint32_t candidate : m_vecTreeletCandidates)
+		{
+			// Rebuilding clears at least the treelet root's flag, so this terminates
+			while (m_vecNodes[candidate].bTreeletCandidate)
+			{
+				// Topmost flagged ancestor, rebuilding it also covers the flagged nodes inside its treelet
+				uint32_t root = candidate;
+				for (uint32_t nodeIndex = m_vecNodes[candidate].parent; nodeIndex != INVALID_INDEX; nodeIndex = m_vecNodes[nodeIndex].parent)
+				{
+					if (m_vecNodes[nodeIndex].bTreeletCandidate)
+						root = nodeIndex;
+				}
+
+				RebuildTreelet(root);
+				++nRebuilt;
+			}
+		}
+
+		m_vecTreeletCandidates.clear();
+		return nRebuilt;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Opens up to m_uiMaxTreeletLeaves of the largest nodes below rootIndex & rebuilds the structure above them.
+	//--- Small subtrees therefore get rebuilt down to their leaves, large ones only get their top levels reshuffled.
+	void DynamicBVH::RebuildTreelet(uint32_t rootIndex)
+	{
+		auto compareArea = [this](uint32_t a, uint32_t b) { return m_vecNodes[a].bounds.SurfaceArea() < m_vecNodes[b].bounds.SurfaceArea(); };
+		std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(compareArea)> queueInterior(compareArea);
+
+		m_vecScratchLeaves.clear();
+
+		auto addFrontier = [&](uint32_t nodeIndex)
+		{
+			if (m_vecNodes[nodeIndex].IsLeaf())
+				m_vecScratchLeaves.push_back(nodeIndex);
+			else
+				queueInterior.push(nodeIndex);
+		};
+
+		addFrontier(m_vecNodes[rootIndex].left);
+		addFrontier(m_vecNodes[rootIndex].right);
+
+		while (!queueInterior.empty() && m_vecScratchLeaves.size() + queueInterior.size() < m_uiMaxTreeletLeaves)
+		{
+			const uint32_t nodeIndex = queueInterior.top();
+			queueInterior.pop();
+
+			addFrontier(m_vecNodes[nodeIndex].left);
+			addFrontier(m_vecNodes[nodeIndex].right);
+			FreeNode(nodeIndex);
+		}
+
+		while (!queueInterior.empty())
+		{
+			m_vecScratchLeaves.push_back(queueInterior.top());
+			queueInterior.pop();
+		}
+
+		const uint32_t count = static_cast<uint32_t>(m_vecScratchLeaves.size());
+		BuildSubtree(m_vecScratchLeaves.data(), count, m_vecNodes[rootIndex].parent, rootIndex);
+
+		++m_Stats.treeletsRebuilt;
+		m_Stats.treeletLeaves += count;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float DynamicBVH::ComputeSAHCost() const
+	{
+		if (m_uiRootIndex == INVALID_INDEX)
+			return 0.0f;
+
+		const float rootArea = m_vecNodes[m_uiRootIndex].bounds.SurfaceArea();
+		if (rootArea <= 0.0f)
+			return 0.0f;
+
+		// Free list entries live in the same array, so only walk reachable nodes
+		float cost = 0.0f;
+		std::vector<uint32_t> vecStack = { m_uiRootIndex };
+		while (!vecStack.empty())
+		{
+			const DynamicBVHNode& node = m_vecNodes[vecStack.back()];
+			vecStack.pop_back();
+
+			cost += node.bounds.SurfaceArea();
+			if (!node.IsLeaf())
+			{
+				vecStack.push_back(node.left);
+				vecStack.push_back(node.right);
+			}
+		}
+
+		return cost / rootArea;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<DynamicBVHBenchmarkResult> DynamicBVH::RunBenchmark(uint32_t instanceCount, uint32_t frameCount)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		std::vector<DynamicBVHBenchmarkResult> vecResults;
+		const float vecFractions[] = { 0.01f, 0.02f, 0.05f, 0.10f };
+
+		//--- Boxes of roughly unit size at an average spacing of 4, every mover drifts at half a unit per frame
+		const float worldSize = 4.0f * std::cbrt(static_cast<float>(instanceCount));
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> randomUnit(0.0f, 1.0f);
+
+		std::vector<glm::vec3> vecPositions(instanceCount);
+		std::vector<glm::vec3> vecHalfExtents(instanceCount);
+		std::vector<glm::vec3> vecVelocities(instanceCount);
+		for (uint32_t i = 0; i < instanceCount; ++i)
+		{
+			vecPositions[i] = glm::vec3(randomUnit(rng), randomUnit(rng), randomUnit(rng)) * worldSize;
+			vecHalfExtents[i] = glm::vec3(0.25f) + glm::vec3(randomUnit(rng), randomUnit(rng), randomUnit(rng)) * 0.75f;
+			vecVelocities[i] = glm::normalize(glm::vec3(randomUnit(rng), randomUnit(rng), randomUnit(rng)) - glm::vec3(0.5f)) * 0.5f;
+		}
+
+		std::vector<uint32_t> vecOrder(instanceCount);
+		for (uint32_t i = 0; i < instanceCount; ++i)
+			vecOrder[i] = i;
+		std::shuffle(vecOrder.begin(), vecOrder.end(), rng);
+
+		std::vector<AABB> vecBounds(instanceCount);
+		auto updateBounds = [&](uint32_t i) { vecBounds[i] = AABB(vecPositions[i] - vecHalfExtents[i], vecPositions[i] + vecHalfExtents[i]); };
+
+		for (float fraction : vecFractions)
+		{
+			for (uint32_t i = 0; i < instanceCount; ++i)
+				updateBounds(i);
+
+			DynamicBVH tree;
+			std::vector<uint32_t> vecLeaves;
+			tree.Build(vecBounds, vecLeaves);
+
+			const uint32_t movingCount = std::max(1u, static_cast<uint32_t>(instanceCount * fraction));
+
+			DynamicBVHBenchmarkResult result;
+			result.movingFraction = fraction;
+			result.treeletsRebuilt = 0;
+
+			double updateMs = 0.0;
+			for (uint32_t frame = 0; frame < frameCount; ++frame)
+			{
+				// Simulation step is not part of the measured update
+				for (uint32_t m = 0; m < movingCount; ++m)
+				{
+					const uint32_t i = vecOrder[m];
+					vecPositions[i] += vecVelocities[i];
+
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						if (vecPositions[i][axis] < 0.0f || vecPositions[i][axis] > worldSize)
+							vecVelocities[i][axis] = -vecVelocities[i][axis];
+					}
+
+					updateBounds(i);
+				}
+
+				const auto startTime = Clock::now();
+
+				for (uint32_t m = 0; m < movingCount; ++m)
+				{
+					const uint32_t i = vecOrder[m];
+					tree.Move(vecLeaves[i], vecBounds[i]);
+				}
+
+				result.treeletsRebuilt += tree.OptimizeTreelets();
+
+				updateMs += std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+			}
+
+			result.updateMs = static_cast<float>(updateMs / frameCount);
+			const float incrementalSAH = tree.ComputeSAHCost();
+
+			//--- Remove & reinsert every mover, the insert/remove path a refit avoids
+			auto startTime = Clock::now();
+			for (uint32_t m = 0; m < movingCount; ++m)
+			{
+				const uint32_t i = vecOrder[m];
+				tree.Remove(vecLeaves[i]);
+				vecLeaves[i] = tree.Insert(i, vecBounds[i]);
+			}
+			result.churnMs = std::chrono::duration<float, std::milli>(Clock::now() - startTime).count();
+
+			//--- Reference: rebuild everything from scratch on the final positions
+			DynamicBVH freshTree;
+			std::vector<uint32_t> vecFreshLeaves;
+			startTime = Clock::now();
+			freshTree.Build(vecBounds, vecFreshLeaves);
+			result.fullRebuildMs = std::chrono::duration<float, std::milli>(Clock::now() - startTime).count();
+
+			const float freshSAH = freshTree.ComputeSAHCost();
+			result.sahRatio = freshSAH > 0.0f ? incrementalSAH / freshSAH : 0.0f;
+
+			vecResults.push_back(result);
+
+			LOG_INFO("DynamicBVH benchmark: {0}% of {1} moving, update {2:.3f} ms/frame vs rebuild {3:.2f} ms, SAH {4:.2f}x fresh, {5} treelets, remove+insert {6:.2f} ms",
+					 fraction * 100.0f, instanceCount, result.updateMs, result.fullRebuildMs, result.sahRatio, result.treeletsRebuilt, result.churnMs);
+		}
+
+		return vecResults;
+	}
+}
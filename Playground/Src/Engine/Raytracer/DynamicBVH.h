@@ -0,0 +1,190 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "BVH.h"
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- One primitive per leaf. Leaf node indices stay valid until the leaf is removed, so callers can keep them as handles.
+	struct DynamicBVHNode
+	{
+		inline bool IsLeaf() const { return primitive != INVALID_INDEX; }
+
+		AABB		bounds;
+		uint32_t	parent;
+		uint32_t	left;
+		uint32_t	right;
+		uint32_t	primitive;			// INVALID_INDEX for interior nodes
+		uint32_t	leafCount;
+		float		buildOverlap;		// Child overlap when this node was last (re)built
+		bool		bTreeletCandidate;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct DynamicBVHStats
+	{
+		DynamicBVHStats() { Reset(); }
+
+		inline void Reset() { refitNodes = 0; inserts = 0; removes = 0; treeletsRebuilt = 0; treeletLeaves = 0; }
+
+		uint32_t	refitNodes;
+		uint32_t	inserts;
+		uint32_t	removes;
+		uint32_t	treeletsRebuilt;
+		uint32_t	treeletLeaves;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct DynamicBVHBenchmarkResult
+	{
+		float		movingFraction;
+		float		updateMs;			// Average per frame: refits + treelet rebuilds
+		float		fullRebuildMs;		// Rebuilding the whole tree for the same frame
+		float		sahRatio;			// Final SAH cost relative to a fresh build
+		uint32_t	treeletsRebuilt;	// Total over all frames
+		float		churnMs;			// Removing & reinserting the moving instances instead of refitting them
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Incrementally updated BVH for the scene top level. Moving a primitive refits its ancestors bottom-up, so the cost
+	//--- follows the number of moved primitives rather than the total. Nodes whose child overlap grew past a threshold
+	//--- since they were built get their subtree rebuilt locally with binned SAH. Insert picks the sibling with the
+	//--- cheapest SAH growth, remove splices the sibling into the parent slot. Neither touches the rest of the tree.
+	class DynamicBVH
+	{
+	public:
+		DynamicBVH();
+		~DynamicBVH();
+
+		// Bulk top-down build, primitive i gets leaf vecOutLeaves[i]
+		void									Build(const std::vector<AABB>& vecBounds, std::vector<uint32_t>& vecOutLeaves);
+		void									Clear();
+
+		uint32_t								Insert(uint32_t primitive, const AABB& bounds);
+		void									Remove(uint32_t leaf);
+		void									Move(uint32_t leaf, const AABB& bounds);
+
+		// Rebuilds the treelets flagged by Move since the last call. Returns the number of treelets rebuilt.
+		uint32_t								OptimizeTreelets();
+
+		inline void								SetPrimitive(uint32_t leaf, uint32_t primitive) { m_vecNodes[leaf].primitive = primitive; }
+		inline uint32_t							GetPrimitive(uint32_t leaf) const { return m_vecNodes[leaf].primitive; }
+		inline bool								IsEmpty() const { return m_uiRootIndex == INVALID_INDEX; }
+
+		// Same normalization as BVH::ComputeSAHCost
+		float									ComputeSAHCost() const;
+
+		// intersectPrim(primitive, ray) must return true on a hit and shrink ray.tMax to the hit distance
+		template<typename PrimIntersector>
+		bool									Traverse(Ray& ray, PrimIntersector&& intersectPrim) const;
+
+		// Simulates movingFraction of instanceCount boxes moving every frame & logs update cost against full rebuilds
+		static std::vector<DynamicBVHBenchmarkResult>	RunBenchmark(uint32_t instanceCount, uint32_t frameCount);
+
+	private:
+		uint32_t								AllocateNode();
+		void									FreeNode(uint32_t nodeIndex);
+		void									RefitAncestors(uint32_t nodeIndex, bool bFlagOverlap);
+		uint32_t								BuildSubtree(uint32_t* pLeaves, uint32_t count, uint32_t parent, uint32_t reuseRoot);
+		void									RebuildTreelet(uint32_t rootIndex);
+
+		static float							ChildOverlap(const AABB& bounds, const AABB& left, const AABB& right);
+
+	public:
+		float									m_fOverlapGrowthThreshold;	// Growth of child overlap / node area that flags a treelet
+		uint32_t								m_uiMaxTreeletLeaves;		// Larger flagged subtrees pass the flag down instead
+		DynamicBVHStats							m_Stats;
+
+	private:
+		std::vector<DynamicBVHNode>				m_vecNodes;
+		std::vector<uint32_t>					m_vecFreeNodes;
+		std::vector<uint32_t>					m_vecTreeletCandidates;
+		std::vector<uint32_t>					m_vecScratchLeaves;
+		uint32_t								m_uiRootIndex;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	template<typename PrimIntersector>
+	bool DynamicBVH::Traverse(Ray& ray, PrimIntersector&& intersectPrim) const
+	{
+		if (m_uiRootIndex == INVALID_INDEX)
+			return false;
+
+		float tEntry;
+		if (!IntersectAABB(ray, m_vecNodes[m_uiRootIndex].bounds, tEntry))
+			return false;
+
+		// Incremental inserts can unbalance the tree, so the stack grows on demand
+		uint32_t localStack[64];
+		std::vector<uint32_t> vecOverflow;
+		uint32_t stackPtr = 0;
+		uint32_t nodeIndex = m_uiRootIndex;
+		bool bHit = false;
+
+		auto push = [&](uint32_t index)
+		{
+			if (stackPtr < 64)
+				localStack[stackPtr++] = index;
+			else
+				vecOverflow.push_back(index);
+		};
+
+		auto pop = [&](uint32_t& index)
+		{
+			if (!vecOverflow.empty())
+			{
+				index = vecOverflow.back();
+				vecOverflow.pop_back();
+				return true;
+			}
+
+			if (stackPtr == 0)
+				return false;
+
+			index = localStack[--stackPtr];
+			return true;
+		};
+
+		while (true)
+		{
+			const DynamicBVHNode& node = m_vecNodes[nodeIndex];
+
+			if (node.IsLeaf())
+			{
+				bHit |= intersectPrim(node.primitive, ray);
+
+				if (!pop(nodeIndex))
+					break;
+
+				continue;
+			}
+
+			float tLeft, tRight;
+			const bool bHitLeft = IntersectAABB(ray, m_vecNodes[node.left].bounds, tLeft);
+			const bool bHitRight = IntersectAABB(ray, m_vecNodes[node.right].bounds, tRight);
+
+			if (bHitLeft && bHitRight)
+			{
+				const bool bLeftFirst = tLeft <= tRight;
+				push(bLeftFirst ? node.right : node.left);
+				nodeIndex = bLeftFirst ? node.left : node.right;
+			}
+			else if (bHitLeft)
+			{
+				nodeIndex = node.left;
+			}
+			else if (bHitRight)
+			{
+				nodeIndex = node.right;
+			}
+			else if (!pop(nodeIndex))
+			{
+				break;
+			}
+		}
+
+		return bHit;
+	}
+}
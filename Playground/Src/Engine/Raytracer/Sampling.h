@@ -0,0 +1,83 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- PCG hash, good enough avalanche to turn pixel coordinates into independent seeds
+	inline uint32_t PCGHash(uint32_t v)
+	{
+		const uint32_t state = v * 747796405u + 2891336453u;
+		const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Seed depends only on pixel, stream & sample index, never on which thread renders the pixel.
+	//--- That keeps output bit-identical for any thread count or tile schedule. Different streams give
+	//--- uncorrelated sample sequences for the same pixel.
+	inline uint32_t PixelSeed(uint32_t x, uint32_t y, uint32_t streamIndex, uint32_t sampleIndex)
+	{
+		return PCGHash(x ^ PCGHash(y ^ PCGHash(streamIndex ^ PCGHash(sampleIndex))));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Small per-pixel random number generator
+	struct RandomSampler
+	{
+		explicit RandomSampler(uint32_t seed) : state(seed) {}
+
+		inline uint32_t NextUInt()
+		{
+			state = PCGHash(state);
+			return state;
+		}
+
+		// Uniform float in [0, 1)
+		inline float NextFloat()
+		{
+			return (NextUInt() >> 8) * (1.0f / 16777216.0f);
+		}
+
+		inline glm::vec2 NextFloat2()
+		{
+			const float u = NextFloat();
+			return glm::vec2(u, NextFloat());
+		}
+
+		uint32_t state;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Duff et al. branchless basis around a unit normal
+	inline void BuildOrthonormalBasis(const glm::vec3& n, glm::vec3& outTangent, glm::vec3& outBitangent)
+	{
+		const float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+		const float a = -1.0f / (sign + n.z);
+		const float b = n.x * n.y * a;
+
+		outTangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+		outBitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Hemisphere around +z, pdf 1 / (2 PI)
+	inline glm::vec3 SampleUniformHemisphere(const glm::vec2& u)
+	{
+		const float r = std::sqrt(std::max(0.0f, 1.0f - u.x * u.x));
+		const float phi = static_cast<float>(2.0 * M_PI) * u.y;
+
+		return glm::vec3(r * std::cos(phi), r * std::sin(phi), u.x);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Hemisphere around +z, pdf cos(theta) / PI
+	inline glm::vec3 SampleCosineHemisphere(const glm::vec2& u)
+	{
+		const float r = std::sqrt(u.x);
+		const float phi = static_cast<float>(2.0 * M_PI) * u.y;
+
+		return glm::vec3(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(0.0f, 1.0f - u.x)));
+	}
+}
\ No newline at end of file
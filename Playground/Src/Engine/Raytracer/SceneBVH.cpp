@@ -0,0 +1,189 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "SceneBVH.h"
+
+#include <unordered_map>
+
+#include "Engine/RenderObjects/SceneObject.h"
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	SceneBVH::SceneBVH()
+	{
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	SceneBVH::~SceneBVH()
+	{
+		Clear();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void SceneBVH::Update(const std::vector<SceneObject*>& vecObjects)
+	{
+		m_TopLevel.m_Stats.Reset();
+
+		bool bListChanged = vecObjects.size() != m_vecInstances.size();
+		for (uint32_t i = 0; i < vecObjects.size() && !bListChanged; ++i)
+		{
+			bListChanged = vecObjects[i] != m_vecInstances[i].pObject;
+		}
+
+		if (bListChanged)
+		{
+			// Bulk build is both faster & better than inserting everything one by one
+			if (m_TopLevel.IsEmpty())
+				Rebuild(vecObjects);
+			else
+				UpdateObjectList(vecObjects);
+		}
+
+		//--- Refit the paths of objects that moved
+		for (uint32_t i = 0; i < vecObjects.size(); ++i)
+		{
+			SceneInstance& instance = m_vecInstances[i];
+			const glm::mat4& matTransform = vecObjects[i]->m_pMeshInstanceData->transformMatrix;
+
+			if (matTransform == instance.matObjectToWorld)
+				continue;
+
+			instance.matObjectToWorld = matTransform;
+			instance.matWorldToObject = glm::inverse(matTransform);
+
+			if (instance.leaf != INVALID_INDEX)
+				m_TopLevel.Move(instance.leaf, TransformAABB(instance.localBounds, matTransform));
+		}
+
+		m_TopLevel.OptimizeTreelets();
+		m_UpdateStats = m_TopLevel.m_Stats;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool SceneBVH::InitInstance(SceneInstance& instance, const SceneObject* pObject)
+	{
+		instance.pObject = pObject;
+		instance.matObjectToWorld = pObject->m_pMeshInstanceData->transformMatrix;
+		instance.matWorldToObject = glm::inverse(instance.matObjectToWorld);
+		instance.leaf = INVALID_INDEX;
+
+		return pObject->GetLocalBounds(instance.localBounds);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void SceneBVH::Rebuild(const std::vector<SceneObject*>& vecObjects)
+	{
+		m_vecInstances.resize(vecObjects.size());
+
+		// Objects without CPU geometry stay out of the tree
+		std::vector<AABB> vecWorldBounds;
+		std::vector<uint32_t> vecObjectIndices;
+
+		for (uint32_t i = 0; i < vecObjects.size(); ++i)
+		{
+			SceneInstance& instance = m_vecInstances[i];
+			if (InitInstance(instance, vecObjects[i]))
+			{
+				vecWorldBounds.push_back(TransformAABB(instance.localBounds, instance.matObjectToWorld));
+				vecObjectIndices.push_back(i);
+			}
+		}
+
+		std::vector<uint32_t> vecLeaves;
+		m_TopLevel.Build(vecWorldBounds, vecLeaves);
+
+		for (uint32_t i = 0; i < vecLeaves.size(); ++i)
+		{
+			m_TopLevel.SetPrimitive(vecLeaves[i], vecObjectIndices[i]);
+			m_vecInstances[vecObjectIndices[i]].leaf = vecLeaves[i];
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Removes leaves of objects that left the list, inserts leaves for new ones & renumbers the rest. Only the
+	//--- inserted & removed objects touch the tree, surviving leaves just get their object index updated.
+	void SceneBVH::UpdateObjectList(const std::vector<SceneObject*>& vecObjects)
+	{
+		std::unordered_map<const SceneObject*, uint32_t> mapOldIndices;
+		for (uint32_t i = 0; i < m_vecInstances.size(); ++i)
+		{
+			mapOldIndices[m_vecInstances[i].pObject] = i;
+		}
+
+		std::vector<SceneInstance> vecInstances(vecObjects.size());
+		std::vector<bool> vecKept(m_vecInstances.size(), false);
+
+		for (uint32_t i = 0; i < vecObjects.size(); ++i)
+		{
+			auto it = mapOldIndices.find(vecObjects[i]);
+			if (it != mapOldIndices.end() && !vecKept[it->second])
+			{
+				vecKept[it->second] = true;
+				vecInstances[i] = m_vecInstances[it->second];
+
+				if (vecInstances[i].leaf != INVALID_INDEX)
+					m_TopLevel.SetPrimitive(vecInstances[i].leaf, i);
+
+				continue;
+			}
+
+			SceneInstance& instance = vecInstances[i];
+			if (InitInstance(instance, vecObjects[i]))
+				instance.leaf = m_TopLevel.Insert(i, TransformAABB(instance.localBounds, instance.matObjectToWorld));
+		}
+
+		for (uint32_t i = 0; i < m_vecInstances.size(); ++i)
+		{
+			if (!vecKept[i] && m_vecInstances[i].leaf != INVALID_INDEX)
+				m_TopLevel.Remove(m_vecInstances[i].leaf);
+		}
+
+		m_vecInstances.swap(vecInstances);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void SceneBVH::Clear()
+	{
+		m_TopLevel.Clear();
+		m_vecInstances.clear();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void SceneBVH::RunUpdateBenchmark(uint32_t instanceCount, uint32_t frameCount)
+	{
+		m_vecBenchmarkResults = DynamicBVH::RunBenchmark(instanceCount, frameCount);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	RayHit SceneBVH::RaycastClosest(const glm::vec3& origin, const glm::vec3& direction, float tMax) const
+	{
+		Ray ray(origin, direction, 0.0f, tMax);
+		RayHit hit;
+
+		RaycastClosest(ray, hit);
+		return hit;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool SceneBVH::RaycastClosest(Ray& ray, RayHit& hit) const
+	{
+		return m_TopLevel.Traverse(ray, [this, &hit](uint32_t instanceIndex, Ray& worldRay)
+		{
+			const SceneInstance& instance = m_vecInstances[instanceIndex];
+
+			// Object space direction stays unnormalized, so the hit t is directly comparable in world space
+			Ray localRay(glm::vec3(instance.matWorldToObject * glm::vec4(worldRay.origin, 1.0f)),
+						 glm::vec3(instance.matWorldToObject * glm::vec4(worldRay.direction, 0.0f)),
+						 worldRay.tMin, worldRay.tMax);
+
+			RayHit localHit;
+			if (!instance.pObject->IntersectLocal(localRay, localHit))
+				return false;
+
+			hit = localHit;
+			hit.objectIndex = instanceIndex;
+			worldRay.tMax = localRay.tMax;
+			return true;
+		});
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "BVH.h"
+#include "DynamicBVH.h"
+
+class SceneObject;
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct SceneInstance
+	{
+		const SceneObject*	pObject;
+		glm::mat4			matObjectToWorld;
+		glm::mat4			matWorldToObject;
+		AABB				localBounds;
+		uint32_t			leaf;				// Top level leaf, INVALID_INDEX for objects without CPU geometry
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Two level CPU acceleration structure over the scene objects. The top level is a DynamicBVH over instance world
+	//--- bounds, the bottom level is each object's own BVH, reached through SceneObject::IntersectLocal. Moved objects
+	//--- refit their path to the root, added & removed objects get inserted & removed in place. Main thread only.
+	class SceneBVH
+	{
+	public:
+		SceneBVH();
+		~SceneBVH();
+
+		// Top level work scales with the number of changed objects, call once per frame after transforms got updated
+		void									Update(const std::vector<SceneObject*>& vecObjects);
+		void									Clear();
+
+		// Closest hit along origin + t * direction. objectIndex is the index into the vector handed to Update.
+		RayHit									RaycastClosest(const glm::vec3& origin, const glm::vec3& direction, float tMax = FLT_MAX) const;
+		bool									RaycastClosest(Ray& ray, RayHit& hit) const;
+
+		// DynamicBVH::RunBenchmark over synthetic instances, results kept for the UI
+		void									RunUpdateBenchmark(uint32_t instanceCount, uint32_t frameCount);
+
+	private:
+		void									Rebuild(const std::vector<SceneObject*>& vecObjects);
+		void									UpdateObjectList(const std::vector<SceneObject*>& vecObjects);
+		bool									InitInstance(SceneInstance& instance, const SceneObject* pObject);
+
+	public:
+		DynamicBVHStats							m_UpdateStats;				// Top level work done by the last Update
+		std::vector<DynamicBVHBenchmarkResult>	m_vecBenchmarkResults;
+
+	private:
+		DynamicBVH								m_TopLevel;
+		std::vector<SceneInstance>				m_vecInstances;
+	};
+}
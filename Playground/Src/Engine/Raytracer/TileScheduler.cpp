@@ -0,0 +1,187 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "TileScheduler.h"
+
+#include <chrono>
+
+#include "Engine/Helpers/JobSystem.h"
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	TileScheduler::TileScheduler()
+	{
+		m_uiTileSize = 32;
+		m_uiThreadCount = 0;
+		m_uiActiveThreads = 0;
+		m_uiTilesWidth = 0;
+		m_uiTilesHeight = 0;
+		m_uiTilesSize = 0;
+		m_uiTilesStolen = 0;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	TileScheduler::~TileScheduler()
+	{
+		m_vecQueues.clear();
+		m_vecTiles.clear();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t TileScheduler::ComputeTileSize(size_t cacheBytes, size_t bytesPerPixel)
+	{
+		// Leave half the cache for BVH nodes & triangles touched while tracing the tile
+		const size_t budget = cacheBytes / 2;
+
+		uint32_t size = 8;
+		while (size < 128 && static_cast<size_t>(size * 2) * (size * 2) * bytesPerPixel <= budget)
+		{
+			size *= 2;
+		}
+
+		return size;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	const std::vector<Tile>& TileScheduler::BuildTiles(uint32_t width, uint32_t height)
+	{
+		if (width == m_uiTilesWidth && height == m_uiTilesHeight && m_uiTileSize == m_uiTilesSize)
+			return m_vecTiles;
+
+		//--- Scanline order, so that each thread starts out on a spatially coherent block
+		m_vecTiles.clear();
+		for (uint32_t y = 0; y < height; y += m_uiTileSize)
+		{
+			for (uint32_t x = 0; x < width; x += m_uiTileSize)
+			{
+				Tile tile;
+				tile.x = x;
+				tile.y = y;
+				tile.width = std::min(m_uiTileSize, width - x);
+				tile.height = std::min(m_uiTileSize, height - y);
+				tile.index = static_cast<uint32_t>(m_vecTiles.size());
+				m_vecTiles.push_back(tile);
+			}
+		}
+
+		m_uiTilesWidth = width;
+		m_uiTilesHeight = height;
+		m_uiTilesSize = m_uiTileSize;
+
+		return m_vecTiles;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool TileScheduler::Execute(uint32_t width, uint32_t height, const std::function<void(const Tile&, uint32_t)>& tileFunc,
+								const std::atomic<bool>* pCancel)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		JobSystem& jobSystem = JobSystem::getInstance();
+		const uint32_t nThreads = m_uiThreadCount == 0 ? jobSystem.GetThreadCount() : std::min(m_uiThreadCount, jobSystem.GetThreadCount());
+
+		BuildTiles(width, height);
+
+		const uint32_t nTiles = static_cast<uint32_t>(m_vecTiles.size());
+
+		if (m_vecQueues.size() < nThreads)
+		{
+			m_vecQueues.resize(nThreads);
+			for (std::unique_ptr<WorkerQueue>& pQueue : m_vecQueues)
+			{
+				if (!pQueue)
+					pQueue = std::make_unique<WorkerQueue>();
+			}
+		}
+
+		// Contiguous runs, stored reversed so that popping the back walks each run front to back
+		const uint32_t tilesPerThread = (nTiles + nThreads - 1) / nThreads;
+		for (uint32_t t = 0; t < nThreads; ++t)
+		{
+			std::deque<uint32_t>& deque = m_vecQueues[t]->deque;
+			deque.clear();
+
+			const uint32_t first = std::min(nTiles, t * tilesPerThread);
+			const uint32_t last = std::min(nTiles, first + tilesPerThread);
+			for (uint32_t i = last; i > first; --i)
+				deque.push_back(i - 1);
+		}
+
+		m_uiTilesStolen = 0;
+		m_uiActiveThreads = nThreads;
+
+		//--- Calling thread is worker 0
+		TaskGroup group;
+		for (uint32_t t = 1; t < nThreads; ++t)
+		{
+			jobSystem.Run(&group, [this, t, &tileFunc, pCancel]() { WorkerLoop(t, tileFunc, pCancel); });
+		}
+
+		WorkerLoop(0, tileFunc, pCancel);
+		jobSystem.Wait(&group);
+
+		const auto endTime = std::chrono::high_resolution_clock::now();
+
+		m_Stats.tileCount = nTiles;
+		m_Stats.tilesStolen = m_uiTilesStolen;
+		m_Stats.threadCount = nThreads;
+		m_Stats.timeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+		m_Stats.bCancelled = pCancel && pCancel->load(std::memory_order_relaxed);
+
+		return !m_Stats.bCancelled;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool TileScheduler::PopLocal(uint32_t worker, uint32_t& tileIndex)
+	{
+		WorkerQueue& queue = *m_vecQueues[worker];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.deque.empty())
+			return false;
+
+		tileIndex = queue.deque.back();
+		queue.deque.pop_back();
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool TileScheduler::Steal(uint32_t thief, uint32_t& tileIndex)
+	{
+		const uint32_t nQueues = m_uiActiveThreads;
+
+		// Start at the neighbour, so thieves spread out over victims instead of all hitting queue 0
+		for (uint32_t i = 1; i < nQueues; ++i)
+		{
+			WorkerQueue& victim = *m_vecQueues[(thief + i) % nQueues];
+
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.deque.empty())
+				continue;
+
+			// Take from the far end of the victim's run, away from where the owner is working
+			tileIndex = victim.deque.front();
+			victim.deque.pop_front();
+
+			m_uiTilesStolen.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		return false;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void TileScheduler::WorkerLoop(uint32_t worker, const std::function<void(const Tile&, uint32_t)>& tileFunc, const std::atomic<bool>* pCancel)
+	{
+		uint32_t tileIndex;
+
+		while (!(pCancel && pCancel->load(std::memory_order_relaxed)))
+		{
+			// No tiles are ever added during Execute, so once the local pop & all steals fail, we are done
+			if (!PopLocal(worker, tileIndex) && !Steal(worker, tileIndex))
+				break;
+
+			tileFunc(m_vecTiles[tileIndex], worker);
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <deque>
+
+namespace Raytracer
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct Tile
+	{
+		uint32_t	x;
+		uint32_t	y;
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	index;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct TileSchedulerStats
+	{
+		TileSchedulerStats() { tileCount = 0; tilesStolen = 0; threadCount = 0; timeMs = 0.0f; bCancelled = false; }
+
+		uint32_t	tileCount;
+		uint32_t	tilesStolen;
+		uint32_t	threadCount;
+		float		timeMs;
+		bool		bCancelled;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Splits an image into tiles & runs them on the JobSystem workers. Every participating thread owns a deque
+	//--- seeded with a contiguous run of tiles; it pops from the back of its own deque and, once empty, steals from
+	//--- the front of the others. Cheap sky tiles therefore never leave a core idle while the mesh tiles are pending.
+	class TileScheduler
+	{
+	public:
+		TileScheduler();
+		~TileScheduler();
+
+		// Largest power of two tile edge whose per-tile working set fits in half of cacheBytes, clamped to [8, 128]
+		static uint32_t							ComputeTileSize(size_t cacheBytes, size_t bytesPerPixel);
+
+		void									SetTileSize(uint32_t size)		{ m_uiTileSize = std::max(1u, size); }
+		void									SetThreadCount(uint32_t count)	{ m_uiThreadCount = count; }		// 0 = all JobSystem threads
+		inline uint32_t							GetTileSize() const				{ return m_uiTileSize; }
+
+		// Splits width x height into tiles in scanline order. Tile indices stay stable until size or tile size change.
+		const std::vector<Tile>&				BuildTiles(uint32_t width, uint32_t height);
+
+		// Runs tileFunc(tile, threadIndex) over all tiles. Returns false if pCancel got raised before all tiles ran.
+		bool									Execute(uint32_t width, uint32_t height, const std::function<void(const Tile&, uint32_t)>& tileFunc,
+														const std::atomic<bool>* pCancel);
+
+		// Tiles handed out in the last Execute call
+		inline const std::vector<Tile>&			GetTiles() const { return m_vecTiles; }
+
+	private:
+		struct WorkerQueue
+		{
+			std::mutex							mutex;
+			std::deque<uint32_t>				deque;
+		};
+
+		bool									PopLocal(uint32_t worker, uint32_t& tileIndex);
+		bool									Steal(uint32_t thief, uint32_t& tileIndex);
+		void									WorkerLoop(uint32_t worker, const std::function<void(const Tile&, uint32_t)>& tileFunc, const std::atomic<bool>* pCancel);
+
+	public:
+		TileSchedulerStats						m_Stats;
+
+	private:
+		uint32_t								m_uiTileSize;
+		uint32_t								m_uiThreadCount;
+		uint32_t								m_uiActiveThreads;
+		uint32_t								m_uiTilesWidth;
+		uint32_t								m_uiTilesHeight;
+		uint32_t								m_uiTilesSize;
+
+		std::vector<Tile>						m_vecTiles;
+		std::vector<std::unique_ptr<WorkerQueue>> m_vecQueues;
+		std::atomic<uint32_t>					m_uiTilesStolen;
+	};
+}
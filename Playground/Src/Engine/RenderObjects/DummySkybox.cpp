@@ -9,8 +9,8 @@ DummySkybox::DummySkybox()
 	
 	m_vkVertexBuffer = VK_NULL_HANDLE;
 	m_vkIndexBuffer = VK_NULL_HANDLE;
-	m_vkVertexBufferMemory = VK_NULL_HANDLE;
-	m_vkIndexBufferMemory = VK_NULL_HANDLE;
+	m_pVertexAllocation = nullptr;
+	m_pIndexAllocation = nullptr;
 
 }
 
@@ -79,37 +79,20 @@ void DummySkybox::CreateVertexBuffer(VulkanDevice* pDevice)
 	// Get the size of buffer needed for vertices
 	VkDeviceSize bufferSize = 8 * sizeof(App::VertexP);
 
-	// Temporary buffer to "stage" vertex data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	// Create buffer & allocate memory to it!
-	pDevice->CreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		&stagingBufferMemory);
-
-	//-- MAP MEMORY TO VERTEX BUFFER
-	void* data;																					// 1. Create pointer to a point in normal memory
-	vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);		// 2. Map the vertex buffer memory to that point
-	memcpy(data, m_vecVertices.data(), (size_t)bufferSize);										// 3. Copy memory from vertices vector to the point
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);								// 4. Unmap the vertex buffer memory
-
 	// Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER_BIT)
 	// Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU & accessible by it & not CPU!
+	// Only bound by handle while recording, so defragmentation may move it
 	pDevice->CreateBuffer(bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		&m_vkVertexBuffer,
-		&m_vkVertexBufferMemory);
-
-	// Copy staging buffer to vertex buffer on GPU using Command buffer!
-	pDevice->CopyBuffer(stagingBuffer, m_vkVertexBuffer, bufferSize);
+		&m_pVertexAllocation,
+		"SKYBOX_VB",
+		[this](VkBuffer buffer) { m_vkVertexBuffer = buffer; });
 
-	// Clean up staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+	// Staged in the uploader's ring & copied with its next batch, draws on the graphics queue are submitted after it
+	pDevice->m_pUploader->UploadBuffer(m_vkVertexBuffer, 0, m_vecVertices.data(), bufferSize);
+	pDevice->m_pUploader->Submit();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -118,43 +101,26 @@ void DummySkybox::CreateIndexBuffer(VulkanDevice* pDevice)
 	// Get size of buffer needed for indices
 	VkDeviceSize bufferSize = 36 * sizeof(uint32_t);
 
-	// Temporary buffer to "stage" index data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	pDevice->CreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		&stagingBufferMemory);
-
-	// Map memory to Index buffer
-	void* data;
-	vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, m_vecIndices.data(), (size_t)bufferSize);
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);
-
 	// Create buffer for index data on GPU access only area
 	pDevice->CreateBuffer(	bufferSize,
 							VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
 							VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 							&m_vkIndexBuffer,
-							&m_vkIndexBufferMemory);
-
-	// Copy from staging buffer to GPU access buffer
-	pDevice->CopyBuffer(stagingBuffer, m_vkIndexBuffer, bufferSize);
+							&m_pIndexAllocation,
+							"SKYBOX_IB",
+							[this](VkBuffer buffer) { m_vkIndexBuffer = buffer; });
 
-	// Clean up staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+	// Through the uploader like the vertices
+	pDevice->m_pUploader->UploadBuffer(m_vkIndexBuffer, 0, m_vecIndices.data(), bufferSize);
+	pDevice->m_pUploader->Submit();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void DummySkybox::Cleanup(VulkanDevice* pDevice)
 {
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, m_vkVertexBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, m_vkVertexBufferMemory, nullptr);
+	pDevice->DestroyBuffer(m_vkVertexBuffer, m_pVertexAllocation);
+	m_pVertexAllocation = nullptr;
 
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, m_vkIndexBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, m_vkIndexBufferMemory, nullptr);
+	pDevice->DestroyBuffer(m_vkIndexBuffer, m_pIndexAllocation);
+	m_pIndexAllocation = nullptr;
 }
@@ -22,7 +22,7 @@ private:
 	std::vector<uint32_t>				m_vecIndices;
 	VkBuffer							m_vkVertexBuffer;
 	VkBuffer							m_vkIndexBuffer;
-	VkDeviceMemory						m_vkVertexBufferMemory;
-	VkDeviceMemory						m_vkIndexBufferMemory;
+	VulkanAllocation*					m_pVertexAllocation;		// Movable, DefragmentMemory updates the handles above
+	VulkanAllocation*					m_pIndexAllocation;
 };
 
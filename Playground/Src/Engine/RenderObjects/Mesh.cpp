@@ -66,23 +66,6 @@ void Mesh::CreateVertexBuffer(VulkanDevice* pDevice, const std::vector<App::Vert
 	// Get the size of buffer needed for vertices
 	VkDeviceSize bufferSize = m_uiVertexCount * sizeof(App::VertexPNTBT);
 
-	// Temporary buffer to "stage" vertex data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	// Create buffer & allocate memory to it!
-	pDevice->CreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		&stagingBufferMemory);
-
-	//-- MAP MEMORY TO VERTEX BUFFER
-	void* data;																					// 1. Create pointer to a point in normal memory
-	vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);		// 2. Map the vertex buffer memory to that point
-	memcpy(data, vertices.data(), (size_t)bufferSize);											// 3. Copy memory from vertices vector to the point
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);								// 4. Unmap the vertex buffer memory
-
 	// Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER_BIT)
 	// Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU & accessible by it & not CPU!
 	pDevice->CreateBuffer(	bufferSize,
@@ -91,12 +74,9 @@ void Mesh::CreateVertexBuffer(VulkanDevice* pDevice, const std::vector<App::Vert
 							&m_vkVertexBuffer,
 							&m_vkVertexBufferMemory);
 
-	// Copy staging buffer to vertex buffer on GPU using Command buffer!
-	pDevice->CopyBuffer(stagingBuffer, m_vkVertexBuffer, bufferSize);
-
-	// Clean up staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+	// Staged in the uploader's ring & copied with its next batch, draws on the graphics queue are submitted after it
+	pDevice->m_pUploader->UploadBuffer(m_vkVertexBuffer, 0, vertices.data(), bufferSize);
+	pDevice->m_pUploader->Submit();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -105,23 +85,6 @@ void Mesh::CreateVertexBuffer(VulkanDevice* pDevice, const std::vector<App::Vert
 	// Get the size of buffer needed for vertices
 	VkDeviceSize bufferSize = m_uiVertexCount * sizeof(App::VertexPNT);
 
-	// Temporary buffer to "stage" vertex data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	// Create buffer & allocate memory to it!
-	pDevice->CreateBuffer(	bufferSize,
-							VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-							&stagingBuffer,
-							&stagingBufferMemory);
-
-	//-- MAP MEMORY TO VERTEX BUFFER
-	void* data;																					// 1. Create pointer to a point in normal memory
-	vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);		// 2. Map the vertex buffer memory to that point
-	memcpy(data, vertices.data(), (size_t)bufferSize);											// 3. Copy memory from vertices vector to the point
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);								// 4. Unmap the vertex buffer memory
-
 	// Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER_BIT)
 	// Buffer memory is to be DEVICE_LOCAL_BIT meaning memory is on the GPU & accessible by it & not CPU!
 	pDevice->CreateBuffer(	bufferSize,
@@ -130,12 +93,9 @@ void Mesh::CreateVertexBuffer(VulkanDevice* pDevice, const std::vector<App::Vert
 							&m_vkVertexBuffer,
 							&m_vkVertexBufferMemory);
 
-	// Copy staging buffer to vertex buffer on GPU using Command buffer!
-	pDevice->CopyBuffer(stagingBuffer, m_vkVertexBuffer, bufferSize);
-
-	// Clean up staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+	// Same as above, staged in the uploader's ring
+	pDevice->m_pUploader->UploadBuffer(m_vkVertexBuffer, 0, vertices.data(), bufferSize);
+	pDevice->m_pUploader->Submit();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -144,22 +104,6 @@ void Mesh::CreateIndexBuffer(VulkanDevice* pDevice, const std::vector<uint32_t>&
 	// Get size of buffer needed for indices
 	VkDeviceSize bufferSize = m_uiIndexCount * sizeof(uint32_t);
 
-	// Temporary buffer to "stage" index data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	pDevice->CreateBuffer(bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer,
-		&stagingBufferMemory);
-
-	// Map memory to Index buffer
-	void* data;
-	vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);
-
 	// Create buffer for index data on GPU access only area
 	pDevice->CreateBuffer(bufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
@@ -167,12 +111,9 @@ void Mesh::CreateIndexBuffer(VulkanDevice* pDevice, const std::vector<uint32_t>&
 		&m_vkIndexBuffer,
 		&m_vkIndexBufferMemory);
 
-	// Copy from staging buffer to GPU access buffer
-	pDevice->CopyBuffer(stagingBuffer, m_vkIndexBuffer, bufferSize);
-
-	// Clean up staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+	// Through the uploader like the vertices
+	pDevice->m_pUploader->UploadBuffer(m_vkIndexBuffer, 0, indices.data(), bufferSize);
+	pDevice->m_pUploader->Submit();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -6,6 +6,8 @@
 #include "Engine/Renderer/VulkanSwapChain.h"
 #include "Engine/Renderer/VulkanMaterial.h"
 #include "Engine/Renderer/VulkanTexture2D.h"
+#include "Engine/Renderer/VulkanTextureCache.h"
+#include "Engine/Renderer/VulkanMaterialTable.h"
 #include "Engine/Renderer/VulkanGraphicsPipeline.h"
 
 #include "Engine/ImGui/imgui.h"
@@ -31,10 +33,12 @@ Model::Model(ModelType typeID)
 	m_fAutoRotateSpeed = 1.0f;
 	
 	m_mapTextures.clear();
+	m_ORMSources = {};
 
 	m_vkDescriptorPool = VK_NULL_HANDLE;
 	m_vkDescriptorSetLayout = VK_NULL_HANDLE;
 	m_vecDescriptorSet.clear();
+	m_uiTrackedSetCount = 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -129,24 +133,21 @@ void Model::SetDefaultValues(aiTextureType eType)
 
 		case aiTextureType_DIFFUSE_ROUGHNESS:
 		{
-			m_pShaderUniforms->shaderData.hasTextureRMO.r = 0.0f;
-			m_mapTextures.emplace("MissingRoughness.png", TextureType::TEXTURE_ROUGHNESS);
+			m_pShaderUniforms->shaderData.hasTextureORM.g = 0.0f;
 			LOG_ERROR("Roughness texture not found, using default texture!");
 			break;
 		}
 		
 		case aiTextureType_METALNESS:
 		{
-			m_pShaderUniforms->shaderData.hasTextureRMO.g = 0.0f;
-			m_mapTextures.emplace("MissingMetalness.png", TextureType::TEXTURE_METALNESS);
+			m_pShaderUniforms->shaderData.hasTextureORM.b = 0.0f;
 			LOG_ERROR("Metalness texture not found, using default texture!");
 			break;
 		}
 		
 		case aiTextureType_AMBIENT_OCCLUSION:
 		{
-			m_pShaderUniforms->shaderData.hasTextureRMO.b = 0.0f;
-			m_mapTextures.emplace("MissingAO.png", TextureType::TEXTURE_AO);
+			m_pShaderUniforms->shaderData.hasTextureORM.r = 0.0f;
 			LOG_ERROR("AO texture not found, using default texture!");
 			break;
 		}
@@ -195,22 +196,25 @@ void Model::ExtractTextureFromMaterial(aiMaterial* pMaterial, aiTextureType eTyp
 
 					case aiTextureType_DIFFUSE_ROUGHNESS:
 					{
-						m_pShaderUniforms->shaderData.hasTextureRMO.r = 1.0f;
-						m_mapTextures.emplace(fileName, TextureType::TEXTURE_ROUGHNESS);
+						m_pShaderUniforms->shaderData.hasTextureORM.g = 1.0f;
+						if (m_ORMSources.roughness.empty())
+							m_ORMSources.roughness = fileName;
 						break;
 					}
 					
 					case aiTextureType_METALNESS:
 					{
-						m_pShaderUniforms->shaderData.hasTextureRMO.g = 1.0f;
-						m_mapTextures.emplace(fileName, TextureType::TEXTURE_METALNESS);
+						m_pShaderUniforms->shaderData.hasTextureORM.b = 1.0f;
+						if (m_ORMSources.metalness.empty())
+							m_ORMSources.metalness = fileName;
 						break;
 					}
 					
 					case aiTextureType_AMBIENT_OCCLUSION:
 					{
-						m_pShaderUniforms->shaderData.hasTextureRMO.b = 1.0f;
-						m_mapTextures.emplace(fileName, TextureType::TEXTURE_AO);
+						m_pShaderUniforms->shaderData.hasTextureORM.r = 1.0f;
+						if (m_ORMSources.occlusion.empty())
+							m_ORMSources.occlusion = fileName;
 						break;
 					}
 
@@ -249,13 +253,24 @@ void Model::LoadMaterials(VulkanDevice* pDevice, const aiScene* scene)
 		ExtractTextureFromMaterial(material, aiTextureType_AMBIENT_OCCLUSION);
 	}
 
+	// Roughness, metalness & AO are single channel, sample them as one ORM texture instead of three RGBA8 ones
+	m_mapTextures.emplace(Texture::ImportORMTexture(m_ORMSources), TextureType::TEXTURE_ORM);
+
 	m_pMaterial = new VulkanMaterial();
 
-	std::map<std::string, TextureType>::iterator iter = m_mapTextures.begin();
-	for (; iter != m_mapTextures.end(); ++iter)
-	{
-		m_pMaterial->LoadTexture(pDevice, iter->first, iter->second);
-	}
+	m_pMaterial->LoadTextures(pDevice, m_mapTextures);
+
+	// Shaders look the material up in VulkanMaterialTable through the ID in the uniforms
+	const ShaderData& shaderData = m_pShaderUniforms->shaderData;
+
+	MaterialGPUData constants;
+	constants.albedoColor = shaderData.albedoColor;
+	constants.emissiveColor = shaderData.emissiveColor;
+	constants.ao = shaderData.ao;
+	constants.roughness = shaderData.roughness;
+	constants.metalness = shaderData.metalness;
+
+	m_pShaderUniforms->shaderData.materialID = m_pMaterial->RegisterBindless(pDevice, constants);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -347,11 +362,33 @@ void Model::Update(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, float dt)
 
 	// Update object ID
 	m_pShaderUniforms->shaderData.objectID = static_cast<uint32_t>(m_eType);
+
+	// Projected size of the model's scaled unit extent, drives which mips of its textures stay resident
+	const Camera& camera = Camera::getInstance();
+	const float distance = std::max(0.01f, glm::length(m_vecPosition - camera.m_vecCameraPosition));
+	const float size = std::max(m_vecScale.x, std::max(m_vecScale.y, m_vecScale.z));
+	const float screenExtent = 0.5f * camera.m_iWindowHeight * camera.m_matProjection[1][1] * size / distance;
+
+	std::map<TextureType, VulkanTexture2D*>::iterator iter = m_pMaterial->m_mapTextures.begin();
+	for (; iter != m_pMaterial->m_mapTextures.end(); ++iter)
+	{
+		VulkanTextureCache::getInstance().RequestMip(iter->second, screenExtent);
+	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void Model::Render (VulkanDevice* pDevice, VulkanGraphicsPipeline* pPipeline, uint32_t index)
 {
+	// Per model uniforms, bound once. Materials come from set 1, bound once per frame by the renderer
+	vkCmdBindDescriptorSets(pDevice->m_vecCommandBufferGraphics[index],
+							VK_PIPELINE_BIND_POINT_GRAPHICS,
+							pPipeline->m_vkPipelineLayout,
+							0,
+							1,
+							&(m_vecDescriptorSet[index]),
+							0,
+							nullptr);
+
 	for (int i = 0; i < m_vecMeshes.size(); ++i)
 	{
 
@@ -363,16 +400,6 @@ void Model::Render (VulkanDevice* pDevice, VulkanGraphicsPipeline* pPipeline, ui
 		// bind mesh index buffer, with zero offset & using uint32_t type
 		vkCmdBindIndexBuffer(pDevice->m_vecCommandBufferGraphics[index], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-		// bind descriptor sets
-		vkCmdBindDescriptorSets(pDevice->m_vecCommandBufferGraphics[index],
-								VK_PIPELINE_BIND_POINT_GRAPHICS,
-								pPipeline->m_vkPipelineLayout,
-								0,
-								1,
-								&(m_vecDescriptorSet[index]),
-								0,
-								nullptr);
-
 		// Execute pipeline
 		vkCmdDrawIndexed(pDevice->m_vecCommandBufferGraphics[index], m_vecMeshes[i].m_uiIndexCount, 1, 0, 0, 0);
 	}
@@ -383,20 +410,16 @@ void Model::SetupDescriptors(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 {
 	m_pShaderUniforms->CreateBuffers(pDevice, pSwapchain);
 
-	// *** Create Descriptor pool
-	std::array<VkDescriptorPoolSize, 2> arrDescriptorPoolSize = {};
+	// *** Create Descriptor pool, material textures & constants live in VulkanMaterialTable so only the UBOs are left
+	std::array<VkDescriptorPoolSize, 1> arrDescriptorPoolSize = {};
 
 	//-- Uniform Buffer
 	arrDescriptorPoolSize[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 	arrDescriptorPoolSize[0].descriptorCount = static_cast<uint32_t>(pSwapchain->m_vecSwapchainImages.size());
 
-	//-- Texture samplers
-	arrDescriptorPoolSize[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorPoolSize[1].descriptorCount = static_cast<uint32_t>(m_mapTextures.size());
-
 	VkDescriptorPoolCreateInfo poolCreateInfo = {};
 	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCreateInfo.maxSets = static_cast<uint32_t>(m_mapTextures.size()) + static_cast<uint32_t>(pSwapchain->m_vecSwapchainImages.size());
+	poolCreateInfo.maxSets = static_cast<uint32_t>(pSwapchain->m_vecSwapchainImages.size());
 	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(arrDescriptorPoolSize.size());
 	poolCreateInfo.pPoolSizes = arrDescriptorPoolSize.data();
 
@@ -408,7 +431,7 @@ void Model::SetupDescriptors(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 		LOG_DEBUG("Successfully created Descriptor Pool");
 
 	// *** Create Descriptor Set Layout
-	std::array<VkDescriptorSetLayoutBinding, 7> arrDescriptorSetLayoutBindings = {};
+	std::array<VkDescriptorSetLayoutBinding, 1> arrDescriptorSetLayoutBindings = {};
 
 	//-- Uniform Buffer
 	arrDescriptorSetLayoutBindings[0].binding = 0;																// binding point in shader, binding = ?
@@ -417,48 +440,6 @@ void Model::SetupDescriptors(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 	arrDescriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;	// Shader stage to bind to
 	arrDescriptorSetLayoutBindings[0].pImmutableSamplers = nullptr;												// For textures!
 
-	//-- BaseColor Texture
-	arrDescriptorSetLayoutBindings[1].binding = 1;
-	arrDescriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;						
-	arrDescriptorSetLayoutBindings[1].descriptorCount = 1;														
-	arrDescriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;									
-	arrDescriptorSetLayoutBindings[1].pImmutableSamplers = nullptr;
-
-	//-- Metalness Texture
-	arrDescriptorSetLayoutBindings[2].binding = 2;
-	arrDescriptorSetLayoutBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorSetLayoutBindings[2].descriptorCount = 1;
-	arrDescriptorSetLayoutBindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	arrDescriptorSetLayoutBindings[2].pImmutableSamplers = nullptr;
-
-	//-- Normal Texture
-	arrDescriptorSetLayoutBindings[3].binding = 3;
-	arrDescriptorSetLayoutBindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorSetLayoutBindings[3].descriptorCount = 1;
-	arrDescriptorSetLayoutBindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	arrDescriptorSetLayoutBindings[3].pImmutableSamplers = nullptr;
-
-	//-- Roughness Texture
-	arrDescriptorSetLayoutBindings[4].binding = 4;
-	arrDescriptorSetLayoutBindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorSetLayoutBindings[4].descriptorCount = 1;
-	arrDescriptorSetLayoutBindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	arrDescriptorSetLayoutBindings[4].pImmutableSamplers = nullptr;
-
-	//-- AO Texture
-	arrDescriptorSetLayoutBindings[5].binding = 5;
-	arrDescriptorSetLayoutBindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorSetLayoutBindings[5].descriptorCount = 1;
-	arrDescriptorSetLayoutBindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	arrDescriptorSetLayoutBindings[5].pImmutableSamplers = nullptr;
-
-	//-- Emission Texture
-	arrDescriptorSetLayoutBindings[6].binding = 6;
-	arrDescriptorSetLayoutBindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorSetLayoutBindings[6].descriptorCount = 1;
-	arrDescriptorSetLayoutBindings[6].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	arrDescriptorSetLayoutBindings[6].pImmutableSamplers = nullptr;
-
 	VkDescriptorSetLayoutCreateInfo descSetlayoutCreateInfo = {};
 	descSetlayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descSetlayoutCreateInfo.bindingCount = arrDescriptorSetLayoutBindings.size();
@@ -500,7 +481,7 @@ void Model::SetupDescriptors(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 		VkDescriptorBufferInfo ubBufferInfo = {};
 		ubBufferInfo.buffer = m_pShaderUniforms->vecBuffer[i];			// buffer to get data from
 		ubBufferInfo.offset = 0;											// position of start of data
-		ubBufferInfo.range = sizeof(ShaderUniforms);						// size of data
+		ubBufferInfo.range = sizeof(ShaderData);							// size of data
 
 		// Data about connection between binding & buffer
 		VkWriteDescriptorSet ubSetWrite = {};
@@ -511,110 +492,13 @@ void Model::SetupDescriptors(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 		ubSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;		// type of descriptor
 		ubSetWrite.descriptorCount = 1;										// amount to update		
 		ubSetWrite.pBufferInfo = &ubBufferInfo;
-		
-		//-- Base Texture
-		VkDescriptorImageInfo albedoImageInfo = {};
-		albedoImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											// Image layout when in use
-		albedoImageInfo.imageView = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_ALBEDO)->m_vkTextureImageView;	// image to bind to set
-		albedoImageInfo.sampler = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_ALBEDO)->m_vkTextureSampler;		// sampler to use for the set
-
-		// Descriptor write info
-		VkWriteDescriptorSet albedoSetWrite = {};
-		albedoSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		albedoSetWrite.dstSet = m_vecDescriptorSet[i];
-		albedoSetWrite.dstBinding = 1;
-		albedoSetWrite.dstArrayElement = 0;
-		albedoSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		albedoSetWrite.descriptorCount = 1;
-		albedoSetWrite.pImageInfo = &albedoImageInfo;
-
-		//-- Metalness Texture
-		VkDescriptorImageInfo metalnessImageInfo = {};
-		metalnessImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											// Image layout when in use
-		metalnessImageInfo.imageView = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_METALNESS)->m_vkTextureImageView;	// image to bind to set
-		metalnessImageInfo.sampler = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_METALNESS)->m_vkTextureSampler;		// sampler to use for the set
-
-		// Descriptor write info
-		VkWriteDescriptorSet metalnessSetWrite = {};
-		metalnessSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		metalnessSetWrite.dstSet = m_vecDescriptorSet[i];
-		metalnessSetWrite.dstBinding = 2;
-		metalnessSetWrite.dstArrayElement = 0;
-		metalnessSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		metalnessSetWrite.descriptorCount = 1;
-		metalnessSetWrite.pImageInfo = &metalnessImageInfo;
-
-		//-- Normal Texture
-		VkDescriptorImageInfo normalImageInfo = {};
-		normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											// Image layout when in use
-		normalImageInfo.imageView = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_NORMAL)->m_vkTextureImageView;	// image to bind to set
-		normalImageInfo.sampler = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_NORMAL)->m_vkTextureSampler;		// sampler to use for the set
-
-		// Descriptor write info
-		VkWriteDescriptorSet normalSetWrite = {};
-		normalSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		normalSetWrite.dstSet = m_vecDescriptorSet[i];
-		normalSetWrite.dstBinding = 3;
-		normalSetWrite.dstArrayElement = 0;
-		normalSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		normalSetWrite.descriptorCount = 1;
-		normalSetWrite.pImageInfo = &normalImageInfo;
-
-		//-- Roughness Texture
-		VkDescriptorImageInfo roughnessImageInfo = {};
-		roughnessImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											// Image layout when in use
-		roughnessImageInfo.imageView = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_ROUGHNESS)->m_vkTextureImageView;	// image to bind to set
-		roughnessImageInfo.sampler = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_ROUGHNESS)->m_vkTextureSampler;		// sampler to use for the set
-
-		// Descriptor write info
-		VkWriteDescriptorSet roughnessSetWrite = {};
-		roughnessSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		roughnessSetWrite.dstSet = m_vecDescriptorSet[i];
-		roughnessSetWrite.dstBinding = 4;
-		roughnessSetWrite.dstArrayElement = 0;
-		roughnessSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		roughnessSetWrite.descriptorCount = 1;
-		roughnessSetWrite.pImageInfo = &roughnessImageInfo;
-
-		//-- AO Texture
-		VkDescriptorImageInfo AOImageInfo = {};
-		AOImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											// Image layout when in use
-		AOImageInfo.imageView = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_AO)->m_vkTextureImageView;		// image to bind to set
-		AOImageInfo.sampler = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_AO)->m_vkTextureSampler;			// sampler to use for the set
-
-		// Descriptor write info
-		VkWriteDescriptorSet AOSetWrite = {};
-		AOSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		AOSetWrite.dstSet = m_vecDescriptorSet[i];
-		AOSetWrite.dstBinding = 5;
-		AOSetWrite.dstArrayElement = 0;
-		AOSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		AOSetWrite.descriptorCount = 1;
-		AOSetWrite.pImageInfo = &AOImageInfo;
-
-		//-- Emission Texture
-		VkDescriptorImageInfo emissionImageInfo = {};
-		emissionImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											// Image layout when in use
-		emissionImageInfo.imageView = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_EMISSIVE)->m_vkTextureImageView;	// image to bind to set
-		emissionImageInfo.sampler = m_pMaterial->m_mapTextures.at(TextureType::TEXTURE_EMISSIVE)->m_vkTextureSampler;		// sampler to use for the set
-
-		// Descriptor write info
-		VkWriteDescriptorSet emissionSetWrite = {};
-		emissionSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		emissionSetWrite.dstSet = m_vecDescriptorSet[i];
-		emissionSetWrite.dstBinding = 6;
-		emissionSetWrite.dstArrayElement = 0;
-		emissionSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		emissionSetWrite.descriptorCount = 1;
-		emissionSetWrite.pImageInfo = &emissionImageInfo;
-
-		// List of Descriptor set writes
-		std::vector<VkWriteDescriptorSet> setWrites = { ubSetWrite, albedoSetWrite, metalnessSetWrite, normalSetWrite,
-														roughnessSetWrite, AOSetWrite, emissionSetWrite };
-		
+
 		// Update the descriptor sets with new buffer/binding info
-		vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+		vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &ubSetWrite, 0, nullptr);
 	}
+
+	m_uiTrackedSetCount = static_cast<uint32_t>(pSwapchain->m_vecSwapchainImages.size());
+	VulkanMaterialTable::getInstance().TrackModel(m_uiTrackedSetCount, static_cast<uint32_t>(m_vecMeshes.size()));
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -623,6 +507,9 @@ void Model::Cleanup(VulkanDevice* pDevice)
 	m_pShaderUniforms->Cleanup(pDevice);
 	m_pMaterial->Cleanup(pDevice);
 
+	VulkanMaterialTable::getInstance().UntrackModel(m_uiTrackedSetCount, static_cast<uint32_t>(m_vecMeshes.size()));
+	m_uiTrackedSetCount = 0;
+
 	std::vector<Mesh>::iterator iter = m_vecMeshes.begin();
 	for (; iter != m_vecMeshes.end(); iter++)
 	{
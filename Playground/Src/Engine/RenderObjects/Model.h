@@ -4,6 +4,7 @@
 #include "assimp/Importer.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
+#include "Engine/Texture/ChannelPacker.h"
 
 class VulkanDevice;
 class VulkanSwapChain;
@@ -31,12 +32,13 @@ struct ShaderData
 		albedoColor			= glm::vec4(1.0f);
 		emissiveColor		= glm::vec4(1,1,0,1);
 		hasTextureAEN		= glm::vec3(0, 0, 0);
-		hasTextureRMO		= glm::vec3(0, 0, 0);
+		hasTextureORM		= glm::vec3(0, 0, 0);
 
 		ao					= 0.0f;
 		roughness			= 0.5f;
 		metalness			= 0.5f;
 		objectID			= 1;
+		materialID			= 0xFFFFFFFF;
 	}
 
 	// Data Specific
@@ -48,11 +50,12 @@ struct ShaderData
 	alignas(16) glm::vec4				albedoColor;
 	alignas(16) glm::vec4				emissiveColor;
 	alignas(16) glm::vec3				hasTextureAEN;		// R-Albedo, G-Emissive, B-Normal
-	alignas(16) glm::vec3				hasTextureRMO;		// R-Roughness, G-Metalness, B-Occlusion
+	alignas(16) glm::vec3				hasTextureORM;		// R-Occlusion, G-Roughness, B-Metalness, same as the ORM texture
 	alignas(4)  float					ao;
 	alignas(4)	float					roughness;
 	alignas(4)	float					metalness;
 	alignas(4)	uint32_t				objectID;
+	alignas(4)	uint32_t				materialID;			// Index into VulkanMaterialTable, textures are sampled from its array
 };
 //---------------------------------------------------------------------------------------------------------------------
 struct ShaderUniforms
@@ -115,14 +118,16 @@ private:
 private:
 	std::vector<Mesh>					m_vecMeshes;
 	std::map<std::string, TextureType>	m_mapTextures;
+	Texture::ORMSources					m_ORMSources;						// Packed into one TEXTURE_ORM by LoadMaterials
 
 	ModelType							m_eType;
 	VulkanMaterial*						m_pMaterial;
+	uint32_t							m_uiTrackedSetCount;				// Sets reported to VulkanMaterialTable's stats
 
 public:
-	VkDescriptorPool					m_vkDescriptorPool;					// Pool for all descriptors.
-	VkDescriptorSetLayout				m_vkDescriptorSetLayout;			// combination of layouts of uniforms & samplers.
-	std::vector<VkDescriptorSet>		m_vecDescriptorSet;					// combination of sets of uniforms & samplers per swapchain image!
+	VkDescriptorPool					m_vkDescriptorPool;					// Pool for the uniform buffer sets.
+	VkDescriptorSetLayout				m_vkDescriptorSetLayout;			// Set 0, uniforms only. Pipelines take VulkanMaterialTable's layout as set 1.
+	std::vector<VkDescriptorSet>		m_vecDescriptorSet;					// uniforms set per swapchain image!
 
 	ShaderUniforms*						m_pShaderUniforms;
 
@@ -83,24 +83,40 @@ void RTXCube::CreateBottomLevelAS(VulkanDevice* pDevice)
 {
     m_pMeshData = new Vulkan::MeshData();
 
-    // 2. Create buffers for Mesh Data
+    // 2. Create buffers for Mesh Data, only read by the BLAS build below so defragmentation may move them, the callbacks
+    // keep the handles & instance addresses current. Device local, the data goes through the staging ring & the build is
+    // submitted to the same queue after it
+    auto onVertexBufferMoved = [this, pDevice](VkBuffer buffer)
+    {
+        m_pMeshData->vertexBuffer.buffer = buffer;
+        m_pMeshInstanceData->verticesAddress = Vulkan::GetBufferDeviceAddress(pDevice, buffer);
+    };
+
+    auto onIndexBufferMoved = [this, pDevice](VkBuffer buffer)
+    {
+        m_pMeshData->indexBuffer.buffer = buffer;
+        m_pMeshInstanceData->indicesAddress = Vulkan::GetBufferDeviceAddress(pDevice, buffer);
+    };
+
     // Create VB
     pDevice->CreateBufferAndCopyData(m_vecVertices.size() * sizeof(App::VertexP),
                                      VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                      &(m_pMeshData->vertexBuffer.buffer),
-                                     &(m_pMeshData->vertexBuffer.memory),
+                                     &(m_pMeshData->vertexBuffer.allocation),
                                      m_vecVertices.data(),
-                                     "BLAS_CUBE_VB");
+                                     "BLAS_CUBE_VB",
+                                     onVertexBufferMoved);
 
     // Create IB
     pDevice->CreateBufferAndCopyData(m_vecIndices.size() * sizeof(uint32_t),
                                      VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                      &(m_pMeshData->indexBuffer.buffer),
-                                     &(m_pMeshData->indexBuffer.memory),
+                                     &(m_pMeshData->indexBuffer.allocation),
                                      m_vecIndices.data(),
-                                     "BLAS_CUBE_IB");
+                                     "BLAS_CUBE_IB",
+                                     onIndexBufferMoved);
 
 
     // 3. Get Device addresses of buffers just created
@@ -157,7 +173,7 @@ void RTXCube::CreateBottomLevelAS(VulkanDevice* pDevice)
                           VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                           VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
                           &m_BottomLevelAS.buffer,
-                          &m_BottomLevelAS.memory,
+                          &m_BottomLevelAS.allocation,
                           "BLAS_CUBE");
 
     VkAccelerationStructureCreateInfoKHR accelStructCreateInfo = {};
@@ -180,7 +196,7 @@ void RTXCube::CreateBottomLevelAS(VulkanDevice* pDevice)
                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                           &scratchBuffer.handle,
-                          &scratchBuffer.memory,
+                          &scratchBuffer.allocation,
                           "BLAS_SCRATCH_BUFFER");
 
     scratchBuffer.deviceAddress = Vulkan::GetBufferDeviceAddress(pDevice, scratchBuffer.handle);
@@ -204,7 +220,7 @@ void RTXCube::CreateBottomLevelAS(VulkanDevice* pDevice)
     std::vector<VkAccelerationStructureBuildRangeInfoKHR*> vecAccelStructRangeInfos;
     vecAccelStructRangeInfos.push_back(&accelStructBuildRangeInfo);
 
-    VkCommandBuffer commandBuffer = pDevice->BeginCommandBuffer();
+    VkCommandBuffer commandBuffer = pDevice->BeginComputeCommandBuffer();
 
     // Accel Struct needs to be built on Device!
     vkCmdBuildAccelerationStructuresKHR(commandBuffer,
@@ -212,7 +228,8 @@ void RTXCube::CreateBottomLevelAS(VulkanDevice* pDevice)
                                         &accelStructBuildGeomInfo2,
                                         vecAccelStructRangeInfos.data());
 
-    pDevice->EndAndSubmitCommandBuffer(commandBuffer);
+    // Async compute when there's a queue for it, graphics waits for the build on the GPU
+    const uint64_t computeValue = pDevice->SubmitComputeCommandBuffer(commandBuffer, 0);
 
     // 9. Finally, get hold of device address of BLAS!
     VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
@@ -220,6 +237,6 @@ void RTXCube::CreateBottomLevelAS(VulkanDevice* pDevice)
     accelerationDeviceAddressInfo.accelerationStructure = m_BottomLevelAS.handle;
     m_BottomLevelAS.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(pDevice->m_vkLogicalDevice, &accelerationDeviceAddressInfo);
 
-    // 10. Scratch buffer no lonoger needed!
-    scratchBuffer.Cleanup(pDevice);
+    // 10. Scratch buffer no lonoger needed, once the build is done with it!
+    pDevice->DestroyBufferAfterCompute(scratchBuffer.handle, scratchBuffer.allocation, computeValue);
 }
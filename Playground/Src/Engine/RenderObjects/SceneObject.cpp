@@ -2,6 +2,8 @@
 #include "PlaygroundHeaders.h"
 #include "SceneObject.h"
 
+#include "Engine/Renderer/VulkanMaterialTable.h"
+
 //---------------------------------------------------------------------------------------------------------------------
 SceneObject::SceneObject()
 {
@@ -71,3 +73,21 @@ void SceneObject::SetUpdate(bool flag)
     m_bUpdate = flag;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+bool SceneObject::IntersectLocal(Raytracer::Ray& ray, Raytracer::RayHit& hit) const
+{
+    // No CPU side geometry by default
+    return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool SceneObject::GetLocalBounds(Raytracer::AABB& bounds) const
+{
+    return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t SceneObject::GetMaterialID() const
+{
+    return INVALID_BINDLESS_INDEX;
+}
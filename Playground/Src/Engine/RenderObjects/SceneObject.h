@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Engine/Helpers/Utility.h"
+#include "Engine/Raytracer/BVH.h"
 
 class SceneObject
 {
@@ -18,6 +19,15 @@ public:
     virtual void                                    SetRotation(const glm::vec3& axis, float angle);
     virtual void                                    SetUpdate(bool flag);
 
+    // CPU ray query against object space geometry. Shrinks ray.tMax & fills hit on a closer hit.
+    virtual bool                                    IntersectLocal(Raytracer::Ray& ray, Raytracer::RayHit& hit) const;
+
+    // Object space bounds of the geometry IntersectLocal can hit. Returns false if there is none.
+    virtual bool                                    GetLocalBounds(Raytracer::AABB& bounds) const;
+
+    // Entry in VulkanMaterialTable hit shaders shade the object with, INVALID_BINDLESS_INDEX when it has none
+    virtual uint32_t                                GetMaterialID() const;
+
 protected:
     PFN_vkCreateAccelerationStructureKHR            vkCreateAccelerationStructureKHR;
     PFN_vkCmdBuildAccelerationStructuresKHR         vkCmdBuildAccelerationStructuresKHR;
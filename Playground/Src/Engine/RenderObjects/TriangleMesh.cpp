@@ -2,18 +2,30 @@
 #include "PlaygroundHeaders.h"
 #include "TriangleMesh.h"
 
+#include "Engine/Helpers/Camera.h"
+#include "Engine/Renderer/VulkanMaterial.h"
+#include "Engine/Renderer/VulkanMaterialTable.h"
+#include "Engine/Renderer/VulkanTexture2D.h"
+#include "Engine/Renderer/VulkanTextureCache.h"
+
 //---------------------------------------------------------------------------------------------------------------------
-TriangleMesh::TriangleMesh(const std::string& filepath)
+TriangleMesh::TriangleMesh(const std::string& filepath, Raytracer::BVHBuildMode eBVHMode)
 {
     m_FilePath = filepath;
+    m_eBVHBuildMode = eBVHMode;
 
     m_vecVertices.clear();
     m_vecIndices.clear();
+
+    m_mapTextures.clear();
+    m_ORMSources = {};
+    m_pMaterial = nullptr;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 TriangleMesh::~TriangleMesh()
 {
+    SAFE_DELETE(m_pMaterial);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -21,7 +33,8 @@ void TriangleMesh::Initialize(VulkanDevice* pDevice)
 {
     SceneObject::Initialize(pDevice);
 
-    LoadModel(m_FilePath);
+    LoadModel(pDevice, m_FilePath);
+    BuildBVH();
 	CreateBottomLevelAS(pDevice);
 }
 
@@ -29,6 +42,22 @@ void TriangleMesh::Initialize(VulkanDevice* pDevice)
 void TriangleMesh::Update(float dt)
 {
     SceneObject::Update(dt);
+
+    if (m_pMaterial == nullptr || m_BVH.IsEmpty())
+        return;
+
+    // Projected size of the scaled bounds, drives which mips of the material's textures stay resident
+    const Camera& camera = Camera::getInstance();
+    const glm::vec3 extent = m_BVH.GetBounds().Extent() * m_pMeshInstanceData->scale;
+    const float distance = std::max(0.01f, glm::length(m_pMeshInstanceData->position - camera.m_vecCameraPosition));
+    const float size = std::max(extent.x, std::max(extent.y, extent.z));
+    const float screenExtent = 0.5f * camera.m_iWindowHeight * camera.m_matProjection[1][1] * size / distance;
+
+    std::map<TextureType, VulkanTexture2D*>::iterator iter = m_pMaterial->m_mapTextures.begin();
+    for (; iter != m_pMaterial->m_mapTextures.end(); ++iter)
+    {
+        VulkanTextureCache::getInstance().RequestMip(iter->second, screenExtent);
+    }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -41,13 +70,55 @@ void TriangleMesh::Cleanup(VulkanDevice* pDevice)
 {
     m_pMeshData->Cleanup(pDevice);
     m_BottomLevelAS.Cleanup(pDevice);
+    m_BVH.Clear();
+
+    if (m_pMaterial)
+        m_pMaterial->Cleanup(pDevice);
 
     m_vecVertices.clear();
     m_vecIndices.clear();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void TriangleMesh::LoadModel(const std::string& path)
+bool TriangleMesh::IntersectLocal(Raytracer::Ray& ray, Raytracer::RayHit& hit) const
+{
+    return m_BVH.Traverse(ray, [this, &hit](uint32_t triangle, Raytracer::Ray& r)
+    {
+        const glm::vec3& v0 = m_vecVertices[m_vecIndices[3 * triangle + 0]].Position;
+        const glm::vec3& v1 = m_vecVertices[m_vecIndices[3 * triangle + 1]].Position;
+        const glm::vec3& v2 = m_vecVertices[m_vecIndices[3 * triangle + 2]].Position;
+
+        float t, u, v;
+        if (!Raytracer::IntersectTriangle(r, v0, v1, v2, t, u, v))
+            return false;
+
+        r.tMax = t;
+        hit.t = t;
+        hit.primitive = triangle;
+        hit.barycentrics = glm::vec2(u, v);
+        hit.normal = glm::cross(v1 - v0, v2 - v0);
+        return true;
+    });
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool TriangleMesh::GetLocalBounds(Raytracer::AABB& bounds) const
+{
+    if (m_BVH.IsEmpty())
+        return false;
+
+    bounds = m_BVH.GetBounds();
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t TriangleMesh::GetMaterialID() const
+{
+    return m_pMaterial != nullptr ? m_pMaterial->m_uiMaterialID : INVALID_BINDLESS_INDEX;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TriangleMesh::LoadModel(VulkanDevice* pDevice, const std::string& path)
 {
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
@@ -58,10 +129,93 @@ void TriangleMesh::LoadModel(const std::string& path)
         return;
     }
 
+    LoadMaterial(pDevice, scene);
+
     // process root node recursively!
     ProcessNode(scene->mRootNode, scene);
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+//--- Same texture slots as the Stingray PBS materials Model reads. Missing textures stay INVALID_BINDLESS_INDEX in the
+//--- material table, shaders fall back to its constants.
+void TriangleMesh::ExtractTextureFromMaterial(aiMaterial* pMaterial, aiTextureType eType)
+{
+    aiString path;
+    if (pMaterial->GetTextureCount(eType) == 0 || pMaterial->GetTexture(eType, 0, &path) != AI_SUCCESS)
+        return;
+
+    // cut off any directory information already present
+    const std::string fullPath = path.C_Str();
+    const std::string fileName = fullPath.substr(fullPath.find_last_of("\\/") + 1);
+
+    if (fileName.empty())
+        return;
+
+    switch (eType)
+    {
+        case aiTextureType_BASE_COLOR:          m_mapTextures.emplace(fileName, TextureType::TEXTURE_ALBEDO);      break;
+        case aiTextureType_EMISSION_COLOR:      m_mapTextures.emplace(fileName, TextureType::TEXTURE_EMISSIVE);    break;
+        case aiTextureType_NORMAL_CAMERA:       m_mapTextures.emplace(fileName, TextureType::TEXTURE_NORMAL);      break;
+
+        case aiTextureType_DIFFUSE_ROUGHNESS:
+        {
+            if (m_ORMSources.roughness.empty())
+                m_ORMSources.roughness = fileName;
+            break;
+        }
+
+        case aiTextureType_METALNESS:
+        {
+            if (m_ORMSources.metalness.empty())
+                m_ORMSources.metalness = fileName;
+            break;
+        }
+
+        case aiTextureType_AMBIENT_OCCLUSION:
+        {
+            if (m_ORMSources.occlusion.empty())
+                m_ORMSources.occlusion = fileName;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Textures of every material the file has, loaded as one batch & registered in VulkanMaterialTable. The first
+//--- texture of each type wins, see VulkanMaterial::LoadTextures.
+void TriangleMesh::LoadMaterial(VulkanDevice* pDevice, const aiScene* scene)
+{
+    MaterialGPUData constants;
+
+    for (uint32_t i = 0; i < scene->mNumMaterials; ++i)
+    {
+        aiMaterial* material = scene->mMaterials[i];
+
+        ExtractTextureFromMaterial(material, aiTextureType_BASE_COLOR);
+        ExtractTextureFromMaterial(material, aiTextureType_NORMAL_CAMERA);
+        ExtractTextureFromMaterial(material, aiTextureType_EMISSION_COLOR);
+        ExtractTextureFromMaterial(material, aiTextureType_METALNESS);
+        ExtractTextureFromMaterial(material, aiTextureType_DIFFUSE_ROUGHNESS);
+        ExtractTextureFromMaterial(material, aiTextureType_AMBIENT_OCCLUSION);
+
+        // Flat color of the first material, used wherever there's no albedo texture
+        aiColor4D diffuseColor;
+        if (i == 0 && aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor) == AI_SUCCESS)
+            constants.albedoColor = glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a);
+    }
+
+    // Roughness, metalness & AO are single channel, sample them as one ORM texture instead of three RGBA8 ones
+    if (!m_ORMSources.occlusion.empty() || !m_ORMSources.roughness.empty() || !m_ORMSources.metalness.empty())
+        m_mapTextures.emplace(Texture::ImportORMTexture(m_ORMSources), TextureType::TEXTURE_ORM);
+
+    m_pMaterial = new VulkanMaterial();
+    m_pMaterial->LoadTextures(pDevice, m_mapTextures);
+    m_pMaterial->RegisterBindless(pDevice, constants);
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void TriangleMesh::ProcessNode(aiNode* node, const aiScene* scene)
 {
@@ -223,24 +377,40 @@ void TriangleMesh::CreateBottomLevelAS(VulkanDevice* pDevice)
 {	  
 	m_pMeshData = new Vulkan::MeshData();
 
-    // 2. Create buffers for Mesh Data
+    // 2. Create buffers for Mesh Data, only read by the BLAS build below so defragmentation may move them, the callbacks
+    // keep the handles & instance addresses current. Device local, the data goes through the staging ring & the build is
+    // submitted to the same queue after it
+    auto onVertexBufferMoved = [this, pDevice](VkBuffer buffer)
+    {
+        m_pMeshData->vertexBuffer.buffer = buffer;
+        m_pMeshInstanceData->verticesAddress = Vulkan::GetBufferDeviceAddress(pDevice, buffer);
+    };
+
+    auto onIndexBufferMoved = [this, pDevice](VkBuffer buffer)
+    {
+        m_pMeshData->indexBuffer.buffer = buffer;
+        m_pMeshInstanceData->indicesAddress = Vulkan::GetBufferDeviceAddress(pDevice, buffer);
+    };
+
     // Create VB
     pDevice->CreateBufferAndCopyData(m_vecVertices.size() * sizeof(App::VertexP),
                                      VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                      &(m_pMeshData->vertexBuffer.buffer),
-                                     &(m_pMeshData->vertexBuffer.memory),
+                                     &(m_pMeshData->vertexBuffer.allocation),
                                      m_vecVertices.data(),
-                                     "BLAS_CUBE_MESH_VB");
+                                     "BLAS_CUBE_MESH_VB",
+                                     onVertexBufferMoved);
 
     // Create IB
     pDevice->CreateBufferAndCopyData(m_vecIndices.size() * sizeof(uint32_t),
                                     VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                     &(m_pMeshData->indexBuffer.buffer),
-                                    &(m_pMeshData->indexBuffer.memory),
+                                    &(m_pMeshData->indexBuffer.allocation),
                                     m_vecIndices.data(),
-                                    "BLAS_CUBE_MESH_IB");
+                                    "BLAS_CUBE_MESH_IB",
+                                    onIndexBufferMoved);
 
 
     // 3. Get Device addresses of buffers just created
@@ -293,7 +463,7 @@ void TriangleMesh::CreateBottomLevelAS(VulkanDevice* pDevice)
                           VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                           VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
                           &m_BottomLevelAS.buffer,
-                          &m_BottomLevelAS.memory,
+                          &m_BottomLevelAS.allocation,
                           "BLAS_MESH");
 
     VkAccelerationStructureCreateInfoKHR accelStructCreateInfo = {};
@@ -316,7 +486,7 @@ void TriangleMesh::CreateBottomLevelAS(VulkanDevice* pDevice)
                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                           &scratchBuffer.handle,
-                          &scratchBuffer.memory,
+                          &scratchBuffer.allocation,
                           "BLAS_SCRATCH_BUFFER");
 
     scratchBuffer.deviceAddress = Vulkan::GetBufferDeviceAddress(pDevice, scratchBuffer.handle);
@@ -340,7 +510,7 @@ void TriangleMesh::CreateBottomLevelAS(VulkanDevice* pDevice)
     std::vector<VkAccelerationStructureBuildRangeInfoKHR*> vecAccelStructRangeInfos;
     vecAccelStructRangeInfos.push_back(&accelStructBuildRangeInfo);
 
-    VkCommandBuffer commandBuffer = pDevice->BeginCommandBuffer("BuildBLAS");
+    VkCommandBuffer commandBuffer = pDevice->BeginComputeCommandBuffer("BuildBLAS");
 
     // Accel Struct needs to be built on Device!
     vkCmdBuildAccelerationStructuresKHR(commandBuffer,
@@ -348,7 +518,8 @@ void TriangleMesh::CreateBottomLevelAS(VulkanDevice* pDevice)
                                         &accelStructBuildGeomInfo2,
                                         vecAccelStructRangeInfos.data());
 
-    pDevice->EndAndSubmitCommandBuffer(commandBuffer);
+    // Async compute when there's a queue for it, graphics waits for the build on the GPU
+    const uint64_t computeValue = pDevice->SubmitComputeCommandBuffer(commandBuffer, 0);
 
     // 9. Finally, get hold of device address of BLAS!
     VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
@@ -356,6 +527,28 @@ void TriangleMesh::CreateBottomLevelAS(VulkanDevice* pDevice)
     accelerationDeviceAddressInfo.accelerationStructure = m_BottomLevelAS.handle;
     m_BottomLevelAS.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(pDevice->m_vkLogicalDevice, &accelerationDeviceAddressInfo);
 
-    // 10. Scratch buffer no lonoger needed!
-    scratchBuffer.Cleanup(pDevice);
+    // 10. Scratch buffer no lonoger needed, once the build is done with it!
+    pDevice->DestroyBufferAfterCompute(scratchBuffer.handle, scratchBuffer.allocation, computeValue);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void TriangleMesh::BuildBVH()
+{
+    // CPU side BVH in object space, used by the CPU raytracing paths
+    const uint32_t nTriangles = static_cast<uint32_t>(m_vecIndices.size()) / 3;
+
+    std::vector<Raytracer::AABB> vecTriangleBounds(nTriangles);
+    for (uint32_t i = 0; i < nTriangles; ++i)
+    {
+        vecTriangleBounds[i].Grow(m_vecVertices[m_vecIndices[3 * i + 0]].Position);
+        vecTriangleBounds[i].Grow(m_vecVertices[m_vecIndices[3 * i + 1]].Position);
+        vecTriangleBounds[i].Grow(m_vecVertices[m_vecIndices[3 * i + 2]].Position);
+    }
+
+    m_BVH.Build(vecTriangleBounds, m_eBVHBuildMode);
+
+    const Raytracer::BVHBuildStats& stats = m_BVH.m_BuildStats;
+    LOG_INFO("BVH ({0}) for {1}: {2} tris in {3:.2f} ms, {4:.2f} Mtris/s, SAH cost {5:.2f}, {6} nodes, {7} leaves",
+             m_eBVHBuildMode == Raytracer::BVHBuildMode::LBVH ? "LBVH" : "Binned SAH",
+             m_FilePath, nTriangles, stats.buildTimeMs, stats.mtrisPerSec, stats.sahCost, stats.nodeCount, stats.leafCount);
 }
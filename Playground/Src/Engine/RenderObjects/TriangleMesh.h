@@ -5,12 +5,17 @@
 #include "assimp/scene.h"
 
 #include "Engine/Helpers/Utility.h"
+#include "Engine/Raytracer/BVH.h"
+#include "Engine/Texture/ChannelPacker.h"
 #include "SceneObject.h"
 
+class VulkanMaterial;
+enum class TextureType;
+
 class TriangleMesh : public SceneObject
 {
 public:
-    TriangleMesh(const std::string& filepath);
+    TriangleMesh(const std::string& filepath, Raytracer::BVHBuildMode eBVHMode = Raytracer::BVHBuildMode::BINNED_SAH);
     ~TriangleMesh();
 
     void                                            Initialize(VulkanDevice* pDevice) override;
@@ -18,11 +23,18 @@ public:
     void                                            Render() override;
     void                                            Cleanup(VulkanDevice* pDevice) override;
 
+    bool                                            IntersectLocal(Raytracer::Ray& ray, Raytracer::RayHit& hit) const override;
+    bool                                            GetLocalBounds(Raytracer::AABB& bounds) const override;
+    uint32_t                                        GetMaterialID() const override;
+
 private:
-    void                                            LoadModel(const std::string& path);
+    void                                            LoadModel(VulkanDevice* pDevice, const std::string& path);
+    void                                            LoadMaterial(VulkanDevice* pDevice, const aiScene* scene);
+    void                                            ExtractTextureFromMaterial(aiMaterial* pMaterial, aiTextureType eType);
     void                                            ProcessNode(aiNode* node, const aiScene* scene);
     void                                            ProcessMesh(aiMesh* mesh, const aiScene* scene);
     void                                            CreateBottomLevelAS(VulkanDevice* pDevice);
+    void                                            BuildBVH();
 
 private:
     std::vector<App::VertexP>                       m_vecVertices;
@@ -30,5 +42,15 @@ private:
 
     Vulkan::MeshData*                               m_pMeshData;
     std::string                                     m_FilePath;
+
+    Raytracer::BVH                                  m_BVH;
+    Raytracer::BVHBuildMode                         m_eBVHBuildMode;
+
+    // One material for the whole mesh, every sub mesh shares the BLAS & its single instance
+    std::map<std::string, TextureType>              m_mapTextures;
+    Texture::ORMSources                             m_ORMSources;                   // Packed into one TEXTURE_ORM by LoadMaterial
+
+public:
+    VulkanMaterial*                                 m_pMaterial;
 };
 
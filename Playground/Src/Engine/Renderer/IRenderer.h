@@ -13,5 +13,8 @@ public:
 	virtual void	Update(float dt) = 0;
 	virtual void	Render() = 0;
 	virtual	void	Cleanup() = 0;
+
+	// Cursor position in window coordinates
+	virtual void	PickObject(double xPos, double yPos) {};
 };
 
@@ -1,8 +1,12 @@
 #include "PlaygroundPCH.h"
 #include "RTXRenderer.h"
 #include "VulkanDevice.h"
+#include "VulkanMemoryAllocator.h"
 #include "VulkanSwapChain.h"
 #include "VulkanTexture2D.h"
+#include "VulkanTextureCache.h"
+#include "VulkanMaterialTable.h"
+#include "VulkanSamplerCache.h"
 #include "VulkanGraphicsPipeline.h"
 #include "Engine/RenderObjects/HDRISkydome.h"
 #include "Engine/Scene.h"      
@@ -11,16 +15,32 @@
 #include "Engine/ImGui/UIManager.h"
 #include "Engine/RenderObjects/TriangleMesh.h"
 #include "Engine/RenderObjects/SceneObject.h"
+#include "Engine/Raytracer/CpuRenderer.h"
+
+#include <chrono>
+
+// Instance custom index of objects without a material, NO_MATERIAL in closestHitBasic.rchit
+const uint32_t RT_NO_MATERIAL = 0xFFFFFF;
 
 //---------------------------------------------------------------------------------------------------------------------
 RTXRenderer::RTXRenderer()
 {
     m_pScene = nullptr;
+    m_pEnvironmentMap = nullptr;
+    m_pCpuRenderer = nullptr;
+    m_arrCpuFrameBuffersMapped.fill(nullptr);
+    m_arrCpuFrameVersions.fill(0);
+    m_arrTopLevelASGraphicsValues.fill(0);
+    m_arrTopLevelASComputeValues.fill(0);
+    m_arrDescriptorSetsRayTracing.fill(VK_NULL_HANDLE);
+    m_fPickTimeMs = 0.0f;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 RTXRenderer::~RTXRenderer()
 {
+    SAFE_DELETE(m_pCpuRenderer);
+    SAFE_DELETE(m_pEnvironmentMap);
     SAFE_DELETE(m_pScene);
 }
 
@@ -45,9 +65,18 @@ int RTXRenderer::Initialize(GLFWwindow* pWindow)
         //SetupRenderPass();
         InitRayTracing();
 
+        // Before the scene, materials register into it while loading
+        VulkanMaterialTable::getInstance().Initialize(m_pDevice);
+
         m_pScene = new Scene();
         m_pScene->LoadScene(m_pDevice, m_pSwapChain);
 
+        m_pEnvironmentMap = new VulkanTexture2D();
+        m_pEnvironmentMap->CreateEnvironmentMap(m_pDevice, "old_hall_2k.hdr");
+
+        VulkanMaterialTable::getInstance().LogStats();
+        VulkanSamplerCache::getInstance().LogStats();
+
         //m_pCube = new RTXCube();
         //m_pCube->Initialize(m_pDevice);
 
@@ -59,12 +88,20 @@ int RTXRenderer::Initialize(GLFWwindow* pWindow)
 
         m_vecShaderModules.clear();
         
-        CreateTopLevelAS(false);
+        for (uint32_t i = 0; i < App::MAX_FRAME_DRAWS; ++i)
+            CreateTopLevelAS(i, false);
+
+        // Load boundary, the BLAS inputs are only read by the builds & their scratch buffers are gone
+        m_pDevice->DefragmentMemory(UINT32_MAX);
+
         CreateStorageImage();
         CreateRayTracingDescriptorSet();
         CreateRayTracingGraphicsPipeline();
         CreateRayTracingBindingTable();
 
+        m_pCpuRenderer = new Raytracer::CpuRenderer();
+        CreateCpuFrameBuffers();
+
         // Initialize UI Manager!
         UIManager::getInstance().Initialize(m_pWindow, m_vkInstance, m_pDevice, m_pSwapChain);
     }
@@ -92,7 +129,9 @@ void RTXRenderer::Update(float dt)
     m_pScene->Update(m_pDevice, m_pSwapChain, dt);
     m_pShaderUniformsRT->UpdateUniforms(m_pDevice);
 
-    CreateTopLevelAS(true);
+    CreateTopLevelAS(m_uiCurrentFrame, true);
+
+    m_pCpuRenderer->Update(m_pScene);
 
     //VkAccelerationStructureInstanceKHR& tInst = m_TopLevelAS.handle;
 }
@@ -101,14 +140,27 @@ void RTXRenderer::Update(float dt)
 void RTXRenderer::Render()
 {
     VulkanRenderer::BeginFrame();
+
+    // Fence for this frame has signalled, so its CPU frame buffer is no longer read by the GPU
+    if (m_pCpuRenderer->m_bEnabled)
+        m_pCpuRenderer->AcquireFrame(m_arrCpuFrameBuffersMapped[m_uiCurrentFrame], m_arrCpuFrameVersions[m_uiCurrentFrame]);
+
     RecordCommands(m_uiSwapchainImageIndex);
 
     UIManager::getInstance().BeginRender();
     //UIManager::getInstance().RenderSceneUI(m_pScene);
     UIManager::getInstance().RenderDebugStats();
+    UIManager::getInstance().RenderCpuRendererUI(m_pCpuRenderer, m_pScene);
+    UIManager::getInstance().RenderPickingStats(m_PickedHit, m_fPickTimeMs, m_pScene);
+    UIManager::getInstance().RenderTextureUI(m_pDevice, m_pSwapChain);
+    UIManager::getInstance().RenderMemoryUI(m_pDevice);
     UIManager::getInstance().EndRender(m_pSwapChain, m_uiSwapchainImageIndex);
 
-    VulkanRenderer::SubmitAndPresentFrame();   
+    const uint32_t frame = m_uiCurrentFrame;
+    VulkanRenderer::SubmitAndPresentFrame();
+
+    // The next refit of this frame's TLAS waits for everything submitted up to here
+    m_arrTopLevelASGraphicsValues[frame] = m_pDevice->SignalGraphicsTimeline();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -119,6 +171,9 @@ void RTXRenderer::Cleanup()
 
     UIManager::getInstance().Cleanup(m_pDevice);
 
+    m_pCpuRenderer->Cleanup();
+    CleanupCpuFrameBuffers();
+
     vkDestroyDescriptorPool(m_pDevice->m_vkLogicalDevice, m_vkDescriptorPoolRayTracing, nullptr);
     vkDestroyDescriptorSetLayout(m_pDevice->m_vkLogicalDevice, m_vkDescriptorSetLayoutRayTracing, nullptr);
 
@@ -135,7 +190,16 @@ void RTXRenderer::Cleanup()
     //m_pCube->Cleanup(m_pDevice);
     //m_pMesh->Cleanup(m_pDevice);
     m_pScene->Cleanup(m_pDevice);
-    m_TopLevelAS.Cleanup(m_pDevice);
+    m_pEnvironmentMap->Cleanup(m_pDevice);
+    VulkanMaterialTable::getInstance().Cleanup(m_pDevice);
+    VulkanTextureCache::getInstance().Cleanup(m_pDevice);
+    VulkanSamplerCache::getInstance().Cleanup(m_pDevice);
+    for (uint32_t i = 0; i < App::MAX_FRAME_DRAWS; ++i)
+    {
+        m_arrTopLevelAS[i].Cleanup(m_pDevice);
+        m_arrTopLevelASInstances[i].Cleanup(m_pDevice);
+        m_arrTopLevelASScratch[i].Cleanup(m_pDevice);
+    }
 
     m_RaygenShaderBindingTable.Cleanup(m_pDevice);
     m_MissShaderBindingTable.Cleanup(m_pDevice);
@@ -179,18 +243,52 @@ void RTXRenderer::RecordCommands(uint32_t currentImage)
 
     VkStridedDeviceAddressRegionKHR callableShaderSbtEntry{};
 
-    /*
-        Dispatch the ray tracing commands
-    */
-    vkCmdBindPipeline(m_pDevice->m_vecCommandBufferGraphics[currentImage], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_vkPipelineRayTracing);
-    vkCmdBindDescriptorSets(m_pDevice->m_vecCommandBufferGraphics[currentImage], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_vkPipelineLayoutRayTracing, 0, 1, &m_vkDescriptorSetRayTracing, 0, 0);
-
-    vkCmdTraceRaysKHR(m_pDevice->m_vecCommandBufferGraphics[currentImage],
-                      &raygenShaderSbtEntry,
-                      &missShaderSbtEntry,
-                      &hitShaderSbtEntry,
-                      &callableShaderSbtEntry,
-                      m_pSwapChain->m_vkSwapchainExtent.width, m_pSwapChain->m_vkSwapchainExtent.height, 1);
+    if (m_pCpuRenderer->m_bEnabled)
+    {
+        /*
+            Upload latest CPU reference frame into the storage image
+        */
+        Vulkan::TransitionImageLayout(m_pDevice,
+                                      m_pDevice->m_vecCommandBufferGraphics[currentImage],
+                                      m_StorageImage.image,
+                                      VK_IMAGE_LAYOUT_GENERAL,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      subresourceRange);
+
+        VkBufferImageCopy bufferCopyRegion = {};
+        bufferCopyRegion.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        bufferCopyRegion.imageExtent = { m_pCpuRenderer->GetWidth(), m_pCpuRenderer->GetHeight(), 1 };
+
+        vkCmdCopyBufferToImage(m_pDevice->m_vecCommandBufferGraphics[currentImage],
+                               m_arrCpuFrameBuffers[m_uiCurrentFrame].buffer,
+                               m_StorageImage.image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1,
+                               &bufferCopyRegion);
+
+        Vulkan::TransitionImageLayout(m_pDevice,
+                                      m_pDevice->m_vecCommandBufferGraphics[currentImage],
+                                      m_StorageImage.image,
+                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      VK_IMAGE_LAYOUT_GENERAL,
+                                      subresourceRange);
+    }
+    else
+    {
+        /*
+            Dispatch the ray tracing commands
+        */
+        vkCmdBindPipeline(m_pDevice->m_vecCommandBufferGraphics[currentImage], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_vkPipelineRayTracing);
+        vkCmdBindDescriptorSets(m_pDevice->m_vecCommandBufferGraphics[currentImage], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_vkPipelineLayoutRayTracing, 0, 1, &m_arrDescriptorSetsRayTracing[m_uiCurrentFrame], 0, 0);
+        VulkanMaterialTable::getInstance().Bind(m_pDevice->m_vecCommandBufferGraphics[currentImage], VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_vkPipelineLayoutRayTracing, 1);
+
+        vkCmdTraceRaysKHR(m_pDevice->m_vecCommandBufferGraphics[currentImage],
+                          &raygenShaderSbtEntry,
+                          &missShaderSbtEntry,
+                          &hitShaderSbtEntry,
+                          &callableShaderSbtEntry,
+                          m_pSwapChain->m_vkSwapchainExtent.width, m_pSwapChain->m_vkSwapchainExtent.height, 1);
+    }
 
     /*
         Copy ray tracing output to swap chain image
@@ -251,21 +349,25 @@ void RTXRenderer::HandleWindowResize()
 
     // Recreate Storage image!
     CreateStorageImage();
+    CreateCpuFrameBuffers();
 
     // Update Descriptor!
     VkDescriptorImageInfo storageImageDescriptor = {};
     storageImageDescriptor.imageView = m_StorageImage.imageView;
     storageImageDescriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-    VkWriteDescriptorSet resultImageWrite = {};
-    resultImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    resultImageWrite.dstSet = m_vkDescriptorSetRayTracing;
-    resultImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    resultImageWrite.dstBinding = 1;
-    resultImageWrite.descriptorCount = 1;
-    resultImageWrite.pImageInfo = &storageImageDescriptor;
-
-    vkUpdateDescriptorSets(m_pDevice->m_vkLogicalDevice, 1, &resultImageWrite, 0, VK_NULL_HANDLE);
+    for (VkDescriptorSet descriptorSet : m_arrDescriptorSetsRayTracing)
+    {
+        VkWriteDescriptorSet resultImageWrite = {};
+        resultImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        resultImageWrite.dstSet = descriptorSet;
+        resultImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        resultImageWrite.dstBinding = 1;
+        resultImageWrite.descriptorCount = 1;
+        resultImageWrite.pImageInfo = &storageImageDescriptor;
+
+        vkUpdateDescriptorSets(m_pDevice->m_vkLogicalDevice, 1, &resultImageWrite, 0, VK_NULL_HANDLE);
+    }
 
     UIManager::getInstance().HandleWindowResize(m_pWindow, m_vkInstance, m_pDevice, m_pSwapChain);
 
@@ -280,6 +382,7 @@ void RTXRenderer::CleanupOnWindowResize()
     UIManager::getInstance().CleanupOnWindowResize(m_pDevice);
     
     m_StorageImage.CleanupOnWindowResize(m_pDevice);
+    CleanupCpuFrameBuffers();
 }
 //---------------------------------------------------------------------------------------------------------------------
 void RTXRenderer::InitRayTracing()
@@ -309,7 +412,7 @@ void RTXRenderer::InitRayTracing()
 //---------------------------------------------------------------------------------------------------------------------
 // TLAS holds scene's object instances
 //---------------------------------------------------------------------------------------------------------------------
-void RTXRenderer::CreateTopLevelAS(bool bUpdate)
+void RTXRenderer::CreateTopLevelAS(uint32_t frame, bool bUpdate)
 { 
     // 1. Fetch transform matrix data
     // glm::mat4 matrix1 = glm::transpose(m_pScene->m_vecSceneObjects[0]->m_pMeshInstanceData->transformMatrix);
@@ -331,7 +434,9 @@ void RTXRenderer::CreateTopLevelAS(bool bUpdate)
 
         VkAccelerationStructureInstanceKHR accelStructInstance = {};
         accelStructInstance.transform = instMatrices[i];
-        accelStructInstance.instanceCustomIndex = i;
+        // Hit shaders look the object's material up with gl_InstanceCustomIndexEXT, it only has 24 bits
+        const uint32_t materialID = m_pScene->m_vecSceneObjects[i]->GetMaterialID();
+        accelStructInstance.instanceCustomIndex = materialID < RT_NO_MATERIAL ? materialID : RT_NO_MATERIAL;
         accelStructInstance.mask = 0xFF;
         accelStructInstance.instanceShaderBindingTableRecordOffset = 0;
         accelStructInstance.flags = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
@@ -342,14 +447,25 @@ void RTXRenderer::CreateTopLevelAS(bool bUpdate)
 
     // 2. Create buffer for Instance data!
     
-    // Create a buffer holding the actual instance data for use by the AS builder!
+    // Buffer holding the actual instance data for use by the AS builder, one per TLAS copy & rewritten by its refits
     VkDeviceSize instanceDescSizeInBytes = m_pScene->m_vecSceneObjects.size() * sizeof(VkAccelerationStructureInstanceKHR);
 
-    Vulkan::Buffer instanceBuffer;
-    m_pDevice->CreateBufferAndCopyData(instanceDescSizeInBytes,
-                                       VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
-                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                       &instanceBuffer.buffer, &instanceBuffer.memory, instAccelStruct.data(), "TLAS_Instances");
+    Vulkan::Buffer& instanceBuffer = m_arrTopLevelASInstances[frame];
+    Vulkan::RTAccelerationStructure& topLevelAS = m_arrTopLevelAS[frame];
+
+    if (!bUpdate)
+    {
+        m_pDevice->CreateBufferAndCopyData(instanceDescSizeInBytes,
+                                           VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                           &instanceBuffer.buffer, &instanceBuffer.allocation, instAccelStruct.data(), "TLAS_Instances");
+    }
+    else
+    {
+        // The previous refit of this copy, MAX_FRAME_DRAWS frames back, may still read the instances
+        m_pDevice->WaitCompute(m_arrTopLevelASComputeValues[frame]);
+        memcpy(instanceBuffer.allocation->pMapped, instAccelStruct.data(), instanceDescSizeInBytes);
+    }
 
     // 3. Get Device address of Buffer just created!
     VkDeviceOrHostAddressConstKHR instanceDataDeviceAddress = {};
@@ -442,33 +558,35 @@ void RTXRenderer::CreateTopLevelAS(bool bUpdate)
         m_pDevice->CreateBuffer(accelerationStructureBuildSizesInfo.accelerationStructureSize,
                                 VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
                                 VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
-                                &m_TopLevelAS.buffer,
-                                &m_TopLevelAS.memory,
+                                &topLevelAS.buffer,
+                                &topLevelAS.allocation,
                                 "TLAS_AS");
 
         VkAccelerationStructureCreateInfoKHR accelerationStructureCreateInfo = {};
         accelerationStructureCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-        accelerationStructureCreateInfo.buffer = m_TopLevelAS.buffer;
+        accelerationStructureCreateInfo.buffer = topLevelAS.buffer;
         accelerationStructureCreateInfo.size = accelerationStructureBuildSizesInfo.accelerationStructureSize;
         accelerationStructureCreateInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-        vkCreateAccelerationStructureKHR(m_pDevice->m_vkLogicalDevice, &accelerationStructureCreateInfo, nullptr, &m_TopLevelAS.handle);
+        vkCreateAccelerationStructureKHR(m_pDevice->m_vkLogicalDevice, &accelerationStructureCreateInfo, nullptr, &topLevelAS.handle);
+
+        // 7. Create a small scratch buffer used during building of the TLAS, kept for the copy's refits
+        m_arrTopLevelASScratch[frame] = CreateScratchBuffer(std::max(accelerationStructureBuildSizesInfo.buildScratchSize,
+                                                                     accelerationStructureBuildSizesInfo.updateScratchSize));
     }
-    
 
-    // 7. Create a small scratch buffer used during building of the TLAS
-    Vulkan::RTScratchBuffer scratchBuffer = CreateScratchBuffer(accelerationStructureBuildSizesInfo.buildScratchSize);
+    const Vulkan::RTScratchBuffer& scratchBuffer = m_arrTopLevelASScratch[frame];
 
     VkAccelerationStructureBuildGeometryInfoKHR accelBuildGeometryInfo2 = {};
     accelBuildGeometryInfo2.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
     accelBuildGeometryInfo2.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
     accelBuildGeometryInfo2.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
     accelBuildGeometryInfo2.mode = bUpdate ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-    accelBuildGeometryInfo2.dstAccelerationStructure = m_TopLevelAS.handle;
+    accelBuildGeometryInfo2.dstAccelerationStructure = topLevelAS.handle;
     accelBuildGeometryInfo2.geometryCount = 1;
     accelBuildGeometryInfo2.pGeometries = &topASGeometry;
     accelBuildGeometryInfo2.scratchData.deviceAddress = scratchBuffer.deviceAddress;
-    accelBuildGeometryInfo2.srcAccelerationStructure = bUpdate ? m_TopLevelAS.handle : VK_NULL_HANDLE;
-    accelBuildGeometryInfo2.dstAccelerationStructure = m_TopLevelAS.handle;
+    accelBuildGeometryInfo2.srcAccelerationStructure = bUpdate ? topLevelAS.handle : VK_NULL_HANDLE;
+    accelBuildGeometryInfo2.dstAccelerationStructure = topLevelAS.handle;
 
     VkAccelerationStructureBuildRangeInfoKHR accelerationStructureBuildRangeInfo = {};
     accelerationStructureBuildRangeInfo.primitiveCount = static_cast<uint32_t>(m_pScene->m_vecSceneObjects.size());
@@ -478,6 +596,7 @@ void RTXRenderer::CreateTopLevelAS(bool bUpdate)
     std::vector<VkAccelerationStructureBuildRangeInfoKHR*> vecAccelerationBuildStructureRangeInfos = { &accelerationStructureBuildRangeInfo };
 
     // 8. Create AS either on CPU or GPU depending on the feature availability!
+    uint64_t computeValue = 0;
     if (m_vkRayTracingAccelerationStructureFeaturesEnabled.accelerationStructureHostCommands)
     {
         // Implementation supports building Accel Struct on Host!
@@ -491,7 +610,7 @@ void RTXRenderer::CreateTopLevelAS(bool bUpdate)
     }
     else
     {
-        VkCommandBuffer commandBuffer = m_pDevice->BeginCommandBuffer();
+        VkCommandBuffer commandBuffer = m_pDevice->BeginComputeCommandBuffer("BuildTLAS");
 
         // Accel Struct needs to be built on Device!
         vkCmdBuildAccelerationStructuresKHR(commandBuffer,
@@ -499,18 +618,18 @@ void RTXRenderer::CreateTopLevelAS(bool bUpdate)
                                             &accelBuildGeometryInfo2,
                                             vecAccelerationBuildStructureRangeInfos.data());
 
-        m_pDevice->EndAndSubmitCommandBuffer(commandBuffer);
+        // Async compute, no CPU wait. A refit rewrites this copy in place, so it waits for the frame that last traced
+        // against it, the frame in flight with the other copy keeps going.
+        computeValue = m_pDevice->SubmitComputeCommandBuffer(commandBuffer, bUpdate ? m_arrTopLevelASGraphicsValues[frame] : 0);
     }
 
+    m_arrTopLevelASComputeValues[frame] = computeValue;
+
     // 9. Finally, get hold of device address of TLAS!
     VkAccelerationStructureDeviceAddressInfoKHR accelerationDeviceAddressInfo{};
     accelerationDeviceAddressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-    accelerationDeviceAddressInfo.accelerationStructure = m_TopLevelAS.handle;
-    m_TopLevelAS.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(m_pDevice->m_vkLogicalDevice, &accelerationDeviceAddressInfo);
-
-    // 10. Scratch buffer & Instance buffer no longer needed!
-    scratchBuffer.Cleanup(m_pDevice);
-    instanceBuffer.Cleanup(m_pDevice);
+    accelerationDeviceAddressInfo.accelerationStructure = topLevelAS.handle;
+    topLevelAS.deviceAddress = vkGetAccelerationStructureDeviceAddressKHR(m_pDevice->m_vkLogicalDevice, &accelerationDeviceAddressInfo);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -519,15 +638,17 @@ void RTXRenderer::CreateRayTracingDescriptorSet()
     //--- Create Descriptor pool
     std::vector<VkDescriptorPoolSize> poolSizes = 
     {
-        {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1}
+        {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, App::MAX_FRAME_DRAWS},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, App::MAX_FRAME_DRAWS},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, App::MAX_FRAME_DRAWS},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, App::MAX_FRAME_DRAWS},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, App::MAX_FRAME_DRAWS}
     };
 
     VkDescriptorPoolCreateInfo descPoolCreateInfo = {};
     descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     descPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    descPoolCreateInfo.maxSets = 1;
+    descPoolCreateInfo.maxSets = App::MAX_FRAME_DRAWS;
     descPoolCreateInfo.pPoolSizes = poolSizes.data();
 
     VKRESULT_CHECK_INFO(vkCreateDescriptorPool(m_pDevice->m_vkLogicalDevice,
@@ -556,11 +677,26 @@ void RTXRenderer::CreateRayTracingDescriptorSet()
     ubLayoutBinding.descriptorCount = 1;
     ubLayoutBinding.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR;
 
+    // Environment, envSampling.glsl at ENV_SAMPLING_BINDING 3: the alias table & the equirect right after it
+    VkDescriptorSetLayoutBinding envAliasLayoutBinding = {};
+    envAliasLayoutBinding.binding = 3;
+    envAliasLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    envAliasLayoutBinding.descriptorCount = 1;
+    envAliasLayoutBinding.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR;
+
+    VkDescriptorSetLayoutBinding envMapLayoutBinding = {};
+    envMapLayoutBinding.binding = 4;
+    envMapLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    envMapLayoutBinding.descriptorCount = 1;
+    envMapLayoutBinding.stageFlags = VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR;
+
     std::vector<VkDescriptorSetLayoutBinding> bindings = 
     {
         accelStructLayoutBinding,
         resultImageLayoutBinding,
-        ubLayoutBinding
+        ubLayoutBinding,
+        envAliasLayoutBinding,
+        envMapLayoutBinding
     };
 
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {};
@@ -570,25 +706,26 @@ void RTXRenderer::CreateRayTracingDescriptorSet()
     
     VKRESULT_CHECK(vkCreateDescriptorSetLayout(m_pDevice->m_vkLogicalDevice, &descriptorSetLayoutCreateInfo, nullptr, &m_vkDescriptorSetLayoutRayTracing));
 
-    //--- Create Descriptor Sets!
+    //--- Create Descriptor Sets, one per frame in flight for its TLAS copy!
+    std::array<VkDescriptorSetLayout, App::MAX_FRAME_DRAWS> arrSetLayouts;
+    arrSetLayouts.fill(m_vkDescriptorSetLayoutRayTracing);
+
     VkDescriptorSetAllocateInfo descSetAllocInfo = {};
     descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     descSetAllocInfo.descriptorPool = m_vkDescriptorPoolRayTracing;
-    descSetAllocInfo.descriptorSetCount =  1;
-    descSetAllocInfo.pSetLayouts = &m_vkDescriptorSetLayoutRayTracing;
+    descSetAllocInfo.descriptorSetCount = App::MAX_FRAME_DRAWS;
+    descSetAllocInfo.pSetLayouts = arrSetLayouts.data();
 
-    VKRESULT_CHECK(vkAllocateDescriptorSets(m_pDevice->m_vkLogicalDevice, &descSetAllocInfo, &m_vkDescriptorSetRayTracing));
+    VKRESULT_CHECK(vkAllocateDescriptorSets(m_pDevice->m_vkLogicalDevice, &descSetAllocInfo, m_arrDescriptorSetsRayTracing.data()));
 
-    // Descriptor for AS
+    // Descriptor for AS, pointed at each frame's copy below
     VkWriteDescriptorSetAccelerationStructureKHR descASInfo = {};
     descASInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
     descASInfo.accelerationStructureCount = 1;
-    descASInfo.pAccelerationStructures = &m_TopLevelAS.handle;
 
     VkWriteDescriptorSet accelStructWrite = {};
     accelStructWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     accelStructWrite.pNext = &descASInfo;
-    accelStructWrite.dstSet = m_vkDescriptorSetRayTracing;
     accelStructWrite.dstBinding = 0;
     accelStructWrite.descriptorCount = 1;
     accelStructWrite.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
@@ -600,7 +737,6 @@ void RTXRenderer::CreateRayTracingDescriptorSet()
 
     VkWriteDescriptorSet resultImageWrite = {};
     resultImageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    resultImageWrite.dstSet = m_vkDescriptorSetRayTracing;
     resultImageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     resultImageWrite.dstBinding = 1;
     resultImageWrite.descriptorCount = 1;            
@@ -614,24 +750,58 @@ void RTXRenderer::CreateRayTracingDescriptorSet()
 
     VkWriteDescriptorSet uboWrite = {};
     uboWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    uboWrite.dstSet = m_vkDescriptorSetRayTracing;
     uboWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     uboWrite.dstBinding = 2;
     uboWrite.descriptorCount = 1;
     uboWrite.pBufferInfo = &ubBufferInfo;
 
+    // Descriptors for the environment
+    VkDescriptorBufferInfo envAliasBufferInfo = {};
+    envAliasBufferInfo.buffer = m_pEnvironmentMap->m_vkEnvironmentAliasBuffer;
+    envAliasBufferInfo.offset = 0;
+    envAliasBufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet envAliasWrite = {};
+    envAliasWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    envAliasWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    envAliasWrite.dstBinding = 3;
+    envAliasWrite.descriptorCount = 1;
+    envAliasWrite.pBufferInfo = &envAliasBufferInfo;
+
+    VkDescriptorImageInfo envMapImageInfo = {};
+    envMapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    envMapImageInfo.imageView = m_pEnvironmentMap->m_vkTextureImageView;
+    envMapImageInfo.sampler = m_pEnvironmentMap->m_vkTextureSampler;
+
+    VkWriteDescriptorSet envMapWrite = {};
+    envMapWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    envMapWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    envMapWrite.dstBinding = 4;
+    envMapWrite.descriptorCount = 1;
+    envMapWrite.pImageInfo = &envMapImageInfo;
+
     std::vector<VkWriteDescriptorSet> writeDescriptorSets = 
     {
         accelStructWrite,
         resultImageWrite,
-        uboWrite
+        uboWrite,
+        envAliasWrite,
+        envMapWrite
     };
 
-    vkUpdateDescriptorSets(m_pDevice->m_vkLogicalDevice,
-                           static_cast<uint32_t>(writeDescriptorSets.size()),
-                           writeDescriptorSets.data(),
-                           0,
-                           VK_NULL_HANDLE);
+    for (uint32_t i = 0; i < App::MAX_FRAME_DRAWS; ++i)
+    {
+        descASInfo.pAccelerationStructures = &m_arrTopLevelAS[i].handle;
+
+        for (VkWriteDescriptorSet& writeDescriptorSet : writeDescriptorSets)
+            writeDescriptorSet.dstSet = m_arrDescriptorSetsRayTracing[i];
+
+        vkUpdateDescriptorSets(m_pDevice->m_vkLogicalDevice,
+                               static_cast<uint32_t>(writeDescriptorSets.size()),
+                               writeDescriptorSets.data(),
+                               0,
+                               VK_NULL_HANDLE);
+    }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -640,8 +810,13 @@ void RTXRenderer::CreateRayTracingGraphicsPipeline()
     //--- Pipeline Layout
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount = 1;
-    pipelineLayoutCreateInfo.pSetLayouts = &m_vkDescriptorSetLayoutRayTracing;
+    // Set 1 is the material table, hit shaders fetch textures through the material ID of the instance
+    std::vector<VkDescriptorSetLayout> vecSetLayouts = { m_vkDescriptorSetLayoutRayTracing };
+    if (VulkanMaterialTable::getInstance().IsInitialized())
+        vecSetLayouts.push_back(VulkanMaterialTable::getInstance().GetDescriptorSetLayout());
+
+    pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(vecSetLayouts.size());
+    pipelineLayoutCreateInfo.pSetLayouts = vecSetLayouts.data();
 
     VKRESULT_CHECK(vkCreatePipelineLayout(m_pDevice->m_vkLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_vkPipelineLayoutRayTracing));
 
@@ -753,19 +928,12 @@ void RTXRenderer::CreateRayTracingBindingTable()
     const VkBufferUsageFlags bufferUsageFlags = VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
     const VkMemoryPropertyFlags memoryUsageFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
-    m_pDevice->CreateBuffer(handleSize, bufferUsageFlags, memoryUsageFlags, &m_RaygenShaderBindingTable.buffer, &m_RaygenShaderBindingTable.memory);
-    m_pDevice->CreateBuffer(handleSize, bufferUsageFlags, memoryUsageFlags, &m_MissShaderBindingTable.buffer, &m_MissShaderBindingTable.memory);
-    m_pDevice->CreateBuffer(handleSize, bufferUsageFlags, memoryUsageFlags, &m_HitShaderBindingTable.buffer, &m_HitShaderBindingTable.memory);
-
-    void* data;
-    VKRESULT_CHECK(vkMapMemory(m_pDevice->m_vkLogicalDevice, m_RaygenShaderBindingTable.memory, 0, handleSize, 0, &data));
-    memcpy(data, shaderHandleStorage.data(), handleSize);
-    
-    VKRESULT_CHECK(vkMapMemory(m_pDevice->m_vkLogicalDevice, m_MissShaderBindingTable.memory, 0, handleSize, 0, &data));
-    memcpy(data, shaderHandleStorage.data() + handleSizeAligned, handleSize);
-
-    VKRESULT_CHECK(vkMapMemory(m_pDevice->m_vkLogicalDevice, m_HitShaderBindingTable.memory, 0, handleSize, 0, &data));
-    memcpy(data, shaderHandleStorage.data() + handleSizeAligned * 2, handleSize);
+    m_pDevice->CreateBufferAndCopyData(handleSize, bufferUsageFlags, memoryUsageFlags, &m_RaygenShaderBindingTable.buffer, &m_RaygenShaderBindingTable.allocation,
+                                       shaderHandleStorage.data(), "SBT_RAYGEN");
+    m_pDevice->CreateBufferAndCopyData(handleSize, bufferUsageFlags, memoryUsageFlags, &m_MissShaderBindingTable.buffer, &m_MissShaderBindingTable.allocation,
+                                       shaderHandleStorage.data() + handleSizeAligned, "SBT_MISS");
+    m_pDevice->CreateBufferAndCopyData(handleSize, bufferUsageFlags, memoryUsageFlags, &m_HitShaderBindingTable.buffer, &m_HitShaderBindingTable.allocation,
+                                       shaderHandleStorage.data() + handleSizeAligned * 2, "SBT_HIT");
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -773,29 +941,14 @@ Vulkan::RTScratchBuffer RTXRenderer::CreateScratchBuffer(VkDeviceSize size)
 {
     Vulkan::RTScratchBuffer scratchBuffer = {};
 
-    VkBufferCreateInfo bufferCreateInfo = {};
-    bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferCreateInfo.size = size;
-    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-
-    VKRESULT_CHECK(vkCreateBuffer(m_pDevice->m_vkLogicalDevice, &bufferCreateInfo, nullptr, &scratchBuffer.handle));
+    // Served from a block instead of a vkAllocateMemory of its own
+    m_pDevice->CreateBuffer(size,
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            &scratchBuffer.handle,
+                            &scratchBuffer.allocation,
+                            "TLAS_SCRATCH_BUFFER");
 
-    VkMemoryRequirements memReq = {};
-    vkGetBufferMemoryRequirements(m_pDevice->m_vkLogicalDevice, scratchBuffer.handle, &memReq);
-
-    VkMemoryAllocateFlagsInfo memAllocFlagsInfo = {};
-    memAllocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-    memAllocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
-
-    VkMemoryAllocateInfo memAllocInfo = {};
-    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAllocInfo.pNext = &memAllocFlagsInfo;
-    memAllocInfo.allocationSize = memReq.size;
-    memAllocInfo.memoryTypeIndex = m_pDevice->FindMemoryTypeIndex(memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    VKRESULT_CHECK(vkAllocateMemory(m_pDevice->m_vkLogicalDevice, &memAllocInfo, nullptr, &scratchBuffer.memory));
-    VKRESULT_CHECK(vkBindBufferMemory(m_pDevice->m_vkLogicalDevice, scratchBuffer.handle, scratchBuffer.memory, 0));
-    
     scratchBuffer.deviceAddress = Vulkan::GetBufferDeviceAddress(m_pDevice, scratchBuffer.handle);
 
     return scratchBuffer;
@@ -810,7 +963,7 @@ void RTXRenderer::CreateStorageImage()
                                                m_pSwapChain->m_vkSwapchainExtent.height,
                                                m_pSwapChain->m_vkSwapchainImageFormat,
                                                VK_IMAGE_TILING_OPTIMAL,
-                                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                                               VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                                                &m_StorageImage.memory);
 
@@ -834,22 +987,88 @@ void RTXRenderer::CreateStorageImage()
     
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+void RTXRenderer::PickObject(double xPos, double yPos)
+{
+    int width, height;
+    glfwGetWindowSize(m_pWindow, &width, &height);
+    if (width == 0 || height == 0)
+        return;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Same ray the ray generation shader launches through this pixel
+    const Camera& camera = Camera::getInstance();
+    const glm::vec2 ndc = glm::vec2(xPos / width, yPos / height) * 2.0f - glm::vec2(1.0f);
+
+    Raytracer::Ray ray = Raytracer::GenerateCameraRay(glm::inverse(camera.m_matView), glm::inverse(camera.m_matProjection), ndc);
+    m_PickedHit = Raytracer::RayHit();
+    m_pScene->RaycastClosest(ray, m_PickedHit);
+
+    const auto endTime = std::chrono::high_resolution_clock::now();
+    m_fPickTimeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+
+    if (m_PickedHit.IsValid())
+    {
+        LOG_DEBUG("Picked object {0}, triangle {1}, t = {2} ({3} ms)", m_PickedHit.objectIndex, m_PickedHit.primitive, m_PickedHit.t, m_fPickTimeMs);
+    }
+    else
+    {
+        LOG_DEBUG("Picked nothing ({0} ms)", m_fPickTimeMs);
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void RTXRenderer::CreateCpuFrameBuffers()
+{
+    const uint32_t width = m_pSwapChain->m_vkSwapchainExtent.width;
+    const uint32_t height = m_pSwapChain->m_vkSwapchainExtent.height;
+    const bool bOutputBGRA = m_pSwapChain->m_vkSwapchainImageFormat == VK_FORMAT_B8G8R8A8_UNORM;
+
+    m_pCpuRenderer->Initialize(width, height, bOutputBGRA);
+
+    // One persistently mapped buffer per frame in flight
+    const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(width) * height * sizeof(uint32_t);
+    for (uint32_t i = 0; i < App::MAX_FRAME_DRAWS; ++i)
+    {
+        m_pDevice->CreateBuffer(bufferSize,
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                &m_arrCpuFrameBuffers[i].buffer,
+                                &m_arrCpuFrameBuffers[i].allocation,
+                                "CPU_FRAME_BUFFER");
+
+        m_arrCpuFrameBuffersMapped[i] = m_arrCpuFrameBuffers[i].allocation->pMapped;
+        memset(m_arrCpuFrameBuffersMapped[i], 0, bufferSize);
+        m_arrCpuFrameVersions[i] = 0;
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void RTXRenderer::CleanupCpuFrameBuffers()
+{
+    for (uint32_t i = 0; i < App::MAX_FRAME_DRAWS; ++i)
+    {
+        m_arrCpuFrameBuffersMapped[i] = nullptr;
+
+        m_arrCpuFrameBuffers[i].Cleanup(m_pDevice);
+        m_arrCpuFrameBuffers[i] = Vulkan::Buffer();
+    }
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void RTShaderUniforms::CreateBuffer(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 {
     pDevice->CreateBuffer(sizeof(RTShaderUniforms),
                           VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          &uniformDataBuffer.buffer, &uniformDataBuffer.memory, "RTShaderUniforms");
+                          &uniformDataBuffer.buffer, &uniformDataBuffer.allocation, "RTShaderUniforms");
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void RTShaderUniforms::UpdateUniforms(VulkanDevice* pDevice)
 {
-    void* data;
-    vkMapMemory(pDevice->m_vkLogicalDevice, uniformDataBuffer.memory, 0, sizeof(RTUniformData), 0, &data);
-    memcpy(data, &uniformData, sizeof(RTUniformData));
-    vkUnmapMemory(pDevice->m_vkLogicalDevice, uniformDataBuffer.memory);
+    memcpy(uniformDataBuffer.allocation->pMapped, &uniformData, sizeof(RTUniformData));
 }
 
 //---------------------------------------------------------------------------------------------------------------------
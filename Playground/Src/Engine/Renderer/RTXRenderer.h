@@ -7,6 +7,7 @@
 #include "PlaygroundHeaders.h"
 
 #include "VulkanRenderer.h"
+#include "Engine/Raytracer/BVH.h"
 
 class VulkanDevice;
 class VulkanSwapChain;
@@ -16,6 +17,12 @@ class Scene;
 class SceneObject;
 class RTXCube;
 class TriangleMesh;
+class VulkanTexture2D;
+
+namespace Raytracer
+{
+    class CpuRenderer;
+}
 
 //-----------------------------------------------------------------------------------------------------------------------
 struct RTUniformData
@@ -58,10 +65,12 @@ public:
                                                         
     virtual void					                    HandleWindowResize() override;
     virtual void					                    CleanupOnWindowResize() override;
+
+    virtual void					                    PickObject(double xPos, double yPos) override;
                                                         
     // RTX                                              
     void							                    InitRayTracing();
-    void							                    CreateTopLevelAS(bool bUpdate);
+    void							                    CreateTopLevelAS(uint32_t frame, bool bUpdate);
     void							                    CreateRayTracingDescriptorSet();
     void							                    CreateRayTracingGraphicsPipeline();
     void							                    CreateRayTracingBindingTable();
@@ -84,7 +93,14 @@ private:
     VkPhysicalDeviceAccelerationStructureFeaturesKHR    m_vkRayTracingAccelerationStructureFeaturesEnabled;
 
     Vulkan::RTAccelerationStructure                     m_BottomLevelAS;
-    Vulkan::RTAccelerationStructure                     m_TopLevelAS;
+
+    // One TLAS per frame in flight along with its instance & scratch buffers, so refitting a frame's copy only waits for
+    // the frame that last traced against it
+    std::array<Vulkan::RTAccelerationStructure, App::MAX_FRAME_DRAWS>  m_arrTopLevelAS;
+    std::array<Vulkan::Buffer, App::MAX_FRAME_DRAWS>                   m_arrTopLevelASInstances;       // Host visible, mapped
+    std::array<Vulkan::RTScratchBuffer, App::MAX_FRAME_DRAWS>          m_arrTopLevelASScratch;
+    std::array<uint64_t, App::MAX_FRAME_DRAWS>                         m_arrTopLevelASGraphicsValues;  // Signalled after the last frame using the copy
+    std::array<uint64_t, App::MAX_FRAME_DRAWS>                         m_arrTopLevelASComputeValues;   // Last build or refit of the copy
     Vulkan::RTStorageImage                              m_StorageImage;
 
     RTShaderUniforms*                                   m_pShaderUniformsRT;
@@ -94,6 +110,10 @@ private:
     Vulkan::RTScratchBuffer                             CreateScratchBuffer(VkDeviceSize size);
     void                                                CreateStorageImage();
 
+    // CPU reference renderer output
+    void                                                CreateCpuFrameBuffers();
+    void                                                CleanupCpuFrameBuffers();
+
 private:
    
     //RTXCube*                                            m_pCube;
@@ -101,6 +121,9 @@ private:
 
     Scene*                                              m_pScene;
 
+    // Miss shader radiance & raygen's importance sampled environment rays, alias table & equirect in bindings 3 & 4
+    VulkanTexture2D*                                    m_pEnvironmentMap;
+
     // RayGen shader binding table
     Vulkan::Buffer                                      m_RaygenShaderBindingTable;
 
@@ -115,8 +138,18 @@ private:
 
     VkPipeline                                          m_vkPipelineRayTracing;
     VkPipelineLayout                                    m_vkPipelineLayoutRayTracing;
-    VkDescriptorSet                                     m_vkDescriptorSetRayTracing;
+    std::array<VkDescriptorSet, App::MAX_FRAME_DRAWS>   m_arrDescriptorSetsRayTracing;  // Differ in the TLAS only
     VkDescriptorSetLayout                               m_vkDescriptorSetLayoutRayTracing;
     VkDescriptorPool                                    m_vkDescriptorPoolRayTracing;
+
+    // CPU reference renderer, its frames get copied into the storage image instead of tracing on the GPU
+    Raytracer::CpuRenderer*                             m_pCpuRenderer;
+    std::array<Vulkan::Buffer, App::MAX_FRAME_DRAWS>    m_arrCpuFrameBuffers;
+    std::array<void*, App::MAX_FRAME_DRAWS>             m_arrCpuFrameBuffersMapped;
+    std::array<uint32_t, App::MAX_FRAME_DRAWS>          m_arrCpuFrameVersions;
+
+    // Last mouse pick
+    Raytracer::RayHit                                   m_PickedHit;
+    float                                               m_fPickTimeMs;
 };
 
@@ -0,0 +1,791 @@
+#include "PlaygroundPCH.h"
+#include "VulkanComputeIBL.h"
+
+#include "VulkanComputePipeline.h"
+#include "VulkanDevice.h"
+#include "VulkanTextureCUBE.h"
+#include "VulkanSamplerCache.h"
+#include "Engine/Helpers/Utility.h"
+#include "Engine/Helpers/Log.h"
+#include "Engine/Helpers/JobSystem.h"
+#include "Engine/Texture/HDRConverter.h"
+
+#include <chrono>
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Every level & layer of image, the helpers in Vulkan:: don't know GENERAL or compute stages
+inline void RecordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t levelCount, uint32_t layerCount,
+							   VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+							   VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+	VkImageMemoryBarrier imageMemoryBarrier = {};
+	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageMemoryBarrier.oldLayout = oldLayout;
+	imageMemoryBarrier.newLayout = newLayout;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.image = image;
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+	imageMemoryBarrier.subresourceRange.levelCount = levelCount;
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+	imageMemoryBarrier.subresourceRange.layerCount = layerCount;
+	imageMemoryBarrier.srcAccessMask = srcAccess;
+	imageMemoryBarrier.dstAccessMask = dstAccess;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- 6 layer view of one level, what a cube stage writes through
+inline VkImageView CreateCubeLevelView(VulkanDevice* pDevice, VkImage image, VkFormat format, uint32_t level)
+{
+	VkImageViewCreateInfo imageViewCreateInfo = {};
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.image = image;
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	imageViewCreateInfo.format = format;
+	imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageViewCreateInfo.subresourceRange.baseMipLevel = level;
+	imageViewCreateInfo.subresourceRange.levelCount = 1;
+	imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	imageViewCreateInfo.subresourceRange.layerCount = 6;
+
+	VkImageView imageView = VK_NULL_HANDLE;
+	if (vkCreateImageView(pDevice->m_vkLogicalDevice, &imageViewCreateInfo, nullptr, &imageView) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create a cube level view!");
+	}
+
+	return imageView;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Linear with mips, u repeats for the equirect seam
+inline VkSampler AcquireIBLSampler(VulkanDevice* pDevice, VkSamplerAddressMode addressModeU)
+{
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.addressModeU = addressModeU;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_WHITE;
+	samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerCreateInfo.mipLodBias = 0.0f;
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerCreateInfo.anisotropyEnable = VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = 1;
+
+	return VulkanSamplerCache::getInstance().Acquire(pDevice, samplerCreateInfo);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanComputeIBL::VulkanComputeIBL()
+{
+	m_pComputePipelineEnvironment	= nullptr;
+	m_pComputePipelinePrefilter		= nullptr;
+	m_pComputePipelineBrdfLUT		= nullptr;
+
+	m_vkDescSetLayoutCube			= VK_NULL_HANDLE;
+	m_vkDescSetLayoutBrdf			= VK_NULL_HANDLE;
+
+	m_vkQueryPoolTimestamps			= VK_NULL_HANDLE;
+	m_fTimestampPeriod				= 1.0f;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanComputeIBL::~VulkanComputeIBL()
+{
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanComputeIBL::Initialize(VulkanDevice* pDevice)
+{
+	// m_vkDeviceProperties holds whichever device was enumerated last
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(pDevice->m_vkPhysicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(pDevice->m_vkPhysicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> vecQueueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(pDevice->m_vkPhysicalDevice, &queueFamilyCount, vecQueueFamilies.data());
+
+	// Dispatches go through BeginCommandBuffer, so onto the graphics queue
+	const VkQueueFamilyProperties& graphicsFamily = vecQueueFamilies[pDevice->m_pQueueFamilyIndices->m_uiGraphicsFamily.value()];
+	if (!(graphicsFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))
+	{
+		LOG_ERROR("Graphics queue can't run compute, no compute IBL!");
+		return false;
+	}
+
+	m_vkDescSetLayoutCube = CreateDescriptorSetLayout(pDevice, true);
+	m_vkDescSetLayoutBrdf = CreateDescriptorSetLayout(pDevice, false);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(IBLComputePushData);
+
+	m_pComputePipelineEnvironment = new VulkanComputePipeline("Assets/Shaders/iblEnvironment.comp.spv");
+	m_pComputePipelineEnvironment->CreatePipelineLayout(pDevice, { m_vkDescSetLayoutCube }, { pushConstantRange });
+
+	m_pComputePipelinePrefilter = new VulkanComputePipeline("Assets/Shaders/iblPrefilter.comp.spv");
+	m_pComputePipelinePrefilter->CreatePipelineLayout(pDevice, { m_vkDescSetLayoutCube }, { pushConstantRange });
+
+	m_pComputePipelineBrdfLUT = new VulkanComputePipeline("Assets/Shaders/iblBrdfLUT.comp.spv");
+	m_pComputePipelineBrdfLUT->CreatePipelineLayout(pDevice, { m_vkDescSetLayoutBrdf }, { pushConstantRange });
+
+	if (!m_pComputePipelineEnvironment->CreateComputePipeline(pDevice) || !m_pComputePipelinePrefilter->CreateComputePipeline(pDevice) ||
+		!m_pComputePipelineBrdfLUT->CreateComputePipeline(pDevice))
+	{
+		return false;
+	}
+
+	// Stage timings are optional, the bake itself doesn't need them
+	if (properties.limits.timestampComputeAndGraphics && graphicsFamily.timestampValidBits > 0)
+	{
+		VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = 4;
+
+		if (vkCreateQueryPool(pDevice->m_vkLogicalDevice, &queryPoolCreateInfo, nullptr, &m_vkQueryPoolTimestamps) != VK_SUCCESS)
+		{
+			LOG_WARNING("Failed to create the compute IBL timestamp pool, stages won't be timed");
+			m_vkQueryPoolTimestamps = VK_NULL_HANDLE;
+		}
+
+		m_fTimestampPeriod = properties.limits.timestampPeriod;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VkDescriptorSetLayout VulkanComputeIBL::CreateDescriptorSetLayout(VulkanDevice* pDevice, bool bCubeStage)
+{
+	std::vector<VkDescriptorSetLayoutBinding> vecBindings;
+
+	// Cube stages: sampled source at 0, a storage view per level at 1. BRDF LUT: its storage image at 0.
+	if (bCubeStage)
+	{
+		VkDescriptorSetLayoutBinding sourceBinding = {};
+		sourceBinding.binding = 0;
+		sourceBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		sourceBinding.descriptorCount = 1;
+		sourceBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		vecBindings.push_back(sourceBinding);
+	}
+
+	VkDescriptorSetLayoutBinding storageBinding = {};
+	storageBinding.binding = bCubeStage ? 1 : 0;
+	storageBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	storageBinding.descriptorCount = bCubeStage ? IBL_COMPUTE_MAX_LEVELS : 1;
+	storageBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	vecBindings.push_back(storageBinding);
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(vecBindings.size());
+	layoutCreateInfo.pBindings = vecBindings.data();
+
+	VkDescriptorSetLayout descSetLayout = VK_NULL_HANDLE;
+	if (vkCreateDescriptorSetLayout(pDevice->m_vkLogicalDevice, &layoutCreateInfo, nullptr, &descSetLayout) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create compute IBL descriptor set layout!");
+	}
+
+	return descSetLayout;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t VulkanComputeIBL::FillCubeDispatch(uint32_t dimension, uint32_t levelCount, IBLComputePushData& outPush)
+{
+	outPush.levelCount = levelCount;
+	outPush.dimension = dimension;
+
+	uint32_t groupCount = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const uint32_t tilesPerSide = (std::max(dimension >> level, 1u) + IBL_COMPUTE_TILE - 1) / IBL_COMPUTE_TILE;
+
+		outPush.groupOffsets[level] = groupCount;
+		groupCount += tilesPerSide * tilesPerSide * 6;
+	}
+
+	outPush.groupOffsets[levelCount] = groupCount;
+	outPush.groupsPerRow = std::min(groupCount, IBL_COMPUTE_GROUPS_PER_ROW);
+
+	return groupCount;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanComputeIBL::Bake(VulkanDevice* pDevice, const float* pRGBA, uint32_t width, uint32_t height, const Texture::IBLBakeSettings& settings,
+							VulkanTextureCUBE* pOutCube, ComputeIBLReport* pOutReport)
+{
+	if (!m_pComputePipelineBrdfLUT)
+	{
+		LOG_ERROR("Compute IBL baked before Initialize!");
+		return false;
+	}
+
+	const auto bakeStart = std::chrono::high_resolution_clock::now();
+
+	const VkFormat equirectFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+	const VkFormat cubeFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+	const VkFormat brdfFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	const uint32_t environmentDimension = settings.environmentDimension;
+	const uint32_t environmentLevels = std::min(static_cast<uint32_t>(std::floor(std::log2(environmentDimension))) + 1, IBL_COMPUTE_MAX_LEVELS);
+
+	const uint32_t prefilterDimension = settings.prefilter.dimension;
+	const uint32_t prefilterFullChain = static_cast<uint32_t>(std::floor(std::log2(prefilterDimension))) + 1;
+	const uint32_t prefilterLevels = std::min(settings.prefilter.mipLevels > 0 ? std::min(settings.prefilter.mipLevels, prefilterFullChain) : prefilterFullChain,
+											  IBL_COMPUTE_MAX_LEVELS);
+
+	const uint32_t brdfDimension = settings.brdfDimension;
+
+	//--- Equirect with its box filtered mips, the environment stage picks the level matching each cube level
+	std::vector<float> vecEquirect;
+	std::vector<size_t> vecEquirectOffsets;
+	Texture::GenerateEquirectMips(pRGBA, width, height, vecEquirect, vecEquirectOffsets);
+
+	const uint32_t equirectLevels = static_cast<uint32_t>(vecEquirectOffsets.size());
+	const VkDeviceSize equirectBytes = vecEquirect.size() * sizeof(float);
+
+	VkBuffer		stagingBuffer;
+	VkDeviceMemory	stagingBufferMemory;
+	pDevice->CreateBuffer(	equirectBytes,
+							VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+							&stagingBuffer,
+							&stagingBufferMemory);
+
+	void* data;
+	vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, equirectBytes, 0, &data);
+	memcpy(data, vecEquirect.data(), static_cast<size_t>(equirectBytes));
+	vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);
+
+	VkDeviceMemory equirectMemory;
+	VkImage equirectImage = Vulkan::CreateImage(pDevice, width, height, equirectFormat, VK_IMAGE_TILING_OPTIMAL,
+												VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+												&equirectMemory, equirectLevels);
+	VkImageView equirectView = Vulkan::CreateImageView(pDevice, equirectImage, equirectFormat, VK_IMAGE_ASPECT_COLOR_BIT, equirectLevels);
+
+	VkSampler equirectSampler = AcquireIBLSampler(pDevice, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+	VkSampler cubeSampler = AcquireIBLSampler(pDevice, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+	//--- Outputs, written as storage images, sampled afterwards & read back by the validation
+	const VkImageUsageFlags outputUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+	pOutCube->m_vkImageCUBE = Vulkan::CreateImageCUBE(pDevice, environmentDimension, environmentDimension, cubeFormat, environmentLevels,
+													  VK_IMAGE_TILING_OPTIMAL, outputUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pOutCube->m_vkImageMemoryCUBE);
+	pOutCube->m_vkImageViewCUBE = Vulkan::CreateImageViewCUBE(pDevice, pOutCube->m_vkImageCUBE, cubeFormat, environmentLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+	pOutCube->m_vkImageLayoutCUBE = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	pOutCube->m_vkImagePrefilterSpec = Vulkan::CreateImageCUBE(pDevice, prefilterDimension, prefilterDimension, cubeFormat, prefilterLevels,
+															   VK_IMAGE_TILING_OPTIMAL, outputUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+															   &pOutCube->m_vkImageMemoryPrefilterSpec);
+	pOutCube->m_vkImageViewPrefilterSpec = Vulkan::CreateImageViewCUBE(pDevice, pOutCube->m_vkImagePrefilterSpec, cubeFormat, prefilterLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+	pOutCube->m_vkImageLayoutPrefilterSpec = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	pOutCube->m_vkImageBRDF = Vulkan::CreateImage(pDevice, brdfDimension, brdfDimension, brdfFormat, VK_IMAGE_TILING_OPTIMAL, outputUsage,
+												  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pOutCube->m_vkImageMemoryBRDF);
+	pOutCube->m_vkImageViewBRDF = Vulkan::CreateImageView(pDevice, pOutCube->m_vkImageBRDF, brdfFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	pOutCube->m_vkImageLayoutBRDF = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	std::vector<VkImageView> vecEnvironmentViews(environmentLevels);
+	for (uint32_t level = 0; level < environmentLevels; ++level)
+		vecEnvironmentViews[level] = CreateCubeLevelView(pDevice, pOutCube->m_vkImageCUBE, cubeFormat, level);
+
+	std::vector<VkImageView> vecPrefilterViews(prefilterLevels);
+	for (uint32_t level = 0; level < prefilterLevels; ++level)
+		vecPrefilterViews[level] = CreateCubeLevelView(pDevice, pOutCube->m_vkImagePrefilterSpec, cubeFormat, level);
+
+	//--- One pool, a set per stage
+	std::array<VkDescriptorPoolSize, 2> arrPoolSizes = {};
+	arrPoolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	arrPoolSizes[0].descriptorCount = 2;
+	arrPoolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	arrPoolSizes[1].descriptorCount = 2 * IBL_COMPUTE_MAX_LEVELS + 1;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 3;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(arrPoolSizes.size());
+	poolCreateInfo.pPoolSizes = arrPoolSizes.data();
+
+	VkDescriptorPool descriptorPool;
+	if (vkCreateDescriptorPool(pDevice->m_vkLogicalDevice, &poolCreateInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create compute IBL descriptor pool!");
+	}
+
+	std::array<VkDescriptorSetLayout, 3> arrSetLayouts = { m_vkDescSetLayoutCube, m_vkDescSetLayoutCube, m_vkDescSetLayoutBrdf };
+	std::array<VkDescriptorSet, 3> arrDescSets = {};
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = descriptorPool;
+	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(arrSetLayouts.size());
+	setAllocInfo.pSetLayouts = arrSetLayouts.data();
+
+	if (vkAllocateDescriptorSets(pDevice->m_vkLogicalDevice, &setAllocInfo, arrDescSets.data()) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to allocate compute IBL descriptor sets!");
+	}
+
+	// Slots past the last level repeat it, every descriptor of the array has to be valid
+	auto writeCubeStageSet = [&](VkDescriptorSet descSet, VkSampler sampler, VkImageView sourceView, const std::vector<VkImageView>& vecLevelViews)
+	{
+		VkDescriptorImageInfo sourceInfo = {};
+		sourceInfo.sampler = sampler;
+		sourceInfo.imageView = sourceView;
+		sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		std::array<VkDescriptorImageInfo, IBL_COMPUTE_MAX_LEVELS> arrLevelInfos = {};
+		for (uint32_t slot = 0; slot < IBL_COMPUTE_MAX_LEVELS; ++slot)
+		{
+			arrLevelInfos[slot].imageView = vecLevelViews[std::min(slot, static_cast<uint32_t>(vecLevelViews.size()) - 1)];
+			arrLevelInfos[slot].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		}
+
+		std::array<VkWriteDescriptorSet, 2> arrWrites = {};
+		arrWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		arrWrites[0].dstSet = descSet;
+		arrWrites[0].dstBinding = 0;
+		arrWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		arrWrites[0].descriptorCount = 1;
+		arrWrites[0].pImageInfo = &sourceInfo;
+
+		arrWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		arrWrites[1].dstSet = descSet;
+		arrWrites[1].dstBinding = 1;
+		arrWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		arrWrites[1].descriptorCount = IBL_COMPUTE_MAX_LEVELS;
+		arrWrites[1].pImageInfo = arrLevelInfos.data();
+
+		vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, static_cast<uint32_t>(arrWrites.size()), arrWrites.data(), 0, nullptr);
+	};
+
+	writeCubeStageSet(arrDescSets[0], equirectSampler, equirectView, vecEnvironmentViews);
+	writeCubeStageSet(arrDescSets[1], cubeSampler, pOutCube->m_vkImageViewCUBE, vecPrefilterViews);
+
+	VkDescriptorImageInfo brdfInfo = {};
+	brdfInfo.imageView = pOutCube->m_vkImageViewBRDF;
+	brdfInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet brdfWrite = {};
+	brdfWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	brdfWrite.dstSet = arrDescSets[2];
+	brdfWrite.dstBinding = 0;
+	brdfWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	brdfWrite.descriptorCount = 1;
+	brdfWrite.pImageInfo = &brdfInfo;
+
+	vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &brdfWrite, 0, nullptr);
+
+	const auto recordStart = std::chrono::high_resolution_clock::now();
+
+	//--- Upload, three dispatches & the transitions between them in one submit
+	VkCommandBuffer cmdBuffer = pDevice->BeginCommandBuffer();
+
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+		vkCmdResetQueryPool(cmdBuffer, m_vkQueryPoolTimestamps, 0, 4);
+
+	RecordImageBarrier(cmdBuffer, equirectImage, equirectLevels, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					   0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	std::vector<VkBufferImageCopy> vecRegions(equirectLevels);
+	for (uint32_t level = 0; level < equirectLevels; ++level)
+	{
+		vecRegions[level] = {};
+		vecRegions[level].bufferOffset = vecEquirectOffsets[level] * sizeof(float);
+		vecRegions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		vecRegions[level].imageSubresource.mipLevel = level;
+		vecRegions[level].imageSubresource.baseArrayLayer = 0;
+		vecRegions[level].imageSubresource.layerCount = 1;
+		vecRegions[level].imageOffset = { 0, 0, 0 };
+		vecRegions[level].imageExtent = { std::max(width >> level, 1u), std::max(height >> level, 1u), 1 };
+	}
+
+	vkCmdCopyBufferToImage(cmdBuffer, stagingBuffer, equirectImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, equirectLevels, vecRegions.data());
+
+	RecordImageBarrier(cmdBuffer, equirectImage, equirectLevels, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	RecordImageBarrier(cmdBuffer, pOutCube->m_vkImageCUBE, environmentLevels, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+					   0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	RecordImageBarrier(cmdBuffer, pOutCube->m_vkImagePrefilterSpec, prefilterLevels, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+					   0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	RecordImageBarrier(cmdBuffer, pOutCube->m_vkImageBRDF, 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+					   0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	// Bottom of pipe waits for everything before it, so each pair of timestamps brackets one stage
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_vkQueryPoolTimestamps, 0);
+
+	uint32_t dispatchCount = 0;
+
+	//--- HDRI->Cube, every face & level
+	IBLComputePushData environmentPush = {};
+	environmentPush.sourceWidth = width;
+	environmentPush.sourceHeight = height;
+	environmentPush.sourceLevels = equirectLevels;
+	const uint32_t environmentGroups = FillCubeDispatch(environmentDimension, environmentLevels, environmentPush);
+
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pComputePipelineEnvironment->m_vkComputePipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pComputePipelineEnvironment->m_vkPipelineLayout, 0, 1, &arrDescSets[0], 0, nullptr);
+	vkCmdPushConstants(cmdBuffer, m_pComputePipelineEnvironment->m_vkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IBLComputePushData), &environmentPush);
+	vkCmdDispatch(cmdBuffer, environmentPush.groupsPerRow, (environmentGroups + environmentPush.groupsPerRow - 1) / environmentPush.groupsPerRow, 1);
+	++dispatchCount;
+
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_vkQueryPoolTimestamps, 1);
+
+	// The prefilter samples the whole chain, so it waits for every level
+	RecordImageBarrier(cmdBuffer, pOutCube->m_vkImageCUBE, environmentLevels, 6, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					   VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	//--- Prefiltered specular, every face & level
+	IBLComputePushData prefilterPush = {};
+	prefilterPush.sourceWidth = environmentDimension;
+	prefilterPush.sourceHeight = environmentDimension;
+	prefilterPush.sourceLevels = settings.prefilter.bSourceMipSelection ? environmentLevels : 1;
+	prefilterPush.minSamples = settings.prefilter.minSamples;
+	prefilterPush.maxSamples = settings.prefilter.maxSamples;
+	const uint32_t prefilterGroups = FillCubeDispatch(prefilterDimension, prefilterLevels, prefilterPush);
+
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pComputePipelinePrefilter->m_vkComputePipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pComputePipelinePrefilter->m_vkPipelineLayout, 0, 1, &arrDescSets[1], 0, nullptr);
+	vkCmdPushConstants(cmdBuffer, m_pComputePipelinePrefilter->m_vkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IBLComputePushData), &prefilterPush);
+	vkCmdDispatch(cmdBuffer, prefilterPush.groupsPerRow, (prefilterGroups + prefilterPush.groupsPerRow - 1) / prefilterPush.groupsPerRow, 1);
+	++dispatchCount;
+
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_vkQueryPoolTimestamps, 2);
+
+	//--- BRDF LUT, independent of the environment
+	IBLComputePushData brdfPush = {};
+	brdfPush.levelCount = 1;
+	brdfPush.dimension = brdfDimension;
+	brdfPush.maxSamples = settings.brdfSamples;
+
+	const uint32_t brdfGroups = (brdfDimension + IBL_COMPUTE_TILE - 1) / IBL_COMPUTE_TILE;
+
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pComputePipelineBrdfLUT->m_vkComputePipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pComputePipelineBrdfLUT->m_vkPipelineLayout, 0, 1, &arrDescSets[2], 0, nullptr);
+	vkCmdPushConstants(cmdBuffer, m_pComputePipelineBrdfLUT->m_vkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(IBLComputePushData), &brdfPush);
+	vkCmdDispatch(cmdBuffer, brdfGroups, brdfGroups, 1);
+	++dispatchCount;
+
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_vkQueryPoolTimestamps, 3);
+
+	RecordImageBarrier(cmdBuffer, pOutCube->m_vkImagePrefilterSpec, prefilterLevels, 6, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					   VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	RecordImageBarrier(cmdBuffer, pOutCube->m_vkImageBRDF, 1, 1, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					   VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+	pDevice->EndAndSubmitCommandBuffer(cmdBuffer);
+
+	const auto bakeEnd = std::chrono::high_resolution_clock::now();
+
+	std::array<uint64_t, 4> arrTimestamps = {};
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+	{
+		vkGetQueryPoolResults(pDevice->m_vkLogicalDevice, m_vkQueryPoolTimestamps, 0, 4, sizeof(arrTimestamps), arrTimestamps.data(), sizeof(uint64_t),
+							  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+	}
+
+	auto timestampMs = [&](uint32_t begin, uint32_t end)
+	{
+		return static_cast<float>(static_cast<double>(arrTimestamps[end] - arrTimestamps[begin]) * m_fTimestampPeriod / 1000000.0);
+	};
+
+	//--- Only the outputs outlive the bake
+	for (VkImageView view : vecEnvironmentViews)
+		vkDestroyImageView(pDevice->m_vkLogicalDevice, view, nullptr);
+
+	for (VkImageView view : vecPrefilterViews)
+		vkDestroyImageView(pDevice->m_vkLogicalDevice, view, nullptr);
+
+	vkDestroyDescriptorPool(pDevice->m_vkLogicalDevice, descriptorPool, nullptr);
+
+	vkDestroyImageView(pDevice->m_vkLogicalDevice, equirectView, nullptr);
+	vkDestroyImage(pDevice->m_vkLogicalDevice, equirectImage, nullptr);
+	vkFreeMemory(pDevice->m_vkLogicalDevice, equirectMemory, nullptr);
+
+	vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
+	vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+
+	VulkanSamplerCache::getInstance().Release(pDevice, equirectSampler);
+	VulkanSamplerCache::getInstance().Release(pDevice, cubeSampler);
+
+	ComputeIBLReport report = {};
+	report.environmentDimension = environmentDimension;
+	report.prefilterDimension = prefilterDimension;
+	report.prefilterLevels = prefilterLevels;
+	report.brdfDimension = brdfDimension;
+	report.dispatchCount = dispatchCount;
+	report.setupMs = std::chrono::duration<float, std::milli>(recordStart - bakeStart).count();
+	report.totalMs = std::chrono::duration<float, std::milli>(bakeEnd - bakeStart).count();
+	report.bValid = true;
+
+	if (m_vkQueryPoolTimestamps != VK_NULL_HANDLE)
+	{
+		report.environmentGpuMs = timestampMs(0, 1);
+		report.prefilterGpuMs = timestampMs(1, 2);
+		report.brdfGpuMs = timestampMs(2, 3);
+	}
+
+	LOG_DEBUG("Compute IBL: environment {0} ({1:.2f} ms), prefiltered {2} x {3} levels ({4:.2f} ms), BRDF LUT {5} ({6:.2f} ms), {7} dispatches, {8:.1f} ms total",
+			  environmentDimension, report.environmentGpuMs, prefilterDimension, prefilterLevels, report.prefilterGpuMs, brdfDimension, report.brdfGpuMs,
+			  dispatchCount, report.totalMs);
+
+	if (pOutReport)
+		*pOutReport = report;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanComputeIBL::Cleanup(VulkanDevice* pDevice)
+{
+	if (m_pComputePipelineEnvironment)
+		m_pComputePipelineEnvironment->Cleanup(pDevice);
+
+	if (m_pComputePipelinePrefilter)
+		m_pComputePipelinePrefilter->Cleanup(pDevice);
+
+	if (m_pComputePipelineBrdfLUT)
+		m_pComputePipelineBrdfLUT->Cleanup(pDevice);
+
+	SAFE_DELETE(m_pComputePipelineEnvironment);
+	SAFE_DELETE(m_pComputePipelinePrefilter);
+	SAFE_DELETE(m_pComputePipelineBrdfLUT);
+
+	vkDestroyDescriptorSetLayout(pDevice->m_vkLogicalDevice, m_vkDescSetLayoutCube, nullptr);
+	vkDestroyDescriptorSetLayout(pDevice->m_vkLogicalDevice, m_vkDescSetLayoutBrdf, nullptr);
+	vkDestroyQueryPool(pDevice->m_vkLogicalDevice, m_vkQueryPoolTimestamps, nullptr);
+
+	m_vkDescSetLayoutCube = VK_NULL_HANDLE;
+	m_vkDescSetLayoutBrdf = VK_NULL_HANDLE;
+	m_vkQueryPoolTimestamps = VK_NULL_HANDLE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Every level of a shader read only image, level major & layers back to back inside a level
+inline void ReadbackImage(VulkanDevice* pDevice, VkImage image, uint32_t dimension, uint32_t levelCount, uint32_t layerCount,
+						  uint32_t texelBytes, std::vector<uint8_t>& outData, std::vector<VkDeviceSize>& outLevelOffsets)
+{
+	outLevelOffsets.resize(levelCount);
+
+	std::vector<VkBufferImageCopy> vecRegions(levelCount);
+
+	VkDeviceSize byteSize = 0;
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const uint32_t levelDimension = std::max(dimension >> level, 1u);
+		outLevelOffsets[level] = byteSize;
+
+		vecRegions[level] = {};
+		vecRegions[level].bufferOffset = byteSize;
+		vecRegions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		vecRegions[level].imageSubresource.mipLevel = level;
+		vecRegions[level].imageSubresource.baseArrayLayer = 0;
+		vecRegions[level].imageSubresource.layerCount = layerCount;
+		vecRegions[level].imageOffset = { 0, 0, 0 };
+		vecRegions[level].imageExtent = { levelDimension, levelDimension, 1 };
+
+		byteSize += static_cast<VkDeviceSize>(levelDimension) * levelDimension * layerCount * texelBytes;
+	}
+
+	VkBuffer		readbackBuffer;
+	VkDeviceMemory	readbackBufferMemory;
+	pDevice->CreateBuffer(	byteSize,
+							VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+							&readbackBuffer,
+							&readbackBufferMemory);
+
+	VkCommandBuffer cmdBuffer = pDevice->BeginCommandBuffer();
+
+	RecordImageBarrier(cmdBuffer, image, levelCount, layerCount, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					   VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	vkCmdCopyImageToBuffer(cmdBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, levelCount, vecRegions.data());
+
+	RecordImageBarrier(cmdBuffer, image, levelCount, layerCount, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					   VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+	pDevice->EndAndSubmitCommandBuffer(cmdBuffer);
+
+	outData.resize(static_cast<size_t>(byteSize));
+
+	void* data;
+	vkMapMemory(pDevice->m_vkLogicalDevice, readbackBufferMemory, 0, byteSize, 0, &data);
+	memcpy(outData.data(), data, static_cast<size_t>(byteSize));
+	vkUnmapMemory(pDevice->m_vkLogicalDevice, readbackBufferMemory);
+
+	vkDestroyBuffer(pDevice->m_vkLogicalDevice, readbackBuffer, nullptr);
+	vkFreeMemory(pDevice->m_vkLogicalDevice, readbackBufferMemory, nullptr);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Readback of a RGBA32F cube into a CubeMipChain, face major like the CPU bakes
+inline void ReadbackCube(VulkanDevice* pDevice, VkImage image, uint32_t dimension, uint32_t levelCount, Texture::CubeMipChain& outCube)
+{
+	std::vector<uint8_t> vecData;
+	std::vector<VkDeviceSize> vecLevelOffsets;
+	ReadbackImage(pDevice, image, dimension, levelCount, 6, 4 * sizeof(float), vecData, vecLevelOffsets);
+
+	outCube.Allocate(dimension, levelCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const size_t faceBytes = static_cast<size_t>(outCube.GetLevelDimension(level)) * outCube.GetLevelDimension(level) * 4 * sizeof(float);
+		for (uint32_t face = 0; face < 6; ++face)
+			memcpy(outCube.GetLevel(face, level), &vecData[static_cast<size_t>(vecLevelOffsets[level]) + face * faceBytes], faceBytes);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Sum of the RGB differences over the sum of the reference, so dim texels can't blow it up
+inline float MeanRelativeError(const float* pValues, const float* pReference, size_t texelCount, uint32_t valueStride, uint32_t referenceStride,
+							   uint32_t channels)
+{
+	double difference = 0.0, reference = 0.0;
+	for (size_t texel = 0; texel < texelCount; ++texel)
+	{
+		for (uint32_t c = 0; c < channels; ++c)
+		{
+			difference += std::fabs(pValues[texel * valueStride + c] - pReference[texel * referenceStride + c]);
+			reference += std::fabs(pReference[texel * referenceStride + c]);
+		}
+	}
+
+	return reference > 0.0 ? static_cast<float>(difference / reference) : static_cast<float>(difference);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<ComputeIBLReport> VulkanComputeIBL::RunComputeIBLValidation(VulkanDevice* pDevice)
+{
+	std::vector<ComputeIBLReport> vecReports;
+
+	VulkanComputeIBL computeIBL;
+	if (!computeIBL.Initialize(pDevice))
+	{
+		computeIBL.Cleanup(pDevice);
+		return vecReports;
+	}
+
+	const uint32_t sourceWidth = 512;
+	const uint32_t sourceHeight = 256;
+
+	// Sky gradient with a soft sun, bright enough to show up in every level without the fireflies a point sun gives
+	std::vector<float> vecEquirect(static_cast<size_t>(sourceWidth) * sourceHeight * 4);
+	const glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 0.6f, -0.7f));
+	JobSystem::getInstance().ParallelFor(sourceHeight, 16, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t y = begin; y < end; ++y)
+		{
+			for (uint32_t x = 0; x < sourceWidth; ++x)
+			{
+				const glm::vec3 direction = Texture::EquirectDirection((x + 0.5f) / sourceWidth, (y + 0.5f) / sourceHeight);
+				const float height = direction.y;
+				glm::vec3 radiance = height >= 0.0f ? glm::mix(glm::vec3(1.0f, 0.9f, 0.8f), glm::vec3(0.3f, 0.5f, 1.0f), std::sqrt(height))
+													: glm::mix(glm::vec3(1.0f, 0.9f, 0.8f), glm::vec3(0.25f, 0.2f, 0.15f), std::sqrt(-height));
+				radiance += glm::vec3(20.0f, 18.0f, 16.0f) * std::pow(std::max(glm::dot(direction, sunDirection), 0.0f), 64.0f);
+
+				float* pTexel = &vecEquirect[(static_cast<size_t>(y) * sourceWidth + x) * 4];
+				pTexel[0] = radiance.x;
+				pTexel[1] = radiance.y;
+				pTexel[2] = radiance.z;
+				pTexel[3] = 1.0f;
+			}
+		}
+	});
+
+	struct ValidationCase
+	{
+		const char*			name;
+		uint32_t			dimension;
+		bool				bSourceMipSelection;
+	};
+	const ValidationCase arrCases[2] = { { "Sky", 64, true }, { "Sky, level 0 only", 64, false } };
+
+	for (const ValidationCase& validationCase : arrCases)
+	{
+		Texture::IBLBakeSettings settings;
+		settings.environmentDimension = validationCase.dimension * 2;
+		settings.prefilter.dimension = validationCase.dimension;
+		settings.prefilter.minSamples = 16;
+		settings.prefilter.maxSamples = 128;
+		settings.prefilter.bSourceMipSelection = validationCase.bSourceMipSelection;
+		settings.brdfDimension = 64;
+		settings.brdfSamples = 256;
+
+		VulkanTextureCUBE cube;
+		ComputeIBLReport report = {};
+		if (!computeIBL.Bake(pDevice, vecEquirect.data(), sourceWidth, sourceHeight, settings, &cube, &report))
+		{
+			cube.Cleanup(pDevice);
+			continue;
+		}
+
+		report.name = validationCase.name;
+
+		//--- CPU bakes of the same settings
+		Texture::CubeMipChain cpuEnvironment;
+		Texture::EquirectToCubeMipChain(vecEquirect.data(), sourceWidth, sourceHeight, settings.environmentDimension, cpuEnvironment);
+
+		Texture::CubeMipChain cpuPrefiltered;
+		Texture::BakePrefilteredSpecular(cpuEnvironment, settings.prefilter, cpuPrefiltered);
+
+		std::vector<float> vecCpuBrdf;
+		Texture::BakeBrdfLUT(settings.brdfDimension, settings.brdfSamples, vecCpuBrdf);
+
+		//--- GPU results
+		Texture::CubeMipChain gpuEnvironment;
+		ReadbackCube(pDevice, cube.m_vkImageCUBE, settings.environmentDimension, cpuEnvironment.mipLevels, gpuEnvironment);
+
+		Texture::CubeMipChain gpuPrefiltered;
+		ReadbackCube(pDevice, cube.m_vkImagePrefilterSpec, settings.prefilter.dimension, report.prefilterLevels, gpuPrefiltered);
+
+		std::vector<uint8_t> vecBrdfData;
+		std::vector<VkDeviceSize> vecBrdfOffsets;
+		ReadbackImage(pDevice, cube.m_vkImageBRDF, settings.brdfDimension, 1, 1, 4 * sizeof(uint16_t), vecBrdfData, vecBrdfOffsets);
+
+		const size_t brdfTexels = static_cast<size_t>(settings.brdfDimension) * settings.brdfDimension;
+		std::vector<float> vecGpuBrdf(brdfTexels * 4);
+		const uint16_t* pHalf = reinterpret_cast<const uint16_t*>(vecBrdfData.data());
+		for (size_t i = 0; i < vecGpuBrdf.size(); ++i)
+			vecGpuBrdf[i] = Texture::HalfToFloat(pHalf[i]);
+
+		// Both chains are face major with matching offsets, the whole allocation compares in one go
+		report.environmentError = MeanRelativeError(gpuEnvironment.vecData.data(), cpuEnvironment.vecData.data(), gpuEnvironment.vecData.size() / 4, 4, 4, 3);
+		report.prefilterError = cpuPrefiltered.mipLevels == gpuPrefiltered.mipLevels ?
+								MeanRelativeError(gpuPrefiltered.vecData.data(), cpuPrefiltered.vecData.data(), gpuPrefiltered.vecData.size() / 4, 4, 4, 3) : 1.0f;
+		report.brdfError = MeanRelativeError(vecGpuBrdf.data(), vecCpuBrdf.data(), brdfTexels, 4, 2, 2);
+
+		// Filtering hardware, half floats & the supersampled environment levels leave some difference, broken indexing a lot more
+		report.bValid = report.environmentError < 0.05f && report.prefilterError < 0.05f && report.brdfError < 0.01f;
+
+		LOG_INFO("Compute IBL validation {0}: environment {1} error {2:.3f}%, prefiltered {3} x {4} error {5:.3f}%, BRDF LUT {6} error {7:.3f}%, {8}",
+				 report.name, report.environmentDimension, report.environmentError * 100.0f, report.prefilterDimension, report.prefilterLevels,
+				 report.prefilterError * 100.0f, report.brdfDimension, report.brdfError * 100.0f, report.bValid ? "valid" : "INVALID");
+
+		vecReports.push_back(report);
+
+		cube.Cleanup(pDevice);
+	}
+
+	computeIBL.Cleanup(pDevice);
+
+	return vecReports;
+}
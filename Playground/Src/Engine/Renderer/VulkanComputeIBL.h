@@ -0,0 +1,89 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "Engine/Texture/IBLCache.h"
+
+class VulkanDevice;
+class VulkanComputePipeline;
+class VulkanTextureCUBE;
+
+const uint32_t IBL_COMPUTE_TILE = 8;					// Workgroups are IBL_COMPUTE_TILE^2 texel tiles, IBL_TILE in iblCompute.glsl
+const uint32_t IBL_COMPUTE_MAX_LEVELS = 13;				// Storage views per cube stage, 4096 faces at most
+const uint32_t IBL_COMPUTE_GROUPS_PER_ROW = 1024;		// Width of the 2D dispatch, keeps y far below maxComputeWorkGroupCount
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Push constants of every IBL compute stage, layout of IBLComputePush in iblCompute.glsl. groupOffsets[level] is the
+//--- first workgroup of a level, groupOffsets[levelCount] the total, so one dispatch covers every face & level.
+struct IBLComputePushData
+{
+	uint32_t							levelCount;
+	uint32_t							dimension;
+	uint32_t							sourceWidth;
+	uint32_t							sourceHeight;
+	uint32_t							sourceLevels;
+	uint32_t							minSamples;
+	uint32_t							maxSamples;
+	uint32_t							groupsPerRow;
+	uint32_t							groupOffsets[16];
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct ComputeIBLReport
+{
+	std::string							name;
+	uint32_t							environmentDimension;
+	uint32_t							prefilterDimension;
+	uint32_t							prefilterLevels;
+	uint32_t							brdfDimension;
+	uint32_t							dispatchCount;
+	float								setupMs;					// Equirect mips, images, views & descriptors
+	float								environmentGpuMs;			// Timestamps, 0 when the queue can't write them
+	float								prefilterGpuMs;
+	float								brdfGpuMs;
+	float								totalMs;
+	float								environmentError;			// Mean relative difference to the CPU bakes, validation only
+	float								prefilterError;
+	float								brdfError;
+	bool								bValid;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- HDRI->Cube, prefiltered specular & BRDF LUT as three compute dispatches writing storage images, no render passes or
+//--- framebuffers. Only core features are used, no extended storage formats & no dynamic indexing of storage image arrays.
+//--- Initialize returns false when the .comp.spv files haven't been compiled.
+class VulkanComputeIBL
+{
+public:
+	VulkanComputeIBL();
+	~VulkanComputeIBL();
+
+	bool								Initialize(VulkanDevice* pDevice);
+
+	// Creates the environment, prefiltered & BRDF images & views of pOutCube & fills them in a single submit. Samplers &
+	// irradiance are left to the caller.
+	bool								Bake(VulkanDevice* pDevice, const float* pRGBA, uint32_t width, uint32_t height,
+											 const Texture::IBLBakeSettings& settings, VulkanTextureCUBE* pOutCube, ComputeIBLReport* pOutReport = nullptr);
+
+	void								Cleanup(VulkanDevice* pDevice);
+
+	// Synthetic sky through both paths at small sizes, the GPU results read back & compared against the CPU bakes
+	static std::vector<ComputeIBLReport> RunComputeIBLValidation(VulkanDevice* pDevice);
+
+private:
+	// Workgroup offsets of a cube stage, returns the workgroup count
+	static uint32_t						FillCubeDispatch(uint32_t dimension, uint32_t levelCount, IBLComputePushData& outPush);
+
+	VkDescriptorSetLayout				CreateDescriptorSetLayout(VulkanDevice* pDevice, bool bCubeStage);
+
+private:
+	VulkanComputePipeline*				m_pComputePipelineEnvironment;
+	VulkanComputePipeline*				m_pComputePipelinePrefilter;
+	VulkanComputePipeline*				m_pComputePipelineBrdfLUT;
+
+	VkDescriptorSetLayout				m_vkDescSetLayoutCube;			// Sampled source + IBL_COMPUTE_MAX_LEVELS storage views
+	VkDescriptorSetLayout				m_vkDescSetLayoutBrdf;
+
+	VkQueryPool							m_vkQueryPoolTimestamps;		// VK_NULL_HANDLE without timestampComputeAndGraphics
+	float								m_fTimestampPeriod;
+};
@@ -0,0 +1,82 @@
+#include "PlaygroundPCH.h"
+#include "VulkanComputePipeline.h"
+
+#include "VulkanDevice.h"
+
+#include "Engine/Helpers/Utility.h"
+#include "Engine/Helpers/Log.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanComputePipeline::VulkanComputePipeline(const std::string& computeShader)
+{
+	m_vkPipelineLayout = VK_NULL_HANDLE;
+	m_vkComputePipeline = VK_NULL_HANDLE;
+
+	m_strComputeShader = computeShader;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanComputePipeline::~VulkanComputePipeline()
+{
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanComputePipeline::CreatePipelineLayout(VulkanDevice* pDevice, const std::vector<VkDescriptorSetLayout>& layouts,
+												 const std::vector<VkPushConstantRange> pushConstantRanges)
+{
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+	pipelineLayoutCreateInfo.pSetLayouts = layouts.data();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	if (vkCreatePipelineLayout(pDevice->m_vkLogicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_vkPipelineLayout) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create compute Pipeline layout for {0}!", m_strComputeShader);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanComputePipeline::CreateComputePipeline(VulkanDevice* pDevice)
+{
+	VkShaderModule computeShaderModule = Vulkan::CreateShaderModule(pDevice, m_strComputeShader);
+	if (computeShaderModule == VK_NULL_HANDLE)
+		return false;
+
+	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {};
+	shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStageCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStageCreateInfo.module = computeShaderModule;
+	shaderStageCreateInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage = shaderStageCreateInfo;
+	pipelineCreateInfo.layout = m_vkPipelineLayout;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkResult result = vkCreateComputePipelines(pDevice->m_vkLogicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_vkComputePipeline);
+
+	// Module isn't needed once the pipeline exists
+	vkDestroyShaderModule(pDevice->m_vkLogicalDevice, computeShaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create compute Pipeline for {0}!", m_strComputeShader);
+		return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanComputePipeline::Cleanup(VulkanDevice* pDevice)
+{
+	vkDestroyPipeline(pDevice->m_vkLogicalDevice, m_vkComputePipeline, nullptr);
+	vkDestroyPipelineLayout(pDevice->m_vkLogicalDevice, m_vkPipelineLayout, nullptr);
+
+	m_vkComputePipeline = VK_NULL_HANDLE;
+	m_vkPipelineLayout = VK_NULL_HANDLE;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+class VulkanDevice;
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- A compute shader & its layout. No render pass, no fixed function state, the shader is the whole pipeline.
+class VulkanComputePipeline
+{
+public:
+	VulkanComputePipeline(const std::string& computeShader);
+	~VulkanComputePipeline();
+
+	void												CreatePipelineLayout(VulkanDevice* pDevice, const std::vector<VkDescriptorSetLayout>& layouts, 
+																			const std::vector<VkPushConstantRange> pushConstantRanges);
+
+	bool												CreateComputePipeline(VulkanDevice* pDevice);
+
+	void												Cleanup(VulkanDevice* pDevice);
+
+public:
+	VkPipeline											m_vkComputePipeline;
+	VkPipelineLayout									m_vkPipelineLayout;
+
+private:
+	std::string											m_strComputeShader;
+};
@@ -3,6 +3,9 @@
 
 #include "PlaygroundHeaders.h"
 #include "Engine/Helpers/Utility.h"
+#include "VulkanMemoryAllocator.h"
+
+const VkDeviceSize DEVICE_ADDRESS_ALIGNMENT = 256;		// Acceleration structure offsets, covers scratch & SBT base alignment
 
 //---------------------------------------------------------------------------------------------------------------------
 VulkanDevice::VulkanDevice(VkInstance instance, VkSurfaceKHR surface)
@@ -21,16 +24,32 @@ VulkanDevice::VulkanDevice(VkInstance instance, VkSurfaceKHR surface)
 	m_vkDeviceMemoryProps = {};
 	m_vkQueueGraphics = nullptr;
 	m_vkQueuePresent = nullptr;
+	m_vkQueueTransfer = nullptr;
+	m_vkQueueCompute = nullptr;
 
 	m_vkLogicalDevice = nullptr;
 	m_vkCommandPoolGraphics = nullptr;
 	m_pQueueFamilyIndices = nullptr;
+	m_pMemoryBackend = nullptr;
+	m_pMemoryAllocator = nullptr;
+	m_pUploader = nullptr;
+	m_bDescriptorIndexing = false;
+	m_bTimelineSemaphore = false;
+	m_bHostQueryReset = false;
+
+	m_vkCommandPoolCompute = VK_NULL_HANDLE;
+	m_vkTimelineGraphics = VK_NULL_HANDLE;
+	m_uiTimelineGraphics = 0;
+	m_vkTimelineCompute = VK_NULL_HANDLE;
+	m_uiTimelineCompute = 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 VulkanDevice::~VulkanDevice()
 {
 	SAFE_DELETE(m_pQueueFamilyIndices);
+	SAFE_DELETE(m_pMemoryAllocator);
+	SAFE_DELETE(m_pMemoryBackend);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -153,10 +172,12 @@ void VulkanDevice::FindQueueFamilies(VkPhysicalDevice device)
 	m_pQueueFamilyIndices = new QueueFamilyIndices();
 
 	// VkQueueFamilyProperties contains details about the queue family. We need to find at least one
-	// queue family that supports VK_QUEUE_GRAPHICS_BIT
+	// queue family that supports VK_QUEUE_GRAPHICS_BIT, the first family of each kind wins
 	for (int i = 0; i < queueFamilyCount; ++i)
 	{
-		if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		const VkQueueFlags queueFlags = queueFamilies[i].queueFlags;
+
+		if ((queueFlags & VK_QUEUE_GRAPHICS_BIT) && !m_pQueueFamilyIndices->m_uiGraphicsFamily.has_value())
 		{
 			m_pQueueFamilyIndices->m_uiGraphicsFamily = i;
 		}
@@ -166,13 +187,23 @@ void VulkanDevice::FindQueueFamilies(VkPhysicalDevice device)
 		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_vkSurface, &bPresentSupport);
 
 		// if yes, store presentation family queue index!
-		if (bPresentSupport)
+		if (bPresentSupport && !m_pQueueFamilyIndices->m_uiPresentFamily.has_value())
 		{
 			m_pQueueFamilyIndices->m_uiPresentFamily = i;
 		}
 
-		if (m_pQueueFamilyIndices->isComplete())
-			break;
+		// Copy engines, transfer without graphics & compute
+		if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+			!m_pQueueFamilyIndices->m_uiTransferFamily.has_value())
+		{
+			m_pQueueFamilyIndices->m_uiTransferFamily = i;
+		}
+
+		// Async compute, compute without graphics
+		if ((queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFlags & VK_QUEUE_GRAPHICS_BIT) && !m_pQueueFamilyIndices->m_uiComputeFamily.has_value())
+		{
+			m_pQueueFamilyIndices->m_uiComputeFamily = i;
+		}
 	}
 }
 
@@ -181,6 +212,35 @@ void VulkanDevice::CreateLogicalDevice()
 {
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
 
+	// Timeline semaphores sync the transfer & compute queues with graphics, without them everything stays on graphics
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreSupport = {};
+	timelineSemaphoreSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+	// Lets the uploader reset its timestamps from the host, vkCmdResetQueryPool isn't supported on transfer queues
+	VkPhysicalDeviceHostQueryResetFeatures hostQueryResetSupport = {};
+	hostQueryResetSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
+	hostQueryResetSupport.pNext = &timelineSemaphoreSupport;
+
+	// Bindless material textures, one update after bind array indexed by material (see VulkanMaterialTable)
+	VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingSupport = {};
+	descriptorIndexingSupport.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	descriptorIndexingSupport.pNext = &hostQueryResetSupport;
+
+	VkPhysicalDeviceFeatures2 supportedFeatures2 = {};
+	supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures2.pNext = &descriptorIndexingSupport;
+	vkGetPhysicalDeviceFeatures2(m_vkPhysicalDevice, &supportedFeatures2);
+
+	m_bTimelineSemaphore = timelineSemaphoreSupport.timelineSemaphore;
+	m_bHostQueryReset = hostQueryResetSupport.hostQueryReset;
+
+	if (!m_bTimelineSemaphore)
+	{
+		LOG_WARNING("No timeline semaphores, uploads & acceleration structure builds stay on the graphics queue");
+		m_pQueueFamilyIndices->m_uiTransferFamily.reset();
+		m_pQueueFamilyIndices->m_uiComputeFamily.reset();
+	}
+
 	// std::set allows only One unique value for input values, no duplicate is allowed, so if both Graphics Queue family
 	// and Presentation Queue family index is same then it will avoid the duplicates and assign only one queue index!
 	std::set<uint32_t> uniqueQueueFamilies =
@@ -189,9 +249,15 @@ void VulkanDevice::CreateLogicalDevice()
 		m_pQueueFamilyIndices->m_uiPresentFamily.value()
 	};
 
+	if (HasTransferQueue())
+		uniqueQueueFamilies.insert(m_pQueueFamilyIndices->m_uiTransferFamily.value());
+
+	if (HasComputeQueue())
+		uniqueQueueFamilies.insert(m_pQueueFamilyIndices->m_uiComputeFamily.value());
+
 	float queuePriority = 1.0f;
 
-	for (uint32_t queueFamily = 0; queueFamily < uniqueQueueFamilies.size(); ++queueFamily)
+	for (uint32_t queueFamily : uniqueQueueFamilies)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo{};
 		queueCreateInfo.flags = 0;
@@ -215,7 +281,38 @@ void VulkanDevice::CreateLogicalDevice()
 	bufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
 	bufferDeviceAddressFeatures.bufferDeviceAddressCaptureReplay = VK_FALSE;
 	bufferDeviceAddressFeatures.bufferDeviceAddressMultiDevice = VK_FALSE;
-	bufferDeviceAddressFeatures.pNext = nullptr;
+
+	// Compiled textures & compressed IBL cubes, loaders still check the format before picking a BC container
+	deviceFeatures.textureCompressionBC = supportedFeatures2.features.textureCompressionBC;
+
+	m_bDescriptorIndexing = descriptorIndexingSupport.shaderSampledImageArrayNonUniformIndexing &&
+							descriptorIndexingSupport.runtimeDescriptorArray &&
+							descriptorIndexingSupport.descriptorBindingPartiallyBound &&
+							descriptorIndexingSupport.descriptorBindingVariableDescriptorCount &&
+							descriptorIndexingSupport.descriptorBindingSampledImageUpdateAfterBind &&
+							descriptorIndexingSupport.descriptorBindingUpdateUnusedWhilePending;
+
+	VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures = {};
+	descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+	descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = m_bDescriptorIndexing;
+	descriptorIndexingFeatures.runtimeDescriptorArray = m_bDescriptorIndexing;
+	descriptorIndexingFeatures.descriptorBindingPartiallyBound = m_bDescriptorIndexing;
+	descriptorIndexingFeatures.descriptorBindingVariableDescriptorCount = m_bDescriptorIndexing;
+	descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = m_bDescriptorIndexing;
+	descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = m_bDescriptorIndexing;
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	timelineSemaphoreFeatures.timelineSemaphore = m_bTimelineSemaphore;
+
+	VkPhysicalDeviceHostQueryResetFeatures hostQueryResetFeatures = {};
+	hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES;
+	hostQueryResetFeatures.hostQueryReset = m_bHostQueryReset;
+	hostQueryResetFeatures.pNext = &timelineSemaphoreFeatures;
+
+	descriptorIndexingFeatures.pNext = &hostQueryResetFeatures;
+
+	bufferDeviceAddressFeatures.pNext = &descriptorIndexingFeatures;
 
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR rayTracingPipelineFeatures = {};
 	rayTracingPipelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR;
@@ -268,7 +365,82 @@ void VulkanDevice::CreateLogicalDevice()
 	vkGetDeviceQueue(m_vkLogicalDevice, m_pQueueFamilyIndices->m_uiGraphicsFamily.value(), 0, &m_vkQueueGraphics);
 	vkGetDeviceQueue(m_vkLogicalDevice, m_pQueueFamilyIndices->m_uiPresentFamily.value(), 0, &m_vkQueuePresent);
 
+	// Uploads & acceleration structure builds fall back to the graphics queue
+	m_vkQueueTransfer = m_vkQueueGraphics;
+	m_vkQueueCompute = m_vkQueueGraphics;
+
+	m_vecBufferQueueFamilies = { m_pQueueFamilyIndices->m_uiGraphicsFamily.value() };
+
+	if (HasTransferQueue())
+	{
+		vkGetDeviceQueue(m_vkLogicalDevice, m_pQueueFamilyIndices->m_uiTransferFamily.value(), 0, &m_vkQueueTransfer);
+		m_vecBufferQueueFamilies.push_back(m_pQueueFamilyIndices->m_uiTransferFamily.value());
+	}
+
+	if (HasComputeQueue())
+	{
+		vkGetDeviceQueue(m_vkLogicalDevice, m_pQueueFamilyIndices->m_uiComputeFamily.value(), 0, &m_vkQueueCompute);
+		m_vecBufferQueueFamilies.push_back(m_pQueueFamilyIndices->m_uiComputeFamily.value());
+	}
+
 	LOG_INFO("Logical Device Created!");
+	LOG_INFO("Queue families: graphics {0}, transfer {1}, compute {2}", m_pQueueFamilyIndices->m_uiGraphicsFamily.value(),
+			 HasTransferQueue() ? std::to_string(m_pQueueFamilyIndices->m_uiTransferFamily.value()) : "shared",
+			 HasComputeQueue() ? std::to_string(m_pQueueFamilyIndices->m_uiComputeFamily.value()) : "shared");
+
+	CreateMemoryAllocator();
+	CreateComputeQueueObjects();
+	CreateStagingUploader();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- m_vkDeviceProperties holds whichever device got enumerated last, so the limits are queried for the picked one
+void VulkanDevice::CreateMemoryAllocator()
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &deviceProperties);
+
+	VulkanMemoryAllocatorCreateInfo createInfo = {};
+	vkGetPhysicalDeviceMemoryProperties(m_vkPhysicalDevice, &createInfo.memoryProperties);
+	createInfo.bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+	createInfo.nonCoherentAtomSize = deviceProperties.limits.nonCoherentAtomSize;
+	createInfo.maxMemoryAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+	createInfo.preferredBlockSize = 0;
+
+	m_pMemoryBackend = new VulkanMemoryBackend(m_vkLogicalDevice);
+	m_pMemoryAllocator = new VulkanMemoryAllocator(m_pMemoryBackend, createInfo);
+
+	LOG_DEBUG("Device memory allocator created, {0} memory types, {1} VkDeviceMemory objects at most", createInfo.memoryProperties.memoryTypeCount,
+			  createInfo.maxMemoryAllocationCount);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanDevice::CreateStagingUploader()
+{
+	m_pUploader = new VulkanStagingUploader();
+	m_pUploader->Init(this);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Graphics timeline is created either way, the compute pool & timeline only with an async compute family
+void VulkanDevice::CreateComputeQueueObjects()
+{
+	if (!m_bTimelineSemaphore)
+		return;
+
+	m_vkTimelineGraphics = CreateTimelineSemaphore("GraphicsTimeline");
+
+	if (!HasComputeQueue())
+		return;
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = m_pQueueFamilyIndices->m_uiComputeFamily.value();
+
+	VKRESULT_CHECK(vkCreateCommandPool(m_vkLogicalDevice, &commandPoolCreateInfo, nullptr, &m_vkCommandPoolCompute));
+
+	m_vkTimelineCompute = CreateTimelineSemaphore("ComputeTimeline");
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -432,6 +604,180 @@ void VulkanDevice::CreateBufferAndCopyData(VkDeviceSize bufferSize, VkBufferUsag
 	vkBindBufferMemory(m_vkLogicalDevice, *outBuffer, *outBufferMemory, 0);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//--- Create VkBuffer & place it in memory sub-allocated from the device's blocks
+void VulkanDevice::CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags bufferProperties,
+								VkBuffer* outBuffer, VulkanAllocation** outAllocation, const std::string& debugName,
+								const std::function<void(VkBuffer)>& onMoved)
+{
+	// Defragmentation copies movable buffers over to their new place
+	if (onMoved)
+		bufferUsageFlags |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = bufferSize;
+	bufferInfo.usage = bufferUsageFlags;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Written by the transfer queue, read by compute builds & graphics, no ownership transfers for buffers
+	if (m_vecBufferQueueFamilies.size() > 1)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(m_vecBufferQueueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = m_vecBufferQueueFamilies.data();
+	}
+
+	*outAllocation = nullptr;
+
+	if (vkCreateBuffer(m_vkLogicalDevice, &bufferInfo, nullptr, outBuffer) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create {0} buffer", debugName);
+		return;
+	}
+
+	Vulkan::SetDebugUtilsObjectName(m_vkLogicalDevice, VK_OBJECT_TYPE_BUFFER, reinterpret_cast<uint64_t>(*outBuffer), (debugName + "_buffer"));
+
+	// Requirements, along with whether the driver wants a VkDeviceMemory of its own for this buffer
+	VkMemoryDedicatedRequirements dedicatedRequirements = {};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 memRequirements = {};
+	memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	memRequirements.pNext = &dedicatedRequirements;
+
+	VkBufferMemoryRequirementsInfo2 memRequirementsInfo = {};
+	memRequirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	memRequirementsInfo.buffer = *outBuffer;
+
+	vkGetBufferMemoryRequirements2(m_vkLogicalDevice, &memRequirementsInfo, &memRequirements);
+
+	VulkanAllocationCreateInfo allocCreateInfo;
+	allocCreateInfo.requirements = memRequirements.memoryRequirements;
+	allocCreateInfo.properties = bufferProperties;
+	allocCreateInfo.eTiling = ResourceTiling::LINEAR;
+	allocCreateInfo.bDedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+	allocCreateInfo.dedicatedBuffer = allocCreateInfo.bDedicated ? *outBuffer : VK_NULL_HANDLE;
+
+	if (bufferUsageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+		allocCreateInfo.minAlignment = DEVICE_ADDRESS_ALIGNMENT;
+
+	*outAllocation = m_pMemoryAllocator->Allocate(allocCreateInfo);
+	if (*outAllocation == nullptr)
+	{
+		LOG_ERROR("Failed to allocate {0} buffer memory!", debugName);
+		return;
+	}
+
+	if (onMoved && !(*outAllocation)->bDedicated)
+	{
+		(*outAllocation)->bMovable = true;
+		(*outAllocation)->buffer = *outBuffer;
+		(*outAllocation)->onMoved = onMoved;
+		(*outAllocation)->bufferInfo = bufferInfo;
+	}
+
+	VKRESULT_CHECK(vkBindBufferMemory(m_vkLogicalDevice, *outBuffer, (*outAllocation)->memory, (*outAllocation)->offset));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//--- Sub-allocated buffer filled through its persistent mapping when host visible & coherent, through the staging ring
+//--- otherwise
+UploadToken VulkanDevice::CreateBufferAndCopyData(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags bufferProperties,
+												  VkBuffer* outBuffer, VulkanAllocation** outAllocation, void* inData, const std::string& debugName,
+												  const std::function<void(VkBuffer)>& onMoved)
+{
+	const bool bStaged = inData != nullptr && !(bufferProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	if (bStaged)
+		bufferUsageFlags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	CreateBuffer(bufferSize, bufferUsageFlags, bufferProperties, outBuffer, outAllocation, debugName, onMoved);
+
+	if (inData == nullptr || *outAllocation == nullptr)
+		return UPLOAD_TOKEN_NONE;
+
+	if (bStaged)
+	{
+		m_pUploader->UploadBuffer(*outBuffer, 0, inData, bufferSize);
+		return m_pUploader->Submit();
+	}
+
+	if ((*outAllocation)->pMapped == nullptr)
+	{
+		LOG_ERROR("{0} buffer memory isn't host visible, data not copied!", debugName);
+		return UPLOAD_TOKEN_NONE;
+	}
+
+	memcpy((*outAllocation)->pMapped, inData, bufferSize);
+
+	return UPLOAD_TOKEN_NONE;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VulkanDevice::DestroyBuffer(VkBuffer buffer, VulkanAllocation* pAllocation)
+{
+	vkDestroyBuffer(m_vkLogicalDevice, buffer, nullptr);
+	m_pMemoryAllocator->Free(pAllocation);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//--- Every move gets a new buffer bound at its reserved place & a copy from the old one, all in one submit. Old buffers
+//--- go once the copies are done, the allocations keep the new handles & pass them on to their owners' onMoved.
+uint32_t VulkanDevice::DefragmentMemory(uint32_t maxMoves)
+{
+	// Recorded uploads still name the current handles, they have to reach the queue first
+	m_pUploader->Submit();
+	m_pUploader->WaitIdle();
+
+	vkDeviceWaitIdle(m_vkLogicalDevice);
+
+	// Scratch & instance buffers of finished builds leave the holes the moves fill
+	ReleaseCompletedCompute();
+
+	const std::vector<VulkanDefragmentationMove> vecMoves = m_pMemoryAllocator->BeginDefragmentation(maxMoves);
+	if (vecMoves.empty())
+	{
+		m_pMemoryAllocator->EndDefragmentation(vecMoves);
+		return 0;
+	}
+
+	std::vector<VkBuffer> vecNewBuffers(vecMoves.size(), VK_NULL_HANDLE);
+
+	VkCommandBuffer commandBuffer = BeginCommandBuffer("Defragmentation");
+
+	for (size_t i = 0; i < vecMoves.size(); ++i)
+	{
+		const VulkanAllocation* pAllocation = vecMoves[i].pAllocation;
+
+		VKRESULT_CHECK(vkCreateBuffer(m_vkLogicalDevice, &pAllocation->bufferInfo, nullptr, &vecNewBuffers[i]));
+		VKRESULT_CHECK(vkBindBufferMemory(m_vkLogicalDevice, vecNewBuffers[i], vecMoves[i].dstMemory, vecMoves[i].dstOffset));
+
+		VkBufferCopy bufferCopyRegion = {};
+		bufferCopyRegion.srcOffset = 0;
+		bufferCopyRegion.dstOffset = 0;
+		bufferCopyRegion.size = pAllocation->bufferInfo.size;
+
+		vkCmdCopyBuffer(commandBuffer, pAllocation->buffer, vecNewBuffers[i], 1, &bufferCopyRegion);
+	}
+
+	EndAndSubmitCommandBuffer(commandBuffer);
+
+	for (size_t i = 0; i < vecMoves.size(); ++i)
+	{
+		VulkanAllocation* pAllocation = vecMoves[i].pAllocation;
+
+		vkDestroyBuffer(m_vkLogicalDevice, pAllocation->buffer, nullptr);
+		pAllocation->buffer = vecNewBuffers[i];
+		pAllocation->onMoved(vecNewBuffers[i]);
+	}
+
+	m_pMemoryAllocator->EndDefragmentation(vecMoves);
+
+	LOG_DEBUG("Defragmentation moved {0} buffers", vecMoves.size());
+
+	return static_cast<uint32_t>(vecMoves.size());
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //--- Begin Command buffer for recording commands! 
 VkCommandBuffer VulkanDevice::BeginCommandBuffer(const std::string& debugName)
@@ -490,11 +836,11 @@ void VulkanDevice::EndAndSubmitCommandBuffer(VkCommandBuffer commandBuffer)
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//--- Generic Copy buffer from srcBuffer to dstBuffer using transferQueue & transferCommandPool of specific size
-void VulkanDevice::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
+//--- Generic Copy buffer from srcBuffer to dstBuffer, batched with whatever else the uploader has recorded
+UploadToken VulkanDevice::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
 {
-	// Create buffer
-	VkCommandBuffer transferCommandBuffer = BeginCommandBuffer();
+	// Open batch of the uploader, no command buffer of its own & no vkQueueWaitIdle
+	VkCommandBuffer transferCommandBuffer = m_pUploader->GetCommandBuffer();
 
 	// Region of data to copy from and to 
 	VkBufferCopy bufferCopyRegion = {};
@@ -505,7 +851,242 @@ void VulkanDevice::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSi
 	// Command to copy src buffer to dst buffer
 	vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
 
-	EndAndSubmitCommandBuffer(transferCommandBuffer);
+	return m_pUploader->Submit();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VkSemaphore VulkanDevice::CreateTimelineSemaphore(const std::string& debugName)
+{
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo = {};
+	semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &semaphoreTypeInfo;
+
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	VKRESULT_CHECK(vkCreateSemaphore(m_vkLogicalDevice, &semaphoreInfo, nullptr, &semaphore));
+
+	Vulkan::SetDebugUtilsObjectName(m_vkLogicalDevice, VK_OBJECT_TYPE_SEMAPHORE, reinterpret_cast<uint64_t>(semaphore), debugName);
+
+	return semaphore;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//--- A wait covers every command submitted to the queue after it, so nothing has to be added to the frame's submit
+void VulkanDevice::QueueWaitTimeline(VkQueue queue, VkSemaphore timeline, uint64_t value)
+{
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 1;
+	timelineInfo.pWaitSemaphoreValues = &value;
+
+	const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = &timeline;
+	submitInfo.pWaitDstStageMask = &waitStage;
+
+	VKRESULT_CHECK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//--- 0 without timeline semaphores, compute submits then have no graphics value to wait for & run on the graphics queue
+uint64_t VulkanDevice::SignalGraphicsTimeline()
+{
+	if (m_vkTimelineGraphics == VK_NULL_HANDLE)
+		return 0;
+
+	const uint64_t value = ++m_uiTimelineGraphics;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &m_vkTimelineGraphics;
+
+	VKRESULT_CHECK(vkQueueSubmit(m_vkQueueGraphics, 1, &submitInfo, VK_NULL_HANDLE));
+
+	return value;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+VkCommandBuffer VulkanDevice::BeginComputeCommandBuffer(const std::string& debugName)
+{
+	if (!HasComputeQueue())
+		return BeginCommandBuffer(debugName);
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = m_vkCommandPoolCompute;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	VKRESULT_CHECK(vkAllocateCommandBuffers(m_vkLogicalDevice, &allocInfo, &commandBuffer));
+
+	Vulkan::SetDebugUtilsObjectName(m_vkLogicalDevice, VK_OBJECT_TYPE_COMMAND_BUFFER, reinterpret_cast<uint64_t>(commandBuffer), (debugName + "_computeCommandBuffer"));
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VKRESULT_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+	// Builds submitted earlier to this queue wrote the BLASes or the TLAS this one reads
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+	memoryBarrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+						 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+	return commandBuffer;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//--- Compute waits on the uploader's timeline & the graphics timeline, graphics waits on the compute timeline. The CPU
+//--- doesn't wait on anything, unlike EndAndSubmitCommandBuffer which idles the graphics queue.
+uint64_t VulkanDevice::SubmitComputeCommandBuffer(VkCommandBuffer commandBuffer, uint64_t graphicsValue)
+{
+	// Recorded uploads reach their queue first, the build may read them
+	const UploadToken uploadToken = m_pUploader->Submit();
+
+	if (!HasComputeQueue())
+	{
+		EndAndSubmitCommandBuffer(commandBuffer);
+		return 0;
+	}
+
+	VKRESULT_CHECK(vkEndCommandBuffer(commandBuffer));
+
+	std::array<VkSemaphore, 2> arrWaitSemaphores = {};
+	std::array<uint64_t, 2> arrWaitValues = {};
+	std::array<VkPipelineStageFlags, 2> arrWaitStages = {};
+	uint32_t waitCount = 0;
+
+	if (uploadToken != UPLOAD_TOKEN_NONE)
+	{
+		arrWaitSemaphores[waitCount] = m_pUploader->GetTimeline();
+		arrWaitValues[waitCount] = uploadToken;
+		arrWaitStages[waitCount] = VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+		++waitCount;
+	}
+
+	// Graphics submitted up to the value may still read what gets rebuilt in place
+	if (graphicsValue != 0)
+	{
+		arrWaitSemaphores[waitCount] = m_vkTimelineGraphics;
+		arrWaitValues[waitCount] = graphicsValue;
+		arrWaitStages[waitCount] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		++waitCount;
+	}
+
+	const uint64_t computeValue = ++m_uiTimelineCompute;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = waitCount;
+	timelineInfo.pWaitSemaphoreValues = arrWaitValues.data();
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &computeValue;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = arrWaitSemaphores.data();
+	submitInfo.pWaitDstStageMask = arrWaitStages.data();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &m_vkTimelineCompute;
+
+	VKRESULT_CHECK(vkQueueSubmit(m_vkQueueCompute, 1, &submitInfo, VK_NULL_HANDLE));
+
+	QueueWaitTimeline(m_vkQueueGraphics, m_vkTimelineCompute, computeValue);
+
+	ReleaseCompletedCompute();
+	m_vecComputeReleases.push_back({ computeValue, commandBuffer, VK_NULL_HANDLE, nullptr });
+
+	return computeValue;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VulkanDevice::IsComputeComplete(uint64_t computeValue)
+{
+	if (computeValue == 0)
+		return true;
+
+	uint64_t completedValue = 0;
+	VKRESULT_CHECK(vkGetSemaphoreCounterValue(m_vkLogicalDevice, m_vkTimelineCompute, &completedValue));
+
+	return completedValue >= computeValue;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VulkanDevice::WaitCompute(uint64_t computeValue)
+{
+	if (computeValue == 0)
+		return;
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_vkTimelineCompute;
+	waitInfo.pValues = &computeValue;
+
+	VKRESULT_CHECK(vkWaitSemaphores(m_vkLogicalDevice, &waitInfo, UINT64_MAX));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VulkanDevice::DestroyBufferAfterCompute(VkBuffer buffer, VulkanAllocation* pAllocation, uint64_t computeValue)
+{
+	if (IsComputeComplete(computeValue))
+	{
+		DestroyBuffer(buffer, pAllocation);
+		return;
+	}
+
+	m_vecComputeReleases.push_back({ computeValue, VK_NULL_HANDLE, buffer, pAllocation });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+void VulkanDevice::ReleaseCompletedCompute()
+{
+	if (m_vecComputeReleases.empty())
+		return;
+
+	uint64_t completedValue = 0;
+	VKRESULT_CHECK(vkGetSemaphoreCounterValue(m_vkLogicalDevice, m_vkTimelineCompute, &completedValue));
+
+	auto itRelease = m_vecComputeReleases.begin();
+	while (itRelease != m_vecComputeReleases.end())
+	{
+		if (itRelease->computeValue > completedValue)
+		{
+			++itRelease;
+			continue;
+		}
+
+		if (itRelease->commandBuffer != VK_NULL_HANDLE)
+			vkFreeCommandBuffers(m_vkLogicalDevice, m_vkCommandPoolCompute, 1, &itRelease->commandBuffer);
+		else
+			DestroyBuffer(itRelease->buffer, itRelease->pAllocation);
+
+		itRelease = m_vecComputeReleases.erase(itRelease);
+	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -517,6 +1098,28 @@ void VulkanDevice::Cleanup()
 	// Destroy command pool
 	vkDestroyCommandPool(m_vkLogicalDevice, m_vkCommandPoolGraphics, nullptr);
 
+	// Waits for the uploads in flight, the ring is one of the allocator's buffers
+	m_pUploader->Cleanup();
+	SAFE_DELETE(m_pUploader);
+
+	// Scratch & instance buffers of the last builds
+	if (HasComputeQueue())
+	{
+		WaitCompute(m_uiTimelineCompute);
+		ReleaseCompletedCompute();
+
+		vkDestroyCommandPool(m_vkLogicalDevice, m_vkCommandPoolCompute, nullptr);
+		vkDestroySemaphore(m_vkLogicalDevice, m_vkTimelineCompute, nullptr);
+	}
+
+	if (m_vkTimelineGraphics != VK_NULL_HANDLE)
+		vkDestroySemaphore(m_vkLogicalDevice, m_vkTimelineGraphics, nullptr);
+
+	// Every block & dedicated allocation, buffers still bound to them are reported as leaks
+	m_pMemoryAllocator->Cleanup();
+	SAFE_DELETE(m_pMemoryAllocator);
+	SAFE_DELETE(m_pMemoryBackend);
+
 	vkDestroyDevice(m_vkLogicalDevice, nullptr);
 }
 
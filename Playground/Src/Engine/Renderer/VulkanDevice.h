@@ -1,7 +1,11 @@
 #pragma once
 
 #include "vulkan/vulkan.h"
+#include "VulkanStagingUploader.h"
 
+struct VulkanAllocation;
+class VulkanMemoryAllocator;
+class IVulkanMemoryBackend;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Almost every operation in Vulkan, from drawing to uploading textures requires commands to be submitted to Queue. 
@@ -15,11 +19,17 @@ struct QueueFamilyIndices
 	{
 		m_uiGraphicsFamily.reset();
 		m_uiPresentFamily.reset();
+		m_uiTransferFamily.reset();
+		m_uiComputeFamily.reset();
 	}
 
 	std::optional<uint32_t> m_uiGraphicsFamily;
 	std::optional<uint32_t>	m_uiPresentFamily;
 
+	// Optional, families without graphics. Transfer only ones are the copy engines, compute only ones run next to graphics
+	std::optional<uint32_t>	m_uiTransferFamily;
+	std::optional<uint32_t>	m_uiComputeFamily;
+
 	bool isComplete() { return m_uiGraphicsFamily.has_value() && m_uiPresentFamily.has_value(); }
 };
 
@@ -33,6 +43,9 @@ public:
 	void								PickPhysicalDevice();
 	void								CreateLogicalDevice();
 
+	void								CreateMemoryAllocator();
+	void								CreateStagingUploader();
+	void								CreateComputeQueueObjects();
 	void								CreateGraphicsCommandPool();
 	void								CreateGraphicsCommandBuffers(uint32_t size);
 
@@ -45,11 +58,54 @@ public:
 	void								CreateBufferAndCopyData(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags, 
 																VkMemoryPropertyFlags bufferProperties, VkBuffer* outBuffer, 
 																VkDeviceMemory* outBufferMemory, void* data, const std::string& debugName = "");
+
+	// Sub-allocated from m_pMemoryAllocator, host visible allocations stay mapped through (*outAllocation)->pMapped.
+	// Passing onMoved makes the buffer movable: DefragmentMemory may recreate it at another place & hands the new
+	// handle to onMoved, which has to refresh every copy of the handle or its device address the owner keeps. Data for
+	// memory that isn't host visible goes through m_pUploader, the returned token completes once it's in place.
+	void								CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags,
+													 VkMemoryPropertyFlags bufferProperties, VkBuffer* outBuffer,
+													 VulkanAllocation** outAllocation, const std::string& debugName = "",
+													 const std::function<void(VkBuffer)>& onMoved = nullptr);
+
+	UploadToken							CreateBufferAndCopyData(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsageFlags,
+																VkMemoryPropertyFlags bufferProperties, VkBuffer* outBuffer,
+																VulkanAllocation** outAllocation, void* data, const std::string& debugName = "",
+																const std::function<void(VkBuffer)>& onMoved = nullptr);
+
+	void								DestroyBuffer(VkBuffer buffer, VulkanAllocation* pAllocation);
+
+	// Destroyed once the compute submit that returned computeValue is done, right away when it already is
+	void								DestroyBufferAfterCompute(VkBuffer buffer, VulkanAllocation* pAllocation, uint64_t computeValue);
+
+	// Waits for the device, moves up to maxMoves movable buffers with one copy submit, returns the number moved
+	uint32_t							DefragmentMemory(uint32_t maxMoves);
 	
 
 	VkCommandBuffer						BeginCommandBuffer(const std::string& debugName = "");
 	void								EndAndSubmitCommandBuffer(VkCommandBuffer commandBuffer);
-	void								CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize);
+
+	// Recorded into m_pUploader's open batch & submitted, srcBuffer has to stay alive until the token completes
+	UploadToken							CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize);
+
+	// Acceleration structure builds & other compute work for the async compute queue. The submit waits for every upload so
+	// far, for the graphics timeline to reach graphicsValue (0 skips it, see SignalGraphicsTimeline), & graphics work
+	// submitted after it waits for the result. Returns without waiting, the command buffer is released & whatever the work reads has to stay alive until
+	// IsComputeComplete. Without an async compute family it's BeginCommandBuffer & EndAndSubmitCommandBuffer, returning 0.
+	VkCommandBuffer						BeginComputeCommandBuffer(const std::string& debugName = "");
+	uint64_t							SubmitComputeCommandBuffer(VkCommandBuffer commandBuffer, uint64_t graphicsValue);
+	bool								IsComputeComplete(uint64_t computeValue);
+	void								WaitCompute(uint64_t computeValue);
+
+	bool								HasTransferQueue() const	{ return m_pQueueFamilyIndices->m_uiTransferFamily.has_value(); }
+	bool								HasComputeQueue() const		{ return m_pQueueFamilyIndices->m_uiComputeFamily.has_value(); }
+
+	VkSemaphore							CreateTimelineSemaphore(const std::string& debugName);
+
+	// Empty submits, later work on queue waits for the timeline to reach value / every earlier graphics submit signals,
+	// SignalGraphicsTimeline returns 0 when there are no timeline semaphores
+	void								QueueWaitTimeline(VkQueue queue, VkSemaphore timeline, uint64_t value);
+	uint64_t							SignalGraphicsTimeline();
 
 	void								Cleanup();
 	void								CleanupOnWindowResize();
@@ -57,6 +113,15 @@ public:
 private:
 	bool								CheckDeviceExtensionSupport(VkPhysicalDevice device);
 	void								FindQueueFamilies(VkPhysicalDevice device);
+	void								ReleaseCompletedCompute();
+
+	struct ComputeRelease
+	{
+		uint64_t						computeValue;
+		VkCommandBuffer					commandBuffer;			// Either the submitted command buffer or a buffer read by it
+		VkBuffer						buffer;
+		VulkanAllocation*				pAllocation;
+	};
 
 	VkInstance							m_vkInstance;
 
@@ -73,12 +138,34 @@ public:
 	VkDevice							m_vkLogicalDevice;
 
 	QueueFamilyIndices*					m_pQueueFamilyIndices;
+	IVulkanMemoryBackend*				m_pMemoryBackend;
+	VulkanMemoryAllocator*				m_pMemoryAllocator;
+	VulkanStagingUploader*				m_pUploader;
+	bool								m_bDescriptorIndexing;			// Every feature VulkanMaterialTable needs is enabled
+	bool								m_bTimelineSemaphore;
+	bool								m_bHostQueryReset;
+
+	// Buffers are shared concurrently between these, images change hands with queue family ownership transfers
+	std::vector<uint32_t>				m_vecBufferQueueFamilies;
 
 	VkCommandPool						m_vkCommandPoolGraphics;
 	std::vector<VkCommandBuffer>		m_vecCommandBufferGraphics;
 
 	VkQueue								m_vkQueueGraphics;
 	VkQueue								m_vkQueuePresent;
+	VkQueue								m_vkQueueTransfer;				// m_vkQueueGraphics without a transfer family
+	VkQueue								m_vkQueueCompute;				// m_vkQueueGraphics without a compute family
+
+private:
+	VkCommandPool						m_vkCommandPoolCompute;
+
+	// Values reached once everything submitted up to their signal is done
+	VkSemaphore							m_vkTimelineGraphics;
+	uint64_t							m_uiTimelineGraphics;
+	VkSemaphore							m_vkTimelineCompute;
+	uint64_t							m_uiTimelineCompute;
+
+	std::vector<ComputeRelease>			m_vecComputeReleases;
 };
 
 
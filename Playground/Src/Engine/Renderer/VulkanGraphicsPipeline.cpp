@@ -157,6 +157,11 @@ void VulkanGraphicsPipeline::CreateGraphicsPipeline(VulkanDevice* pDevice, Vulka
 	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
 
 	VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
+	std::vector<VkDynamicState> vecDynamicStates;
+
+	// Read by vkCreateGraphicsPipelines, so they have to outlive the switch
+	VkVertexInputBindingDescription skyboxBindingDescription = {};
+	VkVertexInputAttributeDescription skyboxAttributeDescription = {};
 
 	// Create default configuration for the pipeline!
 	PipelineConfigInfo m_sPipelineConfigInfo = {};
@@ -386,8 +391,77 @@ void VulkanGraphicsPipeline::CreateGraphicsPipeline(VulkanDevice* pDevice, Vulka
 
 			break;
 		}
+
+		case PipelineType::HDRI_CUBE:
+		case PipelineType::PREFILTER_SPEC:
+		{
+			m_strVertexShader = m_eType == PipelineType::HDRI_CUBE ? "Assets/Shaders/HDRI2Cube.vert.spv" : "Assets/Shaders/PreFilterCube.vert.spv";
+			m_strFragmentShader = m_eType == PipelineType::HDRI_CUBE ? "Assets/Shaders/HDRI2Cube.frag.spv" : "Assets/Shaders/PreFilterCube.frag.spv";
+
+			vertShaderModule = Vulkan::CreateShaderModule(pDevice, m_strVertexShader);
+			fragShaderModule = Vulkan::CreateShaderModule(pDevice, m_strFragmentShader);
+
+			//--- DummySkybox cube, positions only
+			skyboxBindingDescription.binding = 0;
+			skyboxBindingDescription.stride = sizeof(App::VertexP);
+			skyboxBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			skyboxAttributeDescription.binding = 0;
+			skyboxAttributeDescription.location = 0;
+			skyboxAttributeDescription.format = VkFormat::VK_FORMAT_R32G32B32_SFLOAT;
+			skyboxAttributeDescription.offset = offsetof(App::VertexP, Position);
+
+			vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+			vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 1;
+			vertexInputStateCreateInfo.pVertexAttributeDescriptions = &skyboxAttributeDescription;
+			vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
+			vertexInputStateCreateInfo.pVertexBindingDescriptions = &skyboxBindingDescription;
+			vertexInputStateCreateInfo.flags = 0;
+			vertexInputStateCreateInfo.pNext = nullptr;
+
+			// Camera sits inside the cube, every face renders & there is no depth attachment
+			m_sPipelineConfigInfo.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+			m_sPipelineConfigInfo.depthStencilInfo.depthTestEnable = VK_FALSE;
+			m_sPipelineConfigInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+			// Viewport shrinks with every mip level of the bake
+			vecDynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+			break;
+		}
+
+		case PipelineType::BRDF_LUT:
+		{
+			m_strVertexShader = "Assets/Shaders/BrdfLUT.vert.spv";
+			m_strFragmentShader = "Assets/Shaders/BrdfLUT.frag.spv";
+
+			vertShaderModule = Vulkan::CreateShaderModule(pDevice, m_strVertexShader);
+			fragShaderModule = Vulkan::CreateShaderModule(pDevice, m_strFragmentShader);
+
+			// Fullscreen triangle from the vertex index, no vertex data
+			vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+			vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
+			vertexInputStateCreateInfo.pVertexBindingDescriptions = nullptr;
+			vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
+			vertexInputStateCreateInfo.pVertexAttributeDescriptions = nullptr;
+
+			m_sPipelineConfigInfo.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+			m_sPipelineConfigInfo.depthStencilInfo.depthTestEnable = VK_FALSE;
+			m_sPipelineConfigInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+			vecDynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+			break;
+		}
 	}
 	
+	// Bake pipelines set viewport & scissor while recording
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(vecDynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = vecDynamicStates.data();
+
+	
 	//--- to actually use shaders, we need to assign them to a specific pipeline stage
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -410,8 +484,6 @@ void VulkanGraphicsPipeline::CreateGraphicsPipeline(VulkanDevice* pDevice, Vulka
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 
-	// Dynamic state (nullptr for now!)
-
 	// Finally, Create Graphics Pipeline!!!
 	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
 	graphicsPipelineCreateInfo.sType				=	VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -420,7 +492,7 @@ void VulkanGraphicsPipeline::CreateGraphicsPipeline(VulkanDevice* pDevice, Vulka
 	graphicsPipelineCreateInfo.pVertexInputState	=	&vertexInputStateCreateInfo;
 	graphicsPipelineCreateInfo.pInputAssemblyState	=	&m_sPipelineConfigInfo.inputAssemblyInfo;
 	graphicsPipelineCreateInfo.pViewportState		=	&m_sPipelineConfigInfo.viewportInfo;
-	graphicsPipelineCreateInfo.pDynamicState		=	nullptr;
+	graphicsPipelineCreateInfo.pDynamicState		=	vecDynamicStates.empty() ? nullptr : &dynamicStateCreateInfo;
 	graphicsPipelineCreateInfo.pRasterizationState	=	&m_sPipelineConfigInfo.rasterizationInfo;
 	graphicsPipelineCreateInfo.pMultisampleState	=	&m_sPipelineConfigInfo.multisampleInfo;
 	graphicsPipelineCreateInfo.pColorBlendState		=	&m_sPipelineConfigInfo.colorBlendInfo;
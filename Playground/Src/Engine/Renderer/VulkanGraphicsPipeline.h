@@ -9,7 +9,10 @@ enum class PipelineType
 {
 	GBUFFER_OPAQUE,
 	HDRI_SKYDOME,
-	DEFERRED
+	DEFERRED,
+	HDRI_CUBE,
+	PREFILTER_SPEC,
+	BRDF_LUT
 };
 
 struct PipelineConfigInfo
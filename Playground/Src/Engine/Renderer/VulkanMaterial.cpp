@@ -3,6 +3,8 @@
 
 #include "VulkanDevice.h"
 #include "VulkanTexture2D.h"
+#include "VulkanTextureCache.h"
+#include "VulkanMaterialTable.h"
 
 #include "PlaygroundHeaders.h"
 
@@ -10,6 +12,7 @@
 VulkanMaterial::VulkanMaterial()
 {
 	m_mapTextures.clear();
+	m_uiMaterialID = INVALID_BINDLESS_INDEX;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -22,20 +25,69 @@ VulkanMaterial::~VulkanMaterial()
 //---------------------------------------------------------------------------------------------------------------------
 void VulkanMaterial::LoadTexture(VulkanDevice* pDevice, const std::string& filePath, TextureType type)
 {
-	VulkanTexture2D* pTexture = new VulkanTexture2D();
-	pTexture->CreateTexture(pDevice, filePath, type);
+	// Fallback textures & textures shared between materials get loaded once
+	VulkanTexture2D* pTexture = VulkanTextureCache::getInstance().Acquire(pDevice, filePath, type);
 
-	m_mapTextures.emplace(type, pTexture);
+	// Only the first texture of a type gets bound, don't keep a reference to the others alive
+	if (!m_mapTextures.emplace(type, pTexture).second)
+		VulkanTextureCache::getInstance().Release(pDevice, pTexture);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Whole material in one go, textures decode in parallel & upload with a single submit
+void VulkanMaterial::LoadTextures(VulkanDevice* pDevice, const std::map<std::string, TextureType>& mapTextures)
+{
+	std::vector<TextureRequest> vecRequests;
+	std::map<TextureType, bool> mapRequestedTypes;
+
+	// Same rule as LoadTexture, only the first texture of a type gets bound so don't load the others at all
+	std::map<std::string, TextureType>::const_iterator iter = mapTextures.begin();
+	for (; iter != mapTextures.end(); ++iter)
+	{
+		if (m_mapTextures.count(iter->second) > 0 || !mapRequestedTypes.emplace(iter->second, true).second)
+			continue;
+
+		TextureRequest request;
+		request.fileName = iter->first;
+		request.eType = iter->second;
+		vecRequests.push_back(request);
+	}
+
+	std::vector<VulkanTexture2D*> vecTextures = VulkanTextureCache::getInstance().AcquireBatch(pDevice, vecRequests);
+	for (uint32_t i = 0; i < vecTextures.size(); ++i)
+	{
+		m_mapTextures.emplace(vecRequests[i].eType, vecTextures[i]);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Call once the textures are loaded, they go into the global texture array & the constants into the material table
+uint32_t VulkanMaterial::RegisterBindless(VulkanDevice* pDevice, const MaterialGPUData& constants)
+{
+	if (m_uiMaterialID != INVALID_BINDLESS_INDEX)
+	{
+		VulkanMaterialTable::getInstance().UpdateMaterial(m_uiMaterialID, constants);
+		return m_uiMaterialID;
+	}
+
+	m_uiMaterialID = VulkanMaterialTable::getInstance().RegisterMaterial(pDevice, m_mapTextures, constants);
+	return m_uiMaterialID;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void VulkanMaterial::Cleanup(VulkanDevice* pDevice)
 {
+	// Slots go before the textures, the cache may destroy them on release
+	VulkanMaterialTable::getInstance().ReleaseMaterial(pDevice, m_uiMaterialID);
+	m_uiMaterialID = INVALID_BINDLESS_INDEX;
+
 	std::map<TextureType, VulkanTexture2D*>::iterator iter = m_mapTextures.begin();
 	for (; iter != m_mapTextures.end(); ++iter)
 	{
-		iter->second->Cleanup(pDevice);
+		VulkanTextureCache::getInstance().Release(pDevice, iter->second);
 	}
+
+	m_mapTextures.clear();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
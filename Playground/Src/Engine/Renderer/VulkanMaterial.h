@@ -4,6 +4,7 @@
 
 class VulkanDevice;
 class VulkanTexture2D;
+struct MaterialGPUData;
 enum class TextureType;
 
 class VulkanMaterial
@@ -13,9 +14,12 @@ public:
 	~VulkanMaterial();
 
 	void									LoadTexture(VulkanDevice* pDevice, const std::string& filePath, TextureType type);
+	void									LoadTextures(VulkanDevice* pDevice, const std::map<std::string, TextureType>& mapTextures);
+	uint32_t								RegisterBindless(VulkanDevice* pDevice, const MaterialGPUData& constants);
 	void									Cleanup(VulkanDevice* pDevice);
 	void									CleanupOnWindowResize(VulkanDevice* pDevice);
 
 	std::map<TextureType, VulkanTexture2D*>	m_mapTextures;
+	uint32_t								m_uiMaterialID;				// Entry in VulkanMaterialTable, INVALID_BINDLESS_INDEX until registered
 };
 
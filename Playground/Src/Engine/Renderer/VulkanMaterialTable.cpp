@@ -0,0 +1,468 @@
+#include "PlaygroundPCH.h"
+#include "VulkanMaterialTable.h"
+
+#include "VulkanDevice.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanTexture2D.h"
+
+#include "PlaygroundHeaders.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMaterialTable::VulkanMaterialTable()
+{
+	m_vkDescriptorPool = VK_NULL_HANDLE;
+	m_vkDescriptorSetLayout = VK_NULL_HANDLE;
+	m_vkDescriptorSet = VK_NULL_HANDLE;
+
+	m_vkMaterialBuffer = VK_NULL_HANDLE;
+	m_pMaterialAllocation = nullptr;
+	m_pMaterialData = nullptr;
+
+	m_uiMaxTextures = 0;
+	m_uiMaxMaterials = 0;
+
+	m_uiModelCount = 0;
+	m_uiLegacySets = 0;
+	m_uiModelMeshes = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMaterialTable::~VulkanMaterialTable()
+{
+	m_mapTextureSlots.clear();
+	m_vecSlotTextures.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::Initialize(VulkanDevice* pDevice, uint32_t maxTextures, uint32_t maxMaterials)
+{
+	if (IsInitialized())
+		return;
+
+	if (!pDevice->m_bDescriptorIndexing)
+	{
+		LOG_ERROR("Descriptor indexing isn't supported, bindless material textures are disabled");
+		return;
+	}
+
+	// The array is sized for the worst case up front, update after bind limits are far above the regular ones
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 deviceProperties2 = {};
+	deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties2.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(pDevice->m_vkPhysicalDevice, &deviceProperties2);
+
+	m_uiMaxTextures = std::min(maxTextures, std::min(indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+													 indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages));
+	m_uiMaxMaterials = maxMaterials;
+
+	VkShaderStageFlags stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT |
+									VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+
+	//--- Layout
+	std::array<VkDescriptorSetLayoutBinding, 2> arrBindings = {};
+	arrBindings[0].binding = 0;
+	arrBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	arrBindings[0].descriptorCount = 1;
+	arrBindings[0].stageFlags = stageFlags;
+	arrBindings[0].pImmutableSamplers = nullptr;
+
+	arrBindings[1].binding = 1;
+	arrBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	arrBindings[1].descriptorCount = m_uiMaxTextures;
+	arrBindings[1].stageFlags = stageFlags;
+	arrBindings[1].pImmutableSamplers = nullptr;
+
+	// Slots get written while earlier frames may still be in flight, unused ones never need to be valid
+	std::array<VkDescriptorBindingFlags, 2> arrBindingFlags = {};
+	arrBindingFlags[0] = 0;
+	arrBindingFlags[1] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+						 VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+						 VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+						 VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(arrBindingFlags.size());
+	bindingFlagsInfo.pBindingFlags = arrBindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(arrBindings.size());
+	layoutCreateInfo.pBindings = arrBindings.data();
+
+	VKRESULT_CHECK(vkCreateDescriptorSetLayout(pDevice->m_vkLogicalDevice, &layoutCreateInfo, nullptr, &m_vkDescriptorSetLayout));
+
+	//--- Pool, a single set for the whole application
+	std::array<VkDescriptorPoolSize, 2> arrPoolSizes = {};
+	arrPoolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	arrPoolSizes[0].descriptorCount = 1;
+	arrPoolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	arrPoolSizes[1].descriptorCount = m_uiMaxTextures;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(arrPoolSizes.size());
+	poolCreateInfo.pPoolSizes = arrPoolSizes.data();
+
+	VKRESULT_CHECK(vkCreateDescriptorPool(pDevice->m_vkLogicalDevice, &poolCreateInfo, nullptr, &m_vkDescriptorPool));
+
+	//--- Set
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {};
+	variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	variableCountInfo.descriptorSetCount = 1;
+	variableCountInfo.pDescriptorCounts = &m_uiMaxTextures;
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.pNext = &variableCountInfo;
+	allocInfo.descriptorPool = m_vkDescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_vkDescriptorSetLayout;
+
+	VKRESULT_CHECK(vkAllocateDescriptorSets(pDevice->m_vkLogicalDevice, &allocInfo, &m_vkDescriptorSet));
+
+	//--- Material table, written straight from the CPU
+	VkDeviceSize bufferSize = sizeof(MaterialGPUData) * m_uiMaxMaterials;
+	pDevice->CreateBuffer(	bufferSize,
+							VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+							&m_vkMaterialBuffer,
+							&m_pMaterialAllocation,
+							"MaterialTable");
+
+	m_pMaterialData = static_cast<MaterialGPUData*>(m_pMaterialAllocation->pMapped);
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = m_vkMaterialBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = bufferSize;
+
+	VkWriteDescriptorSet bufferWrite = {};
+	bufferWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	bufferWrite.dstSet = m_vkDescriptorSet;
+	bufferWrite.dstBinding = 0;
+	bufferWrite.dstArrayElement = 0;
+	bufferWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bufferWrite.descriptorCount = 1;
+	bufferWrite.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &bufferWrite, 0, nullptr);
+
+	// Free lists hand out the lowest index first
+	m_vecSlotTextures.assign(m_uiMaxTextures, nullptr);
+	m_vecFreeTextureSlots.resize(m_uiMaxTextures);
+	for (uint32_t i = 0; i < m_uiMaxTextures; ++i)
+	{
+		m_vecFreeTextureSlots[i] = m_uiMaxTextures - 1 - i;
+	}
+
+	m_vecMaterialTextures.assign(m_uiMaxMaterials, std::vector<uint32_t>());
+	m_vecMaterialUsed.assign(m_uiMaxMaterials, false);
+	m_vecFreeMaterials.resize(m_uiMaxMaterials);
+	for (uint32_t i = 0; i < m_uiMaxMaterials; ++i)
+	{
+		m_vecFreeMaterials[i] = m_uiMaxMaterials - 1 - i;
+	}
+
+	LOG_DEBUG("Material table: {0} texture slots, {1} materials ({2} KB)", m_uiMaxTextures, m_uiMaxMaterials, bufferSize / 1024);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::Cleanup(VulkanDevice* pDevice)
+{
+	if (!m_mapTextureSlots.empty())
+	{
+		LOG_WARNING("Material table cleaned up with {0} textures still registered", m_mapTextureSlots.size());
+	}
+
+	if (m_vkMaterialBuffer != VK_NULL_HANDLE)
+	{
+		pDevice->DestroyBuffer(m_vkMaterialBuffer, m_pMaterialAllocation);
+	}
+
+	if (m_vkDescriptorPool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(pDevice->m_vkLogicalDevice, m_vkDescriptorPool, nullptr);
+
+	if (m_vkDescriptorSetLayout != VK_NULL_HANDLE)
+		vkDestroyDescriptorSetLayout(pDevice->m_vkLogicalDevice, m_vkDescriptorSetLayout, nullptr);
+
+	m_vkDescriptorPool = VK_NULL_HANDLE;
+	m_vkDescriptorSetLayout = VK_NULL_HANDLE;
+	m_vkDescriptorSet = VK_NULL_HANDLE;
+	m_vkMaterialBuffer = VK_NULL_HANDLE;
+	m_pMaterialAllocation = nullptr;
+	m_pMaterialData = nullptr;
+
+	m_mapTextureSlots.clear();
+	m_vecSlotTextures.clear();
+	m_vecFreeTextureSlots.clear();
+	m_vecMaterialTextures.clear();
+	m_vecMaterialUsed.clear();
+	m_vecFreeMaterials.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t VulkanMaterialTable::AcquireTextureSlot(VulkanDevice* pDevice, VulkanTexture2D* pTexture)
+{
+	std::map<VulkanTexture2D*, TextureSlot>::iterator iter = m_mapTextureSlots.find(pTexture);
+	if (iter != m_mapTextureSlots.end())
+	{
+		++iter->second.refCount;
+		return iter->second.index;
+	}
+
+	if (m_vecFreeTextureSlots.empty())
+	{
+		LOG_ERROR("Material table is out of texture slots ({0})", m_uiMaxTextures);
+		return INVALID_BINDLESS_INDEX;
+	}
+
+	TextureSlot slot;
+	slot.index = m_vecFreeTextureSlots.back();
+	slot.refCount = 1;
+	m_vecFreeTextureSlots.pop_back();
+
+	m_mapTextureSlots.emplace(pTexture, slot);
+	m_vecSlotTextures[slot.index] = pTexture;
+
+	WriteTextureDescriptor(pDevice, slot.index, pTexture);
+
+	return slot.index;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::WriteTextureDescriptor(VulkanDevice* pDevice, uint32_t index, VulkanTexture2D* pTexture)
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = pTexture->m_vkTextureImageView;
+	imageInfo.sampler = pTexture->m_vkTextureSampler;
+
+	VkWriteDescriptorSet imageWrite = {};
+	imageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	imageWrite.dstSet = m_vkDescriptorSet;
+	imageWrite.dstBinding = 1;
+	imageWrite.dstArrayElement = index;
+	imageWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	imageWrite.descriptorCount = 1;
+	imageWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &imageWrite, 0, nullptr);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Frames in flight may still read the old slot, so the new view goes into a free one & every material holding the
+//--- texture moves over. Only out of slots does the old one get rewritten, after waiting for the GPU.
+uint32_t VulkanMaterialTable::RefreshTexture(VulkanDevice* pDevice, VulkanTexture2D* pTexture)
+{
+	std::map<VulkanTexture2D*, TextureSlot>::iterator iter = m_mapTextureSlots.find(pTexture);
+	if (iter == m_mapTextureSlots.end())
+		return INVALID_BINDLESS_INDEX;
+
+	const uint32_t oldIndex = iter->second.index;
+	if (m_vecFreeTextureSlots.empty())
+	{
+		LOG_WARNING("Material table is out of texture slots, waiting for the GPU to swap a texture in place");
+		vkDeviceWaitIdle(pDevice->m_vkLogicalDevice);
+		WriteTextureDescriptor(pDevice, oldIndex, pTexture);
+		return INVALID_BINDLESS_INDEX;
+	}
+
+	const uint32_t newIndex = m_vecFreeTextureSlots.back();
+	m_vecFreeTextureSlots.pop_back();
+
+	WriteTextureDescriptor(pDevice, newIndex, pTexture);
+
+	iter->second.index = newIndex;
+	m_vecSlotTextures[newIndex] = pTexture;
+	m_vecSlotTextures[oldIndex] = nullptr;
+
+	for (uint32_t materialID = 0; materialID < m_uiMaxMaterials; ++materialID)
+	{
+		std::vector<uint32_t>& vecSlots = m_vecMaterialTextures[materialID];
+		if (!m_vecMaterialUsed[materialID] || std::find(vecSlots.begin(), vecSlots.end(), oldIndex) == vecSlots.end())
+			continue;
+
+		std::replace(vecSlots.begin(), vecSlots.end(), oldIndex, newIndex);
+
+		MaterialGPUData& entry = m_pMaterialData[materialID];
+		for (uint32_t* pIndex : { &entry.albedoTexture, &entry.ormTexture, &entry.normalTexture, &entry.emissiveTexture })
+		{
+			if (*pIndex == oldIndex)
+				*pIndex = newIndex;
+		}
+	}
+
+	return oldIndex;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::FreeRetiredSlot(uint32_t index)
+{
+	// The table may have been cleaned up already
+	if (index >= m_vecSlotTextures.size() || m_vecSlotTextures[index] != nullptr)
+		return;
+
+	m_vecFreeTextureSlots.push_back(index);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Partially bound, so the stale descriptor stays until the slot is reused, nothing references it anymore
+void VulkanMaterialTable::ReleaseTextureSlot(uint32_t index)
+{
+	VulkanTexture2D* pTexture = m_vecSlotTextures[index];
+
+	std::map<VulkanTexture2D*, TextureSlot>::iterator iter = m_mapTextureSlots.find(pTexture);
+	if (iter == m_mapTextureSlots.end())
+		return;
+
+	if (--iter->second.refCount > 0)
+		return;
+
+	m_mapTextureSlots.erase(iter);
+	m_vecSlotTextures[index] = nullptr;
+	m_vecFreeTextureSlots.push_back(index);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t VulkanMaterialTable::RegisterMaterial(VulkanDevice* pDevice, const std::map<TextureType, VulkanTexture2D*>& mapTextures,
+											   const MaterialGPUData& constants)
+{
+	if (!IsInitialized())
+		return INVALID_BINDLESS_INDEX;
+
+	if (m_vecFreeMaterials.empty())
+	{
+		LOG_ERROR("Material table is full ({0} materials)", m_uiMaxMaterials);
+		return INVALID_BINDLESS_INDEX;
+	}
+
+	uint32_t materialID = m_vecFreeMaterials.back();
+	m_vecFreeMaterials.pop_back();
+	m_vecMaterialUsed[materialID] = true;
+
+	MaterialGPUData data = constants;
+
+	std::map<TextureType, VulkanTexture2D*>::const_iterator iter = mapTextures.begin();
+	for (; iter != mapTextures.end(); ++iter)
+	{
+		uint32_t* pIndex = nullptr;
+		switch (iter->first)
+		{
+			case TextureType::TEXTURE_ALBEDO:	pIndex = &data.albedoTexture;	break;
+			case TextureType::TEXTURE_ORM:		pIndex = &data.ormTexture;		break;
+			case TextureType::TEXTURE_NORMAL:	pIndex = &data.normalTexture;	break;
+			case TextureType::TEXTURE_EMISSIVE:	pIndex = &data.emissiveTexture;	break;
+			default:																break;
+		}
+
+		if (pIndex == nullptr || iter->second == nullptr)
+			continue;
+
+		*pIndex = AcquireTextureSlot(pDevice, iter->second);
+		if (*pIndex != INVALID_BINDLESS_INDEX)
+			m_vecMaterialTextures[materialID].push_back(*pIndex);
+	}
+
+	m_pMaterialData[materialID] = data;
+
+	return materialID;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Constants only, the texture indices the material registered with stay
+void VulkanMaterialTable::UpdateMaterial(uint32_t materialID, const MaterialGPUData& data)
+{
+	if (materialID >= m_uiMaxMaterials || !m_vecMaterialUsed[materialID])
+		return;
+
+	MaterialGPUData& entry = m_pMaterialData[materialID];
+	entry.albedoColor = data.albedoColor;
+	entry.emissiveColor = data.emissiveColor;
+	entry.ao = data.ao;
+	entry.roughness = data.roughness;
+	entry.metalness = data.metalness;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::ReleaseMaterial(VulkanDevice* pDevice, uint32_t materialID)
+{
+	if (materialID >= m_uiMaxMaterials || !m_vecMaterialUsed[materialID])
+		return;
+
+	for (uint32_t i = 0; i < m_vecMaterialTextures[materialID].size(); ++i)
+	{
+		ReleaseTextureSlot(m_vecMaterialTextures[materialID][i]);
+	}
+
+	m_vecMaterialTextures[materialID].clear();
+	m_vecMaterialUsed[materialID] = false;
+	m_vecFreeMaterials.push_back(materialID);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex) const
+{
+	if (!IsInitialized())
+		return;
+
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, setIndex, 1, &m_vkDescriptorSet, 0, nullptr);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::TrackModel(uint32_t swapchainImageCount, uint32_t meshCount)
+{
+	++m_uiModelCount;
+	m_uiLegacySets += swapchainImageCount;
+	m_uiModelMeshes += meshCount;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::UntrackModel(uint32_t swapchainImageCount, uint32_t meshCount)
+{
+	m_uiModelCount -= std::min(m_uiModelCount, 1u);
+	m_uiLegacySets -= std::min(m_uiLegacySets, swapchainImageCount);
+	m_uiModelMeshes -= std::min(m_uiModelMeshes, meshCount);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+BindlessStats VulkanMaterialTable::GetStats() const
+{
+	BindlessStats stats = {};
+	stats.textureCount = static_cast<uint32_t>(m_mapTextureSlots.size());
+	stats.materialCount = m_uiMaxMaterials - static_cast<uint32_t>(m_vecFreeMaterials.size());
+	stats.modelCount = m_uiModelCount;
+
+	// Before: a pool per model, each set a UBO & 4 material samplers, rebound for every mesh
+	stats.legacyPools = m_uiModelCount;
+	stats.legacySets = m_uiLegacySets;
+	stats.legacyDescriptors = m_uiLegacySets * 5;
+	stats.legacyBindsPerFrame = m_uiModelMeshes;
+
+	// After: models keep a UBO only set per swapchain image, bound once per model, plus the global set bound once
+	stats.pools = m_uiModelCount + (IsInitialized() ? 1 : 0);
+	stats.sets = m_uiLegacySets + (IsInitialized() ? 1 : 0);
+	stats.descriptors = m_uiLegacySets + (IsInitialized() ? stats.textureCount + 1 : 0);
+	stats.bindsPerFrame = m_uiModelCount + (IsInitialized() ? 1 : 0);
+
+	return stats;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMaterialTable::LogStats() const
+{
+	BindlessStats stats = GetStats();
+
+	LOG_INFO("Material descriptors for {0} models, {1} materials, {2} textures", stats.modelCount, stats.materialCount, stats.textureCount);
+	LOG_INFO("  per model sets: {0} pools, {1} sets, {2} descriptors, {3} binds per frame",
+			 stats.legacyPools, stats.legacySets, stats.legacyDescriptors, stats.legacyBindsPerFrame);
+	LOG_INFO("  bindless:       {0} pools, {1} sets, {2} descriptors, {3} binds per frame",
+			 stats.pools, stats.sets, stats.descriptors, stats.bindsPerFrame);
+}
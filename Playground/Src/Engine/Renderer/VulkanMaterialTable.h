@@ -0,0 +1,143 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "glm/glm.hpp"
+
+class VulkanDevice;
+class VulkanTexture2D;
+struct VulkanAllocation;
+enum class TextureType;
+
+const uint32_t INVALID_BINDLESS_INDEX = 0xFFFFFFFF;
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- One entry of the material table, std430. Must match MaterialData in the shaders.
+struct MaterialGPUData
+{
+	MaterialGPUData()
+	{
+		albedoColor			= glm::vec4(1.0f);
+		emissiveColor		= glm::vec4(0.0f);
+		albedoTexture		= INVALID_BINDLESS_INDEX;
+		ormTexture			= INVALID_BINDLESS_INDEX;
+		normalTexture		= INVALID_BINDLESS_INDEX;
+		emissiveTexture		= INVALID_BINDLESS_INDEX;
+		ao					= 1.0f;
+		roughness			= 0.5f;
+		metalness			= 0.0f;
+		padding				= 0;
+	}
+
+	glm::vec4							albedoColor;
+	glm::vec4							emissiveColor;
+	uint32_t							albedoTexture;			// Indices into the texture array, INVALID_BINDLESS_INDEX when unused
+	uint32_t							ormTexture;
+	uint32_t							normalTexture;
+	uint32_t							emissiveTexture;
+	float								ao;						// Used for channels the ORM texture doesn't provide
+	float								roughness;
+	float								metalness;
+	uint32_t							padding;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Descriptor usage of the registered materials, against what per model sets (UBO + 4 samplers per swapchain image,
+//--- a set bind per mesh) needed for the same models
+struct BindlessStats
+{
+	uint32_t							textureCount;
+	uint32_t							materialCount;
+	uint32_t							modelCount;
+
+	uint32_t							legacyPools;
+	uint32_t							legacySets;
+	uint32_t							legacyDescriptors;
+	uint32_t							legacyBindsPerFrame;
+
+	uint32_t							pools;
+	uint32_t							sets;
+	uint32_t							descriptors;
+	uint32_t							bindsPerFrame;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Every material texture in one global, update after bind array (binding 1) plus a storage buffer of MaterialGPUData
+//--- (binding 0) indexed by material ID. Renderers bind the single set once per frame, for raster & ray tracing
+//--- pipelines alike, & pass the material ID with the draw or instance. Textures shared through VulkanTextureCache share
+//--- a slot too.
+class VulkanMaterialTable
+{
+public:
+	static VulkanMaterialTable& getInstance()
+	{
+		static VulkanMaterialTable instance;
+		return instance;
+	}
+
+	~VulkanMaterialTable();
+
+	// Call once the device exists, textures & materials are capped by maxTextures/maxMaterials & the device limits
+	void								Initialize(VulkanDevice* pDevice, uint32_t maxTextures = 4096, uint32_t maxMaterials = 1024);
+	void								Cleanup(VulkanDevice* pDevice);
+
+	// Registers every texture of the material, returns its ID or INVALID_BINDLESS_INDEX when the table is full
+	uint32_t							RegisterMaterial(VulkanDevice* pDevice, const std::map<TextureType, VulkanTexture2D*>& mapTextures,
+														 const MaterialGPUData& constants);
+	void								UpdateMaterial(uint32_t materialID, const MaterialGPUData& data);
+	void								ReleaseMaterial(VulkanDevice* pDevice, uint32_t materialID);
+
+	// Streaming swapped the texture's view. Returns its previous slot, which frames in flight may still read, for
+	// FreeRetiredSlot once they're done. INVALID_BINDLESS_INDEX when the texture isn't in the table.
+	uint32_t							RefreshTexture(VulkanDevice* pDevice, VulkanTexture2D* pTexture);
+	void								FreeRetiredSlot(uint32_t index);
+
+	void								Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex) const;
+
+	// Models report what their own descriptor sets would have cost, only used for the stats
+	void								TrackModel(uint32_t swapchainImageCount, uint32_t meshCount);
+	void								UntrackModel(uint32_t swapchainImageCount, uint32_t meshCount);
+
+	BindlessStats						GetStats() const;
+	void								LogStats() const;
+
+	inline bool							IsInitialized() const { return m_vkDescriptorSet != VK_NULL_HANDLE; }
+	inline VkDescriptorSetLayout		GetDescriptorSetLayout() const { return m_vkDescriptorSetLayout; }
+
+private:
+	VulkanMaterialTable();
+	VulkanMaterialTable(const VulkanMaterialTable&);
+	void operator=(const VulkanMaterialTable&);
+
+	struct TextureSlot
+	{
+		uint32_t						index;
+		uint32_t						refCount;
+	};
+
+	uint32_t							AcquireTextureSlot(VulkanDevice* pDevice, VulkanTexture2D* pTexture);
+	void								ReleaseTextureSlot(uint32_t index);
+	void								WriteTextureDescriptor(VulkanDevice* pDevice, uint32_t index, VulkanTexture2D* pTexture);
+
+private:
+	VkDescriptorPool					m_vkDescriptorPool;
+	VkDescriptorSetLayout				m_vkDescriptorSetLayout;
+	VkDescriptorSet						m_vkDescriptorSet;
+
+	VkBuffer							m_vkMaterialBuffer;
+	VulkanAllocation*					m_pMaterialAllocation;
+	MaterialGPUData*					m_pMaterialData;			// Mapped for the table's lifetime, host coherent
+
+	uint32_t							m_uiMaxTextures;
+	uint32_t							m_uiMaxMaterials;
+
+	std::map<VulkanTexture2D*, TextureSlot>	m_mapTextureSlots;
+	std::vector<VulkanTexture2D*>		m_vecSlotTextures;			// Texture in each array slot, nullptr when free
+	std::vector<uint32_t>				m_vecFreeTextureSlots;
+	std::vector<std::vector<uint32_t>>	m_vecMaterialTextures;		// Slots each material holds, empty when the ID is free
+	std::vector<bool>					m_vecMaterialUsed;
+	std::vector<uint32_t>				m_vecFreeMaterials;
+
+	uint32_t							m_uiModelCount;
+	uint32_t							m_uiLegacySets;
+	uint32_t							m_uiModelMeshes;
+};
@@ -0,0 +1,1564 @@
+#include "PlaygroundPCH.h"
+#include "VulkanMemoryAllocator.h"
+
+#include "PlaygroundHeaders.h"
+
+#include <chrono>
+#include <random>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const uint32_t TLSF_SL_BITS = 4;								// 16 second level lists per power of two
+const uint32_t TLSF_SL_COUNT = 1 << TLSF_SL_BITS;
+const uint32_t TLSF_SMALL_SHIFT = 8;							// Below 256 bytes one linear class of 16 byte steps
+const VkDeviceSize TLSF_SMALL_SIZE = 1ull << TLSF_SMALL_SHIFT;
+const uint32_t TLSF_FL_COUNT = 32;
+const uint32_t TLSF_INVALID_NODE = UINT32_MAX;
+
+//---------------------------------------------------------------------------------------------------------------------
+inline uint32_t HighestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline uint32_t LowestBit(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- bufferImageGranularity is a power of two
+inline bool OnSamePage(VkDeviceSize lastByte, VkDeviceSize firstByte, VkDeviceSize pageSize)
+{
+	return (lastByte & ~(pageSize - 1)) == (firstByte & ~(pageSize - 1));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Free list a range of this size goes into
+inline void MapFreeList(VkDeviceSize size, uint32_t& outFirstLevel, uint32_t& outSecondLevel)
+{
+	if (size < TLSF_SMALL_SIZE)
+	{
+		outFirstLevel = 0;
+		outSecondLevel = static_cast<uint32_t>(size >> (TLSF_SMALL_SHIFT - TLSF_SL_BITS));
+		return;
+	}
+
+	const uint32_t highestBit = HighestBit(size);
+	outFirstLevel = std::min(highestBit - TLSF_SMALL_SHIFT + 1, TLSF_FL_COUNT - 1);
+	outSecondLevel = static_cast<uint32_t>(size >> (highestBit - TLSF_SL_BITS)) & (TLSF_SL_COUNT - 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- First free list whose every range holds size, rounded up to the next class
+inline void MapSearchList(VkDeviceSize size, uint32_t& outFirstLevel, uint32_t& outSecondLevel)
+{
+	if (size < TLSF_SMALL_SIZE)
+		size += (1ull << (TLSF_SMALL_SHIFT - TLSF_SL_BITS)) - 1;
+	else
+		size += (1ull << (HighestBit(size) - TLSF_SL_BITS)) - 1;
+
+	MapFreeList(size, outFirstLevel, outSecondLevel);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Ranges of a block in address order, free ones also linked into their TLSF list
+struct MemoryNode
+{
+	VkDeviceSize						offset;
+	VkDeviceSize						size;
+	uint32_t							prevPhysical;
+	uint32_t							nextPhysical;
+	uint32_t							prevFree;
+	uint32_t							nextFree;
+	VulkanAllocation*					pAllocation;				// nullptr while free
+	ResourceTiling						eTiling;
+	bool								bFree;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- One VkDeviceMemory & its TLSF bookkeeping. Nodes live in a vector & link by index, released ones get reused.
+class VulkanMemoryBlock
+{
+public:
+	VulkanMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, uint8_t* pMapped, VkDeviceSize granularity);
+
+	// Offset for size bytes ending at or before limit, a free node of a class that holds size + alignment first
+	bool								FindPlacement(VkDeviceSize size, VkDeviceSize alignment, ResourceTiling eTiling, VkDeviceSize limit,
+													  uint32_t& outNode, VkDeviceSize& outOffset) const;
+
+	// Splits the free node around [offset, offset + size), returns the node that now holds pAllocation
+	uint32_t							Commit(uint32_t node, VkDeviceSize offset, VkDeviceSize size, ResourceTiling eTiling, VulkanAllocation* pAllocation);
+	void								Release(uint32_t node);
+
+	VkDeviceSize						GetLargestFree() const;
+	bool								Validate() const;
+
+private:
+	bool								TryPlacement(uint32_t node, VkDeviceSize size, VkDeviceSize alignment, ResourceTiling eTiling, VkDeviceSize limit,
+													 VkDeviceSize& outOffset) const;
+	bool								FindFreeList(uint32_t& firstLevel, uint32_t& secondLevel) const;
+
+	void								InsertFree(uint32_t node);
+	void								RemoveFree(uint32_t node);
+	uint32_t							CreateNode();
+	void								DestroyNode(uint32_t node);
+
+public:
+	VkDeviceMemory						m_vkMemory;
+	VkDeviceSize						m_vkSize;
+	uint32_t							m_uiMemoryTypeIndex;
+	uint8_t*							m_pMapped;					// Host visible blocks only
+
+	VkDeviceSize						m_vkUsedBytes;
+	uint32_t							m_uiAllocationCount;
+
+	std::vector<MemoryNode>				m_vecNodes;
+	uint32_t							m_uiFirstNode;
+
+private:
+	std::vector<uint32_t>				m_vecSpareNodes;
+	VkDeviceSize						m_vkGranularity;
+
+	uint32_t							m_uiFirstLevelBitmap;
+	std::array<uint32_t, TLSF_FL_COUNT>	m_arrSecondLevelBitmaps;
+	std::array<uint32_t, TLSF_FL_COUNT * TLSF_SL_COUNT>	m_arrFreeLists;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMemoryBlock::VulkanMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, uint8_t* pMapped, VkDeviceSize granularity)
+{
+	m_vkMemory = memory;
+	m_vkSize = size;
+	m_uiMemoryTypeIndex = memoryTypeIndex;
+	m_pMapped = pMapped;
+	m_vkGranularity = granularity;
+
+	m_vkUsedBytes = 0;
+	m_uiAllocationCount = 0;
+
+	m_uiFirstLevelBitmap = 0;
+	m_arrSecondLevelBitmaps.fill(0);
+	m_arrFreeLists.fill(TLSF_INVALID_NODE);
+
+	// The whole block as a single free range
+	m_uiFirstNode = CreateNode();
+	m_vecNodes[m_uiFirstNode].offset = 0;
+	m_vecNodes[m_uiFirstNode].size = size;
+	InsertFree(m_uiFirstNode);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t VulkanMemoryBlock::CreateNode()
+{
+	uint32_t node;
+	if (!m_vecSpareNodes.empty())
+	{
+		node = m_vecSpareNodes.back();
+		m_vecSpareNodes.pop_back();
+	}
+	else
+	{
+		node = static_cast<uint32_t>(m_vecNodes.size());
+		m_vecNodes.emplace_back();
+	}
+
+	MemoryNode& newNode = m_vecNodes[node];
+	newNode.offset = 0;
+	newNode.size = 0;
+	newNode.prevPhysical = TLSF_INVALID_NODE;
+	newNode.nextPhysical = TLSF_INVALID_NODE;
+	newNode.prevFree = TLSF_INVALID_NODE;
+	newNode.nextFree = TLSF_INVALID_NODE;
+	newNode.pAllocation = nullptr;
+	newNode.eTiling = ResourceTiling::LINEAR;
+	newNode.bFree = true;
+
+	return node;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryBlock::DestroyNode(uint32_t node)
+{
+	m_vecSpareNodes.push_back(node);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryBlock::InsertFree(uint32_t node)
+{
+	uint32_t firstLevel, secondLevel;
+	MapFreeList(m_vecNodes[node].size, firstLevel, secondLevel);
+
+	uint32_t& head = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel];
+
+	m_vecNodes[node].bFree = true;
+	m_vecNodes[node].prevFree = TLSF_INVALID_NODE;
+	m_vecNodes[node].nextFree = head;
+
+	if (head != TLSF_INVALID_NODE)
+		m_vecNodes[head].prevFree = node;
+
+	head = node;
+
+	m_uiFirstLevelBitmap |= 1u << firstLevel;
+	m_arrSecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryBlock::RemoveFree(uint32_t node)
+{
+	uint32_t firstLevel, secondLevel;
+	MapFreeList(m_vecNodes[node].size, firstLevel, secondLevel);
+
+	uint32_t& head = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel];
+
+	const uint32_t prevFree = m_vecNodes[node].prevFree;
+	const uint32_t nextFree = m_vecNodes[node].nextFree;
+
+	if (prevFree != TLSF_INVALID_NODE)
+		m_vecNodes[prevFree].nextFree = nextFree;
+	else
+		head = nextFree;
+
+	if (nextFree != TLSF_INVALID_NODE)
+		m_vecNodes[nextFree].prevFree = prevFree;
+
+	if (head == TLSF_INVALID_NODE)
+	{
+		m_arrSecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (m_arrSecondLevelBitmaps[firstLevel] == 0)
+			m_uiFirstLevelBitmap &= ~(1u << firstLevel);
+	}
+
+	m_vecNodes[node].prevFree = TLSF_INVALID_NODE;
+	m_vecNodes[node].nextFree = TLSF_INVALID_NODE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- First non empty list at or above (firstLevel, secondLevel)
+bool VulkanMemoryBlock::FindFreeList(uint32_t& firstLevel, uint32_t& secondLevel) const
+{
+	if (firstLevel >= TLSF_FL_COUNT)
+		return false;
+
+	uint32_t secondLevelMap = secondLevel < TLSF_SL_COUNT ? m_arrSecondLevelBitmaps[firstLevel] & (~0u << secondLevel) : 0;
+	if (secondLevelMap == 0)
+	{
+		const uint32_t firstLevelMap = firstLevel + 1 < TLSF_FL_COUNT ? m_uiFirstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0)
+			return false;
+
+		firstLevel = LowestBit(firstLevelMap);
+		secondLevelMap = m_arrSecondLevelBitmaps[firstLevel];
+	}
+
+	secondLevel = LowestBit(secondLevelMap);
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- A LINEAR & an OPTIMAL resource may not share a bufferImageGranularity page. An allocated neighbour in front pushes
+//--- the offset to the next page, one behind rejects the node.
+bool VulkanMemoryBlock::TryPlacement(uint32_t node, VkDeviceSize size, VkDeviceSize alignment, ResourceTiling eTiling, VkDeviceSize limit,
+									 VkDeviceSize& outOffset) const
+{
+	const MemoryNode& freeNode = m_vecNodes[node];
+
+	VkDeviceSize offset = AlignUp(freeNode.offset, alignment);
+	if (m_vkGranularity > 1 && freeNode.prevPhysical != TLSF_INVALID_NODE)
+	{
+		const MemoryNode& prevNode = m_vecNodes[freeNode.prevPhysical];
+		if (!prevNode.bFree && prevNode.eTiling != eTiling && OnSamePage(prevNode.offset + prevNode.size - 1, offset, m_vkGranularity))
+			offset = AlignUp(offset, m_vkGranularity);
+	}
+
+	const VkDeviceSize end = offset + size;
+	if (end > freeNode.offset + freeNode.size || end > limit)
+		return false;
+
+	if (m_vkGranularity > 1 && freeNode.nextPhysical != TLSF_INVALID_NODE)
+	{
+		const MemoryNode& nextNode = m_vecNodes[freeNode.nextPhysical];
+		if (!nextNode.bFree && nextNode.eTiling != eTiling && OnSamePage(end - 1, nextNode.offset, m_vkGranularity))
+			return false;
+	}
+
+	outOffset = offset;
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanMemoryBlock::FindPlacement(VkDeviceSize size, VkDeviceSize alignment, ResourceTiling eTiling, VkDeviceSize limit,
+									  uint32_t& outNode, VkDeviceSize& outOffset) const
+{
+	//--- Good fit, every range in the first list that holds size + alignment padding fits unless granularity gets in the way
+	uint32_t firstLevel, secondLevel;
+	MapSearchList(size + alignment - 1, firstLevel, secondLevel);
+
+	if (FindFreeList(firstLevel, secondLevel))
+	{
+		for (uint32_t node = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel]; node != TLSF_INVALID_NODE; node = m_vecNodes[node].nextFree)
+		{
+			if (TryPlacement(node, size, alignment, eTiling, limit, outOffset))
+			{
+				outNode = node;
+				return true;
+			}
+		}
+	}
+
+	//--- Anything that fits, from the list size itself falls into upwards. Smaller ranges than the good fit, padding,
+	//--- granularity & the limit are what get checked one by one here.
+	MapFreeList(size, firstLevel, secondLevel);
+
+	while (FindFreeList(firstLevel, secondLevel))
+	{
+		for (uint32_t node = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel]; node != TLSF_INVALID_NODE; node = m_vecNodes[node].nextFree)
+		{
+			if (TryPlacement(node, size, alignment, eTiling, limit, outOffset))
+			{
+				outNode = node;
+				return true;
+			}
+		}
+
+		++secondLevel;
+	}
+
+	return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint32_t VulkanMemoryBlock::Commit(uint32_t node, VkDeviceSize offset, VkDeviceSize size, ResourceTiling eTiling, VulkanAllocation* pAllocation)
+{
+	RemoveFree(node);
+
+	//--- Alignment padding in front stays free as a range of its own
+	if (offset > m_vecNodes[node].offset)
+	{
+		const uint32_t paddingNode = CreateNode();
+
+		MemoryNode& padding = m_vecNodes[paddingNode];
+		MemoryNode& current = m_vecNodes[node];
+
+		padding.offset = current.offset;
+		padding.size = offset - current.offset;
+		padding.prevPhysical = current.prevPhysical;
+		padding.nextPhysical = node;
+
+		if (current.prevPhysical != TLSF_INVALID_NODE)
+			m_vecNodes[current.prevPhysical].nextPhysical = paddingNode;
+		else
+			m_uiFirstNode = paddingNode;
+
+		current.prevPhysical = paddingNode;
+		current.offset = offset;
+		current.size -= padding.size;
+
+		InsertFree(paddingNode);
+	}
+
+	//--- So does whatever is left behind it
+	if (m_vecNodes[node].size > size)
+	{
+		const uint32_t tailNode = CreateNode();
+
+		MemoryNode& tail = m_vecNodes[tailNode];
+		MemoryNode& current = m_vecNodes[node];
+
+		tail.offset = offset + size;
+		tail.size = current.size - size;
+		tail.prevPhysical = node;
+		tail.nextPhysical = current.nextPhysical;
+
+		if (current.nextPhysical != TLSF_INVALID_NODE)
+			m_vecNodes[current.nextPhysical].prevPhysical = tailNode;
+
+		current.nextPhysical = tailNode;
+		current.size = size;
+
+		InsertFree(tailNode);
+	}
+
+	MemoryNode& current = m_vecNodes[node];
+	current.bFree = false;
+	current.eTiling = eTiling;
+	current.pAllocation = pAllocation;
+
+	m_vkUsedBytes += size;
+	++m_uiAllocationCount;
+
+	return node;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Merges with free neighbours, free ranges never touch each other
+void VulkanMemoryBlock::Release(uint32_t node)
+{
+	m_vkUsedBytes -= m_vecNodes[node].size;
+	--m_uiAllocationCount;
+
+	m_vecNodes[node].pAllocation = nullptr;
+
+	const uint32_t prevNode = m_vecNodes[node].prevPhysical;
+	if (prevNode != TLSF_INVALID_NODE && m_vecNodes[prevNode].bFree)
+	{
+		RemoveFree(prevNode);
+
+		MemoryNode& current = m_vecNodes[node];
+		current.offset = m_vecNodes[prevNode].offset;
+		current.size += m_vecNodes[prevNode].size;
+		current.prevPhysical = m_vecNodes[prevNode].prevPhysical;
+
+		if (current.prevPhysical != TLSF_INVALID_NODE)
+			m_vecNodes[current.prevPhysical].nextPhysical = node;
+		else
+			m_uiFirstNode = node;
+
+		DestroyNode(prevNode);
+	}
+
+	const uint32_t nextNode = m_vecNodes[node].nextPhysical;
+	if (nextNode != TLSF_INVALID_NODE && m_vecNodes[nextNode].bFree)
+	{
+		RemoveFree(nextNode);
+
+		MemoryNode& current = m_vecNodes[node];
+		current.size += m_vecNodes[nextNode].size;
+		current.nextPhysical = m_vecNodes[nextNode].nextPhysical;
+
+		if (current.nextPhysical != TLSF_INVALID_NODE)
+			m_vecNodes[current.nextPhysical].prevPhysical = node;
+
+		DestroyNode(nextNode);
+	}
+
+	InsertFree(node);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Ranges of the highest non empty class are larger than any other
+VkDeviceSize VulkanMemoryBlock::GetLargestFree() const
+{
+	if (m_uiFirstLevelBitmap == 0)
+		return 0;
+
+	const uint32_t firstLevel = HighestBit(m_uiFirstLevelBitmap);
+	const uint32_t secondLevel = HighestBit(m_arrSecondLevelBitmaps[firstLevel]);
+
+	VkDeviceSize largest = 0;
+	for (uint32_t node = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel]; node != TLSF_INVALID_NODE; node = m_vecNodes[node].nextFree)
+		largest = std::max(largest, m_vecNodes[node].size);
+
+	return largest;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanMemoryBlock::Validate() const
+{
+	VkDeviceSize offset = 0;
+	VkDeviceSize usedBytes = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeCount = 0;
+	uint32_t prevNode = TLSF_INVALID_NODE;
+	bool bPrevFree = false;
+
+	for (uint32_t node = m_uiFirstNode; node != TLSF_INVALID_NODE; node = m_vecNodes[node].nextPhysical)
+	{
+		const MemoryNode& current = m_vecNodes[node];
+		if (current.offset != offset || current.size == 0 || current.prevPhysical != prevNode)
+			return false;
+
+		if (current.bFree)
+		{
+			if (bPrevFree || current.pAllocation != nullptr)
+				return false;
+
+			uint32_t firstLevel, secondLevel;
+			MapFreeList(current.size, firstLevel, secondLevel);
+
+			uint32_t listNode = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel];
+			while (listNode != TLSF_INVALID_NODE && listNode != node)
+				listNode = m_vecNodes[listNode].nextFree;
+
+			if (listNode != node)
+				return false;
+
+			++freeCount;
+		}
+		else
+		{
+			const VulkanAllocation* pAllocation = current.pAllocation;
+			if (pAllocation == nullptr || pAllocation->pBlock != this || pAllocation->node != node || pAllocation->offset != current.offset ||
+				pAllocation->size != current.size || pAllocation->offset % pAllocation->alignment != 0)
+				return false;
+
+			usedBytes += current.size;
+			++allocationCount;
+		}
+
+		bPrevFree = current.bFree;
+		offset += current.size;
+		prevNode = node;
+	}
+
+	if (offset != m_vkSize || usedBytes != m_vkUsedBytes || allocationCount != m_uiAllocationCount)
+		return false;
+
+	// Every listed node is a free one, bitmaps match the lists
+	uint32_t listedCount = 0;
+	for (uint32_t firstLevel = 0; firstLevel < TLSF_FL_COUNT; ++firstLevel)
+	{
+		for (uint32_t secondLevel = 0; secondLevel < TLSF_SL_COUNT; ++secondLevel)
+		{
+			const uint32_t head = m_arrFreeLists[firstLevel * TLSF_SL_COUNT + secondLevel];
+			const bool bBit = (m_arrSecondLevelBitmaps[firstLevel] & (1u << secondLevel)) != 0;
+			if (bBit != (head != TLSF_INVALID_NODE))
+				return false;
+
+			for (uint32_t node = head; node != TLSF_INVALID_NODE; node = m_vecNodes[node].nextFree)
+			{
+				if (!m_vecNodes[node].bFree)
+					return false;
+
+				++listedCount;
+			}
+		}
+
+		if (((m_uiFirstLevelBitmap >> firstLevel) & 1u) != (m_arrSecondLevelBitmaps[firstLevel] != 0 ? 1u : 0u))
+			return false;
+	}
+
+	return listedCount == freeCount;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMemoryBackend::VulkanMemoryBackend(VkDevice device)
+{
+	m_vkDevice = device;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VkResult VulkanMemoryBackend::AllocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkDeviceMemory* pOutMemory)
+{
+	VkMemoryDedicatedAllocateInfo dedicatedAllocInfo = {};
+	dedicatedAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedAllocInfo.buffer = dedicatedBuffer;
+
+	VkMemoryAllocateFlagsInfo allocFlagsInfo = {};
+	allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+	allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+	allocFlagsInfo.pNext = dedicatedBuffer != VK_NULL_HANDLE ? &dedicatedAllocInfo : nullptr;
+
+	VkMemoryAllocateInfo memoryAllocInfo = {};
+	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocInfo.allocationSize = size;
+	memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+	memoryAllocInfo.pNext = &allocFlagsInfo;
+
+	return vkAllocateMemory(m_vkDevice, &memoryAllocInfo, nullptr, pOutMemory);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryBackend::FreeMemory(VkDeviceMemory memory)
+{
+	vkFreeMemory(m_vkDevice, memory, nullptr);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void* VulkanMemoryBackend::MapMemory(VkDeviceMemory memory)
+{
+	void* pData = nullptr;
+	if (vkMapMemory(m_vkDevice, memory, 0, VK_WHOLE_SIZE, 0, &pData) != VK_SUCCESS)
+		return nullptr;
+
+	return pData;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryBackend::UnmapMemory(VkDeviceMemory memory)
+{
+	vkUnmapMemory(m_vkDevice, memory);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMemoryAllocator::VulkanMemoryAllocator(IVulkanMemoryBackend* pBackend, const VulkanMemoryAllocatorCreateInfo& createInfo)
+{
+	m_pBackend = pBackend;
+	m_CreateInfo = createInfo;
+	m_CreateInfo.bufferImageGranularity = std::max<VkDeviceSize>(createInfo.bufferImageGranularity, 1);
+	m_CreateInfo.nonCoherentAtomSize = std::max<VkDeviceSize>(createInfo.nonCoherentAtomSize, 1);
+
+	m_uiDeviceMemoryCount = 0;
+	m_uiAllocateCalls = 0;
+	m_uiAllocationsServed = 0;
+	m_uiLastDefragmentationMoves = 0;
+	m_uiLastDefragmentationBytes = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+	Cleanup();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VkDeviceSize VulkanMemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) const
+{
+	if (m_CreateInfo.preferredBlockSize > 0)
+		return m_CreateInfo.preferredBlockSize;
+
+	const uint32_t heapIndex = m_CreateInfo.memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	const VkDeviceSize heapSize = m_CreateInfo.memoryProperties.memoryHeaps[heapIndex].size;
+
+	return heapSize >= DEVICE_MEMORY_LARGE_HEAP ? DEVICE_MEMORY_BLOCK_SIZE : AlignUp(heapSize / 8, 32);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanMemoryAllocator::IsHostVisible(uint32_t memoryTypeIndex) const
+{
+	return (m_CreateInfo.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanMemoryBlock* VulkanMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+	if (m_uiDeviceMemoryCount >= m_CreateInfo.maxMemoryAllocationCount)
+		return nullptr;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+
+	++m_uiAllocateCalls;
+	if (m_pBackend->AllocateMemory(memoryTypeIndex, size, VK_NULL_HANDLE, &memory) != VK_SUCCESS)
+		return nullptr;
+
+	++m_uiDeviceMemoryCount;
+
+	uint8_t* pMapped = IsHostVisible(memoryTypeIndex) ? static_cast<uint8_t*>(m_pBackend->MapMemory(memory)) : nullptr;
+
+	VulkanMemoryBlock* pBlock = new VulkanMemoryBlock(memory, size, memoryTypeIndex, pMapped, m_CreateInfo.bufferImageGranularity);
+	m_arrBlocks[memoryTypeIndex].push_back(pBlock);
+
+	return pBlock;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Keeps the first empty block of a memory type, frees the others
+void VulkanMemoryAllocator::ReleaseEmptyBlocks(uint32_t memoryTypeIndex)
+{
+	std::vector<VulkanMemoryBlock*>& vecBlocks = m_arrBlocks[memoryTypeIndex];
+
+	bool bKeptEmpty = false;
+	for (auto it = vecBlocks.begin(); it != vecBlocks.end();)
+	{
+		VulkanMemoryBlock* pBlock = *it;
+		if (pBlock->m_uiAllocationCount > 0 || !bKeptEmpty)
+		{
+			bKeptEmpty |= pBlock->m_uiAllocationCount == 0;
+			++it;
+			continue;
+		}
+
+		if (pBlock->m_pMapped)
+			m_pBackend->UnmapMemory(pBlock->m_vkMemory);
+
+		m_pBackend->FreeMemory(pBlock->m_vkMemory);
+		--m_uiDeviceMemoryCount;
+
+		SAFE_DELETE(pBlock);
+		it = vecBlocks.erase(it);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanAllocation* VulkanMemoryAllocator::AllocateFromBlocks(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceSize alignment, ResourceTiling eTiling)
+{
+	uint32_t node = TLSF_INVALID_NODE;
+	VkDeviceSize offset = 0;
+
+	VulkanMemoryBlock* pTarget = nullptr;
+	for (VulkanMemoryBlock* pBlock : m_arrBlocks[memoryTypeIndex])
+	{
+		if (pBlock->m_vkSize - pBlock->m_vkUsedBytes >= size && pBlock->FindPlacement(size, alignment, eTiling, pBlock->m_vkSize, node, offset))
+		{
+			pTarget = pBlock;
+			break;
+		}
+	}
+
+	if (pTarget == nullptr)
+	{
+		pTarget = CreateBlock(memoryTypeIndex, GetBlockSize(memoryTypeIndex));
+		if (pTarget == nullptr || !pTarget->FindPlacement(size, alignment, eTiling, pTarget->m_vkSize, node, offset))
+			return nullptr;
+	}
+
+	VulkanAllocation* pAllocation = new VulkanAllocation();
+	pAllocation->memory = pTarget->m_vkMemory;
+	pAllocation->offset = offset;
+	pAllocation->size = size;
+	pAllocation->alignment = alignment;
+	pAllocation->pMapped = pTarget->m_pMapped ? pTarget->m_pMapped + offset : nullptr;
+	pAllocation->memoryTypeIndex = memoryTypeIndex;
+	pAllocation->bDedicated = false;
+	pAllocation->pBlock = pTarget;
+	pAllocation->eTiling = eTiling;
+	pAllocation->node = pTarget->Commit(node, offset, size, eTiling, pAllocation);
+
+	return pAllocation;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanAllocation* VulkanMemoryAllocator::AllocateDedicated(uint32_t memoryTypeIndex, const VulkanAllocationCreateInfo& createInfo)
+{
+	if (m_uiDeviceMemoryCount >= m_CreateInfo.maxMemoryAllocationCount)
+		return nullptr;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+
+	++m_uiAllocateCalls;
+	if (m_pBackend->AllocateMemory(memoryTypeIndex, createInfo.requirements.size, createInfo.dedicatedBuffer, &memory) != VK_SUCCESS)
+		return nullptr;
+
+	++m_uiDeviceMemoryCount;
+
+	VulkanAllocation* pAllocation = new VulkanAllocation();
+	pAllocation->memory = memory;
+	pAllocation->offset = 0;
+	pAllocation->size = createInfo.requirements.size;
+	pAllocation->alignment = 1;
+	pAllocation->pMapped = IsHostVisible(memoryTypeIndex) ? m_pBackend->MapMemory(memory) : nullptr;
+	pAllocation->memoryTypeIndex = memoryTypeIndex;
+	pAllocation->bDedicated = true;
+	pAllocation->pBlock = nullptr;
+	pAllocation->node = TLSF_INVALID_NODE;
+	pAllocation->eTiling = createInfo.eTiling;
+
+	m_vecDedicated.push_back(pAllocation);
+
+	return pAllocation;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanAllocation* VulkanMemoryAllocator::Allocate(const VulkanAllocationCreateInfo& createInfo)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	const VkMemoryRequirements& requirements = createInfo.requirements;
+	const VkDeviceSize alignment = std::max<VkDeviceSize>(std::max(requirements.alignment, createInfo.minAlignment), 1);
+
+	// Every memory type that qualifies in index order, the first is what FindMemoryTypeIndex picks
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < m_CreateInfo.memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+	{
+		const VkMemoryPropertyFlags typeFlags = m_CreateInfo.memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+		if (!(requirements.memoryTypeBits & (1u << memoryTypeIndex)) || (typeFlags & createInfo.properties) != createInfo.properties)
+			continue;
+
+		// Flushes of non coherent memory work on whole atoms, neighbours mustn't share one
+		VkDeviceSize typeAlignment = alignment;
+		if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+			typeAlignment = std::max(typeAlignment, m_CreateInfo.nonCoherentAtomSize);
+
+		VulkanAllocation* pAllocation = nullptr;
+		if (createInfo.bDedicated || requirements.size > GetBlockSize(memoryTypeIndex) / 2)
+		{
+			pAllocation = AllocateDedicated(memoryTypeIndex, createInfo);
+		}
+		else
+		{
+			// No block left to draw from, a tighter dedicated allocation may still fit the heap
+			pAllocation = AllocateFromBlocks(memoryTypeIndex, requirements.size, typeAlignment, createInfo.eTiling);
+			if (pAllocation == nullptr)
+				pAllocation = AllocateDedicated(memoryTypeIndex, createInfo);
+		}
+
+		if (pAllocation)
+		{
+			pAllocation->bMovable = false;
+			pAllocation->buffer = VK_NULL_HANDLE;
+			pAllocation->onMoved = nullptr;
+			pAllocation->bufferInfo = {};
+
+			++m_uiAllocationsServed;
+			return pAllocation;
+		}
+	}
+
+	LOG_ERROR("Failed to allocate {0} bytes of device memory, {1} of {2} VkDeviceMemory objects in use!", requirements.size,
+			  m_uiDeviceMemoryCount, m_CreateInfo.maxMemoryAllocationCount);
+
+	return nullptr;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryAllocator::Free(VulkanAllocation* pAllocation)
+{
+	if (pAllocation == nullptr)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (pAllocation->bDedicated)
+	{
+		if (pAllocation->pMapped)
+			m_pBackend->UnmapMemory(pAllocation->memory);
+
+		m_pBackend->FreeMemory(pAllocation->memory);
+		--m_uiDeviceMemoryCount;
+
+		m_vecDedicated.erase(std::find(m_vecDedicated.begin(), m_vecDedicated.end(), pAllocation));
+	}
+	else
+	{
+		VulkanMemoryBlock* pBlock = pAllocation->pBlock;
+		pBlock->Release(pAllocation->node);
+
+		if (pBlock->m_uiAllocationCount == 0)
+			ReleaseEmptyBlocks(pAllocation->memoryTypeIndex);
+	}
+
+	SAFE_DELETE(pAllocation);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<VulkanDefragmentationMove> VulkanMemoryAllocator::BeginDefragmentation(uint32_t maxMoves)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::vector<VulkanDefragmentationMove> vecMoves;
+	std::set<VulkanAllocation*> setMoved;
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < m_CreateInfo.memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+	{
+		// Fullest first, moves only ever go towards the front
+		std::vector<VulkanMemoryBlock*> vecBlocks = m_arrBlocks[memoryTypeIndex];
+		std::stable_sort(vecBlocks.begin(), vecBlocks.end(), [](const VulkanMemoryBlock* pA, const VulkanMemoryBlock* pB)
+		{
+			return pA->m_vkUsedBytes > pB->m_vkUsedBytes;
+		});
+
+		for (size_t source = vecBlocks.size(); source-- > 0 && vecMoves.size() < maxMoves;)
+		{
+			VulkanMemoryBlock* pSource = vecBlocks[source];
+
+			// Reserving destinations splits nodes, so snapshot the allocations first. Reserved nodes of allocations that
+			// live in another block are skipped by the pBlock check.
+			std::vector<VulkanAllocation*> vecCandidates;
+			for (uint32_t node = pSource->m_uiFirstNode; node != TLSF_INVALID_NODE; node = pSource->m_vecNodes[node].nextPhysical)
+			{
+				VulkanAllocation* pAllocation = pSource->m_vecNodes[node].pAllocation;
+				if (pAllocation && pAllocation->bMovable && pAllocation->pBlock == pSource && setMoved.count(pAllocation) == 0)
+					vecCandidates.push_back(pAllocation);
+			}
+
+			for (VulkanAllocation* pAllocation : vecCandidates)
+			{
+				if (vecMoves.size() >= maxMoves)
+					break;
+
+				VulkanMemoryBlock* pDestination = nullptr;
+				uint32_t node = TLSF_INVALID_NODE;
+				VkDeviceSize offset = 0;
+
+				for (size_t destination = 0; destination < source && pDestination == nullptr; ++destination)
+				{
+					VulkanMemoryBlock* pBlock = vecBlocks[destination];
+					if (pBlock->FindPlacement(pAllocation->size, pAllocation->alignment, pAllocation->eTiling, pBlock->m_vkSize, node, offset))
+						pDestination = pBlock;
+				}
+
+				// Otherwise towards the front of its own block, ending before it starts so the ranges don't overlap
+				if (pDestination == nullptr && pSource->FindPlacement(pAllocation->size, pAllocation->alignment, pAllocation->eTiling,
+																	 pAllocation->offset, node, offset))
+				{
+					pDestination = pSource;
+				}
+
+				if (pDestination == nullptr)
+					continue;
+
+				VulkanDefragmentationMove move;
+				move.pAllocation = pAllocation;
+				move.dstMemory = pDestination->m_vkMemory;
+				move.dstOffset = offset;
+				move.pDstMapped = pDestination->m_pMapped ? pDestination->m_pMapped + offset : nullptr;
+				move.pDstBlock = pDestination;
+				move.dstNode = pDestination->Commit(node, offset, pAllocation->size, pAllocation->eTiling, pAllocation);
+
+				vecMoves.push_back(move);
+				setMoved.insert(pAllocation);
+			}
+		}
+	}
+
+	return vecMoves;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryAllocator::EndDefragmentation(const std::vector<VulkanDefragmentationMove>& vecMoves)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	VkDeviceSize movedBytes = 0;
+	for (const VulkanDefragmentationMove& move : vecMoves)
+	{
+		VulkanAllocation* pAllocation = move.pAllocation;
+		pAllocation->pBlock->Release(pAllocation->node);
+
+		pAllocation->memory = move.dstMemory;
+		pAllocation->offset = move.dstOffset;
+		pAllocation->pMapped = move.pDstMapped;
+		pAllocation->pBlock = move.pDstBlock;
+		pAllocation->node = move.dstNode;
+
+		movedBytes += pAllocation->size;
+	}
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < m_CreateInfo.memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+		ReleaseEmptyBlocks(memoryTypeIndex);
+
+	m_uiLastDefragmentationMoves = static_cast<uint32_t>(vecMoves.size());
+	m_uiLastDefragmentationBytes = movedBytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+DeviceMemoryStats VulkanMemoryAllocator::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	DeviceMemoryStats stats = {};
+	stats.deviceMemoryCount = m_uiDeviceMemoryCount;
+	stats.maxDeviceMemoryCount = m_CreateInfo.maxMemoryAllocationCount;
+	stats.allocateCalls = m_uiAllocateCalls;
+	stats.allocationsServed = m_uiAllocationsServed;
+	stats.lastDefragmentationMoves = m_uiLastDefragmentationMoves;
+	stats.lastDefragmentationBytes = m_uiLastDefragmentationBytes;
+
+	VkDeviceSize largestFree = 0;
+	for (const std::vector<VulkanMemoryBlock*>& vecBlocks : m_arrBlocks)
+	{
+		for (const VulkanMemoryBlock* pBlock : vecBlocks)
+		{
+			++stats.blockCount;
+			stats.allocationCount += pBlock->m_uiAllocationCount;
+			stats.blockBytes += pBlock->m_vkSize;
+			stats.blockUsedBytes += pBlock->m_vkUsedBytes;
+
+			largestFree = std::max(largestFree, pBlock->GetLargestFree());
+		}
+	}
+
+	for (const VulkanAllocation* pAllocation : m_vecDedicated)
+	{
+		++stats.dedicatedCount;
+		++stats.allocationCount;
+		stats.dedicatedBytes += pAllocation->size;
+	}
+
+	const VkDeviceSize freeBytes = stats.blockBytes - stats.blockUsedBytes;
+	stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(largestFree) / freeBytes : 0.0f;
+
+	return stats;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanMemoryAllocator::CheckConsistency()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	uint32_t blockCount = 0;
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; ++memoryTypeIndex)
+	{
+		uint32_t emptyCount = 0;
+		for (const VulkanMemoryBlock* pBlock : m_arrBlocks[memoryTypeIndex])
+		{
+			if (pBlock->m_uiMemoryTypeIndex != memoryTypeIndex || !pBlock->Validate())
+				return false;
+
+			emptyCount += pBlock->m_uiAllocationCount == 0 ? 1 : 0;
+			++blockCount;
+		}
+
+		if (emptyCount > 1)
+			return false;
+	}
+
+	return blockCount + m_vecDedicated.size() == m_uiDeviceMemoryCount;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanMemoryAllocator::Cleanup()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	uint32_t leakedCount = static_cast<uint32_t>(m_vecDedicated.size());
+
+	for (std::vector<VulkanMemoryBlock*>& vecBlocks : m_arrBlocks)
+	{
+		for (VulkanMemoryBlock* pBlock : vecBlocks)
+		{
+			for (uint32_t node = pBlock->m_uiFirstNode; node != TLSF_INVALID_NODE; node = pBlock->m_vecNodes[node].nextPhysical)
+			{
+				if (pBlock->m_vecNodes[node].pAllocation)
+				{
+					delete pBlock->m_vecNodes[node].pAllocation;
+					++leakedCount;
+				}
+			}
+
+			if (pBlock->m_pMapped)
+				m_pBackend->UnmapMemory(pBlock->m_vkMemory);
+
+			m_pBackend->FreeMemory(pBlock->m_vkMemory);
+			SAFE_DELETE(pBlock);
+		}
+
+		vecBlocks.clear();
+	}
+
+	for (VulkanAllocation* pAllocation : m_vecDedicated)
+	{
+		if (pAllocation->pMapped)
+			m_pBackend->UnmapMemory(pAllocation->memory);
+
+		m_pBackend->FreeMemory(pAllocation->memory);
+		SAFE_DELETE(pAllocation);
+	}
+
+	m_vecDedicated.clear();
+	m_uiDeviceMemoryCount = 0;
+
+	if (leakedCount > 0)
+	{
+		LOG_WARNING("{0} device memory allocations still alive at cleanup!", leakedCount);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Host memory standing in for VkDeviceMemory, heap sizes are enforced so exhaustion can be tested
+class MockMemoryBackend : public IVulkanMemoryBackend
+{
+public:
+	MockMemoryBackend(const VkPhysicalDeviceMemoryProperties& memoryProperties)
+	{
+		m_MemoryProperties = memoryProperties;
+		m_arrHeapUsage.fill(0);
+		m_uiNextHandle = 1;
+		m_uiPeakCount = 0;
+	}
+
+	virtual VkResult AllocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkDeviceMemory* pOutMemory) override
+	{
+		const uint32_t heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		if (m_arrHeapUsage[heapIndex] + size > m_MemoryProperties.memoryHeaps[heapIndex].size)
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+		m_arrHeapUsage[heapIndex] += size;
+
+		MockMemory& memory = m_mapMemory[m_uiNextHandle];
+		memory.heapIndex = heapIndex;
+		memory.vecData.resize(static_cast<size_t>(size));
+
+		*pOutMemory = reinterpret_cast<VkDeviceMemory>(static_cast<uintptr_t>(m_uiNextHandle++));
+		m_uiPeakCount = std::max(m_uiPeakCount, static_cast<uint32_t>(m_mapMemory.size()));
+
+		return VK_SUCCESS;
+	}
+
+	virtual void FreeMemory(VkDeviceMemory memory) override
+	{
+		auto it = m_mapMemory.find(reinterpret_cast<uintptr_t>(memory));
+		m_arrHeapUsage[it->second.heapIndex] -= it->second.vecData.size();
+		m_mapMemory.erase(it);
+	}
+
+	virtual void* MapMemory(VkDeviceMemory memory) override
+	{
+		return m_mapMemory[reinterpret_cast<uintptr_t>(memory)].vecData.data();
+	}
+
+	virtual void UnmapMemory(VkDeviceMemory memory) override {}
+
+	uint32_t GetPeakCount() const { return m_uiPeakCount; }
+
+private:
+	struct MockMemory
+	{
+		uint32_t						heapIndex;
+		std::vector<uint8_t>			vecData;
+	};
+
+	VkPhysicalDeviceMemoryProperties	m_MemoryProperties;
+	std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS>	m_arrHeapUsage;
+	std::map<uintptr_t, MockMemory>		m_mapMemory;
+	uintptr_t							m_uiNextHandle;
+	uint32_t							m_uiPeakCount;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Device local, host visible & coherent, host visible only. heapSize for the device local heap.
+inline VkPhysicalDeviceMemoryProperties MockMemoryProperties(VkDeviceSize heapSize)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	memoryProperties.memoryHeapCount = 2;
+	memoryProperties.memoryHeaps[0].size = heapSize;
+	memoryProperties.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+	memoryProperties.memoryHeaps[1].size = 512ull * 1024 * 1024;
+
+	memoryProperties.memoryTypeCount = 3;
+	memoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	memoryProperties.memoryTypes[0].heapIndex = 0;
+	memoryProperties.memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	memoryProperties.memoryTypes[1].heapIndex = 1;
+	memoryProperties.memoryTypes[2].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	memoryProperties.memoryTypes[2].heapIndex = 1;
+
+	return memoryProperties;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline VulkanAllocationCreateInfo MockRequest(VkDeviceSize size, VkDeviceSize alignment, uint32_t memoryTypeBits, VkMemoryPropertyFlags properties,
+											  ResourceTiling eTiling = ResourceTiling::LINEAR)
+{
+	VulkanAllocationCreateInfo createInfo;
+	createInfo.requirements.size = size;
+	createInfo.requirements.alignment = alignment;
+	createInfo.requirements.memoryTypeBits = memoryTypeBits;
+	createInfo.properties = properties;
+	createInfo.eTiling = eTiling;
+
+	return createInfo;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Bytes derived from the seed over the first & last 256 bytes, enough to catch a move or an overlap. Where the two
+//--- ranges overlap on small allocations the tail wins.
+inline void WritePattern(VulkanAllocation* pAllocation, uint32_t seed)
+{
+	uint8_t* pData = static_cast<uint8_t*>(pAllocation->pMapped);
+	const VkDeviceSize count = std::min<VkDeviceSize>(pAllocation->size, 256);
+
+	for (VkDeviceSize i = 0; i < count; ++i)
+		pData[i] = static_cast<uint8_t>(seed + i * 31);
+
+	for (VkDeviceSize i = 0; i < count; ++i)
+		pData[pAllocation->size - 1 - i] = static_cast<uint8_t>(seed * 7 + i);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool CheckPattern(const VulkanAllocation* pAllocation, uint32_t seed)
+{
+	const uint8_t* pData = static_cast<const uint8_t*>(pAllocation->pMapped);
+	const VkDeviceSize count = std::min<VkDeviceSize>(pAllocation->size, 256);
+
+	for (VkDeviceSize i = 0; i < count && i < pAllocation->size - count; ++i)
+	{
+		if (pData[i] != static_cast<uint8_t>(seed + i * 31))
+			return false;
+	}
+
+	for (VkDeviceSize i = 0; i < count; ++i)
+	{
+		if (pData[pAllocation->size - 1 - i] != static_cast<uint8_t>(seed * 7 + i))
+			return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Live ranges sorted by memory & offset mustn't overlap, LINEAR & OPTIMAL neighbours mustn't share a page
+inline bool CheckRanges(std::vector<const VulkanAllocation*> vecAllocations, VkDeviceSize granularity)
+{
+	std::sort(vecAllocations.begin(), vecAllocations.end(), [](const VulkanAllocation* pA, const VulkanAllocation* pB)
+	{
+		return pA->memory != pB->memory ? pA->memory < pB->memory : pA->offset < pB->offset;
+	});
+
+	for (size_t i = 0; i + 1 < vecAllocations.size(); ++i)
+	{
+		const VulkanAllocation* pA = vecAllocations[i];
+		const VulkanAllocation* pB = vecAllocations[i + 1];
+		if (pA->memory != pB->memory)
+			continue;
+
+		if (pA->offset + pA->size > pB->offset)
+			return false;
+
+		if (granularity > 1 && pA->eTiling != pB->eTiling && OnSamePage(pA->offset + pA->size - 1, pB->offset, granularity))
+			return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<MemoryAllocatorValidationResult> VulkanMemoryAllocator::RunMemoryAllocatorValidation()
+{
+	std::vector<MemoryAllocatorValidationResult> vecResults;
+
+	const VkDeviceSize blockSize = 4ull * 1024 * 1024;
+	const uint32_t allMemoryTypes = 0x7;
+	const VkMemoryPropertyFlags arrProperties[] =
+	{
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+	};
+
+	VulkanMemoryAllocatorCreateInfo createInfo = {};
+	createInfo.memoryProperties = MockMemoryProperties(512ull * 1024 * 1024);
+	createInfo.bufferImageGranularity = 1;
+	createInfo.nonCoherentAtomSize = 256;
+	createInfo.maxMemoryAllocationCount = 4096;
+	createInfo.preferredBlockSize = blockSize;
+
+	//--- Random churn, sizes from 16 bytes to 1.5 MB & alignments up to 4k over every memory type, a few dedicated ones
+	{
+		MockMemoryBackend backend(createInfo.memoryProperties);
+		VulkanMemoryAllocator allocator(&backend, createInfo);
+
+		std::mt19937 rng(48);
+		std::vector<std::pair<VulkanAllocation*, uint32_t>> vecLive;
+
+		MemoryAllocatorValidationResult result = {};
+		result.name = "Random churn";
+		result.bValid = true;
+
+		float allocatorMs = 0.0f;
+		const uint32_t operationCount = 40000;
+		for (uint32_t operation = 0; operation < operationCount && result.bValid; ++operation)
+		{
+			const bool bAllocate = vecLive.size() < 64 || (vecLive.size() < 3000 && rng() % 100 < 55);
+			if (bAllocate)
+			{
+				VkDeviceSize size = (16ull << (rng() % 14)) + rng() % 4096;
+				if (rng() % 500 == 0)
+					size = blockSize - rng() % 1024;
+
+				const VkDeviceSize alignment = 1ull << (rng() % 13);
+				const VkMemoryPropertyFlags properties = arrProperties[rng() % 3];
+
+				const auto startTime = std::chrono::high_resolution_clock::now();
+				VulkanAllocation* pAllocation = allocator.Allocate(MockRequest(size, alignment, allMemoryTypes, properties));
+				allocatorMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+				if (pAllocation == nullptr || pAllocation->offset % alignment != 0 || pAllocation->size != size ||
+					(pAllocation->memoryTypeIndex == 2 && pAllocation->offset % createInfo.nonCoherentAtomSize != 0))
+				{
+					result.bValid = false;
+					break;
+				}
+
+				const uint32_t seed = rng();
+				if (pAllocation->pMapped)
+					WritePattern(pAllocation, seed);
+
+				vecLive.push_back({ pAllocation, seed });
+				++result.allocationCount;
+			}
+			else
+			{
+				const size_t index = rng() % vecLive.size();
+				VulkanAllocation* pAllocation = vecLive[index].first;
+
+				if (pAllocation->pMapped && !CheckPattern(pAllocation, vecLive[index].second))
+					result.bValid = false;
+
+				const auto startTime = std::chrono::high_resolution_clock::now();
+				allocator.Free(pAllocation);
+				allocatorMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+				vecLive[index] = vecLive.back();
+				vecLive.pop_back();
+			}
+
+			if (operation % 2000 == 0)
+			{
+				std::vector<const VulkanAllocation*> vecRanges;
+				for (const auto& live : vecLive)
+					vecRanges.push_back(live.first);
+
+				result.bValid &= allocator.CheckConsistency() && CheckRanges(vecRanges, 1);
+			}
+		}
+
+		result.fragmentation = allocator.GetStats().fragmentation;
+
+		for (const auto& live : vecLive)
+		{
+			result.bValid &= live.first->pMapped == nullptr || CheckPattern(live.first, live.second);
+			allocator.Free(live.first);
+		}
+
+		result.bValid &= allocator.CheckConsistency() && allocator.GetStats().blockCount <= 3;
+		result.peakDeviceMemoryCount = backend.GetPeakCount();
+		result.allocateUs = allocatorMs * 1000.0f / operationCount;
+
+		vecResults.push_back(result);
+	}
+
+	//--- Buffers & optimal images interleaved with a 4k bufferImageGranularity
+	{
+		VulkanMemoryAllocatorCreateInfo granularityInfo = createInfo;
+		granularityInfo.bufferImageGranularity = 4096;
+
+		MockMemoryBackend backend(granularityInfo.memoryProperties);
+		VulkanMemoryAllocator allocator(&backend, granularityInfo);
+
+		std::mt19937 rng(4096);
+		std::vector<VulkanAllocation*> vecLive;
+
+		MemoryAllocatorValidationResult result = {};
+		result.name = "Buffer-image granularity";
+		result.bValid = true;
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		for (uint32_t operation = 0; operation < 20000 && result.bValid; ++operation)
+		{
+			if (vecLive.size() < 32 || rng() % 100 < 52)
+			{
+				const ResourceTiling eTiling = rng() % 2 ? ResourceTiling::OPTIMAL : ResourceTiling::LINEAR;
+				VulkanAllocation* pAllocation = allocator.Allocate(MockRequest(64 + rng() % 8192, 16ull << (rng() % 5), 0x1,
+																			   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, eTiling));
+				if (pAllocation == nullptr)
+				{
+					result.bValid = false;
+					break;
+				}
+
+				vecLive.push_back(pAllocation);
+				++result.allocationCount;
+			}
+			else
+			{
+				const size_t index = rng() % vecLive.size();
+				allocator.Free(vecLive[index]);
+
+				vecLive[index] = vecLive.back();
+				vecLive.pop_back();
+			}
+
+			if (operation % 1000 == 0)
+				result.bValid &= allocator.CheckConsistency() && CheckRanges(std::vector<const VulkanAllocation*>(vecLive.begin(), vecLive.end()), 4096);
+		}
+
+		const float totalMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		result.bValid &= CheckRanges(std::vector<const VulkanAllocation*>(vecLive.begin(), vecLive.end()), 4096);
+		result.fragmentation = allocator.GetStats().fragmentation;
+		result.peakDeviceMemoryCount = backend.GetPeakCount();
+		result.allocateUs = totalMs * 1000.0f / 20000;
+
+		for (VulkanAllocation* pAllocation : vecLive)
+			allocator.Free(pAllocation);
+
+		vecResults.push_back(result);
+	}
+
+	//--- Half a block & up, or asked for, get their own memory at offset 0, mapped when host visible
+	{
+		MockMemoryBackend backend(createInfo.memoryProperties);
+		VulkanMemoryAllocator allocator(&backend, createInfo);
+
+		MemoryAllocatorValidationResult result = {};
+		result.name = "Dedicated";
+
+		VulkanAllocation* pSmall = allocator.Allocate(MockRequest(1024, 256, allMemoryTypes, arrProperties[1]));
+		VulkanAllocation* pLarge = allocator.Allocate(MockRequest(blockSize / 2 + 1, 256, allMemoryTypes, arrProperties[1]));
+
+		VulkanAllocationCreateInfo requestInfo = MockRequest(4096, 256, allMemoryTypes, arrProperties[0]);
+		requestInfo.bDedicated = true;
+		VulkanAllocation* pRequested = allocator.Allocate(requestInfo);
+
+		const DeviceMemoryStats stats = allocator.GetStats();
+		result.bValid = pSmall && !pSmall->bDedicated && pLarge && pLarge->bDedicated && pLarge->offset == 0 && pLarge->pMapped &&
+						pRequested && pRequested->bDedicated && pRequested->pMapped == nullptr && stats.dedicatedCount == 2 && stats.blockCount == 1;
+
+		allocator.Free(pSmall);
+		allocator.Free(pLarge);
+		allocator.Free(pRequested);
+
+		result.bValid &= allocator.GetStats().deviceMemoryCount == 1 && allocator.CheckConsistency();
+		result.allocationCount = 3;
+		result.peakDeviceMemoryCount = backend.GetPeakCount();
+
+		vecResults.push_back(result);
+	}
+
+	//--- 2000 small buffers under a maxMemoryAllocationCount of 3, one VkDeviceMemory each would have failed at the 4th
+	{
+		VulkanMemoryAllocatorCreateInfo limitInfo = createInfo;
+		limitInfo.maxMemoryAllocationCount = 3;
+
+		MockMemoryBackend backend(limitInfo.memoryProperties);
+		VulkanMemoryAllocator allocator(&backend, limitInfo);
+
+		MemoryAllocatorValidationResult result = {};
+		result.name = "Allocation count limit";
+		result.bValid = true;
+
+		std::vector<VulkanAllocation*> vecLive;
+		for (uint32_t i = 0; i < 2000; ++i)
+		{
+			VulkanAllocation* pAllocation = allocator.Allocate(MockRequest(1024 + (i % 4) * 512, 256, allMemoryTypes, arrProperties[0]));
+			result.bValid &= pAllocation != nullptr;
+			vecLive.push_back(pAllocation);
+		}
+
+		// One block is in use, two dedicated ones reach the limit & the third has to fail cleanly
+		uint32_t dedicatedCount = 0;
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			VulkanAllocation* pAllocation = allocator.Allocate(MockRequest(blockSize, 256, allMemoryTypes, arrProperties[0]));
+			dedicatedCount += pAllocation ? 1 : 0;
+			vecLive.push_back(pAllocation);
+		}
+
+		result.bValid &= dedicatedCount == 2 && allocator.GetStats().deviceMemoryCount == 3 && allocator.CheckConsistency();
+		result.allocationCount = 2000 + dedicatedCount;
+		result.peakDeviceMemoryCount = backend.GetPeakCount();
+
+		for (VulkanAllocation* pAllocation : vecLive)
+			allocator.Free(pAllocation);
+
+		vecResults.push_back(result);
+	}
+
+	//--- A 10 MB heap holds two 4 MB blocks, the last 2 MB get served as dedicated allocations before it runs dry
+	{
+		VulkanMemoryAllocatorCreateInfo heapInfo = createInfo;
+		heapInfo.memoryProperties = MockMemoryProperties(10ull * 1024 * 1024);
+
+		MockMemoryBackend backend(heapInfo.memoryProperties);
+		VulkanMemoryAllocator allocator(&backend, heapInfo);
+
+		MemoryAllocatorValidationResult result = {};
+		result.name = "Heap exhaustion";
+
+		std::vector<VulkanAllocation*> vecLive;
+		for (uint32_t i = 0; i < 12; ++i)
+		{
+			VulkanAllocation* pAllocation = allocator.Allocate(MockRequest(1024 * 1024, 256, 0x1, arrProperties[0]));
+			if (pAllocation == nullptr)
+				break;
+
+			vecLive.push_back(pAllocation);
+		}
+
+		const DeviceMemoryStats stats = allocator.GetStats();
+		result.bValid = vecLive.size() == 10 && stats.blockCount == 2 && stats.dedicatedCount == 2 && allocator.CheckConsistency();
+		result.allocationCount = static_cast<uint32_t>(vecLive.size());
+		result.peakDeviceMemoryCount = backend.GetPeakCount();
+
+		for (VulkanAllocation* pAllocation : vecLive)
+			allocator.Free(pAllocation);
+
+		vecResults.push_back(result);
+	}
+
+	//--- Fill a dozen blocks with movable buffers, free three quarters & defragment, contents checked after the moves
+	{
+		MockMemoryBackend backend(createInfo.memoryProperties);
+		VulkanMemoryAllocator allocator(&backend, createInfo);
+
+		std::mt19937 rng(7);
+		std::vector<std::pair<VulkanAllocation*, uint32_t>> vecLive;
+
+		MemoryAllocatorValidationResult result = {};
+		result.bValid = true;
+
+		for (uint32_t i = 0; i < 6000; ++i)
+		{
+			VulkanAllocation* pAllocation = allocator.Allocate(MockRequest(4096 + (rng() % 3) * 2048, 256, allMemoryTypes, arrProperties[1]));
+			if (pAllocation == nullptr)
+			{
+				result.bValid = false;
+				break;
+			}
+
+			pAllocation->bMovable = true;
+
+			const uint32_t seed = rng();
+			WritePattern(pAllocation, seed);
+			vecLive.push_back({ pAllocation, seed });
+		}
+
+		std::shuffle(vecLive.begin(), vecLive.end(), rng);
+		while (vecLive.size() > 1500)
+		{
+			allocator.Free(vecLive.back().first);
+			vecLive.pop_back();
+		}
+
+		const DeviceMemoryStats statsBefore = allocator.GetStats();
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		// What VulkanDevice::DefragmentMemory does with a copy command
+		const std::vector<VulkanDefragmentationMove> vecMoves = allocator.BeginDefragmentation(UINT32_MAX);
+		for (const VulkanDefragmentationMove& move : vecMoves)
+			memcpy(move.pDstMapped, move.pAllocation->pMapped, static_cast<size_t>(move.pAllocation->size));
+
+		allocator.EndDefragmentation(vecMoves);
+
+		const float defragmentMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+		const DeviceMemoryStats statsAfter = allocator.GetStats();
+
+		std::vector<const VulkanAllocation*> vecRanges;
+		for (const auto& live : vecLive)
+		{
+			result.bValid &= CheckPattern(live.first, live.second);
+			vecRanges.push_back(live.first);
+		}
+
+		result.bValid &= allocator.CheckConsistency() && CheckRanges(vecRanges, 1) && statsAfter.blockCount < statsBefore.blockCount;
+		result.name = "Defragment " + std::to_string(statsBefore.blockCount) + " -> " + std::to_string(statsAfter.blockCount) + " blocks";
+		result.allocationCount = static_cast<uint32_t>(vecMoves.size());
+		result.peakDeviceMemoryCount = backend.GetPeakCount();
+		result.allocateUs = vecMoves.empty() ? 0.0f : defragmentMs * 1000.0f / vecMoves.size();
+		result.fragmentation = statsAfter.fragmentation;
+
+		for (const auto& live : vecLive)
+			allocator.Free(live.first);
+
+		vecResults.push_back(result);
+	}
+
+	for (const MemoryAllocatorValidationResult& result : vecResults)
+	{
+		if (result.bValid)
+		{
+			LOG_DEBUG("Memory allocator {0}: {1} allocations, {2} device memories, {3} us", result.name, result.allocationCount,
+					  result.peakDeviceMemoryCount, result.allocateUs);
+		}
+		else
+		{
+			LOG_ERROR("Memory allocator {0} FAILED", result.name);
+		}
+	}
+
+	return vecResults;
+}
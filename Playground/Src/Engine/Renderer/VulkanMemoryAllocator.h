@@ -0,0 +1,208 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <mutex>
+#include <functional>
+
+class VulkanMemoryBlock;
+
+const VkDeviceSize DEVICE_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;		// Preferred block size, heaps under 1 GB use heap / 8
+const VkDeviceSize DEVICE_MEMORY_LARGE_HEAP = 1024ull * 1024 * 1024;
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Where VkDeviceMemory comes from. VulkanMemoryBackend is the device, the validation swaps in a CPU side mock so the
+//--- allocator's bookkeeping runs without a GPU.
+class IVulkanMemoryBackend
+{
+public:
+	IVulkanMemoryBackend() {};
+	virtual							~IVulkanMemoryBackend() {};
+
+	// dedicatedBuffer is VK_NULL_HANDLE for blocks
+	virtual VkResult				AllocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkDeviceMemory* pOutMemory) = 0;
+	virtual void					FreeMemory(VkDeviceMemory memory) = 0;
+
+	// Whole allocation, nullptr on failure
+	virtual void*					MapMemory(VkDeviceMemory memory) = 0;
+	virtual void					UnmapMemory(VkDeviceMemory memory) = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- vkAllocateMemory & friends. Every allocation can back device addresses, blocks are shared between buffers with &
+//--- without VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+class VulkanMemoryBackend : public IVulkanMemoryBackend
+{
+public:
+	VulkanMemoryBackend(VkDevice device);
+	virtual							~VulkanMemoryBackend() {};
+
+	virtual VkResult				AllocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkDeviceMemory* pOutMemory) override;
+	virtual void					FreeMemory(VkDeviceMemory memory) override;
+	virtual void*					MapMemory(VkDeviceMemory memory) override;
+	virtual void					UnmapMemory(VkDeviceMemory memory) override;
+
+private:
+	VkDevice						m_vkDevice;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Buffer-image granularity class of whatever gets bound. Buffers & linear images are LINEAR, optimal images OPTIMAL.
+enum class ResourceTiling
+{
+	LINEAR,
+	OPTIMAL
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct VulkanAllocationCreateInfo
+{
+	VulkanAllocationCreateInfo()
+	{
+		requirements = {};
+		properties = 0;
+		eTiling = ResourceTiling::LINEAR;
+		minAlignment = 1;
+		bDedicated = false;
+		dedicatedBuffer = VK_NULL_HANDLE;
+	}
+
+	VkMemoryRequirements			requirements;
+	VkMemoryPropertyFlags			properties;
+	ResourceTiling					eTiling;
+	VkDeviceSize					minAlignment;				// On top of requirements.alignment, e.g. for device addresses
+	bool							bDedicated;					// The driver prefers or requires a VkDeviceMemory of its own
+	VkBuffer						dedicatedBuffer;			// Passed on to VkMemoryDedicatedAllocateInfo
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Owned by the allocator, the pointer stays valid until Free even when defragmentation moves the memory.
+struct VulkanAllocation
+{
+	VkDeviceMemory					memory;
+	VkDeviceSize					offset;
+	VkDeviceSize					size;
+	VkDeviceSize					alignment;
+	void*							pMapped;					// Host visible memory only, already offset
+	uint32_t						memoryTypeIndex;
+	bool							bDedicated;
+
+	// Movable buffers, the defragmentation recreates the buffer, replaces buffer & hands the new one to onMoved
+	bool							bMovable;
+	VkBuffer						buffer;
+	std::function<void(VkBuffer)>	onMoved;
+	VkBufferCreateInfo				bufferInfo;
+
+	// Allocator side, nullptr for dedicated allocations
+	VulkanMemoryBlock*				pBlock;
+	uint32_t						node;
+	ResourceTiling					eTiling;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct VulkanMemoryAllocatorCreateInfo
+{
+	VkPhysicalDeviceMemoryProperties	memoryProperties;
+	VkDeviceSize					bufferImageGranularity;
+	VkDeviceSize					nonCoherentAtomSize;
+	uint32_t						maxMemoryAllocationCount;
+	VkDeviceSize					preferredBlockSize;			// 0 picks one per heap
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Reserved destination of one allocation, the caller copies the bytes over between Begin & EndDefragmentation
+struct VulkanDefragmentationMove
+{
+	VulkanAllocation*				pAllocation;
+	VkDeviceMemory					dstMemory;
+	VkDeviceSize					dstOffset;
+	void*							pDstMapped;
+
+	VulkanMemoryBlock*				pDstBlock;
+	uint32_t						dstNode;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct DeviceMemoryStats
+{
+	uint32_t						blockCount;
+	uint32_t						dedicatedCount;
+	uint32_t						deviceMemoryCount;			// Live VkDeviceMemory objects, blocks + dedicated
+	uint32_t						maxDeviceMemoryCount;		// maxMemoryAllocationCount
+	uint32_t						allocationCount;			// Live allocations handed out, blocks + dedicated
+	uint64_t						allocateCalls;				// vkAllocateMemory calls so far
+	uint64_t						allocationsServed;			// Allocate calls so far, what used to be one vkAllocateMemory each
+	VkDeviceSize					blockBytes;
+	VkDeviceSize					blockUsedBytes;
+	VkDeviceSize					dedicatedBytes;
+	float							fragmentation;				// 1 - largest free range / free bytes, over every block
+	uint32_t						lastDefragmentationMoves;
+	VkDeviceSize					lastDefragmentationBytes;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct MemoryAllocatorValidationResult
+{
+	std::string						name;
+	uint32_t						allocationCount;			// Allocations made over the whole test
+	uint32_t						peakDeviceMemoryCount;		// Most VkDeviceMemory objects alive at once
+	float							allocateUs;					// Mean Allocate + Free
+	float							fragmentation;
+	bool							bValid;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Draws DEVICE_MEMORY_BLOCK_SIZE blocks per memory type & sub-allocates them with a TLSF (two level segregated fit)
+//--- allocator, alignment & bufferImageGranularity between LINEAR & OPTIMAL neighbours handled. Allocations of half a
+//--- block or more & the ones the driver wants dedicated get a VkDeviceMemory of their own. Host visible blocks stay
+//--- mapped for their lifetime. One empty block per memory type is kept around for the next allocation.
+class VulkanMemoryAllocator
+{
+public:
+	VulkanMemoryAllocator(IVulkanMemoryBackend* pBackend, const VulkanMemoryAllocatorCreateInfo& createInfo);
+	~VulkanMemoryAllocator();
+
+	// nullptr when no memory type matches, the memory is exhausted or maxMemoryAllocationCount is reached
+	VulkanAllocation*				Allocate(const VulkanAllocationCreateInfo& createInfo);
+	void							Free(VulkanAllocation* pAllocation);
+
+	// Moves movable allocations out of the least used blocks into fuller ones, & towards the front of their own block.
+	// Destinations are reserved, the sources stay intact until EndDefragmentation frees them & releases empty blocks.
+	std::vector<VulkanDefragmentationMove>	BeginDefragmentation(uint32_t maxMoves);
+	void							EndDefragmentation(const std::vector<VulkanDefragmentationMove>& vecMoves);
+
+	DeviceMemoryStats				GetStats();
+
+	// Walks every block, node chains must cover the block with free nodes in their lists & merged with their neighbours
+	bool							CheckConsistency();
+
+	// Releases every block, allocations still alive are reported & leaked
+	void							Cleanup();
+
+	// Mock backend, random churn with data checks, granularity, dedicated, allocation count limit & defragmentation
+	static std::vector<MemoryAllocatorValidationResult> RunMemoryAllocatorValidation();
+
+private:
+	VulkanAllocation*				AllocateDedicated(uint32_t memoryTypeIndex, const VulkanAllocationCreateInfo& createInfo);
+	VulkanAllocation*				AllocateFromBlocks(uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceSize alignment, ResourceTiling eTiling);
+	VulkanMemoryBlock*				CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+	void							ReleaseEmptyBlocks(uint32_t memoryTypeIndex);
+
+	VkDeviceSize					GetBlockSize(uint32_t memoryTypeIndex) const;
+	bool							IsHostVisible(uint32_t memoryTypeIndex) const;
+
+private:
+	IVulkanMemoryBackend*			m_pBackend;
+	VulkanMemoryAllocatorCreateInfo	m_CreateInfo;
+
+	std::array<std::vector<VulkanMemoryBlock*>, VK_MAX_MEMORY_TYPES>	m_arrBlocks;
+	std::vector<VulkanAllocation*>	m_vecDedicated;
+
+	uint32_t						m_uiDeviceMemoryCount;
+	uint64_t						m_uiAllocateCalls;
+	uint64_t						m_uiAllocationsServed;
+	uint32_t						m_uiLastDefragmentationMoves;
+	VkDeviceSize					m_uiLastDefragmentationBytes;
+
+	std::mutex						m_Mutex;
+};
@@ -100,7 +100,8 @@ void VulkanRenderer::RunShaderCompiler(const std::string& directoryPath)
 	{
 		if (entry.is_regular_file() && 
 		   (entry.path().extension().string() == ".vert" || entry.path().extension().string() == ".frag") ||
-		    entry.path().extension().string() == ".rchit" || entry.path().extension().string() == ".rmiss"  || entry.path().extension().string() == ".rgen")
+		    entry.path().extension().string() == ".rchit" || entry.path().extension().string() == ".rmiss"  || entry.path().extension().string() == ".rgen" ||
+		    entry.path().extension().string() == ".comp")
 		{
 			std::string cmd = shaderCompiler + " --target-env=vulkan1.2" + " -c" + " " + entry.path().string() + " -o " + entry.path().string() + ".spv";
 			LOG_DEBUG("Compiling shader " + entry.path().filename().string());
@@ -0,0 +1,210 @@
+#include "PlaygroundPCH.h"
+#include "VulkanSamplerCache.h"
+
+#include "VulkanDevice.h"
+
+#include "PlaygroundHeaders.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanSamplerCache::VulkanSamplerCache()
+{
+	m_mapSamplers.clear();
+	m_mapEntries.clear();
+
+	m_uiRequests = 0;
+	m_uiHits = 0;
+	m_uiCreates = 0;
+	m_uiDestroys = 0;
+	m_uiPeakSamplers = 0;
+	m_uiDeviceLimit = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanSamplerCache::~VulkanSamplerCache()
+{
+	m_mapSamplers.clear();
+	m_mapEntries.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanSamplerCache::SamplerKey::operator==(const SamplerKey& other) const
+{
+	// Plain old data without padding between the 4 byte members, floats compare by bits so -0 & NaN stay distinct
+	return memcmp(this, &other, sizeof(SamplerKey)) == 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+size_t VulkanSamplerCache::SamplerKeyHasher::operator()(const SamplerKey& key) const
+{
+	// FNV-1a over the key's bytes
+	const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&key);
+
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(SamplerKey); ++i)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return static_cast<size_t>(hash);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanSamplerCache::SamplerKey VulkanSamplerCache::MakeKey(const VkSamplerCreateInfo& createInfo)
+{
+	SamplerKey key;
+	memset(&key, 0, sizeof(SamplerKey));
+
+	key.flags = createInfo.flags;
+	key.magFilter = createInfo.magFilter;
+	key.minFilter = createInfo.minFilter;
+	key.mipmapMode = createInfo.mipmapMode;
+	key.addressModeU = createInfo.addressModeU;
+	key.addressModeV = createInfo.addressModeV;
+	key.addressModeW = createInfo.addressModeW;
+	key.mipLodBias = createInfo.mipLodBias;
+	key.anisotropyEnable = createInfo.anisotropyEnable;
+	key.compareEnable = createInfo.compareEnable;
+	key.unnormalizedCoordinates = createInfo.unnormalizedCoordinates;
+	key.minLod = createInfo.minLod;
+	key.maxLod = createInfo.maxLod;
+
+	// Ignored state would only split otherwise identical samplers
+	key.maxAnisotropy = createInfo.anisotropyEnable ? createInfo.maxAnisotropy : 0.0f;
+	key.compareOp = createInfo.compareEnable ? createInfo.compareOp : VK_COMPARE_OP_NEVER;
+
+	const bool bUsesBorder = createInfo.addressModeU == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER ||
+							 createInfo.addressModeV == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER ||
+							 createInfo.addressModeW == VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	key.borderColor = bUsesBorder ? createInfo.borderColor : VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+
+	return key;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VkSampler VulkanSamplerCache::Acquire(VulkanDevice* pDevice, const VkSamplerCreateInfo& createInfo)
+{
+	// Queried once from the picked device, m_vkDeviceProperties holds whichever device was enumerated last
+	if (m_uiDeviceLimit == 0)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(pDevice->m_vkPhysicalDevice, &properties);
+
+		m_uiDeviceLimit = properties.limits.maxSamplerAllocationCount;
+	}
+
+	++m_uiRequests;
+
+	const bool bCacheable = createInfo.pNext == nullptr;
+	const SamplerKey key = MakeKey(createInfo);
+
+	if (bCacheable)
+	{
+		std::unordered_map<SamplerKey, VkSampler, SamplerKeyHasher>::iterator iter = m_mapSamplers.find(key);
+		if (iter != m_mapSamplers.end())
+		{
+			++m_mapEntries[iter->second].refCount;
+			++m_uiHits;
+			return iter->second;
+		}
+	}
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	if (vkCreateSampler(pDevice->m_vkLogicalDevice, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		LOG_ERROR("Failed to create Texture sampler!");
+		return VK_NULL_HANDLE;
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.refCount = 1;
+	entry.bCached = bCacheable;
+	m_mapEntries.emplace(sampler, entry);
+
+	if (bCacheable)
+		m_mapSamplers.emplace(key, sampler);
+
+	++m_uiCreates;
+	m_uiPeakSamplers = std::max(m_uiPeakSamplers, static_cast<uint32_t>(m_mapEntries.size()));
+
+	if (m_mapEntries.size() * 4 > m_uiDeviceLimit * 3)
+	{
+		LOG_WARNING("{0} live samplers, the device allows {1}", m_mapEntries.size(), m_uiDeviceLimit);
+	}
+
+	return sampler;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanSamplerCache::Release(VulkanDevice* pDevice, VkSampler sampler)
+{
+	if (sampler == VK_NULL_HANDLE)
+		return;
+
+	std::unordered_map<VkSampler, Entry>::iterator iter = m_mapEntries.find(sampler);
+	if (iter == m_mapEntries.end())
+	{
+		LOG_WARNING("Released a sampler that didn't come from the sampler cache");
+		return;
+	}
+
+	if (--iter->second.refCount > 0)
+		return;
+
+	if (iter->second.bCached)
+		m_mapSamplers.erase(iter->second.key);
+
+	vkDestroySampler(pDevice->m_vkLogicalDevice, sampler, nullptr);
+	m_mapEntries.erase(iter);
+
+	++m_uiDestroys;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanSamplerCache::Cleanup(VulkanDevice* pDevice)
+{
+	if (!m_mapEntries.empty())
+	{
+		LOG_WARNING("Sampler cache cleaned up with {0} samplers still referenced", m_mapEntries.size());
+	}
+
+	std::unordered_map<VkSampler, Entry>::iterator iter = m_mapEntries.begin();
+	for (; iter != m_mapEntries.end(); ++iter)
+	{
+		vkDestroySampler(pDevice->m_vkLogicalDevice, iter->first, nullptr);
+	}
+
+	m_mapSamplers.clear();
+	m_mapEntries.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+SamplerCacheStats VulkanSamplerCache::GetStats() const
+{
+	SamplerCacheStats stats = {};
+	stats.requests = m_uiRequests;
+	stats.hits = m_uiHits;
+	stats.creates = m_uiCreates;
+	stats.destroys = m_uiDestroys;
+	stats.liveSamplers = static_cast<uint32_t>(m_mapEntries.size());
+	stats.peakSamplers = m_uiPeakSamplers;
+	stats.deviceLimit = m_uiDeviceLimit;
+
+	std::unordered_map<VkSampler, Entry>::const_iterator iter = m_mapEntries.begin();
+	for (; iter != m_mapEntries.end(); ++iter)
+	{
+		stats.references += iter->second.refCount;
+	}
+
+	return stats;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanSamplerCache::LogStats() const
+{
+	const SamplerCacheStats stats = GetStats();
+
+	LOG_INFO("Sampler cache: {0} live samplers for {1} textures (peak {2}, device limit {3}), {4} requests, {5} hits, {6} created",
+			 stats.liveSamplers, stats.references, stats.peakSamplers, stats.deviceLimit, stats.requests, stats.hits, stats.creates);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <unordered_map>
+
+class VulkanDevice;
+
+//---------------------------------------------------------------------------------------------------------------------
+struct SamplerCacheStats
+{
+	uint32_t							requests;
+	uint32_t							hits;
+	uint32_t							creates;
+	uint32_t							destroys;
+	uint32_t							liveSamplers;
+	uint32_t							peakSamplers;
+	uint32_t							references;				// Textures currently holding one of the live samplers
+	uint32_t							deviceLimit;			// maxSamplerAllocationCount
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Shares VkSamplers between every texture created with the same VkSamplerCreateInfo state. Samplers are ref counted
+//--- & destroyed on the last Release. Create infos with a pNext chain aren't hashed, they get a sampler of their own.
+class VulkanSamplerCache
+{
+public:
+	static VulkanSamplerCache& getInstance()
+	{
+		static VulkanSamplerCache instance;
+		return instance;
+	}
+
+	~VulkanSamplerCache();
+
+	VkSampler							Acquire(VulkanDevice* pDevice, const VkSamplerCreateInfo& createInfo);
+	void								Release(VulkanDevice* pDevice, VkSampler sampler);
+
+	// Destroys whatever is still alive, call once the device is idle
+	void								Cleanup(VulkanDevice* pDevice);
+
+	SamplerCacheStats					GetStats() const;
+	void								LogStats() const;
+
+private:
+	VulkanSamplerCache();
+	VulkanSamplerCache(const VulkanSamplerCache&);
+	void operator=(const VulkanSamplerCache&);
+
+	//--- Every VkSamplerCreateInfo field that affects the sampler, floats compared bitwise
+	struct SamplerKey
+	{
+		VkSamplerCreateFlags			flags;
+		VkFilter						magFilter;
+		VkFilter						minFilter;
+		VkSamplerMipmapMode				mipmapMode;
+		VkSamplerAddressMode			addressModeU;
+		VkSamplerAddressMode			addressModeV;
+		VkSamplerAddressMode			addressModeW;
+		float							mipLodBias;
+		VkBool32						anisotropyEnable;
+		float							maxAnisotropy;
+		VkBool32						compareEnable;
+		VkCompareOp						compareOp;
+		float							minLod;
+		float							maxLod;
+		VkBorderColor					borderColor;
+		VkBool32						unnormalizedCoordinates;
+
+		bool							operator==(const SamplerKey& other) const;
+	};
+
+	struct SamplerKeyHasher
+	{
+		size_t							operator()(const SamplerKey& key) const;
+	};
+
+	struct Entry
+	{
+		SamplerKey						key;
+		uint32_t						refCount;
+		bool							bCached;				// False for pNext chains, never found by Acquire
+	};
+
+	static SamplerKey					MakeKey(const VkSamplerCreateInfo& createInfo);
+
+private:
+	std::unordered_map<SamplerKey, VkSampler, SamplerKeyHasher>	m_mapSamplers;
+	std::unordered_map<VkSampler, Entry>	m_mapEntries;
+
+	uint32_t							m_uiRequests;
+	uint32_t							m_uiHits;
+	uint32_t							m_uiCreates;
+	uint32_t							m_uiDestroys;
+	uint32_t							m_uiPeakSamplers;
+	uint32_t							m_uiDeviceLimit;
+};
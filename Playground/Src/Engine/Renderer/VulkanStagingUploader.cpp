@@ -0,0 +1,748 @@
+#include "PlaygroundPCH.h"
+#include "VulkanStagingUploader.h"
+
+#include <chrono>
+
+#include "Engine/Renderer/VulkanDevice.h"
+#include "Engine/Renderer/VulkanMemoryAllocator.h"
+#include "Engine/Helpers/Utility.h"
+#include "PlaygroundHeaders.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanStagingUploader::VulkanStagingUploader()
+{
+	m_pDevice = nullptr;
+	m_vkCommandPool = VK_NULL_HANDLE;
+	m_vkQueue = VK_NULL_HANDLE;
+	m_uiQueueFamily = 0;
+	m_uiGraphicsFamily = 0;
+	m_bOwnQueue = false;
+	m_vkGraphicsCommandPool = VK_NULL_HANDLE;
+	m_vkTimeline = VK_NULL_HANDLE;
+
+	m_vkRingBuffer = VK_NULL_HANDLE;
+	m_pRingAllocation = nullptr;
+	m_pRingData = nullptr;
+
+	m_uiRingHead = 0;
+	m_uiRingTail = 0;
+
+	for (UploadBatch& batch : m_arrBatches)
+	{
+		batch.commandBuffer = VK_NULL_HANDLE;
+		batch.graphicsCommandBuffer = VK_NULL_HANDLE;
+		batch.fence = VK_NULL_HANDLE;
+		batch.token = UPLOAD_TOKEN_NONE;
+		batch.ringEnd = 0;
+		batch.bytes = 0;
+		batch.bRecording = false;
+		batch.bGraphicsRecording = false;
+	}
+
+	m_iOpenBatch = -1;
+
+	m_uiLastSubmitted = UPLOAD_TOKEN_NONE;
+	m_uiLastCompleted = UPLOAD_TOKEN_NONE;
+
+	m_vkTimestampPool = VK_NULL_HANDLE;
+	m_fTimestampPeriod = 0.0f;
+
+	m_Stats = {};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanStagingUploader::~VulkanStagingUploader()
+{
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanStagingUploader::Init(VulkanDevice* pDevice)
+{
+	m_pDevice = pDevice;
+	m_vkQueue = pDevice->m_vkQueueTransfer;
+	m_bOwnQueue = pDevice->HasTransferQueue();
+
+	m_uiGraphicsFamily = pDevice->m_pQueueFamilyIndices->m_uiGraphicsFamily.value();
+	m_uiQueueFamily = m_bOwnQueue ? pDevice->m_pQueueFamilyIndices->m_uiTransferFamily.value() : m_uiGraphicsFamily;
+
+	// Command buffers get re-recorded every time their slot comes round again
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = m_uiQueueFamily;
+
+	VKRESULT_CHECK(vkCreateCommandPool(pDevice->m_vkLogicalDevice, &commandPoolCreateInfo, nullptr, &m_vkCommandPool));
+
+	std::array<VkCommandBuffer, STAGING_BATCH_COUNT> arrCommandBuffers;
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = m_vkCommandPool;
+	allocInfo.commandBufferCount = STAGING_BATCH_COUNT;
+
+	VKRESULT_CHECK(vkAllocateCommandBuffers(pDevice->m_vkLogicalDevice, &allocInfo, arrCommandBuffers.data()));
+
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for (uint32_t i = 0; i < STAGING_BATCH_COUNT; ++i)
+	{
+		m_arrBatches[i].commandBuffer = arrCommandBuffers[i];
+		VKRESULT_CHECK(vkCreateFence(pDevice->m_vkLogicalDevice, &fenceCreateInfo, nullptr, &m_arrBatches[i].fence));
+
+		Vulkan::SetDebugUtilsObjectName(pDevice->m_vkLogicalDevice, VK_OBJECT_TYPE_COMMAND_BUFFER, reinterpret_cast<uint64_t>(arrCommandBuffers[i]),
+										"StagingUploader_commandBuffer" + std::to_string(i));
+	}
+
+	// Acquire barriers have to be recorded on the graphics family, one command buffer next to each transfer one
+	if (m_bOwnQueue)
+	{
+		commandPoolCreateInfo.queueFamilyIndex = m_uiGraphicsFamily;
+		VKRESULT_CHECK(vkCreateCommandPool(pDevice->m_vkLogicalDevice, &commandPoolCreateInfo, nullptr, &m_vkGraphicsCommandPool));
+
+		allocInfo.commandPool = m_vkGraphicsCommandPool;
+		VKRESULT_CHECK(vkAllocateCommandBuffers(pDevice->m_vkLogicalDevice, &allocInfo, arrCommandBuffers.data()));
+
+		for (uint32_t i = 0; i < STAGING_BATCH_COUNT; ++i)
+		{
+			m_arrBatches[i].graphicsCommandBuffer = arrCommandBuffers[i];
+
+			Vulkan::SetDebugUtilsObjectName(pDevice->m_vkLogicalDevice, VK_OBJECT_TYPE_COMMAND_BUFFER, reinterpret_cast<uint64_t>(arrCommandBuffers[i]),
+											"StagingUploader_acquireCommandBuffer" + std::to_string(i));
+		}
+	}
+
+	// Async compute waits on it for the data its builds read
+	if (pDevice->m_bTimelineSemaphore)
+		m_vkTimeline = pDevice->CreateTimelineSemaphore("StagingTimeline");
+
+	// Above half a block, so the ring gets a VkDeviceMemory of its own
+	pDevice->CreateBuffer(	STAGING_RING_SIZE,
+							VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+							&m_vkRingBuffer,
+							&m_pRingAllocation,
+							"StagingRing");
+
+	if (m_pRingAllocation == nullptr || m_pRingAllocation->pMapped == nullptr)
+	{
+		LOG_CRITICAL("Failed to create the staging ring!");
+		return;
+	}
+
+	m_pRingData = static_cast<uint8_t*>(m_pRingAllocation->pMapped);
+
+	// Throughput is optional, uploads work without it. Transfer queues need the queries reset from the host.
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(pDevice->m_vkPhysicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(pDevice->m_vkPhysicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> vecQueueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(pDevice->m_vkPhysicalDevice, &queueFamilyCount, vecQueueFamilies.data());
+
+	if (properties.limits.timestampComputeAndGraphics && vecQueueFamilies[m_uiQueueFamily].timestampValidBits > 0 && (!m_bOwnQueue || pDevice->m_bHostQueryReset))
+	{
+		VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = STAGING_BATCH_COUNT * 2;
+
+		if (vkCreateQueryPool(pDevice->m_vkLogicalDevice, &queryPoolCreateInfo, nullptr, &m_vkTimestampPool) != VK_SUCCESS)
+		{
+			LOG_WARNING("Failed to create the staging timestamp pool, upload throughput won't be measured");
+			m_vkTimestampPool = VK_NULL_HANDLE;
+		}
+
+		m_fTimestampPeriod = properties.limits.timestampPeriod;
+	}
+
+	LOG_DEBUG("Staging uploader created, {0} MB ring & {1} batches in flight on the {2} queue", STAGING_RING_SIZE / (1024 * 1024), STAGING_BATCH_COUNT,
+			  m_bOwnQueue ? "transfer" : "graphics");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanStagingUploader::TryStage(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outStaging)
+{
+	return AllocateRing(size, alignment, outStaging);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+StagingAllocation VulkanStagingUploader::Stage(VkDeviceSize size, VkDeviceSize alignment)
+{
+	StagingAllocation staging = {};
+	if (AllocateRing(size, alignment, staging))
+		return staging;
+
+	// Whatever the open batch staged holds the ring, once it's in flight the space comes back with its fence
+	if (size <= STAGING_RING_SIZE)
+	{
+		Submit();
+
+		if (AllocateRing(size, alignment, staging))
+			return staging;
+	}
+
+	UploadBatch* pBatch = OpenBatch();
+
+	VulkanAllocation* pAllocation = nullptr;
+	m_pDevice->CreateBuffer(size,
+							VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+							&staging.buffer,
+							&pAllocation,
+							"StagingOversize");
+
+	if (pAllocation == nullptr)
+	{
+		LOG_ERROR("Failed to allocate a {0} MB staging buffer!", size / (1024 * 1024));
+		return StagingAllocation();
+	}
+
+	staging.offset = 0;
+	staging.size = size;
+	staging.pData = static_cast<uint8_t*>(pAllocation->pMapped);
+
+	pBatch->vecOversize.push_back(std::make_pair(staging.buffer, pAllocation));
+	pBatch->bytes += size;
+
+	m_Stats.uploadBytes += size;
+	++m_Stats.oversizeCount;
+
+	return staging;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VkCommandBuffer VulkanStagingUploader::GetCommandBuffer()
+{
+	return OpenBatch()->commandBuffer;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VkCommandBuffer VulkanStagingUploader::GetGraphicsCommandBuffer()
+{
+	UploadBatch* pBatch = OpenBatch();
+	if (!m_bOwnQueue)
+		return pBatch->commandBuffer;
+
+	if (!pBatch->bGraphicsRecording)
+	{
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		VKRESULT_CHECK(vkBeginCommandBuffer(pBatch->graphicsCommandBuffer, &beginInfo));
+		pBatch->bGraphicsRecording = true;
+	}
+
+	return pBatch->graphicsCommandBuffer;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Release & acquire carry the same layouts & families, the layout changes once between the two
+void VulkanStagingUploader::EndImageUpload(VkImage image, const VkImageSubresourceRange& subResRange, VkImageLayout newLayout)
+{
+	const VkAccessFlags dstAccessMask = newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+																							: VK_ACCESS_SHADER_READ_BIT;
+
+	VkImageMemoryBarrier imageMemoryBarrier = {};
+	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageMemoryBarrier.newLayout = newLayout;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.image = image;
+	imageMemoryBarrier.subresourceRange = subResRange;
+	imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageMemoryBarrier.dstAccessMask = dstAccessMask;
+
+	if (!m_bOwnQueue)
+	{
+		vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr,
+							 1, &imageMemoryBarrier);
+		return;
+	}
+
+	imageMemoryBarrier.srcQueueFamilyIndex = m_uiQueueFamily;
+	imageMemoryBarrier.dstQueueFamilyIndex = m_uiGraphicsFamily;
+
+	// Release, destination access has no meaning on the transfer queue
+	imageMemoryBarrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(GetCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+						 1, &imageMemoryBarrier);
+
+	// Acquire, the semaphore wait in front of it covers the transfer writes
+	imageMemoryBarrier.srcAccessMask = 0;
+	imageMemoryBarrier.dstAccessMask = dstAccessMask;
+	vkCmdPipelineBarrier(GetGraphicsCommandBuffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr,
+						 1, &imageMemoryBarrier);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanStagingUploader::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size)
+{
+	// vkCmdCopyBuffer takes any offset, 16 keeps the memcpy on aligned addresses
+	const StagingAllocation staging = Stage(size, 16);
+	if (staging.pData == nullptr)
+		return;
+
+	memcpy(staging.pData, pData, static_cast<size_t>(size));
+
+	VkBufferCopy bufferCopyRegion = {};
+	bufferCopyRegion.srcOffset = staging.offset;
+	bufferCopyRegion.dstOffset = dstOffset;
+	bufferCopyRegion.size = size;
+
+	vkCmdCopyBuffer(GetCommandBuffer(), staging.buffer, dstBuffer, 1, &bufferCopyRegion);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+UploadToken VulkanStagingUploader::Submit()
+{
+	if (m_iOpenBatch < 0)
+		return m_uiLastSubmitted;
+
+	const uint32_t slot = static_cast<uint32_t>(m_iOpenBatch);
+	UploadBatch& batch = m_arrBatches[slot];
+	const UploadToken token = m_uiLastSubmitted + 1;
+
+	// Copies don't know who reads their destination, make every transfer write visible to whatever the queue runs next.
+	// A queue of its own hands over with the timeline instead.
+	if (!m_bOwnQueue)
+	{
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr,
+							 0, nullptr);
+	}
+
+	if (m_vkTimestampPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(batch.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_vkTimestampPool, slot * 2 + 1);
+
+	VKRESULT_CHECK(vkEndCommandBuffer(batch.commandBuffer));
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &token;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+	if (m_vkTimeline != VK_NULL_HANDLE)
+	{
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_vkTimeline;
+	}
+
+	VKRESULT_CHECK(vkQueueSubmit(m_vkQueue, 1, &submitInfo, m_bOwnQueue ? VK_NULL_HANDLE : batch.fence));
+
+	// Graphics side waits for the transfers, everything submitted to graphics later is ordered behind the wait. The fence
+	// goes here so a signalled batch has both command buffers free.
+	if (m_bOwnQueue)
+	{
+		if (batch.bGraphicsRecording)
+			VKRESULT_CHECK(vkEndCommandBuffer(batch.graphicsCommandBuffer));
+
+		VkTimelineSemaphoreSubmitInfo waitTimelineInfo = {};
+		waitTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		waitTimelineInfo.waitSemaphoreValueCount = 1;
+		waitTimelineInfo.pWaitSemaphoreValues = &token;
+
+		const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+		VkSubmitInfo graphicsSubmitInfo = {};
+		graphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		graphicsSubmitInfo.pNext = &waitTimelineInfo;
+		graphicsSubmitInfo.waitSemaphoreCount = 1;
+		graphicsSubmitInfo.pWaitSemaphores = &m_vkTimeline;
+		graphicsSubmitInfo.pWaitDstStageMask = &waitStage;
+		graphicsSubmitInfo.commandBufferCount = batch.bGraphicsRecording ? 1 : 0;
+		graphicsSubmitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+
+		VKRESULT_CHECK(vkQueueSubmit(m_pDevice->m_vkQueueGraphics, 1, &graphicsSubmitInfo, batch.fence));
+
+		batch.bGraphicsRecording = false;
+	}
+
+	batch.token = token;
+	m_uiLastSubmitted = token;
+	batch.ringEnd = m_uiRingHead;
+	batch.bRecording = false;
+
+	m_queInFlight.push_back(slot);
+	m_iOpenBatch = -1;
+	++m_Stats.submitCount;
+
+	// Cheap, keeps the ring from filling up with batches that are long done
+	RetireCompleted();
+
+	return batch.token;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanStagingUploader::IsComplete(UploadToken token)
+{
+	if (token <= m_uiLastCompleted)
+		return true;
+
+	RetireCompleted();
+
+	return token <= m_uiLastCompleted;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanStagingUploader::Wait(UploadToken token)
+{
+	while (token > m_uiLastCompleted && !m_queInFlight.empty())
+		WaitOldest();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanStagingUploader::WaitIdle()
+{
+	Wait(m_uiLastSubmitted);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+UploadStats VulkanStagingUploader::GetStats() const
+{
+	UploadStats stats = m_Stats;
+	stats.ringSize = STAGING_RING_SIZE;
+	stats.ringInFlight = m_uiRingHead - m_uiRingTail;
+	stats.batchesInFlight = static_cast<uint32_t>(m_queInFlight.size());
+
+	return stats;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanStagingUploader::Cleanup()
+{
+	if (m_pDevice == nullptr)
+		return;
+
+	// Recorded work still holds oversize buffers, send it off so they get released the usual way
+	Submit();
+	WaitIdle();
+
+	for (UploadBatch& batch : m_arrBatches)
+	{
+		vkDestroyFence(m_pDevice->m_vkLogicalDevice, batch.fence, nullptr);
+		batch.fence = VK_NULL_HANDLE;
+		batch.commandBuffer = VK_NULL_HANDLE;
+		batch.graphicsCommandBuffer = VK_NULL_HANDLE;
+	}
+
+	vkDestroyCommandPool(m_pDevice->m_vkLogicalDevice, m_vkCommandPool, nullptr);
+	m_vkCommandPool = VK_NULL_HANDLE;
+
+	if (m_vkGraphicsCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(m_pDevice->m_vkLogicalDevice, m_vkGraphicsCommandPool, nullptr);
+	}
+
+	m_vkGraphicsCommandPool = VK_NULL_HANDLE;
+
+	if (m_vkTimeline != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(m_pDevice->m_vkLogicalDevice, m_vkTimeline, nullptr);
+	}
+
+	m_vkTimeline = VK_NULL_HANDLE;
+
+	if (m_vkTimestampPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_pDevice->m_vkLogicalDevice, m_vkTimestampPool, nullptr);
+	}
+
+	m_vkTimestampPool = VK_NULL_HANDLE;
+
+	if (m_pRingAllocation != nullptr)
+	{
+		m_pDevice->DestroyBuffer(m_vkRingBuffer, m_pRingAllocation);
+	}
+
+	m_vkRingBuffer = VK_NULL_HANDLE;
+	m_pRingAllocation = nullptr;
+	m_pRingData = nullptr;
+
+	m_pDevice = nullptr;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanStagingUploader::UploadBatch* VulkanStagingUploader::OpenBatch()
+{
+	if (m_iOpenBatch >= 0)
+		return &m_arrBatches[m_iOpenBatch];
+
+	// Every slot in flight, the oldest one is the first to come back
+	if (m_queInFlight.size() == STAGING_BATCH_COUNT)
+	{
+		m_Stats.stallMs += WaitOldest();
+		++m_Stats.stallCount;
+	}
+
+	uint32_t slot = 0;
+	while (m_arrBatches[slot].token != UPLOAD_TOKEN_NONE)
+		++slot;
+
+	UploadBatch& batch = m_arrBatches[slot];
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	// Resets the command buffer implicitly, the pool allows it
+	VKRESULT_CHECK(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+
+	if (m_vkTimestampPool != VK_NULL_HANDLE)
+	{
+		// The slot's earlier results were read when it retired
+		if (m_bOwnQueue)
+			vkResetQueryPool(m_pDevice->m_vkLogicalDevice, m_vkTimestampPool, slot * 2, 2);
+		else
+			vkCmdResetQueryPool(batch.commandBuffer, m_vkTimestampPool, slot * 2, 2);
+
+		vkCmdWriteTimestamp(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_vkTimestampPool, slot * 2);
+	}
+
+	batch.bytes = 0;
+	batch.bRecording = true;
+	m_iOpenBatch = static_cast<int32_t>(slot);
+
+	return &batch;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Allocations never straddle the end of the ring, the remainder gets skipped & the allocation starts at the front
+bool VulkanStagingUploader::AllocateRing(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outStaging)
+{
+	if (m_pRingData == nullptr || size > STAGING_RING_SIZE)
+		return false;
+
+	alignment = std::max<VkDeviceSize>(alignment, 1);
+
+	while (true)
+	{
+		// Nothing staged or in flight, start over at the front so large sizes don't straddle the end
+		if (m_uiRingTail == m_uiRingHead)
+		{
+			m_uiRingHead = ((m_uiRingHead + STAGING_RING_SIZE - 1) / STAGING_RING_SIZE) * STAGING_RING_SIZE;
+			m_uiRingTail = m_uiRingHead;
+		}
+
+		uint64_t position = ((m_uiRingHead + alignment - 1) / alignment) * alignment;
+
+		const uint64_t ringOffset = position % STAGING_RING_SIZE;
+		if (ringOffset + size > STAGING_RING_SIZE)
+			position += STAGING_RING_SIZE - ringOffset;
+
+		if (position + size - m_uiRingTail <= STAGING_RING_SIZE)
+		{
+			// Opened before the head moves, so a stall on a batch slot can't see a half claimed range
+			OpenBatch()->bytes += size;
+
+			m_uiRingHead = position + size;
+
+			outStaging.buffer = m_vkRingBuffer;
+			outStaging.offset = position % STAGING_RING_SIZE;
+			outStaging.size = size;
+			outStaging.pData = m_pRingData + outStaging.offset;
+
+			m_Stats.uploadBytes += size;
+
+			return true;
+		}
+
+		// Only the open batch holds the ring, it has to go first
+		if (m_queInFlight.empty())
+			return false;
+
+		m_Stats.stallMs += WaitOldest();
+		++m_Stats.stallCount;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+float VulkanStagingUploader::WaitOldest()
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const uint32_t slot = m_queInFlight.front();
+	VKRESULT_CHECK(vkWaitForFences(m_pDevice->m_vkLogicalDevice, 1, &m_arrBatches[slot].fence, VK_TRUE, UINT64_MAX));
+
+	const float waitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	Retire(slot);
+
+	return waitMs;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Batches run in submit order on one queue, stop at the first one still busy
+void VulkanStagingUploader::RetireCompleted()
+{
+	while (!m_queInFlight.empty())
+	{
+		const uint32_t slot = m_queInFlight.front();
+		if (vkGetFenceStatus(m_pDevice->m_vkLogicalDevice, m_arrBatches[slot].fence) != VK_SUCCESS)
+			break;
+
+		Retire(slot);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanStagingUploader::Retire(uint32_t slot)
+{
+	UploadBatch& batch = m_arrBatches[slot];
+
+	if (m_vkTimestampPool != VK_NULL_HANDLE && batch.bytes > 0)
+	{
+		// Fence has signalled, the results are available
+		uint64_t timestamps[2] = { 0, 0 };
+		if (vkGetQueryPoolResults(m_pDevice->m_vkLogicalDevice, m_vkTimestampPool, slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+								  VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			const float batchMs = static_cast<float>(timestamps[1] - timestamps[0]) * m_fTimestampPeriod / 1000000.0f;
+
+			m_Stats.lastBatchGpuMs = batchMs;
+			m_Stats.lastBatchBytes = batch.bytes;
+			m_Stats.timedBytes += batch.bytes;
+			m_Stats.gpuMs += batchMs;
+
+			if (m_Stats.gpuMs > 0.0f)
+				m_Stats.gbPerSecond = static_cast<float>(m_Stats.timedBytes) / (m_Stats.gpuMs * 1000000.0f);
+		}
+	}
+
+	for (const std::pair<VkBuffer, VulkanAllocation*>& oversize : batch.vecOversize)
+		m_pDevice->DestroyBuffer(oversize.first, oversize.second);
+
+	batch.vecOversize.clear();
+
+	VKRESULT_CHECK(vkResetFences(m_pDevice->m_vkLogicalDevice, 1, &batch.fence));
+
+	m_uiRingTail = batch.ringEnd;
+	m_uiLastCompleted = batch.token;
+
+	batch.token = UPLOAD_TOKEN_NONE;
+	batch.bytes = 0;
+
+	m_queInFlight.pop_front();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- The same bytes go to one device local buffer both ways, the old path waits on the queue after every upload
+std::vector<UploadBenchmarkResult> VulkanStagingUploader::RunUploadBenchmark(VulkanDevice* pDevice)
+{
+	std::vector<UploadBenchmarkResult> vecResults;
+
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	pUploader->WaitIdle();
+
+	const VkDeviceSize dstSize = 64 * 1024 * 1024;
+	const VkDeviceSize arrUploadSizes[3] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+	const uint32_t arrUploadCounts[3] = { 1024, 128, 16 };
+
+	VkBuffer dstBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* pDstAllocation = nullptr;
+	pDevice->CreateBuffer(dstSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &dstBuffer, &pDstAllocation,
+						  "UploadBenchmarkDst");
+
+	if (pDstAllocation == nullptr)
+	{
+		LOG_ERROR("Upload benchmark couldn't allocate its {0} MB destination", dstSize / (1024 * 1024));
+		return vecResults;
+	}
+
+	std::vector<uint8_t> vecSource(static_cast<size_t>(arrUploadSizes[2]));
+	for (size_t i = 0; i < vecSource.size(); ++i)
+		vecSource[i] = static_cast<uint8_t>(i * 31 + 7);
+
+	for (uint32_t s = 0; s < 3; ++s)
+	{
+		const VkDeviceSize uploadSize = arrUploadSizes[s];
+		const uint32_t uploadCount = arrUploadCounts[s];
+		const std::string sizeName = uploadSize >= 1024 * 1024 ? std::to_string(uploadSize / (1024 * 1024)) + " MB"
+															   : std::to_string(uploadSize / 1024) + " KB";
+
+		//--- Staging buffer, submit & vkQueueWaitIdle per upload
+		{
+			const auto start = std::chrono::high_resolution_clock::now();
+
+			for (uint32_t i = 0; i < uploadCount; ++i)
+			{
+				VkBuffer stagingBuffer;
+				VkDeviceMemory stagingBufferMemory;
+				pDevice->CreateBuffer(uploadSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+									  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer,
+									  &stagingBufferMemory);
+
+				void* pData;
+				vkMapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, 0, uploadSize, 0, &pData);
+				memcpy(pData, vecSource.data(), static_cast<size_t>(uploadSize));
+				vkUnmapMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory);
+
+				VkCommandBuffer commandBuffer = pDevice->BeginCommandBuffer("UploadBenchmark");
+
+				VkBufferCopy bufferCopyRegion = {};
+				bufferCopyRegion.dstOffset = (i * uploadSize) % dstSize;
+				bufferCopyRegion.size = uploadSize;
+				vkCmdCopyBuffer(commandBuffer, stagingBuffer, dstBuffer, 1, &bufferCopyRegion);
+
+				pDevice->EndAndSubmitCommandBuffer(commandBuffer);
+
+				vkDestroyBuffer(pDevice->m_vkLogicalDevice, stagingBuffer, nullptr);
+				vkFreeMemory(pDevice->m_vkLogicalDevice, stagingBufferMemory, nullptr);
+			}
+
+			UploadBenchmarkResult result;
+			result.name = "Per upload staging, " + sizeName;
+			result.uploadCount = uploadCount;
+			result.uploadBytes = uploadSize * uploadCount;
+			result.submitCount = uploadCount;
+			result.cpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			vecResults.push_back(result);
+		}
+
+		//--- Ring, submits only when it fills up
+		{
+			const uint32_t submitsBefore = pUploader->GetStats().submitCount;
+			const auto start = std::chrono::high_resolution_clock::now();
+
+			for (uint32_t i = 0; i < uploadCount; ++i)
+				pUploader->UploadBuffer(dstBuffer, (i * uploadSize) % dstSize, vecSource.data(), uploadSize);
+
+			pUploader->Wait(pUploader->Submit());
+
+			UploadBenchmarkResult result;
+			result.name = "Staging ring, " + sizeName;
+			result.uploadCount = uploadCount;
+			result.uploadBytes = uploadSize * uploadCount;
+			result.submitCount = pUploader->GetStats().submitCount - submitsBefore;
+			result.cpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			vecResults.push_back(result);
+		}
+	}
+
+	pDevice->DestroyBuffer(dstBuffer, pDstAllocation);
+
+	for (UploadBenchmarkResult& result : vecResults)
+	{
+		result.gbPerSecond = result.cpuMs > 0.0f ? static_cast<float>(result.uploadBytes) / (result.cpuMs * 1000000.0f) : 0.0f;
+
+		LOG_INFO("{0}: {1} uploads, {2} MB in {3:.1f} ms ({4:.2f} GB/s), {5} submits", result.name, result.uploadCount,
+				 result.uploadBytes / (1024 * 1024), result.cpuMs, result.gbPerSecond, result.submitCount);
+	}
+
+	return vecResults;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <deque>
+
+class VulkanDevice;
+struct VulkanAllocation;
+
+// Completion of one submitted batch, later tokens complete after earlier ones. UPLOAD_TOKEN_NONE is always complete.
+typedef uint64_t UploadToken;
+const UploadToken UPLOAD_TOKEN_NONE = 0;
+
+const VkDeviceSize	STAGING_RING_SIZE			= 64 * 1024 * 1024;
+const uint32_t		STAGING_BATCH_COUNT			= 4;			// Batches in flight before Stage has to wait on the oldest
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Host coherent & mapped, write pData then record a copy from buffer at offset
+struct StagingAllocation
+{
+	VkBuffer							buffer;
+	VkDeviceSize						offset;
+	VkDeviceSize						size;
+	uint8_t*							pData;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct UploadStats
+{
+	uint64_t							uploadBytes;			// Staged so far
+	uint32_t							submitCount;
+	uint32_t							oversizeCount;			// Uploads bigger than the ring that got a staging buffer of their own
+	uint32_t							stallCount;				// Times Stage had to wait on the GPU for ring space or a batch
+	float								stallMs;
+	VkDeviceSize						ringSize;
+	VkDeviceSize						ringInFlight;			// Bytes staged & not yet reclaimed
+	uint32_t							batchesInFlight;
+
+	// Transfer timestamps of completed batches, zero when the queue has no timestamps
+	uint64_t							timedBytes;
+	float								gpuMs;
+	float								lastBatchGpuMs;
+	uint64_t							lastBatchBytes;
+	float								gbPerSecond;			// timedBytes over gpuMs
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct UploadBenchmarkResult
+{
+	std::string							name;
+	uint32_t							uploadCount;
+	uint64_t							uploadBytes;
+	uint32_t							submitCount;
+	float								cpuMs;					// Until every upload is complete
+	float								gbPerSecond;			// uploadBytes over cpuMs
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Every upload to device local memory goes through one persistently mapped staging ring. Staged data & the copies
+//--- reading it are recorded into a shared command buffer, Submit sends the batch off with a fence & hands back a token
+//--- instead of waiting on the queue. Ring space of a batch is reclaimed once its fence signals, Stage only blocks when
+//--- the ring or every batch slot is still in use by the GPU.
+//---
+//--- Recorded work reaches the queue at Submit only. Batches run on the device's transfer queue, a copy engine family
+//--- when there is one. There each batch signals the timeline with its token & a graphics queue submit waits for it,
+//--- running the acquire half of image ownership transfers & whatever was recorded into GetGraphicsCommandBuffer. On
+//--- the graphics queue a batch ends with a transfer write barrier towards all commands instead. Either way graphics
+//--- work submitted after Submit sees the data without waiting on the token. The CPU has to wait before it destroys a
+//--- destination or reads it back. Main thread only.
+class VulkanStagingUploader
+{
+public:
+	VulkanStagingUploader();
+	~VulkanStagingUploader();
+
+	void								Init(VulkanDevice* pDevice);
+
+	// Ring space only, never submits the open batch. False when the ring is full of the open batch's data or size
+	// doesn't fit in the ring at all, Submit & try again or use Stage.
+	bool								TryStage(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outStaging);
+
+	// Only fails when an oversize staging buffer can't be allocated, pData is nullptr then. May submit the batch recorded so far to make room, finish writing earlier stagings before calling.
+	// Sizes over the ring get a staging buffer of their own, released with the batch.
+	StagingAllocation					Stage(VkDeviceSize size, VkDeviceSize alignment);
+
+	// Command buffer of the open batch, begun on first use. Record the copies reading staged data into it.
+	VkCommandBuffer						GetCommandBuffer();
+
+	// Graphics queue part of the open batch, runs after its transfers. Work the transfer queue can't do goes here, like
+	// blits on images handed over with EndImageUpload. Same as GetCommandBuffer on the graphics queue.
+	VkCommandBuffer						GetGraphicsCommandBuffer();
+
+	// Image copies recorded into GetCommandBuffer leave the image in TRANSFER_DST, this moves it to newLayout for the
+	// graphics queue. A queue family ownership release & acquire pair on a dedicated transfer queue, a plain transition
+	// otherwise. newLayout is SHADER_READ_ONLY, or TRANSFER_DST for more transfer work in GetGraphicsCommandBuffer.
+	void								EndImageUpload(VkImage image, const VkImageSubresourceRange& subResRange, VkImageLayout newLayout);
+
+	// Stage, memcpy & record the copy into dstBuffer in one go
+	void								UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size);
+
+	// Submits the open batch, or returns the token of the latest batch when nothing was recorded since
+	UploadToken							Submit();
+
+	bool								IsComplete(UploadToken token);
+	void								Wait(UploadToken token);
+	void								WaitIdle();
+
+	UploadStats							GetStats() const;
+
+	// Reaches a token's value once its transfers are done, VK_NULL_HANDLE without timeline semaphores
+	VkSemaphore							GetTimeline() const			{ return m_vkTimeline; }
+	bool								HasOwnQueue() const			{ return m_bOwnQueue; }
+
+	// Per upload staging buffer + BeginCommandBuffer/EndAndSubmitCommandBuffer against the ring, at a few upload sizes
+	static std::vector<UploadBenchmarkResult>	RunUploadBenchmark(VulkanDevice* pDevice);
+
+	// Waits for everything in flight & destroys the ring, batches & query pool
+	void								Cleanup();
+
+private:
+	struct UploadBatch
+	{
+		VkCommandBuffer					commandBuffer;
+		VkCommandBuffer					graphicsCommandBuffer;		// Only with a queue of its own
+		VkFence							fence;						// On the graphics submit with a queue of its own
+		UploadToken						token;				// UPLOAD_TOKEN_NONE while free or recording
+		uint64_t						ringEnd;			// Ring head at submit, the tail moves there once the batch completes
+		uint64_t						bytes;
+		bool							bRecording;
+		bool							bGraphicsRecording;
+		std::vector<std::pair<VkBuffer, VulkanAllocation*>>	vecOversize;
+	};
+
+	UploadBatch*						OpenBatch();
+	bool								AllocateRing(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& outStaging);
+	float								WaitOldest();				// Returns the ms waited
+	void								RetireCompleted();
+	void								Retire(uint32_t slot);
+
+private:
+	VulkanDevice*						m_pDevice;
+	VkCommandPool						m_vkCommandPool;
+	VkQueue								m_vkQueue;
+	uint32_t							m_uiQueueFamily;
+	uint32_t							m_uiGraphicsFamily;
+	bool								m_bOwnQueue;				// Dedicated transfer family, not the graphics queue
+	VkCommandPool						m_vkGraphicsCommandPool;	// Acquire side, only with a queue of its own
+	VkSemaphore							m_vkTimeline;
+
+	VkBuffer							m_vkRingBuffer;
+	VulkanAllocation*					m_pRingAllocation;
+	uint8_t*							m_pRingData;
+
+	// Monotonic byte positions, offset into the ring is position % STAGING_RING_SIZE
+	uint64_t							m_uiRingHead;
+	uint64_t							m_uiRingTail;
+
+	std::array<UploadBatch, STAGING_BATCH_COUNT>	m_arrBatches;
+	int32_t								m_iOpenBatch;				// -1 when nothing is recording
+	std::deque<uint32_t>				m_queInFlight;				// Batch slots in submit order
+
+	UploadToken							m_uiLastSubmitted;
+	UploadToken							m_uiLastCompleted;
+
+	VkQueryPool							m_vkTimestampPool;			// Two queries per batch slot, VK_NULL_HANDLE without timestamps
+	float								m_fTimestampPeriod;
+
+	UploadStats							m_Stats;
+};
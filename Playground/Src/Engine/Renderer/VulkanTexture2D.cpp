@@ -1,9 +1,18 @@
 #include "PlaygroundPCH.h"
 #include "VulkanTexture2D.h"
 
+#include <chrono>
+
 #include "Engine/Renderer/VulkanDevice.h"
+#include "Engine/Renderer/VulkanTextureLoader.h"
+#include "Engine/Renderer/VulkanSamplerCache.h"
 #include "Engine/Helpers/Utility.h"
 #include "Engine/Helpers/Log.h"
+#include "Engine/Renderer/VulkanMemoryAllocator.h"
+#include "Engine/Texture/HDRConverter.h"
+#include "Engine/Texture/EnvironmentSampling.h"
+#include "Engine/Texture/MipGenerator.h"
+#include "Engine/Texture/TextureCompiler.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -16,6 +25,17 @@ VulkanTexture2D::VulkanTexture2D()
 	m_vkTextureImageMemory			=	VK_NULL_HANDLE;
 	m_vkTextureDeviceSize			=	0;
 	m_vkTextureSampler				=	VK_NULL_HANDLE;
+	m_uiMipLevels					=	1;
+	m_vkTextureFormat				=	VK_FORMAT_R8G8B8A8_UNORM;
+	m_bCompiled						=	false;
+	m_uiResidentMip					=	0;
+	m_vkImageByteSize				=	0;
+	m_vecLevelByteSizes.clear();
+	m_eMipGeneration				=	MipGeneration::GPU_BLIT;
+	m_uiUploadToken					=	UPLOAD_TOKEN_NONE;
+	m_vkEnvironmentAliasBuffer		=	VK_NULL_HANDLE;
+	m_pEnvironmentAliasAllocation	=	nullptr;
+	m_vkEnvironmentAliasSize		=	0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -24,58 +44,47 @@ VulkanTexture2D::~VulkanTexture2D()
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTexture2D::CreateTexture(VulkanDevice* pDevice, std::string fileName, TextureType eType)
+void VulkanTexture2D::CreateTexture(VulkanDevice* pDevice, std::string fileName, TextureType eType, MipGeneration eMipGeneration)
 {
-	// what is the type of this texture?
-	m_eTextureType = eType;
-
-	// Create VkImage & VkImageView, Treat only Albedo as sRGB texture!
-	switch (m_eTextureType)
+	// HDRIs keep their own float path, everything else goes through the loader as a batch of one
+	if (eType == TextureType::TEXTURE_HDRI)
 	{
-		case TextureType::TEXTURE_ALBEDO:
-		{
-			CreateTextureImage(pDevice, fileName);
-			m_vkTextureImageView = Vulkan::CreateImageView(	pDevice, m_vkTextureImage,
-																	VK_FORMAT_R8G8B8A8_SRGB,
-																	VK_IMAGE_ASPECT_COLOR_BIT);
-			
-			break;
-		}
+		m_eTextureType = eType;
+		m_eMipGeneration = eMipGeneration;
 
-		case TextureType::TEXTURE_NORMAL:
-		case TextureType::TEXTURE_AO:
-		case TextureType::TEXTURE_EMISSIVE:
-		case TextureType::TEXTURE_METALNESS:
-		case TextureType::TEXTURE_ROUGHNESS:
-		case TextureType::TEXTURE_ERROR:
-		{
-			CreateTextureImage(pDevice, fileName);
-			m_vkTextureImageView = Vulkan::CreateImageView(	pDevice, m_vkTextureImage,
-																	VK_FORMAT_R8G8B8A8_UNORM,
-																	VK_IMAGE_ASPECT_COLOR_BIT);
-			break;
-		}
+		CreateTextureHDRI(pDevice, fileName);
+		FinalizeTexture(pDevice);
 
-		case TextureType::TEXTURE_HDRI:
-		{
-			CreateTextureHDRI(pDevice, fileName);
-			m_vkTextureImageView = Vulkan::CreateImageView(	pDevice, m_vkTextureImage,
-																	VK_FORMAT_R32G32B32A32_SFLOAT,
-																	VK_IMAGE_ASPECT_COLOR_BIT);
-			break;
-		}
+		LOG_DEBUG("Created Vulkan Texture for {0}", fileName);
+		return;
 	}
-	
-	// Create Sampler
-	CreateTextureSampler(pDevice);
 
-	LOG_DEBUG("Created Vulkan Texture for {0}", fileName);
-}
+	std::vector<TextureLoadRequest> vecRequests(1);
+	vecRequests[0].pTexture = this;
+	vecRequests[0].fileName = fileName;
+	vecRequests[0].eType = eType;
+	vecRequests[0].eMipGeneration = eMipGeneration;
 
+	VulkanTextureLoader::getInstance().LoadBatch(pDevice, vecRequests);
+}
 //---------------------------------------------------------------------------------------------------------------------
 void VulkanTexture2D::Cleanup(VulkanDevice* pDevice)
 {
-	vkDestroySampler(pDevice->m_vkLogicalDevice, m_vkTextureSampler, nullptr);
+	// The copies into the image may still be in flight
+	pDevice->m_pUploader->Wait(m_uiUploadToken);
+	m_uiUploadToken = UPLOAD_TOKEN_NONE;
+
+	VulkanSamplerCache::getInstance().Release(pDevice, m_vkTextureSampler);
+	m_vkTextureSampler = VK_NULL_HANDLE;
+
+	m_StreamSource = TextureUploadData();
+
+	if (m_vkEnvironmentAliasBuffer != VK_NULL_HANDLE)
+	{
+		pDevice->DestroyBuffer(m_vkEnvironmentAliasBuffer, m_pEnvironmentAliasAllocation);
+		m_vkEnvironmentAliasBuffer = VK_NULL_HANDLE;
+		m_pEnvironmentAliasAllocation = nullptr;
+	}
 
 	vkDestroyImageView(pDevice->m_vkLogicalDevice, m_vkTextureImageView, nullptr);
 	vkDestroyImage(pDevice->m_vkLogicalDevice, m_vkTextureImage, nullptr);
@@ -111,124 +120,502 @@ unsigned char* VulkanTexture2D::LoadTextureFile(VulkanDevice* pDevice, std::stri
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-float* VulkanTexture2D::LoadHDRI(VulkanDevice* pDevice, std::string fileName)
+//--- Shared exponent where the device can filter it (4 bytes per texel), half floats otherwise (8, always supported).
+//--- HDRIs have no alpha & no negative values, so neither loses anything RGBE stored.
+bool VulkanTexture2D::LoadHDRI(VulkanDevice* pDevice, std::string fileName, Texture::HDRImage& outImage)
 {
-	// Number of channels in image
-	int channels = 0;
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(pDevice->m_vkPhysicalDevice, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, &formatProperties);
 
-	std::string fileLoc = "Assets/Textures/HDRI/" + fileName;
+	const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	const bool bSharedExponent = (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
 
-	// Load pixel data for an image
-	stbi_set_flip_vertically_on_load(1);
-	float* imageData = stbi_loadf(fileLoc.c_str(), &m_iTextureWidth, &m_iTextureHeight, &m_iTextureChannels, 4);
-	if (!imageData)
+	const Texture::TextureFormat eFormat = bSharedExponent ? Texture::TextureFormat::E5B9G9R9 : Texture::TextureFormat::RGBA16F;
+	m_vkTextureFormat = bSharedExponent ? VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 : VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	Texture::HDRLoadReport report;
+	const bool bLoaded = Texture::LoadHDRImage("Assets/Textures/HDRI/" + fileName, eFormat, outImage, &report);
+	if (!bLoaded)
 	{
-		LOG_ERROR(("Failed to load a Texture file! (" + fileName + ")").c_str());
+		// Magenta like the LDR fallback
+		const float magenta[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
+		outImage.eFormat = eFormat;
+		outImage.width = 1;
+		outImage.height = 1;
+		outImage.vecData.resize(Texture::ComputeLevelByteSize(eFormat, 1, 1));
+		Texture::ConvertHDRTexels(magenta, 1, eFormat, outImage.vecData.data());
+	}
+	else
+	{
+		LOG_DEBUG("Loaded HDRI {0} as {1} in {2:.1f} ms ({3})", fileName, Texture::GetTextureFormatName(eFormat), report.loadMs,
+				  report.bFromCache ? "cache" : (report.bParallel ? "parallel decode" : "stb_image"));
 	}
-	stbi_set_flip_vertically_on_load(0);
 
-	// Calculate image size using given data
-	m_vkTextureDeviceSize = m_iTextureWidth * m_iTextureHeight * 4 * sizeof(float);
+	m_iTextureWidth = static_cast<int>(outImage.width);
+	m_iTextureHeight = static_cast<int>(outImage.height);
+	m_iTextureChannels = 4;
+	m_vkTextureDeviceSize = outImage.vecData.size();
 
-	return imageData;
+	return bLoaded;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTexture2D::CreateTextureImage(VulkanDevice* pDevice, std::string fileName)
+bool TextureUploadData::CopyTo(uint8_t* pDst, uint32_t firstMip) const
 {
-	stbi_uc* imageData = LoadTextureFile(pDevice, fileName);
+	if (!containerPath.empty())
+	{
+		Texture::ContainerInfo levels = containerInfo;
+		levels.vecLevels.erase(levels.vecLevels.begin(), levels.vecLevels.begin() + firstMip);
 
-	// Create staging buffer to hold loaded data, ready to copy to device
-	VkBuffer imageStagingBuffer;
-	VkDeviceMemory imageStagingBufferMemory;
+		std::vector<uint64_t> vecOffsets;
+		return Texture::ReadContainerLevels(containerPath, levels, pDst, vecOffsets);
+	}
 
-	// create staging buffer to hold the loaded data, ready to copy to device!
-	pDevice->CreateBuffer(m_vkTextureDeviceSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageStagingBuffer,
-		&imageStagingBufferMemory);
+	const size_t offset = static_cast<size_t>(vecLevelOffsets[firstMip]);
+	memcpy(pDst, vecData.data() + offset, vecData.size() - offset);
+	return true;
+}
 
-	// copy image data to staging buffer
-	void* data;
-	vkMapMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory, 0, m_vkTextureDeviceSize, 0, &data);
-	memcpy(data, imageData, static_cast<uint32_t>(m_vkTextureDeviceSize));
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory);
+//---------------------------------------------------------------------------------------------------------------------
+//--- CPU half of a load. Offline compiled containers are already block compressed & mipped, only their headers get read
+//--- here & the levels go straight to staging later. Otherwise decode the source & build the mip chain if the GPU can't.
+bool VulkanTexture2D::LoadTextureData(VulkanDevice* pDevice, std::string fileName, TextureType eType, MipGeneration eMipGeneration,
+									  TextureUploadData& outData)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
 
-	// Free original image data
-	stbi_image_free(imageData);
+	m_eTextureType = eType;
+	m_eMipGeneration = eMipGeneration;
+
+	m_bCompiled = LoadCompiledData(pDevice, fileName, outData);
+	const bool bValid = m_bCompiled || LoadSourceData(pDevice, fileName, outData);
+
+	// Keep descriptors valid with a 1x1 magenta texture when the file is missing or broken
+	if (!bValid)
+	{
+		outData = TextureUploadData();
+		outData.vecData = { 255, 0, 255, 255 };
+		outData.vecLevelOffsets = { 0 };
+		outData.byteSize = 4;
+
+		m_vkImageByteSize = 4;
+		m_vecLevelByteSizes = { 4 };
+	}
+
+	m_iTextureWidth = outData.width;
+	m_iTextureHeight = outData.height;
+	m_uiMipLevels = outData.mipLevels;
+	m_vkTextureFormat = outData.format;
+	m_vkTextureDeviceSize = outData.byteSize;
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	outData.decodeMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+	return bValid;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTexture2D::LoadSourceData(VulkanDevice* pDevice, std::string fileName, TextureUploadData& outData)
+{
+	stbi_uc* imageData = LoadTextureFile(pDevice, fileName);
+	if (!imageData)
+		return false;
 
 	// Treat only Albedo as sRGB texture!
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	Texture::MipSettings mipSettings;
+
 	switch (m_eTextureType)
 	{
 		case TextureType::TEXTURE_ALBEDO:
 		{
-			m_vkTextureImage = Vulkan::CreateImage(	pDevice, m_iTextureWidth, m_iTextureHeight,
-															VK_FORMAT_R8G8B8A8_SRGB,
-															VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-															VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkTextureImageMemory);
+			format = VK_FORMAT_R8G8B8A8_SRGB;
+			mipSettings.eColorSpace = Texture::MipColorSpace::SRGB;
 			break;
 		}
 
 		case TextureType::TEXTURE_NORMAL:
-		case TextureType::TEXTURE_AO:
-		case TextureType::TEXTURE_EMISSIVE:
-		case TextureType::TEXTURE_METALNESS:
-		case TextureType::TEXTURE_ROUGHNESS:
-		case TextureType::TEXTURE_ERROR:
 		{
-			m_vkTextureImage = Vulkan::CreateImage(	pDevice, m_iTextureWidth, m_iTextureHeight,
-															VK_FORMAT_R8G8B8A8_UNORM, 
-															VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
-															VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkTextureImageMemory);
+			mipSettings.eColorSpace = Texture::MipColorSpace::NORMAL;
 			break;
 		}
+
+		default:
+			break;
 	}
 
-	// Transition image to be DST for copy operation
+	outData.format = format;
+	outData.width = m_iTextureWidth;
+	outData.height = m_iTextureHeight;
+	outData.mipLevels = Texture::ComputeMipCount(m_iTextureWidth, m_iTextureHeight);
+
+	// Blits filter without renormalizing, so normal maps always take the CPU path
+	outData.bBlitMips = m_eMipGeneration == MipGeneration::GPU_BLIT &&
+						m_eTextureType != TextureType::TEXTURE_NORMAL &&
+						SupportsLinearBlit(pDevice, format);
+
+	// Staging holds only level 0 for blits, the whole chain back to back otherwise
+	if (outData.bBlitMips)
+	{
+		outData.vecData.assign(imageData, imageData + m_vkTextureDeviceSize);
+		outData.vecLevelOffsets = { 0 };
+	}
+	else
+	{
+		std::vector<Texture::MipLevel> vecLevels;
+		mipSettings.eFilter = m_eMipGeneration == MipGeneration::CPU_KAISER ? Texture::MipFilter::KAISER : Texture::MipFilter::BOX;
+		Texture::GenerateMipChain(imageData, m_iTextureWidth, m_iTextureHeight, mipSettings, vecLevels);
+
+		size_t totalSize = 0;
+		for (const Texture::MipLevel& level : vecLevels)
+			totalSize += level.vecData.size();
+
+		outData.vecData.resize(totalSize);
+		outData.vecLevelOffsets.clear();
+
+		size_t offset = 0;
+		for (const Texture::MipLevel& level : vecLevels)
+		{
+			outData.vecLevelOffsets.push_back(offset);
+			memcpy(outData.vecData.data() + offset, level.vecData.data(), level.vecData.size());
+			offset += level.vecData.size();
+		}
+	}
+
+	outData.byteSize = outData.vecData.size();
+
+	// Free original image data
+	stbi_image_free(imageData);
+
+	m_vkImageByteSize = 0;
+	m_vecLevelByteSizes.clear();
+	for (uint32_t i = 0; i < outData.mipLevels; ++i)
+	{
+		m_vecLevelByteSizes.push_back(static_cast<uint64_t>(std::max(1, m_iTextureWidth >> i)) * std::max(1, m_iTextureHeight >> i) * 4);
+		m_vkImageByteSize += m_vecLevelByteSizes.back();
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Assets/Textures/Compiled/<name>.ktx2 (or .dds). Returns false when there's no usable compiled file, the caller then
+//--- loads the source image.
+bool VulkanTexture2D::LoadCompiledData(VulkanDevice* pDevice, std::string fileName, TextureUploadData& outData)
+{
+	const std::string sourcePath = "Assets/Textures/" + fileName;
+
+	std::string compiledPath = Texture::GetCompiledTexturePath(fileName, Texture::ContainerType::KTX2);
+	if (!std::filesystem::exists(compiledPath))
+		compiledPath = Texture::GetCompiledTexturePath(fileName, Texture::ContainerType::DDS);
+
+	if (!std::filesystem::exists(compiledPath))
+		return false;
+
+	// Source edited after compiling, don't show stale data
+	if (std::filesystem::exists(sourcePath) && std::filesystem::last_write_time(sourcePath) > std::filesystem::last_write_time(compiledPath))
+	{
+		LOG_WARNING("{0} is older than its source, loading the source instead", compiledPath);
+		return false;
+	}
+
+	Texture::ContainerInfo info;
+	if (!Texture::ReadContainerInfo(compiledPath, info) || info.faceCount != 1)
+		return false;
+
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	switch (info.eFormat)
+	{
+		case Texture::TextureFormat::BC1:	format = info.bSRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;	break;
+		case Texture::TextureFormat::BC4:	format = VK_FORMAT_BC4_UNORM_BLOCK;													break;
+		case Texture::TextureFormat::BC5:	format = VK_FORMAT_BC5_UNORM_BLOCK;													break;
+		case Texture::TextureFormat::BC7:	format = info.bSRGB ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;			break;
+		case Texture::TextureFormat::BC6H:	format = VK_FORMAT_BC6H_UFLOAT_BLOCK;												break;
+		case Texture::TextureFormat::RGBA16F:	format = VK_FORMAT_R16G16B16A16_SFLOAT;										break;
+		case Texture::TextureFormat::RGBA32F:	format = VK_FORMAT_R32G32B32A32_SFLOAT;										break;
+		case Texture::TextureFormat::E5B9G9R9:	format = VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;									break;
+		default:							format = info.bSRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;			break;
+	}
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(pDevice->m_vkPhysicalDevice, format, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+	{
+		LOG_WARNING("Device can't sample {0} textures, loading the source of {1} instead", Texture::GetTextureFormatName(info.eFormat), fileName);
+		return false;
+	}
+
+	outData.format = format;
+	outData.width = info.width;
+	outData.height = info.height;
+	outData.mipLevels = static_cast<uint32_t>(info.vecLevels.size());
+	outData.byteSize = info.GetTotalByteSize();
+	outData.containerPath = compiledPath;
+	outData.containerInfo = info;
+
+	// Levels get read back to back in level order
+	VkDeviceSize offset = 0;
+	m_vecLevelByteSizes.clear();
+	for (const Texture::ContainerLevel& level : info.vecLevels)
+	{
+		outData.vecLevelOffsets.push_back(offset);
+		m_vecLevelByteSizes.push_back(level.byteSize);
+		offset += level.byteSize;
+	}
+
+	m_vkImageByteSize = outData.byteSize;
+
+	LOG_DEBUG("Using compiled {0} ({1}, {2} levels, {3} KB)", compiledPath, Texture::GetTextureFormatName(info.eFormat), outData.mipLevels,
+			  outData.byteSize / 1024);
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTexture2D::CreateImageResources(VulkanDevice* pDevice, const TextureUploadData& data)
+{
+	const VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+										 (data.bBlitMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+
+	m_vkTextureImage = Vulkan::CreateImage(	pDevice, data.width, data.height, data.format,
+											VK_IMAGE_TILING_OPTIMAL, usageFlags,
+											VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkTextureImageMemory, data.mipLevels);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Records the whole upload, data must already sit in stagingBuffer at stagingOffset. Ends with every level
+//--- SHADER_READ_ONLY & owned by graphics, blits need a graphics queue so they go after the hand over.
+void VulkanTexture2D::RecordUpload(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, const TextureUploadData& data, VkBuffer stagingBuffer,
+								   VkDeviceSize stagingOffset)
+{
+	VkImageSubresourceRange subResRange = {};
+	subResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subResRange.baseMipLevel = 0;
+	subResRange.levelCount = data.mipLevels;
+	subResRange.baseArrayLayer = 0;
+	subResRange.layerCount = 1;
+
+	// Transition every level to be DST for copy operation
 	Vulkan::TransitionImageLayout(	pDevice,
-											m_vkTextureImage,
-											VK_IMAGE_LAYOUT_UNDEFINED,
-											VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+									commandBuffer,
+									m_vkTextureImage,
+									VK_IMAGE_LAYOUT_UNDEFINED,
+									VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+									subResRange);
 
 	// COPY DATA TO IMAGE
-	Vulkan::CopyImageBuffer(pDevice, imageStagingBuffer, m_vkTextureImage, m_iTextureWidth, m_iTextureHeight);
+	std::vector<VkDeviceSize> vecLevelOffsets(data.vecLevelOffsets);
+	for (VkDeviceSize& offset : vecLevelOffsets)
+		offset += stagingOffset;
 
-	// Transition image to be shader readable for shader usage
-	Vulkan::TransitionImageLayout(pDevice,
-		m_vkTextureImage,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	Vulkan::CopyImageBufferMips(commandBuffer, stagingBuffer, m_vkTextureImage, data.width, data.height, vecLevelOffsets);
 
-	// Destroy staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, imageStagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory, nullptr);
+	// Transition image to be shader readable for shader usage, the blit chain does that level by level
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	if (data.bBlitMips)
+	{
+		pUploader->EndImageUpload(m_vkTextureImage, subResRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		Vulkan::GenerateMipmapsBlit(pUploader->GetGraphicsCommandBuffer(), m_vkTextureImage, data.width, data.height, data.mipLevels);
+	}
+	else
+	{
+		pUploader->EndImageUpload(m_vkTextureImage, subResRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTexture2D::CreateTextureHDRI(VulkanDevice* pDevice, std::string fileName)
+void VulkanTexture2D::FinalizeTexture(VulkanDevice* pDevice)
 {
-	float* imageData = LoadHDRI(pDevice, fileName);
-	
-	// Create staging buffer to hold loaded data, ready to copy to device
-	VkBuffer		imageStagingBuffer;
-	VkDeviceMemory	imageStagingBufferMemory;
-	
-	// create staging buffer to hold the loaded data, ready to copy to device!
-	pDevice->CreateBuffer(	m_vkTextureDeviceSize,
-							VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-							VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-							&imageStagingBuffer,
-							&imageStagingBufferMemory);
+	m_vkTextureImageView = Vulkan::CreateImageView(	pDevice, m_vkTextureImage,
+													m_vkTextureFormat,
+													VK_IMAGE_ASPECT_COLOR_BIT, m_uiMipLevels);
+
+	// Create Sampler
+	CreateTextureSampler(pDevice);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTexture2D::SetStreamSource(TextureUploadData&& data)
+{
+	// Blits only kept level 0 & a single level has nothing to stream
+	if (data.bBlitMips || data.mipLevels < 2 || data.vecLevelOffsets.size() != data.mipLevels)
+	{
+		m_StreamSource = TextureUploadData();
+		return;
+	}
+
+	m_StreamSource = std::move(data);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Coarser levels go up again with the new finest one instead of being copied over from the old image. A third more
+//--- upload, but no transitions on an image earlier frames may still be sampling. Recorded into the uploader's open
+//--- batch, the caller submits it.
+bool VulkanTexture2D::SetResidentMip(VulkanDevice* pDevice, uint32_t residentMip, RetiredTextureImage& outRetired)
+{
+	residentMip = std::min(residentMip, m_uiMipLevels - 1);
+	if (!IsStreamable() || residentMip == m_uiResidentMip)
+		return false;
+
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	const StagingAllocation staging = pUploader->Stage(m_StreamSource.GetByteSize(residentMip), 16);
+	if (staging.pData == nullptr || !m_StreamSource.CopyTo(staging.pData, residentMip))
+	{
+		LOG_ERROR("Failed to stage mip {0} & coarser of a streamed texture", residentMip);
+		return false;
+	}
+
+	const uint32_t levelCount = m_uiMipLevels - residentMip;
+	const uint32_t width = std::max(1u, GetWidth() >> residentMip);
+	const uint32_t height = std::max(1u, GetHeight() >> residentMip);
+
+	VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+	VkImage image = Vulkan::CreateImage(pDevice, width, height, m_vkTextureFormat,
+										VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+										VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &imageMemory, levelCount);
+
+	VkImageSubresourceRange subResRange = {};
+	subResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subResRange.baseMipLevel = 0;
+	subResRange.levelCount = levelCount;
+	subResRange.baseArrayLayer = 0;
+	subResRange.layerCount = 1;
+
+	VkCommandBuffer commandBuffer = pUploader->GetCommandBuffer();
+	Vulkan::TransitionImageLayout(pDevice, commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subResRange);
+
+	// Source offsets of the kept levels, relative to the new finest one
+	std::vector<VkDeviceSize> vecLevelOffsets(m_StreamSource.vecLevelOffsets.begin() + residentMip, m_StreamSource.vecLevelOffsets.end());
+	const VkDeviceSize firstOffset = vecLevelOffsets[0];
+	for (VkDeviceSize& offset : vecLevelOffsets)
+		offset = offset - firstOffset + staging.offset;
+
+	Vulkan::CopyImageBufferMips(commandBuffer, staging.buffer, image, width, height, vecLevelOffsets);
+	pUploader->EndImageUpload(image, subResRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	outRetired.image = m_vkTextureImage;
+	outRetired.view = m_vkTextureImageView;
+	outRetired.memory = m_vkTextureImageMemory;
+	outRetired.uploadToken = m_uiUploadToken;
+
+	m_vkTextureImage = image;
+	m_vkTextureImageMemory = imageMemory;
+	m_vkTextureImageView = Vulkan::CreateImageView(pDevice, image, m_vkTextureFormat, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
+	m_uiResidentMip = residentMip;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTexture2D::DestroyRetiredImage(VulkanDevice* pDevice, const RetiredTextureImage& retired)
+{
+	pDevice->m_pUploader->Wait(retired.uploadToken);
+
+	vkDestroyImageView(pDevice->m_vkLogicalDevice, retired.view, nullptr);
+	vkDestroyImage(pDevice->m_vkLogicalDevice, retired.image, nullptr);
+	vkFreeMemory(pDevice->m_vkLogicalDevice, retired.memory, nullptr);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t VulkanTexture2D::GetResidentByteSize() const
+{
+	uint64_t bytes = 0;
+	for (uint32_t i = m_uiResidentMip; i < m_vecLevelByteSizes.size(); ++i)
+		bytes += m_vecLevelByteSizes[i];
+
+	return bytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTexture2D::SupportsLinearBlit(VulkanDevice* pDevice, VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(pDevice->m_vkPhysicalDevice, format, &formatProperties);
+
+	const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+												  VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+	if ((formatProperties.optimalTilingFeatures & requiredFeatures) != requiredFeatures)
+	{
+		LOG_DEBUG("Format {0} doesn't support linear blits, generating mips on the CPU", static_cast<uint32_t>(format));
+		return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTexture2D::CreateEnvironmentMap(VulkanDevice* pDevice, std::string fileName)
+{
+	m_eTextureType = TextureType::TEXTURE_HDRI;
+
+	CreateTextureHDRI(pDevice, fileName, true);
+	FinalizeTexture(pDevice);
+
+	LOG_DEBUG("Created Vulkan environment map for {0}", fileName);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Built from the texels as uploaded (shared exponent or half), so the pdfs describe exactly what envMap returns
+void VulkanTexture2D::CreateEnvironmentAliasBuffer(VulkanDevice* pDevice, const Texture::HDRImage& image)
+{
+	const size_t texelCount = static_cast<size_t>(image.width) * image.height;
+
+	std::vector<float> vecRGBA(texelCount * 4);
+	Texture::DecodeHDRTexels(image.vecData.data(), texelCount, image.eFormat, vecRGBA.data());
+
+	Texture::EnvironmentSampling sampling;
+	Texture::EnvironmentSamplingReport report;
+	Texture::BuildEnvironmentSampling(vecRGBA.data(), image.width, image.height, sampling, &report);
+
+	std::vector<Texture::EnvironmentAliasGPU> vecAlias;
+	Texture::PackEnvironmentAliasGPU(sampling, vecAlias);
+
+	m_vkEnvironmentAliasSize = vecAlias.size() * sizeof(Texture::EnvironmentAliasGPU);
+
+	// Recorded into the open batch, goes up with the image at the Submit in CreateTextureHDRI
+	pDevice->CreateBuffer(m_vkEnvironmentAliasSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+						  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkEnvironmentAliasBuffer, &m_pEnvironmentAliasAllocation, "ENVIRONMENT_ALIAS");
+
+	if (m_pEnvironmentAliasAllocation == nullptr)
+	{
+		LOG_ERROR("No memory for the environment alias table!");
+		return;
+	}
+
+	pDevice->m_pUploader->UploadBuffer(m_vkEnvironmentAliasBuffer, 0, vecAlias.data(), m_vkEnvironmentAliasSize);
+
+	LOG_DEBUG("Environment alias table {0}x{1}: CDF {2:.2f} ms, alias {3:.2f} ms, {4} threads", image.width, image.height,
+			  report.cdfMs, report.aliasMs, report.threadCount);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTexture2D::CreateTextureHDRI(VulkanDevice* pDevice, std::string fileName, bool bEnvironmentSampling)
+{
+	Texture::HDRImage image;
+	LoadHDRI(pDevice, fileName, image);
+
+	if (bEnvironmentSampling)
+		CreateEnvironmentAliasBuffer(pDevice, image);
+
+	// Equirect sky is looked up along view directions, single level is enough
+	m_uiMipLevels = 1;
+	m_vkImageByteSize = m_vkTextureDeviceSize;
+	m_vecLevelByteSizes = { m_vkTextureDeviceSize };
 	
-	// copy image data to staging buffer
-	void* data;
-	vkMapMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory, 0, m_vkTextureDeviceSize, 0, &data);
-	memcpy(data, imageData, static_cast<uint32_t>(m_vkTextureDeviceSize));
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory);
+	// Staged in the uploader's ring, 8k maps get a staging buffer of their own for the batch
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	const StagingAllocation staging = pUploader->Stage(m_vkTextureDeviceSize, 16);
+	if (staging.pData == nullptr)
+	{
+		LOG_ERROR("No staging memory for {0}!", fileName);
+		return;
+	}
+
+	memcpy(staging.pData, image.vecData.data(), static_cast<size_t>(m_vkTextureDeviceSize));
 	
 	// Free original image data
-	stbi_image_free(imageData);
+	image.vecData = std::vector<uint8_t>();
 
 	//VkImageFormatProperties imgProps = {};
 	//VkImageCreateFlags imgFlags = {};
@@ -247,28 +634,33 @@ void VulkanTexture2D::CreateTextureHDRI(VulkanDevice* pDevice, std::string fileN
 	//}
 
 	m_vkTextureImage = Vulkan::CreateImage(	pDevice, m_iTextureWidth, m_iTextureHeight,
-													VK_FORMAT_R32G32B32A32_SFLOAT,
+													m_vkTextureFormat,
 													VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT |									 VK_IMAGE_USAGE_SAMPLED_BIT,
 													VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkTextureImageMemory);
 		
+	VkCommandBuffer commandBuffer = pUploader->GetCommandBuffer();
+
 	// Transition image to be DST for copy operation
 	Vulkan::TransitionImageLayout(	pDevice,
-											m_vkTextureImage,
-											VK_IMAGE_LAYOUT_UNDEFINED,
-											VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+									commandBuffer,
+									m_vkTextureImage,
+									VK_IMAGE_LAYOUT_UNDEFINED,
+									VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 	
 	// COPY DATA TO IMAGE
-	Vulkan::CopyImageBuffer(pDevice, imageStagingBuffer, m_vkTextureImage, m_iTextureWidth, m_iTextureHeight);
+	Vulkan::CopyImageBufferMips(commandBuffer, staging.buffer, m_vkTextureImage, m_iTextureWidth, m_iTextureHeight, { staging.offset });
 	
-	// Transition image to be shader readable for shader usage
-	Vulkan::TransitionImageLayout(pDevice,
-										  m_vkTextureImage,
-										  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-										  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	
-	// Destroy staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, imageStagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory, nullptr);
+	// Transition image to be shader readable for shader usage, graphics takes it over from the transfer queue
+	VkImageSubresourceRange subResRange = {};
+	subResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subResRange.baseMipLevel = 0;
+	subResRange.levelCount = 1;
+	subResRange.baseArrayLayer = 0;
+	subResRange.layerCount = 1;
+
+	pUploader->EndImageUpload(m_vkTextureImage, subResRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	m_uiUploadToken = pUploader->Submit();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -287,14 +679,11 @@ void VulkanTexture2D::CreateTextureSampler(VulkanDevice* pDevice)
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;				// Mipmap interpolation mode
 	samplerCreateInfo.mipLodBias = 0.0f;										// Level of detail bias for mip level
 	samplerCreateInfo.minLod = 0.0f;											// minimum level of detail to pick mip level
-	samplerCreateInfo.maxLod = 0.0f;											// maximum level of detail to pick mip level
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;								// the view limits the levels, so textures with any mip count share the sampler
 	samplerCreateInfo.anisotropyEnable = VK_FALSE;								// Enable Anisotropy or not? Check physical device features to see if anisotropy is supported or not!
 	samplerCreateInfo.maxAnisotropy = 16;										// Anisotropy sample level
 
-	if (vkCreateSampler(pDevice->m_vkLogicalDevice, &samplerCreateInfo, nullptr, &m_vkTextureSampler) != VK_SUCCESS)
-	{
-		LOG_ERROR("Failed to create Texture sampler!");
-	}
+	m_vkTextureSampler = VulkanSamplerCache::getInstance().Acquire(pDevice, samplerCreateInfo);
 }
 
 
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "vulkan/vulkan.h"
+#include "Engine/Texture/TextureContainer.h"
+#include "Engine/Renderer/VulkanStagingUploader.h"
 
 class VulkanDevice;
+struct VulkanAllocation;
+
+namespace Texture
+{
+	struct HDRImage;
+}
 
 enum class TextureType
 {
@@ -12,32 +20,117 @@ enum class TextureType
 	TEXTURE_ROUGHNESS,
 	TEXTURE_AO,
 	TEXTURE_EMISSIVE,
+	TEXTURE_ORM,			// R-Occlusion, G-Roughness, B-Metalness, see Texture::ImportORMTexture
 	TEXTURE_HDRI,
 	TEXTURE_ERROR
 };
 
+enum class MipGeneration
+{
+	GPU_BLIT,				// vkCmdBlitImage chain, normal maps & formats without linear blits fall back to CPU_BOX
+	CPU_BOX,				// Texture::GenerateMipChain, sRGB correct & renormalized normals
+	CPU_KAISER
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Everything the GPU half of a load needs, filled on a worker thread by VulkanTexture2D::LoadTextureData
+struct TextureUploadData
+{
+	VkFormat							format = VK_FORMAT_R8G8B8A8_UNORM;
+	uint32_t							width = 1;
+	uint32_t							height = 1;
+	uint32_t							mipLevels = 1;
+	std::vector<uint8_t>				vecData;					// Levels back to back, only level 0 when bBlitMips
+	std::vector<VkDeviceSize>			vecLevelOffsets;			// Relative to the start of the upload
+	VkDeviceSize						byteSize = 0;				// Bytes the upload takes in staging
+	bool								bBlitMips = false;
+	float								decodeMs = 0.0f;
+
+	// Compiled containers aren't read into vecData, CopyTo streams their levels straight into staging
+	std::string							containerPath;
+	Texture::ContainerInfo				containerInfo;
+
+	// Levels firstMip & coarser, back to back
+	bool								CopyTo(uint8_t* pDst, uint32_t firstMip = 0) const;
+	inline VkDeviceSize					GetByteSize(uint32_t firstMip) const { return byteSize - vecLevelOffsets[firstMip]; }
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Image of a texture swapped out by streaming, frames in flight may still sample it
+struct RetiredTextureImage
+{
+	VkImage								image = VK_NULL_HANDLE;
+	VkImageView							view = VK_NULL_HANDLE;
+	VkDeviceMemory						memory = VK_NULL_HANDLE;
+	UploadToken							uploadToken = UPLOAD_TOKEN_NONE;	// Last upload into it
+};
+
+//---------------------------------------------------------------------------------------------------------------------
 class VulkanTexture2D
 {
 public:
 	VulkanTexture2D();
 	~VulkanTexture2D();
 
-	void								CreateTexture(VulkanDevice* pDevice, std::string fileName, TextureType eType);
-	void								CreateTextureHDRI(VulkanDevice* pDevice, std::string fileName);
+	void								CreateTexture(VulkanDevice* pDevice, std::string fileName, TextureType eType,
+													  MipGeneration eMipGeneration = MipGeneration::GPU_BLIT);
+	void								CreateTextureHDRI(VulkanDevice* pDevice, std::string fileName, bool bEnvironmentSampling = false);
+
+	// HDRI plus its luminance alias table in m_vkEnvironmentAliasBuffer, both up in one uploader batch
+	void								CreateEnvironmentMap(VulkanDevice* pDevice, std::string fileName);
 	void								Cleanup(VulkanDevice* pDevice);
 	void								CleanupOnWindowResize(VulkanDevice* pDevice);
 
+	// Split load used by VulkanTextureLoader. LoadTextureData is CPU only & safe to run for different textures in
+	// parallel, the rest must run on the thread owning the device. Returns false (& a 1x1 fallback) for missing files.
+	bool								LoadTextureData(VulkanDevice* pDevice, std::string fileName, TextureType eType,
+														MipGeneration eMipGeneration, TextureUploadData& outData);
+	void								CreateImageResources(VulkanDevice* pDevice, const TextureUploadData& data);
+	void								RecordUpload(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, const TextureUploadData& data,
+													 VkBuffer stagingBuffer, VkDeviceSize stagingOffset);
+	void								FinalizeTexture(VulkanDevice* pDevice);
+
+	// Streaming. Keeps the levels of a load (CPU mips or the compiled container) so they can go up again, textures with
+	// blit generated mips don't have their finer levels anywhere & stay whole.
+	void								SetStreamSource(TextureUploadData&& data);
+	inline bool							IsStreamable() const { return !m_StreamSource.vecLevelOffsets.empty(); }
+
+	// Swaps the image for one holding levels residentMip & coarser, all uploaded again from the stream source. Returns
+	// false when nothing changed, otherwise outRetired holds the previous image for the caller to destroy once no frame
+	// in flight samples it.
+	bool								SetResidentMip(VulkanDevice* pDevice, uint32_t residentMip, RetiredTextureImage& outRetired);
+	static void							DestroyRetiredImage(VulkanDevice* pDevice, const RetiredTextureImage& retired);
+	uint64_t							GetResidentByteSize() const;
+
+	inline uint32_t						GetWidth() const { return static_cast<uint32_t>(m_iTextureWidth); }
+	inline uint32_t						GetHeight() const { return static_cast<uint32_t>(m_iTextureHeight); }
+
 public:
 	VkImage								m_vkTextureImage;
 	VkImageView							m_vkTextureImageView;
 	VkImageLayout						m_vkTextureImageLayout;
 	VkDeviceMemory						m_vkTextureImageMemory;
 	VkSampler							m_vkTextureSampler;
+	uint32_t							m_uiMipLevels;
+	VkFormat							m_vkTextureFormat;
+	VkDeviceSize						m_vkImageByteSize;			// Every mip level, as stored in the upload
+	std::vector<uint64_t>				m_vecLevelByteSizes;		// Each level of m_vkImageByteSize, level 0 first
+	bool								m_bCompiled;				// Loaded from an offline block compressed container
+	uint32_t							m_uiResidentMip;			// Finest level in m_vkTextureImage, level 0 of its view
+	UploadToken							m_uiUploadToken;			// Image data is in place once it completes, Cleanup waits on it
+
+	// Environment maps only, one Texture::EnvironmentAliasGPU per texel as envSampling.glsl reads it
+	VkBuffer							m_vkEnvironmentAliasBuffer;
+	VulkanAllocation*					m_pEnvironmentAliasAllocation;
+	VkDeviceSize						m_vkEnvironmentAliasSize;
 
 private:
 	unsigned char*						LoadTextureFile(VulkanDevice* pDevice, std::string fileName);
-	float*								LoadHDRI(VulkanDevice* pDevice, std::string fileName);
-	void								CreateTextureImage(VulkanDevice* pDevice, std::string fileName);
+	bool								LoadHDRI(VulkanDevice* pDevice, std::string fileName, Texture::HDRImage& outImage);
+	void								CreateEnvironmentAliasBuffer(VulkanDevice* pDevice, const Texture::HDRImage& image);
+	bool								LoadSourceData(VulkanDevice* pDevice, std::string fileName, TextureUploadData& outData);
+	bool								LoadCompiledData(VulkanDevice* pDevice, std::string fileName, TextureUploadData& outData);
+	bool								SupportsLinearBlit(VulkanDevice* pDevice, VkFormat format);
 	void								CreateTextureSampler(VulkanDevice* pDevice);
 
 	int									m_iTextureWidth;
@@ -46,5 +139,8 @@ private:
 	VkDeviceSize						m_vkTextureDeviceSize;
 
 	TextureType							m_eTextureType;
+	MipGeneration						m_eMipGeneration;
+
+	TextureUploadData					m_StreamSource;				// vecLevelOffsets empty when not streamable
 };
 
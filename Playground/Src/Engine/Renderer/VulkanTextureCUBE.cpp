@@ -1,12 +1,20 @@
 #include "PlaygroundPCH.h"
 #include "VulkanTextureCUBE.h"
 #include "VulkanTexture2D.h"
+#include "VulkanTextureLoader.h"
+#include "VulkanSamplerCache.h"
+#include "VulkanComputeIBL.h"
 #include "Engine/Renderer/VulkanDevice.h"
 #include "Engine/Renderer/VulkanSwapChain.h"
 #include "Engine/Renderer/VulkanGraphicsPipeline.h"
 #include "Engine/RenderObjects/DummySkybox.h"
 #include "Engine/Helpers/Utility.h"
 #include "Engine/Helpers/Log.h"
+#include "Engine/Texture/MipGenerator.h"
+#include "Engine/Texture/HDRConverter.h"
+#include "Engine/Texture/TextureContainer.h"
+
+#include <chrono>
 
 #include "stb_image.h"
 
@@ -18,11 +26,28 @@ VulkanTextureCUBE::VulkanTextureCUBE()
 	m_vkImageMemoryCUBE				= VK_NULL_HANDLE;
 	m_vkSamplerCUBE					= VK_NULL_HANDLE;
 
+	m_IrradianceSH					= {};
+	m_IrradianceSHGPU				= {};
+	m_bIrradianceSH					= false;
+
+	m_vkImagePrefilterSpec			= VK_NULL_HANDLE;
+	m_vkImageViewPrefilterSpec		= VK_NULL_HANDLE;
+	m_vkImageMemoryPrefilterSpec	= VK_NULL_HANDLE;
+	m_vkSamplerPrefilterSpec		= VK_NULL_HANDLE;
+
+	m_vkImageBRDF					= VK_NULL_HANDLE;
+	m_vkImageViewBRDF				= VK_NULL_HANDLE;
+	m_vkImageMemoryBRDF				= VK_NULL_HANDLE;
+	m_vkSamplerBRDF					= VK_NULL_HANDLE;
+
 	m_pTextureHDRI					= nullptr;
 	m_pGraphicsPipelineHDRI2Cube	= nullptr;
-	m_pGraphicsPipelineIrradiance	= nullptr;
 	m_pGraphicsPipelinePrefilterSpec= nullptr;
+	m_pGraphicsPipelineBrdfLUT		= nullptr;
 	m_pDummySkybox					= nullptr;
+	m_uiUploadToken					= UPLOAD_TOKEN_NONE;
+
+	m_eCubeBakeTarget				= CubeBakeTarget::LAYER_VIEWS;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -30,7 +55,6 @@ VulkanTextureCUBE::~VulkanTextureCUBE()
 {
 	SAFE_DELETE(m_pTextureHDRI);
 	SAFE_DELETE(m_pGraphicsPipelineHDRI2Cube);
-	SAFE_DELETE(m_pGraphicsPipelineIrradiance);
 	SAFE_DELETE(m_pGraphicsPipelinePrefilterSpec);
 	SAFE_DELETE(m_pDummySkybox);
 }
@@ -38,18 +62,13 @@ VulkanTextureCUBE::~VulkanTextureCUBE()
 //---------------------------------------------------------------------------------------------------------------------
 void VulkanTextureCUBE::CreateTextureCUBE(VulkanDevice* pDevice, std::string fileName)
 {
-	// Create Texture image!
-	CreateTextureImage(pDevice, fileName);
-
-	// Create Image View!
-	m_vkImageViewCUBE = Vulkan::CreateImageViewCUBE(	pDevice,
-																m_vkImageCUBE,
-																VK_FORMAT_R8G8B8A8_UNORM,
-																1,
-																VK_IMAGE_ASPECT_COLOR_BIT);
+	// Faces decode in parallel & the whole cube uploads with one submit, several cubes are better off in one batch
+	CubemapLoadRequest request;
+	request.pCube = this;
+	request.directory = "Textures/Cubemaps/" + fileName;
+	request.bGenerateMips = false;
 
-	// Create Sampler!
-	m_vkSamplerCUBE = CreateTextureSampler(pDevice, 1);
+	VulkanTextureLoader::getInstance().LoadCubemapBatch(pDevice, { request });
 	
 	LOG_DEBUG("Created Vulkan Cubemap Texture for {0}", fileName);
 }
@@ -63,14 +82,15 @@ void VulkanTextureCUBE::CreateTextureCubeFromHDRI(VulkanDevice* pDevice, VulkanS
 
 	const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
 
-	//*** Create VkImage with 6 array Layers!
+	//*** Create VkImage with 6 array Layers! Color attachment for the layer views, transfer dst for the face copies.
 	m_vkImageCUBE = Vulkan::CreateImageCUBE(pDevice,
 													512,
 													512,
 													format,
 													1,
 													VK_IMAGE_TILING_OPTIMAL,
-													VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkImageMemoryCUBE);
+													VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
+													VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkImageMemoryCUBE);
 
 	// Create Image View!
 	m_vkImageViewCUBE = Vulkan::CreateImageViewCUBE(pDevice,
@@ -86,27 +106,26 @@ void VulkanTextureCUBE::CreateTextureCubeFromHDRI(VulkanDevice* pDevice, VulkanS
 	m_pDummySkybox = new DummySkybox();
 	m_pDummySkybox->Init(pDevice);
 
-	// Create RenderPass
-	VkRenderPass hdr2CubeRenderPass = CreateOffscreenRenderPass(pDevice, format);
-
-	// Create Off-screen framebuffer! 
-	std::tuple<VkImage, VkImageView, VkDeviceMemory, VkFramebuffer> tupleOffscreen = CreateOffscreenFramebuffer(pDevice, hdr2CubeRenderPass, format, 512);
+	// Create RenderPass & framebuffers, straight onto the cube's faces or onto an offscreen image
+	CubeBakeTargets targets;
+	CreateCubeBakeTargets(pDevice, m_vkImageCUBE, format, 512, 1, targets);
 
 	// Create Descriptor Set layout & Descriptor Set!
 	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> tupleDescriptor = CreateHDRI2CubeDescriptorSet(pDevice);
 
 	// Create Graphics Pipeline!
-	CreateHDRI2CubePipeline(pDevice, pSwapchain, std::get<1>(tupleDescriptor), hdr2CubeRenderPass);
+	CreateHDRI2CubePipeline(pDevice, pSwapchain, std::get<1>(tupleDescriptor), targets.renderPass);
 
 	// Render
-	RenderHDRI2CUBE(pDevice, hdr2CubeRenderPass, std::get<3>(tupleOffscreen), m_vkImageCUBE, std::get<0>(tupleOffscreen), std::get<2>(tupleDescriptor), 512);
+	const auto bakeStart = std::chrono::high_resolution_clock::now();
+
+	RenderHDRI2CUBE(pDevice, targets, m_vkImageCUBE, std::get<2>(tupleDescriptor), 512);
+
+	AddCubeBakeReport("HDRI->Cube " + fileName, targets, 512, 
+					  std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - bakeStart).count());
 
 	// Cleanup!
-	vkDestroyRenderPass(pDevice->m_vkLogicalDevice, hdr2CubeRenderPass, nullptr);
-	vkDestroyFramebuffer(pDevice->m_vkLogicalDevice, std::get<3>(tupleOffscreen), nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, std::get<2>(tupleOffscreen), nullptr);
-	vkDestroyImageView(pDevice->m_vkLogicalDevice, std::get<1>(tupleOffscreen), nullptr);
-	vkDestroyImage(pDevice->m_vkLogicalDevice, std::get<0>(tupleOffscreen), nullptr);
+	DestroyCubeBakeTargets(pDevice, targets);
 	vkDestroyDescriptorPool(pDevice->m_vkLogicalDevice, std::get<0>(tupleDescriptor), nullptr);
 	vkDestroyDescriptorSetLayout(pDevice->m_vkLogicalDevice, std::get<1>(tupleDescriptor), nullptr);
 
@@ -218,85 +237,223 @@ std::tuple<VkImage, VkImageView, VkDeviceMemory, VkFramebuffer> VulkanTextureCUB
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextureCUBE::CreateHDRI2CubeDescriptorSet(VulkanDevice* pDevice)
+VkRenderPass VulkanTextureCUBE::CreateCubeLayerRenderPass(VulkanDevice* pDevice, VkFormat format)
 {
-	VkResult result;
-	VkDescriptorPool		descPool;
-	VkDescriptorSetLayout	descSetLayout;
-	VkDescriptorSet			descSet;
+	VkRenderPass renderPass;
 
-	// *** Create Descriptor pool
-	std::array<VkDescriptorPoolSize, 1> arrDescriptorPoolSize = {};
-	arrDescriptorPoolSize[0].descriptorCount = 1;
-	arrDescriptorPoolSize[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	VkAttachmentDescription attachDesc = {};
 
-	VkDescriptorPoolCreateInfo poolCreateInfo = {};
-	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCreateInfo.poolSizeCount = arrDescriptorPoolSize.size();
-	poolCreateInfo.pPoolSizes = arrDescriptorPoolSize.data();
-	poolCreateInfo.maxSets = 2;
+	// The skybox covers every texel of the face, nothing to load. Each pass leaves its own face & level shader readable,
+	// so the cube needs no transitions of its own.
+	attachDesc.format						= format;
+	attachDesc.samples						= VK_SAMPLE_COUNT_1_BIT;
+	attachDesc.loadOp						= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachDesc.storeOp						= VK_ATTACHMENT_STORE_OP_STORE;
+	attachDesc.stencilLoadOp				= VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachDesc.stencilStoreOp				= VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachDesc.initialLayout				= VK_IMAGE_LAYOUT_UNDEFINED;
+	attachDesc.finalLayout					= VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	
+	VkAttachmentReference	colorAttachRef	= {};
+	colorAttachRef.attachment				= 0;
+	colorAttachRef.layout					= VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-	result = vkCreateDescriptorPool(pDevice->m_vkLogicalDevice, &poolCreateInfo, nullptr, &descPool);
+	VkSubpassDescription	subpassDesc		= {};
+	subpassDesc.pipelineBindPoint			= VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpassDesc.colorAttachmentCount		= 1;
+	subpassDesc.pColorAttachments			= &colorAttachRef;
+
+	// Subpass dependencies, every face & level is its own subresource so passes only wait on what samples the result
+	std::array<VkSubpassDependency, 2> dependencies;
+	dependencies[0].srcSubpass				= VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass				= 0;
+	dependencies[0].srcStageMask			= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	dependencies[0].dstStageMask			= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].srcAccessMask			= 0;
+	dependencies[0].dstAccessMask			= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dependencyFlags			= VK_DEPENDENCY_BY_REGION_BIT;
+	dependencies[1].srcSubpass				= 0;
+	dependencies[1].dstSubpass				= VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask			= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask			= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[1].srcAccessMask			= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask			= VK_ACCESS_SHADER_READ_BIT;
+	dependencies[1].dependencyFlags			= VK_DEPENDENCY_BY_REGION_BIT;
+
+	// Renderpass
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType				= VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount	= 1;
+	renderPassCreateInfo.pAttachments		= &attachDesc;
+	renderPassCreateInfo.subpassCount		= 1;
+	renderPassCreateInfo.pSubpasses			= &subpassDesc;
+	renderPassCreateInfo.dependencyCount	= 2;
+	renderPassCreateInfo.pDependencies		= dependencies.data();
+
+	VkResult result = vkCreateRenderPass(pDevice->m_vkLogicalDevice, &renderPassCreateInfo, nullptr, &renderPass);
 	if (result != VK_SUCCESS)
 	{
-		LOG_ERROR("Failed to create Descriptor Pool for HDRI2Cube!");
+		LOG_ERROR("Failed to create Renderpass for cube layer rendering!");
+		return VK_NULL_HANDLE;
 	}
 
-	// *** Create Descriptor Set Layout
-	std::array<VkDescriptorSetLayoutBinding, 1> arrDescriptorSetLayoutBindings = {};
-	arrDescriptorSetLayoutBindings[0].binding = 0;
-	arrDescriptorSetLayoutBindings[0].descriptorCount = 1;
-	arrDescriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	arrDescriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	return renderPass;
+}
 
-	VkDescriptorSetLayoutCreateInfo descSetlayoutCreateInfo = {};
-	descSetlayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	descSetlayoutCreateInfo.bindingCount = arrDescriptorSetLayoutBindings.size();
-	descSetlayoutCreateInfo.pBindings = arrDescriptorSetLayoutBindings.data();
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTextureCUBE::CreateCubeBakeTargets(VulkanDevice* pDevice, VkImage cubeImage, VkFormat format, uint32_t dimension, 
+											  uint32_t mipLevels, CubeBakeTargets& outTargets)
+{
+	outTargets.eTarget = m_eCubeBakeTarget;
+	outTargets.mipLevels = mipLevels;
 
-	result = vkCreateDescriptorSetLayout(pDevice->m_vkLogicalDevice, &descSetlayoutCreateInfo, nullptr, &descSetLayout);
-	if (result != VK_SUCCESS)
+	if (outTargets.eTarget == CubeBakeTarget::FACE_COPY)
 	{
-		LOG_ERROR("Failed to create Descriptor Set Layout for HDRI2Cube map!");
+		outTargets.renderPass = CreateOffscreenRenderPass(pDevice, format);
+
+		std::tuple<VkImage, VkImageView, VkDeviceMemory, VkFramebuffer> tupleOffscreen = CreateOffscreenFramebuffer(pDevice, outTargets.renderPass, format, dimension);
+		outTargets.offscreenImage = std::get<0>(tupleOffscreen);
+		outTargets.vecViews.push_back(std::get<1>(tupleOffscreen));
+		outTargets.offscreenMemory = std::get<2>(tupleOffscreen);
+		outTargets.vecFramebuffers.push_back(std::get<3>(tupleOffscreen));
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(pDevice->m_vkLogicalDevice, outTargets.offscreenImage, &memRequirements);
+		outTargets.transientBytes = memRequirements.size;
+
+		return outTargets.renderPass != VK_NULL_HANDLE;
 	}
 
-	// *** Create Descriptor Set
-	VkDescriptorSetAllocateInfo	setAllocInfo = {};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = descPool;
-	setAllocInfo.descriptorSetCount = 1;
-	setAllocInfo.pSetLayouts = &descSetLayout;
+	outTargets.renderPass = CreateCubeLayerRenderPass(pDevice, format);
+	if (outTargets.renderPass == VK_NULL_HANDLE)
+		return false;
 
-	result = vkAllocateDescriptorSets(pDevice->m_vkLogicalDevice, &setAllocInfo, &descSet);
-	if (result != VK_SUCCESS)
+	// A 2D view of one face & level is a complete color attachment, the cube never goes through a copy
+	outTargets.vecViews.resize(6 * mipLevels, VK_NULL_HANDLE);
+	outTargets.vecFramebuffers.resize(6 * mipLevels, VK_NULL_HANDLE);
+
+	for (uint32_t f = 0; f < 6; ++f)
 	{
-		LOG_ERROR("Failed to create Descriptor Set for HDRI2Cube map!");
+		for (uint32_t m = 0; m < mipLevels; ++m)
+		{
+			const uint32_t index = f * mipLevels + m;
+			const uint32_t extent = std::max(dimension >> m, 1u);
+
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.image = cubeImage;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = format;
+			viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewCreateInfo.subresourceRange.baseMipLevel = m;
+			viewCreateInfo.subresourceRange.levelCount = 1;
+			viewCreateInfo.subresourceRange.baseArrayLayer = f;
+			viewCreateInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(pDevice->m_vkLogicalDevice, &viewCreateInfo, nullptr, &outTargets.vecViews[index]) != VK_SUCCESS)
+			{
+				LOG_ERROR("Failed to create view of cube face {0} level {1}!", f, m);
+				return false;
+			}
+
+			VkFramebufferCreateInfo fbCreateInfo = {};
+			fbCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			fbCreateInfo.renderPass = outTargets.renderPass;
+			fbCreateInfo.attachmentCount = 1;
+			fbCreateInfo.pAttachments = &outTargets.vecViews[index];
+			fbCreateInfo.width = extent;
+			fbCreateInfo.height = extent;
+			fbCreateInfo.layers = 1;
+
+			if (vkCreateFramebuffer(pDevice->m_vkLogicalDevice, &fbCreateInfo, nullptr, &outTargets.vecFramebuffers[index]) != VK_SUCCESS)
+			{
+				LOG_ERROR("Failed to create framebuffer for cube face {0} level {1}!", f, m);
+				return false;
+			}
+		}
 	}
 
-	// *** Write Descriptor Sets (HDRI Image goes in as parameter to shader which then gets converted into CubeMap!)
-	VkDescriptorImageInfo hdriImageInfo = {};
-	hdriImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	hdriImageInfo.imageView = m_pTextureHDRI->m_vkTextureImageView;
-	hdriImageInfo.sampler = m_pTextureHDRI->m_vkTextureSampler;
+	return true;
+}
 
-	// Descriptor write info
-	VkWriteDescriptorSet hdriSetWrite = {};
-	hdriSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	hdriSetWrite.dstSet = descSet;
-	hdriSetWrite.dstBinding = 0;
-	hdriSetWrite.dstArrayElement = 0;
-	hdriSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	hdriSetWrite.descriptorCount = 1;
-	hdriSetWrite.pImageInfo = &hdriImageInfo;
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::DestroyCubeBakeTargets(VulkanDevice* pDevice, CubeBakeTargets& targets)
+{
+	for (VkFramebuffer framebuffer : targets.vecFramebuffers)
+		vkDestroyFramebuffer(pDevice->m_vkLogicalDevice, framebuffer, nullptr);
 
-	// Update the descriptor sets with new buffer/binding info
-	vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &hdriSetWrite, 0, nullptr);
+	for (VkImageView view : targets.vecViews)
+		vkDestroyImageView(pDevice->m_vkLogicalDevice, view, nullptr);
 
-	return std::make_tuple(descPool, descSetLayout, descSet);
+	vkDestroyImage(pDevice->m_vkLogicalDevice, targets.offscreenImage, nullptr);
+	vkFreeMemory(pDevice->m_vkLogicalDevice, targets.offscreenMemory, nullptr);
+	vkDestroyRenderPass(pDevice->m_vkLogicalDevice, targets.renderPass, nullptr);
+
+	targets = CubeBakeTargets();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Framebuffer a face & level renders into
+inline VkFramebuffer GetCubeBakeFramebuffer(const CubeBakeTargets& targets, uint32_t face, uint32_t level)
+{
+	return targets.eTarget == CubeBakeTarget::LAYER_VIEWS ? targets.vecFramebuffers[face * targets.mipLevels + level] : targets.vecFramebuffers[0];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::RecordFaceCopy(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, const CubeBakeTargets& targets, 
+									   VkImage cubeImage, uint32_t face, uint32_t level, uint32_t extent)
+{
+	Vulkan::TransitionImageLayout(pDevice, commandBuffer, targets.offscreenImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+	// Copy region for transfer from framebuffer to cube face
+	VkImageCopy copyRegion = {};
+
+	copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.srcSubresource.baseArrayLayer = 0;
+	copyRegion.srcSubresource.mipLevel = 0;
+	copyRegion.srcSubresource.layerCount = 1;
+	copyRegion.srcOffset = { 0, 0, 0 };
+
+	copyRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copyRegion.dstSubresource.baseArrayLayer = face;
+	copyRegion.dstSubresource.mipLevel = level;
+	copyRegion.dstSubresource.layerCount = 1;
+	copyRegion.dstOffset = { 0, 0, 0 };
+
+	copyRegion.extent.width = extent;
+	copyRegion.extent.height = extent;
+	copyRegion.extent.depth = 1;
+
+	vkCmdCopyImage(commandBuffer, targets.offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cubeImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+
+	// Transform framebuffer color attachment back
+	Vulkan::TransitionImageLayout(pDevice, commandBuffer, targets.offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::AddCubeBakeReport(const std::string& name, const CubeBakeTargets& targets, uint32_t dimension, float bakeMs)
+{
+	const uint32_t passCount = 6 * targets.mipLevels;
+	const bool bCopy = targets.eTarget == CubeBakeTarget::FACE_COPY;
+
+	CubeBakeReport report;
+	report.name = name;
+	report.eTarget = targets.eTarget;
+	report.dimension = dimension;
+	report.mipLevels = targets.mipLevels;
+	report.bakeMs = bakeMs;
+	report.transientBytes = targets.transientBytes;
+	report.copyCount = bCopy ? passCount : 0;
+	report.barrierCount = bCopy ? 2 * passCount + 2 : 0;
+
+	m_vecCubeBakeReports.push_back(report);
+
+	LOG_INFO("{0} via {1}: {2:.2f} ms, {3} passes, {4} copies, {5} barriers, {6} KB transient", name, 
+			 bCopy ? "face copies" : "layer views", bakeMs, passCount, report.copyCount, report.barrierCount, report.transientBytes / 1024);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextureCUBE::CreateIrradianceDescriptorSet(VulkanDevice* pDevice)
+std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextureCUBE::CreateHDRI2CubeDescriptorSet(VulkanDevice* pDevice)
 {
 	VkResult result;
 	VkDescriptorPool		descPool;
@@ -317,7 +474,7 @@ std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextu
 	result = vkCreateDescriptorPool(pDevice->m_vkLogicalDevice, &poolCreateInfo, nullptr, &descPool);
 	if (result != VK_SUCCESS)
 	{
-		LOG_ERROR("Failed to create Descriptor Pool for Irradiance map!");
+		LOG_ERROR("Failed to create Descriptor Pool for HDRI2Cube!");
 	}
 
 	// *** Create Descriptor Set Layout
@@ -331,11 +488,11 @@ std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextu
 	descSetlayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descSetlayoutCreateInfo.bindingCount = arrDescriptorSetLayoutBindings.size();
 	descSetlayoutCreateInfo.pBindings = arrDescriptorSetLayoutBindings.data();
-	
+
 	result = vkCreateDescriptorSetLayout(pDevice->m_vkLogicalDevice, &descSetlayoutCreateInfo, nullptr, &descSetLayout);
 	if (result != VK_SUCCESS)
 	{
-		LOG_ERROR("Failed to create Descriptor Set Layout for Irradiance map!");
+		LOG_ERROR("Failed to create Descriptor Set Layout for HDRI2Cube map!");
 	}
 
 	// *** Create Descriptor Set
@@ -348,27 +505,27 @@ std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextu
 	result = vkAllocateDescriptorSets(pDevice->m_vkLogicalDevice, &setAllocInfo, &descSet);
 	if (result != VK_SUCCESS)
 	{
-		LOG_ERROR("Failed to create Descriptor Set for Irradiance map!");
+		LOG_ERROR("Failed to create Descriptor Set for HDRI2Cube map!");
 	}
 
-	// *** Write Descriptor Sets (Cubemap Image goes in as parameter to shader which then gets converted into Irrad Map!)
-	VkDescriptorImageInfo cubemapImageInfo = {};
-	cubemapImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;											
-	cubemapImageInfo.imageView = m_vkImageViewCUBE;																	
-	cubemapImageInfo.sampler = m_vkSamplerCUBE;			
+	// *** Write Descriptor Sets (HDRI Image goes in as parameter to shader which then gets converted into CubeMap!)
+	VkDescriptorImageInfo hdriImageInfo = {};
+	hdriImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	hdriImageInfo.imageView = m_pTextureHDRI->m_vkTextureImageView;
+	hdriImageInfo.sampler = m_pTextureHDRI->m_vkTextureSampler;
 
 	// Descriptor write info
-	VkWriteDescriptorSet cubemapSetWrite = {};
-	cubemapSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	cubemapSetWrite.dstSet = descSet;
-	cubemapSetWrite.dstBinding = 0;
-	cubemapSetWrite.dstArrayElement = 0;
-	cubemapSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	cubemapSetWrite.descriptorCount = 1;
-	cubemapSetWrite.pImageInfo = &cubemapImageInfo;
+	VkWriteDescriptorSet hdriSetWrite = {};
+	hdriSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	hdriSetWrite.dstSet = descSet;
+	hdriSetWrite.dstBinding = 0;
+	hdriSetWrite.dstArrayElement = 0;
+	hdriSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	hdriSetWrite.descriptorCount = 1;
+	hdriSetWrite.pImageInfo = &hdriImageInfo;
 
 	// Update the descriptor sets with new buffer/binding info
-	vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &cubemapSetWrite, 0, nullptr);
+	vkUpdateDescriptorSets(pDevice->m_vkLogicalDevice, 1, &hdriSetWrite, 0, nullptr);
 
 	return std::make_tuple(descPool, descSetLayout, descSet);
 }
@@ -393,133 +550,6 @@ void VulkanTextureCUBE::CreateHDRI2CubePipeline(VulkanDevice* pDevice, VulkanSwa
 	m_pGraphicsPipelineHDRI2Cube->CreateGraphicsPipeline(pDevice, pSwapchain, renderPass, 0, 1);
 }
 
-//---------------------------------------------------------------------------------------------------------------------
-void VulkanTextureCUBE::CreateIrradiancePipeline(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, VkDescriptorSetLayout descSetLayout, VkRenderPass renderPass)
-{
-	m_pGraphicsPipelineIrradiance = new VulkanGraphicsPipeline(PipelineType::IRRADIANCE_CUBE, pSwapchain);
-
-	// Descriptor Set layouts!
-	std::vector<VkDescriptorSetLayout> setLayouts = { descSetLayout };
-
-	// Push constants!
-	VkPushConstantRange pushConstantRange = {};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = sizeof(IrradShaderPushData);
-
-	std::vector<VkPushConstantRange> pushConstantRanges = { pushConstantRange };
-
-	m_pGraphicsPipelineIrradiance->CreatePipelineLayout(pDevice, setLayouts, pushConstantRanges);
-	m_pGraphicsPipelineIrradiance->CreateGraphicsPipeline(pDevice, pSwapchain, renderPass, 0, 1);
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-void VulkanTextureCUBE::RenderIrrandianceCUBE(VulkanDevice* pDevice, VkRenderPass renderPass, VkFramebuffer framebuffer, VkImage irradImage, VkImage offscreenImage, VkDescriptorSet irradDescSet, uint32_t dimension)
-{
-	std::array<VkClearValue, 1> arrClearValues;
-	arrClearValues[0].color = { {0.8f, 0.8f, 0.8f, 0.0f} };
-
-	VkRenderPassBeginInfo renderPassBeginInfo = {};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = renderPass;
-	renderPassBeginInfo.framebuffer = framebuffer;
-	renderPassBeginInfo.renderArea.extent.width = dimension;
-	renderPassBeginInfo.renderArea.extent.height = dimension;
-	renderPassBeginInfo.clearValueCount = arrClearValues.size();
-	renderPassBeginInfo.pClearValues = arrClearValues.data();
-
-	glm::mat4 captureViews[] =
-	{
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-	   glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
-	};
-
-	VkViewport vp = {};
-	vp.width = (float)dimension;
-	vp.height = (float)dimension;
-	vp.minDepth = 0.0f;
-	vp.maxDepth = 1.0f;
-
-	VkRect2D scissorRect = {};
-	scissorRect.extent.width = dimension;
-	scissorRect.extent.height = dimension;
-	scissorRect.offset.x = 0.0f;
-	scissorRect.offset.y = 0.0f;
-
-	IrradShaderPushData irradPushData;
-
-	// Start recording commands to command buffer!
-	VkCommandBuffer cmdBuffer = pDevice->BeginCommandBuffer();
-
-	vkCmdSetViewport(cmdBuffer, 0, 1, &vp);
-	vkCmdSetScissor(cmdBuffer, 0, 1, &scissorRect);
-
-	VkImageSubresourceRange subresourceRange = {};
-	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	subresourceRange.baseMipLevel = 0;
-	subresourceRange.levelCount = 1;
-	subresourceRange.layerCount = 6;
-
-	// Change image layout for all cubemap faces to transfer destination
-	Vulkan::TransitionImageLayout(pDevice, cmdBuffer, irradImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
-
-	// 6 faces of irradiance map!
-	for (uint32_t f = 0; f < 6; f++)
-	{
-		// Render scene from cube face's point of view
-		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		irradPushData.mvp = glm::perspective((float)(M_PI_OVER_TWO), 1.0f, 0.1f, 512.0f) * captureViews[f];
-		vkCmdPushConstants(	cmdBuffer,
-							m_pGraphicsPipelineIrradiance->m_vkPipelineLayout,
-							VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-							0, sizeof(IrradShaderPushData),
-							&irradPushData);	
-
-		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pGraphicsPipelineIrradiance->m_vkGraphicsPipeline);
-		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pGraphicsPipelineIrradiance->m_vkPipelineLayout, 0, 1, &irradDescSet, 0, NULL);
-
-		m_pDummySkybox->Render(pDevice, cmdBuffer);
-
-		vkCmdEndRenderPass(cmdBuffer);
-
-		Vulkan::TransitionImageLayout(pDevice, cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-		// Copy region for transfer from framebuffer to cube face
-		VkImageCopy copyRegion = {};
-
-		copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.srcSubresource.baseArrayLayer = 0;
-		copyRegion.srcSubresource.mipLevel = 0;
-		copyRegion.srcSubresource.layerCount = 1;
-		copyRegion.srcOffset = { 0, 0, 0 };
-
-		copyRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.dstSubresource.baseArrayLayer = f;
-		copyRegion.dstSubresource.mipLevel = 0;
-		copyRegion.dstSubresource.layerCount = 1;
-		copyRegion.dstOffset = { 0, 0, 0 };
-
-		copyRegion.extent.width = static_cast<uint32_t>(vp.width);
-		copyRegion.extent.height = static_cast<uint32_t>(vp.height);
-		copyRegion.extent.depth = 1;
-
-		vkCmdCopyImage(cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, irradImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,&copyRegion);
-
-		// Transform framebuffer color attachment back
-		Vulkan::TransitionImageLayout(pDevice, cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-	}
-
-	// Transform Irradiance map to Shader readable optimal format!
-	Vulkan::TransitionImageLayout(pDevice, cmdBuffer, irradImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
-
-	pDevice->EndAndSubmitCommandBuffer(cmdBuffer);
-}
-
 //---------------------------------------------------------------------------------------------------------------------
 std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> VulkanTextureCUBE::CreatePrefilteredSpecDescriptorSet(VulkanDevice* pDevice)
 {
@@ -619,15 +649,15 @@ void VulkanTextureCUBE::CreatePrefilteredSpecPipeline(VulkanDevice* pDevice, Vul
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTextureCUBE::RenderPrefilteredSpec(VulkanDevice* pDevice, VkRenderPass renderPass, VkFramebuffer framebuffer, VkImage prefilterImage, VkImage offscreenImage, VkDescriptorSet prefilterDescSet, uint32_t dimension, uint32_t nMipmaps)
+void VulkanTextureCUBE::RenderPrefilteredSpec(VulkanDevice* pDevice, const CubeBakeTargets& targets, VkImage prefilterImage, 
+											  VkDescriptorSet prefilterDescSet, uint32_t dimension, uint32_t nMipmaps)
 {
 	std::array<VkClearValue, 1> arrClearValues;
 	arrClearValues[0].color = { {0.8f, 0.8f, 0.8f, 0.0f} };
 
 	VkRenderPassBeginInfo renderPassBeginInfo = {};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = renderPass;
-	renderPassBeginInfo.framebuffer = framebuffer;
+	renderPassBeginInfo.renderPass = targets.renderPass;
 	renderPassBeginInfo.renderArea.extent.width = dimension;
 	renderPassBeginInfo.renderArea.extent.height = dimension;
 	renderPassBeginInfo.clearValueCount = arrClearValues.size();
@@ -669,20 +699,32 @@ void VulkanTextureCUBE::RenderPrefilteredSpec(VulkanDevice* pDevice, VkRenderPas
 	subresourceRange.levelCount = nMipmaps;
 	subresourceRange.layerCount = 6;
 
-	// Change image layout for all cubemap faces to transfer destination
-	Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, prefilterImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+	// Copies need all cubemap faces as transfer destination, layer views get their layouts from the render pass
+	if (targets.eTarget == CubeBakeTarget::FACE_COPY)
+		Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, prefilterImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
 
 	for (uint32_t m = 0; m < nMipmaps; m++) 
 	{
 		prefilterShaderData.roughness = (float)m / (float)(nMipmaps - 1);
 
+		// Layer view framebuffers are only as big as their level
+		const uint32_t extent = std::max(dimension >> m, 1u);
+
+		vp.width = static_cast<float>(extent);
+		vp.height = static_cast<float>(extent);
+		vkCmdSetViewport(cmdBuffer, 0, 1, &vp);
+
+		scissorRect.extent.width = extent;
+		scissorRect.extent.height = extent;
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissorRect);
+
+		renderPassBeginInfo.renderArea.extent.width = extent;
+		renderPassBeginInfo.renderArea.extent.height = extent;
+
 		for (uint32_t f = 0; f < 6; f++) 
 		{
-			vp.width = static_cast<float>(dimension * std::pow(0.5f, m));
-			vp.height = static_cast<float>(dimension * std::pow(0.5f, m));
-			vkCmdSetViewport(cmdBuffer, 0, 1, &vp);
-
 			// Render scene from cube face's point of view
+			renderPassBeginInfo.framebuffer = GetCubeBakeFramebuffer(targets, f, m);
 			vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			// Update shader push constant block
@@ -701,36 +743,14 @@ void VulkanTextureCUBE::RenderPrefilteredSpec(VulkanDevice* pDevice, VkRenderPas
 
 			vkCmdEndRenderPass(cmdBuffer);
 
-			Vulkan::TransitionImageLayout(pDevice, cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-			// Copy region for transfer from framebuffer to cube face
-			VkImageCopy copyRegion = {};
-
-			copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			copyRegion.srcSubresource.baseArrayLayer = 0;
-			copyRegion.srcSubresource.mipLevel = 0;
-			copyRegion.srcSubresource.layerCount = 1;
-			copyRegion.srcOffset = { 0, 0, 0 };
-
-			copyRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			copyRegion.dstSubresource.baseArrayLayer = f;
-			copyRegion.dstSubresource.mipLevel = m;
-			copyRegion.dstSubresource.layerCount = 1;
-			copyRegion.dstOffset = { 0, 0, 0 };
-
-			copyRegion.extent.width = static_cast<uint32_t>(vp.width);
-			copyRegion.extent.height = static_cast<uint32_t>(vp.height);
-			copyRegion.extent.depth = 1;
-
-			vkCmdCopyImage(cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, prefilterImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-			// Transform framebuffer color attachment back
-			Vulkan::TransitionImageLayout(pDevice, cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+			if (targets.eTarget == CubeBakeTarget::FACE_COPY)
+				RecordFaceCopy(pDevice, cmdBuffer, targets, prefilterImage, f, m, extent);
 		}
 	}
 
-	// Transform Irradiance map to Shader readable optimal format!
-	Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, prefilterImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
+	// Transform Prefiltered map to Shader readable optimal format!
+	if (targets.eTarget == CubeBakeTarget::FACE_COPY)
+		Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, prefilterImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
 
 	pDevice->EndAndSubmitCommandBuffer(cmdBuffer);
 }
@@ -848,15 +868,14 @@ void VulkanTextureCUBE::RenderBrdfLUT(VulkanDevice* pDevice, VkRenderPass render
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTextureCUBE::RenderHDRI2CUBE(VulkanDevice* pDevice, VkRenderPass renderPass, VkFramebuffer framebuffer, VkImage cubeImage, VkImage offscreenImage, VkDescriptorSet cubeDescSet, uint32_t dimension)
+void VulkanTextureCUBE::RenderHDRI2CUBE(VulkanDevice* pDevice, const CubeBakeTargets& targets, VkImage cubeImage, VkDescriptorSet cubeDescSet, uint32_t dimension)
 {
 	std::array<VkClearValue, 1> arrClearValues;
 	arrClearValues[0].color = { {0.8f, 0.8f, 0.8f, 0.0f} };
 
 	VkRenderPassBeginInfo renderPassBeginInfo = {};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = renderPass;
-	renderPassBeginInfo.framebuffer = framebuffer;
+	renderPassBeginInfo.renderPass = targets.renderPass;
 	renderPassBeginInfo.renderArea.extent.width = dimension;
 	renderPassBeginInfo.renderArea.extent.height = dimension;
 	renderPassBeginInfo.clearValueCount = arrClearValues.size();
@@ -898,13 +917,15 @@ void VulkanTextureCUBE::RenderHDRI2CUBE(VulkanDevice* pDevice, VkRenderPass rend
 	subresourceRange.levelCount = 1;
 	subresourceRange.layerCount = 6;
 
-	// Change image layout for all cubemap faces to transfer destination
-	Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, cubeImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+	// Copies need all cubemap faces as transfer destination, layer views get their layouts from the render pass
+	if (targets.eTarget == CubeBakeTarget::FACE_COPY)
+		Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, cubeImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
 
 	// 6 faces of irradiance map!
 	for (uint32_t f = 0; f < 6; f++)
 	{
 		// Render scene from cube face's point of view
+		renderPassBeginInfo.framebuffer = GetCubeBakeFramebuffer(targets, f, 0);
 		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
@@ -924,95 +945,38 @@ void VulkanTextureCUBE::RenderHDRI2CUBE(VulkanDevice* pDevice, VkRenderPass rend
 
 		vkCmdEndRenderPass(cmdBuffer);
 
-		Vulkan::TransitionImageLayout(pDevice, cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-
-		// Copy region for transfer from framebuffer to cube face
-		VkImageCopy copyRegion = {};
-
-		copyRegion.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.srcSubresource.baseArrayLayer = 0;
-		copyRegion.srcSubresource.mipLevel = 0;
-		copyRegion.srcSubresource.layerCount = 1;
-		copyRegion.srcOffset = { 0, 0, 0 };
-
-		copyRegion.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copyRegion.dstSubresource.baseArrayLayer = f;
-		copyRegion.dstSubresource.mipLevel = 0;
-		copyRegion.dstSubresource.layerCount = 1;
-		copyRegion.dstOffset = { 0, 0, 0 };
-
-		copyRegion.extent.width =  static_cast<uint32_t>(vp.width);
-		copyRegion.extent.height = static_cast<uint32_t>(vp.height);
-		copyRegion.extent.depth = 1;
-
-		vkCmdCopyImage(cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cubeImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
-
-		// Transform framebuffer color attachment back
-		Vulkan::TransitionImageLayout(pDevice, cmdBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+		if (targets.eTarget == CubeBakeTarget::FACE_COPY)
+			RecordFaceCopy(pDevice, cmdBuffer, targets, cubeImage, f, 0, dimension);
 	}
 
-	// Transform Irradiance map to Shader readable optimal format!
-	Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, cubeImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
+	// Transform Cubemap to Shader readable optimal format!
+	if (targets.eTarget == CubeBakeTarget::FACE_COPY)
+		Vulkan::TransitionImageLayoutCUBE(pDevice, cmdBuffer, cubeImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange);
 
 	pDevice->EndAndSubmitCommandBuffer(cmdBuffer);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTextureCUBE::CreateIrradianceCUBE(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, uint32_t dimension)
+bool VulkanTextureCUBE::CreateIrradianceSH(std::string fileName)
 {
-	m_pDummySkybox = new DummySkybox();
-	m_pDummySkybox->Init(pDevice);
-
-	const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
-
-	//*** Create VkImage with 6 array Layers!
-	m_vkImageIRRAD = Vulkan::CreateImageCUBE(pDevice,
-													dimension,
-													dimension,
-													format, 
-													1,
-													VK_IMAGE_TILING_OPTIMAL,
-													VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkImageMemoryIRRAD);
-
-	// Create Image View!
-	m_vkImageViewIRRAD = Vulkan::CreateImageViewCUBE(pDevice,
-															m_vkImageIRRAD,
-															format,
-															1,
-															VK_IMAGE_ASPECT_COLOR_BIT);
-
-	// Create Sampler!
-	m_vkSamplerIRRAD = CreateTextureSampler(pDevice, 1);
-
-	// Create RenderPass
-	VkRenderPass irradRenderPass = CreateOffscreenRenderPass(pDevice, format);
-
-	// Create Off-screen framebuffer! 
-	std::tuple<VkImage, VkImageView, VkDeviceMemory, VkFramebuffer> tupleOffscreen = CreateOffscreenFramebuffer(pDevice, irradRenderPass, format, dimension);
-
-	// Create Descriptor Set layout & Descriptor Set!
-	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> tupleDescriptor = CreateIrradianceDescriptorSet(pDevice);
+	// Projected straight from the equirect source, full float so bright texels keep their weight
+	Texture::HDRImage image;
+	if (!Texture::LoadHDRImage("Assets/Textures/HDRI/" + fileName, Texture::TextureFormat::RGBA32F, image))
+	{
+		LOG_ERROR("Failed to load {0} for the irradiance SH!", fileName);
+		return false;
+	}
 
-	// Create Graphics Pipeline!
-	CreateIrradiancePipeline(pDevice, pSwapchain, std::get<1>(tupleDescriptor), irradRenderPass);
+	Texture::SHProjectionReport report;
+	Texture::ProjectEquirectSH(reinterpret_cast<const float*>(image.vecData.data()), image.width, image.height, m_IrradianceSH, &report);
 
-	// Render
-	RenderIrrandianceCUBE(pDevice, irradRenderPass, std::get<3>(tupleOffscreen), m_vkImageIRRAD, std::get<0>(tupleOffscreen), std::get<2>(tupleDescriptor), dimension);
+	m_IrradianceSHGPU = Texture::PackIrradianceSH(m_IrradianceSH);
+	m_bIrradianceSH = true;
 
-	// Cleanup!
-	vkDestroyRenderPass(pDevice->m_vkLogicalDevice, irradRenderPass, nullptr);
-	vkDestroyFramebuffer(pDevice->m_vkLogicalDevice, std::get<3>(tupleOffscreen), nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, std::get<2>(tupleOffscreen), nullptr);
-	vkDestroyImageView(pDevice->m_vkLogicalDevice, std::get<1>(tupleOffscreen), nullptr);
-	vkDestroyImage(pDevice->m_vkLogicalDevice, std::get<0>(tupleOffscreen), nullptr);
-	vkDestroyDescriptorPool(pDevice->m_vkLogicalDevice, std::get<0>(tupleDescriptor), nullptr);
-	vkDestroyDescriptorSetLayout(pDevice->m_vkLogicalDevice, std::get<1>(tupleDescriptor), nullptr);
+	LOG_DEBUG("Projected {0} into irradiance SH in {1:.2f} ms ({2} texels, {3} threads, SIMD {4})", fileName, report.projectMs,
+			  report.texelCount, report.threadCount, report.bSimd ? "on" : "off");
 
-	m_pGraphicsPipelineIrradiance->Cleanup(pDevice);
-	m_pDummySkybox->Cleanup(pDevice);
-
-	SAFE_DELETE(m_pGraphicsPipelineIrradiance);
-	SAFE_DELETE(m_pDummySkybox);
+	return true;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -1022,11 +986,11 @@ void VulkanTextureCUBE::CreatePrefilteredSpecMap(VulkanDevice* pDevice, VulkanSw
 	const uint32_t dim = dimension;
 	const uint32_t numMips = static_cast<uint32_t>(floor(log2(dim))) + 1;
 
-	// Create 6 faced cubemap image
+	// Create 6 faced cubemap image, color attachment for the layer views & transfer dst for the face copies
 	m_vkImagePrefilterSpec = Vulkan::CreateImageCUBE(pDevice, 
 															 dim, dim, format, numMips,
 															 VK_IMAGE_TILING_OPTIMAL, 
-															 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+															 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
 															 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 															 &m_vkImageMemoryPrefilterSpec);
 
@@ -1040,27 +1004,26 @@ void VulkanTextureCUBE::CreatePrefilteredSpecMap(VulkanDevice* pDevice, VulkanSw
 	m_pDummySkybox = new DummySkybox();
 	m_pDummySkybox->Init(pDevice);
 
-	// Create offscreen Renderpass
-	VkRenderPass prefilterRenderPass = CreateOffscreenRenderPass(pDevice, format);
-
-	// Create offscreen framebuffer
-	std::tuple<VkImage, VkImageView, VkDeviceMemory, VkFramebuffer> tupleOffscreen = CreateOffscreenFramebuffer(pDevice, prefilterRenderPass, format, dimension);
+	// Create Renderpass & framebuffers, one per face & level or a single offscreen one
+	CubeBakeTargets targets;
+	CreateCubeBakeTargets(pDevice, m_vkImagePrefilterSpec, format, dim, numMips, targets);
 
 	// Create Descriptor Set layout & Descriptor Set!
 	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> tupleDescriptor = CreatePrefilteredSpecDescriptorSet(pDevice);
 
 	// Create Graphics Pipeline!
-	CreatePrefilteredSpecPipeline(pDevice, pSwapchain, std::get<1>(tupleDescriptor), prefilterRenderPass);
+	CreatePrefilteredSpecPipeline(pDevice, pSwapchain, std::get<1>(tupleDescriptor), targets.renderPass);
 
 	// Render
-	RenderPrefilteredSpec(pDevice, prefilterRenderPass, std::get<3>(tupleOffscreen), m_vkImagePrefilterSpec, std::get<0>(tupleOffscreen), std::get<2>(tupleDescriptor), dim, numMips);
+	const auto bakeStart = std::chrono::high_resolution_clock::now();
+
+	RenderPrefilteredSpec(pDevice, targets, m_vkImagePrefilterSpec, std::get<2>(tupleDescriptor), dim, numMips);
+
+	AddCubeBakeReport("Prefiltered specular", targets, dim,
+					  std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - bakeStart).count());
 
 	// Cleanup!
-	vkDestroyRenderPass(pDevice->m_vkLogicalDevice, prefilterRenderPass, nullptr);
-	vkDestroyFramebuffer(pDevice->m_vkLogicalDevice, std::get<3>(tupleOffscreen), nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, std::get<2>(tupleOffscreen), nullptr);
-	vkDestroyImageView(pDevice->m_vkLogicalDevice, std::get<1>(tupleOffscreen), nullptr);
-	vkDestroyImage(pDevice->m_vkLogicalDevice, std::get<0>(tupleOffscreen), nullptr);
+	DestroyCubeBakeTargets(pDevice, targets);
 	vkDestroyDescriptorPool(pDevice->m_vkLogicalDevice, std::get<0>(tupleDescriptor), nullptr);
 	vkDestroyDescriptorSetLayout(pDevice->m_vkLogicalDevice, std::get<1>(tupleDescriptor), nullptr);
 
@@ -1071,6 +1034,74 @@ void VulkanTextureCUBE::CreatePrefilteredSpecMap(VulkanDevice* pDevice, VulkanSw
 	SAFE_DELETE(m_pDummySkybox);
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTextureCUBE::CreatePrefilteredSpecMapCPU(VulkanDevice* pDevice, std::string fileName, uint32_t dimension)
+{
+	Texture::HDRImage image;
+	if (!Texture::LoadHDRImage("Assets/Textures/HDRI/" + fileName, Texture::TextureFormat::RGBA32F, image))
+	{
+		LOG_ERROR("Failed to load {0} for the prefiltered specular map!", fileName);
+		return false;
+	}
+
+	// Same 512 source the HDRI->Cubemap pass renders, with a box filtered chain for the source mip selection
+	Texture::CubeMipChain source;
+	Texture::EquirectToCubeMipChain(reinterpret_cast<const float*>(image.vecData.data()), image.width, image.height, 512, source);
+	image.vecData = std::vector<uint8_t>();
+
+	Texture::PrefilterSettings settings;
+	settings.dimension = dimension;
+
+	Texture::CubeMipChain prefiltered;
+	Texture::PrefilterReport report;
+	Texture::BakePrefilteredSpecular(source, settings, prefiltered, &report);
+
+	UploadPrefilteredSpecMap(pDevice, prefiltered);
+
+	LOG_DEBUG("Baked prefiltered specular map for {0} on the CPU in {1:.1f} ms ({2} levels, {3} jobs, {4} threads)", fileName, report.bakeMs,
+			  prefiltered.mipLevels, report.jobCount, report.threadCount);
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::UploadPrefilteredSpecMap(VulkanDevice* pDevice, const Texture::CubeMipChain& cube)
+{
+	const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+	// Same image, view & sampler CreatePrefilteredSpecMap renders into
+	m_vkImagePrefilterSpec = Vulkan::CreateImageCUBE(pDevice, 
+															 cube.dimension, cube.dimension, format, cube.mipLevels,
+															 VK_IMAGE_TILING_OPTIMAL, 
+															 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+															 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+															 &m_vkImageMemoryPrefilterSpec);
+
+	m_vkImageViewPrefilterSpec = Vulkan::CreateImageViewCUBE(pDevice, m_vkImagePrefilterSpec, format, cube.mipLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_vkSamplerPrefilterSpec = CreateTextureSampler(pDevice, cube.mipLevels);
+
+	const VkDeviceSize byteSize = cube.vecData.size() * sizeof(float);
+
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	const StagingAllocation staging = pUploader->Stage(byteSize, 16);
+	if (staging.pData == nullptr)
+	{
+		LOG_ERROR("No staging memory for the prefiltered specular map!");
+		return;
+	}
+
+	memcpy(staging.pData, cube.vecData.data(), static_cast<size_t>(byteSize));
+
+	// The chain is already laid out in copy order
+	std::vector<VkDeviceSize> vecRegionOffsets(cube.vecRegionOffsets.size());
+	for (size_t i = 0; i < vecRegionOffsets.size(); ++i)
+		vecRegionOffsets[i] = staging.offset + cube.vecRegionOffsets[i] * sizeof(float);
+
+	RecordCubeCopy(pDevice, pUploader->GetCommandBuffer(), m_vkImagePrefilterSpec, cube.dimension, cube.mipLevels, staging.buffer, vecRegionOffsets);
+
+	m_uiUploadToken = pUploader->Submit();
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void VulkanTextureCUBE::CreateBrdfLUTMap(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, uint32_t dimension)
 {
@@ -1187,32 +1218,226 @@ void VulkanTextureCUBE::CreateBrdfLUTMap(VulkanDevice* pDevice, VulkanSwapChain*
 	SAFE_DELETE(m_pGraphicsPipelineBrdfLUT);
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTextureCUBE::CreateIBL(VulkanDevice* pDevice, std::string fileName, const Texture::IBLBakeSettings& settings)
+{
+	// BC6H cubes need a device that samples them, otherwise the float entries get used instead
+	Texture::IBLBakeSettings cacheSettings = settings;
+	if (settings.eCubeFormat == Texture::TextureFormat::BC6H)
+	{
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(pDevice->m_vkPhysicalDevice, VK_FORMAT_BC6H_UFLOAT_BLOCK, &formatProperties);
+		if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+		{
+			LOG_WARNING("Device can't sample BC6H, using RGBA32F IBL cubes for {0}", fileName);
+			cacheSettings.eCubeFormat = Texture::TextureFormat::RGBA32F;
+		}
+	}
+
+	Texture::IBLCachePaths paths;
+	Texture::IBLCacheReport report;
+	if (!Texture::PrepareIBLCache("Assets/Textures/HDRI/" + fileName, cacheSettings, paths, &report))
+	{
+		LOG_ERROR("Failed to prepare the IBL cache for {0}!", fileName);
+		return false;
+	}
+
+	const auto uploadStart = std::chrono::high_resolution_clock::now();
+
+	if (!Texture::ReadIrradianceSH(paths.irradianceSH, m_IrradianceSH))
+	{
+		LOG_ERROR("Failed to read the irradiance SH {0}!", paths.irradianceSH);
+		return false;
+	}
+
+	m_IrradianceSHGPU = Texture::PackIrradianceSH(m_IrradianceSH);
+	m_bIrradianceSH = true;
+
+	// Environment, prefiltered & BRDF LUT, packed back to back in one staging buffer
+	std::array<std::string, 3> arrFiles = { paths.environment, paths.prefiltered, paths.brdfLUT };
+	std::array<Texture::ContainerInfo, 3> arrInfos;
+	std::array<VkDeviceSize, 3> arrStagingOffsets;
+
+	VkDeviceSize byteSize = 0;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		if (!Texture::ReadContainerInfo(arrFiles[i], arrInfos[i]))
+		{
+			LOG_ERROR("Failed to read IBL cache entry {0}!", arrFiles[i]);
+			return false;
+		}
+
+		arrStagingOffsets[i] = byteSize;
+		byteSize += arrInfos[i].GetTotalByteSize();
+
+		// Keeps every region 16 byte aligned for the RGBA32F & BC6H cubes
+		byteSize = (byteSize + 15) & ~VkDeviceSize(15);
+	}
+
+	// Levels get read straight into staging, the ring unless the three images together outgrow it
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	const StagingAllocation staging = pUploader->Stage(byteSize, 16);
+	if (staging.pData == nullptr)
+	{
+		LOG_ERROR("No staging memory for the IBL cache of {0}!", fileName);
+		return false;
+	}
+
+	bool bSuccess = true;
+	std::array<std::vector<uint64_t>, 3> arrLevelOffsets;
+	for (uint32_t i = 0; i < 3 && bSuccess; ++i)
+		bSuccess = Texture::ReadContainerLevels(arrFiles[i], arrInfos[i], staging.pData + arrStagingOffsets[i], arrLevelOffsets[i]);
+
+	// The staged range goes back with the uploader's batch, nothing was recorded against it
+	if (!bSuccess)
+	{
+		LOG_ERROR("Failed to read the IBL cache for {0}!", fileName);
+		return false;
+	}
+
+	// KTX2 keeps a level's faces together, the copy wants face * mipLevels + level
+	auto getCubeRegionOffsets = [&](uint32_t i)
+	{
+		const Texture::ContainerInfo& info = arrInfos[i];
+		const uint32_t mipLevels = static_cast<uint32_t>(info.vecLevels.size());
+
+		std::vector<VkDeviceSize> vecRegionOffsets(6 * mipLevels);
+		for (uint32_t level = 0; level < mipLevels; ++level)
+		{
+			const VkDeviceSize faceBytes = info.vecLevels[level].byteSize / 6;
+			for (uint32_t face = 0; face < 6; ++face)
+				vecRegionOffsets[face * mipLevels + level] = staging.offset + arrStagingOffsets[i] + arrLevelOffsets[i][level] + face * faceBytes;
+		}
+
+		return vecRegionOffsets;
+	};
+
+	const VkFormat cubeFormat = arrInfos[0].eFormat == Texture::TextureFormat::BC6H ? VK_FORMAT_BC6H_UFLOAT_BLOCK : VK_FORMAT_R32G32B32A32_SFLOAT;
+	const VkFormat brdfFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	const uint32_t environmentLevels = static_cast<uint32_t>(arrInfos[0].vecLevels.size());
+	const uint32_t prefilterLevels = static_cast<uint32_t>(arrInfos[1].vecLevels.size());
+
+	// Cubemap
+	m_vkImageCUBE = Vulkan::CreateImageCUBE(pDevice, arrInfos[0].width, arrInfos[0].width, cubeFormat, environmentLevels, VK_IMAGE_TILING_OPTIMAL,
+											VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+											&m_vkImageMemoryCUBE);
+	m_vkImageViewCUBE = Vulkan::CreateImageViewCUBE(pDevice, m_vkImageCUBE, cubeFormat, environmentLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_vkSamplerCUBE = CreateTextureSampler(pDevice, environmentLevels);
+
+	// Prefiltered Specular Cubemap
+	m_vkImagePrefilterSpec = Vulkan::CreateImageCUBE(pDevice, arrInfos[1].width, arrInfos[1].width, cubeFormat, prefilterLevels, VK_IMAGE_TILING_OPTIMAL,
+													 VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+													 &m_vkImageMemoryPrefilterSpec);
+	m_vkImageViewPrefilterSpec = Vulkan::CreateImageViewCUBE(pDevice, m_vkImagePrefilterSpec, cubeFormat, prefilterLevels, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_vkSamplerPrefilterSpec = CreateTextureSampler(pDevice, prefilterLevels);
+
+	// BRDF LUT map
+	m_vkImageBRDF = Vulkan::CreateImage(pDevice, arrInfos[2].width, arrInfos[2].height, brdfFormat, VK_IMAGE_TILING_OPTIMAL,
+										VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+										&m_vkImageMemoryBRDF);
+	m_vkImageViewBRDF = Vulkan::CreateImageView(pDevice, m_vkImageBRDF, brdfFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	m_vkSamplerBRDF = CreateTextureSampler(pDevice, 1);
+
+	VkCommandBuffer cmdBuffer = pUploader->GetCommandBuffer();
+
+	RecordCubeCopy(pDevice, cmdBuffer, m_vkImageCUBE, arrInfos[0].width, environmentLevels, staging.buffer, getCubeRegionOffsets(0));
+	RecordCubeCopy(pDevice, cmdBuffer, m_vkImagePrefilterSpec, arrInfos[1].width, prefilterLevels, staging.buffer, getCubeRegionOffsets(1));
+
+	VkImageSubresourceRange subResRange = {};
+	subResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subResRange.baseMipLevel = 0;
+	subResRange.levelCount = 1;
+	subResRange.baseArrayLayer = 0;
+	subResRange.layerCount = 1;
+
+	Vulkan::TransitionImageLayout(pDevice, cmdBuffer, m_vkImageBRDF, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subResRange);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = staging.offset + arrStagingOffsets[2] + arrLevelOffsets[2][0];
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { arrInfos[2].width, arrInfos[2].height, 1 };
+
+	vkCmdCopyBufferToImage(cmdBuffer, staging.buffer, m_vkImageBRDF, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	pUploader->EndImageUpload(m_vkImageBRDF, subResRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	m_uiUploadToken = pUploader->Submit();
+
+	const float uploadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+	LOG_DEBUG("IBL for {0}: bake {1:.1f} ms, upload {2:.1f} ms ({3} KB staged)", fileName, report.bakeMs, uploadMs, byteSize / 1024);
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTextureCUBE::CreateIBLCompute(VulkanDevice* pDevice, std::string fileName, const Texture::IBLBakeSettings& settings)
+{
+	Texture::HDRImage image;
+	if (!Texture::LoadHDRImage("Assets/Textures/HDRI/" + fileName, Texture::TextureFormat::RGBA32F, image))
+	{
+		LOG_ERROR("Failed to load {0} for the compute IBL!", fileName);
+		return false;
+	}
+
+	const float* pRGBA = reinterpret_cast<const float*>(image.vecData.data());
+
+	Texture::ProjectEquirectSH(pRGBA, image.width, image.height, m_IrradianceSH);
+	m_IrradianceSHGPU = Texture::PackIrradianceSH(m_IrradianceSH);
+	m_bIrradianceSH = true;
+
+	VulkanComputeIBL computeIBL;
+	ComputeIBLReport report = {};
+	const bool bSuccess = computeIBL.Initialize(pDevice) && computeIBL.Bake(pDevice, pRGBA, image.width, image.height, settings, this, &report);
+	computeIBL.Cleanup(pDevice);
+
+	if (!bSuccess)
+	{
+		LOG_ERROR("Failed to bake the compute IBL for {0}!", fileName);
+		return false;
+	}
+
+	const uint32_t environmentLevels = static_cast<uint32_t>(std::floor(std::log2(settings.environmentDimension))) + 1;
+	m_vkSamplerCUBE = CreateTextureSampler(pDevice, std::min(environmentLevels, IBL_COMPUTE_MAX_LEVELS));
+	m_vkSamplerPrefilterSpec = CreateTextureSampler(pDevice, report.prefilterLevels);
+	m_vkSamplerBRDF = CreateTextureSampler(pDevice, 1);
+
+	LOG_DEBUG("Compute IBL for {0}: {1} dispatches, setup {2:.1f} ms, total {3:.1f} ms", fileName, report.dispatchCount, report.setupMs, report.totalMs);
+
+	return true;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 void VulkanTextureCUBE::Cleanup(VulkanDevice* pDevice)
 {
+	pDevice->m_pUploader->Wait(m_uiUploadToken);
+	m_uiUploadToken = UPLOAD_TOKEN_NONE;
+
 	// Cubemap
 	vkDestroyImageView(pDevice->m_vkLogicalDevice, m_vkImageViewCUBE, nullptr);
 	vkDestroyImage(pDevice->m_vkLogicalDevice, m_vkImageCUBE, nullptr);
-	vkDestroySampler(pDevice->m_vkLogicalDevice, m_vkSamplerCUBE, nullptr);
+	VulkanSamplerCache::getInstance().Release(pDevice, m_vkSamplerCUBE);
 	vkFreeMemory(pDevice->m_vkLogicalDevice, m_vkImageMemoryCUBE, nullptr);
 
-	// Irradiance map
-	vkDestroyImageView(pDevice->m_vkLogicalDevice, m_vkImageViewIRRAD, nullptr);
-	vkDestroyImage(pDevice->m_vkLogicalDevice, m_vkImageIRRAD, nullptr);
-	vkDestroySampler(pDevice->m_vkLogicalDevice, m_vkSamplerIRRAD, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, m_vkImageMemoryIRRAD, nullptr);
-
 	// Prefiltered Spec map
 	vkDestroyImageView(pDevice->m_vkLogicalDevice, m_vkImageViewPrefilterSpec, nullptr);
 	vkDestroyImage(pDevice->m_vkLogicalDevice, m_vkImagePrefilterSpec, nullptr);
-	vkDestroySampler(pDevice->m_vkLogicalDevice, m_vkSamplerPrefilterSpec, nullptr);
+	VulkanSamplerCache::getInstance().Release(pDevice, m_vkSamplerPrefilterSpec);
 	vkFreeMemory(pDevice->m_vkLogicalDevice, m_vkImageMemoryPrefilterSpec, nullptr);
 
 	// BRDF LUT map
 	vkDestroyImageView(pDevice->m_vkLogicalDevice, m_vkImageViewBRDF, nullptr);
 	vkDestroyImage(pDevice->m_vkLogicalDevice, m_vkImageBRDF, nullptr);
-	vkDestroySampler(pDevice->m_vkLogicalDevice, m_vkSamplerBRDF, nullptr);
+	VulkanSamplerCache::getInstance().Release(pDevice, m_vkSamplerBRDF);
 	vkFreeMemory(pDevice->m_vkLogicalDevice, m_vkImageMemoryBRDF, nullptr);
+
+	// HDRI source of CreateTextureCubeFromHDRI
+	if (m_pTextureHDRI)
+		m_pTextureHDRI->Cleanup(pDevice);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -1221,96 +1446,197 @@ void VulkanTextureCUBE::CleanupOnWindowResize(VulkanDevice* pDevice)
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-void VulkanTextureCUBE::CreateTextureImage(VulkanDevice* pDevice, std::string fileName)
+std::vector<CubeBakeReport> VulkanTextureCUBE::RunCubeBakeBenchmark(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, std::string fileName)
 {
-	// *** Load pixel data
-	int width = 0, height = 0, channels = 0;
+	std::vector<CubeBakeReport> vecReports;
 
-	std::array<std::string, 6> arrFileNames;
+	// Layer views first, a cold start penalty lands on the new path instead of flattering it
+	for (CubeBakeTarget eTarget : { CubeBakeTarget::LAYER_VIEWS, CubeBakeTarget::FACE_COPY })
+	{
+		VulkanTextureCUBE cube;
+		cube.m_eCubeBakeTarget = eTarget;
+
+		cube.CreateTextureCubeFromHDRI(pDevice, pSwapchain, fileName);
+		cube.CreatePrefilteredSpecMap(pDevice, pSwapchain, 512);
+		cube.Cleanup(pDevice);
 
-	arrFileNames[0] = "Textures/Cubemaps/" + fileName + '/' + "posx.jpg";
-	arrFileNames[1] = "Textures/Cubemaps/" + fileName + '/' + "negx.jpg";
-	arrFileNames[2] = "Textures/Cubemaps/" + fileName + '/' + "posy.jpg";
-	arrFileNames[3] = "Textures/Cubemaps/" + fileName + '/' + "negy.jpg";
-	arrFileNames[4] = "Textures/Cubemaps/" + fileName + '/' + "posz.jpg";
-	arrFileNames[5] = "Textures/Cubemaps/" + fileName + '/' + "negz.jpg";
+		vecReports.insert(vecReports.end(), cube.m_vecCubeBakeReports.begin(), cube.m_vecCubeBakeReports.end());
+	}
 
-	// Data for 6 faces of cubemap!
-	std::array<unsigned char*, 6> arrImageData = {};
+	return vecReports;
+}
 
-	for (int i = 0; i < arrImageData.size(); ++i)
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTextureCUBE::PrepareFaceUpload(const std::string& directory, bool bGenerateMips, CubemapUploadData& outData)
+{
+	const char* arrFaceNames[6] = { "posx.jpg", "negx.jpg", "posy.jpg", "negy.jpg", "posz.jpg", "negz.jpg" };
+
+	// Headers only, the decode itself happens straight into staging
+	for (uint32_t face = 0; face < 6; ++face)
 	{
-		arrImageData[i] = stbi_load(arrFileNames[i].c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		outData.arrFaceFiles[face] = directory + '/' + arrFaceNames[face];
+
+		int width = 0, height = 0, channels = 0;
+		if (!stbi_info(outData.arrFaceFiles[face].c_str(), &width, &height, &channels))
+		{
+			LOG_ERROR("Failed to load a Texture file! ({0})", outData.arrFaceFiles[face]);
+			return false;
+		}
+
+		if (width != height || (face > 0 && static_cast<uint32_t>(width) != outData.dimension))
+		{
+			LOG_ERROR("Cubemap faces must be square & the same size ({0} is {1}x{2})", outData.arrFaceFiles[face], width, height);
+			return false;
+		}
+
+		outData.dimension = static_cast<uint32_t>(width);
+	}
 
-		if (!arrImageData[i])
+	outData.mipLevels = bGenerateMips ? Texture::ComputeMipCount(outData.dimension, outData.dimension) : 1;
+	outData.vecRegionOffsets.resize(6 * outData.mipLevels);
+	outData.byteSize = 0;
+
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		for (uint32_t level = 0; level < outData.mipLevels; ++level)
 		{
-			LOG_ERROR(("Failed to load a Texture file! (" + arrFileNames[i] + ")").c_str());
-			return;
+			const VkDeviceSize levelDimension = std::max(1u, outData.dimension >> level);
+
+			outData.vecRegionOffsets[face * outData.mipLevels + level] = outData.byteSize;
+			outData.byteSize += levelDimension * levelDimension * 4;
 		}
 	}
 
-	// Calculate image size using given data for 6 faces!
-	const VkDeviceSize imageSize = width * height * 4 * 6;
-	const VkDeviceSize layerSize = imageSize / 6;
+	return true;
+}
 
-	//*** Create staging buffer to hold loaded data, ready to copy to device
-	VkBuffer imageStagingBuffer;
-	VkDeviceMemory imageStagingBufferMemory;
+//---------------------------------------------------------------------------------------------------------------------
+bool VulkanTextureCUBE::DecodeFace(const CubemapUploadData& data, uint32_t face, uint8_t* pStaging, float* pOutDecodeMs)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
 
-	// create staging buffer to hold the loaded data, ready to copy to device!
-	pDevice->CreateBuffer(imageSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageStagingBuffer,
-		&imageStagingBufferMemory);
+	int width = 0, height = 0, channels = 0;
+	unsigned char* pPixels = stbi_load(data.arrFaceFiles[face].c_str(), &width, &height, &channels, STBI_rgb_alpha);
 
-	//*** copy image data to staging buffer
-	void* data;
-	vkMapMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory, 0, imageSize, 0, &data);
+	bool bSuccess = pPixels != nullptr && static_cast<uint32_t>(width) == data.dimension && static_cast<uint32_t>(height) == data.dimension;
+	if (!bSuccess)
+	{
+		// Keep the rest of the batch going, the face just stays black
+		LOG_ERROR("Failed to load a Texture file! ({0})", data.arrFaceFiles[face]);
 
-	VkDeviceSize currOffset = 0;
-	for (int i = 0; i < arrImageData.size(); ++i)
+		const VkDeviceSize faceStart = data.vecRegionOffsets[face * data.mipLevels];
+		const VkDeviceSize faceEnd = face < 5 ? data.vecRegionOffsets[(face + 1) * data.mipLevels] : data.byteSize;
+		memset(pStaging + faceStart, 0, static_cast<size_t>(faceEnd - faceStart));
+	}
+	else if (data.mipLevels == 1)
 	{
-		memcpy(static_cast<unsigned char*>(data) + currOffset, arrImageData[i], layerSize);
-		currOffset += layerSize;
+		memcpy(pStaging + data.vecRegionOffsets[face], pPixels, static_cast<size_t>(data.dimension) * data.dimension * 4);
 	}
+	else
+	{
+		// Faces are stored sRGB encoded even though the image is UNORM, filter them as such
+		Texture::MipSettings settings;
+		settings.eColorSpace = Texture::MipColorSpace::SRGB;
 
-	vkUnmapMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory);
+		std::vector<Texture::MipLevel> vecLevels;
+		Texture::GenerateMipChain(pPixels, data.dimension, data.dimension, settings, vecLevels);
 
-	// Free original image data
-	for (int i = 0; i < arrImageData.size(); ++i)
-	{
-		stbi_image_free(arrImageData[i]);
+		for (uint32_t level = 0; level < data.mipLevels; ++level)
+		{
+			memcpy(pStaging + data.vecRegionOffsets[face * data.mipLevels + level], vecLevels[level].vecData.data(), vecLevels[level].vecData.size());
+		}
 	}
 
+	if (pPixels != nullptr)
+		stbi_image_free(pPixels);
+
+	if (pOutDecodeMs != nullptr)
+		*pOutDecodeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return bSuccess;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::CreateImageResources(VulkanDevice* pDevice, const CubemapUploadData& data)
+{
 	//*** Create VkImage with 6 array Layers!
 	m_vkImageCUBE = Vulkan::CreateImageCUBE(	pDevice,
-														width,
-														height,
-														VK_FORMAT_R8G8B8A8_UNORM,
-														1,
-														VK_IMAGE_TILING_OPTIMAL,
-														VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkImageMemoryCUBE);
+												data.dimension,
+												data.dimension,
+												VK_FORMAT_R8G8B8A8_UNORM,
+												data.mipLevels,
+												VK_IMAGE_TILING_OPTIMAL,
+												VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vkImageMemoryCUBE);
+}
 
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::RecordUpload(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, const CubemapUploadData& data,
+									 VkBuffer stagingBuffer, VkDeviceSize stagingOffset)
+{
+	std::vector<VkDeviceSize> vecRegionOffsets(data.vecRegionOffsets.size());
+	for (size_t i = 0; i < vecRegionOffsets.size(); ++i)
+		vecRegionOffsets[i] = stagingOffset + data.vecRegionOffsets[i];
 
-	//*** Transition image to be DST for copy operation
+	RecordCubeCopy(pDevice, commandBuffer, m_vkImageCUBE, data.dimension, data.mipLevels, stagingBuffer, vecRegionOffsets);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::RecordCubeCopy(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, VkImage image, uint32_t dimension,
+									   uint32_t mipLevels, VkBuffer stagingBuffer, const std::vector<VkDeviceSize>& vecRegionOffsets)
+{
+	VkImageSubresourceRange subResRange = {};
+	subResRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subResRange.baseMipLevel = 0;
+	subResRange.levelCount = mipLevels;
+	subResRange.baseArrayLayer = 0;
+	subResRange.layerCount = 6;
+
+	//*** Transition every face & level to be DST for copy operation
 	Vulkan::TransitionImageLayoutCUBE(	pDevice,
-												m_vkImageCUBE,
-												VK_IMAGE_LAYOUT_UNDEFINED,
-												VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+										commandBuffer,
+										image,
+										VK_IMAGE_LAYOUT_UNDEFINED,
+										VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										subResRange);
+
+	// COPY DATA TO IMAGE, one region per face & level
+	std::vector<VkBufferImageCopy> vecRegions(6 * mipLevels);
+	for (uint32_t face = 0; face < 6; ++face)
+	{
+		for (uint32_t level = 0; level < mipLevels; ++level)
+		{
+			const uint32_t levelDimension = std::max(1u, dimension >> level);
+
+			VkBufferImageCopy& region = vecRegions[face * mipLevels + level];
+			region.bufferOffset = vecRegionOffsets[face * mipLevels + level];
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = face;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, 0, 0 };
+			region.imageExtent = { levelDimension, levelDimension, 1 };
+		}
+	}
 
-	// COPY DATA TO IMAGE
-	Vulkan::CopyImageBufferCUBE(pDevice, imageStagingBuffer, m_vkImageCUBE, width, height);
+	vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						   static_cast<uint32_t>(vecRegions.size()), vecRegions.data());
 
-	// Transition image to be shader readable for shader usage
-	Vulkan::TransitionImageLayoutCUBE(	pDevice,
-												m_vkImageCUBE,
-												VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-												VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	// Transition image to be shader readable for shader usage, graphics takes it over from the transfer queue
+	pDevice->m_pUploader->EndImageUpload(image, subResRange, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
 
-	//*** Destroy staging buffers
-	vkDestroyBuffer(pDevice->m_vkLogicalDevice, imageStagingBuffer, nullptr);
-	vkFreeMemory(pDevice->m_vkLogicalDevice, imageStagingBufferMemory, nullptr);
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCUBE::FinalizeTexture(VulkanDevice* pDevice, const CubemapUploadData& data)
+{
+	m_vkImageViewCUBE = Vulkan::CreateImageViewCUBE(	pDevice,
+														m_vkImageCUBE,
+														VK_FORMAT_R8G8B8A8_UNORM,
+														data.mipLevels,
+														VK_IMAGE_ASPECT_COLOR_BIT);
+
+	m_vkSamplerCUBE = CreateTextureSampler(pDevice, data.mipLevels);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -1331,14 +1657,11 @@ VkSampler VulkanTextureCUBE::CreateTextureSampler(VulkanDevice* pDevice, uint32_
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;				// Mipmap interpolation mode
 	samplerCreateInfo.mipLodBias = 0.0f;										// Level of detail bias for mip level
 	samplerCreateInfo.minLod = 0.0f;											// minimum level of detail to pick mip level
-	samplerCreateInfo.maxLod = static_cast<float>(nMipmaps);					// maximum level of detail to pick mip level
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;								// the view limits the levels, so cubes with any mip count share the sampler
 	samplerCreateInfo.anisotropyEnable = VK_FALSE;								// Enable Anisotropy or not? Check physical device features to see if anisotropy is supported or not!
 	samplerCreateInfo.maxAnisotropy = 16;										// Anisotropy sample level
 
-	if (vkCreateSampler(pDevice->m_vkLogicalDevice, &samplerCreateInfo, nullptr, &sampler) != VK_SUCCESS)
-	{
-		LOG_ERROR("Failed to create Texture sampler!");
-	}
+	sampler = VulkanSamplerCache::getInstance().Acquire(pDevice, samplerCreateInfo);
 
 	return sampler;
 }
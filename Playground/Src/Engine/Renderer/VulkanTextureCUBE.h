@@ -6,24 +6,17 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include "Engine/Texture/SphericalHarmonics.h"
+#include "Engine/Texture/SpecularPrefilter.h"
+#include "Engine/Texture/IBLCache.h"
+#include "Engine/Renderer/VulkanStagingUploader.h"
+
 class VulkanDevice;
 class VulkanSwapChain;
 class VulkanGraphicsPipeline;
 class VulkanTexture2D;
 class DummySkybox;
 
-//---------------------------------------------------------------------------------------------------------------------
-struct IrradShaderPushData
-{
-	IrradShaderPushData()
-	{
-		mvp = glm::mat4(1);
-	}
-
-	// Data Specific
-	alignas(64) glm::mat4		mvp;
-};
-
 //-------------------------------------------------------------------------------------------------------------------
 struct HDRIShaderPushData
 {
@@ -52,6 +45,55 @@ struct PrefilterShaderPushData
 	alignas(4)	uint32_t		numSamples;
 };
 
+//---------------------------------------------------------------------------------------------------------------------
+//--- Six face files of a cubemap sized up front by VulkanTextureCUBE::PrepareFaceUpload, decoded by DecodeFace straight into
+//--- staging. Regions are face major, every level of +X first.
+struct CubemapUploadData
+{
+	std::array<std::string, 6>			arrFaceFiles;				// +X, -X, +Y, -Y, +Z, -Z, the layer order Vulkan expects
+	uint32_t							dimension = 0;
+	uint32_t							mipLevels = 1;
+	std::vector<VkDeviceSize>			vecRegionOffsets;			// face * mipLevels + level, relative to the start of the upload
+	VkDeviceSize						byteSize = 0;				// Bytes the upload takes in staging
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Where the HDRI->Cube & prefilter passes render. LAYER_VIEWS draws straight into a 2D view of each face & level of the
+//--- cube, FACE_COPY is the previous path kept to compare against: one offscreen image copied into the cube after every pass.
+enum class CubeBakeTarget
+{
+	LAYER_VIEWS,
+	FACE_COPY
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Render pass & framebuffers of one bake. LAYER_VIEWS has a view & framebuffer per face & level (face * mipLevels + level),
+//--- FACE_COPY a single framebuffer on the offscreen image.
+struct CubeBakeTargets
+{
+	CubeBakeTarget						eTarget = CubeBakeTarget::LAYER_VIEWS;
+	VkRenderPass						renderPass = VK_NULL_HANDLE;
+	uint32_t							mipLevels = 1;
+	std::vector<VkImageView>			vecViews;
+	std::vector<VkFramebuffer>			vecFramebuffers;
+	VkImage								offscreenImage = VK_NULL_HANDLE;
+	VkDeviceMemory						offscreenMemory = VK_NULL_HANDLE;
+	VkDeviceSize						transientBytes = 0;			// Offscreen image memory, nothing for LAYER_VIEWS
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct CubeBakeReport
+{
+	std::string							name;
+	CubeBakeTarget						eTarget;
+	uint32_t							dimension;
+	uint32_t							mipLevels;
+	float								bakeMs;						// Recording, submit & wait of the passes, setup excluded
+	VkDeviceSize						transientBytes;
+	uint32_t							copyCount;
+	uint32_t							barrierCount;				// Recorded transitions, the ones render passes do excluded
+};
+
 //---------------------------------------------------------------------------------------------------------------------
 class VulkanTextureCUBE
 {
@@ -61,37 +103,65 @@ public:
 
 	void																 CreateTextureCUBE(VulkanDevice* pDevice, std::string fileName);
 	void																 CreateTextureCubeFromHDRI(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, std::string fileName);
-	void																 CreateIrradianceCUBE(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, uint32_t dimension);
+	bool																 CreateIrradianceSH(std::string fileName);
 	void																 CreatePrefilteredSpecMap(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, uint32_t dimension);
+	bool																 CreatePrefilteredSpecMapCPU(VulkanDevice* pDevice, std::string fileName, uint32_t dimension);
+	void																 UploadPrefilteredSpecMap(VulkanDevice* pDevice, const Texture::CubeMipChain& cube);
 	void																 CreateBrdfLUTMap(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, uint32_t dimension);
+
+	// Environment cube, irradiance SH, prefiltered specular & BRDF LUT from the IBL cache, baking only on a miss. All three
+	// images go up through one staging allocation & one uploader batch.
+	bool																 CreateIBL(VulkanDevice* pDevice, std::string fileName, const Texture::IBLBakeSettings& settings);
+
+	// Same three images baked on the GPU by VulkanComputeIBL, one dispatch per stage & no cache. Irradiance is still the CPU
+	// SH projection of the equirect.
+	bool																 CreateIBLCompute(VulkanDevice* pDevice, std::string fileName, const Texture::IBLBakeSettings& settings);
 	void																 Cleanup(VulkanDevice* pDevice);
 	void																 CleanupOnWindowResize(VulkanDevice* pDevice);
+
+	// HDRI->Cube & a 512 prefiltered map through both bake targets, the layer views should need no transient memory
+	static std::vector<CubeBakeReport>									 RunCubeBakeBenchmark(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, std::string fileName);
+
+	// Stages of VulkanTextureLoader::LoadCubemapBatch. Prepare & DecodeFace are thread safe, every face of a cube can
+	// decode on its own worker. Faces must be square & the same size, mips come from Texture::GenerateMipChain.
+	static bool															 PrepareFaceUpload(const std::string& directory, bool bGenerateMips, CubemapUploadData& outData);
+	static bool															 DecodeFace(const CubemapUploadData& data, uint32_t face, uint8_t* pStaging, float* pOutDecodeMs);
+	void																 CreateImageResources(VulkanDevice* pDevice, const CubemapUploadData& data);
+	void																 RecordUpload(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, const CubemapUploadData& data,
+																					  VkBuffer stagingBuffer, VkDeviceSize stagingOffset);
+	void																 FinalizeTexture(VulkanDevice* pDevice, const CubemapUploadData& data);
 																		 
 private:															
-	void																 CreateTextureImage(VulkanDevice* pDevice, std::string fileName);
 	VkSampler															 CreateTextureSampler(VulkanDevice* pDevice, uint32_t nMipmaps);
 
+	// Transition, one copy region per face & level (byte offsets into stagingBuffer, face * mipLevels + level) & back to shader read
+	void																 RecordCubeCopy(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, VkImage image, uint32_t dimension,
+																						uint32_t mipLevels, VkBuffer stagingBuffer, const std::vector<VkDeviceSize>& vecRegionOffsets);
+
 	// Generic, HDRI->Cubemap, CubeMap->IrradMap
 	VkRenderPass														 CreateOffscreenRenderPass(VulkanDevice* pDevice, VkFormat format);
 	std::tuple<VkImage, VkImageView, VkDeviceMemory, VkFramebuffer>		 CreateOffscreenFramebuffer(VulkanDevice* pDevice, VkRenderPass renderPass, VkFormat format, uint32_t dimension);
 
+	// Cube bakes, m_eCubeBakeTarget picks between rendering into the cube's own layers & the offscreen image + copies
+	VkRenderPass														 CreateCubeLayerRenderPass(VulkanDevice* pDevice, VkFormat format);
+	bool																 CreateCubeBakeTargets(VulkanDevice* pDevice, VkImage cubeImage, VkFormat format, uint32_t dimension,
+																							   uint32_t mipLevels, CubeBakeTargets& outTargets);
+	void																 DestroyCubeBakeTargets(VulkanDevice* pDevice, CubeBakeTargets& targets);
+	void																 RecordFaceCopy(VulkanDevice* pDevice, VkCommandBuffer commandBuffer, const CubeBakeTargets& targets,
+																						VkImage cubeImage, uint32_t face, uint32_t level, uint32_t extent);
+	void																 AddCubeBakeReport(const std::string& name, const CubeBakeTargets& targets, uint32_t dimension, float bakeMs);
+
 	// HDRI->Cubemap Generation Pass!
 	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> CreateHDRI2CubeDescriptorSet(VulkanDevice* pDevice);
 	void																 CreateHDRI2CubePipeline(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, VkDescriptorSetLayout descSetLayout, VkRenderPass	renderPass);
-	void																 RenderHDRI2CUBE(VulkanDevice* pDevice, VkRenderPass renderPass, VkFramebuffer framebuffer,
-																						 VkImage irradImage, VkImage offscreenImage, VkDescriptorSet irradDescSet, uint32_t dimension);
-
-	// Cubemap->Irradiance Map Generation Pass!
-	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> CreateIrradianceDescriptorSet(VulkanDevice* pDevice);
-	void																 CreateIrradiancePipeline(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, VkDescriptorSetLayout descSetLayout, VkRenderPass renderPass);
-	void																 RenderIrrandianceCUBE(VulkanDevice* pDevice, VkRenderPass renderPass, VkFramebuffer framebuffer,
-																							   VkImage irradImage, VkImage offscreenImage, VkDescriptorSet irradDescSet, uint32_t dimension);
+	void																 RenderHDRI2CUBE(VulkanDevice* pDevice, const CubeBakeTargets& targets, VkImage cubeImage,
+																						 VkDescriptorSet cubeDescSet, uint32_t dimension);
 
 	// Cubemap->Prefiltered Map Generation Pass!
 	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> CreatePrefilteredSpecDescriptorSet(VulkanDevice* pDevice);
 	void																 CreatePrefilteredSpecPipeline(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, VkDescriptorSetLayout descSetLayout, VkRenderPass renderPass);
-	void																 RenderPrefilteredSpec(VulkanDevice* pDevice, VkRenderPass renderPass, VkFramebuffer framebuffer,
-																								VkImage irradImage, VkImage offscreenImage, VkDescriptorSet irradDescSet, uint32_t dimension, uint32_t												nMipmaps);
+	void																 RenderPrefilteredSpec(VulkanDevice* pDevice, const CubeBakeTargets& targets, VkImage prefilterImage,
+																							   VkDescriptorSet prefilterDescSet, uint32_t dimension, uint32_t nMipmaps);
 
 	// BRDF LUT Map Generation Pass!
 	std::tuple<VkDescriptorPool, VkDescriptorSetLayout, VkDescriptorSet> CreateBrdfLUTDescriptorSet(VulkanDevice* pDevice);
@@ -111,13 +181,10 @@ public:
 	VkDeviceMemory														 m_vkImageMemoryCUBE;
 	VkSampler															 m_vkSamplerCUBE;
 																		 
-	// Irradiance Map													 
-	VkImage																 m_vkImageIRRAD;
-	VkImageView															 m_vkImageViewIRRAD;
-	VkImageLayout														 m_vkImageLayoutIRRAD;
-	VkDeviceMemory														 m_vkImageMemoryIRRAD;
-	VkSampler															 m_vkSamplerIRRAD;
-	VulkanGraphicsPipeline*												 m_pGraphicsPipelineIrradiance;
+	// Irradiance as 9 SH coefficients, shaders evaluate the packed form instead of sampling an irradiance cube
+	Texture::SH9Color													 m_IrradianceSH;
+	Texture::SHIrradianceGPU											 m_IrradianceSHGPU;
+	bool																 m_bIrradianceSH;
 
 	// Prefiltered Specular Cubemap
 	VkImage																 m_vkImagePrefilterSpec;
@@ -135,6 +202,13 @@ public:
 	VkSampler															 m_vkSamplerBRDF;
 	VulkanGraphicsPipeline*												 m_pGraphicsPipelineBrdfLUT;
 																		 
-	DummySkybox*														 m_pDummySkybox;																	
+	DummySkybox*														 m_pDummySkybox;
+
+	// Uploads from staging (faces, CPU prefiltered map, IBL cache) are in place once it completes, Cleanup waits on it
+	UploadToken															 m_uiUploadToken;
+
+	// Target of the next GPU bake & what every bake so far cost
+	CubeBakeTarget														 m_eCubeBakeTarget;
+	std::vector<CubeBakeReport>											 m_vecCubeBakeReports;																	
 };
 
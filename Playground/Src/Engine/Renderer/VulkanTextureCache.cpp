@@ -0,0 +1,421 @@
+#include "PlaygroundPCH.h"
+#include "VulkanTextureCache.h"
+
+#include <chrono>
+
+#include "VulkanDevice.h"
+#include "VulkanMaterialTable.h"
+#include "VulkanTextureLoader.h"
+#include "Engine/Helpers/JobSystem.h"
+#include "Engine/Helpers/Utility.h"
+
+#include "PlaygroundHeaders.h"
+
+const uint32_t INVALID_RESIDENCY_ID = 0xFFFFFFFF;
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanTextureCache::VulkanTextureCache()
+{
+	ResetStats();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanTextureCache::~VulkanTextureCache()
+{
+	for (auto& entry : m_mapEntries)
+	{
+		SAFE_DELETE(entry.second);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanTexture2D* VulkanTextureCache::Acquire(VulkanDevice* pDevice, const std::string& fileName, TextureType eType, MipGeneration eMipGeneration)
+{
+	std::vector<TextureRequest> vecRequests(1);
+	vecRequests[0].fileName = fileName;
+	vecRequests[0].eType = eType;
+	vecRequests[0].eMipGeneration = eMipGeneration;
+
+	return AcquireBatch(pDevice, vecRequests)[0];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<VulkanTexture2D*> VulkanTextureCache::AcquireBatch(VulkanDevice* pDevice, const std::vector<TextureRequest>& vecRequests)
+{
+	const uint32_t count = static_cast<uint32_t>(vecRequests.size());
+	m_Stats.requests += count;
+
+	std::vector<VulkanTexture2D*> vecTextures(count, nullptr);
+	std::vector<std::string> vecPathKeys(count);
+	std::vector<uint32_t> vecMisses;
+
+	//--- Same path, nothing to read
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const TextureRequest& request = vecRequests[i];
+		vecPathKeys[i] = std::filesystem::path(request.fileName).lexically_normal().generic_string() + MakeParameterKey(request.eType, request.eMipGeneration);
+
+		std::map<std::string, Entry*>::iterator pathIter = m_mapPathKeys.find(vecPathKeys[i]);
+		if (pathIter != m_mapPathKeys.end())
+			vecTextures[i] = AddReference(pathIter->second, vecPathKeys[i], false);
+		else
+			vecMisses.push_back(i);
+	}
+
+	if (vecMisses.empty())
+		return vecTextures;
+
+	//--- Same bytes under another name, hashing is far cheaper than decoding & uploading again. Files are hashed in
+	//--- parallel, the maps are only touched from this thread.
+	std::vector<std::string> vecContentKeys(count);
+	JobSystem::getInstance().ParallelFor(static_cast<uint32_t>(vecMisses.size()), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t j = begin; j < end; ++j)
+			vecContentKeys[vecMisses[j]] = MakeContentKey(vecRequests[vecMisses[j]]);
+	});
+
+	// Misses sharing a path or contents with an earlier miss of this batch get linked once it's loaded
+	std::vector<TextureLoadRequest> vecLoads;
+	std::vector<uint32_t> vecLoadOwners;
+	std::map<std::string, uint32_t> mapPendingPaths;
+	std::map<std::string, uint32_t> mapPendingContents;
+	std::vector<std::pair<uint32_t, uint32_t>> vecPendingPathHits;
+	std::vector<std::pair<uint32_t, uint32_t>> vecPendingContentHits;
+
+	for (uint32_t i : vecMisses)
+	{
+		const std::string& contentKey = vecContentKeys[i];
+
+		std::map<std::string, uint32_t>::iterator pendingPathIter = mapPendingPaths.find(vecPathKeys[i]);
+		if (pendingPathIter != mapPendingPaths.end())
+		{
+			vecPendingPathHits.emplace_back(i, pendingPathIter->second);
+			continue;
+		}
+
+		if (!contentKey.empty())
+		{
+			std::map<std::string, Entry*>::iterator contentIter = m_mapContentKeys.find(contentKey);
+			if (contentIter != m_mapContentKeys.end())
+			{
+				vecTextures[i] = AddReference(contentIter->second, vecPathKeys[i], true);
+				continue;
+			}
+
+			std::map<std::string, uint32_t>::iterator pendingContentIter = mapPendingContents.find(contentKey);
+			if (pendingContentIter != mapPendingContents.end())
+			{
+				vecPendingContentHits.emplace_back(i, pendingContentIter->second);
+				mapPendingPaths.emplace(vecPathKeys[i], pendingContentIter->second);
+				continue;
+			}
+		}
+
+		//--- Miss
+		const uint32_t loadIndex = static_cast<uint32_t>(vecLoads.size());
+
+		TextureLoadRequest load;
+		load.pTexture = new VulkanTexture2D();
+		load.fileName = vecRequests[i].fileName;
+		load.eType = vecRequests[i].eType;
+		load.eMipGeneration = vecRequests[i].eMipGeneration;
+		load.bKeepLevels = true;
+		vecLoads.push_back(load);
+		vecLoadOwners.push_back(i);
+
+		mapPendingPaths.emplace(vecPathKeys[i], loadIndex);
+		if (!contentKey.empty())
+			mapPendingContents.emplace(contentKey, loadIndex);
+	}
+
+	if (!vecLoads.empty())
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		// HDRIs are rare & keep their own float upload path, everything else goes up as one batch
+		std::vector<TextureLoadRequest> vecBatch;
+		for (const TextureLoadRequest& load : vecLoads)
+		{
+			if (load.eType == TextureType::TEXTURE_HDRI)
+				load.pTexture->CreateTexture(pDevice, load.fileName, load.eType, load.eMipGeneration);
+			else
+				vecBatch.push_back(load);
+		}
+
+		VulkanTextureLoader::getInstance().LoadBatch(pDevice, vecBatch);
+		const auto end = std::chrono::high_resolution_clock::now();
+
+		// Textures of a batch load together, split its time evenly for the saved time stats
+		const float loadMs = std::chrono::duration<float, std::milli>(end - start).count() / vecLoads.size();
+
+		for (uint32_t k = 0; k < vecLoads.size(); ++k)
+		{
+			const uint32_t owner = vecLoadOwners[k];
+			VulkanTexture2D* pTexture = vecLoads[k].pTexture;
+
+			Entry* pEntry = new Entry();
+			pEntry->pTexture = pTexture;
+			pEntry->refCount = 1;
+			pEntry->loadMs = loadMs;
+			pEntry->contentKey = vecContentKeys[owner];
+			pEntry->vecPathKeys.push_back(vecPathKeys[owner]);
+
+			pEntry->residencyID = pTexture->IsStreamable() ? m_Residency.RegisterTexture(pTexture->GetWidth(), pTexture->GetHeight(),
+																						 pTexture->m_vecLevelByteSizes)
+														   : INVALID_RESIDENCY_ID;
+
+			m_mapEntries.emplace(pTexture, pEntry);
+			m_mapPathKeys.emplace(vecPathKeys[owner], pEntry);
+			if (!pEntry->contentKey.empty())
+				m_mapContentKeys.emplace(pEntry->contentKey, pEntry);
+
+			++m_Stats.loads;
+			m_Stats.loadedBytes += pTexture->m_vkImageByteSize;
+			m_Stats.loadMs += loadMs;
+
+			vecTextures[owner] = pTexture;
+		}
+	}
+
+	// Content hits first, they register the path keys later path hits of the batch resolve to
+	for (const std::pair<uint32_t, uint32_t>& hit : vecPendingContentHits)
+		vecTextures[hit.first] = AddReference(m_mapEntries[vecLoads[hit.second].pTexture], vecPathKeys[hit.first], true);
+
+	for (const std::pair<uint32_t, uint32_t>& hit : vecPendingPathHits)
+		vecTextures[hit.first] = AddReference(m_mapEntries[vecLoads[hit.second].pTexture], vecPathKeys[hit.first], false);
+
+	return vecTextures;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCache::Release(VulkanDevice* pDevice, VulkanTexture2D* pTexture)
+{
+	std::map<VulkanTexture2D*, Entry*>::iterator iter = m_mapEntries.find(pTexture);
+	if (iter == m_mapEntries.end())
+	{
+		LOG_ERROR("Releasing a texture the cache doesn't own!");
+		return;
+	}
+
+	Entry* pEntry = iter->second;
+	if (--pEntry->refCount > 0)
+		return;
+
+	for (const std::string& pathKey : pEntry->vecPathKeys)
+		m_mapPathKeys.erase(pathKey);
+
+	if (!pEntry->contentKey.empty())
+		m_mapContentKeys.erase(pEntry->contentKey);
+
+	if (pEntry->residencyID != INVALID_RESIDENCY_ID)
+		m_Residency.UnregisterTexture(pEntry->residencyID);
+
+	pTexture->Cleanup(pDevice);
+	SAFE_DELETE(pTexture);
+	SAFE_DELETE(pEntry);
+
+	m_mapEntries.erase(iter);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCache::Cleanup(VulkanDevice* pDevice)
+{
+	if (!m_mapEntries.empty())
+	{
+		LOG_WARNING("{0} textures still referenced at shutdown, destroying them", m_mapEntries.size());
+	}
+
+	ReleaseRetiredImages(pDevice, true);
+
+	for (auto& entry : m_mapEntries)
+	{
+		if (entry.second->residencyID != INVALID_RESIDENCY_ID)
+			m_Residency.UnregisterTexture(entry.second->residencyID);
+
+		entry.second->pTexture->Cleanup(pDevice);
+		SAFE_DELETE(entry.second->pTexture);
+		SAFE_DELETE(entry.second);
+	}
+
+	m_mapEntries.clear();
+	m_mapPathKeys.clear();
+	m_mapContentKeys.clear();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCache::ResetStats()
+{
+	m_Stats = {};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCache::LogStats(const std::string& label) const
+{
+	const uint32_t hits = m_Stats.pathHits + m_Stats.contentHits;
+	const float hitRate = m_Stats.requests > 0 ? 100.0f * hits / m_Stats.requests : 0.0f;
+
+	LOG_INFO("{0} textures: {1} requests, {2} loads, {3} hits ({4} by content), {5:.1f}% hit rate", label, m_Stats.requests,
+			 m_Stats.loads, hits, m_Stats.contentHits, hitRate);
+	LOG_INFO("{0} textures: {1} KB loaded in {2:.1f} ms, {3} KB & {4:.1f} ms saved", label, m_Stats.loadedBytes / 1024, m_Stats.loadMs,
+			 m_Stats.savedBytes / 1024, m_Stats.savedMs);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+uint64_t VulkanTextureCache::GetResidentBytes() const
+{
+	uint64_t bytes = 0;
+	for (const auto& entry : m_mapEntries)
+		bytes += entry.first->GetResidentByteSize();
+
+	return bytes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+void VulkanTextureCache::RequestMip(VulkanTexture2D* pTexture, float screenExtent)
+{
+	std::map<VulkanTexture2D*, Entry*>::iterator iter = m_mapEntries.find(pTexture);
+	if (iter == m_mapEntries.end() || iter->second->residencyID == INVALID_RESIDENCY_ID)
+		return;
+
+	const uint32_t mip = Texture::ComputeDesiredMip(pTexture->GetWidth(), pTexture->GetHeight(), screenExtent);
+	m_Residency.RequestMip(iter->second->residencyID, mip);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Loads & evictions of one texture in a frame collapse into a single swap to the level the policy ended on, every
+//--- swap of the frame goes up in one uploader batch submitted before the frame samples the new views.
+void VulkanTextureCache::UpdateResidency(VulkanDevice* pDevice)
+{
+	ReleaseRetiredImages(pDevice, false);
+
+	m_Residency.Update(m_vecResidencyCommands);
+	if (m_vecResidencyCommands.empty())
+		return;
+
+	std::set<uint32_t> setChanged;
+	for (const Texture::ResidencyCommand& command : m_vecResidencyCommands)
+		setChanged.insert(command.textureID);
+
+	VulkanMaterialTable& materialTable = VulkanMaterialTable::getInstance();
+	std::vector<VulkanTexture2D*> vecSwapped;
+
+	for (auto& entry : m_mapEntries)
+	{
+		const uint32_t residencyID = entry.second->residencyID;
+		if (residencyID == INVALID_RESIDENCY_ID || setChanged.count(residencyID) == 0)
+			continue;
+
+		// The tail stays even when the policy hasn't got to it yet, shaders always need something to sample
+		const uint32_t residentMip = std::min(m_Residency.GetResidentMip(residencyID), m_Residency.GetTailMip(residencyID));
+
+		RetiredImage retired;
+		if (!entry.first->SetResidentMip(pDevice, residentMip, retired.image))
+			continue;
+
+		retired.textureSlot = materialTable.RefreshTexture(pDevice, entry.first);
+		retired.frame = m_Residency.GetFrame();
+		m_vecRetired.push_back(retired);
+
+		vecSwapped.push_back(entry.first);
+	}
+
+	if (vecSwapped.empty())
+		return;
+
+	const UploadToken token = pDevice->m_pUploader->Submit();
+	for (VulkanTexture2D* pTexture : vecSwapped)
+		pTexture->m_uiUploadToken = token;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Frames recorded before a swap still sample the old image through the old slot, MAX_FRAME_DRAWS frames later none
+//--- of them can be in flight anymore
+void VulkanTextureCache::ReleaseRetiredImages(VulkanDevice* pDevice, bool bAll)
+{
+	VulkanMaterialTable& materialTable = VulkanMaterialTable::getInstance();
+
+	std::vector<RetiredImage>::iterator iter = m_vecRetired.begin();
+	while (iter != m_vecRetired.end())
+	{
+		const bool bDone = bAll || (m_Residency.GetFrame() > iter->frame + App::MAX_FRAME_DRAWS &&
+									pDevice->m_pUploader->IsComplete(iter->image.uploadToken));
+		if (!bDone)
+		{
+			++iter;
+			continue;
+		}
+
+		VulkanTexture2D::DestroyRetiredImage(pDevice, iter->image);
+		if (iter->textureSlot != INVALID_BINDLESS_INDEX)
+			materialTable.FreeRetiredSlot(iter->textureSlot);
+
+		iter = m_vecRetired.erase(iter);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanTexture2D* VulkanTextureCache::AddReference(Entry* pEntry, const std::string& pathKey, bool bContentHit)
+{
+	++pEntry->refCount;
+	m_Stats.savedBytes += pEntry->pTexture->m_vkImageByteSize;
+	m_Stats.savedMs += pEntry->loadMs;
+
+	if (!bContentHit)
+	{
+		++m_Stats.pathHits;
+		return pEntry->pTexture;
+	}
+
+	++m_Stats.contentHits;
+	if (m_mapPathKeys.emplace(pathKey, pEntry).second)
+		pEntry->vecPathKeys.push_back(pathKey);
+
+	LOG_DEBUG("{0} has the same contents as a resident texture, sharing it", pathKey.substr(0, pathKey.find('|')));
+	return pEntry->pTexture;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+std::string VulkanTextureCache::MakeParameterKey(TextureType eType, MipGeneration eMipGeneration) const
+{
+	return "|" + std::to_string(static_cast<int>(eType)) + "|" + std::to_string(static_cast<int>(eMipGeneration));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Empty when the file can't be read
+std::string VulkanTextureCache::MakeContentKey(const TextureRequest& request) const
+{
+	const std::string directory = request.eType == TextureType::TEXTURE_HDRI ? "Assets/Textures/HDRI/" : "Assets/Textures/";
+	const uint64_t contentHash = HashFile(directory + request.fileName);
+	if (contentHash == 0)
+		return std::string();
+
+	char hashString[17];
+	snprintf(hashString, sizeof(hashString), "%016llx", static_cast<unsigned long long>(contentHash));
+	return hashString + MakeParameterKey(request.eType, request.eMipGeneration);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- 64 bit FNV-1a over the file, 0 when it can't be read
+uint64_t VulkanTextureCache::HashFile(const std::string& filePath) const
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+		return 0;
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	std::vector<char> vecChunk(64 * 1024);
+
+	while (file)
+	{
+		file.read(vecChunk.data(), vecChunk.size());
+		const std::streamsize count = file.gcount();
+
+		for (std::streamsize i = 0; i < count; ++i)
+		{
+			hash ^= static_cast<uint8_t>(vecChunk[i]);
+			hash *= 0x100000001b3ull;
+		}
+	}
+
+	return hash;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "VulkanTexture2D.h"
+#include "Engine/Texture/TextureResidency.h"
+
+class VulkanDevice;
+
+//---------------------------------------------------------------------------------------------------------------------
+struct TextureRequest
+{
+	std::string							fileName;
+	TextureType							eType;
+	MipGeneration						eMipGeneration = MipGeneration::GPU_BLIT;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct TextureCacheStats
+{
+	uint32_t							requests;
+	uint32_t							pathHits;				// Same file & load parameters as a resident texture
+	uint32_t							contentHits;			// Different file name, identical bytes & load parameters
+	uint32_t							loads;
+	uint64_t							loadedBytes;			// Image memory of every texture actually created
+	uint64_t							savedBytes;				// Image memory hits would have duplicated
+	float								loadMs;
+	float								savedMs;				// Load time of the textures hits would have reloaded
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Shares VulkanTexture2D instances (image, view & sampler) between everything that loads the same texture. Entries
+//--- are found by normalized path & load parameters first, then by a hash of the file contents, so copies of a file
+//--- under another name are uploaded once too. Entries are ref counted & destroyed on the last Release. Misses of a batch
+//--- are loaded together through VulkanTextureLoader.
+class VulkanTextureCache
+{
+public:
+	static VulkanTextureCache& getInstance()
+	{
+		static VulkanTextureCache instance;
+		return instance;
+	}
+
+	~VulkanTextureCache();
+
+	VulkanTexture2D*					Acquire(VulkanDevice* pDevice, const std::string& fileName, TextureType eType,
+												MipGeneration eMipGeneration = MipGeneration::GPU_BLIT);
+	std::vector<VulkanTexture2D*>		AcquireBatch(VulkanDevice* pDevice, const std::vector<TextureRequest>& vecRequests);
+	void								Release(VulkanDevice* pDevice, VulkanTexture2D* pTexture);
+
+	// Destroys whatever is still resident, call once the device is idle
+	void								Cleanup(VulkanDevice* pDevice);
+
+	// Stats are per scene, reset before loading one & log once it's loaded
+	void								ResetStats();
+	void								LogStats(const std::string& label) const;
+
+	inline const TextureCacheStats&		GetStats() const { return m_Stats; }
+	inline uint32_t						GetResidentCount() const { return static_cast<uint32_t>(m_mapEntries.size()); }
+	uint64_t							GetResidentBytes() const;
+
+	// Mip residency of every streamable texture against Texture::ResidencySettings::budgetBytes. Renderers request the
+	// screen space size textures are drawn at, UpdateResidency runs the policy once per frame & swaps each texture whose
+	// resident level changed for an image holding just those levels, moving it to a fresh slot of VulkanMaterialTable.
+	// Replaced images & slots are freed once the frames in flight that may sample them are done. Textures with blit
+	// generated mips can't upload their finer levels again & always stay whole.
+	void								RequestMip(VulkanTexture2D* pTexture, float screenExtent);
+	void								UpdateResidency(VulkanDevice* pDevice);
+	inline Texture::ResidencyManager&	GetResidency() { return m_Residency; }
+	inline uint32_t						GetLastResidencyCommandCount() const { return static_cast<uint32_t>(m_vecResidencyCommands.size()); }
+
+private:
+	VulkanTextureCache();
+	VulkanTextureCache(const VulkanTextureCache&);
+	void operator=(const VulkanTextureCache&);
+
+	struct Entry
+	{
+		VulkanTexture2D*				pTexture;
+		uint32_t						refCount;
+		float							loadMs;
+		std::string						contentKey;				// Empty when the file couldn't be hashed
+		std::vector<std::string>		vecPathKeys;			// Every path key that resolved to this entry
+		uint32_t						residencyID;			// INVALID_RESIDENCY_ID when the texture isn't streamed
+	};
+
+	struct RetiredImage
+	{
+		RetiredTextureImage				image;
+		uint32_t						textureSlot;			// Material table slot of the old view, INVALID_BINDLESS_INDEX when none
+		uint64_t						frame;					// Residency frame of the swap
+	};
+
+	VulkanTexture2D*					AddReference(Entry* pEntry, const std::string& pathKey, bool bContentHit);
+	std::string							MakeParameterKey(TextureType eType, MipGeneration eMipGeneration) const;
+	std::string							MakeContentKey(const TextureRequest& request) const;
+	uint64_t							HashFile(const std::string& filePath) const;
+	void								ReleaseRetiredImages(VulkanDevice* pDevice, bool bAll);
+
+private:
+	std::map<VulkanTexture2D*, Entry*>	m_mapEntries;
+	std::map<std::string, Entry*>		m_mapPathKeys;
+	std::map<std::string, Entry*>		m_mapContentKeys;
+
+	TextureCacheStats					m_Stats;
+
+	Texture::ResidencyManager			m_Residency;
+	std::vector<Texture::ResidencyCommand>	m_vecResidencyCommands;
+	std::vector<RetiredImage>			m_vecRetired;
+};
@@ -0,0 +1,342 @@
+#include "PlaygroundPCH.h"
+#include "VulkanTextureLoader.h"
+
+#include <chrono>
+
+#include "Engine/Renderer/VulkanDevice.h"
+#include "Engine/Renderer/VulkanTextureCUBE.h"
+#include "Engine/Helpers/JobSystem.h"
+#include "Engine/Helpers/Utility.h"
+#include "PlaygroundHeaders.h"
+
+// Keeps every upload aligned for the texel block size & optimalBufferCopyOffsetAlignment on common hardware
+const VkDeviceSize	RING_ALIGNMENT			= 16;
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanTextureLoader::VulkanTextureLoader()
+{
+	m_LastBatchStats = {};
+	m_LastCubemapStats = {};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+VulkanTextureLoader::~VulkanTextureLoader()
+{
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+UploadToken VulkanTextureLoader::LoadBatch(VulkanDevice* pDevice, const std::vector<TextureLoadRequest>& vecRequests)
+{
+	if (vecRequests.empty())
+		return UPLOAD_TOKEN_NONE;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	const uint32_t count = static_cast<uint32_t>(vecRequests.size());
+
+	m_LastBatchStats = {};
+	m_LastBatchStats.textureCount = count;
+	m_LastBatchStats.threadCount = std::min(count, JobSystem::getInstance().GetThreadCount());
+
+	//--- Decode, one texture per job since sizes vary a lot
+	std::vector<TextureUploadData> vecUploads(count);
+	JobSystem::getInstance().ParallelFor(count, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const TextureLoadRequest& request = vecRequests[i];
+			request.pTexture->LoadTextureData(pDevice, request.fileName, request.eType, request.eMipGeneration, vecUploads[i]);
+		}
+	});
+
+	const auto decodeEnd = std::chrono::high_resolution_clock::now();
+	m_LastBatchStats.decodeMs = std::chrono::duration<float, std::milli>(decodeEnd - start).count();
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		vecRequests[i].pTexture->CreateImageResources(pDevice, vecUploads[i]);
+
+		m_LastBatchStats.uploadBytes += vecUploads[i].byteSize;
+		m_LastBatchStats.decodeCpuMs += vecUploads[i].decodeMs;
+	}
+
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	const uint32_t submitsBefore = pUploader->GetStats().submitCount;
+
+	//--- Upload, as many textures as the ring has room for per pass
+	std::vector<StagingAllocation> vecStaging(count);
+
+	uint32_t first = 0;
+	while (first < count)
+	{
+		// The first one may submit the previous passes to make room or get a staging buffer of its own, the rest only
+		// take what's free so the staged data of this pass stays in one batch
+		vecStaging[first] = pUploader->Stage(vecUploads[first].byteSize, RING_ALIGNMENT);
+
+		uint32_t last = first + 1;
+		while (last < count && pUploader->TryStage(vecUploads[last].byteSize, RING_ALIGNMENT, vecStaging[last]))
+			++last;
+
+		// Copies into staging are plain memcpys or file reads, spread them too
+		JobSystem::getInstance().ParallelFor(last - first, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = first + begin; i < first + end; ++i)
+			{
+				if (vecStaging[i].pData == nullptr || !vecUploads[i].CopyTo(vecStaging[i].pData))
+				{
+					LOG_ERROR("Failed to read {0} into staging", vecRequests[i].fileName);
+				}
+			}
+		});
+
+		VkCommandBuffer commandBuffer = pUploader->GetCommandBuffer();
+		for (uint32_t i = first; i < last; ++i)
+		{
+			if (vecStaging[i].pData != nullptr)
+				vecRequests[i].pTexture->RecordUpload(pDevice, commandBuffer, vecUploads[i], vecStaging[i].buffer, vecStaging[i].offset);
+		}
+
+		first = last;
+	}
+
+	const UploadToken token = pUploader->Submit();
+	m_LastBatchStats.submitCount = pUploader->GetStats().submitCount - submitsBefore;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const TextureLoadRequest& request = vecRequests[i];
+		request.pTexture->FinalizeTexture(pDevice);
+		request.pTexture->m_uiUploadToken = token;
+
+		if (request.bKeepLevels)
+			request.pTexture->SetStreamSource(std::move(vecUploads[i]));
+	}
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	m_LastBatchStats.uploadMs = std::chrono::duration<float, std::milli>(end - decodeEnd).count();
+	m_LastBatchStats.totalMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+	LOG_DEBUG("Loaded {0} textures ({1} KB) in {2:.1f} ms: decode {3:.1f} ms on {4} threads ({5:.1f} ms serial), upload {6:.1f} ms in {7} submits",
+			  count, m_LastBatchStats.uploadBytes / 1024, m_LastBatchStats.totalMs, m_LastBatchStats.decodeMs, m_LastBatchStats.threadCount,
+			  m_LastBatchStats.decodeCpuMs, m_LastBatchStats.uploadMs, m_LastBatchStats.submitCount);
+
+	return token;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+UploadToken VulkanTextureLoader::LoadCubemapBatch(VulkanDevice* pDevice, const std::vector<CubemapLoadRequest>& vecRequests)
+{
+	if (vecRequests.empty())
+		return UPLOAD_TOKEN_NONE;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_LastCubemapStats = {};
+
+	//--- Face headers only, so staging can be claimed before anything gets decoded
+	std::vector<CubemapUploadData> vecUploads(vecRequests.size());
+	std::vector<uint32_t> vecValid;
+
+	for (uint32_t i = 0; i < vecRequests.size(); ++i)
+	{
+		if (!VulkanTextureCUBE::PrepareFaceUpload(vecRequests[i].directory, vecRequests[i].bGenerateMips, vecUploads[i]))
+			continue;
+
+		vecValid.push_back(i);
+		m_LastCubemapStats.uploadBytes += vecUploads[i].byteSize;
+	}
+
+	const uint32_t count = static_cast<uint32_t>(vecValid.size());
+	m_LastCubemapStats.textureCount = count * 6;
+	m_LastCubemapStats.threadCount = std::min(count * 6, JobSystem::getInstance().GetThreadCount());
+
+	if (count == 0)
+		return UPLOAD_TOKEN_NONE;
+
+	VulkanStagingUploader* pUploader = pDevice->m_pUploader;
+	const uint32_t submitsBefore = pUploader->GetStats().submitCount;
+
+	std::vector<float> vecFaceDecodeMs(count * 6, 0.0f);
+	std::vector<StagingAllocation> vecStaging(count);
+
+	//--- As many cubes as the ring has room for per pass, every face of them decodes on its own job
+	uint32_t first = 0;
+	while (first < count)
+	{
+		// Same as LoadBatch, only the first cube of a pass may submit or get a staging buffer of its own
+		vecStaging[first] = pUploader->Stage(vecUploads[vecValid[first]].byteSize, RING_ALIGNMENT);
+
+		uint32_t last = first + 1;
+		while (last < count && pUploader->TryStage(vecUploads[vecValid[last]].byteSize, RING_ALIGNMENT, vecStaging[last]))
+			++last;
+
+		const auto decodeStart = std::chrono::high_resolution_clock::now();
+
+		JobSystem::getInstance().ParallelFor((last - first) * 6, 1, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t job = begin; job < end; ++job)
+			{
+				const uint32_t cube = first + job / 6;
+				const uint32_t face = job % 6;
+
+				if (vecStaging[cube].pData != nullptr)
+					VulkanTextureCUBE::DecodeFace(vecUploads[vecValid[cube]], face, vecStaging[cube].pData, &vecFaceDecodeMs[cube * 6 + face]);
+			}
+		});
+
+		const auto decodeEnd = std::chrono::high_resolution_clock::now();
+		m_LastCubemapStats.decodeMs += std::chrono::duration<float, std::milli>(decodeEnd - decodeStart).count();
+
+		VkCommandBuffer commandBuffer = pUploader->GetCommandBuffer();
+		for (uint32_t i = first; i < last; ++i)
+		{
+			const CubemapLoadRequest& request = vecRequests[vecValid[i]];
+
+			request.pCube->CreateImageResources(pDevice, vecUploads[vecValid[i]]);
+			if (vecStaging[i].pData != nullptr)
+				request.pCube->RecordUpload(pDevice, commandBuffer, vecUploads[vecValid[i]], vecStaging[i].buffer, vecStaging[i].offset);
+		}
+
+		m_LastCubemapStats.uploadMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - decodeEnd).count();
+
+		first = last;
+	}
+
+	const UploadToken token = pUploader->Submit();
+	m_LastCubemapStats.submitCount = pUploader->GetStats().submitCount - submitsBefore;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		vecRequests[vecValid[i]].pCube->FinalizeTexture(pDevice, vecUploads[vecValid[i]]);
+		vecRequests[vecValid[i]].pCube->m_uiUploadToken = token;
+	}
+
+	for (float faceMs : vecFaceDecodeMs)
+		m_LastCubemapStats.decodeCpuMs += faceMs;
+
+	m_LastCubemapStats.totalMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	LOG_DEBUG("Loaded {0} cubemaps ({1} KB) in {2:.1f} ms: decode {3:.1f} ms on {4} threads ({5:.1f} ms serial), upload {6:.1f} ms in {7} submits",
+			  count, m_LastCubemapStats.uploadBytes / 1024, m_LastCubemapStats.totalMs, m_LastCubemapStats.decodeMs, m_LastCubemapStats.threadCount,
+			  m_LastCubemapStats.decodeCpuMs, m_LastCubemapStats.uploadMs, m_LastCubemapStats.submitCount);
+
+	return token;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Faces are smooth gradients with a per face tint & a checker, close enough to photographed skies for jpg decode cost
+std::vector<CubemapBenchmarkResult> VulkanTextureLoader::RunCubemapBenchmark(VulkanDevice* pDevice)
+{
+	std::vector<CubemapBenchmarkResult> vecResults;
+
+	const std::filesystem::path benchmarkDirectory = std::filesystem::temp_directory_path() / "PlaygroundCubemapBenchmark";
+	const uint32_t arrDimensions[3] = { 1024, 2048, 4096 };
+	const char* arrFaceNames[6] = { "posx.jpg", "negx.jpg", "posy.jpg", "negy.jpg", "posz.jpg", "negz.jpg" };
+
+	std::vector<std::string> vecDirectories;
+	for (uint32_t dimension : arrDimensions)
+	{
+		const std::filesystem::path directory = benchmarkDirectory / std::to_string(dimension);
+		std::filesystem::create_directories(directory);
+		vecDirectories.push_back(directory.string());
+
+		JobSystem::getInstance().ParallelFor(6, 1, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<uint8_t> vecPixels(static_cast<size_t>(dimension) * dimension * 4);
+			for (uint32_t face = begin; face < end; ++face)
+			{
+				const std::string fileName = (directory / arrFaceNames[face]).string();
+				if (std::filesystem::exists(fileName))
+					continue;
+
+				for (uint32_t y = 0; y < dimension; ++y)
+				{
+					for (uint32_t x = 0; x < dimension; ++x)
+					{
+						const bool bChecker = ((x / 64) + (y / 64)) % 2 == 0;
+						uint8_t* pTexel = &vecPixels[(static_cast<size_t>(y) * dimension + x) * 4];
+						pTexel[0] = static_cast<uint8_t>((x * 255) / dimension);
+						pTexel[1] = static_cast<uint8_t>((y * 255) / dimension);
+						pTexel[2] = static_cast<uint8_t>(face * 40 + (bChecker ? 30 : 0));
+						pTexel[3] = 255;
+					}
+				}
+
+				stbi_write_jpg(fileName.c_str(), dimension, dimension, 4, vecPixels.data(), 90);
+			}
+		});
+	}
+
+	//--- Each size alone, with & without mips
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		for (uint32_t mips = 0; mips < 2; ++mips)
+		{
+			VulkanTextureCUBE cube;
+
+			CubemapLoadRequest request;
+			request.pCube = &cube;
+			request.directory = vecDirectories[i];
+			request.bGenerateMips = mips == 1;
+
+			const UploadToken token = LoadCubemapBatch(pDevice, { request });
+
+			CubemapBenchmarkResult result;
+			result.dimension = arrDimensions[i];
+			result.cubeCount = 1;
+			result.bMips = request.bGenerateMips;
+			result.stats = m_LastCubemapStats;
+
+			const float waitMs = WaitForUpload(pDevice, token);
+			result.stats.uploadMs += waitMs;
+			result.stats.totalMs += waitMs;
+			vecResults.push_back(result);
+
+			cube.Cleanup(pDevice);
+		}
+	}
+
+	//--- Every size in one batch
+	std::array<VulkanTextureCUBE, 3> arrCubes;
+	std::vector<CubemapLoadRequest> vecRequests(3);
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		vecRequests[i].pCube = &arrCubes[i];
+		vecRequests[i].directory = vecDirectories[i];
+		vecRequests[i].bGenerateMips = true;
+	}
+
+	const UploadToken batchToken = LoadCubemapBatch(pDevice, vecRequests);
+
+	CubemapBenchmarkResult batchResult;
+	batchResult.dimension = 0;
+	batchResult.cubeCount = 3;
+	batchResult.bMips = true;
+	batchResult.stats = m_LastCubemapStats;
+
+	const float batchWaitMs = WaitForUpload(pDevice, batchToken);
+	batchResult.stats.uploadMs += batchWaitMs;
+	batchResult.stats.totalMs += batchWaitMs;
+	vecResults.push_back(batchResult);
+
+	for (VulkanTextureCUBE& cube : arrCubes)
+		cube.Cleanup(pDevice);
+
+	for (const CubemapBenchmarkResult& result : vecResults)
+	{
+		LOG_INFO("Cubemap {0} x{1} {2}: {3:.1f} ms, decode {4:.1f} ms ({5:.1f} ms serial), upload {6:.1f} ms, {7} MB",
+				 result.dimension, result.cubeCount, result.bMips ? "mips" : "no mips", result.stats.totalMs, result.stats.decodeMs,
+				 result.stats.decodeCpuMs, result.stats.uploadMs, result.stats.uploadBytes / (1024 * 1024));
+	}
+
+	return vecResults;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+float VulkanTextureLoader::WaitForUpload(VulkanDevice* pDevice, UploadToken token)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	pDevice->m_pUploader->Wait(token);
+
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
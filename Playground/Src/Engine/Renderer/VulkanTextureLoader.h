@@ -0,0 +1,93 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include "VulkanTexture2D.h"
+#include "VulkanStagingUploader.h"
+
+class VulkanDevice;
+class VulkanTextureCUBE;
+
+//---------------------------------------------------------------------------------------------------------------------
+struct TextureLoadRequest
+{
+	VulkanTexture2D*					pTexture;
+	std::string							fileName;
+	TextureType							eType;
+	MipGeneration						eMipGeneration;
+	bool								bKeepLevels = false;		// Hand the levels to the texture for streaming
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct CubemapLoadRequest
+{
+	VulkanTextureCUBE*					pCube;
+	std::string							directory;				// Holds posx.jpg, negx.jpg ... negz.jpg
+	bool								bGenerateMips;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct TextureLoadStats
+{
+	uint32_t							textureCount;
+	uint32_t							threadCount;
+	uint32_t							submitCount;			// Uploader submits, a single one unless the batch outgrows the ring
+	uint64_t							uploadBytes;
+	float								decodeMs;				// Wall time of the parallel decode
+	float								decodeCpuMs;			// Sum of every texture's decode, what a serial load would take
+	float								uploadMs;				// Staging copies, recording & waits for ring space, not the GPU copy
+	float								totalMs;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+struct CubemapBenchmarkResult
+{
+	uint32_t							dimension;				// Face size, 0 for the batch of every size
+	uint32_t							cubeCount;
+	bool								bMips;
+	TextureLoadStats					stats;					// textureCount counts faces, decodeCpuMs is the one by one decode,
+																// uploadMs & totalMs include waiting for the upload
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+//--- Loads batches of textures in three stages. Files get decoded (or their compiled headers read) across the JobSystem,
+//--- the results are copied into the device's staging ring & every copy, blit & layout transition of the batch is
+//--- recorded into the uploader's open batch, instead of a staging buffer, queue submit & vkQueueWaitIdle per transition
+//--- for each texture. Loads return once everything is submitted, the returned token (also kept by every texture)
+//--- completes when the images hold their data.
+class VulkanTextureLoader
+{
+public:
+	static VulkanTextureLoader& getInstance()
+	{
+		static VulkanTextureLoader instance;
+		return instance;
+	}
+
+	~VulkanTextureLoader();
+
+	// Every texture has its view & sampler on return, the copies are submitted but may still run. HDRIs aren't supported,
+	// they use CreateTextureHDRI.
+	UploadToken							LoadBatch(VulkanDevice* pDevice, const std::vector<TextureLoadRequest>& vecRequests);
+
+	// Every face of every cube decodes in parallel straight into staging, cubes bigger than the ring get a staging buffer
+	// of their own
+	UploadToken							LoadCubemapBatch(VulkanDevice* pDevice, const std::vector<CubemapLoadRequest>& vecRequests);
+
+	// Synthetic 1k, 2k & 4k cubes written as jpg faces into the temp directory, loaded with & without mips & all at once
+	std::vector<CubemapBenchmarkResult>	RunCubemapBenchmark(VulkanDevice* pDevice);
+
+	inline const TextureLoadStats&		GetLastBatchStats() const { return m_LastBatchStats; }
+	inline const TextureLoadStats&		GetLastCubemapStats() const { return m_LastCubemapStats; }
+
+private:
+	VulkanTextureLoader();
+	VulkanTextureLoader(const VulkanTextureLoader&);
+	void operator=(const VulkanTextureLoader&);
+
+	// Benchmark results include the GPU side of the upload, returns the ms waited
+	float								WaitForUpload(VulkanDevice* pDevice, UploadToken token);
+
+private:
+	TextureLoadStats					m_LastBatchStats;
+	TextureLoadStats					m_LastCubemapStats;
+};
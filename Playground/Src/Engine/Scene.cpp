@@ -6,32 +6,40 @@
 #include "Renderer/VulkanDevice.h"
 #include "Renderer/VulkanSwapChain.h"
 #include "Renderer/VulkanGraphicsPipeline.h"
+#include "Renderer/VulkanTextureCache.h"
 
 #include "Engine/RenderObjects/TriangleMesh.h"
 #include "Engine/RenderObjects/RTXCube.h"
+#include "Engine/Raytracer/SceneBVH.h"
 
 
 //---------------------------------------------------------------------------------------------------------------------
 Scene::Scene()
 {
 	m_vecSceneObjects.clear();
+	m_pSceneBVH = new Raytracer::SceneBVH();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 Scene::~Scene()
 {
 	m_vecSceneObjects.clear();
+	SAFE_DELETE(m_pSceneBVH);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 void Scene::LoadScene(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 {
 	// Load all 3D models...
+	VulkanTextureCache::getInstance().ResetStats();
 	LoadModels(pDevice, pSwapchain);
+	VulkanTextureCache::getInstance().LogStats("Scene");
 
 	// Set light properties
 	m_LightAngleEuler = glm::vec3(-90,80,40);
 	m_LightIntensity = 1.0f;
+
+	m_pSceneBVH->Update(m_vecSceneObjects);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -48,7 +56,8 @@ void Scene::LoadModels(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain)
 	pMeshBarb->SetPosition(glm::vec3(0, -0.5f, 0));
 	pMeshBarb->SetScale(glm::vec3(1.0f));
 
-	TriangleMesh* pMeshPlane = new TriangleMesh("Assets/Models/Plane_Oak.fbx");
+	// Ground plane is trivial, cheap linear BVH build is good enough
+	TriangleMesh* pMeshPlane = new TriangleMesh("Assets/Models/Plane_Oak.fbx", Raytracer::BVHBuildMode::LBVH);
 	pMeshPlane->Initialize(pDevice);
 	pMeshPlane->SetPosition(glm::vec3(0, -1, 0));
 	pMeshPlane->SetScale(glm::vec3(1.0f));
@@ -76,6 +85,24 @@ void Scene::Update(VulkanDevice* pDevice, VulkanSwapChain* pSwapchain, float dt)
 			object->Update(dt);
 		}
 	}
+
+	// Refits the top level for anything that moved
+	m_pSceneBVH->Update(m_vecSceneObjects);
+
+	// Residency policy over whatever mips were requested this frame, streams the textures whose levels changed
+	VulkanTextureCache::getInstance().UpdateResidency(pDevice);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+Raytracer::RayHit Scene::RaycastClosest(const glm::vec3& origin, const glm::vec3& direction) const
+{
+	return m_pSceneBVH->RaycastClosest(origin, direction);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+bool Scene::RaycastClosest(Raytracer::Ray& ray, Raytracer::RayHit& hit) const
+{
+	return m_pSceneBVH->RaycastClosest(ray, hit);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -2,11 +2,18 @@
 
 #include "glm/glm.hpp"
 
+#include "Engine/Raytracer/BVH.h"
+
 class VulkanDevice;
 class VulkanSwapChain;
 class VulkanGraphicsPipeline;
 class SceneObject;
 
+namespace Raytracer
+{
+	class SceneBVH;
+}
+
 class Scene
 {
 public:
@@ -20,6 +27,10 @@ public:
 	void								UpdateUniforms(VulkanDevice* pDevice, uint32_t imageIndex);
 	void								RenderOpaque(VulkanDevice* pDevice, VulkanGraphicsPipeline* pPipline, uint32_t imageIndex);
 
+	// Synchronous CPU ray query, no GPU involvement. objectIndex indexes m_vecSceneObjects.
+	Raytracer::RayHit					RaycastClosest(const glm::vec3& origin, const glm::vec3& direction) const;
+	bool								RaycastClosest(Raytracer::Ray& ray, Raytracer::RayHit& hit) const;
+
 public:
 	glm::vec3							m_LightDirection;
 	float								m_LightIntensity;
@@ -30,5 +41,6 @@ private:
 public:								
 	glm::vec3							m_LightAngleEuler;
 	std::vector<SceneObject*>			m_vecSceneObjects;
+	Raytracer::SceneBVH*				m_pSceneBVH;
 };
 
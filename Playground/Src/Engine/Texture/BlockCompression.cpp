@@ -0,0 +1,1791 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "BlockCompression.h"
+
+#include <cfloat>
+
+#include "glm/glm.hpp"
+
+#include "Engine/Helpers/JobSystem.h"
+#include "HDRConverter.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BC7 tables, straight from the format specification. Partition masks have bit i set when texel i belongs to
+	//--- subset 1, anchors are the texels whose index drops its top bit.
+	const uint16_t	BC7_PARTITIONS_2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	const uint8_t	BC7_ANCHORS_2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+		15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+		 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+	};
+
+	const uint32_t	BC7_WEIGHTS_2[4]	= { 0, 21, 43, 64 };
+	const uint32_t	BC7_WEIGHTS_3[8]	= { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const uint32_t	BC7_WEIGHTS_4[16]	= { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	const uint32_t	BC7_PARTITION_CANDIDATES	= 4;		// Partitions fully encoded after the estimate, QUALITY only
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class PBitMode
+	{
+		NONE,
+		SHARED,						// One p-bit per subset
+		UNIQUE						// One p-bit per endpoint
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct BC7Mode
+	{
+		uint32_t	mode;
+		uint32_t	subsets;
+		uint32_t	partitionBits;
+		uint32_t	rotationBits;
+		uint32_t	colorBits;
+		uint32_t	alphaBits;				// 0 when alpha is fixed at 255
+		PBitMode	ePBits;
+		uint32_t	indexBits;
+		uint32_t	alphaIndexBits;			// 0 when alpha shares the color indices
+	};
+
+	const BC7Mode	BC7_MODE_1 = { 1, 2, 6, 0, 6, 0, PBitMode::SHARED, 3, 0 };
+	const BC7Mode	BC7_MODE_5 = { 5, 1, 0, 2, 7, 8, PBitMode::NONE, 2, 2 };
+	const BC7Mode	BC7_MODE_6 = { 6, 1, 0, 0, 7, 7, PBitMode::UNIQUE, 4, 0 };
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Little endian bit stream over a zeroed block
+	class BlockBitWriter
+	{
+	public:
+		BlockBitWriter(uint8_t* pBlock, uint32_t byteSize) : m_pBlock(pBlock), m_uiBit(0) { memset(pBlock, 0, byteSize); }
+
+		void Write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; ++i, ++m_uiBit)
+			{
+				if ((value >> i) & 1)
+					m_pBlock[m_uiBit >> 3] |= static_cast<uint8_t>(1 << (m_uiBit & 7));
+			}
+		}
+
+	private:
+		uint8_t*	m_pBlock;
+		uint32_t	m_uiBit;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	class BlockBitReader
+	{
+	public:
+		BlockBitReader(const uint8_t* pBlock) : m_pBlock(pBlock), m_uiBit(0) {}
+
+		uint32_t Read(uint32_t bitCount)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bitCount; ++i, ++m_uiBit)
+				value |= ((m_pBlock[m_uiBit >> 3] >> (m_uiBit & 7)) & 1) << i;
+
+			return value;
+		}
+
+	private:
+		const uint8_t*	m_pBlock;
+		uint32_t		m_uiBit;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t Interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+	{
+		return (e0 * (64 - weight) + e1 * weight + 32) >> 6;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline const uint32_t* GetWeights(uint32_t indexBits)
+	{
+		return indexBits == 2 ? BC7_WEIGHTS_2 : (indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Bit replication from an n bit value to 8 bits
+	inline uint32_t ExpandBits(uint32_t value, uint32_t bits)
+	{
+		return bits >= 8 ? value : (value << (8 - bits)) | (value >> (2 * bits - 8));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t GetPartitionSubset(uint32_t partition, uint32_t texel, uint32_t subsets)
+	{
+		return subsets == 1 ? 0 : (BC7_PARTITIONS_2[partition] >> texel) & 1;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline bool IsAnchor(uint32_t partition, uint32_t texel, uint32_t subsets)
+	{
+		return texel == 0 || (subsets == 2 && texel == BC7_ANCHORS_2[partition]);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	const char* GetTextureFormatName(TextureFormat eFormat)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::BC1:		return "BC1";
+			case TextureFormat::BC4:		return "BC4";
+			case TextureFormat::BC5:		return "BC5";
+			case TextureFormat::BC7:		return "BC7";
+			case TextureFormat::BC6H:		return "BC6H";
+			case TextureFormat::RGBA16F:	return "RGBA16F";
+			case TextureFormat::RGBA32F:	return "RGBA32F";
+			case TextureFormat::E5B9G9R9:	return "E5B9G9R9";
+			default:						return "RGBA8";
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t GetBlockByteSize(TextureFormat eFormat)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::BC1:
+			case TextureFormat::BC4:
+			case TextureFormat::RGBA16F:
+				return 8;
+
+			case TextureFormat::BC5:
+			case TextureFormat::BC7:
+			case TextureFormat::BC6H:
+			case TextureFormat::RGBA32F:
+				return 16;
+
+			default:
+				return 4;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	size_t ComputeLevelByteSize(TextureFormat eFormat, uint32_t width, uint32_t height)
+	{
+		if (!IsBlockCompressed(eFormat))
+			return static_cast<size_t>(width) * height * GetBlockByteSize(eFormat);
+
+		return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockByteSize(eFormat);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Principal axis through the texels over channels [channelBegin, channelEnd), power iteration on the covariance.
+	glm::vec4 ComputePrincipalAxis(const glm::vec4* pTexels, uint32_t count, const glm::vec4& mean, uint32_t channelBegin, uint32_t channelEnd,
+								   float* pOutEigenvalue = nullptr)
+	{
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const glm::vec4 d = pTexels[i] - mean;
+			for (uint32_t a = channelBegin; a < channelEnd; ++a)
+			{
+				for (uint32_t b = a; b < channelEnd; ++b)
+					covariance[a][b] += d[a] * d[b];
+			}
+		}
+
+		for (uint32_t a = channelBegin; a < channelEnd; ++a)
+		{
+			for (uint32_t b = channelBegin; b < a; ++b)
+				covariance[a][b] = covariance[b][a];
+		}
+
+		// Start along the largest variance channel so a single dominant channel converges immediately
+		glm::vec4 axis(0.0f);
+		uint32_t largest = channelBegin;
+		for (uint32_t a = channelBegin; a < channelEnd; ++a)
+		{
+			if (covariance[a][a] > covariance[largest][largest])
+				largest = a;
+		}
+		for (uint32_t a = channelBegin; a < channelEnd; ++a)
+			axis[a] = covariance[largest][a];
+
+		float eigenvalue = 0.0f;
+		for (uint32_t iteration = 0; iteration < 8; ++iteration)
+		{
+			glm::vec4 next(0.0f);
+			for (uint32_t a = channelBegin; a < channelEnd; ++a)
+			{
+				for (uint32_t b = channelBegin; b < channelEnd; ++b)
+					next[a] += covariance[a][b] * axis[b];
+			}
+
+			eigenvalue = glm::length(next);
+			if (eigenvalue <= 1e-8f)
+				break;
+
+			axis = next / eigenvalue;
+		}
+
+		if (pOutEigenvalue)
+			*pOutEigenvalue = eigenvalue * glm::length(axis);
+
+		if (glm::length(axis) <= 1e-8f)
+		{
+			axis = glm::vec4(0.0f);
+			for (uint32_t a = channelBegin; a < channelEnd; ++a)
+				axis[a] = 1.0f;
+		}
+
+		return glm::normalize(axis);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Endpoints at the extremes of the texel projections onto the principal axis
+	void ComputeAxisEndpoints(const glm::vec4* pTexels, uint32_t count, uint32_t channelBegin, uint32_t channelEnd, glm::vec4& e0, glm::vec4& e1,
+							  float maxValue = 255.0f)
+	{
+		glm::vec4 mean(0.0f);
+		for (uint32_t i = 0; i < count; ++i)
+			mean += pTexels[i];
+		mean /= static_cast<float>(count);
+
+		const glm::vec4 axis = ComputePrincipalAxis(pTexels, count, mean, channelBegin, channelEnd);
+
+		float tMin = FLT_MAX;
+		float tMax = -FLT_MAX;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float t = glm::dot(pTexels[i] - mean, axis);
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+
+		e0 = glm::clamp(mean + axis * tMin, 0.0f, maxValue);
+		e1 = glm::clamp(mean + axis * tMax, 0.0f, maxValue);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Least squares endpoints for fixed interpolation weights, one 2x2 solve shared by all channels. Returns false
+	//--- when every texel uses the same weight.
+	bool RefineEndpoints(const glm::vec4* pTexels, const float* pWeights, uint32_t count, glm::vec4& e0, glm::vec4& e1, float maxValue = 255.0f)
+	{
+		float a = 0.0f, b = 0.0f, c = 0.0f;
+		glm::vec4 rhs0(0.0f), rhs1(0.0f);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float w = pWeights[i];
+			const float iw = 1.0f - w;
+			a += iw * iw;
+			b += iw * w;
+			c += w * w;
+			rhs0 += pTexels[i] * iw;
+			rhs1 += pTexels[i] * w;
+		}
+
+		const float det = a * c - b * b;
+		if (std::abs(det) < 1e-6f)
+			return false;
+
+		e0 = glm::clamp((rhs0 * c - rhs1 * b) / det, 0.0f, maxValue);
+		e1 = glm::clamp((rhs1 * a - rhs0 * b) / det, 0.0f, maxValue);
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline void LoadTexels(const uint8_t* pRGBA, glm::vec4* pTexels)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+			pTexels[i] = glm::vec4(pRGBA[i * 4 + 0], pRGBA[i * 4 + 1], pRGBA[i * 4 + 2], pRGBA[i * 4 + 3]);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BC1
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t PackRGB565(const glm::vec4& c)
+	{
+		const uint32_t r = static_cast<uint32_t>(c.x * 31.0f / 255.0f + 0.5f);
+		const uint32_t g = static_cast<uint32_t>(c.y * 63.0f / 255.0f + 0.5f);
+		const uint32_t b = static_cast<uint32_t>(c.z * 31.0f / 255.0f + 0.5f);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline glm::vec4 UnpackRGB565(uint32_t c)
+	{
+		const uint32_t r = (c >> 11) & 31;
+		const uint32_t g = (c >> 5) & 63;
+		const uint32_t b = c & 31;
+		return glm::vec4(static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2)), 255.0f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Four color mode only, so the block never decodes to transparent black. Returns the squared rgb error.
+	float EncodeBC1Endpoints(const glm::vec4* pTexels, const glm::vec4& e0, const glm::vec4& e1, uint8_t* pBlock, uint8_t* pIndices)
+	{
+		uint32_t color0 = PackRGB565(e0);
+		uint32_t color1 = PackRGB565(e1);
+
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		const glm::vec4 c0 = UnpackRGB565(color0);
+		const glm::vec4 c1 = UnpackRGB565(color1);
+
+		// Equal endpoints would select the 3 color mode, index 0 is still exact
+		glm::vec3 palette[4] = { glm::vec3(c0), glm::vec3(c1), glm::vec3((c0 * 2.0f + c1) / 3.0f), glm::vec3((c0 + c1 * 2.0f) / 3.0f) };
+		const uint32_t paletteSize = color0 == color1 ? 1 : 4;
+
+		float error = 0.0f;
+		uint32_t indexBits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t bestIndex = 0;
+			float bestError = FLT_MAX;
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				const glm::vec3 d = glm::vec3(pTexels[i]) - palette[k];
+				const float e = glm::dot(d, d);
+				if (e < bestError)
+				{
+					bestError = e;
+					bestIndex = k;
+				}
+			}
+
+			pIndices[i] = static_cast<uint8_t>(bestIndex);
+			indexBits |= bestIndex << (i * 2);
+			error += bestError;
+		}
+
+		pBlock[0] = static_cast<uint8_t>(color0);
+		pBlock[1] = static_cast<uint8_t>(color0 >> 8);
+		pBlock[2] = static_cast<uint8_t>(color1);
+		pBlock[3] = static_cast<uint8_t>(color1 >> 8);
+		memcpy(pBlock + 4, &indexBits, 4);
+
+		return error;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void EncodeBlockBC1(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset)
+	{
+		const float BC1_INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		glm::vec4 texels[16];
+		LoadTexels(pRGBA, texels);
+
+		glm::vec4 e0, e1;
+		ComputeAxisEndpoints(texels, 16, 0, 3, e0, e1);
+
+		uint8_t candidate[8];
+		uint8_t indices[16];
+		float bestError = EncodeBC1Endpoints(texels, e1, e0, pBlock, indices);
+
+		const uint32_t refinements = ePreset == CompressionPreset::FAST ? 1 : 4;
+		for (uint32_t iteration = 0; iteration < refinements && bestError > 0.0f; ++iteration)
+		{
+			// Indices refer to the packed (possibly swapped) endpoints, so refine those
+			glm::vec4 c0 = UnpackRGB565(pBlock[0] | (pBlock[1] << 8));
+			glm::vec4 c1 = UnpackRGB565(pBlock[2] | (pBlock[3] << 8));
+
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i)
+				weights[i] = BC1_INDEX_WEIGHTS[indices[i]];
+
+			if (!RefineEndpoints(texels, weights, 16, c0, c1))
+				break;
+
+			uint8_t candidateIndices[16];
+			const float error = EncodeBC1Endpoints(texels, c0, c1, candidate, candidateIndices);
+			if (error >= bestError)
+				break;
+
+			bestError = error;
+			memcpy(pBlock, candidate, 8);
+			memcpy(indices, candidateIndices, 16);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeBlockBC1(const uint8_t* pBlock, uint8_t* pRGBA)
+	{
+		const uint32_t color0 = pBlock[0] | (pBlock[1] << 8);
+		const uint32_t color1 = pBlock[2] | (pBlock[3] << 8);
+		uint32_t indexBits;
+		memcpy(&indexBits, pBlock + 4, 4);
+
+		const glm::vec4 c0 = UnpackRGB565(color0);
+		const glm::vec4 c1 = UnpackRGB565(color1);
+
+		uint8_t palette[4][4];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const uint32_t a = static_cast<uint32_t>(c0[k]);
+			const uint32_t b = static_cast<uint32_t>(c1[k]);
+			palette[0][k] = static_cast<uint8_t>(a);
+			palette[1][k] = static_cast<uint8_t>(b);
+			palette[2][k] = static_cast<uint8_t>(color0 > color1 ? (2 * a + b + 1) / 3 : (a + b) / 2);
+			palette[3][k] = static_cast<uint8_t>(color0 > color1 ? (a + 2 * b + 1) / 3 : 0);
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = color0 > color1 ? 255 : 0;
+
+		for (uint32_t i = 0; i < 16; ++i)
+			memcpy(pRGBA + i * 4, palette[(indexBits >> (i * 2)) & 3], 4);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BC4 / BC5
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline void BuildBC4Palette(uint32_t e0, uint32_t e1, float* pPalette)
+	{
+		pPalette[0] = static_cast<float>(e0);
+		pPalette[1] = static_cast<float>(e1);
+
+		if (e0 > e1)
+		{
+			for (uint32_t k = 1; k < 7; ++k)
+				pPalette[k + 1] = ((7 - k) * e0 + k * e1) / 7.0f;
+		}
+		else
+		{
+			for (uint32_t k = 1; k < 5; ++k)
+				pPalette[k + 1] = ((5 - k) * e0 + k * e1) / 5.0f;
+
+			pPalette[6] = 0.0f;
+			pPalette[7] = 255.0f;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float EncodeBC4Endpoints(const float* pValues, uint32_t e0, uint32_t e1, uint8_t* pBlock)
+	{
+		float palette[8];
+		BuildBC4Palette(e0, e1, palette);
+
+		float error = 0.0f;
+		uint64_t indexBits = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t bestIndex = 0;
+			float bestError = FLT_MAX;
+			for (uint32_t k = 0; k < 8; ++k)
+			{
+				const float d = pValues[i] - palette[k];
+				if (d * d < bestError)
+				{
+					bestError = d * d;
+					bestIndex = k;
+				}
+			}
+
+			indexBits |= static_cast<uint64_t>(bestIndex) << (i * 3);
+			error += bestError;
+		}
+
+		pBlock[0] = static_cast<uint8_t>(e0);
+		pBlock[1] = static_cast<uint8_t>(e1);
+		for (uint32_t i = 0; i < 6; ++i)
+			pBlock[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+
+		return error;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- FAST takes the value range in 8 value mode. QUALITY also tries the 6 value mode with exact 0 & 255 (useful for
+	//--- masks) & nudges each endpoint, the range endpoints clip interior values less than the optimum.
+	void EncodeBlockBC4(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset, uint32_t channel)
+	{
+		float values[16];
+		uint32_t minValue = 255, maxValue = 0;
+		uint32_t minInner = 255, maxInner = 0;
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t v = pRGBA[i * 4 + channel];
+			values[i] = static_cast<float>(v);
+			minValue = std::min(minValue, v);
+			maxValue = std::max(maxValue, v);
+
+			if (v != 0 && v != 255)
+			{
+				minInner = std::min(minInner, v);
+				maxInner = std::max(maxInner, v);
+			}
+		}
+
+		if (minValue == maxValue)
+		{
+			EncodeBC4Endpoints(values, maxValue, minValue, pBlock);
+			return;
+		}
+
+		float bestError = EncodeBC4Endpoints(values, maxValue, minValue, pBlock);
+		if (ePreset == CompressionPreset::FAST || bestError == 0.0f)
+			return;
+
+		uint8_t candidate[8];
+		auto tryEndpoints = [&](int32_t e0, int32_t e1)
+		{
+			e0 = glm::clamp(e0, 0, 255);
+			e1 = glm::clamp(e1, 0, 255);
+
+			const float error = EncodeBC4Endpoints(values, static_cast<uint32_t>(e0), static_cast<uint32_t>(e1), candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(pBlock, candidate, 8);
+			}
+		};
+
+		// 6 value mode spans only the values that 0 & 255 don't cover
+		if (minInner <= maxInner)
+			tryEndpoints(minInner, maxInner);
+
+		for (int32_t d0 = -2; d0 <= 2; ++d0)
+		{
+			for (int32_t d1 = -2; d1 <= 2; ++d1)
+			{
+				// Keep e0 > e1 so this stays in 8 value mode
+				if (static_cast<int32_t>(maxValue) + d0 > static_cast<int32_t>(minValue) + d1)
+					tryEndpoints(maxValue + d0, minValue + d1);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeBlockBC4(const uint8_t* pBlock, uint8_t* pRGBA, uint32_t channel)
+	{
+		float palette[8];
+		BuildBC4Palette(pBlock[0], pBlock[1], palette);
+
+		uint64_t indexBits = 0;
+		for (uint32_t i = 0; i < 6; ++i)
+			indexBits |= static_cast<uint64_t>(pBlock[2 + i]) << (i * 8);
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float value = palette[(indexBits >> (i * 3)) & 7];
+			pRGBA[i * 4 + channel] = static_cast<uint8_t>(value + 0.5f);
+
+			// Single channel formats read back as (r, 0, 0, 1)
+			if (channel == 0)
+			{
+				pRGBA[i * 4 + 1] = 0;
+				pRGBA[i * 4 + 2] = 0;
+				pRGBA[i * 4 + 3] = 255;
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void EncodeBlockBC5(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset)
+	{
+		EncodeBlockBC4(pRGBA, pBlock, ePreset, 0);
+		EncodeBlockBC4(pRGBA, pBlock + 8, ePreset, 1);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeBlockBC5(const uint8_t* pBlock, uint8_t* pRGBA)
+	{
+		DecodeBlockBC4(pBlock, pRGBA, 0);
+		DecodeBlockBC4(pBlock + 8, pRGBA, 1);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BC7
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct BC7Endpoints
+	{
+		uint32_t	code[2][4];				// Stored endpoint bits, without p-bits
+		uint32_t	pbit[2];
+		uint32_t	value[2][4];			// Decoded 8 bit endpoints
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct BC7Block
+	{
+		uint32_t		partition;
+		uint32_t		rotation;
+		BC7Endpoints	endpoints[2];		// Per subset
+		BC7Endpoints	alphaEndpoints;		// Mode 5 only
+		uint8_t			indices[16];
+		uint8_t			alphaIndices[16];
+		float			error;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Nearest code for an 8 bit target, given the stored bit count & an optional p-bit appended as the lowest bit
+	inline uint32_t QuantizeChannel(float value, uint32_t codeBits, int32_t pbit, uint32_t& outValue)
+	{
+		const uint32_t precision = codeBits + (pbit >= 0 ? 1 : 0);
+		const int32_t maxCode = (1 << codeBits) - 1;
+
+		const float scaled = value * ((1 << precision) - 1) / 255.0f;
+		const int32_t guess = pbit >= 0 ? static_cast<int32_t>(std::floor((scaled - pbit) * 0.5f + 0.5f)) : static_cast<int32_t>(scaled + 0.5f);
+
+		uint32_t bestCode = 0;
+		float bestError = FLT_MAX;
+		for (int32_t code = std::max(0, guess - 1); code <= std::min(maxCode, guess + 1); ++code)
+		{
+			const uint32_t stored = pbit >= 0 ? (static_cast<uint32_t>(code) << 1) | static_cast<uint32_t>(pbit) : static_cast<uint32_t>(code);
+			const uint32_t expanded = ExpandBits(stored, precision);
+			const float error = std::abs(static_cast<float>(expanded) - value);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestCode = static_cast<uint32_t>(code);
+				outValue = expanded;
+			}
+		}
+
+		return bestCode;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Quantizes one endpoint over channels [channelBegin, channelEnd) with a fixed p-bit (-1 for none). Returns the
+	//--- squared quantization error.
+	float QuantizeEndpoint(const glm::vec4& e, const BC7Mode& mode, uint32_t channelBegin, uint32_t channelEnd, int32_t pbit,
+						   BC7Endpoints& out, uint32_t endpoint)
+	{
+		float error = 0.0f;
+		for (uint32_t c = channelBegin; c < channelEnd; ++c)
+		{
+			const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+			out.code[endpoint][c] = QuantizeChannel(e[c], bits, pbit, out.value[endpoint][c]);
+
+			const float d = static_cast<float>(out.value[endpoint][c]) - e[c];
+			error += d * d;
+		}
+
+		out.pbit[endpoint] = pbit >= 0 ? static_cast<uint32_t>(pbit) : 0;
+		return error;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Picks indices for quantized endpoints, returns the squared error over channels [channelBegin, channelEnd)
+	float AssignIndices(const glm::vec4* pTexels, const uint8_t* pTexelIds, uint32_t count, const BC7Endpoints& endpoints, uint32_t indexBits,
+						uint32_t channelBegin, uint32_t channelEnd, uint8_t* pIndices)
+	{
+		const uint32_t* pWeights = GetWeights(indexBits);
+		const uint32_t paletteSize = 1u << indexBits;
+
+		float palette[16][4];
+		for (uint32_t k = 0; k < paletteSize; ++k)
+		{
+			for (uint32_t c = channelBegin; c < channelEnd; ++c)
+				palette[k][c] = static_cast<float>(Interpolate(endpoints.value[0][c], endpoints.value[1][c], pWeights[k]));
+		}
+
+		float error = 0.0f;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const glm::vec4& texel = pTexels[pTexelIds[i]];
+
+			uint32_t bestIndex = 0;
+			float bestError = FLT_MAX;
+			for (uint32_t k = 0; k < paletteSize; ++k)
+			{
+				float e = 0.0f;
+				for (uint32_t c = channelBegin; c < channelEnd; ++c)
+				{
+					const float d = texel[c] - palette[k][c];
+					e += d * d;
+				}
+
+				if (e < bestError)
+				{
+					bestError = e;
+					bestIndex = k;
+				}
+			}
+
+			pIndices[pTexelIds[i]] = static_cast<uint8_t>(bestIndex);
+			error += bestError;
+		}
+
+		return error;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Quantizes both endpoints, trying the p-bit choices the mode allows, & assigns indices
+	float QuantizeAndAssign(const glm::vec4* pTexels, const uint8_t* pTexelIds, uint32_t count, const glm::vec4& e0, const glm::vec4& e1,
+							const BC7Mode& mode, uint32_t channelBegin, uint32_t channelEnd, uint32_t indexBits, BC7Endpoints& outEndpoints,
+							uint8_t* pIndices)
+	{
+		if (mode.ePBits == PBitMode::NONE)
+		{
+			QuantizeEndpoint(e0, mode, channelBegin, channelEnd, -1, outEndpoints, 0);
+			QuantizeEndpoint(e1, mode, channelBegin, channelEnd, -1, outEndpoints, 1);
+			return AssignIndices(pTexels, pTexelIds, count, outEndpoints, indexBits, channelBegin, channelEnd, pIndices);
+		}
+
+		if (mode.ePBits == PBitMode::UNIQUE)
+		{
+			// Endpoints are independent, each keeps the p-bit that quantizes it best
+			const glm::vec4* pEnds[2] = { &e0, &e1 };
+			for (uint32_t endpoint = 0; endpoint < 2; ++endpoint)
+			{
+				BC7Endpoints candidate[2];
+				const float error0 = QuantizeEndpoint(*pEnds[endpoint], mode, channelBegin, channelEnd, 0, candidate[0], endpoint);
+				const float error1 = QuantizeEndpoint(*pEnds[endpoint], mode, channelBegin, channelEnd, 1, candidate[1], endpoint);
+				const BC7Endpoints& best = error0 <= error1 ? candidate[0] : candidate[1];
+
+				for (uint32_t c = channelBegin; c < channelEnd; ++c)
+				{
+					outEndpoints.code[endpoint][c] = best.code[endpoint][c];
+					outEndpoints.value[endpoint][c] = best.value[endpoint][c];
+				}
+				outEndpoints.pbit[endpoint] = best.pbit[endpoint];
+			}
+
+			return AssignIndices(pTexels, pTexelIds, count, outEndpoints, indexBits, channelBegin, channelEnd, pIndices);
+		}
+
+		// Shared p-bit couples both endpoints, so judge by the final error
+		float bestError = FLT_MAX;
+		uint8_t candidateIndices[16];
+		for (int32_t pbit = 0; pbit < 2; ++pbit)
+		{
+			BC7Endpoints candidate = outEndpoints;
+			QuantizeEndpoint(e0, mode, channelBegin, channelEnd, pbit, candidate, 0);
+			QuantizeEndpoint(e1, mode, channelBegin, channelEnd, pbit, candidate, 1);
+
+			const float error = AssignIndices(pTexels, pTexelIds, count, candidate, indexBits, channelBegin, channelEnd, candidateIndices);
+			if (error < bestError)
+			{
+				bestError = error;
+				outEndpoints = candidate;
+				for (uint32_t i = 0; i < count; ++i)
+					pIndices[pTexelIds[i]] = candidateIndices[pTexelIds[i]];
+			}
+		}
+
+		return bestError;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Principal axis endpoints, then alternating quantize/index & least squares refits while the error keeps dropping
+	float EncodeSubset(const glm::vec4* pTexels, const uint8_t* pTexelIds, uint32_t count, const BC7Mode& mode, uint32_t channelBegin,
+					   uint32_t channelEnd, uint32_t indexBits, uint32_t refinements, BC7Endpoints& outEndpoints, uint8_t* pIndices)
+	{
+		glm::vec4 subsetTexels[16];
+		for (uint32_t i = 0; i < count; ++i)
+			subsetTexels[i] = pTexels[pTexelIds[i]];
+
+		glm::vec4 e0, e1;
+		ComputeAxisEndpoints(subsetTexels, count, channelBegin, channelEnd, e0, e1);
+
+		float bestError = QuantizeAndAssign(pTexels, pTexelIds, count, e0, e1, mode, channelBegin, channelEnd, indexBits, outEndpoints, pIndices);
+
+		const uint32_t* pWeights = GetWeights(indexBits);
+		for (uint32_t iteration = 0; iteration < refinements && bestError > 0.0f; ++iteration)
+		{
+			float weights[16];
+			for (uint32_t i = 0; i < count; ++i)
+				weights[i] = pWeights[pIndices[pTexelIds[i]]] / 64.0f;
+
+			if (!RefineEndpoints(subsetTexels, weights, count, e0, e1))
+				break;
+
+			BC7Endpoints candidate = outEndpoints;
+			uint8_t candidateIndices[16];
+			memcpy(candidateIndices, pIndices, 16);
+
+			const float error = QuantizeAndAssign(pTexels, pTexelIds, count, e0, e1, mode, channelBegin, channelEnd, indexBits, candidate, candidateIndices);
+			if (error >= bestError)
+				break;
+
+			bestError = error;
+			outEndpoints = candidate;
+			for (uint32_t i = 0; i < count; ++i)
+				pIndices[pTexelIds[i]] = candidateIndices[pTexelIds[i]];
+		}
+
+		return bestError;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Anchor texels store their index without the top bit, so it has to be 0. Swapping the endpoints & mirroring the
+	//--- subset's indices fixes that without changing the decoded colors.
+	void FixAnchor(BC7Endpoints& endpoints, uint8_t* pIndices, uint32_t indexBits, uint32_t anchor, uint32_t partition, uint32_t subset,
+				   uint32_t subsets)
+	{
+		const uint32_t highBit = 1u << (indexBits - 1);
+		if (!(pIndices[anchor] & highBit))
+			return;
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			std::swap(endpoints.code[0][c], endpoints.code[1][c]);
+			std::swap(endpoints.value[0][c], endpoints.value[1][c]);
+		}
+		std::swap(endpoints.pbit[0], endpoints.pbit[1]);
+
+		const uint32_t maxIndex = (1u << indexBits) - 1;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (GetPartitionSubset(partition, i, subsets) == subset)
+				pIndices[i] = static_cast<uint8_t>(maxIndex - pIndices[i]);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- How badly a two subset partition fits, the RGB spread left over once each subset's principal axis is taken out
+	float EstimatePartitionResidual(const glm::vec4* pTexels, uint32_t partition)
+	{
+		float residual = 0.0f;
+		for (uint32_t subset = 0; subset < 2; ++subset)
+		{
+			glm::vec4 subsetTexels[16];
+			uint32_t count = 0;
+			glm::vec4 mean(0.0f);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (GetPartitionSubset(partition, i, 2) == subset)
+				{
+					subsetTexels[count++] = pTexels[i];
+					mean += pTexels[i];
+				}
+			}
+			mean /= static_cast<float>(count);
+
+			float variance = 0.0f;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const glm::vec3 d = glm::vec3(subsetTexels[i] - mean);
+				variance += glm::dot(d, d);
+			}
+
+			float eigenvalue = 0.0f;
+			ComputePrincipalAxis(subsetTexels, count, mean, 0, 3, &eigenvalue);
+			residual += std::max(0.0f, variance - eigenvalue);
+		}
+
+		return residual;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void PackBC7Block(const BC7Mode& mode, BC7Block& block, uint8_t* pOut)
+	{
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			const uint32_t anchor = subset == 0 ? 0 : BC7_ANCHORS_2[block.partition];
+			FixAnchor(block.endpoints[subset], block.indices, mode.indexBits, anchor, block.partition, subset, mode.subsets);
+		}
+
+		if (mode.alphaIndexBits)
+			FixAnchor(block.alphaEndpoints, block.alphaIndices, mode.alphaIndexBits, 0, 0, 0, 1);
+
+		BlockBitWriter writer(pOut, 16);
+		writer.Write(1u << mode.mode, mode.mode + 1);
+		writer.Write(block.partition, mode.partitionBits);
+		writer.Write(block.rotation, mode.rotationBits);
+
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				writer.Write(block.endpoints[subset].code[0][c], mode.colorBits);
+				writer.Write(block.endpoints[subset].code[1][c], mode.colorBits);
+			}
+		}
+
+		if (mode.alphaBits)
+		{
+			const BC7Endpoints& alpha = mode.alphaIndexBits ? block.alphaEndpoints : block.endpoints[0];
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				writer.Write(alpha.code[0][3], mode.alphaBits);
+				writer.Write(alpha.code[1][3], mode.alphaBits);
+			}
+		}
+
+		if (mode.ePBits == PBitMode::UNIQUE)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				writer.Write(block.endpoints[subset].pbit[0], 1);
+				writer.Write(block.endpoints[subset].pbit[1], 1);
+			}
+		}
+		else if (mode.ePBits == PBitMode::SHARED)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+				writer.Write(block.endpoints[subset].pbit[0], 1);
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+			writer.Write(block.indices[i], IsAnchor(block.partition, i, mode.subsets) ? mode.indexBits - 1 : mode.indexBits);
+
+		if (mode.alphaIndexBits)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+				writer.Write(block.alphaIndices[i], i == 0 ? mode.alphaIndexBits - 1 : mode.alphaIndexBits);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Mode 6: one subset, RGBA with shared 4 bit indices. Handles smooth blocks & alpha well.
+	void EncodeBC7Mode6(const glm::vec4* pTexels, uint32_t refinements, BC7Block& block)
+	{
+		const uint8_t texelIds[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+		block.partition = 0;
+		block.rotation = 0;
+		block.error = EncodeSubset(pTexels, texelIds, 16, BC7_MODE_6, 0, 4, BC7_MODE_6.indexBits, refinements, block.endpoints[0], block.indices);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Mode 1: two subsets of opaque RGB. The partition gets picked by how well each subset fits a line, then only the
+	//--- best few candidates get encoded for real.
+	void EncodeBC7Mode1(const glm::vec4* pTexels, uint32_t refinements, BC7Block& block)
+	{
+		std::pair<float, uint32_t> estimates[64];
+		for (uint32_t partition = 0; partition < 64; ++partition)
+			estimates[partition] = std::make_pair(EstimatePartitionResidual(pTexels, partition), partition);
+
+		std::partial_sort(estimates, estimates + BC7_PARTITION_CANDIDATES, estimates + 64);
+
+		block.error = FLT_MAX;
+		for (uint32_t candidate = 0; candidate < BC7_PARTITION_CANDIDATES; ++candidate)
+		{
+			BC7Block trial = {};
+			trial.partition = estimates[candidate].second;
+			trial.error = 0.0f;
+
+			for (uint32_t subset = 0; subset < 2; ++subset)
+			{
+				uint8_t texelIds[16];
+				uint32_t count = 0;
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					if (GetPartitionSubset(trial.partition, i, 2) == subset)
+						texelIds[count++] = static_cast<uint8_t>(i);
+				}
+
+				trial.error += EncodeSubset(pTexels, texelIds, count, BC7_MODE_1, 0, 3, BC7_MODE_1.indexBits, refinements, trial.endpoints[subset], trial.indices);
+			}
+
+			// Alpha decodes as 255
+			for (uint32_t i = 0; i < 16; ++i)
+				trial.error += (255.0f - pTexels[i].w) * (255.0f - pTexels[i].w);
+
+			if (trial.error < block.error)
+				block = trial;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Mode 5: one subset with separate color & alpha indices. The rotation moves one color channel into the alpha
+	//--- slot, which helps blocks where a channel varies independently of the others.
+	void EncodeBC7Mode5(const glm::vec4* pTexels, uint32_t refinements, BC7Block& block)
+	{
+		const uint8_t texelIds[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+		block.error = FLT_MAX;
+		for (uint32_t rotation = 0; rotation < 4; ++rotation)
+		{
+			glm::vec4 rotated[16];
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				rotated[i] = pTexels[i];
+				if (rotation > 0)
+					std::swap(rotated[i][rotation - 1], rotated[i][3]);
+			}
+
+			BC7Block trial = {};
+			trial.partition = 0;
+			trial.rotation = rotation;
+			trial.error = EncodeSubset(rotated, texelIds, 16, BC7_MODE_5, 0, 3, BC7_MODE_5.indexBits, refinements, trial.endpoints[0], trial.indices);
+			trial.error += EncodeSubset(rotated, texelIds, 16, BC7_MODE_5, 3, 4, BC7_MODE_5.alphaIndexBits, refinements, trial.alphaEndpoints, trial.alphaIndices);
+
+			if (trial.error < block.error)
+				block = trial;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void EncodeBlockBC7(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset)
+	{
+		glm::vec4 texels[16];
+		LoadTexels(pRGBA, texels);
+
+		const uint32_t refinements = ePreset == CompressionPreset::FAST ? 1 : 3;
+
+		BC7Block best = {};
+		EncodeBC7Mode6(texels, refinements, best);
+		const BC7Mode* pBestMode = &BC7_MODE_6;
+
+		if (ePreset == CompressionPreset::QUALITY && best.error > 0.0f)
+		{
+			bool bOpaque = true;
+			for (uint32_t i = 0; i < 16; ++i)
+				bOpaque &= pRGBA[i * 4 + 3] == 255;
+
+			BC7Block candidate = {};
+			if (bOpaque)
+			{
+				EncodeBC7Mode1(texels, refinements, candidate);
+				if (candidate.error < best.error)
+				{
+					best = candidate;
+					pBestMode = &BC7_MODE_1;
+				}
+			}
+
+			EncodeBC7Mode5(texels, refinements, candidate);
+			if (candidate.error < best.error)
+			{
+				best = candidate;
+				pBestMode = &BC7_MODE_5;
+			}
+		}
+
+		PackBC7Block(*pBestMode, best, pBlock);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeBlockBC7(const uint8_t* pBlock, uint8_t* pRGBA)
+	{
+		uint32_t modeIndex = 0;
+		while (modeIndex < 8 && !((pBlock[0] >> modeIndex) & 1))
+			++modeIndex;
+
+		const BC7Mode* pMode = modeIndex == 1 ? &BC7_MODE_1 : (modeIndex == 5 ? &BC7_MODE_5 : (modeIndex == 6 ? &BC7_MODE_6 : nullptr));
+		if (!pMode)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				pRGBA[i * 4 + 0] = 255;
+				pRGBA[i * 4 + 1] = 0;
+				pRGBA[i * 4 + 2] = 255;
+				pRGBA[i * 4 + 3] = 255;
+			}
+			return;
+		}
+
+		const BC7Mode& mode = *pMode;
+		BlockBitReader reader(pBlock);
+		reader.Read(mode.mode + 1);
+
+		const uint32_t partition = reader.Read(mode.partitionBits);
+		const uint32_t rotation = reader.Read(mode.rotationBits);
+
+		uint32_t endpoints[2][2][4] = {};		// [subset][endpoint][channel], stored bits
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+			{
+				endpoints[subset][0][c] = reader.Read(mode.colorBits);
+				endpoints[subset][1][c] = reader.Read(mode.colorBits);
+			}
+		}
+
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			endpoints[subset][0][3] = mode.alphaBits ? reader.Read(mode.alphaBits) : 255;
+			endpoints[subset][1][3] = mode.alphaBits ? reader.Read(mode.alphaBits) : 255;
+		}
+
+		uint32_t pbits[2][2] = {};
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			if (mode.ePBits == PBitMode::UNIQUE)
+			{
+				pbits[subset][0] = reader.Read(1);
+				pbits[subset][1] = reader.Read(1);
+			}
+			else if (mode.ePBits == PBitMode::SHARED)
+			{
+				pbits[subset][0] = pbits[subset][1] = reader.Read(1);
+			}
+		}
+
+		// Expand to 8 bits
+		for (uint32_t subset = 0; subset < mode.subsets; ++subset)
+		{
+			for (uint32_t e = 0; e < 2; ++e)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const uint32_t bits = c < 3 ? mode.colorBits : mode.alphaBits;
+					if (c == 3 && !mode.alphaBits)
+						continue;
+
+					if (mode.ePBits == PBitMode::NONE)
+						endpoints[subset][e][c] = ExpandBits(endpoints[subset][e][c], bits);
+					else
+						endpoints[subset][e][c] = ExpandBits((endpoints[subset][e][c] << 1) | pbits[subset][e], bits + 1);
+				}
+			}
+		}
+
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; ++i)
+			indices[i] = reader.Read(IsAnchor(partition, i, mode.subsets) ? mode.indexBits - 1 : mode.indexBits);
+
+		uint32_t alphaIndices[16];
+		for (uint32_t i = 0; i < 16; ++i)
+			alphaIndices[i] = mode.alphaIndexBits ? reader.Read(i == 0 ? mode.alphaIndexBits - 1 : mode.alphaIndexBits) : indices[i];
+
+		const uint32_t* pWeights = GetWeights(mode.indexBits);
+		const uint32_t* pAlphaWeights = GetWeights(mode.alphaIndexBits ? mode.alphaIndexBits : mode.indexBits);
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t subset = GetPartitionSubset(partition, i, mode.subsets);
+			uint8_t* pTexel = pRGBA + i * 4;
+
+			for (uint32_t c = 0; c < 3; ++c)
+				pTexel[c] = static_cast<uint8_t>(Interpolate(endpoints[subset][0][c], endpoints[subset][1][c], pWeights[indices[i]]));
+
+			pTexel[3] = static_cast<uint8_t>(Interpolate(endpoints[subset][0][3], endpoints[subset][1][3], pAlphaWeights[alphaIndices[i]]));
+
+			if (rotation > 0)
+				std::swap(pTexel[rotation - 1], pTexel[3]);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BC6H, unsigned. Endpoints & interpolation live in a 16 bit space the decoder scales by 31/64 into half float bits,
+	//--- so lines get fitted through the texels' half bits, which is close to fitting them in log space.
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct BC6HMode
+	{
+		uint32_t	mode;					// 5 bit mode field
+		uint32_t	regions;
+		uint32_t	endpointBits;			// Precision of every endpoint once decoded
+		uint32_t	deltaBits;				// Stored bits of the second endpoint, a signed delta to the first when transformed
+		bool		bTransformed;
+		uint32_t	indexBits;
+	};
+
+	const BC6HMode	BC6H_MODE_10 = { 0x1E, 2, 6, 6, false, 3 };
+	const BC6HMode	BC6H_MODE_11 = { 0x03, 1, 10, 10, false, 4 };
+	const BC6HMode	BC6H_MODE_12 = { 0x07, 1, 11, 9, true, 4 };
+	const BC6HMode	BC6H_MODE_13 = { 0x0B, 1, 12, 8, true, 4 };
+	const BC6HMode	BC6H_MODE_14 = { 0x0F, 1, 16, 4, true, 4 };
+
+	const uint32_t	BC6H_PARTITIONS				= 32;		// The first 32 BC7 two subset partitions, anchors included
+	const uint32_t	BC6H_PARTITION_CANDIDATES	= 4;		// Mode 10 partitions fully encoded after the estimate
+
+	//--- Mode 10 scatters its endpoint bits, runs of (endpoint, channel, first bit, bit count) in stream order. Endpoints
+	//--- 0 & 1 belong to region 0 (w & x in the specification), 2 & 3 to region 1 (y & z).
+	struct BC6HBitRun
+	{
+		uint8_t		endpoint;
+		uint8_t		channel;
+		uint8_t		firstBit;
+		uint8_t		bitCount;
+	};
+
+	const BC6HBitRun BC6H_MODE_10_LAYOUT[] =
+	{
+		{ 0, 0, 0, 6 }, { 3, 1, 4, 1 }, { 3, 2, 0, 1 }, { 3, 2, 1, 1 }, { 3, 2, 4, 1 },
+		{ 0, 1, 0, 6 }, { 2, 1, 5, 1 }, { 2, 2, 5, 1 }, { 3, 2, 2, 1 }, { 2, 1, 4, 1 },
+		{ 0, 2, 0, 6 }, { 3, 1, 5, 1 }, { 3, 2, 3, 1 }, { 3, 2, 5, 1 }, { 2, 2, 4, 1 },
+		{ 1, 0, 0, 6 }, { 2, 1, 0, 4 },
+		{ 1, 1, 0, 6 }, { 3, 1, 0, 4 },
+		{ 1, 2, 0, 6 }, { 2, 2, 0, 4 },
+		{ 2, 0, 0, 6 }, { 3, 0, 0, 6 }
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct BC6HBlock
+	{
+		uint32_t	partition;
+		uint32_t	endpoints[2][2][3];		// [region][endpoint][channel], endpointBits each
+		uint8_t		indices[16];
+		float		error;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t UnquantizeBC6H(uint32_t code, uint32_t bits)
+	{
+		if (bits >= 15 || code == 0)
+			return code;
+
+		if (code == (1u << bits) - 1)
+			return 0xFFFF;
+
+		return ((code << 16) + 0x8000) >> bits;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Closest code once unquantized, the direct guess can be off by one either way
+	inline uint32_t QuantizeBC6H(float value, uint32_t bits)
+	{
+		const uint32_t maxCode = (1u << bits) - 1;
+		const uint32_t guess = std::min(static_cast<uint32_t>(std::max(value, 0.0f) * static_cast<float>(1u << bits) / 65536.0f), maxCode);
+
+		uint32_t best = guess;
+		float bestError = FLT_MAX;
+		for (uint32_t code = guess > 0 ? guess - 1 : 0; code <= std::min(guess + 1, maxCode); ++code)
+		{
+			const float error = std::abs(static_cast<float>(UnquantizeBC6H(code, bits)) - value);
+			if (error < bestError)
+			{
+				bestError = error;
+				best = code;
+			}
+		}
+
+		return best;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Transformed modes store the other endpoints as deltas to the first, pull them into range
+	void ConstrainBC6HEndpoints(const BC6HMode& mode, BC6HBlock& block)
+	{
+		if (!mode.bTransformed)
+			return;
+
+		const int32_t range = 1 << (mode.deltaBits - 1);
+		for (uint32_t endpoint = 1; endpoint < mode.regions * 2; ++endpoint)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const int32_t base = static_cast<int32_t>(block.endpoints[0][0][c]);
+				uint32_t& code = block.endpoints[endpoint >> 1][endpoint & 1][c];
+				code = static_cast<uint32_t>(base + glm::clamp(static_cast<int32_t>(code) - base, -range, range - 1));
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Squared error of the block in the 16 bit space, picking the closest index per texel or keeping the current ones
+	float EvaluateBC6HBlock(const glm::vec4* pTexels, const BC6HMode& mode, BC6HBlock& block, bool bSelectIndices)
+	{
+		const uint32_t* pWeights = GetWeights(mode.indexBits);
+		const uint32_t indexCount = 1u << mode.indexBits;
+
+		float palette[2][16][3];
+		for (uint32_t region = 0; region < mode.regions; ++region)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint32_t e0 = UnquantizeBC6H(block.endpoints[region][0][c], mode.endpointBits);
+				const uint32_t e1 = UnquantizeBC6H(block.endpoints[region][1][c], mode.endpointBits);
+				for (uint32_t k = 0; k < indexCount; ++k)
+					palette[region][k][c] = static_cast<float>(Interpolate(e0, e1, pWeights[k]));
+			}
+		}
+
+		float error = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t region = GetPartitionSubset(block.partition, i, mode.regions);
+
+			uint32_t bestIndex = block.indices[i];
+			float bestError = FLT_MAX;
+			for (uint32_t k = bSelectIndices ? 0 : bestIndex; k < (bSelectIndices ? indexCount : bestIndex + 1); ++k)
+			{
+				const glm::vec3 d = glm::vec3(pTexels[i]) - glm::vec3(palette[region][k][0], palette[region][k][1], palette[region][k][2]);
+				const float e = glm::dot(d, d);
+				if (e < bestError)
+				{
+					bestError = e;
+					bestIndex = k;
+				}
+			}
+
+			block.indices[i] = static_cast<uint8_t>(bestIndex);
+			error += bestError;
+		}
+
+		return error;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Same anchor rule as BC7, swapped endpoints of a transformed mode get constrained again
+	void FixBC6HAnchors(const BC6HMode& mode, BC6HBlock& block)
+	{
+		const uint32_t highBit = 1u << (mode.indexBits - 1);
+		const uint32_t maxIndex = (1u << mode.indexBits) - 1;
+
+		for (uint32_t region = 0; region < mode.regions; ++region)
+		{
+			const uint32_t anchor = region == 0 ? 0 : BC7_ANCHORS_2[block.partition];
+			if (!(block.indices[anchor] & highBit))
+				continue;
+
+			for (uint32_t c = 0; c < 3; ++c)
+				std::swap(block.endpoints[region][0][c], block.endpoints[region][1][c]);
+
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (GetPartitionSubset(block.partition, i, mode.regions) == region)
+					block.indices[i] = static_cast<uint8_t>(maxIndex - block.indices[i]);
+			}
+		}
+
+		ConstrainBC6HEndpoints(mode, block);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Principal axis endpoints per region, then least squares refits against the chosen weights
+	void EncodeBC6HRegions(const glm::vec4* pTexels, const BC6HMode& mode, uint32_t partition, uint32_t refinements, BC6HBlock& outBlock)
+	{
+		const uint32_t* pWeights = GetWeights(mode.indexBits);
+
+		glm::vec4 endpoints[2][2];
+		for (uint32_t region = 0; region < mode.regions; ++region)
+		{
+			glm::vec4 regionTexels[16];
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				if (GetPartitionSubset(partition, i, mode.regions) == region)
+					regionTexels[count++] = pTexels[i];
+			}
+
+			ComputeAxisEndpoints(regionTexels, count, 0, 3, endpoints[region][0], endpoints[region][1], 65535.0f);
+		}
+
+		outBlock = {};
+		outBlock.partition = partition;
+		outBlock.error = FLT_MAX;
+
+		for (uint32_t iteration = 0; iteration <= refinements; ++iteration)
+		{
+			BC6HBlock trial = {};
+			trial.partition = partition;
+			for (uint32_t region = 0; region < mode.regions; ++region)
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					trial.endpoints[region][0][c] = QuantizeBC6H(endpoints[region][0][c], mode.endpointBits);
+					trial.endpoints[region][1][c] = QuantizeBC6H(endpoints[region][1][c], mode.endpointBits);
+				}
+			}
+
+			ConstrainBC6HEndpoints(mode, trial);
+			EvaluateBC6HBlock(pTexels, mode, trial, true);
+			FixBC6HAnchors(mode, trial);
+			trial.error = EvaluateBC6HBlock(pTexels, mode, trial, false);
+
+			if (trial.error < outBlock.error)
+				outBlock = trial;
+
+			if (iteration == refinements || outBlock.error <= 0.0f)
+				break;
+
+			for (uint32_t region = 0; region < mode.regions; ++region)
+			{
+				glm::vec4 regionTexels[16];
+				float weights[16];
+				uint32_t count = 0;
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					if (GetPartitionSubset(partition, i, mode.regions) == region)
+					{
+						regionTexels[count] = pTexels[i];
+						weights[count++] = pWeights[trial.indices[i]] / 64.0f;
+					}
+				}
+
+				RefineEndpoints(regionTexels, weights, count, endpoints[region][0], endpoints[region][1], 65535.0f);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void PackBC6HBlock(const BC6HMode& mode, const BC6HBlock& block, uint8_t* pOut)
+	{
+		BlockBitWriter writer(pOut, 16);
+		writer.Write(mode.mode, 5);
+
+		if (mode.regions == 2)
+		{
+			for (const BC6HBitRun& run : BC6H_MODE_10_LAYOUT)
+				writer.Write(block.endpoints[run.endpoint >> 1][run.endpoint & 1][run.channel] >> run.firstBit, run.bitCount);
+
+			writer.Write(block.partition, 5);
+		}
+		else
+		{
+			// Low 10 bits of the first endpoint, then per channel the second endpoint followed by the first's high bits,
+			// most significant first
+			for (uint32_t c = 0; c < 3; ++c)
+				writer.Write(block.endpoints[0][0][c], 10);
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint32_t e0 = block.endpoints[0][0][c];
+				const uint32_t e1 = block.endpoints[0][1][c];
+				writer.Write(mode.bTransformed ? e1 - e0 : e1, mode.deltaBits);
+
+				for (uint32_t bit = mode.endpointBits; bit-- > 10;)
+					writer.Write(e0 >> bit, 1);
+			}
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+			writer.Write(block.indices[i], IsAnchor(block.partition, i, mode.regions) ? mode.indexBits - 1 : mode.indexBits);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void EncodeBlockBC6H(const float* pRGBA, uint8_t* pBlock, CompressionPreset ePreset)
+	{
+		// Half bits scaled by 64/31, the inverse of the decoder's last step. Negatives & NaNs go to 0, anything above the
+		// largest half to 65504.
+		glm::vec4 texels[16];
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const float value = pRGBA[i * 4 + c];
+				const uint16_t half = FloatToHalf(value > 0.0f ? std::min(value, 65504.0f) : 0.0f);
+				texels[i][c] = std::min(half * (64.0f / 31.0f), 65535.0f);
+			}
+			texels[i].w = 0.0f;
+		}
+
+		const uint32_t refinements = ePreset == CompressionPreset::FAST ? 1 : 3;
+
+		BC6HBlock best;
+		EncodeBC6HRegions(texels, BC6H_MODE_11, 0, refinements, best);
+		const BC6HMode* pBestMode = &BC6H_MODE_11;
+
+		if (ePreset == CompressionPreset::QUALITY && best.error > 0.0f)
+		{
+			BC6HBlock candidate;
+			for (const BC6HMode* pMode : { &BC6H_MODE_12, &BC6H_MODE_13, &BC6H_MODE_14 })
+			{
+				EncodeBC6HRegions(texels, *pMode, 0, refinements, candidate);
+				if (candidate.error < best.error)
+				{
+					best = candidate;
+					pBestMode = pMode;
+				}
+			}
+
+			std::pair<float, uint32_t> estimates[BC6H_PARTITIONS];
+			for (uint32_t partition = 0; partition < BC6H_PARTITIONS; ++partition)
+				estimates[partition] = std::make_pair(EstimatePartitionResidual(texels, partition), partition);
+
+			std::partial_sort(estimates, estimates + BC6H_PARTITION_CANDIDATES, estimates + BC6H_PARTITIONS);
+
+			for (uint32_t i = 0; i < BC6H_PARTITION_CANDIDATES; ++i)
+			{
+				EncodeBC6HRegions(texels, BC6H_MODE_10, estimates[i].second, refinements, candidate);
+				if (candidate.error < best.error)
+				{
+					best = candidate;
+					pBestMode = &BC6H_MODE_10;
+				}
+			}
+		}
+
+		PackBC6HBlock(*pBestMode, best, pBlock);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeBlockBC6H(const uint8_t* pBlock, float* pRGBA)
+	{
+		BlockBitReader reader(pBlock);
+
+		// Two bit mode fields (modes 1 & 2) end at 00 & 01, everything else reads three more bits
+		uint32_t modeField = reader.Read(2);
+		if (modeField >= 2)
+			modeField |= reader.Read(3) << 2;
+
+		const BC6HMode* pMode = nullptr;
+		switch (modeField)
+		{
+			case 0x1E:	pMode = &BC6H_MODE_10;	break;
+			case 0x03:	pMode = &BC6H_MODE_11;	break;
+			case 0x07:	pMode = &BC6H_MODE_12;	break;
+			case 0x0B:	pMode = &BC6H_MODE_13;	break;
+			case 0x0F:	pMode = &BC6H_MODE_14;	break;
+			default:							break;
+		}
+
+		if (!pMode)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				pRGBA[i * 4 + 0] = 1.0f;
+				pRGBA[i * 4 + 1] = 0.0f;
+				pRGBA[i * 4 + 2] = 1.0f;
+				pRGBA[i * 4 + 3] = 1.0f;
+			}
+			return;
+		}
+
+		const BC6HMode& mode = *pMode;
+
+		uint32_t endpoints[2][2][3] = {};
+		uint32_t partition = 0;
+		if (mode.regions == 2)
+		{
+			for (const BC6HBitRun& run : BC6H_MODE_10_LAYOUT)
+				endpoints[run.endpoint >> 1][run.endpoint & 1][run.channel] |= reader.Read(run.bitCount) << run.firstBit;
+
+			partition = reader.Read(5);
+		}
+		else
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				endpoints[0][0][c] = reader.Read(10);
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				endpoints[0][1][c] = reader.Read(mode.deltaBits);
+
+				for (uint32_t bit = mode.endpointBits; bit-- > 10;)
+					endpoints[0][0][c] |= reader.Read(1) << bit;
+			}
+
+			if (mode.bTransformed)
+			{
+				const uint32_t shift = 32 - mode.deltaBits;
+				const uint32_t mask = (1u << mode.endpointBits) - 1;
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					const int32_t delta = static_cast<int32_t>(endpoints[0][1][c] << shift) >> shift;
+					endpoints[0][1][c] = static_cast<uint32_t>(static_cast<int32_t>(endpoints[0][0][c]) + delta) & mask;
+				}
+			}
+		}
+
+		for (uint32_t region = 0; region < mode.regions; ++region)
+		{
+			for (uint32_t e = 0; e < 2; ++e)
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+					endpoints[region][e][c] = UnquantizeBC6H(endpoints[region][e][c], mode.endpointBits);
+			}
+		}
+
+		const uint32_t* pWeights = GetWeights(mode.indexBits);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t index = reader.Read(IsAnchor(partition, i, mode.regions) ? mode.indexBits - 1 : mode.indexBits);
+			const uint32_t region = GetPartitionSubset(partition, i, mode.regions);
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const uint32_t value = Interpolate(endpoints[region][0][c], endpoints[region][1][c], pWeights[index]);
+				pRGBA[i * 4 + c] = HalfToFloat(static_cast<uint16_t>((value * 31) >> 6));
+			}
+			pRGBA[i * 4 + 3] = 1.0f;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Whole images
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CompressImage(const uint8_t* pRGBA, uint32_t width, uint32_t height, TextureFormat eFormat, CompressionPreset ePreset, uint8_t* pOut)
+	{
+		if (!IsBlockCompressed(eFormat))
+		{
+			memcpy(pOut, pRGBA, ComputeLevelByteSize(eFormat, width, height));
+			return;
+		}
+
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+		const uint32_t blockSize = GetBlockByteSize(eFormat);
+
+		JobSystem::getInstance().ParallelFor(blocksY, 1, [&](uint32_t begin, uint32_t end)
+		{
+			uint8_t texels[64];
+			for (uint32_t by = begin; by < end; ++by)
+			{
+				for (uint32_t bx = 0; bx < blocksX; ++bx)
+				{
+					for (uint32_t y = 0; y < 4; ++y)
+					{
+						const uint32_t srcY = std::min(by * 4 + y, height - 1);
+						for (uint32_t x = 0; x < 4; ++x)
+						{
+							const uint32_t srcX = std::min(bx * 4 + x, width - 1);
+							memcpy(texels + (y * 4 + x) * 4, pRGBA + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+						}
+					}
+
+					uint8_t* pBlock = pOut + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+					switch (eFormat)
+					{
+						case TextureFormat::BC1:	EncodeBlockBC1(texels, pBlock, ePreset);		break;
+						case TextureFormat::BC4:	EncodeBlockBC4(texels, pBlock, ePreset, 0);		break;
+						case TextureFormat::BC5:	EncodeBlockBC5(texels, pBlock, ePreset);		break;
+						case TextureFormat::BC7:	EncodeBlockBC7(texels, pBlock, ePreset);		break;
+						default:																	break;
+					}
+				}
+			}
+		});
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecompressImage(const uint8_t* pData, uint32_t width, uint32_t height, TextureFormat eFormat, uint8_t* pRGBA)
+	{
+		if (!IsBlockCompressed(eFormat))
+		{
+			memcpy(pRGBA, pData, ComputeLevelByteSize(eFormat, width, height));
+			return;
+		}
+
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+		const uint32_t blockSize = GetBlockByteSize(eFormat);
+
+		JobSystem::getInstance().ParallelFor(blocksY, 4, [&](uint32_t begin, uint32_t end)
+		{
+			uint8_t texels[64];
+			for (uint32_t by = begin; by < end; ++by)
+			{
+				for (uint32_t bx = 0; bx < blocksX; ++bx)
+				{
+					const uint8_t* pBlock = pData + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+					switch (eFormat)
+					{
+						case TextureFormat::BC1:	DecodeBlockBC1(pBlock, texels);		break;
+						case TextureFormat::BC4:	DecodeBlockBC4(pBlock, texels, 0);	break;
+						case TextureFormat::BC5:
+						{
+							DecodeBlockBC5(pBlock, texels);
+							for (uint32_t i = 0; i < 16; ++i)
+							{
+								texels[i * 4 + 2] = 0;
+								texels[i * 4 + 3] = 255;
+							}
+							break;
+						}
+						case TextureFormat::BC7:	DecodeBlockBC7(pBlock, texels);		break;
+						default:														break;
+					}
+
+					for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+					{
+						for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+							memcpy(pRGBA + (static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+					}
+				}
+			}
+		});
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CompressImageBC6H(const float* pRGBA, uint32_t width, uint32_t height, CompressionPreset ePreset, uint8_t* pOut)
+	{
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+
+		JobSystem::getInstance().ParallelFor(blocksY, 1, [&](uint32_t begin, uint32_t end)
+		{
+			float texels[64];
+			for (uint32_t by = begin; by < end; ++by)
+			{
+				for (uint32_t bx = 0; bx < blocksX; ++bx)
+				{
+					for (uint32_t y = 0; y < 4; ++y)
+					{
+						const uint32_t srcY = std::min(by * 4 + y, height - 1);
+						for (uint32_t x = 0; x < 4; ++x)
+						{
+							const uint32_t srcX = std::min(bx * 4 + x, width - 1);
+							memcpy(texels + (y * 4 + x) * 4, pRGBA + (static_cast<size_t>(srcY) * width + srcX) * 4, 4 * sizeof(float));
+						}
+					}
+
+					EncodeBlockBC6H(texels, pOut + (static_cast<size_t>(by) * blocksX + bx) * 16, ePreset);
+				}
+			}
+		});
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecompressImageBC6H(const uint8_t* pData, uint32_t width, uint32_t height, float* pRGBA)
+	{
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+
+		JobSystem::getInstance().ParallelFor(blocksY, 4, [&](uint32_t begin, uint32_t end)
+		{
+			float texels[64];
+			for (uint32_t by = begin; by < end; ++by)
+			{
+				for (uint32_t bx = 0; bx < blocksX; ++bx)
+				{
+					DecodeBlockBC6H(pData + (static_cast<size_t>(by) * blocksX + bx) * 16, texels);
+
+					for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+					{
+						for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+							memcpy(pRGBA + (static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4, texels + (y * 4 + x) * 4, 4 * sizeof(float));
+					}
+				}
+			}
+		});
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float ComputePSNR(const uint8_t* pRGBA, const uint8_t* pReference, uint32_t width, uint32_t height, uint32_t channelMask)
+	{
+		double sum = 0.0;
+		uint64_t count = 0;
+
+		for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				if (!(channelMask & (1u << c)))
+					continue;
+
+				const double d = static_cast<double>(pRGBA[i * 4 + c]) - pReference[i * 4 + c];
+				sum += d * d;
+				++count;
+			}
+		}
+
+		if (count == 0 || sum == 0.0)
+			return 99.0f;
+
+		const double mse = sum / count;
+		return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / mse));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float ComputeLogPSNR(const float* pRGBA, const float* pReference, size_t texelCount)
+	{
+		// Below the smallest normal half there's no precision left to measure
+		const float minValue = 1.0f / 16384.0f;
+
+		double sum = 0.0;
+		float referenceMin = FLT_MAX;
+		float referenceMax = -FLT_MAX;
+
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const float value = std::log2(std::max(pRGBA[i * 4 + c], minValue));
+				const float reference = std::log2(std::max(pReference[i * 4 + c], minValue));
+
+				const double d = static_cast<double>(value) - reference;
+				sum += d * d;
+
+				referenceMin = std::min(referenceMin, reference);
+				referenceMax = std::max(referenceMax, reference);
+			}
+		}
+
+		if (texelCount == 0 || sum == 0.0)
+			return 99.0f;
+
+		// A flat reference still gets a one stop peak so the number stays meaningful
+		const double peak = std::max(referenceMax - referenceMin, 1.0f);
+		const double mse = sum / (texelCount * 3);
+		return static_cast<float>(10.0 * std::log10(peak * peak / mse));
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class TextureFormat
+	{
+		RGBA8,
+		BC1,						// RGB, 4 bits per texel
+		BC4,						// Single channel (R), 4 bits per texel
+		BC5,						// Two channels (RG), 8 bits per texel, normal maps with z rebuilt in the shader
+		BC7,						// RGBA, 8 bits per texel
+		BC6H,						// Unsigned half float RGB, 8 bits per texel
+		RGBA16F,					// Half float RGBA, 64 bits per texel
+		RGBA32F,					// Float RGBA, 128 bits per texel
+		E5B9G9R9					// Unsigned RGB with a shared 5 bit exponent, 32 bits per texel
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class CompressionPreset
+	{
+		FAST,						// Principal axis endpoints & one refinement, BC7 mode 6 & BC6H mode 11 only
+		QUALITY						// More refinement, both BC4 modes, BC7 modes 1, 5 & 6 with a partition search, BC6H modes
+									// 10 to 14
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline bool IsBlockCompressed(TextureFormat eFormat)
+	{
+		return eFormat == TextureFormat::BC1 || eFormat == TextureFormat::BC4 || eFormat == TextureFormat::BC5 || eFormat == TextureFormat::BC7 ||
+			   eFormat == TextureFormat::BC6H;
+	}
+
+	inline bool IsFloatFormat(TextureFormat eFormat)
+	{
+		return eFormat == TextureFormat::RGBA16F || eFormat == TextureFormat::RGBA32F || eFormat == TextureFormat::E5B9G9R9 ||
+			   eFormat == TextureFormat::BC6H;
+	}
+
+	const char*						GetTextureFormatName(TextureFormat eFormat);
+
+	// Bytes per 4x4 block, or per texel for uncompressed formats
+	uint32_t						GetBlockByteSize(TextureFormat eFormat);
+
+	// Bytes for one mip level, partial blocks at the edges count as whole blocks
+	size_t							ComputeLevelByteSize(TextureFormat eFormat, uint32_t width, uint32_t height);
+
+	//--- Single block codecs. pRGBA is 16 texels, row major. BC4 reads R, BC5 reads R & G.
+	void							EncodeBlockBC1(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset);
+	void							EncodeBlockBC4(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset, uint32_t channel = 0);
+	void							EncodeBlockBC5(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset);
+	void							EncodeBlockBC7(const uint8_t* pRGBA, uint8_t* pBlock, CompressionPreset ePreset);
+
+	// BC7 decoding covers the modes EncodeBlockBC7 writes (1, 5 & 6), other modes decode to magenta
+	void							DecodeBlockBC1(const uint8_t* pBlock, uint8_t* pRGBA);
+	void							DecodeBlockBC4(const uint8_t* pBlock, uint8_t* pRGBA, uint32_t channel = 0);
+	void							DecodeBlockBC5(const uint8_t* pBlock, uint8_t* pRGBA);
+	void							DecodeBlockBC7(const uint8_t* pBlock, uint8_t* pRGBA);
+
+	//--- BC6H unsigned, float RGBA in & out with alpha ignored & decoded as 1. Negative texels clamp to 0. Decoding covers
+	//--- the modes the encoder writes (10 to 14), other modes decode to magenta.
+	void							EncodeBlockBC6H(const float* pRGBA, uint8_t* pBlock, CompressionPreset ePreset);
+	void							DecodeBlockBC6H(const uint8_t* pBlock, float* pRGBA);
+
+	//--- Whole images. Rows of blocks get spread across the JobSystem, edge blocks replicate the last row & column.
+	//--- Uncompressed formats are copied as they are.
+	void							CompressImage(const uint8_t* pRGBA, uint32_t width, uint32_t height, TextureFormat eFormat,
+												  CompressionPreset ePreset, uint8_t* pOut);
+	void							DecompressImage(const uint8_t* pData, uint32_t width, uint32_t height, TextureFormat eFormat, uint8_t* pRGBA);
+
+	void							CompressImageBC6H(const float* pRGBA, uint32_t width, uint32_t height, CompressionPreset ePreset, uint8_t* pOut);
+	void							DecompressImageBC6H(const uint8_t* pData, uint32_t width, uint32_t height, float* pRGBA);
+
+	// PSNR in dB over the given channel mask (bit 0 = R ... bit 3 = A), 99 for identical images
+	float							ComputePSNR(const uint8_t* pRGBA, const uint8_t* pReference, uint32_t width, uint32_t height, uint32_t channelMask);
+
+	// PSNR in dB of log2 RGB with the reference's log2 range as the peak, so errors count relative to a texel's brightness.
+	// Values below the smallest normal half clamp to it, 99 for identical images.
+	float							ComputeLogPSNR(const float* pRGBA, const float* pReference, size_t texelCount);
+}
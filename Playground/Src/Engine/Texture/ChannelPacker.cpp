@@ -0,0 +1,176 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "ChannelPacker.h"
+
+#include "MipGenerator.h"
+#include "TextureCompiler.h"
+#include "stb_image.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ChannelSource
+	{
+		std::string		fileName;			// Empty for a constant white channel
+		uint32_t		channel;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct SourceImage
+	{
+		int				width = 0;
+		int				height = 0;
+		stbi_uc*		pData = nullptr;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Bilinear, so maps authored at different resolutions still line up
+	inline float SampleChannel(const SourceImage& image, uint32_t channel, float u, float v)
+	{
+		const float x = std::max(0.0f, u * image.width - 0.5f);
+		const float y = std::max(0.0f, v * image.height - 0.5f);
+		const int x0 = std::min(static_cast<int>(x), image.width - 1);
+		const int y0 = std::min(static_cast<int>(y), image.height - 1);
+		const int x1 = std::min(x0 + 1, image.width - 1);
+		const int y1 = std::min(y0 + 1, image.height - 1);
+		const float fx = x - x0;
+		const float fy = y - y0;
+
+		auto texel = [&image, channel](int tx, int ty) { return static_cast<float>(image.pData[(ty * image.width + tx) * 4 + channel]); };
+
+		const float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * fx;
+		const float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * fx;
+		return top + (bottom - top) * fy;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Packed file name from the sources, so materials sharing all three maps share the packed texture too
+	std::string MakePackedName(const ORMSources& sources)
+	{
+		const std::string key = sources.occlusion + "|" + sources.roughness + "|" + sources.metalness;
+
+		uint32_t hash = 0x811c9dc5u;
+		for (unsigned char c : key)
+		{
+			hash ^= c;
+			hash *= 0x01000193u;
+		}
+
+		const std::string& firstSource = !sources.roughness.empty() ? sources.roughness :
+										 (!sources.metalness.empty() ? sources.metalness : sources.occlusion);
+		const std::string stem = firstSource.empty() ? "Default" : std::filesystem::path(firstSource).stem().string();
+
+		char hashString[9];
+		snprintf(hashString, sizeof(hashString), "%08x", hash);
+		return "ORM/" + stem + "_" + hashString + "_ORM.png";
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::string ImportORMTexture(const ORMSources& sources)
+	{
+		// Occlusion/metallicRoughness in one file is already the layout the shaders read
+		if (!sources.roughness.empty() && sources.occlusion == sources.roughness && sources.metalness == sources.roughness)
+			return sources.roughness;
+
+		const bool bSharedRoughMetal = !sources.roughness.empty() && sources.roughness == sources.metalness;
+
+		// R-Occlusion, G-Roughness, B-Metalness
+		const ChannelSource arrChannels[3] =
+		{
+			{ sources.occlusion,	0 },
+			{ sources.roughness,	bSharedRoughMetal ? 1u : 0u },
+			{ sources.metalness,	bSharedRoughMetal ? 2u : 0u }
+		};
+
+		const std::string packedName = MakePackedName(sources);
+		const std::string packedPath = GetCompiledTexturePath(packedName, ContainerType::KTX2);
+
+		//--- Reuse the packed file unless a source changed since
+		bool bUpToDate = std::filesystem::exists(packedPath);
+		for (uint32_t i = 0; i < 3 && bUpToDate; ++i)
+		{
+			const std::string sourcePath = "Assets/Textures/" + arrChannels[i].fileName;
+			if (!arrChannels[i].fileName.empty() && std::filesystem::exists(sourcePath))
+				bUpToDate = std::filesystem::last_write_time(sourcePath) <= std::filesystem::last_write_time(packedPath);
+		}
+
+		if (bUpToDate)
+			return packedName;
+
+		//--- Load every distinct source once, the packed size is the largest of them
+		std::map<std::string, SourceImage> mapImages;
+		uint32_t width = 1;
+		uint32_t height = 1;
+		uint64_t sourceBytes = 0;
+
+		for (const ChannelSource& source : arrChannels)
+		{
+			if (source.fileName.empty() || mapImages.count(source.fileName) > 0)
+				continue;
+
+			SourceImage image;
+			int channels = 0;
+			image.pData = stbi_load(("Assets/Textures/" + source.fileName).c_str(), &image.width, &image.height, &channels, STBI_rgb_alpha);
+			if (!image.pData)
+			{
+				LOG_ERROR("Failed to load {0} for ORM packing, using white instead", source.fileName);
+				continue;
+			}
+
+			width = std::max(width, static_cast<uint32_t>(image.width));
+			height = std::max(height, static_cast<uint32_t>(image.height));
+			sourceBytes += static_cast<uint64_t>(image.width) * image.height * 4;
+			mapImages.emplace(source.fileName, image);
+		}
+
+		std::vector<uint8_t> vecPacked(static_cast<size_t>(width) * height * 4, 255);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			std::map<std::string, SourceImage>::const_iterator iter = mapImages.find(arrChannels[c].fileName);
+			if (iter == mapImages.end())
+				continue;
+
+			const SourceImage& image = iter->second;
+			const bool bSameSize = static_cast<uint32_t>(image.width) == width && static_cast<uint32_t>(image.height) == height;
+
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					uint8_t& dst = vecPacked[(static_cast<size_t>(y) * width + x) * 4 + c];
+					if (bSameSize)
+					{
+						dst = image.pData[(static_cast<size_t>(y) * width + x) * 4 + arrChannels[c].channel];
+					}
+					else
+					{
+						const float value = SampleChannel(image, arrChannels[c].channel, (x + 0.5f) / width, (y + 0.5f) / height);
+						dst = static_cast<uint8_t>(std::min(255.0f, value + 0.5f));
+					}
+				}
+			}
+		}
+
+		for (auto& image : mapImages)
+			stbi_image_free(image.second.pData);
+
+		//--- Channels are independent linear data, plain box filtered chain
+		std::vector<MipLevel> vecMipLevels;
+		GenerateMipChain(vecPacked.data(), width, height, MipSettings(), vecMipLevels);
+
+		std::vector<std::vector<uint8_t>> vecLevels(vecMipLevels.size());
+		for (uint32_t i = 0; i < vecMipLevels.size(); ++i)
+			vecLevels[i].swap(vecMipLevels[i].vecData);
+
+		std::filesystem::create_directories(std::filesystem::path(packedPath).parent_path());
+		if (!WriteTextureContainer(packedPath, TextureFormat::RGBA8, false, width, height, vecLevels))
+		{
+			LOG_ERROR("Failed to write packed ORM texture {0}", packedPath);
+		}
+
+		LOG_INFO("Packed {0} ORM sources into {1} ({2}x{3}), level 0 {4} KB -> {5} KB", mapImages.size(), packedPath, width, height,
+				 sourceBytes / 1024, vecPacked.size() / 1024);
+
+		return packedName;
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Files a material uses for occlusion, roughness & metalness, empty when it has none. Separate maps are read from
+	//--- their red channel. A file shared by roughness & metalness is a glTF style metallicRoughness map (G-Roughness,
+	//--- B-Metalness, R-Occlusion when it's also the occlusion map).
+	struct ORMSources
+	{
+		std::string		occlusion;
+		std::string		roughness;
+		std::string		metalness;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Import stage for TextureType::TEXTURE_ORM, returns the name to load it with. Maps already laid out as ORM are
+	//--- used as they are. Anything else gets packed once into an RGBA8 KTX2 with a full mip chain under
+	//--- Assets/Textures/Compiled/ORM, rebuilt only when a source is newer. Missing channels are white, ShaderData
+	//--- hasTextureORM decides if a channel is used.
+	std::string			ImportORMTexture(const ORMSources& sources);
+}
@@ -0,0 +1,268 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "EnvironmentSampling.h"
+
+#include <chrono>
+
+#include "glm/glm.hpp"
+
+#include "Engine/Helpers/JobSystem.h"
+#include "SphericalHarmonics.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline float EnvironmentLuminance(const float* pRGB)
+	{
+		return 0.2126f * pRGB[0] + 0.7152f * pRGB[1] + 0.0722f * pRGB[2];
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Inverse of EquirectDirection
+	inline glm::vec2 DirectionToEquirect(const glm::vec3& direction)
+	{
+		float phi = std::atan2(-direction.z, -direction.x);
+		if (phi < 0.0f)
+			phi += static_cast<float>(2.0 * M_PI);
+
+		const float theta = std::acos(glm::clamp(direction.y, -1.0f, 1.0f));
+
+		return glm::vec2(phi * static_cast<float>(0.5 / M_PI), 1.0f - theta * static_cast<float>(1.0 / M_PI));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t EquirectTexelIndex(const EnvironmentSampling& sampling, const glm::vec2& uv)
+	{
+		const uint32_t x = std::min(static_cast<uint32_t>(std::max(uv.x, 0.0f) * sampling.width), sampling.width - 1);
+		const uint32_t y = std::min(static_cast<uint32_t>(std::max(uv.y, 0.0f) * sampling.height), sampling.height - 1);
+
+		return y * sampling.width + x;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Unit square density to solid angle, the equirect Jacobian is 2 PI^2 sin(theta)
+	inline float TexelPdfToSolidAngle(float texelPdf, float sinTheta)
+	{
+		return sinTheta > 0.0f ? texelPdf / (static_cast<float>(2.0 * M_PI * M_PI) * sinTheta) : 0.0f;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Index of the interval of a normalized CDF that holds u, with u's position inside it
+	inline uint32_t SampleCDF(const float* pCDF, uint32_t count, float u, float& outOffset)
+	{
+		const float* pUpper = std::upper_bound(pCDF, pCDF + count + 1, u);
+		const uint32_t index = std::min(static_cast<uint32_t>(std::max<ptrdiff_t>(pUpper - pCDF - 1, 0)), count - 1);
+
+		const float width = pCDF[index + 1] - pCDF[index];
+		outOffset = width > 0.0f ? glm::clamp((u - pCDF[index]) / width, 0.0f, 0.99999994f) : 0.5f;
+
+		return index;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BuildEnvironmentSampling(const float* pRGBA, uint32_t width, uint32_t height, EnvironmentSampling& outSampling,
+								  EnvironmentSamplingReport* pOutReport)
+	{
+		const auto cdfStart = std::chrono::high_resolution_clock::now();
+
+		const size_t texelCount = static_cast<size_t>(width) * height;
+
+		outSampling.width = width;
+		outSampling.height = height;
+		outSampling.vecRadiance.resize(texelCount * 3);
+		outSampling.vecConditionalCDF.resize(static_cast<size_t>(width + 1) * height);
+		outSampling.vecMarginalCDF.resize(height + 1);
+		outSampling.vecTexelPdf.resize(texelCount);
+		outSampling.vecAlias.resize(texelCount);
+
+		// Texel weights go into vecTexelPdf for now, normalized once the total is known
+		std::vector<float> vecRowWeights(height);
+
+		JobSystem::getInstance().ParallelFor(height, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				const float sinTheta = std::sin(static_cast<float>(M_PI) * (1.0f - (y + 0.5f) / height));
+
+				float* pCDF = &outSampling.vecConditionalCDF[static_cast<size_t>(y) * (width + 1)];
+				pCDF[0] = 0.0f;
+
+				// Double keeps a bright row from swallowing its dim texels
+				double rowSum = 0.0;
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					const size_t texel = static_cast<size_t>(y) * width + x;
+					const float* pSrc = &pRGBA[texel * 4];
+
+					float* pRadiance = &outSampling.vecRadiance[texel * 3];
+					pRadiance[0] = pSrc[0];
+					pRadiance[1] = pSrc[1];
+					pRadiance[2] = pSrc[2];
+
+					const float weight = std::max(EnvironmentLuminance(pRadiance), 0.0f) * sinTheta;
+					outSampling.vecTexelPdf[texel] = weight;
+
+					rowSum += weight;
+					pCDF[x + 1] = static_cast<float>(rowSum);
+				}
+
+				vecRowWeights[y] = static_cast<float>(rowSum);
+
+				// A black row never gets picked by the marginal, a uniform CDF just keeps the table well formed
+				for (uint32_t x = 1; x <= width; ++x)
+					pCDF[x] = rowSum > 0.0 ? static_cast<float>(pCDF[x] / rowSum) : static_cast<float>(x) / width;
+
+				pCDF[width] = 1.0f;
+			}
+		});
+
+		double total = 0.0;
+		outSampling.vecMarginalCDF[0] = 0.0f;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			total += vecRowWeights[y];
+			outSampling.vecMarginalCDF[y + 1] = static_cast<float>(total);
+		}
+
+		for (uint32_t y = 1; y <= height; ++y)
+			outSampling.vecMarginalCDF[y] = total > 0.0 ? static_cast<float>(outSampling.vecMarginalCDF[y] / total) : static_cast<float>(y) / height;
+
+		outSampling.vecMarginalCDF[height] = 1.0f;
+		outSampling.totalWeight = static_cast<float>(total);
+
+		// Density over the unit square, the same for both samplers
+		const double pdfScale = total > 0.0 ? texelCount / total : 0.0;
+		JobSystem::getInstance().ParallelFor(height, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (size_t texel = static_cast<size_t>(begin) * width; texel < static_cast<size_t>(end) * width; ++texel)
+				outSampling.vecTexelPdf[texel] = total > 0.0 ? static_cast<float>(outSampling.vecTexelPdf[texel] * pdfScale) : 1.0f;
+		});
+
+		const auto aliasStart = std::chrono::high_resolution_clock::now();
+
+		//--- Vose, texels scaled so the average is 1. Below average ones get topped up from one above average texel each.
+		std::vector<uint32_t> vecSmall, vecLarge;
+		vecSmall.reserve(texelCount);
+		vecLarge.reserve(texelCount);
+
+		// Double, a sun texel scaled in the thousands hands out its excess over many steps
+		std::vector<double> vecScaled(outSampling.vecTexelPdf.begin(), outSampling.vecTexelPdf.end());
+		for (size_t texel = 0; texel < texelCount; ++texel)
+		{
+			if (vecScaled[texel] < 1.0f)
+				vecSmall.push_back(static_cast<uint32_t>(texel));
+			else
+				vecLarge.push_back(static_cast<uint32_t>(texel));
+		}
+
+		while (!vecSmall.empty() && !vecLarge.empty())
+		{
+			const uint32_t small = vecSmall.back();
+			const uint32_t large = vecLarge.back();
+			vecSmall.pop_back();
+
+			outSampling.vecAlias[small].probability = static_cast<float>(vecScaled[small]);
+			outSampling.vecAlias[small].alias = large;
+
+			vecScaled[large] -= 1.0f - vecScaled[small];
+			if (vecScaled[large] < 1.0f)
+			{
+				vecLarge.pop_back();
+				vecSmall.push_back(large);
+			}
+		}
+
+		// Whatever is left is 1 up to float rounding
+		for (uint32_t texel : vecLarge)
+			outSampling.vecAlias[texel] = { 1.0f, texel };
+
+		for (uint32_t texel : vecSmall)
+			outSampling.vecAlias[texel] = { 1.0f, texel };
+
+		const auto buildEnd = std::chrono::high_resolution_clock::now();
+
+		if (pOutReport)
+		{
+			pOutReport->cdfMs = std::chrono::duration<float, std::milli>(aliasStart - cdfStart).count();
+			pOutReport->aliasMs = std::chrono::duration<float, std::milli>(buildEnd - aliasStart).count();
+			pOutReport->threadCount = JobSystem::getInstance().GetThreadCount();
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::vec3 LookupEnvironment(const EnvironmentSampling& sampling, const glm::vec3& direction)
+	{
+		const float* pRadiance = &sampling.vecRadiance[static_cast<size_t>(EquirectTexelIndex(sampling, DirectionToEquirect(direction))) * 3];
+		return glm::vec3(pRadiance[0], pRadiance[1], pRadiance[2]);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float EnvironmentPdf(const EnvironmentSampling& sampling, const glm::vec3& direction)
+	{
+		const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - direction.y * direction.y));
+		return TexelPdfToSolidAngle(sampling.vecTexelPdf[EquirectTexelIndex(sampling, DirectionToEquirect(direction))], sinTheta);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Shared tail of both samplers, uv inside texel (x, y)
+	inline EnvironmentSample MakeEnvironmentSample(const EnvironmentSampling& sampling, uint32_t x, uint32_t y, float offsetX, float offsetY)
+	{
+		const uint32_t texel = y * sampling.width + x;
+		const float u = (x + offsetX) / sampling.width;
+		const float v = (y + offsetY) / sampling.height;
+
+		const float* pRadiance = &sampling.vecRadiance[static_cast<size_t>(texel) * 3];
+
+		EnvironmentSample sample;
+		sample.direction = EquirectDirection(u, v);
+		sample.radiance = glm::vec3(pRadiance[0], pRadiance[1], pRadiance[2]);
+		sample.pdf = TexelPdfToSolidAngle(sampling.vecTexelPdf[texel], std::sin(static_cast<float>(M_PI) * (1.0f - v)));
+
+		return sample;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	EnvironmentSample SampleEnvironmentCDF(const EnvironmentSampling& sampling, const glm::vec2& u)
+	{
+		float offsetY, offsetX;
+		const uint32_t y = SampleCDF(sampling.vecMarginalCDF.data(), sampling.height, u.y, offsetY);
+		const uint32_t x = SampleCDF(&sampling.vecConditionalCDF[static_cast<size_t>(y) * (sampling.width + 1)], sampling.width, u.x, offsetX);
+
+		return MakeEnvironmentSample(sampling, x, y, offsetX, offsetY);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	EnvironmentSample SampleEnvironmentAlias(const EnvironmentSampling& sampling, const glm::vec3& u)
+	{
+		const uint32_t texelCount = sampling.width * sampling.height;
+		uint32_t texel = std::min(static_cast<uint32_t>(u.x * texelCount), texelCount - 1);
+
+		// Whichever branch is taken, the decision rescaled to [0, 1) is a fresh uniform for the row offset
+		const EnvironmentAliasEntry& entry = sampling.vecAlias[texel];
+		float offsetY;
+		if (u.y < entry.probability)
+		{
+			offsetY = u.y / entry.probability;
+		}
+		else
+		{
+			offsetY = (u.y - entry.probability) / (1.0f - entry.probability);
+			texel = entry.alias;
+		}
+
+		return MakeEnvironmentSample(sampling, texel % sampling.width, texel / sampling.width, u.z, glm::clamp(offsetY, 0.0f, 0.99999994f));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void PackEnvironmentAliasGPU(const EnvironmentSampling& sampling, std::vector<EnvironmentAliasGPU>& vecOut)
+	{
+		vecOut.resize(sampling.vecAlias.size());
+		for (size_t texel = 0; texel < vecOut.size(); ++texel)
+		{
+			vecOut[texel].probability = sampling.vecAlias[texel].probability;
+			vecOut[texel].alias = sampling.vecAlias[texel].alias;
+			vecOut[texel].texelPdf = sampling.vecTexelPdf[texel];
+			vecOut[texel].padding = 0.0f;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Vose alias table entry, a texel keeps itself with probability & otherwise hands over to alias
+	struct EnvironmentAliasEntry
+	{
+		float					probability;
+		uint32_t				alias;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Luminance weighted sampling tables of an equirect in the Texture::EquirectDirection mapping (row 0 at the bottom).
+	//--- Texel weights are luminance * sin(theta), so both samplers draw directions proportional to radiance per solid angle.
+	struct EnvironmentSampling
+	{
+		uint32_t							width = 0;
+		uint32_t							height = 0;
+		std::vector<float>					vecRadiance;			// RGB per texel, what the pdfs are built against
+		std::vector<float>					vecMarginalCDF;			// height + 1 entries over the rows
+		std::vector<float>					vecConditionalCDF;		// width + 1 entries per row
+		std::vector<EnvironmentAliasEntry>	vecAlias;				// width * height
+		std::vector<float>					vecTexelPdf;			// Density over the unit square, width * height * p(texel)
+		float								totalWeight = 0.0f;		// Sum of the texel weights, 0 falls back to uniform
+
+		bool								IsValid() const { return width > 0 && height > 0; }
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct EnvironmentSample
+	{
+		glm::vec3				direction;
+		glm::vec3				radiance;
+		float					pdf;					// Per steradian, 0 for a direction that can't be sampled
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct EnvironmentSamplingReport
+	{
+		float					cdfMs;
+		float					aliasMs;
+		uint32_t				threadCount;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- 16 bytes per texel, the layout envSampling.glsl reads from a storage buffer. pdf is vecTexelPdf, so one fetch gives
+	//--- both the alias decision & the pdf of a direction that came from elsewhere (BSDF samples under MIS).
+	struct EnvironmentAliasGPU
+	{
+		float					probability;
+		uint32_t				alias;
+		float					texelPdf;
+		float					padding;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Rows of the conditional CDFs & the weights build in parallel, the marginal CDF & alias table in one serial pass
+	void						BuildEnvironmentSampling(const float* pRGBA, uint32_t width, uint32_t height, EnvironmentSampling& outSampling,
+														 EnvironmentSamplingReport* pOutReport = nullptr);
+
+	//--- Nearest texel, the piecewise constant radiance the pdfs describe
+	glm::vec3					LookupEnvironment(const EnvironmentSampling& sampling, const glm::vec3& direction);
+	float						EnvironmentPdf(const EnvironmentSampling& sampling, const glm::vec3& direction);
+
+	//--- Inversion of the 2D CDF, two binary searches. Continuous inside the texel, so stratified u stays stratified.
+	EnvironmentSample			SampleEnvironmentCDF(const EnvironmentSampling& sampling, const glm::vec2& u);
+
+	//--- O(1) alias lookup. u.x picks the texel, u.y decides between it & its alias & gets reused for the row offset, u.z is
+	//--- the column offset. A 2k map has 2^21 texels, so the decision can't come from u.x's leftover bits.
+	EnvironmentSample			SampleEnvironmentAlias(const EnvironmentSampling& sampling, const glm::vec3& u);
+
+	void						PackEnvironmentAliasGPU(const EnvironmentSampling& sampling, std::vector<EnvironmentAliasGPU>& vecOut);
+}
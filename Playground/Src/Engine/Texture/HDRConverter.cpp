@@ -0,0 +1,818 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "HDRConverter.h"
+
+#include <chrono>
+
+#include "glm/glm.hpp"
+
+#include "Engine/Helpers/JobSystem.h"
+#include "TextureCompiler.h"
+#include "TextureContainer.h"
+#include "stb_image.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define HDR_CONVERTER_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define HDR_CONVERTER_F16C_TARGET
+	#else
+		#include <cpuid.h>
+		#define HDR_CONVERTER_F16C_TARGET __attribute__((target("avx,f16c")))
+	#endif
+#else
+	#define HDR_CONVERTER_X86 0
+#endif
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Scalar conversions
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		const uint32_t absBits = bits & 0x7FFFFFFF;
+
+		// Inf & NaN, NaNs keep their top payload bits & stay quiet
+		if (absBits >= 0x7F800000)
+			return sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 | ((absBits >> 13) & 0x3FF) : 0);
+
+		// 65520 & above round to infinity
+		if (absBits >= 0x477FF000)
+			return sign | 0x7C00;
+
+		// Below the smallest normal half, shift the mantissa with its implicit bit into a subnormal
+		if (absBits < 0x38800000)
+		{
+			const uint32_t exponent = absBits >> 23;
+			if (exponent < 102)
+				return sign;
+
+			const uint32_t mantissa = (absBits & 0x7FFFFF) | 0x800000;
+			const uint32_t shift = 126 - exponent;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+
+			uint32_t result = mantissa >> shift;
+			if (remainder > halfway || (remainder == halfway && (result & 1)))
+				++result;
+
+			return sign | static_cast<uint16_t>(result);
+		}
+
+		// Rebias the exponent, a rounding carry moves into the exponent on its own
+		uint32_t result = (absBits - 0x38000000) >> 13;
+		const uint32_t remainder = absBits & 0x1FFF;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1)))
+			++result;
+
+		return sign | static_cast<uint16_t>(result);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float HalfToFloat(uint16_t value)
+	{
+		const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+		const uint32_t exponent = (value >> 10) & 0x1F;
+		const uint32_t mantissa = value & 0x3FF;
+
+		uint32_t bits;
+		if (exponent == 0x1F)
+		{
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+		else
+		{
+			const float subnormal = mantissa * (1.0f / 16777216.0f);
+			return sign ? -subnormal : subnormal;
+		}
+
+		float result;
+		memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Vulkan spec "Shared Exponent Format Conversion", N = 9 mantissa bits, B = 15, Emax = 31
+	uint32_t PackE5B9G9R9(float r, float g, float b)
+	{
+		const float SHAREDEXP_MAX = 511.0f / 512.0f * 65536.0f;
+
+		// NaN fails both comparisons & ends up 0
+		auto clampChannel = [SHAREDEXP_MAX](float value) { return value > 0.0f ? std::min(value, SHAREDEXP_MAX) : 0.0f; };
+
+		const float rc = clampChannel(r);
+		const float gc = clampChannel(g);
+		const float bc = clampChannel(b);
+		const float maxc = std::max(rc, std::max(gc, bc));
+
+		// floor(log2(maxc)) straight from the exponent bits, float denormals are far below the -16 clamp
+		uint32_t maxBits;
+		memcpy(&maxBits, &maxc, sizeof(maxBits));
+		int sharedExponent = std::max(-16, static_cast<int>(maxBits >> 23) - 127) + 1 + 15;
+
+		// 2^-(sharedExponent - B - N) built from its bits, the channels are never negative so +0.5 & truncation is floor(x + 0.5)
+		auto makeScale = [](int exponent)
+		{
+			const uint32_t scaleBits = static_cast<uint32_t>(127 + 15 + 9 - exponent) << 23;
+			float scale;
+			memcpy(&scale, &scaleBits, sizeof(scale));
+			return scale;
+		};
+
+		float scale = makeScale(sharedExponent);
+		if (static_cast<uint32_t>(maxc * scale + 0.5f) >= 512)
+			scale = makeScale(++sharedExponent);
+
+		const uint32_t rs = static_cast<uint32_t>(rc * scale + 0.5f);
+		const uint32_t gs = static_cast<uint32_t>(gc * scale + 0.5f);
+		const uint32_t bs = static_cast<uint32_t>(bc * scale + 0.5f);
+
+		return rs | (gs << 9) | (bs << 18) | (static_cast<uint32_t>(sharedExponent) << 27);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void UnpackE5B9G9R9(uint32_t value, float* pRGB)
+	{
+		const float scale = std::ldexp(1.0f, static_cast<int>(value >> 27) - 15 - 9);
+		pRGB[0] = (value & 0x1FF) * scale;
+		pRGB[1] = ((value >> 9) & 0x1FF) * scale;
+		pRGB[2] = ((value >> 18) & 0x1FF) * scale;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- F16C
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool HasF16C()
+	{
+#if HDR_CONVERTER_X86
+		static const bool bSupported = []()
+		{
+			uint32_t ecx = 0;
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			ecx = static_cast<uint32_t>(info[2]);
+#else
+			uint32_t eax = 0, ebx = 0, edx = 0;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+				return false;
+#endif
+			// F16C is VEX encoded, the OS has to save YMM state (OSXSAVE + XCR0 bits 1 & 2)
+			const uint32_t requiredBits = (1u << 27) | (1u << 28) | (1u << 29);
+			if ((ecx & requiredBits) != requiredBits)
+				return false;
+
+#if defined(_MSC_VER)
+			const uint64_t xcr0 = _xgetbv(0);
+#else
+			uint32_t xcr0Low = 0, xcr0High = 0;
+			__asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+			const uint64_t xcr0 = xcr0Low | (static_cast<uint64_t>(xcr0High) << 32);
+#endif
+			return (xcr0 & 0x6) == 0x6;
+		}();
+
+		return bSupported;
+#else
+		return false;
+#endif
+	}
+
+#if HDR_CONVERTER_X86
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Eight floats per instruction, round to nearest even like FloatToHalf
+	HDR_CONVERTER_F16C_TARGET void ConvertToHalfF16C(const float* pSrc, uint16_t* pDst, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm256_cvtps_ph(_mm256_loadu_ps(pSrc + i), _MM_FROUND_TO_NEAREST_INT));
+
+		for (; i < count; ++i)
+			pDst[i] = FloatToHalf(pSrc[i]);
+	}
+#endif
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void ConvertHDRTexels(const float* pRGBA, size_t count, TextureFormat eFormat, uint8_t* pDst)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::RGBA16F:
+			{
+				uint16_t* pHalf = reinterpret_cast<uint16_t*>(pDst);
+#if HDR_CONVERTER_X86
+				if (HasF16C())
+				{
+					ConvertToHalfF16C(pRGBA, pHalf, count * 4);
+					break;
+				}
+#endif
+				for (size_t i = 0; i < count * 4; ++i)
+					pHalf[i] = FloatToHalf(pRGBA[i]);
+				break;
+			}
+
+			case TextureFormat::E5B9G9R9:
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					const uint32_t packed = PackE5B9G9R9(pRGBA[i * 4], pRGBA[i * 4 + 1], pRGBA[i * 4 + 2]);
+					memcpy(pDst + i * 4, &packed, sizeof(packed));
+				}
+				break;
+			}
+
+			default:
+				memcpy(pDst, pRGBA, count * 4 * sizeof(float));
+				break;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeHDRTexels(const uint8_t* pSrc, size_t count, TextureFormat eFormat, float* pRGBA)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::RGBA16F:
+			{
+				const uint16_t* pHalf = reinterpret_cast<const uint16_t*>(pSrc);
+				for (size_t i = 0; i < count * 4; ++i)
+					pRGBA[i] = HalfToFloat(pHalf[i]);
+				break;
+			}
+
+			case TextureFormat::E5B9G9R9:
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					uint32_t packed;
+					memcpy(&packed, pSrc + i * 4, sizeof(packed));
+
+					UnpackE5B9G9R9(packed, pRGBA + i * 4);
+					pRGBA[i * 4 + 3] = 1.0f;
+				}
+				break;
+			}
+
+			default:
+				memcpy(pRGBA, pSrc, count * 4 * sizeof(float));
+				break;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Radiance .hdr
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Header lines up to the blank line, then "-Y height +X width". Only the orientation stb_image reads is accepted.
+	bool ParseRadianceHeader(const std::vector<uint8_t>& vecFile, uint32_t& outWidth, uint32_t& outHeight, size_t& outDataOffset)
+	{
+		size_t offset = 0;
+		auto readLine = [&vecFile, &offset](std::string& line)
+		{
+			line.clear();
+			while (offset < vecFile.size() && vecFile[offset] != '\n')
+				line.push_back(static_cast<char>(vecFile[offset++]));
+
+			if (offset >= vecFile.size())
+				return false;
+
+			++offset;
+			return true;
+		};
+
+		std::string line;
+		if (!readLine(line) || (line.compare(0, 10, "#?RADIANCE") != 0 && line.compare(0, 6, "#?RGBE") != 0))
+			return false;
+
+		bool bRGBE = false;
+		while (readLine(line) && !line.empty())
+		{
+			if (line == "FORMAT=32-bit_rle_rgbe")
+				bRGBE = true;
+		}
+
+		if (!bRGBE || !readLine(line))
+			return false;
+
+		int height = 0, width = 0;
+		if (sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0)
+			return false;
+
+		outWidth = static_cast<uint32_t>(width);
+		outHeight = static_cast<uint32_t>(height);
+		outDataOffset = offset;
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Walks the run lengths only, so every scanline's start is known before the parallel decode. False for files using
+	//--- flat or old style RLE scanlines, whose lengths can't be known without decoding.
+	bool LocateScanlines(const std::vector<uint8_t>& vecFile, size_t offset, uint32_t width, uint32_t height, std::vector<size_t>& vecOutOffsets)
+	{
+		if (width < 8 || width > 0x7FFF)
+			return false;
+
+		vecOutOffsets.resize(height);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			if (offset + 4 > vecFile.size())
+				return false;
+
+			const uint8_t* pHeader = &vecFile[offset];
+			if (pHeader[0] != 2 || pHeader[1] != 2 || (pHeader[2] & 0x80) || static_cast<uint32_t>((pHeader[2] << 8) | pHeader[3]) != width)
+				return false;
+
+			vecOutOffsets[y] = offset;
+			offset += 4;
+
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				uint32_t x = 0;
+				while (x < width)
+				{
+					if (offset >= vecFile.size())
+						return false;
+
+					uint32_t count = vecFile[offset++];
+					if (count > 128)
+					{
+						count -= 128;
+						offset += 1;
+					}
+					else
+					{
+						offset += count;
+					}
+
+					if (count == 0 || count > width - x)
+						return false;
+
+					x += count;
+				}
+			}
+
+			if (offset > vecFile.size())
+				return false;
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- One scanline already validated by LocateScanlines, into planar R, G, B & E
+	void DecodeScanline(const uint8_t* pData, uint32_t width, uint8_t* pPlanar)
+	{
+		pData += 4;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			uint8_t* pChannel = pPlanar + c * width;
+			uint32_t x = 0;
+			while (x < width)
+			{
+				uint32_t count = *pData++;
+				if (count > 128)
+				{
+					count -= 128;
+					memset(pChannel + x, *pData++, count);
+				}
+				else
+				{
+					memcpy(pChannel + x, pData, count);
+					pData += count;
+				}
+
+				x += count;
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Same expansion as stb_image, so both paths produce identical floats. pScales holds 2^(e - 136) per exponent byte.
+	inline void RGBEToFloat(uint8_t r, uint8_t g, uint8_t b, uint8_t e, const float* pScales, float* pRGBA)
+	{
+		const float scale = pScales[e];
+		pRGBA[0] = r * scale;
+		pRGBA[1] = g * scale;
+		pRGBA[2] = b * scale;
+		pRGBA[3] = 1.0f;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool DecodeRadianceParallel(const std::vector<uint8_t>& vecFile, TextureFormat eFormat, HDRImage& outImage)
+	{
+		uint32_t width = 0, height = 0;
+		size_t dataOffset = 0;
+		std::vector<size_t> vecScanlines;
+		if (!ParseRadianceHeader(vecFile, width, height, dataOffset) || !LocateScanlines(vecFile, dataOffset, width, height, vecScanlines))
+			return false;
+
+		const size_t rowBytes = ComputeLevelByteSize(eFormat, width, 1);
+
+		outImage.eFormat = eFormat;
+		outImage.width = width;
+		outImage.height = height;
+		outImage.vecData.resize(rowBytes * height);
+
+		// Exponent 0 is black whatever the mantissas say
+		float arrScales[256];
+		arrScales[0] = 0.0f;
+		for (int e = 1; e < 256; ++e)
+			arrScales[e] = std::ldexp(1.0f, e - (128 + 8));
+
+		JobSystem::getInstance().ParallelFor(height, 16, [&](uint32_t begin, uint32_t end)
+		{
+			std::vector<uint8_t> vecPlanar(static_cast<size_t>(width) * 4);
+			std::vector<float> vecRow(static_cast<size_t>(width) * 4);
+
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				DecodeScanline(&vecFile[vecScanlines[y]], width, vecPlanar.data());
+
+				const uint8_t* pR = vecPlanar.data();
+				const uint8_t* pG = pR + width;
+				const uint8_t* pB = pG + width;
+				const uint8_t* pE = pB + width;
+				for (uint32_t x = 0; x < width; ++x)
+					RGBEToFloat(pR[x], pG[x], pB[x], pE[x], arrScales, &vecRow[x * 4]);
+
+				// Bottom up, as stb_image with vertical flip gave the sky shaders
+				ConvertHDRTexels(vecRow.data(), width, eFormat, &outImage.vecData[(height - 1 - y) * rowBytes]);
+			}
+		});
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool DecodeWithStb(const std::string& filePath, TextureFormat eFormat, HDRImage& outImage)
+	{
+		int width = 0, height = 0, channels = 0;
+		float* pData = stbi_loadf(filePath.c_str(), &width, &height, &channels, 4);
+		if (!pData)
+			return false;
+
+		const size_t rowBytes = ComputeLevelByteSize(eFormat, width, 1);
+
+		outImage.eFormat = eFormat;
+		outImage.width = static_cast<uint32_t>(width);
+		outImage.height = static_cast<uint32_t>(height);
+		outImage.vecData.resize(rowBytes * height);
+
+		JobSystem::getInstance().ParallelFor(height, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+				ConvertHDRTexels(pData + static_cast<size_t>(y) * width * 4, width, eFormat, &outImage.vecData[(height - 1 - y) * rowBytes]);
+		});
+
+		stbi_image_free(pData);
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::string GetHDRCachePath(const std::string& filePath, TextureFormat eFormat)
+	{
+		std::string formatName = GetTextureFormatName(eFormat);
+		std::transform(formatName.begin(), formatName.end(), formatName.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		return GetCompiledTexturePath("HDRI/" + std::filesystem::path(filePath).stem().string() + "_" + formatName + ".hdr", ContainerType::DDS);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadHDRCache(const std::string& filePath, const std::string& cachePath, TextureFormat eFormat, HDRImage& outImage)
+	{
+		if (!std::filesystem::exists(cachePath))
+			return false;
+
+		if (std::filesystem::exists(filePath) && std::filesystem::last_write_time(filePath) > std::filesystem::last_write_time(cachePath))
+			return false;
+
+		ContainerInfo info;
+		if (!ReadContainerInfo(cachePath, info) || info.eFormat != eFormat || info.vecLevels.size() != 1)
+			return false;
+
+		outImage.eFormat = eFormat;
+		outImage.width = info.width;
+		outImage.height = info.height;
+		outImage.vecData.resize(static_cast<size_t>(info.GetTotalByteSize()));
+
+		std::vector<uint64_t> vecOffsets;
+		return ReadContainerLevels(cachePath, info, outImage.vecData.data(), vecOffsets);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool LoadHDRImage(const std::string& filePath, TextureFormat eFormat, HDRImage& outImage, HDRLoadReport* pOutReport, bool bUseCache)
+	{
+		const auto loadStart = std::chrono::high_resolution_clock::now();
+
+		HDRLoadReport report = {};
+
+		// RGBA32F is what the source decodes to anyway, a cache wouldn't save any work
+		const bool bCacheable = bUseCache && (eFormat == TextureFormat::RGBA16F || eFormat == TextureFormat::E5B9G9R9);
+		const std::string cachePath = bCacheable ? GetHDRCachePath(filePath, eFormat) : std::string();
+
+		bool bLoaded = false;
+		if (bCacheable && ReadHDRCache(filePath, cachePath, eFormat, outImage))
+		{
+			bLoaded = true;
+			report.bFromCache = true;
+		}
+
+		if (!bLoaded)
+		{
+			std::vector<uint8_t> vecFile;
+			std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+			if (file.is_open())
+			{
+				vecFile.resize(static_cast<size_t>(file.tellg()));
+				file.seekg(0);
+				file.read(reinterpret_cast<char*>(vecFile.data()), vecFile.size());
+			}
+
+			if (!vecFile.empty() && DecodeRadianceParallel(vecFile, eFormat, outImage))
+			{
+				bLoaded = true;
+				report.bParallel = true;
+			}
+			else
+			{
+				bLoaded = DecodeWithStb(filePath, eFormat, outImage);
+			}
+		}
+
+		if (!bLoaded)
+		{
+			LOG_ERROR("Failed to load HDRI {0}", filePath);
+			return false;
+		}
+
+		const auto loadEnd = std::chrono::high_resolution_clock::now();
+		report.loadMs = std::chrono::duration<float, std::milli>(loadEnd - loadStart).count();
+
+		if (bCacheable && !report.bFromCache)
+		{
+			// Lend the pixels to the writer instead of copying a few hundred MB for an 8k map
+			std::vector<std::vector<uint8_t>> vecLevels(1);
+			vecLevels[0].swap(outImage.vecData);
+
+			std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path());
+			if (!WriteTextureContainer(cachePath, eFormat, false, outImage.width, outImage.height, vecLevels))
+			{
+				LOG_WARNING("Failed to cache {0} as {1}", filePath, cachePath);
+			}
+
+			vecLevels[0].swap(outImage.vecData);
+		}
+
+		if (pOutReport)
+			*pOutReport = report;
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Benchmark
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Runs of 4+ equal bytes become run packets, everything else literal packets of up to 128 bytes
+	void EncodeRLEChannel(const uint8_t* pChannel, uint32_t width, std::vector<uint8_t>& vecOut)
+	{
+		auto runLength = [pChannel, width](uint32_t x, uint32_t maxRun)
+		{
+			uint32_t run = 1;
+			while (x + run < width && run < maxRun && pChannel[x + run] == pChannel[x])
+				++run;
+			return run;
+		};
+
+		uint32_t x = 0;
+		while (x < width)
+		{
+			const uint32_t run = runLength(x, 127);
+			if (run >= 4)
+			{
+				vecOut.push_back(static_cast<uint8_t>(128 + run));
+				vecOut.push_back(pChannel[x]);
+				x += run;
+				continue;
+			}
+
+			const uint32_t start = x;
+			while (x < width && x - start < 128 && runLength(x, 4) < 4)
+				++x;
+
+			vecOut.push_back(static_cast<uint8_t>(x - start));
+			vecOut.insert(vecOut.end(), pChannel + start, pChannel + x);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Sky gradient, a sun far above what RGBA8 can hold, ground & some texel noise so runs stay short like in photos
+	bool WriteSyntheticHDR(const std::string& filePath, uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> vecPlanar(static_cast<size_t>(width) * height * 4);
+
+		JobSystem::getInstance().ParallelFor(height, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				uint8_t* pRow = &vecPlanar[static_cast<size_t>(y) * width * 4];
+				const float elevation = (0.5f - (y + 0.5f) / height) * static_cast<float>(M_PI);
+
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					const float azimuth = ((x + 0.5f) / width) * 2.0f * static_cast<float>(M_PI);
+
+					uint32_t hash = (x * 73856093u) ^ (y * 19349663u);
+					hash = (hash ^ (hash >> 13)) * 0x5bd1e995u;
+					const float noise = 0.9f + 0.2f * ((hash >> 8) & 0xFFFF) / 65535.0f;
+
+					glm::vec3 color;
+					if (elevation > 0.0f)
+						color = glm::mix(glm::vec3(1.2f, 1.1f, 0.9f), glm::vec3(0.15f, 0.3f, 0.8f), std::sqrt(elevation / static_cast<float>(M_PI_OVER_TWO)));
+					else
+						color = glm::vec3(0.08f, 0.07f, 0.05f);
+
+					const glm::vec3 direction(std::cos(elevation) * std::cos(azimuth), std::sin(elevation), std::cos(elevation) * std::sin(azimuth));
+					const float sun = glm::dot(direction, glm::normalize(glm::vec3(0.5f, 0.6f, 0.3f)));
+					if (sun > 0.9995f)
+						color += glm::vec3(30000.0f, 28000.0f, 24000.0f);
+
+					color *= noise;
+
+					// float to RGBE, as in Greg Ward's reference code
+					const float maxChannel = std::max(color.x, std::max(color.y, color.z));
+					int exponent = 0;
+					const float scale = std::frexp(maxChannel, &exponent) * 256.0f / maxChannel;
+
+					pRow[x] = static_cast<uint8_t>(color.x * scale);
+					pRow[width + x] = static_cast<uint8_t>(color.y * scale);
+					pRow[width * 2 + x] = static_cast<uint8_t>(color.z * scale);
+					pRow[width * 3 + x] = static_cast<uint8_t>(exponent + 128);
+				}
+			}
+		});
+
+		std::vector<uint8_t> vecFile;
+		const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+		vecFile.insert(vecFile.end(), header.begin(), header.end());
+
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			vecFile.push_back(2);
+			vecFile.push_back(2);
+			vecFile.push_back(static_cast<uint8_t>(width >> 8));
+			vecFile.push_back(static_cast<uint8_t>(width & 0xFF));
+
+			for (uint32_t c = 0; c < 4; ++c)
+				EncodeRLEChannel(&vecPlanar[(static_cast<size_t>(y) * 4 + c) * width], width, vecFile);
+		}
+
+		std::ofstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(vecFile.data()), vecFile.size());
+		return file.good();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float ComputeMaxRelativeError(const HDRImage& image, const HDRImage& reference)
+	{
+		if (image.eFormat == TextureFormat::RGBA32F)
+			return 0.0f;
+
+		std::vector<float> vecRowErrors(image.height, 0.0f);
+		JobSystem::getInstance().ParallelFor(image.height, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				float maxError = 0.0f;
+				for (uint32_t x = 0; x < image.width; ++x)
+				{
+					const size_t texel = static_cast<size_t>(y) * image.width + x;
+					const float* pReference = reinterpret_cast<const float*>(reference.vecData.data()) + texel * 4;
+
+					float rgb[3];
+					if (image.eFormat == TextureFormat::RGBA16F)
+					{
+						const uint16_t* pHalf = reinterpret_cast<const uint16_t*>(image.vecData.data()) + texel * 4;
+						for (uint32_t c = 0; c < 3; ++c)
+							rgb[c] = HalfToFloat(pHalf[c]);
+					}
+					else
+					{
+						uint32_t packed;
+						memcpy(&packed, &image.vecData[texel * 4], sizeof(packed));
+						UnpackE5B9G9R9(packed, rgb);
+					}
+
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						if (pReference[c] > 1e-3f)
+							maxError = std::max(maxError, std::abs(rgb[c] - pReference[c]) / pReference[c]);
+					}
+				}
+
+				vecRowErrors[y] = maxError;
+			}
+		});
+
+		return vecRowErrors.empty() ? 0.0f : *std::max_element(vecRowErrors.begin(), vecRowErrors.end());
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<HDRBenchmarkResult> RunHDRBenchmark()
+	{
+		std::vector<HDRBenchmarkResult> vecResults;
+
+		const std::filesystem::path benchmarkDirectory = std::filesystem::temp_directory_path() / "PlaygroundHDRBenchmark";
+		std::filesystem::create_directories(benchmarkDirectory);
+
+		const uint32_t arrWidths[3] = { 2048, 4096, 8192 };
+		const TextureFormat arrFormats[2] = { TextureFormat::RGBA16F, TextureFormat::E5B9G9R9 };
+
+		LOG_INFO("HDRI benchmark, {0} threads, F16C {1}", JobSystem::getInstance().GetThreadCount(), HasF16C() ? "on" : "off");
+
+		for (uint32_t width : arrWidths)
+		{
+			const uint32_t height = width / 2;
+			const std::string filePath = (benchmarkDirectory / ("HDRBenchmark_" + std::to_string(width) + ".hdr")).string();
+			if (!WriteSyntheticHDR(filePath, width, height))
+			{
+				LOG_ERROR("Failed to write {0}", filePath);
+				continue;
+			}
+
+			auto addResult = [&vecResults, width, height](const std::string& method, TextureFormat eFormat, float loadMs, float maxError)
+			{
+				HDRBenchmarkResult result;
+				result.method = method;
+				result.eFormat = eFormat;
+				result.width = width;
+				result.height = height;
+				result.loadMs = loadMs;
+				result.cpuBytes = ComputeLevelByteSize(eFormat, width, height);
+				result.vramBytes = result.cpuBytes;
+				result.maxRelativeError = maxError;
+				vecResults.push_back(result);
+
+				LOG_INFO("HDRI {0}x{1} {2} {3}: {4:.1f} ms, CPU {5} MB, VRAM {6} MB, max error {7:.5f}", width, height, method,
+						 GetTextureFormatName(eFormat), loadMs, result.cpuBytes >> 20, result.vramBytes >> 20, maxError);
+			};
+
+			//--- What VulkanTexture2D used to do
+			{
+				const auto stbStart = std::chrono::high_resolution_clock::now();
+
+				int stbWidth = 0, stbHeight = 0, stbChannels = 0;
+				float* pData = stbi_loadf(filePath.c_str(), &stbWidth, &stbHeight, &stbChannels, 4);
+				stbi_image_free(pData);
+
+				const auto stbEnd = std::chrono::high_resolution_clock::now();
+				if (pData)
+					addResult("stb_image", TextureFormat::RGBA32F, std::chrono::duration<float, std::milli>(stbEnd - stbStart).count(), 0.0f);
+			}
+
+			HDRImage reference;
+			HDRLoadReport report;
+			if (!LoadHDRImage(filePath, TextureFormat::RGBA32F, reference, &report, false))
+				continue;
+
+			addResult("parallel", TextureFormat::RGBA32F, report.loadMs, 0.0f);
+
+			for (TextureFormat eFormat : arrFormats)
+			{
+				const std::string cachePath = GetHDRCachePath(filePath, eFormat);
+				std::filesystem::remove(cachePath);
+
+				HDRImage image;
+				if (!LoadHDRImage(filePath, eFormat, image, &report, false))
+					continue;
+
+				const float maxError = ComputeMaxRelativeError(image, reference);
+				addResult("parallel", eFormat, report.loadMs, maxError);
+
+				// First cached load writes the file, the second one is what later runs see
+				LoadHDRImage(filePath, eFormat, image, &report, true);
+				if (LoadHDRImage(filePath, eFormat, image, &report, true) && report.bFromCache)
+					addResult("cache", eFormat, report.loadMs, maxError);
+
+				std::filesystem::remove(cachePath);
+			}
+
+			std::filesystem::remove(filePath);
+		}
+
+		std::filesystem::remove(benchmarkDirectory);
+		return vecResults;
+	}
+}
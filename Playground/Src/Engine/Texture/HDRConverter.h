@@ -0,0 +1,65 @@
+#pragma once
+
+#include "BlockCompression.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Decoded HDRI, one level, rows bottom up to match the stb_image flip the sky shaders were written against
+	struct HDRImage
+	{
+		TextureFormat			eFormat = TextureFormat::RGBA32F;
+		uint32_t				width = 0;
+		uint32_t				height = 0;
+		std::vector<uint8_t>	vecData;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct HDRLoadReport
+	{
+		bool					bFromCache;
+		bool					bParallel;					// Scanlines decoded across the JobSystem, false for the stb_image fallback
+		float					loadMs;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct HDRBenchmarkResult
+	{
+		std::string				method;						// "stb_image", "parallel" or "cache"
+		TextureFormat			eFormat;
+		uint32_t				width;
+		uint32_t				height;
+		float					loadMs;
+		uint64_t				cpuBytes;					// Decoded image kept in memory until the upload
+		uint64_t				vramBytes;					// Image memory, HDRIs are a single level
+		float					maxRelativeError;			// Against the RGBA32F decode, over texels brighter than 1e-3
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Scalar conversions round to nearest even like F16C & the Vulkan spec's shared exponent packing
+	uint16_t							FloatToHalf(float value);
+	float								HalfToFloat(uint16_t value);
+	uint32_t							PackE5B9G9R9(float r, float g, float b);
+	void								UnpackE5B9G9R9(uint32_t value, float* pRGB);
+
+	//--- F16C when the CPU & OS support it, checked once
+	bool								HasF16C();
+
+	//--- RGBA32F texels into RGBA16F, RGBA32F or E5B9G9R9 (alpha dropped), pDst holds count texels of eFormat
+	void								ConvertHDRTexels(const float* pRGBA, size_t count, TextureFormat eFormat, uint8_t* pDst);
+
+	//--- Back to RGBA32F, alpha 1 for E5B9G9R9. The values the GPU samples, so tables built from them match the image.
+	void								DecodeHDRTexels(const uint8_t* pSrc, size_t count, TextureFormat eFormat, float* pRGBA);
+
+	//--- Loads a Radiance .hdr straight into eFormat. Run length encoded scanlines get located in one serial pass, then
+	//--- decoded & converted in parallel. Other encodings go through stbi_loadf. RGBA16F & E5B9G9R9 results are cached
+	//--- as DDS under Assets/Textures/Compiled/HDRI & reused until the source is newer.
+	bool								LoadHDRImage(const std::string& filePath, TextureFormat eFormat, HDRImage& outImage,
+													 HDRLoadReport* pOutReport = nullptr, bool bUseCache = true);
+
+	std::string							GetHDRCachePath(const std::string& filePath, TextureFormat eFormat);
+
+	//--- Synthetic 2k, 4k & 8k equirect maps written as RLE .hdr into the temp directory, loaded with stb_image & every
+	//--- conversion path. Logs & returns one row per method & format.
+	std::vector<HDRBenchmarkResult>		RunHDRBenchmark();
+}
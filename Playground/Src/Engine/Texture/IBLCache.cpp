@@ -0,0 +1,471 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "IBLCache.h"
+
+#include <chrono>
+
+#include "glm/glm.hpp"
+
+#include "Engine/Helpers/JobSystem.h"
+#include "HDRConverter.h"
+#include "TextureCompiler.h"
+#include "TextureContainer.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	const std::string	HDRI_DIRECTORY		= "Assets/Textures/HDRI/";
+
+	// Bump whenever a bake changes its output, old entries then simply stop matching
+	const uint32_t		IBL_CACHE_VERSION	= 1;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint64_t HashCombine(uint64_t hash, uint64_t value)
+	{
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint64_t HashFileContents(const std::string& filePath)
+	{
+		std::ifstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+			return 0;
+
+		uint64_t hash = 14695981039346656037ull;
+
+		std::vector<char> vecChunk(1 << 20);
+		while (file)
+		{
+			file.read(vecChunk.data(), vecChunk.size());
+			const std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; ++i)
+			{
+				hash ^= static_cast<uint8_t>(vecChunk[i]);
+				hash *= 1099511628211ull;
+			}
+		}
+
+		return hash;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	IBLCachePaths GetIBLCachePaths(const std::string& hdriPath, uint64_t contentHash, const IBLBakeSettings& settings)
+	{
+		uint64_t environmentKey = HashCombine(contentHash, IBL_CACHE_VERSION);
+		environmentKey = HashCombine(environmentKey, settings.environmentDimension);
+		environmentKey = HashCombine(environmentKey, static_cast<uint64_t>(settings.eCubeFormat));
+		if (settings.eCubeFormat == TextureFormat::BC6H)
+			environmentKey = HashCombine(environmentKey, static_cast<uint64_t>(settings.eCubePreset));
+
+		const uint64_t irradianceKey = HashCombine(HashCombine(contentHash, IBL_CACHE_VERSION), 0x5348);
+
+		uint64_t prefilterKey = environmentKey;
+		prefilterKey = HashCombine(prefilterKey, settings.prefilter.dimension);
+		prefilterKey = HashCombine(prefilterKey, settings.prefilter.mipLevels);
+		prefilterKey = HashCombine(prefilterKey, settings.prefilter.minSamples);
+		prefilterKey = HashCombine(prefilterKey, settings.prefilter.maxSamples);
+		prefilterKey = HashCombine(prefilterKey, settings.prefilter.bSourceMipSelection ? 1 : 0);
+
+		auto toHex = [](uint64_t value)
+		{
+			char buffer[17];
+			snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+			return std::string(buffer);
+		};
+
+		// The stem only keeps the directory readable, the key decides whether an entry matches
+		const std::string stem = std::filesystem::path(hdriPath).stem().string();
+
+		IBLCachePaths paths;
+		paths.environment = GetCompiledTexturePath("IBL/" + stem + "_environment_" + toHex(environmentKey) + ".ktx2", ContainerType::KTX2);
+		paths.irradianceSH = GetCompiledTexturePath("IBL/" + stem + "_irradiance_" + toHex(irradianceKey) + ".ktx2", ContainerType::KTX2);
+		paths.prefiltered = GetCompiledTexturePath("IBL/" + stem + "_prefiltered_" + toHex(prefilterKey) + ".ktx2", ContainerType::KTX2);
+		paths.brdfLUT = GetCompiledTexturePath("IBL/brdf_lut_" + std::to_string(settings.brdfDimension) + "_" + std::to_string(settings.brdfSamples) +
+											   "_v" + std::to_string(IBL_CACHE_VERSION) + ".ktx2", ContainerType::KTX2);
+
+		return paths;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Containers
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool WriteCubeMipChain(const std::string& filePath, const CubeMipChain& cube, TextureFormat eFormat, CompressionPreset ePreset,
+						   CubeEncodeReport* pOutReport)
+	{
+		if (eFormat != TextureFormat::RGBA32F && eFormat != TextureFormat::BC6H)
+		{
+			LOG_ERROR("Cube mip chains are RGBA32F or BC6H, not {0} ({1})", GetTextureFormatName(eFormat), filePath);
+			return false;
+		}
+
+		const bool bCompress = eFormat == TextureFormat::BC6H;
+		const auto encodeStart = std::chrono::high_resolution_clock::now();
+
+		// The chain is face major, KTX2 wants every face of a level together
+		std::vector<std::vector<uint8_t>> vecLevels(cube.mipLevels);
+		for (uint32_t level = 0; level < cube.mipLevels; ++level)
+		{
+			const uint32_t levelDimension = cube.GetLevelDimension(level);
+			const size_t faceBytes = ComputeLevelByteSize(eFormat, levelDimension, levelDimension);
+
+			vecLevels[level].resize(faceBytes * 6);
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				if (bCompress)
+					CompressImageBC6H(cube.GetLevel(face, level), levelDimension, levelDimension, ePreset, &vecLevels[level][face * faceBytes]);
+				else
+					memcpy(&vecLevels[level][face * faceBytes], cube.GetLevel(face, level), faceBytes);
+			}
+		}
+
+		if (pOutReport)
+		{
+			pOutReport->encodeMs = bCompress ? std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - encodeStart).count() : 0.0f;
+			pOutReport->logPSNR = 99.0f;
+
+			if (bCompress)
+			{
+				CubeMipChain decoded;
+				decoded.Allocate(cube.dimension, cube.mipLevels);
+				for (uint32_t level = 0; level < cube.mipLevels; ++level)
+				{
+					const uint32_t levelDimension = cube.GetLevelDimension(level);
+					const size_t faceBytes = ComputeLevelByteSize(eFormat, levelDimension, levelDimension);
+
+					for (uint32_t face = 0; face < 6; ++face)
+						DecompressImageBC6H(&vecLevels[level][face * faceBytes], levelDimension, levelDimension, decoded.GetLevel(face, level));
+				}
+
+				pOutReport->logPSNR = ComputeLogPSNR(decoded.vecData.data(), cube.vecData.data(), cube.vecData.size() / 4);
+			}
+		}
+
+		std::filesystem::create_directories(std::filesystem::path(filePath).parent_path());
+		return WriteTextureContainer(filePath, eFormat, false, cube.dimension, cube.dimension, vecLevels, 6);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadCubeMipChain(const std::string& filePath, CubeMipChain& outCube)
+	{
+		ContainerInfo info;
+		if (!ReadContainerInfo(filePath, info) || (info.eFormat != TextureFormat::RGBA32F && info.eFormat != TextureFormat::BC6H) || info.faceCount != 6)
+			return false;
+
+		std::vector<uint8_t> vecData(static_cast<size_t>(info.GetTotalByteSize()));
+		std::vector<uint64_t> vecOffsets;
+		if (!ReadContainerLevels(filePath, info, vecData.data(), vecOffsets))
+			return false;
+
+		outCube.Allocate(info.width, static_cast<uint32_t>(info.vecLevels.size()));
+		for (uint32_t level = 0; level < outCube.mipLevels; ++level)
+		{
+			const uint32_t levelDimension = outCube.GetLevelDimension(level);
+			const size_t faceBytes = ComputeLevelByteSize(info.eFormat, levelDimension, levelDimension);
+
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				const uint8_t* pFace = &vecData[static_cast<size_t>(vecOffsets[level]) + face * faceBytes];
+				if (info.eFormat == TextureFormat::BC6H)
+					DecompressImageBC6H(pFace, levelDimension, levelDimension, outCube.GetLevel(face, level));
+				else
+					memcpy(outCube.GetLevel(face, level), pFace, faceBytes);
+			}
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool WriteIrradianceSH(const std::string& filePath, const SH9Color& sh)
+	{
+		std::vector<std::vector<uint8_t>> vecLevels(1, std::vector<uint8_t>(9 * 4 * sizeof(float)));
+
+		float* pTexels = reinterpret_cast<float*>(vecLevels[0].data());
+		for (uint32_t k = 0; k < 9; ++k)
+		{
+			pTexels[k * 4 + 0] = sh.coefficients[k].x;
+			pTexels[k * 4 + 1] = sh.coefficients[k].y;
+			pTexels[k * 4 + 2] = sh.coefficients[k].z;
+			pTexels[k * 4 + 3] = 0.0f;
+		}
+
+		std::filesystem::create_directories(std::filesystem::path(filePath).parent_path());
+		return WriteTextureContainer(filePath, TextureFormat::RGBA32F, false, 9, 1, vecLevels);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadIrradianceSH(const std::string& filePath, SH9Color& outSH)
+	{
+		ContainerInfo info;
+		if (!ReadContainerInfo(filePath, info) || info.eFormat != TextureFormat::RGBA32F || info.width != 9 || info.height != 1 || info.faceCount != 1)
+			return false;
+
+		float arrTexels[9 * 4];
+		std::vector<uint64_t> vecOffsets;
+		if (!ReadContainerLevels(filePath, info, reinterpret_cast<uint8_t*>(arrTexels), vecOffsets))
+			return false;
+
+		for (uint32_t k = 0; k < 9; ++k)
+			outSH.coefficients[k] = glm::vec3(arrTexels[k * 4 + 0], arrTexels[k * 4 + 1], arrTexels[k * 4 + 2]);
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Only the header is checked for a hit, a truncated body fails the upload's read & gets rebaked next run
+	bool IsCacheEntryValid(const std::string& filePath, TextureFormat eFormat, uint32_t width, uint32_t faceCount, uint32_t mipLevels)
+	{
+		if (!std::filesystem::exists(filePath))
+			return false;
+
+		ContainerInfo info;
+		if (!ReadContainerInfo(filePath, info))
+			return false;
+
+		return info.eFormat == eFormat && info.width == width && info.faceCount == faceCount && (mipLevels == 0 || info.vecLevels.size() == mipLevels);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BRDF LUT
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BakeBrdfLUT(uint32_t dimension, uint32_t sampleCount, std::vector<float>& outScaleBias)
+	{
+		outScaleBias.assign(static_cast<size_t>(dimension) * dimension * 2, 0.0f);
+
+		JobSystem::getInstance().ParallelFor(dimension, 8, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				const float roughness = (y + 0.5f) / dimension;
+				const float alpha = roughness * roughness;
+				const float alphaSq = alpha * alpha;
+
+				// Smith G with the IBL remapping k = alpha / 2
+				const float k = alpha * 0.5f;
+
+				for (uint32_t x = 0; x < dimension; ++x)
+				{
+					const float NdotV = (x + 0.5f) / dimension;
+					const glm::vec3 view(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+
+					float scale = 0.0f, bias = 0.0f;
+					for (uint32_t i = 0; i < sampleCount; ++i)
+					{
+						// Hammersley
+						uint32_t bits = i;
+						bits = (bits << 16u) | (bits >> 16u);
+						bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+						bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+						bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+						bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+						const float u1 = static_cast<float>(i) / sampleCount;
+						const float u2 = static_cast<float>(bits) * 2.3283064365386963e-10f;
+
+						const float phi = static_cast<float>(2.0 * M_PI) * u1;
+						const float cosTheta = std::sqrt((1.0f - u2) / (1.0f + (alphaSq - 1.0f) * u2));
+						const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+						const glm::vec3 halfVector(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+
+						const float VdotH = glm::dot(view, halfVector);
+						const glm::vec3 light = halfVector * (2.0f * VdotH) - view;
+
+						const float NdotL = light.z;
+						if (NdotL <= 0.0f)
+							continue;
+
+						const float NdotH = std::max(halfVector.z, 0.0f);
+						const float clampedVdotH = std::max(VdotH, 0.0f);
+
+						const float geometry = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+						const float visibility = geometry * clampedVdotH / (NdotH * NdotV);
+						const float fresnel = std::pow(1.0f - clampedVdotH, 5.0f);
+
+						scale += (1.0f - fresnel) * visibility;
+						bias += fresnel * visibility;
+					}
+
+					float* pTexel = &outScaleBias[(static_cast<size_t>(y) * dimension + x) * 2];
+					pTexel[0] = scale / sampleCount;
+					pTexel[1] = bias / sampleCount;
+				}
+			}
+		});
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool WriteBrdfLUT(const std::string& filePath, uint32_t dimension, const std::vector<float>& vecScaleBias)
+	{
+		const size_t texelCount = static_cast<size_t>(dimension) * dimension;
+
+		std::vector<float> vecRGBA(texelCount * 4);
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			vecRGBA[i * 4 + 0] = vecScaleBias[i * 2 + 0];
+			vecRGBA[i * 4 + 1] = vecScaleBias[i * 2 + 1];
+			vecRGBA[i * 4 + 2] = 0.0f;
+			vecRGBA[i * 4 + 3] = 1.0f;
+		}
+
+		std::vector<std::vector<uint8_t>> vecLevels(1, std::vector<uint8_t>(ComputeLevelByteSize(TextureFormat::RGBA16F, dimension, dimension)));
+		ConvertHDRTexels(vecRGBA.data(), texelCount, TextureFormat::RGBA16F, vecLevels[0].data());
+
+		std::filesystem::create_directories(std::filesystem::path(filePath).parent_path());
+		return WriteTextureContainer(filePath, TextureFormat::RGBA16F, false, dimension, dimension, vecLevels);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Cache
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool PrepareIBLCache(const std::string& hdriPath, const IBLBakeSettings& settings, IBLCachePaths& outPaths, IBLCacheReport* pOutReport)
+	{
+		const auto prepareStart = std::chrono::high_resolution_clock::now();
+
+		IBLCacheReport report = {};
+		report.name = std::filesystem::path(hdriPath).filename().string();
+
+		report.contentHash = HashFileContents(hdriPath);
+		if (report.contentHash == 0)
+		{
+			LOG_ERROR("Failed to read {0} for the IBL cache", hdriPath);
+			return false;
+		}
+
+		const auto hashEnd = std::chrono::high_resolution_clock::now();
+		report.hashMs = std::chrono::duration<float, std::milli>(hashEnd - prepareStart).count();
+
+		outPaths = GetIBLCachePaths(hdriPath, report.contentHash, settings);
+
+		// Both bakes run their chains down to 1x1 unless the prefilter asks for fewer levels
+		const uint32_t environmentLevels = static_cast<uint32_t>(std::floor(std::log2(settings.environmentDimension))) + 1;
+		const uint32_t prefilterChain = static_cast<uint32_t>(std::floor(std::log2(settings.prefilter.dimension))) + 1;
+		const uint32_t prefilterLevels = settings.prefilter.mipLevels > 0 ? std::min(settings.prefilter.mipLevels, prefilterChain) : prefilterChain;
+
+		report.bEnvironmentHit = IsCacheEntryValid(outPaths.environment, settings.eCubeFormat, settings.environmentDimension, 6, environmentLevels);
+		report.bIrradianceHit = IsCacheEntryValid(outPaths.irradianceSH, TextureFormat::RGBA32F, 9, 1, 1);
+		report.bPrefilterHit = IsCacheEntryValid(outPaths.prefiltered, settings.eCubeFormat, settings.prefilter.dimension, 6, prefilterLevels);
+		report.bBrdfHit = IsCacheEntryValid(outPaths.brdfLUT, TextureFormat::RGBA16F, settings.brdfDimension, 1, 1);
+
+		const auto bakeStart = std::chrono::high_resolution_clock::now();
+		bool bSuccess = true;
+
+		// A BC6H environment is lossy, so the prefilter always starts from the float bake & a key gives the same result
+		// whether the environment was cached or not. Only a float environment gets read back for it.
+		const bool bCompressedCubes = settings.eCubeFormat == TextureFormat::BC6H;
+		const bool bBakeEnvironment = !report.bEnvironmentHit || (!report.bPrefilterHit && bCompressedCubes);
+
+		// The equirect is only decoded when a bake needs it
+		HDRImage image;
+		const bool bNeedsSource = bBakeEnvironment || !report.bIrradianceHit;
+		if (bNeedsSource && !LoadHDRImage(hdriPath, TextureFormat::RGBA32F, image))
+			return false;
+
+		CubeMipChain environment;
+		if (bBakeEnvironment)
+			EquirectToCubeMipChain(reinterpret_cast<const float*>(image.vecData.data()), image.width, image.height, settings.environmentDimension, environment);
+
+		if (!report.bEnvironmentHit)
+		{
+			CubeEncodeReport encodeReport;
+			bSuccess &= WriteCubeMipChain(outPaths.environment, environment, settings.eCubeFormat, settings.eCubePreset, &encodeReport);
+			report.encodeMs += encodeReport.encodeMs;
+			report.environmentPSNR = encodeReport.logPSNR;
+		}
+
+		if (!report.bIrradianceHit)
+		{
+			SH9Color sh;
+			ProjectEquirectSH(reinterpret_cast<const float*>(image.vecData.data()), image.width, image.height, sh);
+			bSuccess &= WriteIrradianceSH(outPaths.irradianceSH, sh);
+		}
+
+		image.vecData = std::vector<uint8_t>();
+
+		if (!report.bPrefilterHit)
+		{
+			if (!bBakeEnvironment && !ReadCubeMipChain(outPaths.environment, environment))
+			{
+				LOG_ERROR("Failed to read the cached environment {0}", outPaths.environment);
+				return false;
+			}
+
+			CubeMipChain prefiltered;
+			BakePrefilteredSpecular(environment, settings.prefilter, prefiltered);
+
+			CubeEncodeReport encodeReport;
+			bSuccess &= WriteCubeMipChain(outPaths.prefiltered, prefiltered, settings.eCubeFormat, settings.eCubePreset, &encodeReport);
+			report.encodeMs += encodeReport.encodeMs;
+			report.prefilterPSNR = encodeReport.logPSNR;
+		}
+
+		if (!report.bBrdfHit)
+		{
+			std::vector<float> vecScaleBias;
+			BakeBrdfLUT(settings.brdfDimension, settings.brdfSamples, vecScaleBias);
+			bSuccess &= WriteBrdfLUT(outPaths.brdfLUT, settings.brdfDimension, vecScaleBias);
+		}
+
+		const auto prepareEnd = std::chrono::high_resolution_clock::now();
+		const bool bAllHit = report.bEnvironmentHit && report.bIrradianceHit && report.bPrefilterHit && report.bBrdfHit;
+		report.bakeMs = bAllHit ? 0.0f : std::chrono::duration<float, std::milli>(prepareEnd - bakeStart).count();
+		report.totalMs = std::chrono::duration<float, std::milli>(prepareEnd - prepareStart).count();
+
+		std::error_code error;
+		report.cubeBytes = std::filesystem::file_size(outPaths.environment, error);
+		report.cubeBytes += error ? 0 : std::filesystem::file_size(outPaths.prefiltered, error);
+
+		if (!bSuccess)
+		{
+			LOG_ERROR("Failed to write the IBL cache for {0}", hdriPath);
+		}
+
+		LOG_INFO("IBL cache {0} ({1:016x}): environment {2}, irradiance {3}, prefiltered {4}, BRDF LUT {5}, hash {6:.1f} ms, bake {7:.1f} ms",
+				 report.name, report.contentHash, report.bEnvironmentHit ? "hit" : "baked", report.bIrradianceHit ? "hit" : "baked",
+				 report.bPrefilterHit ? "hit" : "baked", report.bBrdfHit ? "hit" : "baked", report.hashMs, report.bakeMs);
+
+		if (bCompressedCubes && report.encodeMs > 0.0f)
+		{
+			LOG_INFO("IBL cache {0}: BC6H encode {1:.1f} ms, log PSNR environment {2:.2f} dB, prefiltered {3:.2f} dB, cubes {4} KB", report.name,
+					 report.encodeMs, report.environmentPSNR, report.prefilterPSNR, report.cubeBytes / 1024);
+		}
+
+		if (pOutReport)
+			*pOutReport = report;
+
+		return bSuccess;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<IBLCacheReport> PrepareIBLCacheDirectory(const IBLBakeSettings& settings)
+	{
+		std::vector<IBLCacheReport> vecReports;
+
+		if (!std::filesystem::exists(HDRI_DIRECTORY))
+		{
+			LOG_ERROR("HDRI directory {0} doesn't exist", HDRI_DIRECTORY);
+			return vecReports;
+		}
+
+		for (const auto& entry : std::filesystem::directory_iterator(HDRI_DIRECTORY))
+		{
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			if (!entry.is_regular_file() || extension != ".hdr")
+				continue;
+
+			IBLCachePaths paths;
+			IBLCacheReport report;
+			if (PrepareIBLCache(entry.path().generic_string(), settings, paths, &report))
+				vecReports.push_back(report);
+		}
+
+		return vecReports;
+	}
+}
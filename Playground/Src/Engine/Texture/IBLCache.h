@@ -0,0 +1,78 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "SpecularPrefilter.h"
+#include "SphericalHarmonics.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct IBLBakeSettings
+	{
+		uint32_t				environmentDimension = 512;		// Face size of the HDRI->Cube result, also the prefilter's source
+		PrefilterSettings		prefilter;
+		uint32_t				brdfDimension = 512;
+		uint32_t				brdfSamples = 1024;
+		TextureFormat			eCubeFormat = TextureFormat::RGBA32F;	// RGBA32F or BC6H for the environment & prefiltered cubes
+		CompressionPreset		eCubePreset = CompressionPreset::QUALITY;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- KTX2 files under Assets/Textures/Compiled/IBL. Environment & prefiltered maps are RGBA32F or BC6H cubes with mip
+	//--- chains, the irradiance SH a 9x1 RGBA32F image & the BRDF LUT (scale, bias) in RGBA16F, shared by every environment.
+	struct IBLCachePaths
+	{
+		std::string				environment;
+		std::string				irradianceSH;
+		std::string				prefiltered;
+		std::string				brdfLUT;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct IBLCacheReport
+	{
+		std::string				name;
+		uint64_t				contentHash;
+		bool					bEnvironmentHit;
+		bool					bIrradianceHit;
+		bool					bPrefilterHit;
+		bool					bBrdfHit;
+		float					hashMs;
+		float					bakeMs;							// Loading the HDRI & every bake that missed, 0 when all hit
+		float					totalMs;
+		float					encodeMs;						// BC6H encoding of the cubes that got baked
+		float					environmentPSNR;				// Log space PSNR against the float bake, 0 on a hit
+		float					prefilterPSNR;
+		uint64_t				cubeBytes;						// Environment & prefiltered files together
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct CubeEncodeReport
+	{
+		float					encodeMs;
+		float					logPSNR;						// 99 for RGBA32F
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- FNV-1a over the file's bytes, 0 if it can't be read
+	uint64_t					HashFileContents(const std::string& filePath);
+
+	//--- Keys combine the content hash with every setting that changes a result & a format version
+	IBLCachePaths				GetIBLCachePaths(const std::string& hdriPath, uint64_t contentHash, const IBLBakeSettings& settings);
+
+	//--- Makes sure all four results exist in the cache, baking only what is missing or unreadable
+	bool						PrepareIBLCache(const std::string& hdriPath, const IBLBakeSettings& settings, IBLCachePaths& outPaths,
+												IBLCacheReport* pOutReport = nullptr);
+
+	//--- Split sum environment BRDF, x = N.V & y = roughness, RG pairs of (scale, bias) for F0
+	void						BakeBrdfLUT(uint32_t dimension, uint32_t sampleCount, std::vector<float>& outScaleBias);
+
+	//--- BC6H compresses face by face, each one spread over the JobSystem. Reading decodes BC6H back to float.
+	bool						WriteCubeMipChain(const std::string& filePath, const CubeMipChain& cube, TextureFormat eFormat = TextureFormat::RGBA32F,
+												  CompressionPreset ePreset = CompressionPreset::QUALITY, CubeEncodeReport* pOutReport = nullptr);
+	bool						ReadCubeMipChain(const std::string& filePath, CubeMipChain& outCube);
+	bool						ReadIrradianceSH(const std::string& filePath, SH9Color& outSH);
+
+	//--- PrepareIBLCache on every .hdr in Assets/Textures/HDRI, a second run should hit on everything
+	std::vector<IBLCacheReport>	PrepareIBLCacheDirectory(const IBLBakeSettings& settings);
+}
@@ -0,0 +1,688 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "MipGenerator.h"
+
+#include <chrono>
+#include <random>
+
+#include "Engine/Helpers/JobSystem.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+	#define MIP_USE_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	const uint32_t	MIP_PARALLEL_MIN_TEXELS		= 4096;		// Rows per job are chosen so a job covers at least this many texels
+	const float		MIP_MAX_ERROR				= 2.0f;		// 8 bit steps, float chain vs reference from the quantized level
+	const float		MIP_MAX_MEAN_DRIFT			= 0.02f;
+	const float		MIP_MAX_NORMAL_ERROR		= 0.02f;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline float SRGBToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Decode is a plain lookup. Encode starts from the code at the beginning of one of 4096 linear buckets & steps past
+	//--- the threshold where the rounded code goes up, at most once since no bucket spans more than one threshold. That
+	//--- rounds exactly like round(LinearToSRGB(c) * 255) without a pow or a search per channel.
+	struct SRGBTables
+	{
+		static const uint32_t BUCKET_COUNT = 4096;
+
+		SRGBTables()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+				decode[i] = SRGBToLinear(i / 255.0f);
+
+			for (uint32_t i = 0; i < 255; ++i)
+				encodeThresholds[i] = SRGBToLinear((i + 0.5f) / 255.0f);
+
+			encodeThresholds[255] = 2.0f;
+
+			uint32_t code = 0;
+			for (uint32_t i = 0; i <= BUCKET_COUNT; ++i)
+			{
+				const float bucketStart = static_cast<float>(i) / BUCKET_COUNT;
+				while (bucketStart >= encodeThresholds[code])
+					++code;
+
+				encodeBuckets[i] = static_cast<uint8_t>(code);
+			}
+		}
+
+		float	decode[256];
+		float	encodeThresholds[256];				// Last entry is a sentinel
+		uint8_t	encodeBuckets[BUCKET_COUNT + 1];
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline const SRGBTables& GetSRGBTables()
+	{
+		static SRGBTables tables;
+		return tables;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint8_t EncodeUNorm(float c)
+	{
+		return static_cast<uint8_t>(glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint8_t EncodeSRGB(float c, const SRGBTables& tables)
+	{
+		c = glm::clamp(c, 0.0f, 1.0f);
+
+		uint32_t code = tables.encodeBuckets[static_cast<uint32_t>(c * SRGBTables::BUCKET_COUNT)];
+		if (c >= tables.encodeThresholds[code])
+			++code;
+
+		return static_cast<uint8_t>(code);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline glm::vec3 SafeNormalize(const glm::vec3& n)
+	{
+		const float length = glm::length(n);
+		return length > 1e-6f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline int32_t WrapIndex(int32_t index, int32_t size)
+	{
+		const int32_t wrapped = index % size;
+		return wrapped < 0 ? wrapped + size : wrapped;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Modified Bessel function of the first kind, order 0. The series converges quickly for the alphas used here.
+	inline double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		const double halfX = x * 0.5;
+
+		for (int k = 1; k < 64 && term > sum * 1e-12; ++k)
+		{
+			const double factor = halfX / k;
+			term *= factor * factor;
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Kaiser windowed sinc, d in destination texels so the sinc cuts off at the destination Nyquist frequency.
+	inline double KaiserWeight(double d, const MipSettings& settings)
+	{
+		const double t = d / settings.fKaiserRadius;
+		if (std::abs(t) >= 1.0)
+			return 0.0;
+
+		const double window = BesselI0(settings.fKaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(settings.fKaiserAlpha);
+		const double x = d * M_PI;
+		const double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(x) / x;
+
+		return sinc * window;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t ComputeMipCount(uint32_t width, uint32_t height)
+	{
+		uint32_t size = std::max(width, height);
+		uint32_t count = 1;
+		while (size > 1)
+		{
+			size >>= 1;
+			++count;
+		}
+
+		return count;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Per axis taps of a separable downsample. Destination texel i reads taps [vecFirstTap[i], vecFirstTap[i + 1]).
+	struct FilterTap
+	{
+		uint32_t	srcIndex;
+		float		weight;
+	};
+
+	struct FilterTable
+	{
+		std::vector<uint32_t>	vecFirstTap;
+		std::vector<FilterTap>	vecTaps;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BuildFilterTable(uint32_t srcSize, uint32_t dstSize, const MipSettings& settings, FilterTable& table)
+	{
+		table.vecFirstTap.resize(dstSize + 1);
+		table.vecTaps.clear();
+
+		const float scale = static_cast<float>(srcSize) / static_cast<float>(dstSize);
+
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			table.vecFirstTap[i] = static_cast<uint32_t>(table.vecTaps.size());
+
+			// Axis already at 1 texel, nothing to filter
+			if (srcSize == dstSize)
+			{
+				table.vecTaps.push_back({ i, 1.0f });
+				continue;
+			}
+
+			if (settings.eFilter == MipFilter::BOX)
+			{
+				// Coverage of each source texel by the destination footprint, handles the 3:1 step of odd sizes
+				const float begin = i * scale;
+				const float end = (i + 1) * scale;
+
+				for (uint32_t j = static_cast<uint32_t>(begin); j < srcSize && static_cast<float>(j) < end; ++j)
+				{
+					const float coverage = std::min(end, j + 1.0f) - std::max(begin, static_cast<float>(j));
+					if (coverage > 0.0f)
+						table.vecTaps.push_back({ j, coverage / scale });
+				}
+			}
+			else
+			{
+				const uint32_t firstTap = static_cast<uint32_t>(table.vecTaps.size());
+				const float center = (i + 0.5f) * scale;
+				const float radius = settings.fKaiserRadius * scale;
+
+				double weightSum = 0.0;
+				for (int32_t j = static_cast<int32_t>(std::floor(center - radius)); j <= static_cast<int32_t>(std::ceil(center + radius)); ++j)
+				{
+					const double weight = KaiserWeight((j + 0.5 - center) / scale, settings);
+					if (weight == 0.0)
+						continue;
+
+					table.vecTaps.push_back({ static_cast<uint32_t>(WrapIndex(j, srcSize)), static_cast<float>(weight) });
+					weightSum += weight;
+				}
+
+				for (uint32_t t = firstTap; t < table.vecTaps.size(); ++t)
+					table.vecTaps[t].weight = static_cast<float>(table.vecTaps[t].weight / weightSum);
+			}
+		}
+
+		table.vecFirstTap[dstSize] = static_cast<uint32_t>(table.vecTaps.size());
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void DecodeRows(const uint8_t* pRGBA, uint32_t width, uint32_t rowBegin, uint32_t rowEnd, MipColorSpace eColorSpace, glm::vec4* pOut)
+	{
+		const SRGBTables& tables = GetSRGBTables();
+
+		for (uint32_t i = rowBegin * width; i < rowEnd * width; ++i)
+		{
+			const uint8_t* pTexel = pRGBA + i * 4;
+			const glm::vec4 unorm = glm::vec4(pTexel[0], pTexel[1], pTexel[2], pTexel[3]) / 255.0f;
+
+			switch (eColorSpace)
+			{
+				case MipColorSpace::SRGB:
+					pOut[i] = glm::vec4(tables.decode[pTexel[0]], tables.decode[pTexel[1]], tables.decode[pTexel[2]], unorm.w);
+					break;
+
+				case MipColorSpace::NORMAL:
+					pOut[i] = glm::vec4(glm::vec3(unorm) * 2.0f - 1.0f, unorm.w);
+					break;
+
+				default:
+					pOut[i] = unorm;
+					break;
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void EncodeRows(const glm::vec4* pIn, uint32_t width, uint32_t rowBegin, uint32_t rowEnd, MipColorSpace eColorSpace, uint8_t* pRGBA)
+	{
+		const SRGBTables& tables = GetSRGBTables();
+
+		for (uint32_t i = rowBegin * width; i < rowEnd * width; ++i)
+		{
+			const glm::vec4& c = pIn[i];
+			uint8_t* pTexel = pRGBA + i * 4;
+
+			switch (eColorSpace)
+			{
+				case MipColorSpace::SRGB:
+					pTexel[0] = EncodeSRGB(c.x, tables);
+					pTexel[1] = EncodeSRGB(c.y, tables);
+					pTexel[2] = EncodeSRGB(c.z, tables);
+					break;
+
+				case MipColorSpace::NORMAL:
+					pTexel[0] = EncodeUNorm(c.x * 0.5f + 0.5f);
+					pTexel[1] = EncodeUNorm(c.y * 0.5f + 0.5f);
+					pTexel[2] = EncodeUNorm(c.z * 0.5f + 0.5f);
+					break;
+
+				default:
+					pTexel[0] = EncodeUNorm(c.x);
+					pTexel[1] = EncodeUNorm(c.y);
+					pTexel[2] = EncodeUNorm(c.z);
+					break;
+			}
+
+			pTexel[3] = EncodeUNorm(c.w);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void FilterRowsHorizontal(const glm::vec4* pSrc, uint32_t srcWidth, glm::vec4* pDst, uint32_t dstWidth, const FilterTable& table,
+							  uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			const glm::vec4* pSrcRow = pSrc + static_cast<size_t>(y) * srcWidth;
+			glm::vec4* pDstRow = pDst + static_cast<size_t>(y) * dstWidth;
+
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+#ifdef MIP_USE_SSE
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t t = table.vecFirstTap[x]; t < table.vecFirstTap[x + 1]; ++t)
+				{
+					const FilterTap& tap = table.vecTaps[t];
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&pSrcRow[tap.srcIndex].x), _mm_set1_ps(tap.weight)));
+				}
+				_mm_storeu_ps(&pDstRow[x].x, sum);
+#else
+				glm::vec4 sum(0.0f);
+				for (uint32_t t = table.vecFirstTap[x]; t < table.vecFirstTap[x + 1]; ++t)
+					sum += pSrcRow[table.vecTaps[t].srcIndex] * table.vecTaps[t].weight;
+				pDstRow[x] = sum;
+#endif
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Accumulates whole source rows so the inner loop streams through memory. Normals get renormalized here so the
+	//--- next level filters unit vectors, same as it would when filtering the stored level.
+	void FilterRowsVertical(const glm::vec4* pSrc, glm::vec4* pDst, uint32_t width, const FilterTable& table, MipColorSpace eColorSpace,
+							uint32_t rowBegin, uint32_t rowEnd)
+	{
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			glm::vec4* pDstRow = pDst + static_cast<size_t>(y) * width;
+			std::fill(pDstRow, pDstRow + width, glm::vec4(0.0f));
+
+			for (uint32_t t = table.vecFirstTap[y]; t < table.vecFirstTap[y + 1]; ++t)
+			{
+				const FilterTap& tap = table.vecTaps[t];
+				const glm::vec4* pSrcRow = pSrc + static_cast<size_t>(tap.srcIndex) * width;
+
+#ifdef MIP_USE_SSE
+				const __m128 weight = _mm_set1_ps(tap.weight);
+				for (uint32_t x = 0; x < width; ++x)
+					_mm_storeu_ps(&pDstRow[x].x, _mm_add_ps(_mm_loadu_ps(&pDstRow[x].x), _mm_mul_ps(_mm_loadu_ps(&pSrcRow[x].x), weight)));
+#else
+				for (uint32_t x = 0; x < width; ++x)
+					pDstRow[x] += pSrcRow[x] * tap.weight;
+#endif
+			}
+
+			// Clamp away Kaiser ringing as well, so the next level filters what actually gets stored
+			if (eColorSpace == MipColorSpace::NORMAL)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+					pDstRow[x] = glm::vec4(SafeNormalize(glm::vec3(pDstRow[x])), glm::clamp(pDstRow[x].w, 0.0f, 1.0f));
+			}
+			else
+			{
+				for (uint32_t x = 0; x < width; ++x)
+					pDstRow[x] = glm::clamp(pDstRow[x], 0.0f, 1.0f);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t RowGrain(uint32_t width)
+	{
+		return std::max(1u, MIP_PARALLEL_MIN_TEXELS / std::max(1u, width));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void GenerateMipChain(const uint8_t* pRGBA, uint32_t width, uint32_t height, const MipSettings& settings, std::vector<MipLevel>& vecOutLevels)
+	{
+		JobSystem& jobSystem = JobSystem::getInstance();
+
+		const uint32_t mipCount = ComputeMipCount(width, height);
+		vecOutLevels.resize(mipCount);
+
+		vecOutLevels[0].width = width;
+		vecOutLevels[0].height = height;
+		vecOutLevels[0].vecData.assign(pRGBA, pRGBA + static_cast<size_t>(width) * height * 4);
+
+		// Working set stays in float for the whole chain
+		std::vector<glm::vec4> vecCurrent(static_cast<size_t>(width) * height);
+		std::vector<glm::vec4> vecNext;
+		std::vector<glm::vec4> vecHorizontal;
+
+		jobSystem.ParallelFor(height, RowGrain(width), [&](uint32_t begin, uint32_t end)
+		{
+			DecodeRows(pRGBA, width, begin, end, settings.eColorSpace, vecCurrent.data());
+		});
+
+		FilterTable tableX;
+		FilterTable tableY;
+
+		for (uint32_t level = 1; level < mipCount; ++level)
+		{
+			const uint32_t srcWidth = vecOutLevels[level - 1].width;
+			const uint32_t srcHeight = vecOutLevels[level - 1].height;
+			const uint32_t dstWidth = std::max(1u, srcWidth >> 1);
+			const uint32_t dstHeight = std::max(1u, srcHeight >> 1);
+
+			BuildFilterTable(srcWidth, dstWidth, settings, tableX);
+			BuildFilterTable(srcHeight, dstHeight, settings, tableY);
+
+			vecHorizontal.resize(static_cast<size_t>(dstWidth) * srcHeight);
+			vecNext.resize(static_cast<size_t>(dstWidth) * dstHeight);
+
+			jobSystem.ParallelFor(srcHeight, RowGrain(srcWidth), [&](uint32_t begin, uint32_t end)
+			{
+				FilterRowsHorizontal(vecCurrent.data(), srcWidth, vecHorizontal.data(), dstWidth, tableX, begin, end);
+			});
+
+			MipLevel& mipLevel = vecOutLevels[level];
+			mipLevel.width = dstWidth;
+			mipLevel.height = dstHeight;
+			mipLevel.vecData.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+			jobSystem.ParallelFor(dstHeight, RowGrain(dstWidth), [&](uint32_t begin, uint32_t end)
+			{
+				FilterRowsVertical(vecHorizontal.data(), vecNext.data(), dstWidth, tableY, settings.eColorSpace, begin, end);
+				EncodeRows(vecNext.data(), dstWidth, begin, end, settings.eColorSpace, mipLevel.vecData.data());
+			});
+
+			vecCurrent.swap(vecNext);
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Validation reference, deliberately naive: direct 2D sum in double precision with weights & color conversions
+	//--- computed from scratch instead of the tables used by GenerateMipChain.
+	double ReferenceWeight(uint32_t srcSize, uint32_t dstSize, uint32_t i, int32_t j, const MipSettings& settings)
+	{
+		if (srcSize == dstSize)
+			return j == static_cast<int32_t>(i) ? 1.0 : 0.0;
+
+		const double scale = static_cast<double>(srcSize) / dstSize;
+
+		if (settings.eFilter == MipFilter::BOX)
+			return std::max(0.0, std::min((i + 1) * scale, j + 1.0) - std::max(i * scale, static_cast<double>(j))) / scale;
+
+		return KaiserWeight((j + 0.5 - (i + 0.5) * scale) / scale, settings);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::dvec4 DecodeReference(const uint8_t* pTexel, MipColorSpace eColorSpace)
+	{
+		glm::dvec4 c = glm::dvec4(pTexel[0], pTexel[1], pTexel[2], pTexel[3]) / 255.0;
+
+		if (eColorSpace == MipColorSpace::SRGB)
+		{
+			for (int k = 0; k < 3; ++k)
+				c[k] = c[k] <= 0.04045 ? c[k] / 12.92 : std::pow((c[k] + 0.055) / 1.055, 2.4);
+		}
+		else if (eColorSpace == MipColorSpace::NORMAL)
+		{
+			c = glm::dvec4(glm::dvec3(c) * 2.0 - 1.0, c.w);
+		}
+
+		return c;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Unrounded 8 bit code the reference value should be stored as
+	glm::dvec4 EncodeReference(glm::dvec4 c, MipColorSpace eColorSpace)
+	{
+		if (eColorSpace == MipColorSpace::SRGB)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				const double v = glm::clamp(c[k], 0.0, 1.0);
+				c[k] = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+			}
+		}
+		else if (eColorSpace == MipColorSpace::NORMAL)
+		{
+			const double length = glm::length(glm::dvec3(c));
+			const glm::dvec3 n = length > 1e-12 ? glm::dvec3(c) / length : glm::dvec3(0.0, 0.0, 1.0);
+			c = glm::dvec4(n * 0.5 + 0.5, c.w);
+		}
+
+		return glm::clamp(c, 0.0, 1.0) * 255.0;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::dvec4 ComputeLevelMean(const MipLevel& level, MipColorSpace eColorSpace)
+	{
+		glm::dvec4 sum(0.0);
+		for (size_t i = 0; i < level.vecData.size(); i += 4)
+			sum += DecodeReference(&level.vecData[i], eColorSpace);
+
+		return sum / static_cast<double>(std::max<size_t>(1, level.vecData.size() / 4));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	MipValidationResult ValidateMipChain(const std::vector<MipLevel>& vecLevels, const MipSettings& settings)
+	{
+		MipValidationResult result = {};
+		result.bValid = false;
+
+		if (vecLevels.empty())
+			return result;
+
+		const uint32_t width = vecLevels[0].width;
+		const uint32_t height = vecLevels[0].height;
+		const uint32_t expectedCount = ComputeMipCount(width, height);
+
+		//--- Layout: count, extents & sizes
+		for (uint32_t level = 0; level < expectedCount; ++level)
+		{
+			result.failedLevel = level;
+
+			if (level >= vecLevels.size())
+				return result;
+
+			const MipLevel& mipLevel = vecLevels[level];
+			if (mipLevel.width != std::max(1u, width >> level) || mipLevel.height != std::max(1u, height >> level) ||
+				mipLevel.vecData.size() != static_cast<size_t>(mipLevel.width) * mipLevel.height * 4)
+				return result;
+		}
+
+		if (vecLevels.size() != expectedCount)
+			return result;
+
+		//--- Contents
+		const glm::dvec4 mean0 = ComputeLevelMean(vecLevels[0], settings.eColorSpace);
+
+		for (uint32_t level = 1; level < expectedCount; ++level)
+		{
+			const MipLevel& src = vecLevels[level - 1];
+			const MipLevel& dst = vecLevels[level];
+			result.failedLevel = level;
+
+			for (uint32_t y = 0; y < dst.height; ++y)
+			{
+				for (uint32_t x = 0; x < dst.width; ++x)
+				{
+					const double radius = settings.eFilter == MipFilter::KAISER ? settings.fKaiserRadius : 0.5;
+					const double scaleX = static_cast<double>(src.width) / dst.width;
+					const double scaleY = static_cast<double>(src.height) / dst.height;
+					const int32_t firstX = static_cast<int32_t>(std::floor((x + 0.5) * scaleX - (radius + 0.5) * scaleX));
+					const int32_t lastX = static_cast<int32_t>(std::ceil((x + 0.5) * scaleX + (radius + 0.5) * scaleX));
+					const int32_t firstY = static_cast<int32_t>(std::floor((y + 0.5) * scaleY - (radius + 0.5) * scaleY));
+					const int32_t lastY = static_cast<int32_t>(std::ceil((y + 0.5) * scaleY + (radius + 0.5) * scaleY));
+
+					glm::dvec4 sum(0.0);
+					double weightSum = 0.0;
+
+					for (int32_t sy = firstY; sy <= lastY; ++sy)
+					{
+						const double weightY = ReferenceWeight(src.height, dst.height, y, sy, settings);
+						if (weightY == 0.0)
+							continue;
+
+						for (int32_t sx = firstX; sx <= lastX; ++sx)
+						{
+							const double weight = weightY * ReferenceWeight(src.width, dst.width, x, sx, settings);
+							if (weight == 0.0)
+								continue;
+
+							const size_t srcIndex = static_cast<size_t>(WrapIndex(sy, src.height)) * src.width + WrapIndex(sx, src.width);
+							sum += DecodeReference(&src.vecData[srcIndex * 4], settings.eColorSpace) * weight;
+							weightSum += weight;
+						}
+					}
+
+					const glm::dvec4 expected = EncodeReference(sum / weightSum, settings.eColorSpace);
+					const uint8_t* pTexel = &dst.vecData[(static_cast<size_t>(y) * dst.width + x) * 4];
+
+					for (int k = 0; k < 4; ++k)
+						result.maxError = std::max(result.maxError, static_cast<float>(std::abs(expected[k] - pTexel[k])));
+
+					if (settings.eColorSpace == MipColorSpace::NORMAL)
+					{
+						const double length = glm::length(glm::dvec3(DecodeReference(pTexel, MipColorSpace::NORMAL)));
+						result.maxNormalError = std::max(result.maxNormalError, static_cast<float>(std::abs(1.0 - length)));
+					}
+				}
+			}
+
+			// Normals get renormalized, so their average legitimately changes
+			if (settings.eColorSpace != MipColorSpace::NORMAL)
+			{
+				const glm::dvec4 drift = glm::abs(ComputeLevelMean(dst, settings.eColorSpace) - mean0);
+				result.maxMeanDrift = std::max(result.maxMeanDrift, static_cast<float>(std::max(std::max(drift.x, drift.y), std::max(drift.z, drift.w))));
+			}
+
+			if (result.maxError > MIP_MAX_ERROR || result.maxMeanDrift > MIP_MAX_MEAN_DRIFT || result.maxNormalError > MIP_MAX_NORMAL_ERROR)
+				return result;
+		}
+
+		result.failedLevel = expectedCount;
+		result.bValid = true;
+		return result;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<MipSelfTestResult> RunMipSelfTest()
+	{
+		struct TestImage
+		{
+			std::string				name;
+			uint32_t				width;
+			uint32_t				height;
+			MipColorSpace			eColorSpace;
+			std::vector<uint8_t>	vecData;
+		};
+
+		std::vector<TestImage> vecImages;
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<uint32_t> byteDist(0, 255);
+
+		// Single texel checker, linear average of black & white has to come out at sRGB 188, not 128
+		{
+			TestImage image = { "Checker 256x256 sRGB", 256, 256, MipColorSpace::SRGB };
+			for (uint32_t y = 0; y < image.height; ++y)
+			{
+				for (uint32_t x = 0; x < image.width; ++x)
+				{
+					const uint8_t value = ((x ^ y) & 1) ? 255 : 0;
+					image.vecData.insert(image.vecData.end(), { value, value, value, 255 });
+				}
+			}
+			vecImages.push_back(image);
+		}
+
+		// Odd sizes on both axes take the 3:1 footprints
+		{
+			TestImage image = { "Noise 301x77 sRGB", 301, 77, MipColorSpace::SRGB };
+			for (uint32_t i = 0; i < image.width * image.height * 4; ++i)
+				image.vecData.push_back(static_cast<uint8_t>(byteDist(rng)));
+			vecImages.push_back(image);
+		}
+
+		{
+			TestImage image = { "Gradient 37x19 Linear", 37, 19, MipColorSpace::LINEAR };
+			for (uint32_t y = 0; y < image.height; ++y)
+			{
+				for (uint32_t x = 0; x < image.width; ++x)
+				{
+					image.vecData.insert(image.vecData.end(), { static_cast<uint8_t>(x * 255 / (image.width - 1)), static_cast<uint8_t>(y * 255 / (image.height - 1)),
+																static_cast<uint8_t>((x + y) * 4), static_cast<uint8_t>(255 - x * 3) });
+				}
+			}
+			vecImages.push_back(image);
+		}
+
+		{
+			TestImage image = { "Bumps 128x64 Normal", 128, 64, MipColorSpace::NORMAL };
+			for (uint32_t y = 0; y < image.height; ++y)
+			{
+				for (uint32_t x = 0; x < image.width; ++x)
+				{
+					const float u = static_cast<float>(x) / image.width * 2.0f * static_cast<float>(M_PI) * 8.0f;
+					const float v = static_cast<float>(y) / image.height * 2.0f * static_cast<float>(M_PI) * 4.0f;
+					const glm::vec3 n = glm::normalize(glm::vec3(std::cos(u) * 0.8f, std::cos(v) * 0.8f, 1.0f)) * 0.5f + 0.5f;
+					image.vecData.insert(image.vecData.end(), { EncodeUNorm(n.x), EncodeUNorm(n.y), EncodeUNorm(n.z), 255 });
+				}
+			}
+			vecImages.push_back(image);
+		}
+
+		std::vector<MipSelfTestResult> vecResults;
+
+		for (const TestImage& image : vecImages)
+		{
+			for (MipFilter eFilter : { MipFilter::BOX, MipFilter::KAISER })
+			{
+				MipSettings settings;
+				settings.eColorSpace = image.eColorSpace;
+				settings.eFilter = eFilter;
+
+				std::vector<MipLevel> vecLevels;
+
+				const auto start = std::chrono::high_resolution_clock::now();
+				GenerateMipChain(image.vecData.data(), image.width, image.height, settings, vecLevels);
+				const auto end = std::chrono::high_resolution_clock::now();
+
+				MipSelfTestResult result;
+				result.name = image.name + (eFilter == MipFilter::BOX ? " Box" : " Kaiser");
+				result.levelCount = static_cast<uint32_t>(vecLevels.size());
+				result.timeMs = std::chrono::duration<float, std::milli>(end - start).count();
+				result.validation = ValidateMipChain(vecLevels, settings);
+
+				if (result.validation.bValid)
+				{
+					LOG_INFO("Mip self test {0}: {1} levels OK in {2} ms (max error {3}, mean drift {4}, normal error {5})", result.name,
+							 result.levelCount, result.timeMs, result.validation.maxError, result.validation.maxMeanDrift, result.validation.maxNormalError);
+				}
+				else
+				{
+					LOG_ERROR("Mip self test {0}: level {1} FAILED (max error {2}, mean drift {3}, normal error {4})", result.name,
+							  result.validation.failedLevel, result.validation.maxError, result.validation.maxMeanDrift, result.validation.maxNormalError);
+				}
+
+				vecResults.push_back(result);
+			}
+		}
+
+		return vecResults;
+	}
+}
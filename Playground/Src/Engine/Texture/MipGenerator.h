@@ -0,0 +1,76 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class MipFilter
+	{
+		BOX,						// Exact footprint average, also correct for odd sizes
+		KAISER						// Kaiser windowed sinc, sharper but rings on hard edges
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class MipColorSpace
+	{
+		LINEAR,						// Filter the stored values as is
+		SRGB,						// Decode rgb to linear before filtering, alpha stays linear
+		NORMAL						// Tangent space normals, filtered xyz gets renormalized
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct MipSettings
+	{
+		MipSettings() : eColorSpace(MipColorSpace::LINEAR), eFilter(MipFilter::BOX), fKaiserAlpha(4.0f), fKaiserRadius(3.0f) {}
+
+		MipColorSpace		eColorSpace;
+		MipFilter			eFilter;
+		float				fKaiserAlpha;		// Window shape, higher is smoother
+		float				fKaiserRadius;		// Filter radius in destination texels
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct MipLevel
+	{
+		uint32_t				width;
+		uint32_t				height;
+		std::vector<uint8_t>	vecData;		// RGBA8, tightly packed
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct MipValidationResult
+	{
+		bool		bValid;
+		uint32_t	failedLevel;				// First level that failed, level count when all passed
+		float		maxError;					// Largest difference to the reference, in 8 bit steps
+		float		maxMeanDrift;				// Largest drift of the level average from level 0, linear space
+		float		maxNormalError;				// Largest |1 - length| of a normal, NORMAL only
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct MipSelfTestResult
+	{
+		std::string				name;
+		uint32_t				levelCount;
+		float					timeMs;
+		MipValidationResult		validation;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Full chain down to 1x1, floor(log2(max(width, height))) + 1 levels.
+	uint32_t						ComputeMipCount(uint32_t width, uint32_t height);
+
+	//--- Builds every level of an RGBA8 image on the CPU, level 0 is a copy of the source. Levels get filtered from the
+	//--- float result of the level above, so quantization error doesn't accumulate down the chain. Wrap addressing, to
+	//--- match the REPEAT samplers used for material textures.
+	void							GenerateMipChain(const uint8_t* pRGBA, uint32_t width, uint32_t height, const MipSettings& settings,
+													 std::vector<MipLevel>& vecOutLevels);
+
+	//--- Checks level count & extents, then compares each level against an independent scalar reference filtered from
+	//--- the level above. Also checks that averages don't drift & that normals stay unit length.
+	MipValidationResult				ValidateMipChain(const std::vector<MipLevel>& vecLevels, const MipSettings& settings);
+
+	//--- Generates & validates chains for synthetic textures covering every color space, both filters & odd sizes.
+	std::vector<MipSelfTestResult>	RunMipSelfTest();
+}
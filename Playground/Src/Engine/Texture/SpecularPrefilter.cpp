@@ -0,0 +1,561 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "SpecularPrefilter.h"
+
+#include <chrono>
+
+#include "glm/glm.hpp"
+
+#include "Engine/Helpers/JobSystem.h"
+#include "SphericalHarmonics.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	void CubeMipChain::Allocate(uint32_t dim, uint32_t levels)
+	{
+		dimension = dim;
+		mipLevels = levels;
+		vecRegionOffsets.resize(static_cast<size_t>(levels) * 6);
+
+		size_t offset = 0;
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			for (uint32_t level = 0; level < levels; ++level)
+			{
+				const size_t levelDimension = GetLevelDimension(level);
+				vecRegionOffsets[face * levels + level] = offset;
+				offset += levelDimension * levelDimension * 4;
+			}
+		}
+
+		vecData.assign(offset, 0.0f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Inverse of CubemapDirection, face & [0, 1] texture coordinates of a direction
+	void DirectionToCubeFace(const glm::vec3& direction, uint32_t& outFace, float& outU, float& outV)
+	{
+		const float absX = std::fabs(direction.x);
+		const float absY = std::fabs(direction.y);
+		const float absZ = std::fabs(direction.z);
+
+		float s, t;
+		if (absX >= absY && absX >= absZ)
+		{
+			outFace = direction.x > 0.0f ? 0 : 1;
+			s = (direction.x > 0.0f ? -direction.z : direction.z) / absX;
+			t = -direction.y / absX;
+		}
+		else if (absY >= absZ)
+		{
+			outFace = direction.y > 0.0f ? 2 : 3;
+			s = direction.x / absY;
+			t = (direction.y > 0.0f ? direction.z : -direction.z) / absY;
+		}
+		else
+		{
+			outFace = direction.z > 0.0f ? 4 : 5;
+			s = (direction.z > 0.0f ? direction.x : -direction.x) / absZ;
+			t = -direction.y / absZ;
+		}
+
+		outU = 0.5f * (s + 1.0f);
+		outV = 0.5f * (t + 1.0f);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Bilinear with clamp to edge, u & v in [0, 1] across a width x height RGBA32F image
+	glm::vec3 SampleBilinear(const float* pRGBA, uint32_t width, uint32_t height, float u, float v, bool bWrapU)
+	{
+		const float x = u * width - 0.5f;
+		const float y = v * height - 0.5f;
+
+		const float floorX = std::floor(x);
+		const float floorY = std::floor(y);
+		const float fracX = x - floorX;
+		const float fracY = y - floorY;
+
+		int x0 = static_cast<int>(floorX);
+		int x1 = x0 + 1;
+		const int y0 = std::min(std::max(static_cast<int>(floorY), 0), static_cast<int>(height) - 1);
+		const int y1 = std::min(std::max(static_cast<int>(floorY) + 1, 0), static_cast<int>(height) - 1);
+
+		if (bWrapU)
+		{
+			x0 = (x0 + static_cast<int>(width)) % static_cast<int>(width);
+			x1 = x1 % static_cast<int>(width);
+		}
+		else
+		{
+			x0 = std::min(std::max(x0, 0), static_cast<int>(width) - 1);
+			x1 = std::min(std::max(x1, 0), static_cast<int>(width) - 1);
+		}
+
+		const float* p00 = pRGBA + (static_cast<size_t>(y0) * width + x0) * 4;
+		const float* p10 = pRGBA + (static_cast<size_t>(y0) * width + x1) * 4;
+		const float* p01 = pRGBA + (static_cast<size_t>(y1) * width + x0) * 4;
+		const float* p11 = pRGBA + (static_cast<size_t>(y1) * width + x1) * 4;
+
+		glm::vec3 result;
+		for (int c = 0; c < 3; ++c)
+		{
+			const float top = p00[c] + (p10[c] - p00[c]) * fracX;
+			const float bottom = p01[c] + (p11[c] - p01[c]) * fracX;
+			(&result.x)[c] = top + (bottom - top) * fracY;
+		}
+
+		return result;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void EquirectToCubeMipChain(const float* pRGBA, uint32_t width, uint32_t height, uint32_t dimension, CubeMipChain& outCube)
+	{
+		outCube.Allocate(dimension, static_cast<uint32_t>(std::floor(std::log2(dimension))) + 1);
+
+		JobSystem::getInstance().ParallelFor(dimension * 6, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t rowIndex = begin; rowIndex < end; ++rowIndex)
+			{
+				const uint32_t face = rowIndex / dimension;
+				const uint32_t y = rowIndex % dimension;
+				float* pRow = outCube.GetLevel(face, 0) + static_cast<size_t>(y) * dimension * 4;
+
+				for (uint32_t x = 0; x < dimension; ++x)
+				{
+					const glm::vec3 direction = CubemapDirection(face, (x + 0.5f) / dimension, (y + 0.5f) / dimension);
+
+					// Inverse of EquirectDirection, u = 0 at -X turning towards -Z, v = 0 at -Y
+					float phi = std::atan2(-direction.z, -direction.x);
+					if (phi < 0.0f)
+						phi += static_cast<float>(2.0 * M_PI);
+
+					const float u = phi / static_cast<float>(2.0 * M_PI);
+					const float v = 1.0f - std::acos(std::min(std::max(direction.y, -1.0f), 1.0f)) / static_cast<float>(M_PI);
+
+					const glm::vec3 radiance = SampleBilinear(pRGBA, width, height, u, v, true);
+					pRow[x * 4 + 0] = radiance.x;
+					pRow[x * 4 + 1] = radiance.y;
+					pRow[x * 4 + 2] = radiance.z;
+					pRow[x * 4 + 3] = 1.0f;
+				}
+			}
+		});
+
+		GenerateCubeMips(outCube);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void GenerateCubeMips(CubeMipChain& cube)
+	{
+		for (uint32_t level = 1; level < cube.mipLevels; ++level)
+		{
+			const uint32_t sourceDimension = cube.GetLevelDimension(level - 1);
+			const uint32_t levelDimension = cube.GetLevelDimension(level);
+
+			JobSystem::getInstance().ParallelFor(levelDimension * 6, 16, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t rowIndex = begin; rowIndex < end; ++rowIndex)
+				{
+					const uint32_t face = rowIndex / levelDimension;
+					const uint32_t y = rowIndex % levelDimension;
+
+					const float* pSource = cube.GetLevel(face, level - 1);
+					float* pRow = cube.GetLevel(face, level) + static_cast<size_t>(y) * levelDimension * 4;
+
+					for (uint32_t x = 0; x < levelDimension; ++x)
+					{
+						const uint32_t x0 = std::min(x * 2, sourceDimension - 1), x1 = std::min(x * 2 + 1, sourceDimension - 1);
+						const uint32_t y0 = std::min(y * 2, sourceDimension - 1), y1 = std::min(y * 2 + 1, sourceDimension - 1);
+
+						for (int c = 0; c < 4; ++c)
+						{
+							pRow[x * 4 + c] = 0.25f * (pSource[(y0 * sourceDimension + x0) * 4 + c] + pSource[(y0 * sourceDimension + x1) * 4 + c] +
+													   pSource[(y1 * sourceDimension + x0) * 4 + c] + pSource[(y1 * sourceDimension + x1) * 4 + c]);
+						}
+					}
+				}
+			});
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void GenerateEquirectMips(const float* pRGBA, uint32_t width, uint32_t height, std::vector<float>& outData, std::vector<size_t>& outLevelOffsets)
+	{
+		const uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+		outLevelOffsets.resize(mipLevels);
+
+		size_t offset = 0;
+		for (uint32_t level = 0; level < mipLevels; ++level)
+		{
+			outLevelOffsets[level] = offset;
+			offset += static_cast<size_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+		}
+
+		outData.resize(offset);
+		std::copy(pRGBA, pRGBA + static_cast<size_t>(width) * height * 4, outData.begin());
+
+		for (uint32_t level = 1; level < mipLevels; ++level)
+		{
+			const uint32_t sourceWidth = std::max(width >> (level - 1), 1u), sourceHeight = std::max(height >> (level - 1), 1u);
+			const uint32_t levelWidth = std::max(width >> level, 1u), levelHeight = std::max(height >> level, 1u);
+
+			const float* pSource = &outData[outLevelOffsets[level - 1]];
+			float* pLevel = &outData[outLevelOffsets[level]];
+
+			JobSystem::getInstance().ParallelFor(levelHeight, 16, [&](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t y = begin; y < end; ++y)
+				{
+					float* pRow = pLevel + static_cast<size_t>(y) * levelWidth * 4;
+
+					for (uint32_t x = 0; x < levelWidth; ++x)
+					{
+						const uint32_t x0 = std::min(x * 2, sourceWidth - 1), x1 = std::min(x * 2 + 1, sourceWidth - 1);
+						const uint32_t y0 = std::min(y * 2, sourceHeight - 1), y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+						for (int c = 0; c < 4; ++c)
+						{
+							pRow[x * 4 + c] = 0.25f * (pSource[(y0 * sourceWidth + x0) * 4 + c] + pSource[(y0 * sourceWidth + x1) * 4 + c] +
+													   pSource[(y1 * sourceWidth + x0) * 4 + c] + pSource[(y1 * sourceWidth + x1) * 4 + c]);
+						}
+					}
+				}
+			});
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::vec3 SampleCubeMipChain(const CubeMipChain& cube, const glm::vec3& direction, float lod)
+	{
+		uint32_t face;
+		float u, v;
+		DirectionToCubeFace(direction, face, u, v);
+
+		lod = std::min(std::max(lod, 0.0f), static_cast<float>(cube.mipLevels - 1));
+		const uint32_t level0 = static_cast<uint32_t>(lod);
+		const uint32_t level1 = std::min(level0 + 1, cube.mipLevels - 1);
+		const float fraction = lod - level0;
+
+		const uint32_t dimension0 = cube.GetLevelDimension(level0);
+		const glm::vec3 sample0 = SampleBilinear(cube.GetLevel(face, level0), dimension0, dimension0, u, v, false);
+		if (fraction <= 0.0f || level1 == level0)
+			return sample0;
+
+		const uint32_t dimension1 = cube.GetLevelDimension(level1);
+		const glm::vec3 sample1 = SampleBilinear(cube.GetLevel(face, level1), dimension1, dimension1, u, v, false);
+		return sample0 + (sample1 - sample0) * fraction;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Tangent space GGX samples of one level, shared by every texel of it
+	struct PrefilterSample
+	{
+		glm::vec3				direction;				// L around N = +Z
+		float					weight;					// N.L
+		float					lod;					// Source level matching the sample's solid angle
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	float RadicalInverse(uint32_t bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return static_cast<float>(bits) * 2.3283064365386963e-10f;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<PrefilterSample> BuildLevelSamples(float roughness, uint32_t sampleCount, uint32_t sourceDimension, uint32_t sourceLevels,
+												   uint32_t levelDimension, bool bSourceMipSelection)
+	{
+		std::vector<PrefilterSample> vecSamples;
+
+		// Mirror level, one lookup at the source level matching the output texel size
+		if (roughness <= 0.0f)
+		{
+			PrefilterSample sample;
+			sample.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+			sample.weight = 1.0f;
+			sample.lod = bSourceMipSelection ? std::max(std::log2(static_cast<float>(sourceDimension) / levelDimension), 0.0f) : 0.0f;
+			vecSamples.push_back(sample);
+			return vecSamples;
+		}
+
+		const float alpha = roughness * roughness;
+		const float alphaSq = alpha * alpha;
+		const float texelSolidAngle = static_cast<float>(4.0 * M_PI) / (6.0f * sourceDimension * sourceDimension);
+
+		vecSamples.reserve(sampleCount);
+		for (uint32_t i = 0; i < sampleCount; ++i)
+		{
+			const float u1 = (i + 0.5f) / sampleCount;
+			const float u2 = RadicalInverse(i);
+
+			const float phi = static_cast<float>(2.0 * M_PI) * u1;
+			const float cosTheta = std::sqrt((1.0f - u2) / (1.0f + (alphaSq - 1.0f) * u2));
+			const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+			const glm::vec3 halfVector(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+			const glm::vec3 direction = halfVector * (2.0f * cosTheta) - glm::vec3(0.0f, 0.0f, 1.0f);
+			if (direction.z <= 0.0f)
+				continue;
+
+			PrefilterSample sample;
+			sample.direction = direction;
+			sample.weight = direction.z;
+			sample.lod = 0.0f;
+
+			if (bSourceMipSelection)
+			{
+				// pdf of L is D * N.H / (4 V.H), N = V makes it D / 4. The sample covers 1 / (count * pdf) steradians, the
+				// level whose texels are that big gets read, biased up one level against aliasing.
+				const float denominator = (alphaSq - 1.0f) * cosTheta * cosTheta + 1.0f;
+				const float distribution = alphaSq / (static_cast<float>(M_PI) * denominator * denominator);
+				const float sampleSolidAngle = 1.0f / (sampleCount * distribution * 0.25f + 1e-6f);
+
+				sample.lod = std::min(std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f, 0.0f), static_cast<float>(sourceLevels - 1));
+			}
+
+			vecSamples.push_back(sample);
+		}
+
+		return vecSamples;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void BakePrefilteredSpecular(const CubeMipChain& source, const PrefilterSettings& settings, CubeMipChain& outCube,
+								 PrefilterReport* pOutReport, bool bSingleThread)
+	{
+		const auto bakeStart = std::chrono::high_resolution_clock::now();
+
+		const uint32_t fullChain = static_cast<uint32_t>(std::floor(std::log2(settings.dimension))) + 1;
+		const uint32_t levels = settings.mipLevels > 0 ? std::min(settings.mipLevels, fullChain) : fullChain;
+		outCube.Allocate(settings.dimension, levels);
+
+		// Sample count grows with roughness, wider lobes need more directions even with the blurrier source levels
+		std::vector<std::vector<PrefilterSample>> vecLevelSamples(levels);
+		std::vector<uint32_t> vecSamplesPerLevel(levels);
+		for (uint32_t level = 0; level < levels; ++level)
+		{
+			const float roughness = levels > 1 ? static_cast<float>(level) / (levels - 1) : 0.0f;
+			const uint32_t sampleCount = settings.minSamples + static_cast<uint32_t>((settings.maxSamples - settings.minSamples) * roughness);
+
+			vecLevelSamples[level] = BuildLevelSamples(roughness, sampleCount, source.dimension, source.mipLevels,
+													   outCube.GetLevelDimension(level), settings.bSourceMipSelection);
+			vecSamplesPerLevel[level] = static_cast<uint32_t>(vecLevelSamples[level].size());
+		}
+
+		// Jobs are tiles of a face of a level, levels & faces interleave across the workers
+		struct PrefilterJob
+		{
+			uint32_t			level;
+			uint32_t			face;
+			uint32_t			x0, y0, x1, y1;
+		};
+
+		std::vector<PrefilterJob> vecJobs;
+		uint64_t sampleCount = 0;
+		for (uint32_t level = 0; level < levels; ++level)
+		{
+			const uint32_t levelDimension = outCube.GetLevelDimension(level);
+			sampleCount += static_cast<uint64_t>(levelDimension) * levelDimension * 6 * vecSamplesPerLevel[level];
+
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				for (uint32_t y = 0; y < levelDimension; y += settings.tileSize)
+				{
+					for (uint32_t x = 0; x < levelDimension; x += settings.tileSize)
+					{
+						vecJobs.push_back({ level, face, x, y, std::min(x + settings.tileSize, levelDimension), std::min(y + settings.tileSize, levelDimension) });
+					}
+				}
+			}
+		}
+
+		auto bakeJobs = [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t jobIndex = begin; jobIndex < end; ++jobIndex)
+			{
+				const PrefilterJob& job = vecJobs[jobIndex];
+				const uint32_t levelDimension = outCube.GetLevelDimension(job.level);
+				const std::vector<PrefilterSample>& vecSamples = vecLevelSamples[job.level];
+				float* pLevel = outCube.GetLevel(job.face, job.level);
+
+				for (uint32_t y = job.y0; y < job.y1; ++y)
+				{
+					for (uint32_t x = job.x0; x < job.x1; ++x)
+					{
+						const glm::vec3 normal = CubemapDirection(job.face, (x + 0.5f) / levelDimension, (y + 0.5f) / levelDimension);
+						const glm::vec3 up = std::fabs(normal.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+						const glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+						const glm::vec3 bitangent = glm::cross(normal, tangent);
+
+						glm::vec3 radiance(0.0f);
+						float totalWeight = 0.0f;
+						for (const PrefilterSample& sample : vecSamples)
+						{
+							const glm::vec3 direction = tangent * sample.direction.x + bitangent * sample.direction.y + normal * sample.direction.z;
+							radiance += SampleCubeMipChain(source, direction, sample.lod) * sample.weight;
+							totalWeight += sample.weight;
+						}
+						radiance = radiance * (1.0f / totalWeight);
+
+						float* pTexel = pLevel + (static_cast<size_t>(y) * levelDimension + x) * 4;
+						pTexel[0] = radiance.x;
+						pTexel[1] = radiance.y;
+						pTexel[2] = radiance.z;
+						pTexel[3] = 1.0f;
+					}
+				}
+			}
+		};
+
+		if (bSingleThread)
+			bakeJobs(0, static_cast<uint32_t>(vecJobs.size()));
+		else
+			JobSystem::getInstance().ParallelFor(static_cast<uint32_t>(vecJobs.size()), 1, bakeJobs);
+
+		if (pOutReport)
+		{
+			const auto bakeEnd = std::chrono::high_resolution_clock::now();
+
+			pOutReport->bakeMs = std::chrono::duration<float, std::milli>(bakeEnd - bakeStart).count();
+			pOutReport->jobCount = static_cast<uint32_t>(vecJobs.size());
+			pOutReport->threadCount = bSingleThread ? 1 : JobSystem::getInstance().GetThreadCount();
+			pOutReport->sampleCount = sampleCount;
+			pOutReport->vecSamplesPerLevel = vecSamplesPerLevel;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Benchmark
+	//-----------------------------------------------------------------------------------------------------------------------
+	float MeanRelativeDifference(const CubeMipChain& cube, const CubeMipChain& reference, uint32_t level)
+	{
+		double difference = 0.0;
+		uint64_t count = 0;
+
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			const uint32_t levelDimension = cube.GetLevelDimension(level);
+			const float* pCube = cube.GetLevel(face, level);
+			const float* pReference = reference.GetLevel(face, level);
+
+			for (uint32_t i = 0; i < levelDimension * levelDimension; ++i)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					difference += std::fabs(pCube[i * 4 + c] - pReference[i * 4 + c]) / std::max(pReference[i * 4 + c], 1e-3f);
+					++count;
+				}
+			}
+		}
+
+		return static_cast<float>(difference / std::max<uint64_t>(count, 1));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<PrefilterBenchmarkResult> RunPrefilterBenchmark()
+	{
+		std::vector<PrefilterBenchmarkResult> vecResults;
+
+		const uint32_t sourceWidth = 1024;
+		const uint32_t sourceHeight = 512;
+
+		// Sky gradient with a small, very bright sun, the case where level 0 only sampling shows fireflies
+		std::vector<float> vecEquirect(static_cast<size_t>(sourceWidth) * sourceHeight * 4);
+		const glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 0.6f, -0.7f));
+		JobSystem::getInstance().ParallelFor(sourceHeight, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				for (uint32_t x = 0; x < sourceWidth; ++x)
+				{
+					const glm::vec3 direction = EquirectDirection((x + 0.5f) / sourceWidth, (y + 0.5f) / sourceHeight);
+					const float height = direction.y;
+					glm::vec3 radiance = height >= 0.0f ? glm::mix(glm::vec3(1.0f, 0.9f, 0.8f), glm::vec3(0.3f, 0.5f, 1.0f), std::sqrt(height))
+														: glm::mix(glm::vec3(1.0f, 0.9f, 0.8f), glm::vec3(0.25f, 0.2f, 0.15f), std::sqrt(-height));
+					if (glm::dot(direction, sunDirection) > 0.9995f)
+						radiance += glm::vec3(5000.0f, 4500.0f, 4000.0f);
+
+					float* pTexel = &vecEquirect[(static_cast<size_t>(y) * sourceWidth + x) * 4];
+					pTexel[0] = radiance.x;
+					pTexel[1] = radiance.y;
+					pTexel[2] = radiance.z;
+					pTexel[3] = 1.0f;
+				}
+			}
+		});
+
+		CubeMipChain source;
+		EquirectToCubeMipChain(vecEquirect.data(), sourceWidth, sourceHeight, 256, source);
+
+		CubeMipChain constantSource;
+		constantSource.Allocate(64, 7);
+		std::fill(constantSource.vecData.begin(), constantSource.vecData.end(), 1.0f);
+
+		struct BenchmarkCase
+		{
+			const char*			name;
+			uint32_t			dimension;
+			bool				bSourceMipSelection;
+		};
+		const BenchmarkCase arrCases[3] = { { "Sky", 128, true }, { "Sky", 256, true }, { "Sky, level 0 only", 128, false } };
+
+		for (const BenchmarkCase& benchmarkCase : arrCases)
+		{
+			PrefilterSettings settings;
+			settings.dimension = benchmarkCase.dimension;
+			settings.bSourceMipSelection = benchmarkCase.bSourceMipSelection;
+
+			PrefilterBenchmarkResult result = {};
+			result.name = benchmarkCase.name;
+			result.sourceDimension = source.dimension;
+			result.dimension = benchmarkCase.dimension;
+
+			CubeMipChain cube;
+			PrefilterReport report;
+			BakePrefilteredSpecular(source, settings, cube, &report);
+			result.mipLevels = cube.mipLevels;
+			result.bakeMs = report.bakeMs;
+			result.sampleCount = report.sampleCount;
+
+			CubeMipChain singleThreadCube;
+			PrefilterReport singleThreadReport;
+			BakePrefilteredSpecular(source, settings, singleThreadCube, &singleThreadReport, true);
+			result.bakeSingleThreadMs = singleThreadReport.bakeMs;
+
+			// Noise of the roughness 0.5 level of a 3 level bake against one with 4x the samples, mip selection as configured
+			PrefilterSettings referenceSettings = settings;
+			referenceSettings.mipLevels = 3;
+			referenceSettings.minSamples *= 4;
+			referenceSettings.maxSamples *= 4;
+			CubeMipChain referenceCube;
+			BakePrefilteredSpecular(source, referenceSettings, referenceCube);
+
+			PrefilterSettings noiseSettings = settings;
+			noiseSettings.mipLevels = 3;
+			CubeMipChain noiseCube;
+			BakePrefilteredSpecular(source, noiseSettings, noiseCube);
+			result.noise = MeanRelativeDifference(noiseCube, referenceCube, 1);
+
+			// Any weighting or lookup bias shows up as a deviation from 1
+			CubeMipChain constantCube;
+			BakePrefilteredSpecular(constantSource, settings, constantCube);
+			for (float value : constantCube.vecData)
+				result.constantError = std::max(result.constantError, std::fabs(value - 1.0f));
+
+			LOG_INFO("Prefilter {0} {1}: {2} levels, {3:.1f} ms ({4:.1f} ms single thread, {5} threads), {6} M samples, noise {7:.2f}%, constant error {8:.2e}",
+					 result.name, result.dimension, result.mipLevels, result.bakeMs, result.bakeSingleThreadMs, report.threadCount,
+					 result.sampleCount / 1000000, result.noise * 100.0f, result.constantError);
+
+			vecResults.push_back(result);
+		}
+
+		return vecResults;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- RGBA32F cube with a mip chain in one allocation. Face major, every level of +X first, the region order
+	//--- VulkanTextureCUBE copies into a cube image with. Faces are +X, -X, +Y, -Y, +Z, -Z like Texture::CubemapDirection.
+	struct CubeMipChain
+	{
+		uint32_t				dimension = 0;
+		uint32_t				mipLevels = 0;
+		std::vector<float>		vecData;
+		std::vector<size_t>		vecRegionOffsets;		// face * mipLevels + level, in floats
+
+		void					Allocate(uint32_t dim, uint32_t levels);
+		uint32_t				GetLevelDimension(uint32_t level) const { return std::max(dimension >> level, 1u); }
+		float*					GetLevel(uint32_t face, uint32_t level) { return &vecData[vecRegionOffsets[face * mipLevels + level]]; }
+		const float*			GetLevel(uint32_t face, uint32_t level) const { return &vecData[vecRegionOffsets[face * mipLevels + level]]; }
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct PrefilterSettings
+	{
+		uint32_t				dimension = 256;		// Face size of the prefiltered level 0
+		uint32_t				mipLevels = 0;			// 0 for the full chain, roughness runs linearly from 0 to 1 across it
+		uint32_t				minSamples = 16;		// Samples at the lowest non zero roughness, scaling linearly up to maxSamples
+		uint32_t				maxSamples = 512;
+		uint32_t				tileSize = 32;			// Texels per side of a job
+		bool					bSourceMipSelection = true;	// Filtered importance sampling, off reads every sample from level 0
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct PrefilterReport
+	{
+		float					bakeMs;
+		uint32_t				jobCount;
+		uint32_t				threadCount;
+		uint64_t				sampleCount;			// Source lookups across every texel of every level
+		std::vector<uint32_t>	vecSamplesPerLevel;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct PrefilterBenchmarkResult
+	{
+		std::string				name;
+		uint32_t				sourceDimension;
+		uint32_t				dimension;
+		uint32_t				mipLevels;
+		float					bakeMs;
+		float					bakeSingleThreadMs;
+		uint64_t				sampleCount;
+		float					noise;					// Mean relative difference to a 4x sample bake at roughness 0.5
+		float					constantError;			// Largest deviation of a constant environment, should be ~0
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Source radiance, bilinear resample of an equirect (Texture::HDRImage layout, row 0 at the bottom) & a box filtered
+	//--- mip chain down to 1x1
+	void						EquirectToCubeMipChain(const float* pRGBA, uint32_t width, uint32_t height, uint32_t dimension, CubeMipChain& outCube);
+	void						GenerateCubeMips(CubeMipChain& cube);
+
+	//--- Box filtered mip chain of an equirect down to 1x1, level 0 copied as is. Levels back to back, outLevelOffsets in floats.
+	void						GenerateEquirectMips(const float* pRGBA, uint32_t width, uint32_t height, std::vector<float>& outData,
+													 std::vector<size_t>& outLevelOffsets);
+
+	//--- Trilinear lookup, faces are clamped at their edges
+	glm::vec3					SampleCubeMipChain(const CubeMipChain& cube, const glm::vec3& direction, float lod);
+
+	//--- GGX prefiltered specular cube as the split sum approximation expects it (N = V = R), level m holds roughness
+	//--- m / (levels - 1). Samples are importance sampled & weighted by N.L, each one reads the source level matching its
+	//--- solid angle. Faces, levels & tiles bake in parallel across the JobSystem.
+	void						BakePrefilteredSpecular(const CubeMipChain& source, const PrefilterSettings& settings, CubeMipChain& outCube,
+														PrefilterReport* pOutReport = nullptr, bool bSingleThread = false);
+
+	//--- Synthetic sky with a sun & a noise environment, timed threaded & single threaded at 128 & 256
+	std::vector<PrefilterBenchmarkResult>	RunPrefilterBenchmark();
+}
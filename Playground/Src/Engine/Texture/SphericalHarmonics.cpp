@@ -0,0 +1,655 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "SphericalHarmonics.h"
+
+#include <chrono>
+
+#include "glm/glm.hpp"
+
+#include "Engine/Helpers/JobSystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define SH_PROJECTION_X86 1
+	#include <immintrin.h>
+#else
+	#define SH_PROJECTION_X86 0
+#endif
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Real SH basis constants
+	static const float SH_Y00 = 0.282095f;				// 1 / (2 sqrt(PI))
+	static const float SH_Y1 = 0.488603f;				// sqrt(3) / (2 sqrt(PI))
+	static const float SH_Y2_CROSS = 1.092548f;			// sqrt(15) / (2 sqrt(PI)), xy, yz & xz
+	static const float SH_Y20 = 0.315392f;				// sqrt(5) / (4 sqrt(PI)), 3z^2 - 1
+	static const float SH_Y22 = 0.546274f;				// sqrt(15) / (4 sqrt(PI)), x^2 - y^2
+
+	//--- Clamped cosine convolution per band divided by PI, so the result matches the irradiance cube's E / PI
+	static const float SH_IRRADIANCE_BAND[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+
+	//--- Face basis, texel direction = centre + s * right + t * down for s, t in [-1, 1]
+	static const glm::vec3 CUBE_FACE_CENTRE[6] = { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) };
+	static const glm::vec3 CUBE_FACE_RIGHT[6] = { glm::vec3(0, 0, -1), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(1, 0, 0), glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0) };
+	static const glm::vec3 CUBE_FACE_DOWN[6] = { glm::vec3(0, -1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(0, -1, 0), glm::vec3(0, -1, 0) };
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- One row of source texels as directions & solid angles, structure of arrays for the SIMD loop
+	struct SHRowScratch
+	{
+		std::vector<float>		vecX;
+		std::vector<float>		vecY;
+		std::vector<float>		vecZ;
+		std::vector<float>		vecWeight;
+
+		void Resize(uint32_t count)
+		{
+			vecX.resize(count);
+			vecY.resize(count);
+			vecZ.resize(count);
+			vecWeight.resize(count);
+		}
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Per source layout tables, built once per projection & shared by every row
+	struct EquirectLayout
+	{
+		uint32_t				width;
+		uint32_t				height;
+		std::vector<float>		vecCosPhi;
+		std::vector<float>		vecSinPhi;
+
+		void Build(uint32_t w, uint32_t h)
+		{
+			width = w;
+			height = h;
+			vecCosPhi.resize(w);
+			vecSinPhi.resize(w);
+
+			for (uint32_t x = 0; x < w; ++x)
+			{
+				const double phi = 2.0 * M_PI * (x + 0.5) / w;
+				vecCosPhi[x] = static_cast<float>(std::cos(phi));
+				vecSinPhi[x] = static_cast<float>(std::sin(phi));
+			}
+		}
+
+		// Row 0 at the bottom, the polar angle from +Y runs from PI down to 0
+		void FillRow(uint32_t y, SHRowScratch& row) const
+		{
+			const double thetaBottom = M_PI * (1.0 - static_cast<double>(y) / height);
+			const double thetaTop = M_PI * (1.0 - static_cast<double>(y + 1) / height);
+			const double theta = M_PI * (1.0 - (y + 0.5) / height);
+
+			// Exact solid angle of the band, split evenly across the row
+			const float weight = static_cast<float>(2.0 * M_PI / width * (std::cos(thetaTop) - std::cos(thetaBottom)));
+			const float cosTheta = static_cast<float>(std::cos(theta));
+			const float sinTheta = static_cast<float>(std::sin(theta));
+
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				row.vecX[x] = -sinTheta * vecCosPhi[x];
+				row.vecY[x] = cosTheta;
+				row.vecZ[x] = -sinTheta * vecSinPhi[x];
+				row.vecWeight[x] = weight;
+			}
+		}
+	};
+
+	struct CubemapLayout
+	{
+		uint32_t				dimension;
+		float					weightScale;
+		std::vector<float>		vecCoord;				// Texel centre in [-1, 1]
+
+		void Build(uint32_t dim)
+		{
+			dimension = dim;
+			vecCoord.resize(dim);
+
+			for (uint32_t i = 0; i < dim; ++i)
+				vecCoord[i] = 2.0f * (i + 0.5f) / dim - 1.0f;
+
+			// Differential solid angle (2 / dim)^2 / (1 + s^2 + t^2)^1.5, rescaled so a face integrates to exactly 4 PI / 6
+			double faceSum = 0.0;
+			for (uint32_t t = 0; t < dim; ++t)
+			{
+				for (uint32_t s = 0; s < dim; ++s)
+				{
+					const double lengthSq = 1.0 + vecCoord[s] * vecCoord[s] + vecCoord[t] * vecCoord[t];
+					faceSum += 1.0 / (lengthSq * std::sqrt(lengthSq));
+				}
+			}
+
+			weightScale = static_cast<float>((4.0 * M_PI / 6.0) / faceSum);
+		}
+
+		// Rows of every face back to back, face major
+		void FillRow(uint32_t rowIndex, SHRowScratch& row) const
+		{
+			const uint32_t face = rowIndex / dimension;
+			const float t = vecCoord[rowIndex % dimension];
+
+			const glm::vec3 base = CUBE_FACE_CENTRE[face] + CUBE_FACE_DOWN[face] * t;
+			const glm::vec3 right = CUBE_FACE_RIGHT[face];
+
+			for (uint32_t x = 0; x < dimension; ++x)
+			{
+				const float s = vecCoord[x];
+				const float lengthSq = 1.0f + s * s + t * t;
+				const float invLength = 1.0f / std::sqrt(lengthSq);
+
+				row.vecX[x] = (base.x + right.x * s) * invLength;
+				row.vecY[x] = (base.y + right.y * s) * invLength;
+				row.vecZ[x] = (base.z + right.z * s) * invLength;
+				row.vecWeight[x] = weightScale * invLength * invLength * invLength;
+			}
+		}
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Row kernels, 27 sums laid out as coefficient * 3 + channel & added onto pOutSums
+	//-----------------------------------------------------------------------------------------------------------------------
+	void AccumulateRowScalar(const float* pRGBA, const SHRowScratch& row, uint32_t begin, uint32_t end, double* pOutSums)
+	{
+		float arrSums[27] = {};
+
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const float x = row.vecX[i];
+			const float y = row.vecY[i];
+			const float z = row.vecZ[i];
+			const float w = row.vecWeight[i];
+
+			const float arrBasis[9] = { SH_Y00,
+										SH_Y1 * y, SH_Y1 * z, SH_Y1 * x,
+										SH_Y2_CROSS * x * y, SH_Y2_CROSS * y * z, SH_Y20 * (3.0f * z * z - 1.0f), SH_Y2_CROSS * x * z, SH_Y22 * (x * x - y * y) };
+
+			const float r = pRGBA[i * 4 + 0] * w;
+			const float g = pRGBA[i * 4 + 1] * w;
+			const float b = pRGBA[i * 4 + 2] * w;
+
+			for (int k = 0; k < 9; ++k)
+			{
+				arrSums[k * 3 + 0] += arrBasis[k] * r;
+				arrSums[k * 3 + 1] += arrBasis[k] * g;
+				arrSums[k * 3 + 2] += arrBasis[k] * b;
+			}
+		}
+
+		for (int k = 0; k < 27; ++k)
+			pOutSums[k] += arrSums[k];
+	}
+
+#if SH_PROJECTION_X86
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Four texels per iteration, RGBA transposed into channel registers
+	void AccumulateRowSSE(const float* pRGBA, const SHRowScratch& row, uint32_t count, double* pOutSums)
+	{
+		__m128 arrSums[27];
+		for (int k = 0; k < 27; ++k)
+			arrSums[k] = _mm_setzero_ps();
+
+		const __m128 y00 = _mm_set1_ps(SH_Y00);
+		const __m128 y1 = _mm_set1_ps(SH_Y1);
+		const __m128 y2Cross = _mm_set1_ps(SH_Y2_CROSS);
+		const __m128 y20 = _mm_set1_ps(SH_Y20);
+		const __m128 y22 = _mm_set1_ps(SH_Y22);
+		const __m128 three = _mm_set1_ps(3.0f);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		const uint32_t simdCount = count & ~3u;
+		for (uint32_t i = 0; i < simdCount; i += 4)
+		{
+			const __m128 x = _mm_loadu_ps(&row.vecX[i]);
+			const __m128 y = _mm_loadu_ps(&row.vecY[i]);
+			const __m128 z = _mm_loadu_ps(&row.vecZ[i]);
+			const __m128 w = _mm_loadu_ps(&row.vecWeight[i]);
+
+			__m128 r = _mm_loadu_ps(pRGBA + i * 4 + 0);
+			__m128 g = _mm_loadu_ps(pRGBA + i * 4 + 4);
+			__m128 b = _mm_loadu_ps(pRGBA + i * 4 + 8);
+			__m128 a = _mm_loadu_ps(pRGBA + i * 4 + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+
+			r = _mm_mul_ps(r, w);
+			g = _mm_mul_ps(g, w);
+			b = _mm_mul_ps(b, w);
+
+			const __m128 arrBasis[9] = { y00,
+										 _mm_mul_ps(y1, y), _mm_mul_ps(y1, z), _mm_mul_ps(y1, x),
+										 _mm_mul_ps(y2Cross, _mm_mul_ps(x, y)),
+										 _mm_mul_ps(y2Cross, _mm_mul_ps(y, z)),
+										 _mm_mul_ps(y20, _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(z, z)), one)),
+										 _mm_mul_ps(y2Cross, _mm_mul_ps(x, z)),
+										 _mm_mul_ps(y22, _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))) };
+
+			for (int k = 0; k < 9; ++k)
+			{
+				arrSums[k * 3 + 0] = _mm_add_ps(arrSums[k * 3 + 0], _mm_mul_ps(arrBasis[k], r));
+				arrSums[k * 3 + 1] = _mm_add_ps(arrSums[k * 3 + 1], _mm_mul_ps(arrBasis[k], g));
+				arrSums[k * 3 + 2] = _mm_add_ps(arrSums[k * 3 + 2], _mm_mul_ps(arrBasis[k], b));
+			}
+		}
+
+		for (int k = 0; k < 27; ++k)
+		{
+			alignas(16) float arrLanes[4];
+			_mm_store_ps(arrLanes, arrSums[k]);
+			pOutSums[k] += (static_cast<double>(arrLanes[0]) + arrLanes[1]) + (static_cast<double>(arrLanes[2]) + arrLanes[3]);
+		}
+
+		AccumulateRowScalar(pRGBA, row, simdCount, count, pOutSums);
+	}
+#endif
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Shared driver, rows are summed on their own & reduced in row order so the result doesn't depend on the thread count
+	template<typename Layout>
+	void ProjectRows(const Layout& layout, uint32_t rowCount, uint32_t rowLength, const std::function<const float*(uint32_t)>& getRow,
+					 SH9Color& outSH, SHProjectionReport* pOutReport, bool bScalar)
+	{
+		const auto projectStart = std::chrono::high_resolution_clock::now();
+
+		std::vector<double> vecRowSums(static_cast<size_t>(rowCount) * 27, 0.0);
+		const bool bSimd = !bScalar && SH_PROJECTION_X86;
+
+		auto projectRange = [&](uint32_t begin, uint32_t end)
+		{
+			SHRowScratch row;
+			row.Resize(rowLength);
+
+			for (uint32_t y = begin; y < end; ++y)
+			{
+				layout.FillRow(y, row);
+
+				double* pSums = &vecRowSums[static_cast<size_t>(y) * 27];
+#if SH_PROJECTION_X86
+				if (bSimd)
+				{
+					AccumulateRowSSE(getRow(y), row, rowLength, pSums);
+					continue;
+				}
+#endif
+				AccumulateRowScalar(getRow(y), row, 0, rowLength, pSums);
+			}
+		};
+
+		if (bScalar)
+			projectRange(0, rowCount);
+		else
+			JobSystem::getInstance().ParallelFor(rowCount, 8, projectRange);
+
+		double arrTotal[27] = {};
+		for (uint32_t y = 0; y < rowCount; ++y)
+		{
+			for (int k = 0; k < 27; ++k)
+				arrTotal[k] += vecRowSums[static_cast<size_t>(y) * 27 + k];
+		}
+
+		for (int k = 0; k < 9; ++k)
+			outSH.coefficients[k] = glm::vec3(static_cast<float>(arrTotal[k * 3 + 0]), static_cast<float>(arrTotal[k * 3 + 1]), static_cast<float>(arrTotal[k * 3 + 2]));
+
+		if (pOutReport)
+		{
+			const auto projectEnd = std::chrono::high_resolution_clock::now();
+
+			pOutReport->projectMs = std::chrono::duration<float, std::milli>(projectEnd - projectStart).count();
+			pOutReport->texelCount = rowCount * rowLength;
+			pOutReport->threadCount = bScalar ? 1 : JobSystem::getInstance().GetThreadCount();
+			pOutReport->bSimd = bSimd;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void ProjectEquirectSH(const float* pRGBA, uint32_t width, uint32_t height, SH9Color& outSH, SHProjectionReport* pOutReport, bool bScalar)
+	{
+		EquirectLayout layout;
+		layout.Build(width, height);
+
+		ProjectRows(layout, height, width, [&](uint32_t y) { return pRGBA + static_cast<size_t>(y) * width * 4; }, outSH, pOutReport, bScalar);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void ProjectCubemapSH(const float* const* ppFaces, uint32_t dimension, SH9Color& outSH, SHProjectionReport* pOutReport, bool bScalar)
+	{
+		CubemapLayout layout;
+		layout.Build(dimension);
+
+		ProjectRows(layout, dimension * 6, dimension, [&](uint32_t rowIndex)
+		{
+			return ppFaces[rowIndex / dimension] + static_cast<size_t>(rowIndex % dimension) * dimension * 4;
+		}, outSH, pOutReport, bScalar);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::vec3 EquirectDirection(float u, float v)
+	{
+		const float phi = static_cast<float>(2.0 * M_PI) * u;
+		const float theta = static_cast<float>(M_PI) * (1.0f - v);
+
+		return glm::vec3(-std::sin(theta) * std::cos(phi), std::cos(theta), -std::sin(theta) * std::sin(phi));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::vec3 CubemapDirection(uint32_t face, float u, float v)
+	{
+		const float s = 2.0f * u - 1.0f;
+		const float t = 2.0f * v - 1.0f;
+
+		return glm::normalize(CUBE_FACE_CENTRE[face] + CUBE_FACE_RIGHT[face] * s + CUBE_FACE_DOWN[face] * t);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	glm::vec3 EvaluateIrradianceSH(const SH9Color& radianceSH, const glm::vec3& normal)
+	{
+		const float x = normal.x;
+		const float y = normal.y;
+		const float z = normal.z;
+
+		const float arrBasis[9] = { SH_Y00,
+									SH_Y1 * y, SH_Y1 * z, SH_Y1 * x,
+									SH_Y2_CROSS * x * y, SH_Y2_CROSS * y * z, SH_Y20 * (3.0f * z * z - 1.0f), SH_Y2_CROSS * x * z, SH_Y22 * (x * x - y * y) };
+		const int arrBand[9] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+		glm::vec3 irradiance(0.0f);
+		for (int k = 0; k < 9; ++k)
+			irradiance += radianceSH.coefficients[k] * (SH_IRRADIANCE_BAND[arrBand[k]] * arrBasis[k]);
+
+		return glm::max(irradiance, glm::vec3(0.0f));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	SHIrradianceGPU PackIrradianceSH(const SH9Color& radianceSH)
+	{
+		const glm::vec3* pL = radianceSH.coefficients;
+
+		SHIrradianceGPU packed;
+		packed.coefficients[0] = glm::vec4(pL[0] * (SH_IRRADIANCE_BAND[0] * SH_Y00) - pL[6] * (SH_IRRADIANCE_BAND[2] * SH_Y20), 0.0f);
+		packed.coefficients[1] = glm::vec4(pL[1] * (SH_IRRADIANCE_BAND[1] * SH_Y1), 0.0f);
+		packed.coefficients[2] = glm::vec4(pL[2] * (SH_IRRADIANCE_BAND[1] * SH_Y1), 0.0f);
+		packed.coefficients[3] = glm::vec4(pL[3] * (SH_IRRADIANCE_BAND[1] * SH_Y1), 0.0f);
+		packed.coefficients[4] = glm::vec4(pL[4] * (SH_IRRADIANCE_BAND[2] * SH_Y2_CROSS), 0.0f);
+		packed.coefficients[5] = glm::vec4(pL[5] * (SH_IRRADIANCE_BAND[2] * SH_Y2_CROSS), 0.0f);
+		packed.coefficients[6] = glm::vec4(pL[6] * (SH_IRRADIANCE_BAND[2] * SH_Y20 * 3.0f), 0.0f);
+		packed.coefficients[7] = glm::vec4(pL[7] * (SH_IRRADIANCE_BAND[2] * SH_Y2_CROSS), 0.0f);
+		packed.coefficients[8] = glm::vec4(pL[8] * (SH_IRRADIANCE_BAND[2] * SH_Y22), 0.0f);
+
+		return packed;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Validation
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Radiance of the synthetic environments
+	glm::vec3 SampleValidationEnvironment(uint32_t environment, const glm::vec3& direction)
+	{
+		const glm::vec3 ground(0.25f, 0.2f, 0.15f);
+		const glm::vec3 horizon(1.0f, 0.9f, 0.8f);
+		const glm::vec3 zenith(0.3f, 0.5f, 1.0f);
+
+		const float height = direction.y;
+		const glm::vec3 sky = height >= 0.0f ? horizon + (zenith - horizon) * std::sqrt(height) : horizon + (ground - horizon) * std::sqrt(-height);
+
+		switch (environment)
+		{
+			case 0:
+				return glm::vec3(1.0f);
+
+			case 1:
+				return sky;
+
+			case 2:
+			{
+				// Dim sky & a ~5 degree sun a few thousand times brighter, the worst case for 9 coefficients
+				const glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 0.6f, -0.7f));
+				const float sunCos = glm::dot(direction, sunDirection);
+				return sky * 0.1f + (sunCos > 0.9962f ? glm::vec3(2000.0f, 1800.0f, 1500.0f) : glm::vec3(0.0f));
+			}
+
+			default:
+			{
+				// Log uniform white noise over ~4 stops, hashed from the quantised direction
+				uint32_t hash = static_cast<uint32_t>(static_cast<int32_t>(std::floor(direction.x * 512.0f)) * 73856093) ^
+								static_cast<uint32_t>(static_cast<int32_t>(std::floor(direction.y * 512.0f)) * 19349663) ^
+								static_cast<uint32_t>(static_cast<int32_t>(std::floor(direction.z * 512.0f)) * 83492791);
+
+				glm::vec3 noise;
+				for (int c = 0; c < 3; ++c)
+				{
+					hash ^= hash >> 16;
+					hash *= 0x7FEB352D;
+					hash ^= hash >> 15;
+					hash *= 0x846CA68B;
+					hash ^= hash >> 16;
+
+					const float unit = (hash & 0xFFFFFF) / 16777216.0f;
+					(&noise.x)[c] = std::exp2(unit * 4.0f - 2.0f);
+				}
+
+				return noise;
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Brute force E / PI over every source texel at the texel centres of a reference cube, which is what the irradiance
+	//--- cube pass integrated (with a coarser sample set) per output texel
+	template<typename Layout>
+	std::vector<glm::vec3> ComputeReferenceIrradiance(const Layout& layout, uint32_t rowCount, uint32_t rowLength,
+													  const std::function<const float*(uint32_t)>& getRow, uint32_t referenceDimension)
+	{
+		const uint32_t texelCount = rowCount * rowLength;
+
+		std::vector<float> vecX(texelCount), vecY(texelCount), vecZ(texelCount), vecR(texelCount), vecG(texelCount), vecB(texelCount);
+		SHRowScratch row;
+		row.Resize(rowLength);
+		for (uint32_t y = 0; y < rowCount; ++y)
+		{
+			layout.FillRow(y, row);
+
+			const float* pRGBA = getRow(y);
+			for (uint32_t x = 0; x < rowLength; ++x)
+			{
+				const uint32_t index = y * rowLength + x;
+				vecX[index] = row.vecX[x];
+				vecY[index] = row.vecY[x];
+				vecZ[index] = row.vecZ[x];
+				vecR[index] = pRGBA[x * 4 + 0] * row.vecWeight[x];
+				vecG[index] = pRGBA[x * 4 + 1] * row.vecWeight[x];
+				vecB[index] = pRGBA[x * 4 + 2] * row.vecWeight[x];
+			}
+		}
+
+		const uint32_t outputCount = referenceDimension * referenceDimension * 6;
+		std::vector<glm::vec3> vecIrradiance(outputCount);
+
+		JobSystem::getInstance().ParallelFor(outputCount, 16, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t face = i / (referenceDimension * referenceDimension);
+				const uint32_t texel = i % (referenceDimension * referenceDimension);
+				const glm::vec3 normal = CubemapDirection(face, ((texel % referenceDimension) + 0.5f) / referenceDimension, ((texel / referenceDimension) + 0.5f) / referenceDimension);
+
+				double r = 0.0, g = 0.0, b = 0.0;
+				for (uint32_t s = 0; s < texelCount; ++s)
+				{
+					const float cosine = normal.x * vecX[s] + normal.y * vecY[s] + normal.z * vecZ[s];
+					if (cosine <= 0.0f)
+						continue;
+
+					r += vecR[s] * cosine;
+					g += vecG[s] * cosine;
+					b += vecB[s] * cosine;
+				}
+
+				vecIrradiance[i] = glm::vec3(static_cast<float>(r / M_PI), static_cast<float>(g / M_PI), static_cast<float>(b / M_PI));
+			}
+		});
+
+		return vecIrradiance;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	template<typename Layout>
+	SHValidationResult ValidateSource(const std::string& name, const Layout& layout, uint32_t rowCount, uint32_t rowLength,
+									  const std::function<const float*(uint32_t)>& getRow,
+									  const std::function<void(SH9Color&, SHProjectionReport*, bool)>& project,
+									  uint32_t referenceDimension, float maxErrorThreshold)
+	{
+		SHValidationResult result = {};
+		result.name = name;
+
+		SHProjectionReport scalarReport = {}, simdReport = {};
+		SH9Color scalarSH, simdSH;
+		project(scalarSH, &scalarReport, true);
+		project(simdSH, &simdReport, false);
+
+		result.projectMs = simdReport.projectMs;
+		result.projectScalarMs = scalarReport.projectMs;
+
+		float largestCoefficient = 0.0f;
+		for (int k = 0; k < 9; ++k)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				largestCoefficient = std::max(largestCoefficient, std::fabs((&scalarSH.coefficients[k].x)[c]));
+				result.simdDifference = std::max(result.simdDifference, std::fabs((&simdSH.coefficients[k].x)[c] - (&scalarSH.coefficients[k].x)[c]));
+			}
+		}
+		result.simdDifference /= std::max(largestCoefficient, 1e-6f);
+
+		const auto referenceStart = std::chrono::high_resolution_clock::now();
+		const std::vector<glm::vec3> vecReference = ComputeReferenceIrradiance(layout, rowCount, rowLength, getRow, referenceDimension);
+		const auto referenceEnd = std::chrono::high_resolution_clock::now();
+		result.referenceMs = std::chrono::duration<float, std::milli>(referenceEnd - referenceStart).count();
+
+		// Errors relative to the brightest reference value, relative to each texel would blow up in the dark side of the sun case
+		float brightest = 0.0f;
+		double errorSum = 0.0;
+		float errorMax = 0.0f;
+		for (uint32_t i = 0; i < vecReference.size(); ++i)
+		{
+			const uint32_t face = i / (referenceDimension * referenceDimension);
+			const uint32_t texel = i % (referenceDimension * referenceDimension);
+			const glm::vec3 normal = CubemapDirection(face, ((texel % referenceDimension) + 0.5f) / referenceDimension, ((texel / referenceDimension) + 0.5f) / referenceDimension);
+			const glm::vec3 estimate = EvaluateIrradianceSH(simdSH, normal);
+
+			for (int c = 0; c < 3; ++c)
+			{
+				const float error = std::fabs((&estimate.x)[c] - (&vecReference[i].x)[c]);
+				brightest = std::max(brightest, (&vecReference[i].x)[c]);
+				errorMax = std::max(errorMax, error);
+				errorSum += error;
+			}
+		}
+
+		brightest = std::max(brightest, 1e-6f);
+		result.maxRelativeError = errorMax / brightest;
+		result.meanRelativeError = static_cast<float>(errorSum / (vecReference.size() * 3)) / brightest;
+		result.bValid = result.maxRelativeError <= maxErrorThreshold && result.simdDifference <= 1e-4f;
+
+		LOG_INFO("SH {0}: {1:.3f} ms ({2:.3f} ms scalar, {3} threads), reference {4:.1f} ms, max error {5:.2f}%, mean {6:.3f}%, SIMD difference {7:.2e}, {8}",
+				 name, result.projectMs, result.projectScalarMs, simdReport.threadCount, result.referenceMs,
+				 result.maxRelativeError * 100.0f, result.meanRelativeError * 100.0f, result.simdDifference, result.bValid ? "valid" : "FAILED");
+
+		return result;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<SHValidationResult> RunSHValidation()
+	{
+		const char* arrNames[4] = { "Constant", "Sky", "Sun", "Noise" };
+
+		// Order 2 SH leaves a few percent of a directional light's lobe out, smoother lighting stays within a percent or two
+		const float arrThresholds[4] = { 1e-4f, 0.02f, 0.1f, 0.02f };
+
+		struct SourceSize
+		{
+			uint32_t			equirectWidth;
+			uint32_t			cubeDimension;
+			uint32_t			referenceDimension;
+		};
+		const SourceSize arrSizes[2] = { { 256, 64, 32 }, { 2048, 512, 8 } };
+
+		std::vector<SHValidationResult> vecResults;
+
+		for (const SourceSize& size : arrSizes)
+		{
+			for (uint32_t environment = 0; environment < 4; ++environment)
+			{
+				// The large sources only time the sky, the small ones already cover the error of every environment
+				if (size.equirectWidth > 256 && environment != 1)
+					continue;
+
+				const uint32_t width = size.equirectWidth;
+				const uint32_t height = width / 2;
+
+				std::vector<float> vecEquirect(static_cast<size_t>(width) * height * 4);
+				JobSystem::getInstance().ParallelFor(height, 16, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t y = begin; y < end; ++y)
+					{
+						for (uint32_t x = 0; x < width; ++x)
+						{
+							const glm::vec3 radiance = SampleValidationEnvironment(environment, EquirectDirection((x + 0.5f) / width, (y + 0.5f) / height));
+							float* pTexel = &vecEquirect[(static_cast<size_t>(y) * width + x) * 4];
+							pTexel[0] = radiance.x;
+							pTexel[1] = radiance.y;
+							pTexel[2] = radiance.z;
+							pTexel[3] = 1.0f;
+						}
+					}
+				});
+
+				EquirectLayout equirectLayout;
+				equirectLayout.Build(width, height);
+
+				vecResults.push_back(ValidateSource(std::string(arrNames[environment]) + " equirect " + std::to_string(width) + "x" + std::to_string(height),
+													equirectLayout, height, width,
+													[&](uint32_t y) { return &vecEquirect[static_cast<size_t>(y) * width * 4]; },
+													[&](SH9Color& outSH, SHProjectionReport* pReport, bool bScalar) { ProjectEquirectSH(vecEquirect.data(), width, height, outSH, pReport, bScalar); },
+													size.referenceDimension, arrThresholds[environment]));
+
+				const uint32_t dimension = size.cubeDimension;
+				const size_t faceFloats = static_cast<size_t>(dimension) * dimension * 4;
+
+				std::vector<float> vecCube(faceFloats * 6);
+				JobSystem::getInstance().ParallelFor(dimension * 6, 16, [&](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t rowIndex = begin; rowIndex < end; ++rowIndex)
+					{
+						const uint32_t face = rowIndex / dimension;
+						const uint32_t y = rowIndex % dimension;
+						for (uint32_t x = 0; x < dimension; ++x)
+						{
+							const glm::vec3 radiance = SampleValidationEnvironment(environment, CubemapDirection(face, (x + 0.5f) / dimension, (y + 0.5f) / dimension));
+							float* pTexel = &vecCube[face * faceFloats + (static_cast<size_t>(y) * dimension + x) * 4];
+							pTexel[0] = radiance.x;
+							pTexel[1] = radiance.y;
+							pTexel[2] = radiance.z;
+							pTexel[3] = 1.0f;
+						}
+					}
+				});
+
+				const float* arrFaces[6];
+				for (uint32_t face = 0; face < 6; ++face)
+					arrFaces[face] = &vecCube[face * faceFloats];
+
+				CubemapLayout cubeLayout;
+				cubeLayout.Build(dimension);
+
+				vecResults.push_back(ValidateSource(std::string(arrNames[environment]) + " cube " + std::to_string(dimension),
+													cubeLayout, dimension * 6, dimension,
+													[&](uint32_t rowIndex) { return arrFaces[rowIndex / dimension] + static_cast<size_t>(rowIndex % dimension) * dimension * 4; },
+													[&](SH9Color& outSH, SHProjectionReport* pReport, bool bScalar) { ProjectCubemapSH(arrFaces, dimension, outSH, pReport, bScalar); },
+													size.referenceDimension, arrThresholds[environment]));
+			}
+		}
+
+		return vecResults;
+	}
+}
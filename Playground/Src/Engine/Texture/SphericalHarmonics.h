@@ -0,0 +1,69 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Order 2 (9 coefficient) real SH, one rgb coefficient per basis function. Basis order is l = 0, then l = 1 as y, z, x,
+	//--- then l = 2 as xy, yz, 3z^2 - 1, xz, x^2 - y^2.
+	struct SH9Color
+	{
+		glm::vec3				coefficients[9];
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Irradiance coefficients as a std140/std430 block. Cosine lobe & basis constants are folded in, so a shader gets
+	//--- the value the irradiance cube held (E / PI, diffuse light for albedo 1) as
+	//---		c0 + c1*y + c2*z + c3*x + c4*x*y + c5*y*z + c6*z*z + c7*x*z + c8*(x*x - y*y)
+	//--- for a unit normal (x, y, z), with the constant part of the 3z^2 - 1 term already moved into c0.
+	struct SHIrradianceGPU
+	{
+		glm::vec4				coefficients[9];		// rgb used, w padding
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct SHProjectionReport
+	{
+		float					projectMs;
+		uint32_t				texelCount;
+		uint32_t				threadCount;
+		bool					bSimd;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct SHValidationResult
+	{
+		std::string				name;
+		float					projectMs;				// Threaded SIMD projection
+		float					projectScalarMs;		// Single threaded scalar projection of the same source
+		float					referenceMs;			// Brute force cosine convolution, what the irradiance cube pass computed
+		float					maxRelativeError;		// Against the reference, relative to the brightest reference value
+		float					meanRelativeError;
+		float					simdDifference;			// Largest coefficient difference between the SIMD & scalar paths, relative
+		bool					bValid;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Projection of RGBA32F radiance, every texel weighted by its solid angle. Threaded across the JobSystem with an SSE
+	//--- inner loop where available, bScalar forces the single threaded reference path.
+	//---
+	//--- Equirect maps are +Y up with row 0 at the bottom like Texture::HDRImage, u = 0 at -X going towards -Z. Cube faces
+	//--- are +X, -X, +Y, -Y, +Z, -Z with the usual Vulkan face orientation.
+	void						ProjectEquirectSH(const float* pRGBA, uint32_t width, uint32_t height, SH9Color& outSH,
+												  SHProjectionReport* pOutReport = nullptr, bool bScalar = false);
+	void						ProjectCubemapSH(const float* const* ppFaces, uint32_t dimension, SH9Color& outSH,
+												 SHProjectionReport* pOutReport = nullptr, bool bScalar = false);
+
+	//--- Texel centre direction of the layouts above
+	glm::vec3					EquirectDirection(float u, float v);
+	glm::vec3					CubemapDirection(uint32_t face, float u, float v);
+
+	//--- Cosine lobe convolution, returns what the irradiance cube stored (E / PI) in the direction of a unit normal
+	glm::vec3					EvaluateIrradianceSH(const SH9Color& radianceSH, const glm::vec3& normal);
+	SHIrradianceGPU				PackIrradianceSH(const SH9Color& radianceSH);
+
+	//--- Synthetic environments (constant, sky gradient, sun, noise) projected from equirect & cube sources & compared
+	//--- against a brute force convolution at the texel directions of a 32x32 irradiance cube, plus the sky at 2k for timing
+	std::vector<SHValidationResult>	RunSHValidation();
+}
@@ -0,0 +1,229 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "TextureCompiler.h"
+
+#include <chrono>
+
+#include "MipGenerator.h"
+#include "stb_image.h"
+
+namespace Texture
+{
+	const std::string	TEXTURE_DIRECTORY				= "Assets/Textures/";
+	const std::string	COMPILED_TEXTURE_DIRECTORY		= "Assets/Textures/Compiled/";
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	TextureFormat ChooseTextureFormat(TextureType eType)
+	{
+		switch (eType)
+		{
+			case TextureType::TEXTURE_NORMAL:
+				return TextureFormat::BC5;
+
+			case TextureType::TEXTURE_ROUGHNESS:
+			case TextureType::TEXTURE_METALNESS:
+			case TextureType::TEXTURE_AO:
+				return TextureFormat::BC4;
+
+			case TextureType::TEXTURE_HDRI:
+				return TextureFormat::RGBA8;
+
+			default:
+				return TextureFormat::BC7;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool IsSRGBTexture(TextureType eType)
+	{
+		// Matches the runtime path, only albedo is treated as sRGB
+		return eType == TextureType::TEXTURE_ALBEDO;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	TextureType GuessTextureType(const std::string& fileName)
+	{
+		std::string name = std::filesystem::path(fileName).stem().string();
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		auto endsWith = [&name](const std::string& suffix)
+		{
+			return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+		};
+
+		if (endsWith("_orm") || name.find("occlusionroughnessmetal") != std::string::npos)
+			return TextureType::TEXTURE_ORM;
+
+		if (name.find("normal") != std::string::npos || endsWith("_n") || endsWith("_nrm"))
+			return TextureType::TEXTURE_NORMAL;
+
+		if (name.find("rough") != std::string::npos)
+			return TextureType::TEXTURE_ROUGHNESS;
+
+		if (name.find("metal") != std::string::npos)
+			return TextureType::TEXTURE_METALNESS;
+
+		if (name.find("occlusion") != std::string::npos || endsWith("_ao") || endsWith("ao"))
+			return TextureType::TEXTURE_AO;
+
+		if (name.find("emissive") != std::string::npos || name.find("emission") != std::string::npos)
+			return TextureType::TEXTURE_EMISSIVE;
+
+		return TextureType::TEXTURE_ALBEDO;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::string GetCompiledTexturePath(const std::string& fileName, ContainerType eContainer)
+	{
+		std::filesystem::path compiledPath(fileName);
+		compiledPath.replace_extension(eContainer == ContainerType::KTX2 ? ".ktx2" : ".dds");
+		return COMPILED_TEXTURE_DIRECTORY + compiledPath.generic_string();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Channels a format keeps, as a ComputePSNR mask
+	uint32_t GetFormatChannelMask(TextureFormat eFormat)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::BC1:	return 0x7;
+			case TextureFormat::BC4:	return 0x1;
+			case TextureFormat::BC5:	return 0x3;
+			default:					return 0xF;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool CompileTexture(const std::string& srcPath, const std::string& dstPath, TextureType eType, CompressionPreset ePreset,
+						TextureCompileReport& outReport)
+	{
+		outReport = {};
+		outReport.name = std::filesystem::path(srcPath).filename().string();
+		outReport.eFormat = ChooseTextureFormat(eType);
+
+		//--- Uncompressed path, same work VulkanTexture2D does for a CPU mip chain
+		const auto loadStart = std::chrono::high_resolution_clock::now();
+
+		int width = 0, height = 0, channels = 0;
+		stbi_uc* pImageData = stbi_load(srcPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pImageData)
+		{
+			LOG_ERROR("Failed to load {0} for compilation", srcPath);
+			return false;
+		}
+
+		MipSettings mipSettings;
+		mipSettings.eColorSpace = eType == TextureType::TEXTURE_NORMAL ? MipColorSpace::NORMAL :
+								  (IsSRGBTexture(eType) ? MipColorSpace::SRGB : MipColorSpace::LINEAR);
+
+		std::vector<MipLevel> vecMipLevels;
+		GenerateMipChain(pImageData, width, height, mipSettings, vecMipLevels);
+		stbi_image_free(pImageData);
+
+		const auto loadEnd = std::chrono::high_resolution_clock::now();
+		outReport.sourceLoadMs = std::chrono::duration<float, std::milli>(loadEnd - loadStart).count();
+
+		outReport.width = width;
+		outReport.height = height;
+		outReport.levelCount = static_cast<uint32_t>(vecMipLevels.size());
+
+		//--- Encode every level
+		const auto encodeStart = std::chrono::high_resolution_clock::now();
+
+		std::vector<std::vector<uint8_t>> vecEncodedLevels(vecMipLevels.size());
+		for (uint32_t i = 0; i < vecMipLevels.size(); ++i)
+		{
+			const MipLevel& level = vecMipLevels[i];
+			vecEncodedLevels[i].resize(ComputeLevelByteSize(outReport.eFormat, level.width, level.height));
+			CompressImage(level.vecData.data(), level.width, level.height, outReport.eFormat, ePreset, vecEncodedLevels[i].data());
+
+			outReport.uncompressedBytes += level.vecData.size();
+			outReport.compressedBytes += vecEncodedLevels[i].size();
+		}
+
+		const auto encodeEnd = std::chrono::high_resolution_clock::now();
+		outReport.encodeMs = std::chrono::duration<float, std::milli>(encodeEnd - encodeStart).count();
+
+		std::vector<uint8_t> vecDecoded(vecMipLevels[0].vecData.size());
+		DecompressImage(vecEncodedLevels[0].data(), width, height, outReport.eFormat, vecDecoded.data());
+		outReport.psnr = ComputePSNR(vecDecoded.data(), vecMipLevels[0].vecData.data(), width, height, GetFormatChannelMask(outReport.eFormat));
+
+		std::filesystem::create_directories(std::filesystem::path(dstPath).parent_path());
+		if (!WriteTextureContainer(dstPath, outReport.eFormat, IsSRGBTexture(eType), width, height, vecEncodedLevels))
+			return false;
+
+		//--- Compressed path, what VulkanTexture2D does when the compiled file exists
+		const auto containerStart = std::chrono::high_resolution_clock::now();
+
+		ContainerInfo info;
+		std::vector<uint64_t> vecOffsets;
+		bool bLoaded = ReadContainerInfo(dstPath, info);
+		if (bLoaded)
+		{
+			std::vector<uint8_t> vecStaging(static_cast<size_t>(info.GetTotalByteSize()));
+			bLoaded = ReadContainerLevels(dstPath, info, vecStaging.data(), vecOffsets);
+		}
+
+		const auto containerEnd = std::chrono::high_resolution_clock::now();
+		outReport.containerLoadMs = std::chrono::duration<float, std::milli>(containerEnd - containerStart).count();
+
+		outReport.bSuccess = bLoaded;
+		return bLoaded;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<TextureCompileReport> CompileTextureDirectory(CompressionPreset ePreset, ContainerType eContainer)
+	{
+		std::vector<TextureCompileReport> vecReports;
+		if (!std::filesystem::exists(TEXTURE_DIRECTORY))
+		{
+			LOG_ERROR("Texture directory {0} doesn't exist", TEXTURE_DIRECTORY);
+			return vecReports;
+		}
+
+		uint64_t totalUncompressed = 0;
+		uint64_t totalCompressed = 0;
+		float totalSourceLoadMs = 0.0f;
+		float totalContainerLoadMs = 0.0f;
+
+		for (const auto& entry : std::filesystem::directory_iterator(TEXTURE_DIRECTORY))
+		{
+			if (!entry.is_regular_file())
+				continue;
+
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			if (extension != ".png" && extension != ".jpg" && extension != ".jpeg" && extension != ".tga" && extension != ".bmp")
+				continue;
+
+			const std::string fileName = entry.path().filename().string();
+			const TextureType eType = GuessTextureType(fileName);
+
+			TextureCompileReport report;
+			CompileTexture(entry.path().string(), GetCompiledTexturePath(fileName, eContainer), eType, ePreset, report);
+			vecReports.push_back(report);
+
+			if (!report.bSuccess)
+				continue;
+
+			LOG_INFO("{0}: {1} {2}x{3}, {4} KB -> {5} KB, encode {6:.1f} ms, PSNR {7:.2f} dB, load {8:.2f} ms -> {9:.2f} ms",
+					 report.name, GetTextureFormatName(report.eFormat), report.width, report.height,
+					 report.uncompressedBytes / 1024, report.compressedBytes / 1024, report.encodeMs, report.psnr,
+					 report.sourceLoadMs, report.containerLoadMs);
+
+			totalUncompressed += report.uncompressedBytes;
+			totalCompressed += report.compressedBytes;
+			totalSourceLoadMs += report.sourceLoadMs;
+			totalContainerLoadMs += report.containerLoadMs;
+		}
+
+		if (totalCompressed > 0)
+		{
+			LOG_INFO("Compiled {0} textures, VRAM {1} KB -> {2} KB ({3:.1f}x), load {4:.1f} ms -> {5:.1f} ms", vecReports.size(),
+					 totalUncompressed / 1024, totalCompressed / 1024, static_cast<float>(totalUncompressed) / totalCompressed,
+					 totalSourceLoadMs, totalContainerLoadMs);
+		}
+
+		return vecReports;
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "TextureContainer.h"
+#include "Engine/Renderer/VulkanTexture2D.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct TextureCompileReport
+	{
+		std::string		name;
+		TextureFormat	eFormat;
+		bool			bSuccess;
+		uint32_t		width;
+		uint32_t		height;
+		uint32_t		levelCount;
+		uint64_t		uncompressedBytes;			// RGBA8 with the full mip chain, what the runtime path uploads
+		uint64_t		compressedBytes;
+		float			encodeMs;					// Block encoding of every level
+		float			psnr;						// Level 0, over the channels the format keeps
+		float			sourceLoadMs;				// stb_image decode + CPU mip chain, the uncompressed load path
+		float			containerLoadMs;			// Header + every level read straight into a staging sized buffer
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- BC7 for color, BC5 for normals (z gets rebuilt in the shader), BC4 for single channel masks
+	TextureFormat						ChooseTextureFormat(TextureType eType);
+	bool								IsSRGBTexture(TextureType eType);
+
+	//--- Filename keywords (orm, normal, rough, metal, ao, emissive), albedo otherwise
+	TextureType							GuessTextureType(const std::string& fileName);
+
+	//--- Where the compiled version of an Assets/Textures file lives, e.g. Assets/Textures/Compiled/Brick.ktx2
+	std::string							GetCompiledTexturePath(const std::string& fileName, ContainerType eContainer);
+
+	//--- Loads, builds the mip chain with the same settings as the runtime CPU path, block compresses every level & writes
+	//--- the container picked by dstPath's extension. Blocks within a level get encoded across the JobSystem.
+	bool								CompileTexture(const std::string& srcPath, const std::string& dstPath, TextureType eType,
+													   CompressionPreset ePreset, TextureCompileReport& outReport);
+
+	//--- Compiles every image directly inside Assets/Textures into Assets/Textures/Compiled & logs a summary
+	std::vector<TextureCompileReport>	CompileTextureDirectory(CompressionPreset ePreset, ContainerType eContainer);
+}
@@ -0,0 +1,581 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "TextureContainer.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Enum values from the Vulkan, DXGI & Khronos data format specifications, kept numeric so this stays API agnostic
+	const uint8_t	KTX2_IDENTIFIER[12]			= { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	const uint32_t	VK_FORMAT_RGBA8_UNORM		= 37;
+	const uint32_t	VK_FORMAT_RGBA8_SRGB		= 43;
+	const uint32_t	VK_FORMAT_RGBA16_SFLOAT		= 97;
+	const uint32_t	VK_FORMAT_RGBA32_SFLOAT		= 109;
+	const uint32_t	VK_FORMAT_E5B9G9R9_UFLOAT	= 123;
+	const uint32_t	VK_FORMAT_BC1_RGB_UNORM		= 131;
+	const uint32_t	VK_FORMAT_BC1_RGB_SRGB		= 132;
+	const uint32_t	VK_FORMAT_BC1_RGBA_UNORM	= 133;
+	const uint32_t	VK_FORMAT_BC1_RGBA_SRGB		= 134;
+	const uint32_t	VK_FORMAT_BC4_UNORM			= 139;
+	const uint32_t	VK_FORMAT_BC5_UNORM			= 141;
+	const uint32_t	VK_FORMAT_BC6H_UFLOAT		= 143;
+	const uint32_t	VK_FORMAT_BC7_UNORM			= 145;
+	const uint32_t	VK_FORMAT_BC7_SRGB			= 146;
+
+	const uint32_t	DXGI_FORMAT_RGBA32_FLOAT	= 2;
+	const uint32_t	DXGI_FORMAT_RGBA16_FLOAT	= 10;
+	const uint32_t	DXGI_FORMAT_RGBA8_UNORM		= 28;
+	const uint32_t	DXGI_FORMAT_RGBA8_SRGB		= 29;
+	const uint32_t	DXGI_FORMAT_R9G9B9E5		= 67;
+	const uint32_t	DXGI_FORMAT_BC1_UNORM		= 71;
+	const uint32_t	DXGI_FORMAT_BC1_SRGB		= 72;
+	const uint32_t	DXGI_FORMAT_BC4_UNORM		= 80;
+	const uint32_t	DXGI_FORMAT_BC5_UNORM		= 83;
+	const uint32_t	DXGI_FORMAT_BC6H_UF16		= 95;
+	const uint32_t	DXGI_FORMAT_BC7_UNORM		= 98;
+	const uint32_t	DXGI_FORMAT_BC7_SRGB		= 99;
+
+	const uint32_t	DDS_MAGIC					= 0x20534444;		// "DDS "
+	const uint32_t	DDS_HEADER_SIZE				= 124;
+	const uint32_t	DDS_PIXELFORMAT_SIZE		= 32;
+	const uint32_t	DDS_DX10_HEADER_SIZE		= 20;
+	const uint32_t	DDSD_REQUIRED				= 0x1 | 0x2 | 0x4 | 0x1000;			// CAPS | HEIGHT | WIDTH | PIXELFORMAT
+	const uint32_t	DDSD_MIPMAPCOUNT			= 0x20000;
+	const uint32_t	DDSD_LINEARSIZE				= 0x80000;
+	const uint32_t	DDPF_FOURCC					= 0x4;
+	const uint32_t	DDPF_RGB					= 0x40;
+	const uint32_t	DDSCAPS_TEXTURE				= 0x1000;
+	const uint32_t	DDSCAPS_COMPLEX				= 0x8;
+	const uint32_t	DDSCAPS_MIPMAP				= 0x400000;
+	const uint32_t	DDS_DIMENSION_TEXTURE2D		= 3;
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	inline uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Little endian helpers, both containers are little endian
+	inline void WriteU32(std::vector<uint8_t>& vecOut, uint32_t value)
+	{
+		for (uint32_t i = 0; i < 4; ++i)
+			vecOut.push_back(static_cast<uint8_t>(value >> (i * 8)));
+	}
+
+	inline void WriteU64(std::vector<uint8_t>& vecOut, uint64_t value)
+	{
+		for (uint32_t i = 0; i < 8; ++i)
+			vecOut.push_back(static_cast<uint8_t>(value >> (i * 8)));
+	}
+
+	inline uint32_t ReadU32(const uint8_t* pData)
+	{
+		return pData[0] | (pData[1] << 8) | (pData[2] << 16) | (static_cast<uint32_t>(pData[3]) << 24);
+	}
+
+	inline uint64_t ReadU64(const uint8_t* pData)
+	{
+		return ReadU32(pData) | (static_cast<uint64_t>(ReadU32(pData + 4)) << 32);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t GetVkFormat(TextureFormat eFormat, bool bSRGB)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::BC1:	return bSRGB ? VK_FORMAT_BC1_RGB_SRGB : VK_FORMAT_BC1_RGB_UNORM;
+			case TextureFormat::BC4:	return VK_FORMAT_BC4_UNORM;
+			case TextureFormat::BC5:	return VK_FORMAT_BC5_UNORM;
+			case TextureFormat::BC7:	return bSRGB ? VK_FORMAT_BC7_SRGB : VK_FORMAT_BC7_UNORM;
+			case TextureFormat::BC6H:	return VK_FORMAT_BC6H_UFLOAT;
+			case TextureFormat::RGBA16F:	return VK_FORMAT_RGBA16_SFLOAT;
+			case TextureFormat::RGBA32F:	return VK_FORMAT_RGBA32_SFLOAT;
+			case TextureFormat::E5B9G9R9:	return VK_FORMAT_E5B9G9R9_UFLOAT;
+			default:					return bSRGB ? VK_FORMAT_RGBA8_SRGB : VK_FORMAT_RGBA8_UNORM;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool FromVkFormat(uint32_t vkFormat, TextureFormat& eOutFormat, bool& bOutSRGB)
+	{
+		bOutSRGB = vkFormat == VK_FORMAT_RGBA8_SRGB || vkFormat == VK_FORMAT_BC1_RGB_SRGB || vkFormat == VK_FORMAT_BC1_RGBA_SRGB ||
+				   vkFormat == VK_FORMAT_BC7_SRGB;
+
+		switch (vkFormat)
+		{
+			case VK_FORMAT_RGBA8_UNORM:
+			case VK_FORMAT_RGBA8_SRGB:			eOutFormat = TextureFormat::RGBA8;	return true;
+			case VK_FORMAT_BC1_RGB_UNORM:
+			case VK_FORMAT_BC1_RGB_SRGB:
+			case VK_FORMAT_BC1_RGBA_UNORM:
+			case VK_FORMAT_BC1_RGBA_SRGB:		eOutFormat = TextureFormat::BC1;	return true;
+			case VK_FORMAT_BC4_UNORM:			eOutFormat = TextureFormat::BC4;	return true;
+			case VK_FORMAT_BC5_UNORM:			eOutFormat = TextureFormat::BC5;	return true;
+			case VK_FORMAT_BC7_UNORM:
+			case VK_FORMAT_BC7_SRGB:			eOutFormat = TextureFormat::BC7;	return true;
+			case VK_FORMAT_BC6H_UFLOAT:			eOutFormat = TextureFormat::BC6H;	return true;
+			case VK_FORMAT_RGBA16_SFLOAT:		eOutFormat = TextureFormat::RGBA16F;	return true;
+			case VK_FORMAT_RGBA32_SFLOAT:		eOutFormat = TextureFormat::RGBA32F;	return true;
+			case VK_FORMAT_E5B9G9R9_UFLOAT:		eOutFormat = TextureFormat::E5B9G9R9;	return true;
+			default:																return false;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t GetDXGIFormat(TextureFormat eFormat, bool bSRGB)
+	{
+		switch (eFormat)
+		{
+			case TextureFormat::BC1:	return bSRGB ? DXGI_FORMAT_BC1_SRGB : DXGI_FORMAT_BC1_UNORM;
+			case TextureFormat::BC4:	return DXGI_FORMAT_BC4_UNORM;
+			case TextureFormat::BC5:	return DXGI_FORMAT_BC5_UNORM;
+			case TextureFormat::BC7:	return bSRGB ? DXGI_FORMAT_BC7_SRGB : DXGI_FORMAT_BC7_UNORM;
+			case TextureFormat::BC6H:	return DXGI_FORMAT_BC6H_UF16;
+			case TextureFormat::RGBA16F:	return DXGI_FORMAT_RGBA16_FLOAT;
+			case TextureFormat::RGBA32F:	return DXGI_FORMAT_RGBA32_FLOAT;
+			case TextureFormat::E5B9G9R9:	return DXGI_FORMAT_R9G9B9E5;
+			default:					return bSRGB ? DXGI_FORMAT_RGBA8_SRGB : DXGI_FORMAT_RGBA8_UNORM;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool FromDXGIFormat(uint32_t dxgiFormat, TextureFormat& eOutFormat, bool& bOutSRGB)
+	{
+		bOutSRGB = dxgiFormat == DXGI_FORMAT_RGBA8_SRGB || dxgiFormat == DXGI_FORMAT_BC1_SRGB || dxgiFormat == DXGI_FORMAT_BC7_SRGB;
+
+		switch (dxgiFormat)
+		{
+			case DXGI_FORMAT_RGBA8_UNORM:
+			case DXGI_FORMAT_RGBA8_SRGB:		eOutFormat = TextureFormat::RGBA8;	return true;
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_SRGB:			eOutFormat = TextureFormat::BC1;	return true;
+			case DXGI_FORMAT_BC4_UNORM:			eOutFormat = TextureFormat::BC4;	return true;
+			case DXGI_FORMAT_BC5_UNORM:			eOutFormat = TextureFormat::BC5;	return true;
+			case DXGI_FORMAT_BC7_UNORM:
+			case DXGI_FORMAT_BC7_SRGB:			eOutFormat = TextureFormat::BC7;	return true;
+			case DXGI_FORMAT_BC6H_UF16:			eOutFormat = TextureFormat::BC6H;	return true;
+			case DXGI_FORMAT_RGBA16_FLOAT:		eOutFormat = TextureFormat::RGBA16F;	return true;
+			case DXGI_FORMAT_RGBA32_FLOAT:		eOutFormat = TextureFormat::RGBA32F;	return true;
+			case DXGI_FORMAT_R9G9B9E5:			eOutFormat = TextureFormat::E5B9G9R9;	return true;
+			default:																return false;
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint64_t ContainerInfo::GetTotalByteSize() const
+	{
+		uint64_t total = 0;
+		for (const ContainerLevel& level : vecLevels)
+			total += level.byteSize;
+
+		return total;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Basic data format descriptor, one block describing the texel block & its channels
+	std::vector<uint8_t> BuildKTX2DataFormatDescriptor(TextureFormat eFormat, bool bSRGB)
+	{
+		const uint32_t KHR_DF_MODEL_RGBSDA	= 1;
+		const uint32_t KHR_DF_MODEL_BC1A	= 128;
+		const uint32_t KHR_DF_MODEL_BC4		= 131;
+		const uint32_t KHR_DF_MODEL_BC5		= 132;
+		const uint32_t KHR_DF_MODEL_BC6H	= 133;
+		const uint32_t KHR_DF_MODEL_BC7		= 134;
+		const uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+		const uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+		const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+		const uint32_t KHR_DF_SAMPLE_LINEAR = 0x10;
+		const uint32_t KHR_DF_SAMPLE_FLOAT	= 0x80;
+		const uint32_t KHR_DF_SAMPLE_SIGNED_FLOAT = 0x40 | KHR_DF_SAMPLE_FLOAT;
+		const uint32_t FLOAT_MINUS_ONE		= 0xBF800000;
+		const uint32_t FLOAT_ONE			= 0x3F800000;
+
+		struct Sample
+		{
+			uint32_t	bitOffset;
+			uint32_t	bitLength;
+			uint32_t	channel;
+			uint32_t	upper;
+			uint32_t	lower;
+		};
+
+		std::vector<Sample> vecSamples;
+		uint32_t colorModel = KHR_DF_MODEL_RGBSDA;
+		uint32_t blockDimension = 0;				// Each dimension stored minus one
+
+		switch (eFormat)
+		{
+			case TextureFormat::BC1:	colorModel = KHR_DF_MODEL_BC1A;	vecSamples.push_back({ 0, 64, 0, 0xFFFFFFFF });	break;
+			case TextureFormat::BC4:	colorModel = KHR_DF_MODEL_BC4;	vecSamples.push_back({ 0, 64, 0, 0xFFFFFFFF });	break;
+			case TextureFormat::BC7:	colorModel = KHR_DF_MODEL_BC7;	vecSamples.push_back({ 0, 128, 0, 0xFFFFFFFF });	break;
+			case TextureFormat::BC6H:	colorModel = KHR_DF_MODEL_BC6H;	vecSamples.push_back({ 0, 128, KHR_DF_SAMPLE_FLOAT, FLOAT_ONE, 0 });	break;
+			case TextureFormat::BC5:
+			{
+				colorModel = KHR_DF_MODEL_BC5;
+				vecSamples.push_back({ 0, 64, 0, 0xFFFFFFFF });
+				vecSamples.push_back({ 64, 64, 1, 0xFFFFFFFF });
+				break;
+			}
+			case TextureFormat::RGBA16F:
+			case TextureFormat::RGBA32F:
+			{
+				const uint32_t bits = eFormat == TextureFormat::RGBA16F ? 16 : 32;
+				for (uint32_t c = 0; c < 4; ++c)
+					vecSamples.push_back({ c * bits, bits, (c == 3 ? 15u : c) | KHR_DF_SAMPLE_SIGNED_FLOAT, FLOAT_ONE, FLOAT_MINUS_ONE });
+				break;
+			}
+			default:
+			{
+				// Alpha is never sRGB encoded
+				for (uint32_t c = 0; c < 4; ++c)
+					vecSamples.push_back({ c * 8, 8, c == 3 ? (15u | (bSRGB ? KHR_DF_SAMPLE_LINEAR : 0u)) : c, 255 });
+				break;
+			}
+		}
+
+		if (IsBlockCompressed(eFormat))
+			blockDimension = 3 | (3 << 8);
+
+		const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(vecSamples.size());
+
+		std::vector<uint8_t> vecDFD;
+		WriteU32(vecDFD, 4 + blockSize);											// dfdTotalSize
+		WriteU32(vecDFD, 0);														// vendorId, descriptorType
+		WriteU32(vecDFD, 2 | (blockSize << 16));									// versionNumber, descriptorBlockSize
+		WriteU32(vecDFD, colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | ((bSRGB ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16));
+		WriteU32(vecDFD, blockDimension);
+		WriteU32(vecDFD, GetBlockByteSize(eFormat));								// bytesPlane0
+		WriteU32(vecDFD, 0);														// bytesPlane4..7
+
+		for (const Sample& sample : vecSamples)
+		{
+			WriteU32(vecDFD, sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+			WriteU32(vecDFD, 0);													// samplePosition
+			WriteU32(vecDFD, sample.lower);
+			WriteU32(vecDFD, sample.upper);
+		}
+
+		return vecDFD;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Level index first (level 0 first), data in the file smallest level first, each level aligned to the block size
+	void BuildKTX2(TextureFormat eFormat, bool bSRGB, uint32_t width, uint32_t height, uint32_t faceCount,
+				   const std::vector<std::vector<uint8_t>>& vecLevels, std::vector<uint8_t>& vecOut)
+	{
+		const uint32_t levelCount = static_cast<uint32_t>(vecLevels.size());
+		const uint32_t alignment = std::max(4u, GetBlockByteSize(eFormat));
+		const std::vector<uint8_t> vecDFD = BuildKTX2DataFormatDescriptor(eFormat, bSRGB);
+
+		const uint32_t levelIndexOffset = 12 + 36 + 32;
+		const uint32_t dfdOffset = levelIndexOffset + levelCount * 24;
+
+		std::vector<uint64_t> vecLevelOffsets(levelCount);
+		uint64_t offset = dfdOffset + vecDFD.size();
+		for (int32_t i = static_cast<int32_t>(levelCount) - 1; i >= 0; --i)
+		{
+			offset = (offset + alignment - 1) / alignment * alignment;
+			vecLevelOffsets[i] = offset;
+			offset += vecLevels[i].size();
+		}
+
+		vecOut.clear();
+		vecOut.reserve(static_cast<size_t>(offset));
+		vecOut.insert(vecOut.end(), KTX2_IDENTIFIER, KTX2_IDENTIFIER + 12);
+
+		WriteU32(vecOut, GetVkFormat(eFormat, bSRGB));
+		WriteU32(vecOut, 1);														// typeSize
+		WriteU32(vecOut, width);
+		WriteU32(vecOut, height);
+		WriteU32(vecOut, 0);														// pixelDepth
+		WriteU32(vecOut, 0);														// layerCount
+		WriteU32(vecOut, faceCount);
+		WriteU32(vecOut, levelCount);
+		WriteU32(vecOut, 0);														// supercompressionScheme
+
+		WriteU32(vecOut, dfdOffset);
+		WriteU32(vecOut, static_cast<uint32_t>(vecDFD.size()));
+		WriteU32(vecOut, 0);														// kvdByteOffset
+		WriteU32(vecOut, 0);														// kvdByteLength
+		WriteU64(vecOut, 0);														// sgdByteOffset
+		WriteU64(vecOut, 0);														// sgdByteLength
+
+		for (uint32_t i = 0; i < levelCount; ++i)
+		{
+			WriteU64(vecOut, vecLevelOffsets[i]);
+			WriteU64(vecOut, vecLevels[i].size());
+			WriteU64(vecOut, vecLevels[i].size());									// uncompressedByteLength
+		}
+
+		vecOut.insert(vecOut.end(), vecDFD.begin(), vecDFD.end());
+
+		for (int32_t i = static_cast<int32_t>(levelCount) - 1; i >= 0; --i)
+		{
+			vecOut.resize(static_cast<size_t>(vecLevelOffsets[i]), 0);
+			vecOut.insert(vecOut.end(), vecLevels[i].begin(), vecLevels[i].end());
+		}
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- DX10 extended header so sRGB & BC7 can be expressed, levels back to back largest first
+	void BuildDDS(TextureFormat eFormat, bool bSRGB, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& vecLevels,
+				  std::vector<uint8_t>& vecOut)
+	{
+		vecOut.clear();
+		WriteU32(vecOut, DDS_MAGIC);
+
+		WriteU32(vecOut, DDS_HEADER_SIZE);
+		WriteU32(vecOut, DDSD_REQUIRED | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+		WriteU32(vecOut, height);
+		WriteU32(vecOut, width);
+		WriteU32(vecOut, vecLevels.empty() ? 0 : static_cast<uint32_t>(vecLevels[0].size()));
+		WriteU32(vecOut, 0);														// depth
+		WriteU32(vecOut, static_cast<uint32_t>(vecLevels.size()));
+		for (uint32_t i = 0; i < 11; ++i)
+			WriteU32(vecOut, 0);													// reserved
+
+		WriteU32(vecOut, DDS_PIXELFORMAT_SIZE);
+		WriteU32(vecOut, DDPF_FOURCC);
+		WriteU32(vecOut, MakeFourCC('D', 'X', '1', '0'));
+		for (uint32_t i = 0; i < 5; ++i)
+			WriteU32(vecOut, 0);													// bit count & masks
+
+		WriteU32(vecOut, DDSCAPS_TEXTURE | (vecLevels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+		for (uint32_t i = 0; i < 4; ++i)
+			WriteU32(vecOut, 0);													// caps2..4, reserved
+
+		WriteU32(vecOut, GetDXGIFormat(eFormat, bSRGB));
+		WriteU32(vecOut, DDS_DIMENSION_TEXTURE2D);
+		WriteU32(vecOut, 0);														// miscFlag
+		WriteU32(vecOut, 1);														// arraySize
+		WriteU32(vecOut, 0);														// miscFlags2
+
+		for (const std::vector<uint8_t>& level : vecLevels)
+			vecOut.insert(vecOut.end(), level.begin(), level.end());
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool WriteTextureContainer(const std::string& filePath, TextureFormat eFormat, bool bSRGB, uint32_t width, uint32_t height,
+							   const std::vector<std::vector<uint8_t>>& vecLevels, uint32_t faceCount)
+	{
+		const std::string extension = std::filesystem::path(filePath).extension().string();
+
+		std::vector<uint8_t> vecFile;
+		if (extension == ".ktx2" && eFormat == TextureFormat::E5B9G9R9)
+		{
+			// Shared exponent needs a multi sample descriptor, DDS holds it as DXGI_FORMAT_R9G9B9E5_SHAREDEXP
+			LOG_ERROR("E5B9G9R9 can only be written to DDS ({0})", filePath);
+			return false;
+		}
+		else if (extension == ".ktx2")
+		{
+			BuildKTX2(eFormat, bSRGB, width, height, faceCount, vecLevels, vecFile);
+		}
+		else if (extension == ".dds" && faceCount != 1)
+		{
+			LOG_ERROR("Cubemaps can only be written to KTX2 ({0})", filePath);
+			return false;
+		}
+		else if (extension == ".dds")
+		{
+			BuildDDS(eFormat, bSRGB, width, height, vecLevels, vecFile);
+		}
+		else
+		{
+			LOG_ERROR("Unknown texture container {0}", filePath);
+			return false;
+		}
+
+		std::ofstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+		{
+			LOG_ERROR("Failed to open {0} for writing", filePath);
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(vecFile.data()), vecFile.size());
+		return file.good();
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadKTX2Info(std::ifstream& file, ContainerInfo& outInfo)
+	{
+		uint8_t header[80];
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		if (!file || memcmp(header, KTX2_IDENTIFIER, 12) != 0)
+			return false;
+
+		const uint32_t vkFormat = ReadU32(header + 12);
+		outInfo.width = ReadU32(header + 20);
+		outInfo.height = ReadU32(header + 24);
+
+		const uint32_t depth = ReadU32(header + 28);
+		const uint32_t layers = ReadU32(header + 32);
+		const uint32_t faces = ReadU32(header + 36);
+		const uint32_t levelCount = std::max(1u, ReadU32(header + 40));
+		const uint32_t supercompression = ReadU32(header + 44);
+
+		if (!FromVkFormat(vkFormat, outInfo.eFormat, outInfo.bSRGB))
+		{
+			LOG_ERROR("Unsupported KTX2 vkFormat {0}", vkFormat);
+			return false;
+		}
+
+		if (depth > 1 || layers > 1 || (faces != 1 && faces != 6) || (faces == 6 && outInfo.width != outInfo.height) || supercompression != 0)
+		{
+			LOG_ERROR("Only plain 2D & cubemap KTX2 textures without supercompression are supported");
+			return false;
+		}
+
+		outInfo.faceCount = faces;
+
+		std::vector<uint8_t> vecLevelIndex(levelCount * 24);
+		file.read(reinterpret_cast<char*>(vecLevelIndex.data()), vecLevelIndex.size());
+		if (!file)
+			return false;
+
+		outInfo.vecLevels.resize(levelCount);
+		for (uint32_t i = 0; i < levelCount; ++i)
+		{
+			ContainerLevel& level = outInfo.vecLevels[i];
+			level.width = std::max(1u, outInfo.width >> i);
+			level.height = std::max(1u, outInfo.height >> i);
+			level.fileOffset = ReadU64(&vecLevelIndex[i * 24]);
+			level.byteSize = ReadU64(&vecLevelIndex[i * 24 + 8]);
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadDDSInfo(std::ifstream& file, ContainerInfo& outInfo)
+	{
+		uint8_t header[4 + DDS_HEADER_SIZE];
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		if (!file || ReadU32(header) != DDS_MAGIC || ReadU32(header + 4) != DDS_HEADER_SIZE)
+			return false;
+
+		outInfo.height = ReadU32(header + 12);
+		outInfo.width = ReadU32(header + 16);
+		const uint32_t levelCount = std::max(1u, ReadU32(header + 28));
+
+		const uint8_t* pPixelFormat = header + 76;
+		const uint32_t pixelFlags = ReadU32(pPixelFormat + 4);
+		const uint32_t fourCC = ReadU32(pPixelFormat + 8);
+
+		uint64_t dataOffset = sizeof(header);
+		outInfo.bSRGB = false;
+		outInfo.faceCount = 1;
+
+		if ((pixelFlags & DDPF_FOURCC) && fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			uint8_t dx10[DDS_DX10_HEADER_SIZE];
+			file.read(reinterpret_cast<char*>(dx10), sizeof(dx10));
+			if (!file)
+				return false;
+
+			dataOffset += DDS_DX10_HEADER_SIZE;
+
+			if (!FromDXGIFormat(ReadU32(dx10), outInfo.eFormat, outInfo.bSRGB) || ReadU32(dx10 + 4) != DDS_DIMENSION_TEXTURE2D || ReadU32(dx10 + 12) > 1)
+			{
+				LOG_ERROR("Unsupported DDS DXGI format {0}", ReadU32(dx10));
+				return false;
+			}
+		}
+		else if (pixelFlags & DDPF_FOURCC)
+		{
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+				outInfo.eFormat = TextureFormat::BC1;
+			else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+				outInfo.eFormat = TextureFormat::BC4;
+			else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+				outInfo.eFormat = TextureFormat::BC5;
+			else
+			{
+				LOG_ERROR("Unsupported DDS four CC {0:x}", fourCC);
+				return false;
+			}
+		}
+		else if ((pixelFlags & DDPF_RGB) && ReadU32(pPixelFormat + 12) == 32 && ReadU32(pPixelFormat + 16) == 0xFF)
+		{
+			outInfo.eFormat = TextureFormat::RGBA8;
+		}
+		else
+		{
+			LOG_ERROR("Unsupported DDS pixel format");
+			return false;
+		}
+
+		outInfo.vecLevels.resize(levelCount);
+		for (uint32_t i = 0; i < levelCount; ++i)
+		{
+			ContainerLevel& level = outInfo.vecLevels[i];
+			level.width = std::max(1u, outInfo.width >> i);
+			level.height = std::max(1u, outInfo.height >> i);
+			level.fileOffset = dataOffset;
+			level.byteSize = ComputeLevelByteSize(outInfo.eFormat, level.width, level.height);
+			dataOffset += level.byteSize;
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadContainerInfo(const std::string& filePath, ContainerInfo& outInfo)
+	{
+		std::ifstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		const std::string extension = std::filesystem::path(filePath).extension().string();
+		outInfo.eType = extension == ".dds" ? ContainerType::DDS : ContainerType::KTX2;
+
+		const bool bValid = outInfo.eType == ContainerType::DDS ? ReadDDSInfo(file, outInfo) : ReadKTX2Info(file, outInfo);
+		if (!bValid)
+		{
+			LOG_ERROR("Failed to read texture container header ({0})", filePath);
+			return false;
+		}
+
+		// Reject files whose level sizes disagree with the format, the upload copies by extent
+		for (const ContainerLevel& level : outInfo.vecLevels)
+		{
+			if (level.byteSize != ComputeLevelByteSize(outInfo.eFormat, level.width, level.height) * outInfo.faceCount)
+			{
+				LOG_ERROR("Texture container level size mismatch ({0})", filePath);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	bool ReadContainerLevels(const std::string& filePath, const ContainerInfo& info, uint8_t* pDst, std::vector<uint64_t>& vecOutOffsets)
+	{
+		std::ifstream file(filePath, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		vecOutOffsets.clear();
+
+		uint64_t dstOffset = 0;
+		for (const ContainerLevel& level : info.vecLevels)
+		{
+			file.seekg(static_cast<std::streamoff>(level.fileOffset));
+			file.read(reinterpret_cast<char*>(pDst + dstOffset), static_cast<std::streamsize>(level.byteSize));
+			if (!file)
+			{
+				LOG_ERROR("Texture container is truncated ({0})", filePath);
+				return false;
+			}
+
+			vecOutOffsets.push_back(dstOffset);
+			dstOffset += level.byteSize;
+		}
+
+		return true;
+	}
+}
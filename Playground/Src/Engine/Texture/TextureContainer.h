@@ -0,0 +1,52 @@
+#pragma once
+
+#include "BlockCompression.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class ContainerType
+	{
+		KTX2,
+		DDS
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ContainerLevel
+	{
+		uint32_t	width;
+		uint32_t	height;
+		uint64_t	fileOffset;
+		uint64_t	byteSize;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ContainerInfo
+	{
+		ContainerType				eType;
+		TextureFormat				eFormat;
+		bool						bSRGB;
+		uint32_t					width;
+		uint32_t					height;
+		uint32_t					faceCount;			// 6 for cubemaps, a level then holds its faces back to back
+		std::vector<ContainerLevel>	vecLevels;			// Level 0 first, whatever the order in the file
+
+		// Sum of every level, i.e. staging size with the levels packed back to back
+		uint64_t					GetTotalByteSize() const;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- The container gets picked from the extension, .ktx2 or .dds. vecLevels holds the encoded levels, level 0 first.
+	//--- KTX2 gets a basic data format descriptor so other tools can read it, the loader below doesn't need it. E5B9G9R9
+	//--- is DDS only. Cubemaps (faceCount 6) are KTX2 only, each level holding +X, -X, +Y, -Y, +Z, -Z back to back.
+	bool							WriteTextureContainer(const std::string& filePath, TextureFormat eFormat, bool bSRGB, uint32_t width,
+														  uint32_t height, const std::vector<std::vector<uint8_t>>& vecLevels, uint32_t faceCount = 1);
+
+	//--- Reads only the headers. DDS also accepts legacy DXT1/ATI1/ATI2 four CCs.
+	bool							ReadContainerInfo(const std::string& filePath, ContainerInfo& outInfo);
+
+	//--- Reads every level straight into pDst, level 0 first & packed back to back, so pDst can be mapped staging memory
+	//--- of GetTotalByteSize() bytes. vecOutOffsets receives each level's offset into pDst.
+	bool							ReadContainerLevels(const std::string& filePath, const ContainerInfo& info, uint8_t* pDst,
+														std::vector<uint64_t>& vecOutOffsets);
+}
@@ -0,0 +1,509 @@
+#include "PlaygroundPCH.h"
+#include "PlaygroundHeaders.h"
+#include "TextureResidency.h"
+
+#include <chrono>
+
+#include "MipGenerator.h"
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	ResidencyManager::ResidencyManager()
+	{
+		m_Stats = {};
+		m_uiFrame = 1;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	ResidencyManager::ResidencyManager(const ResidencySettings& settings) : ResidencyManager()
+	{
+		m_Settings = settings;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t ResidencyManager::RegisterTexture(uint32_t width, uint32_t height, const std::vector<uint64_t>& vecLevelBytes)
+	{
+		TextureState state;
+		state.vecLevelBytes = vecLevelBytes;
+		state.residentMip = static_cast<uint32_t>(vecLevelBytes.size());
+		state.requestedMip = state.residentMip;
+		state.lastUsedFrame = 0;
+		state.bRegistered = true;
+
+		// First level that fits in the tail extent, the last level when none does
+		state.tailMip = 0;
+		while (state.tailMip + 1 < vecLevelBytes.size() &&
+			   std::max(std::max(1u, width >> state.tailMip), std::max(1u, height >> state.tailMip)) > m_Settings.tailExtent)
+		{
+			++state.tailMip;
+		}
+
+		if (!m_vecFreeIDs.empty())
+		{
+			const uint32_t textureID = m_vecFreeIDs.back();
+			m_vecFreeIDs.pop_back();
+			m_vecTextures[textureID] = state;
+			return textureID;
+		}
+
+		m_vecTextures.push_back(state);
+		return static_cast<uint32_t>(m_vecTextures.size() - 1);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void ResidencyManager::UnregisterTexture(uint32_t textureID)
+	{
+		TextureState& state = m_vecTextures[textureID];
+		for (uint32_t mip = state.residentMip; mip < state.vecLevelBytes.size(); ++mip)
+			m_Stats.residentBytes -= state.vecLevelBytes[mip];
+
+		state = TextureState();
+		state.bRegistered = false;
+		m_vecFreeIDs.push_back(textureID);
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void ResidencyManager::RequestMip(uint32_t textureID, uint32_t mip)
+	{
+		TextureState& state = m_vecTextures[textureID];
+		const uint32_t levelCount = static_cast<uint32_t>(state.vecLevelBytes.size());
+
+		state.requestedMip = std::min(state.requestedMip, std::min(mip, levelCount - 1));
+		state.lastUsedFrame = m_uiFrame;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	void ResidencyManager::Update(std::vector<ResidencyCommand>& vecOutCommands)
+	{
+		vecOutCommands.clear();
+
+		uint64_t uploadLeft = m_Settings.uploadBytesPerFrame;
+		bool bUploadedAny = false;
+
+		// A single level larger than the per frame bandwidth still has to load eventually
+		auto canUpload = [&](uint64_t bytes) { return !bUploadedAny || bytes <= uploadLeft; };
+
+		auto load = [&](uint32_t textureID)
+		{
+			TextureState& state = m_vecTextures[textureID];
+			const uint32_t mip = state.residentMip - 1;
+			const uint64_t bytes = state.vecLevelBytes[mip];
+
+			if (m_Stats.residentBytes + bytes > m_Settings.budgetBytes && !EvictForLoad(textureID, bytes, vecOutCommands))
+				return false;
+
+			state.residentMip = mip;
+			vecOutCommands.push_back({ textureID, mip, ResidencyAction::LOAD });
+
+			m_Stats.residentBytes += bytes;
+			m_Stats.loadedBytes += bytes;
+			++m_Stats.loads;
+
+			uploadLeft -= std::min(uploadLeft, bytes);
+			bUploadedAny = true;
+			return true;
+		};
+
+		//--- Tails first, requested textures before the rest
+		std::vector<uint32_t> vecTailOrder;
+		for (uint32_t i = 0; i < m_vecTextures.size(); ++i)
+		{
+			if (m_vecTextures[i].bRegistered && m_vecTextures[i].residentMip > m_vecTextures[i].tailMip)
+				vecTailOrder.push_back(i);
+		}
+
+		std::stable_sort(vecTailOrder.begin(), vecTailOrder.end(), [this](uint32_t a, uint32_t b)
+		{
+			return m_vecTextures[a].lastUsedFrame > m_vecTextures[b].lastUsedFrame;
+		});
+
+		bool bTailsDone = true;
+		for (uint32_t textureID : vecTailOrder)
+		{
+			TextureState& state = m_vecTextures[textureID];
+			while (state.residentMip > state.tailMip && canUpload(state.vecLevelBytes[state.residentMip - 1]))
+			{
+				if (!load(textureID))
+					break;
+			}
+
+			bTailsDone &= state.residentMip <= state.tailMip;
+		}
+
+		//--- Then one level at a time for whatever is furthest from its request, coarse levels are cheap & fix the most
+		if (bTailsDone)
+		{
+			std::vector<uint32_t> vecCandidates;
+			for (uint32_t i = 0; i < m_vecTextures.size(); ++i)
+			{
+				if (m_vecTextures[i].bRegistered && m_vecTextures[i].requestedMip < m_vecTextures[i].residentMip)
+					vecCandidates.push_back(i);
+			}
+
+			while (!vecCandidates.empty())
+			{
+				std::vector<uint32_t>::iterator best = std::max_element(vecCandidates.begin(), vecCandidates.end(), [this](uint32_t a, uint32_t b)
+				{
+					const TextureState& stateA = m_vecTextures[a];
+					const TextureState& stateB = m_vecTextures[b];
+					const uint32_t deficitA = stateA.residentMip - stateA.requestedMip;
+					const uint32_t deficitB = stateB.residentMip - stateB.requestedMip;
+					if (deficitA != deficitB)
+						return deficitA < deficitB;
+
+					// Smaller level first at equal deficit
+					return stateA.vecLevelBytes[stateA.residentMip - 1] > stateB.vecLevelBytes[stateB.residentMip - 1];
+				});
+
+				TextureState& state = m_vecTextures[*best];
+				if (!canUpload(state.vecLevelBytes[state.residentMip - 1]))
+					break;
+
+				// Nothing can make room for this one, others may still fit
+				if (!load(*best) || state.residentMip <= state.requestedMip)
+					vecCandidates.erase(best);
+			}
+		}
+
+		//--- Frame stats, then start the next frame's requests
+		m_Stats.requests = 0;
+		m_Stats.misses = 0;
+		for (TextureState& state : m_vecTextures)
+		{
+			if (state.bRegistered && state.requestedMip < state.vecLevelBytes.size())
+			{
+				++m_Stats.requests;
+				if (state.residentMip > state.requestedMip)
+					++m_Stats.misses;
+			}
+
+			state.requestedMip = static_cast<uint32_t>(state.vecLevelBytes.size());
+		}
+
+		m_Stats.peakResidentBytes = std::max(m_Stats.peakResidentBytes, m_Stats.residentBytes);
+		++m_uiFrame;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Evicts finest levels, least recently used texture first, until requiredBytes fit. Evicts nothing & returns
+	//--- false when that isn't possible without touching tails or levels still in use.
+	bool ResidencyManager::EvictForLoad(uint32_t loadingID, uint64_t requiredBytes, std::vector<ResidencyCommand>& vecOutCommands)
+	{
+		// How far down each texture can go
+		std::vector<uint32_t> vecEvictTo(m_vecTextures.size());
+		for (uint32_t i = 0; i < m_vecTextures.size(); ++i)
+		{
+			const TextureState& state = m_vecTextures[i];
+			vecEvictTo[i] = state.residentMip;
+
+			if (!state.bRegistered || i == loadingID || state.residentMip >= state.tailMip)
+				continue;
+
+			// Levels loaded this frame can't be evicted again right away
+			bool bLoadedThisFrame = false;
+			for (const ResidencyCommand& command : vecOutCommands)
+				bLoadedThisFrame |= command.textureID == i && command.eAction == ResidencyAction::LOAD;
+
+			if (bLoadedThisFrame)
+				continue;
+
+			if (state.requestedMip < state.vecLevelBytes.size())
+				vecEvictTo[i] = std::max(state.residentMip, std::min(state.requestedMip, state.tailMip));
+			else if (state.lastUsedFrame + m_Settings.keepFrames < m_uiFrame)
+				vecEvictTo[i] = state.tailMip;
+		}
+
+		//--- Plan first, so a failed eviction leaves everything resident
+		std::vector<uint32_t> vecNewResident(m_vecTextures.size());
+		for (uint32_t i = 0; i < m_vecTextures.size(); ++i)
+			vecNewResident[i] = m_vecTextures[i].residentMip;
+
+		std::vector<ResidencyCommand> vecEvictions;
+		uint64_t freedBytes = 0;
+
+		while (m_Stats.residentBytes - freedBytes + requiredBytes > m_Settings.budgetBytes)
+		{
+			int32_t victim = -1;
+			for (uint32_t i = 0; i < m_vecTextures.size(); ++i)
+			{
+				if (vecNewResident[i] >= vecEvictTo[i])
+					continue;
+
+				if (victim < 0 || m_vecTextures[i].lastUsedFrame < m_vecTextures[victim].lastUsedFrame ||
+					(m_vecTextures[i].lastUsedFrame == m_vecTextures[victim].lastUsedFrame && vecNewResident[i] < vecNewResident[victim]))
+				{
+					victim = static_cast<int32_t>(i);
+				}
+			}
+
+			if (victim < 0)
+				return false;
+
+			const uint32_t mip = vecNewResident[victim]++;
+			freedBytes += m_vecTextures[victim].vecLevelBytes[mip];
+			vecEvictions.push_back({ static_cast<uint32_t>(victim), mip, ResidencyAction::EVICT });
+		}
+
+		for (const ResidencyCommand& command : vecEvictions)
+		{
+			TextureState& state = m_vecTextures[command.textureID];
+			state.residentMip = command.mip + 1;
+
+			m_Stats.residentBytes -= state.vecLevelBytes[command.mip];
+			m_Stats.evictedBytes += state.vecLevelBytes[command.mip];
+			++m_Stats.evictions;
+
+			vecOutCommands.push_back(command);
+		}
+
+		return true;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t ResidencyManager::GetResidentMip(uint32_t textureID) const
+	{
+		return m_vecTextures[textureID].residentMip;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t ResidencyManager::GetTailMip(uint32_t textureID) const
+	{
+		return m_vecTextures[textureID].tailMip;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	uint32_t ComputeDesiredMip(uint32_t width, uint32_t height, float screenExtent)
+	{
+		const uint32_t levelCount = ComputeMipCount(width, height);
+		const float extent = static_cast<float>(std::max(width, height));
+		if (screenExtent >= extent)
+			return 0;
+
+		const float mip = std::floor(std::log2(extent / std::max(1.0f, screenExtent)));
+		return std::min(levelCount - 1, static_cast<uint32_t>(mip));
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Simulation harness
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct SimulatedTexture
+	{
+		uint32_t		width;
+		uint32_t		height;
+		float			position;							// Along the camera path
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<uint64_t> ComputeRGBA8LevelBytes(uint32_t width, uint32_t height)
+	{
+		std::vector<uint64_t> vecLevelBytes(ComputeMipCount(width, height));
+		for (uint32_t i = 0; i < vecLevelBytes.size(); ++i)
+			vecLevelBytes[i] = static_cast<uint64_t>(std::max(1u, width >> i)) * std::max(1u, height >> i) * 4;
+
+		return vecLevelBytes;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Textures are quads along a line, the camera moves from cameraStart to cameraEnd & sees everything within
+	//--- viewDistance. Screen extent falls off with distance like a perspective projection.
+	ResidencySimulationResult SimulateResidency(const std::string& name, const ResidencySettings& settings,
+												const std::vector<SimulatedTexture>& vecTextures, float cameraStart, float cameraEnd,
+												float viewDistance, uint32_t frames)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		ResidencySimulationResult result = {};
+		result.name = name;
+		result.bValid = true;
+		result.frames = frames;
+		result.framesToTails = frames;
+		result.budgetBytes = settings.budgetBytes;
+
+		ResidencyManager manager(settings);
+		std::vector<uint32_t> vecIDs;
+		std::vector<uint32_t> vecShadowMips;
+		for (const SimulatedTexture& texture : vecTextures)
+		{
+			std::vector<uint64_t> vecLevelBytes = ComputeRGBA8LevelBytes(texture.width, texture.height);
+			vecIDs.push_back(manager.RegisterTexture(texture.width, texture.height, vecLevelBytes));
+			vecShadowMips.push_back(static_cast<uint32_t>(vecLevelBytes.size()));
+		}
+
+		auto fail = [&result](const std::string& failure)
+		{
+			if (result.bValid)
+			{
+				result.bValid = false;
+				result.failure = failure;
+			}
+		};
+
+		uint64_t totalRequests = 0;
+		uint64_t totalMisses = 0;
+		std::vector<ResidencyCommand> vecCommands;
+
+		for (uint32_t frame = 0; frame < frames; ++frame)
+		{
+			const float t = frames > 1 ? static_cast<float>(frame) / (frames - 1) : 0.0f;
+			const float camera = cameraStart + (cameraEnd - cameraStart) * t;
+
+			for (uint32_t i = 0; i < vecTextures.size(); ++i)
+			{
+				const float distance = std::abs(vecTextures[i].position - camera);
+				if (distance > viewDistance)
+					continue;
+
+				const float screenExtent = 1024.0f / std::max(0.25f, distance);
+				manager.RequestMip(vecIDs[i], ComputeDesiredMip(vecTextures[i].width, vecTextures[i].height, screenExtent));
+			}
+
+			manager.Update(vecCommands);
+
+			//--- Replay the commands on our own copy of the state & check every invariant
+			std::vector<uint8_t> vecLoaded(vecTextures.size(), 0);
+			std::vector<uint8_t> vecEvicted(vecTextures.size(), 0);
+			for (const ResidencyCommand& command : vecCommands)
+			{
+				const uint32_t index = static_cast<uint32_t>(std::find(vecIDs.begin(), vecIDs.end(), command.textureID) - vecIDs.begin());
+				const uint32_t tailMip = manager.GetTailMip(command.textureID);
+
+				if (command.eAction == ResidencyAction::LOAD)
+				{
+					if (command.mip + 1 != vecShadowMips[index])
+						fail("Level loaded out of order");
+
+					if (command.mip < tailMip)
+					{
+						for (uint32_t j = 0; j < vecTextures.size(); ++j)
+						{
+							if (vecShadowMips[j] > manager.GetTailMip(vecIDs[j]))
+								fail("Level loaded before every tail");
+						}
+					}
+
+					vecShadowMips[index] = command.mip;
+					vecLoaded[index] = 1;
+				}
+				else
+				{
+					if (command.mip != vecShadowMips[index])
+						fail("Level evicted out of order");
+
+					if (command.mip >= tailMip)
+						fail("Tail level evicted");
+
+					vecShadowMips[index] = command.mip + 1;
+					vecEvicted[index] = 1;
+				}
+			}
+
+			for (uint32_t i = 0; i < vecTextures.size(); ++i)
+			{
+				if (vecLoaded[i] && vecEvicted[i])
+					fail("Texture loaded & evicted in the same frame");
+
+				if (vecShadowMips[i] != manager.GetResidentMip(vecIDs[i]))
+					fail("Commands don't match the resident state");
+			}
+
+			if (manager.GetStats().residentBytes > settings.budgetBytes)
+				fail("Budget exceeded");
+
+			bool bAllTails = true;
+			for (uint32_t i = 0; i < vecTextures.size(); ++i)
+				bAllTails &= vecShadowMips[i] <= manager.GetTailMip(vecIDs[i]);
+
+			if (bAllTails && result.framesToTails == frames)
+				result.framesToTails = frame + 1;
+
+			totalRequests += manager.GetStats().requests;
+			totalMisses += manager.GetStats().misses;
+		}
+
+		const ResidencyStats& stats = manager.GetStats();
+		result.missRate = totalRequests > 0 ? static_cast<float>(totalMisses) / totalRequests : 0.0f;
+		result.peakResidentBytes = stats.peakResidentBytes;
+		result.loads = stats.loads;
+		result.evictions = stats.evictions;
+
+		const auto end = std::chrono::high_resolution_clock::now();
+		result.timeMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+		return result;
+	}
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	std::vector<ResidencySimulationResult> RunResidencySimulation()
+	{
+		std::vector<ResidencySimulationResult> vecResults;
+
+		//--- Everything fits, should converge to full resolution without a single eviction
+		{
+			ResidencySettings settings;
+			std::vector<SimulatedTexture> vecTextures;
+			for (uint32_t i = 0; i < 16; ++i)
+				vecTextures.push_back({ 1024, 1024, 0.5f });
+
+			ResidencySimulationResult result = SimulateResidency("Static, fits", settings, vecTextures, 0.0f, 0.0f, 10.0f, 120);
+			if (result.bValid && result.evictions > 0)
+			{
+				result.bValid = false;
+				result.failure = "Evicted although everything fits";
+			}
+
+			vecResults.push_back(result);
+		}
+
+		//--- Long row of 2K textures, ~2.8 GB with mips against a 256 MB budget
+		{
+			ResidencySettings settings;
+			std::vector<SimulatedTexture> vecTextures;
+			for (uint32_t i = 0; i < 128; ++i)
+				vecTextures.push_back({ 2048, 2048, i * 2.0f });
+
+			vecResults.push_back(SimulateResidency("Fly through, 2.8 GB", settings, vecTextures, 0.0f, 256.0f, 6.0f, 600));
+		}
+
+		//--- More visible than the budget holds, must stay under it without thrashing
+		{
+			ResidencySettings settings;
+			settings.budgetBytes = 64ull * 1024 * 1024;
+
+			std::vector<SimulatedTexture> vecTextures;
+			for (uint32_t i = 0; i < 32; ++i)
+				vecTextures.push_back({ 4096, 2048, 0.25f });
+
+			vecResults.push_back(SimulateResidency("Over budget", settings, vecTextures, 0.0f, 0.0f, 10.0f, 120));
+		}
+
+		//--- Odd sizes & a tail extent larger than some textures
+		{
+			ResidencySettings settings;
+			settings.budgetBytes = 16ull * 1024 * 1024;
+			settings.tailExtent = 128;
+
+			std::vector<SimulatedTexture> vecTextures;
+			for (uint32_t i = 0; i < 48; ++i)
+				vecTextures.push_back({ 37u + i * 41u, 1000u - i * 17u, i * 1.0f });
+
+			vecResults.push_back(SimulateResidency("Odd sizes, small budget", settings, vecTextures, 0.0f, 48.0f, 4.0f, 300));
+		}
+
+		for (const ResidencySimulationResult& result : vecResults)
+		{
+			if (result.bValid)
+			{
+				LOG_INFO("Residency {0}: {1} frames, tails after {2}, miss rate {3:.1f}%, peak {4} / {5} MB, {6} loads, {7} evictions, {8:.1f} ms",
+						 result.name, result.frames, result.framesToTails, 100.0f * result.missRate, result.peakResidentBytes / (1024 * 1024),
+						 result.budgetBytes / (1024 * 1024), result.loads, result.evictions, result.timeMs);
+			}
+			else
+			{
+				LOG_ERROR("Residency {0} FAILED: {1}", result.name, result.failure);
+			}
+		}
+
+		return vecResults;
+	}
+}
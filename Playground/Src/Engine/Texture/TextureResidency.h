@@ -0,0 +1,120 @@
+#pragma once
+
+namespace Texture
+{
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ResidencySettings
+	{
+		uint64_t		budgetBytes = 256ull * 1024 * 1024;
+		uint64_t		uploadBytesPerFrame = 16ull * 1024 * 1024;		// Streaming bandwidth, loads past it wait a frame
+		uint32_t		tailExtent = 64;								// Levels this size & smaller are always resident
+		uint32_t		keepFrames = 30;								// Levels used within this many frames aren't evicted
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	enum class ResidencyAction
+	{
+		LOAD,
+		EVICT
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ResidencyCommand
+	{
+		uint32_t		textureID;
+		uint32_t		mip;
+		ResidencyAction	eAction;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ResidencyStats
+	{
+		uint64_t		residentBytes;
+		uint64_t		peakResidentBytes;
+		uint64_t		loadedBytes;
+		uint64_t		evictedBytes;
+		uint32_t		loads;
+		uint32_t		evictions;
+		uint32_t		requests;							// Last frame's requested textures
+		uint32_t		misses;								// Last frame's requests sampling a coarser level than wanted
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Decides which mips of which textures are resident under a memory budget. Textures are tracked by their finest
+	//--- resident level, everything coarser is resident too, so a level is only loaded once the level below it is &
+	//--- evicted before it. Every frame the renderer requests the finest level it would sample per texture (see
+	//--- ComputeDesiredMip), Update then issues loads & evictions:
+	//---   - Mip tails load first, so every texture has something to sample as soon as possible
+	//---   - Then one level at a time for the textures furthest from their requested level
+	//---   - Under budget pressure the finest level of the least recently used texture gets evicted, never a tail & never
+	//---     a level that's still wanted or was used within keepFrames
+	//--- Purely CPU side, the caller applies the commands to its images.
+	class ResidencyManager
+	{
+	public:
+		ResidencyManager();
+		explicit ResidencyManager(const ResidencySettings& settings);
+
+		// vecLevelBytes holds each level's size, level 0 first. Returns the texture's ID, nothing is resident yet.
+		uint32_t						RegisterTexture(uint32_t width, uint32_t height, const std::vector<uint64_t>& vecLevelBytes);
+		void							UnregisterTexture(uint32_t textureID);
+
+		// Finest level wanted this frame, several requests for a texture keep the finest
+		void							RequestMip(uint32_t textureID, uint32_t mip);
+		void							Update(std::vector<ResidencyCommand>& vecOutCommands);
+
+		// Level count when nothing is resident
+		uint32_t						GetResidentMip(uint32_t textureID) const;
+		uint32_t						GetTailMip(uint32_t textureID) const;
+
+		void							SetSettings(const ResidencySettings& settings) { m_Settings = settings; }
+		inline const ResidencySettings&	GetSettings() const { return m_Settings; }
+		inline const ResidencyStats&	GetStats() const { return m_Stats; }
+		inline uint64_t					GetFrame() const { return m_uiFrame; }
+
+	private:
+		struct TextureState
+		{
+			std::vector<uint64_t>		vecLevelBytes;
+			uint32_t					tailMip;
+			uint32_t					residentMip;
+			uint32_t					requestedMip;				// Level count when not requested this frame
+			uint64_t					lastUsedFrame;
+			bool						bRegistered;
+		};
+
+		bool							EvictForLoad(uint32_t loadingID, uint64_t requiredBytes, std::vector<ResidencyCommand>& vecOutCommands);
+
+	private:
+		ResidencySettings				m_Settings;
+		ResidencyStats					m_Stats;
+		std::vector<TextureState>		m_vecTextures;
+		std::vector<uint32_t>			m_vecFreeIDs;
+		uint64_t						m_uiFrame;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	struct ResidencySimulationResult
+	{
+		std::string		name;
+		bool			bValid;
+		std::string		failure;							// First broken invariant, empty when valid
+		uint32_t		frames;
+		uint32_t		framesToTails;						// Frames until every texture had its tail resident
+		float			missRate;							// Requests sampling a coarser level than wanted, every frame
+		uint64_t		peakResidentBytes;
+		uint64_t		budgetBytes;
+		uint32_t		loads;
+		uint32_t		evictions;
+		float			timeMs;
+	};
+
+	//-----------------------------------------------------------------------------------------------------------------------
+	//--- Finest level worth sampling for a texture covering screenExtent pixels along its longest side.
+	uint32_t							ComputeDesiredMip(uint32_t width, uint32_t height, float screenExtent);
+
+	//--- Runs the policy against synthetic camera paths (everything fits, a fly through a long row of textures, a budget
+	//--- smaller than what's visible) & checks its invariants every frame: budget respected, tails loaded first & never
+	//--- evicted, levels contiguous, no level loaded & evicted in the same frame.
+	std::vector<ResidencySimulationResult>	RunResidencySimulation();
+}